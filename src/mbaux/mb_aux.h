@@ -211,6 +211,9 @@ void mb_plot_string(double x, double y, double hgt, double angle, char *label);
 /* mb_surface function prototypes */
 int mb_surface(int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin, double xxmax, double yymin,
                double yymax, double xxinc, double yyinc, double ttension, float *sgrid);
+int mb_surface_tiled(int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin, double xxmax, double yymin,
+                     double yymax, double xxinc, double yyinc, double ttension, int tile_dim, int tile_overlap, int nthreads,
+                     float *sgrid);
 int mb_zgrid(float *z, int *n_columns, int *n_rows, float *x1, float *y1, float *dx, float *dy, float *xyz, int *n, float *zpij, int *knxt,
              bool *imnew, float *cay, int *nrng);
 int mb_zgrid2(float *z, int *n_columns, int *n_rows, float *x1, float *y1, float *dx, float *dy, float *xyz, int *n, float *zpij, int *knxt,
@@ -278,6 +281,27 @@ void mblsqr_lsqr(int m, int n, void (*aprod)(int mode, int m, int n, double x[],
                  int *istop_out, int *itn_out, double *anorm_out, double *acond_out, double *rnorm_out, double *arnorm_out,
                  double *xnorm_out);
 
+/* Compressed sparse row form of an LSQR matrix together with its
+   transpose, so that both aprod modes are row parallel. The rows of the
+   transpose keep the original row order, making the products bitwise
+   identical to a serial loop over the source fill. */
+struct mblsqr_csr {
+	int m;          /* number of rows */
+	int n;          /* number of columns */
+	int nnz;        /* number of stored entries */
+	int *row_start; /* m + 1 offsets of each row into col and a */
+	int *col;       /* column of each entry */
+	double *a;      /* value of each entry */
+	int *col_start; /* n + 1 offsets of each column into row and at */
+	int *row;       /* row of each transpose entry */
+	double *at;     /* value of each transpose entry */
+};
+
+int mblsqr_csr_init(int verbose, int m, int n, int ia_dim, const int *nia, const int *ia, const double *a,
+                    struct mblsqr_csr *csr, int *error);
+int mblsqr_csr_deall(int verbose, struct mblsqr_csr *csr, int *error);
+void mblsqr_csr_aprod(int mode, int m, int n, double x[], double y[], void *UsrWrk);
+
 #define ZERO 0.0
 #define ONE 1.0
 
@@ -327,6 +351,11 @@ double mbcblas_dnrm2(const int N, const double *X, const int incX);
 
 void mbcblas_dscal(const int N, const double alpha, double *X, const int incX);
 
+/* Number of threads used by mbcblas_daxpy, mbcblas_dscal and
+   mblsqr_csr_aprod on long vectors; the default of 1 is serial. */
+void mbcblas_set_num_threads(int nthreads);
+int mbcblas_get_num_threads(void);
+
 void mbcblas_dgemv(const enum MBCBLAS_ORDER order, const enum MBCBLAS_TRANSPOSE TransA, const int M, const int N,
                    const double alpha, const double *A, const int lda, const double *X, const int incX, const double beta,
                    double *Y, const int incY);
@@ -52,7 +52,9 @@
  *
  */
 
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -480,6 +482,152 @@ void lspeig(const double *a, const int *ia, const int *nia, int nnz, int nc,
    - mbcblas_dscal
 */
 
+/*----------------------------------------------------------------------*/
+/* Worker pool shared by the unit stride level 1 kernels and the sparse
+   matrix products. The caller runs the first slice of each job itself and
+   the workers, started on first use, run the rest. Vectors shorter than
+   MBCBLAS_CHUNK_MIN per thread are processed serially since the memory
+   bandwidth of one core already saturates on them. Every element is
+   computed exactly as in the serial loops, so results do not depend on
+   the number of threads. */
+#define MBCBLAS_CHUNK_MIN 16384
+
+typedef void (*mbcblas_job)(void *arg, int ithread, int njob);
+
+struct mbcblas_worker {
+	int ithread;
+	unsigned long generation;
+};
+
+static struct {
+	pthread_mutex_t dispatch; /* held by the one caller using the pool */
+	pthread_mutex_t mutex;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	int nthreads;             /* threads per job, including the caller */
+	int nworkers;             /* worker threads started so far */
+	unsigned long generation; /* incremented for each job */
+	int pending;              /* workers still running the current job */
+	mbcblas_job job;
+	void *arg;
+	int njob;
+	struct mbcblas_worker workers[MB_THREAD_MAX];
+} mbcblas_pool = {.dispatch = PTHREAD_MUTEX_INITIALIZER,
+                  .mutex = PTHREAD_MUTEX_INITIALIZER,
+                  .start = PTHREAD_COND_INITIALIZER,
+                  .done = PTHREAD_COND_INITIALIZER,
+                  .nthreads = 1};
+
+static void *mbcblas_worker_thread(void *arg) {
+	struct mbcblas_worker *worker = (struct mbcblas_worker *)arg;
+
+	pthread_mutex_lock(&mbcblas_pool.mutex);
+	while (true) {
+		while (mbcblas_pool.generation == worker->generation)
+			pthread_cond_wait(&mbcblas_pool.start, &mbcblas_pool.mutex);
+		worker->generation = mbcblas_pool.generation;
+		if (worker->ithread < mbcblas_pool.njob) {
+			const mbcblas_job job = mbcblas_pool.job;
+			void *job_arg = mbcblas_pool.arg;
+			const int njob = mbcblas_pool.njob;
+			pthread_mutex_unlock(&mbcblas_pool.mutex);
+			(*job)(job_arg, worker->ithread, njob);
+			pthread_mutex_lock(&mbcblas_pool.mutex);
+			if (--mbcblas_pool.pending == 0)
+				pthread_cond_signal(&mbcblas_pool.done);
+		}
+	}
+	return NULL;
+}
+
+/* Run job on njob slices, falling back to one serial slice when the pool
+   is in use by another thread or no workers can be started. */
+static void mbcblas_pool_run(mbcblas_job job, void *arg, int njob) {
+	if (njob <= 1 || pthread_mutex_trylock(&mbcblas_pool.dispatch) != 0) {
+		(*job)(arg, 0, 1);
+		return;
+	}
+
+	pthread_mutex_lock(&mbcblas_pool.mutex);
+	while (mbcblas_pool.nworkers < njob - 1) {
+		struct mbcblas_worker *worker = &mbcblas_pool.workers[mbcblas_pool.nworkers];
+		worker->ithread = mbcblas_pool.nworkers + 1;
+		worker->generation = mbcblas_pool.generation;
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, mbcblas_worker_thread, worker) != 0)
+			break;
+		pthread_detach(thread);
+		mbcblas_pool.nworkers++;
+	}
+	njob = MIN(njob, mbcblas_pool.nworkers + 1);
+	mbcblas_pool.job = job;
+	mbcblas_pool.arg = arg;
+	mbcblas_pool.njob = njob;
+	mbcblas_pool.pending = njob - 1;
+	mbcblas_pool.generation++;
+	pthread_cond_broadcast(&mbcblas_pool.start);
+	pthread_mutex_unlock(&mbcblas_pool.mutex);
+
+	(*job)(arg, 0, njob);
+
+	pthread_mutex_lock(&mbcblas_pool.mutex);
+	while (mbcblas_pool.pending > 0)
+		pthread_cond_wait(&mbcblas_pool.done, &mbcblas_pool.mutex);
+	pthread_mutex_unlock(&mbcblas_pool.mutex);
+	pthread_mutex_unlock(&mbcblas_pool.dispatch);
+}
+
+/* number of slices for a job touching n elements */
+static int mbcblas_pool_njob(int n) {
+	return MAX(1, MIN(mbcblas_pool.nthreads, n / MBCBLAS_CHUNK_MIN));
+}
+
+void mbcblas_set_num_threads(int nthreads) {
+	pthread_mutex_lock(&mbcblas_pool.dispatch);
+	mbcblas_pool.nthreads = MAX(1, MIN(nthreads, MB_THREAD_MAX));
+	pthread_mutex_unlock(&mbcblas_pool.dispatch);
+}
+
+int mbcblas_get_num_threads(void) {
+	return mbcblas_pool.nthreads;
+}
+
+struct mbcblas_vector_job {
+	int n;
+	double alpha;
+	const double *X;
+	double *Y;
+};
+
+static void mbcblas_daxpy_unit(const int N, const double alpha, const double *X, double *Y) {
+	const int m = N % 4;
+
+	for (int i = 0; i < m; i++)
+		Y[i] += alpha * X[i];
+
+	for (int i = m; i + 3 < N; i += 4) {
+		Y[i] += alpha * X[i];
+		Y[i + 1] += alpha * X[i + 1];
+		Y[i + 2] += alpha * X[i + 2];
+		Y[i + 3] += alpha * X[i + 3];
+	}
+}
+
+static void mbcblas_daxpy_job(void *arg, int ithread, int njob) {
+	const struct mbcblas_vector_job *v = (const struct mbcblas_vector_job *)arg;
+	const int i0 = (int)((long)v->n * ithread / njob);
+	const int i1 = (int)((long)v->n * (ithread + 1) / njob);
+	mbcblas_daxpy_unit(i1 - i0, v->alpha, &v->X[i0], &v->Y[i0]);
+}
+
+static void mbcblas_dscal_job(void *arg, int ithread, int njob) {
+	const struct mbcblas_vector_job *v = (const struct mbcblas_vector_job *)arg;
+	const int i0 = (int)((long)v->n * ithread / njob);
+	const int i1 = (int)((long)v->n * (ithread + 1) / njob);
+	for (int i = i0; i < i1; i++)
+		v->Y[i] *= v->alpha;
+}
+
 /*!
   \param[in]     N
   \param[in]     alpha
@@ -495,17 +643,13 @@ void mbcblas_daxpy(const int N, const double alpha, const double *X, const int i
 		return;
 
 	if (incX == 1 && incY == 1) {
-		const int m = N % 4;
-
-		for (int i = 0; i < m; i++)
-			Y[i] += alpha * X[i];
-
-		for (int i = m; i + 3 < N; i += 4) {
-			Y[i] += alpha * X[i];
-			Y[i + 1] += alpha * X[i + 1];
-			Y[i + 2] += alpha * X[i + 2];
-			Y[i + 3] += alpha * X[i + 3];
+		const int njob = mbcblas_pool_njob(N);
+		if (njob > 1) {
+			struct mbcblas_vector_job v = {N, alpha, X, Y};
+			mbcblas_pool_run(mbcblas_daxpy_job, &v, njob);
 		}
+		else
+			mbcblas_daxpy_unit(N, alpha, X, Y);
 	}
 	else {
 		int ix = MBCBLAS_OFFSET(N, incX);
@@ -607,6 +751,13 @@ void mbcblas_dscal(const int N, const double alpha, double *X, const int incX) {
 	if (incX <= 0)
 		return;
 
+	const int njob = incX == 1 ? mbcblas_pool_njob(N) : 1;
+	if (njob > 1) {
+		struct mbcblas_vector_job v = {N, alpha, NULL, X};
+		mbcblas_pool_run(mbcblas_dscal_job, &v, njob);
+		return;
+	}
+
 	int ix = MBCBLAS_OFFSET(N, incX);
 
 	for (int i = 0; i < N; i++) {
@@ -1320,3 +1471,194 @@ void mblsqr_lsqr(int m, int n, void (*aprod)(int mode, int m, int n, double x[],
 	return;
 }
 // ---------------------------------------------------------------------
+/*----------------------------------------------------------------------*/
+/* Sparse matrix products for LSQR using a compressed sparse row matrix
+   and its transpose. The matrix is given in the fixed stride form used
+   by mb_aprod: row i holds nia[i] entries at ia[ia_dim*i+j], a[ia_dim*i+j]. */
+int mblsqr_csr_init(int verbose, int m, int n, int ia_dim, const int *nia, const int *ia, const double *a,
+                    struct mblsqr_csr *csr, int *error) {
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+		fprintf(stderr, "dbg2  Input arguments:\n");
+		fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+		fprintf(stderr, "dbg2       m:          %d\n", m);
+		fprintf(stderr, "dbg2       n:          %d\n", n);
+		fprintf(stderr, "dbg2       ia_dim:     %d\n", ia_dim);
+		fprintf(stderr, "dbg2       csr:        %p\n", (void *)csr);
+	}
+
+	int status = MB_SUCCESS;
+	memset(csr, 0, sizeof(struct mblsqr_csr));
+
+	long nnz = 0;
+	bool valid = m >= 0 && n >= 0 && ia_dim >= 0;
+	for (int i = 0; valid && i < m; i++) {
+		if (nia[i] < 0 || nia[i] > ia_dim)
+			valid = false;
+		for (int j = 0; valid && j < nia[i]; j++)
+			if (ia[(long)ia_dim * i + j] < 0 || ia[(long)ia_dim * i + j] >= n)
+				valid = false;
+		nnz += nia[i];
+	}
+	if (!valid || nnz > INT_MAX) {
+		*error = MB_ERROR_BAD_PARAMETER;
+		status = MB_FAILURE;
+	}
+
+	if (status == MB_SUCCESS) {
+		csr->m = m;
+		csr->n = n;
+		csr->nnz = (int)nnz;
+		csr->row_start = (int *)malloc((m + 1) * sizeof(int));
+		csr->col = (int *)malloc(MAX(nnz, 1) * sizeof(int));
+		csr->a = (double *)malloc(MAX(nnz, 1) * sizeof(double));
+		csr->col_start = (int *)calloc(n + 1, sizeof(int));
+		csr->row = (int *)malloc(MAX(nnz, 1) * sizeof(int));
+		csr->at = (double *)malloc(MAX(nnz, 1) * sizeof(double));
+		if (csr->row_start == NULL || csr->col == NULL || csr->a == NULL || csr->col_start == NULL || csr->row == NULL ||
+		    csr->at == NULL) {
+			int error_deall;
+			mblsqr_csr_deall(verbose, csr, &error_deall);
+			*error = MB_ERROR_MEMORY_FAIL;
+			status = MB_FAILURE;
+		}
+	}
+
+	if (status == MB_SUCCESS) {
+		/* compress the rows, counting the entries of each column */
+		int k = 0;
+		for (int i = 0; i < m; i++) {
+			csr->row_start[i] = k;
+			for (int j = 0; j < nia[i]; j++) {
+				csr->col[k] = ia[(long)ia_dim * i + j];
+				csr->a[k] = a[(long)ia_dim * i + j];
+				csr->col_start[csr->col[k] + 1]++;
+				k++;
+			}
+		}
+		csr->row_start[m] = k;
+
+		/* fill the transpose in row order so that mode 2 sums each
+		   column in the same order as the serial loop */
+		for (int j = 0; j < n; j++)
+			csr->col_start[j + 1] += csr->col_start[j];
+		for (int i = 0; i < m; i++) {
+			for (int k = csr->row_start[i]; k < csr->row_start[i + 1]; k++) {
+				const int kt = csr->col_start[csr->col[k]]++;
+				csr->row[kt] = i;
+				csr->at[kt] = csr->a[k];
+			}
+		}
+		for (int j = n; j > 0; j--)
+			csr->col_start[j] = csr->col_start[j - 1];
+		csr->col_start[0] = 0;
+		*error = MB_ERROR_NO_ERROR;
+	}
+
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+		fprintf(stderr, "dbg2  Return values:\n");
+		fprintf(stderr, "dbg2       nnz:        %d\n", csr->nnz);
+		fprintf(stderr, "dbg2       error:      %d\n", *error);
+		fprintf(stderr, "dbg2  Return status:\n");
+		fprintf(stderr, "dbg2       status:     %d\n", status);
+	}
+
+	return (status);
+}
+
+int mblsqr_csr_deall(int verbose, struct mblsqr_csr *csr, int *error) {
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+		fprintf(stderr, "dbg2  Input arguments:\n");
+		fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+		fprintf(stderr, "dbg2       csr:        %p\n", (void *)csr);
+	}
+
+	free(csr->row_start);
+	free(csr->col);
+	free(csr->a);
+	free(csr->col_start);
+	free(csr->row);
+	free(csr->at);
+	memset(csr, 0, sizeof(struct mblsqr_csr));
+
+	const int status = MB_SUCCESS;
+	*error = MB_ERROR_NO_ERROR;
+
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+		fprintf(stderr, "dbg2  Return values:\n");
+		fprintf(stderr, "dbg2       error:      %d\n", *error);
+		fprintf(stderr, "dbg2  Return status:\n");
+		fprintf(stderr, "dbg2       status:     %d\n", status);
+	}
+
+	return (status);
+}
+
+struct mblsqr_csr_job {
+	int nout;         /* rows of the product */
+	const int *start; /* nout + 1 entry offsets */
+	const int *index;
+	const double *value;
+	const double *in;
+	double *out;
+};
+
+/* first row whose entries start at or after entry k */
+static int mblsqr_csr_split(const int *start, int nout, long k) {
+	int lo = 0;
+	int hi = nout;
+	while (lo < hi) {
+		const int mid = lo + (hi - lo) / 2;
+		if (start[mid] < k)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* out += M*in over the rows holding this slice's share of the entries */
+static void mblsqr_csr_job(void *arg, int ithread, int njob) {
+	const struct mblsqr_csr_job *p = (const struct mblsqr_csr_job *)arg;
+	const long nnz = p->start[p->nout];
+	const int i0 = ithread > 0 ? mblsqr_csr_split(p->start, p->nout, nnz * ithread / njob) : 0;
+	const int i1 = ithread < njob - 1 ? mblsqr_csr_split(p->start, p->nout, nnz * (ithread + 1) / njob) : p->nout;
+
+	for (int i = i0; i < i1; i++) {
+		double sum = p->out[i];
+		for (int k = p->start[i]; k < p->start[i + 1]; k++)
+			sum += p->value[k] * p->in[p->index[k]];
+		p->out[i] = sum;
+	}
+}
+
+void mblsqr_csr_aprod(int mode, int m, int n, double x[], double y[], void *UsrWrk) {
+	// mode == 1 : compute y = y + A*x
+	// mode == 2 : compute x = x + A(transpose)*y
+	const struct mblsqr_csr *csr = (const struct mblsqr_csr *)UsrWrk;
+	struct mblsqr_csr_job p;
+
+	if (mode == 1) {
+		p.nout = m;
+		p.start = csr->row_start;
+		p.index = csr->col;
+		p.value = csr->a;
+		p.in = x;
+		p.out = y;
+	}
+	else if (mode == 2) {
+		p.nout = n;
+		p.start = csr->col_start;
+		p.index = csr->row;
+		p.value = csr->at;
+		p.in = y;
+		p.out = x;
+	}
+	else
+		return;
+
+	mbcblas_pool_run(mblsqr_csr_job, &p, mbcblas_pool_njob(csr->nnz));
+}
@@ -55,12 +55,28 @@
  * Author:	D. W. Caress
  * Date:	May 2, 1994
  *
+ * The state formerly held in file scope static variables now lives in
+ * a struct mb_surface_ctx allocated for each call, so that any number
+ * of surface fits may run concurrently. mb_surface_tiled() fits a large
+ * grid as overlapping tiles in parallel and blends the seams; a grid
+ * small enough for one tile is fit whole, relaxing the grid with
+ * several threads. Both give the same result for any number of threads,
+ * but relax the nodes in a different order than mb_surface(), so the
+ * grids differ slightly from those of mb_surface(). Each tile is fit
+ * over twice the overlap beyond its blending zone, and agrees closely
+ * with a fit of the whole grid except where data gaps are wider than
+ * that. A fit of the whole grid whose dimensions minus one have no
+ * common factor gets no coarse grid stages and may not converge in the
+ * iterations allowed, while the tiles always do, so there the tiled
+ * fit is the better one.
  *
  */
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "mb_aux.h"
 #include "mb_define.h"
@@ -75,239 +91,263 @@
 
 const int OUTSIDE = 2000000000; /* Index number indicating data is outside useable area */
 
+/* default tile dimension and overlap (in grid nodes) for mb_surface_tiled() */
+#define MB_SURFACE_TILE_DIM 1024
+#define MB_SURFACE_TILE_OVERLAP 64
+
 struct MB_SURFACE_DATA {
 	float x;
 	float y;
 	float z;
 	int index;
+	double dist; /* Distance to the constrained node, used for sorting */
 };
 
 struct MB_SURFACE_BRIGGS {
 	double b[6];
 };
 
-static int npoints = 0; /* Number of data points */
-static int n_columns = 0;      /* Number of nodes in x-dir. */
-static int n_rows = 0;      /* Number of nodes in y-dir. (Final grid) */
-static int m_columns = 0;
-static int m_rows = 0;
-static int ij_sw_corner, ij_se_corner, ij_nw_corner, ij_ne_corner;
-static int block_n_columns;             /* Number of nodes in x-dir for a given grid factor */
-static int block_n_rows;             /* Number of nodes in y-dir for a given grid factor */
-static int max_iterations = 250; /* Max iter per call to iterate */
-static int total_iterations = 0;
-static int grid, old_grid; /* Node spacings  */
-static int grid_east;
-static int n_fact = 0;  /* Number of factors in common (n_rows-1, n_columns-1) */
-static int factors[32]; /* Array of common factors */
-static int local_verbose = FALSE;
-static int local_error = MB_ERROR_NO_ERROR;
-static int status = MB_SUCCESS;
-// static int n_empty;                                     /* No of unconstrained nodes at initialization  */
-static int set_low = 0;                                 /* 0 unconstrained,1 = by min data value, 2 = by user value */
-static int set_high = 0;                                /* 0 unconstrained,1 = by max data value, 2 = by user value */
-static int constrained = FALSE;                         /* TRUE if set_low or set_high is TRUE */
-static double low_limit, high_limit;                    /* Constrains on range of solution */
-static double xmin, xmax, ymin, ymax;                   /* minmax coordinates */
-static float *lower, *upper;                            /* arrays for minmax values, if set */
-static double xinc, yinc;                               /* Size of each grid cell (final size) */
-static double grid_xinc, grid_yinc;                     /* size of each grid cell for a given grid factor */
-static double r_xinc, r_yinc, r_grid_xinc, r_grid_yinc; /* Reciprocals  */
-static double converge_limit = 0.0;                     /* Convergence limit */
-static double radius = 0.0;                             /* Search radius for initializing grid  */
-static double tension = 0.00;                           /* Tension parameter on the surface  */
-static double boundary_tension = 0.0;
-static double interior_tension = 0.0;
-static double a0_const_1, a0_const_2; /* Constants for off grid point equation  */
-static double e_2, e_m2, one_plus_e2;
-static double eps_p2, eps_m2, two_plus_ep2, two_plus_em2;
-static double x_edge_const, y_edge_const;
-static double epsilon = 1.0;
-static double z_mean;
-static double z_scale = 1.0;                /* Root mean square range of z after removing planar trend  */
-static double r_z_scale = 1.0;              /* reciprocal of z_scale  */
-static double plane_c0, plane_c1, plane_c2; /* Coefficients of best fitting plane to data  */
-static double smalldistance;                /* Let data point coincide with node if distance < smalldistance */
-static float *u;                            /* Pointer to grid array */
-static char *iu;                            /* Pointer to grid info array */
-static char mode_type[2] = {'I', 'D'};      /* D means include data points when iterating
-                                             * I means just interpolate from larger grid */
-
-static int offset[25][12];  /* Indices of 12 nearby points in 25 cases of edge conditions  */
-static double coeff[2][12]; /* Coefficients for 12 nearby points, constrained and unconstrained  */
-
-static double relax_old, relax_new = 1.4; /* Coefficients for relaxation factor to speed up convergence */
-
-static struct MB_SURFACE_DATA *data;     /* Data point and index to node it currently constrains  */
-static struct MB_SURFACE_BRIGGS *briggs; /* Coefficients in Taylor series for Laplacian(z) a la I. C. Briggs (1974)  */
-
-void set_coefficients() {
-	const double loose = 1.0 - interior_tension;
-	e_2 = epsilon * epsilon;
-	const double e_4 = e_2 * e_2;
-	eps_p2 = e_2;
-	eps_m2 = 1.0 / e_2;
-	one_plus_e2 = 1.0 + e_2;
-	two_plus_ep2 = 2.0 + 2.0 * eps_p2;
-	two_plus_em2 = 2.0 + 2.0 * eps_m2;
-
-	x_edge_const = 4 * one_plus_e2 - 2 * (interior_tension / loose);
-	e_m2 = 1.0 / e_2;
-	y_edge_const = 4 * (1.0 + e_m2) - 2 * (interior_tension * e_m2 / loose);
-
-	const double a0 = 1.0 / ((6 * e_4 * loose + 10 * e_2 * loose + 8 * loose - 2 * one_plus_e2) + 4 * interior_tension * one_plus_e2);
-	a0_const_1 = 2 * loose * (1.0 + e_4);
-	a0_const_2 = 2.0 - interior_tension + 2 * loose * e_2;
-
-	coeff[1][4] = coeff[1][7] = -loose;
-	coeff[1][0] = coeff[1][11] = -loose * e_4;
-	coeff[0][4] = coeff[0][7] = -loose * a0;
-	coeff[0][0] = coeff[0][11] = -loose * e_4 * a0;
-	coeff[1][5] = coeff[1][6] = 2 * loose * one_plus_e2;
-	coeff[0][5] = coeff[0][6] = (2 * coeff[1][5] + interior_tension) * a0;
-	coeff[1][2] = coeff[1][9] = coeff[1][5] * e_2;
-	coeff[0][2] = coeff[0][9] = coeff[0][5] * e_2;
-	coeff[1][1] = coeff[1][3] = coeff[1][8] = coeff[1][10] = -2 * loose * e_2;
-	coeff[0][1] = coeff[0][3] = coeff[0][8] = coeff[0][10] = coeff[1][1] * a0;
-
-	e_2 *= 2; /* We will need these in boundary conditions  */
-	e_m2 *= 2;
-
-	ij_sw_corner = 2 * m_rows + 2; /*  Corners of array of actual data  */
-	ij_se_corner = ij_sw_corner + (n_columns - 1) * m_rows;
-	ij_nw_corner = ij_sw_corner + (n_rows - 1);
-	ij_ne_corner = ij_se_corner + (n_rows - 1);
+/* State of a single surface fit */
+struct mb_surface_ctx {
+	int npoints;    /* Number of data points */
+	int n_columns;  /* Number of nodes in x-dir. */
+	int n_rows;     /* Number of nodes in y-dir. (Final grid) */
+	int m_columns;
+	int m_rows;
+	int ij_sw_corner, ij_se_corner, ij_nw_corner, ij_ne_corner;
+	int block_n_columns; /* Number of nodes in x-dir for a given grid factor */
+	int block_n_rows;    /* Number of nodes in y-dir for a given grid factor */
+	int max_iterations;  /* Max iter per call to iterate */
+	int total_iterations;
+	int grid, old_grid; /* Node spacings  */
+	int grid_east;
+	int n_fact;      /* Number of factors in common (n_rows-1, n_columns-1) */
+	int factors[32]; /* Array of common factors */
+	int local_verbose;
+	int local_error;
+	int status;
+	int nthreads;                                    /* Threads relaxing the grid, 0 for the serial sweep */
+	int set_low;                                     /* 0 unconstrained,1 = by min data value, 2 = by user value */
+	int set_high;                                    /* 0 unconstrained,1 = by max data value, 2 = by user value */
+	int constrained;                                 /* TRUE if set_low or set_high is TRUE */
+	double low_limit, high_limit;                    /* Constrains on range of solution */
+	double xmin, xmax, ymin, ymax;                   /* minmax coordinates */
+	float *lower, *upper;                            /* arrays for minmax values, if set */
+	double xinc, yinc;                               /* Size of each grid cell (final size) */
+	double grid_xinc, grid_yinc;                     /* size of each grid cell for a given grid factor */
+	double r_xinc, r_yinc, r_grid_xinc, r_grid_yinc; /* Reciprocals  */
+	double converge_limit;                           /* Convergence limit */
+	double radius;                                   /* Search radius for initializing grid  */
+	double tension;                                  /* Tension parameter on the surface  */
+	double boundary_tension;
+	double interior_tension;
+	double a0_const_1, a0_const_2; /* Constants for off grid point equation  */
+	double e_2, e_m2, one_plus_e2;
+	double eps_p2, eps_m2, two_plus_ep2, two_plus_em2;
+	double x_edge_const, y_edge_const;
+	double epsilon;
+	double z_mean;
+	double z_scale;                      /* Root mean square range of z after removing planar trend  */
+	double r_z_scale;                    /* reciprocal of z_scale  */
+	double plane_c0, plane_c1, plane_c2; /* Coefficients of best fitting plane to data  */
+	double smalldistance;                /* Let data point coincide with node if distance < smalldistance */
+	float *u;                            /* Pointer to grid array */
+	char *iu;                            /* Pointer to grid info array */
+	char mode_type[2];                   /* D means include data points when iterating
+	                                      * I means just interpolate from larger grid */
+
+	int offset[25][12];  /* Indices of 12 nearby points in 25 cases of edge conditions  */
+	double coeff[2][12]; /* Coefficients for 12 nearby points, constrained and unconstrained  */
+
+	double relax_old, relax_new; /* Coefficients for relaxation factor to speed up convergence */
+
+	struct MB_SURFACE_DATA *data;     /* Data point and index to node it currently constrains  */
+	struct MB_SURFACE_BRIGGS *briggs; /* Coefficients in Taylor series for Laplacian(z) a la I. C. Briggs (1974)  */
+};
+
+static void set_coefficients(struct mb_surface_ctx *ctx) {
+	const double loose = 1.0 - ctx->interior_tension;
+	ctx->e_2 = ctx->epsilon * ctx->epsilon;
+	const double e_4 = ctx->e_2 * ctx->e_2;
+	ctx->eps_p2 = ctx->e_2;
+	ctx->eps_m2 = 1.0 / ctx->e_2;
+	ctx->one_plus_e2 = 1.0 + ctx->e_2;
+	ctx->two_plus_ep2 = 2.0 + 2.0 * ctx->eps_p2;
+	ctx->two_plus_em2 = 2.0 + 2.0 * ctx->eps_m2;
+
+	ctx->x_edge_const = 4 * ctx->one_plus_e2 - 2 * (ctx->interior_tension / loose);
+	ctx->e_m2 = 1.0 / ctx->e_2;
+	ctx->y_edge_const = 4 * (1.0 + ctx->e_m2) - 2 * (ctx->interior_tension * ctx->e_m2 / loose);
+
+	const double a0 = 1.0 / ((6 * e_4 * loose + 10 * ctx->e_2 * loose + 8 * loose - 2 * ctx->one_plus_e2) + 4 * ctx->interior_tension * ctx->one_plus_e2);
+	ctx->a0_const_1 = 2 * loose * (1.0 + e_4);
+	ctx->a0_const_2 = 2.0 - ctx->interior_tension + 2 * loose * ctx->e_2;
+
+	ctx->coeff[1][4] = ctx->coeff[1][7] = -loose;
+	ctx->coeff[1][0] = ctx->coeff[1][11] = -loose * e_4;
+	ctx->coeff[0][4] = ctx->coeff[0][7] = -loose * a0;
+	ctx->coeff[0][0] = ctx->coeff[0][11] = -loose * e_4 * a0;
+	ctx->coeff[1][5] = ctx->coeff[1][6] = 2 * loose * ctx->one_plus_e2;
+	ctx->coeff[0][5] = ctx->coeff[0][6] = (2 * ctx->coeff[1][5] + ctx->interior_tension) * a0;
+	ctx->coeff[1][2] = ctx->coeff[1][9] = ctx->coeff[1][5] * ctx->e_2;
+	ctx->coeff[0][2] = ctx->coeff[0][9] = ctx->coeff[0][5] * ctx->e_2;
+	ctx->coeff[1][1] = ctx->coeff[1][3] = ctx->coeff[1][8] = ctx->coeff[1][10] = -2 * loose * ctx->e_2;
+	ctx->coeff[0][1] = ctx->coeff[0][3] = ctx->coeff[0][8] = ctx->coeff[0][10] = ctx->coeff[1][1] * a0;
+
+	ctx->e_2 *= 2; /* We will need these in boundary conditions  */
+	ctx->e_m2 *= 2;
+
+	ctx->ij_sw_corner = 2 * ctx->m_rows + 2; /*  Corners of array of actual data  */
+	ctx->ij_se_corner = ctx->ij_sw_corner + (ctx->n_columns - 1) * ctx->m_rows;
+	ctx->ij_nw_corner = ctx->ij_sw_corner + (ctx->n_rows - 1);
+	ctx->ij_ne_corner = ctx->ij_se_corner + (ctx->n_rows - 1);
 }
 
-void set_offset() {
+static void set_offset(struct mb_surface_ctx *ctx) {
 	/* Make these const. */
 	int add_w[5];
-	add_w[0] = -m_rows;
-	add_w[1] = add_w[2] = add_w[3] = add_w[4] = -grid_east;
+	add_w[0] = -ctx->m_rows;
+	add_w[1] = add_w[2] = add_w[3] = add_w[4] = -ctx->grid_east;
 	int add_w2[5];
-	add_w2[0] = -2 * m_rows;
-	add_w2[1] = -m_rows - grid_east;
-	add_w2[2] = add_w2[3] = add_w2[4] = -2 * grid_east;
+	add_w2[0] = -2 * ctx->m_rows;
+	add_w2[1] = -ctx->m_rows - ctx->grid_east;
+	add_w2[2] = add_w2[3] = add_w2[4] = -2 * ctx->grid_east;
 	int add_e[5];
-	add_e[4] = m_rows;
-	add_e[0] = add_e[1] = add_e[2] = add_e[3] = grid_east;
+	add_e[4] = ctx->m_rows;
+	add_e[0] = add_e[1] = add_e[2] = add_e[3] = ctx->grid_east;
 	int add_e2[5];
-	add_e2[4] = 2 * m_rows;
-	add_e2[3] = m_rows + grid_east;
-	add_e2[2] = add_e2[1] = add_e2[0] = 2 * grid_east;
+	add_e2[4] = 2 * ctx->m_rows;
+	add_e2[3] = ctx->m_rows + ctx->grid_east;
+	add_e2[2] = add_e2[1] = add_e2[0] = 2 * ctx->grid_east;
 
 	int add_n[5];
 	add_n[4] = 1;
-	add_n[3] = add_n[2] = add_n[1] = add_n[0] = grid;
+	add_n[3] = add_n[2] = add_n[1] = add_n[0] = ctx->grid;
 	int add_n2[5];
 	add_n2[4] = 2;
-	add_n2[3] = grid + 1;
-	add_n2[2] = add_n2[1] = add_n2[0] = 2 * grid;
+	add_n2[3] = ctx->grid + 1;
+	add_n2[2] = add_n2[1] = add_n2[0] = 2 * ctx->grid;
 	int add_s[5];
 	add_s[0] = -1;
-	add_s[1] = add_s[2] = add_s[3] = add_s[4] = -grid;
+	add_s[1] = add_s[2] = add_s[3] = add_s[4] = -ctx->grid;
 	int add_s2[5];
 	add_s2[0] = -2;
-	add_s2[1] = -grid - 1;
-	add_s2[2] = add_s2[3] = add_s2[4] = -2 * grid;
+	add_s2[1] = -ctx->grid - 1;
+	add_s2[2] = add_s2[3] = add_s2[4] = -2 * ctx->grid;
 
 	for (int i = 0, kase = 0; i < 5; i++) {
 		for (int j = 0; j < 5; j++, kase++) {
-			offset[kase][0] = add_n2[j];
-			offset[kase][1] = add_n[j] + add_w[i];
-			offset[kase][2] = add_n[j];
-			offset[kase][3] = add_n[j] + add_e[i];
-			offset[kase][4] = add_w2[i];
-			offset[kase][5] = add_w[i];
-			offset[kase][6] = add_e[i];
-			offset[kase][7] = add_e2[i];
-			offset[kase][8] = add_s[j] + add_w[i];
-			offset[kase][9] = add_s[j];
-			offset[kase][10] = add_s[j] + add_e[i];
-			offset[kase][11] = add_s2[j];
+			ctx->offset[kase][0] = add_n2[j];
+			ctx->offset[kase][1] = add_n[j] + add_w[i];
+			ctx->offset[kase][2] = add_n[j];
+			ctx->offset[kase][3] = add_n[j] + add_e[i];
+			ctx->offset[kase][4] = add_w2[i];
+			ctx->offset[kase][5] = add_w[i];
+			ctx->offset[kase][6] = add_e[i];
+			ctx->offset[kase][7] = add_e2[i];
+			ctx->offset[kase][8] = add_s[j] + add_w[i];
+			ctx->offset[kase][9] = add_s[j];
+			ctx->offset[kase][10] = add_s[j] + add_e[i];
+			ctx->offset[kase][11] = add_s2[j];
 		}
 	}
 }
 
-void fill_in_forecast() {
+static void fill_in_forecast(struct mb_surface_ctx *ctx) {
 	// Fills in bilinear estimates into new node locations
 	// after grid is divided.
 
-	const double old_size = 1.0 / (double)old_grid;
+	const double old_size = 1.0 / (double)ctx->old_grid;
 
 	/* first do from southwest corner */
-	for (int i = 0; i < n_columns - 1; i += old_grid) {
-		for (int j = 0; j < n_rows - 1; j += old_grid) {
+	for (int i = 0; i < ctx->n_columns - 1; i += ctx->old_grid) {
+		for (int j = 0; j < ctx->n_rows - 1; j += ctx->old_grid) {
 
 			/* get indices of bilinear square */
-			const int index_0 = ij_sw_corner + i * m_rows + j;
-			const int index_1 = index_0 + old_grid * m_rows;
-			const int index_2 = index_1 + old_grid;
-			const int index_3 = index_0 + old_grid;
+			const int index_0 = ctx->ij_sw_corner + i * ctx->m_rows + j;
+			const int index_1 = index_0 + ctx->old_grid * ctx->m_rows;
+			const int index_2 = index_1 + ctx->old_grid;
+			const int index_3 = index_0 + ctx->old_grid;
 
 			/* get coefficients */
-			const double a0 = u[index_0];
-			const double a1 = u[index_1] - a0;
-			const double a2 = u[index_3] - a0;
-			const double a3 = u[index_2] - a0 - a1 - a2;
+			const double a0 = ctx->u[index_0];
+			const double a1 = ctx->u[index_1] - a0;
+			const double a2 = ctx->u[index_3] - a0;
+			const double a3 = ctx->u[index_2] - a0 - a1 - a2;
 
 			/* find all possible new fill ins */
 
-			for (int ii = i; ii < i + old_grid; ii += grid) {
+			for (int ii = i; ii < i + ctx->old_grid; ii += ctx->grid) {
 				const double delta_x = (ii - i) * old_size;
-				for (int jj = j; jj < j + old_grid; jj += grid) {
-					const int index_new = ij_sw_corner + ii * m_rows + jj;
+				for (int jj = j; jj < j + ctx->old_grid; jj += ctx->grid) {
+					const int index_new = ctx->ij_sw_corner + ii * ctx->m_rows + jj;
 					if (index_new == index_0)
 						continue;
 					const double delta_y = (jj - j) * old_size;
-					u[index_new] = a0 + a1 * delta_x + delta_y * (a2 + a3 * delta_x);
-					iu[index_new] = 0;
+					ctx->u[index_new] = a0 + a1 * delta_x + delta_y * (a2 + a3 * delta_x);
+					ctx->iu[index_new] = 0;
 				}
 			}
-			iu[index_0] = 5;
+			ctx->iu[index_0] = 5;
 		}
 	}
 
 	/* now do linear guess along east edge */
 
-	for (int j = 0; j < (n_rows - 1); j += old_grid) {
-		const int index_0 = ij_se_corner + j;
-		const int index_3 = index_0 + old_grid;
-		for (int jj = j; jj < j + old_grid; jj += grid) {
-			const int index_new = ij_se_corner + jj;
+	for (int j = 0; j < (ctx->n_rows - 1); j += ctx->old_grid) {
+		const int index_0 = ctx->ij_se_corner + j;
+		const int index_3 = index_0 + ctx->old_grid;
+		for (int jj = j; jj < j + ctx->old_grid; jj += ctx->grid) {
+			const int index_new = ctx->ij_se_corner + jj;
 			const double delta_y = (jj - j) * old_size;
-			u[index_new] = u[index_0] + delta_y * (u[index_3] - u[index_0]);
-			iu[index_new] = 0;
+			ctx->u[index_new] = ctx->u[index_0] + delta_y * (ctx->u[index_3] - ctx->u[index_0]);
+			ctx->iu[index_new] = 0;
 		}
-		iu[index_0] = 5;
+		ctx->iu[index_0] = 5;
 	}
 	/* now do linear guess along north edge */
-	for (int i = 0; i < (n_columns - 1); i += old_grid) {
-		const int index_0 = ij_nw_corner + i * m_rows;
-		const int index_1 = index_0 + old_grid * m_rows;
-		for (int ii = i; ii < i + old_grid; ii += grid) {
-			const int index_new = ij_nw_corner + ii * m_rows;
+	for (int i = 0; i < (ctx->n_columns - 1); i += ctx->old_grid) {
+		const int index_0 = ctx->ij_nw_corner + i * ctx->m_rows;
+		const int index_1 = index_0 + ctx->old_grid * ctx->m_rows;
+		for (int ii = i; ii < i + ctx->old_grid; ii += ctx->grid) {
+			const int index_new = ctx->ij_nw_corner + ii * ctx->m_rows;
 			const double delta_x = (ii - i) * old_size;
-			u[index_new] = u[index_0] + delta_x * (u[index_1] - u[index_0]);
-			iu[index_new] = 0;
+			ctx->u[index_new] = ctx->u[index_0] + delta_x * (ctx->u[index_1] - ctx->u[index_0]);
+			ctx->iu[index_new] = 0;
 		}
-		iu[index_0] = 5;
+		ctx->iu[index_0] = 5;
 	}
 	/* now set northeast corner to fixed and we're done */
-	iu[ij_ne_corner] = 5;
+	ctx->iu[ctx->ij_ne_corner] = 5;
 }
 
-void smart_divide() {
+static void smart_divide(struct mb_surface_ctx *ctx) {
 	/* Divide grid by its largest prime factor */
-	grid /= factors[n_fact - 1];
-	n_fact--;
+	ctx->grid /= ctx->factors[ctx->n_fact - 1];
+	ctx->n_fact--;
 }
 
-int compare_points(struct MB_SURFACE_DATA *point_1, struct MB_SURFACE_DATA *point_2) {
+static void set_distances(struct mb_surface_ctx *ctx) {
+	/* Computes the squared distance from each datum to the node it is indexed to,
+	    so that compare_points() needs no access to the grid parameters. */
+	for (int k = 0; k < ctx->npoints; k++) {
+		if (ctx->data[k].index == OUTSIDE)
+			continue;
+		const int block_i = ctx->data[k].index / ctx->block_n_rows;
+		const int block_j = ctx->data[k].index % ctx->block_n_rows;
+		const double x0 = ctx->xmin + block_i * ctx->grid_xinc;
+		const double y0 = ctx->ymin + block_j * ctx->grid_yinc;
+		ctx->data[k].dist = (ctx->data[k].x - x0) * (ctx->data[k].x - x0) + (ctx->data[k].y - y0) * (ctx->data[k].y - y0);
+	}
+}
+
+static int compare_points(const void *p1, const void *p2) {
 	/*  Routine for qsort to sort data structure for fast access to data by node location.
 	    Sorts on index first, then on radius to node corresponding to index, so that index
 	    goes from low to high, and so does radius.
 	*/
+	const struct MB_SURFACE_DATA *point_1 = (const struct MB_SURFACE_DATA *)p1;
+	const struct MB_SURFACE_DATA *point_2 = (const struct MB_SURFACE_DATA *)p2;
 	const int index_1 = point_1->index;
 	const int index_2 = point_2->index;
 	if (index_1 < index_2)
@@ -318,151 +358,146 @@ int compare_points(struct MB_SURFACE_DATA *point_1, struct MB_SURFACE_DATA *poin
 		return (0);
 
 	/* Points are in same grid cell, find the one who is nearest to grid point */
-	const int block_i = point_1->index / block_n_rows;
-	const int block_j = point_1->index % block_n_rows;
-	const double x0 = xmin + block_i * grid_xinc;
-	const double y0 = ymin + block_j * grid_yinc;
-	const double dist_1 = (point_1->x - x0) * (point_1->x - x0) + (point_1->y - y0) * (point_1->y - y0);
-	const double dist_2 = (point_2->x - x0) * (point_2->x - x0) + (point_2->y - y0) * (point_2->y - y0);
-	if (dist_1 < dist_2)
+	if (point_1->dist < point_2->dist)
 		return (-1);
-	if (dist_1 > dist_2)
+	if (point_1->dist > point_2->dist)
 		return (1);
 	else
 		return (0);
 }
 
-void set_index() {
+static void set_index(struct mb_surface_ctx *ctx) {
 	/* recomputes data[k].index for new value of grid,
 	   sorts data on index and radii, and throws away
 	   data which are now outside the useable limits. */
 	int k_skipped = 0;
 
-	for (int k = 0; k < npoints; k++) {
-		const int i = floor(((data[k].x - xmin) * r_grid_xinc) + 0.5);
-		const int j = floor(((data[k].y - ymin) * r_grid_yinc) + 0.5);
-		if (i < 0 || i >= block_n_columns || j < 0 || j >= block_n_rows) {
-			data[k].index = OUTSIDE;
+	for (int k = 0; k < ctx->npoints; k++) {
+		const int i = floor(((ctx->data[k].x - ctx->xmin) * ctx->r_grid_xinc) + 0.5);
+		const int j = floor(((ctx->data[k].y - ctx->ymin) * ctx->r_grid_yinc) + 0.5);
+		if (i < 0 || i >= ctx->block_n_columns || j < 0 || j >= ctx->block_n_rows) {
+			ctx->data[k].index = OUTSIDE;
 			k_skipped++;
 		}
 		else
-			data[k].index = i * block_n_rows + j;
+			ctx->data[k].index = i * ctx->block_n_rows + j;
 	}
 
-	qsort((char *)data, npoints, sizeof(struct MB_SURFACE_DATA), (void *)compare_points);
+	set_distances(ctx);
+	qsort((char *)ctx->data, ctx->npoints, sizeof(struct MB_SURFACE_DATA), compare_points);
 
-	npoints -= k_skipped;
+	ctx->npoints -= k_skipped;
 }
 
-void find_nearest_point() {
-	smalldistance = 0.05 * ((grid_xinc < grid_yinc) ? grid_xinc : grid_yinc);
+static void find_nearest_point(struct mb_surface_ctx *ctx) {
+	ctx->smalldistance = 0.05 * ((ctx->grid_xinc < ctx->grid_yinc) ? ctx->grid_xinc : ctx->grid_yinc);
 
-	for (int i = 0; i < n_columns; i += grid) /* Reset grid info */
-		for (int j = 0; j < n_rows; j += grid)
-			iu[ij_sw_corner + i * m_rows + j] = 0;
+	for (int i = 0; i < ctx->n_columns; i += ctx->grid) /* Reset grid info */
+		for (int j = 0; j < ctx->n_rows; j += ctx->grid)
+			ctx->iu[ctx->ij_sw_corner + i * ctx->m_rows + j] = 0;
 
 	int last_index = -1;
 	int briggs_index = 0;
-	for (int k = 0; k < npoints; k++) { /* Find constraining value  */
-		if (data[k].index != last_index) {
-			const int block_i = data[k].index / block_n_rows;
-			const int block_j = data[k].index % block_n_rows;
-			last_index = data[k].index;
-			const int iu_index = ij_sw_corner + (block_i * m_rows + block_j) * grid;
-			const double x0 = xmin + block_i * grid_xinc;
-			const double y0 = ymin + block_j * grid_yinc;
-			double dx = (data[k].x - x0) * r_grid_xinc;
-			double dy = (data[k].y - y0) * r_grid_yinc;
-			if (fabs(dx) < smalldistance && fabs(dy) < smalldistance) {
-				iu[iu_index] = 5;
-				u[iu_index] = data[k].z;
+	for (int k = 0; k < ctx->npoints; k++) { /* Find constraining value  */
+		if (ctx->data[k].index != last_index) {
+			const int block_i = ctx->data[k].index / ctx->block_n_rows;
+			const int block_j = ctx->data[k].index % ctx->block_n_rows;
+			last_index = ctx->data[k].index;
+			const int iu_index = ctx->ij_sw_corner + (block_i * ctx->m_rows + block_j) * ctx->grid;
+			const double x0 = ctx->xmin + block_i * ctx->grid_xinc;
+			const double y0 = ctx->ymin + block_j * ctx->grid_yinc;
+			double dx = (ctx->data[k].x - x0) * ctx->r_grid_xinc;
+			double dy = (ctx->data[k].y - y0) * ctx->r_grid_yinc;
+			if (fabs(dx) < ctx->smalldistance && fabs(dy) < ctx->smalldistance) {
+				ctx->iu[iu_index] = 5;
+				ctx->u[iu_index] = ctx->data[k].z;
 			}
 			else {
 				if (dx >= 0.0) {
 					if (dy >= 0.0)
-						iu[iu_index] = 1;
+						ctx->iu[iu_index] = 1;
 					else
-						iu[iu_index] = 4;
+						ctx->iu[iu_index] = 4;
 				}
 				else {
 					if (dy >= 0.0)
-						iu[iu_index] = 2;
+						ctx->iu[iu_index] = 2;
 					else
-						iu[iu_index] = 3;
+						ctx->iu[iu_index] = 3;
 				}
 				dx = fabs(dx);
 				dy = fabs(dy);
-				const double btemp = 2 * one_plus_e2 / ((dx + dy) * (1.0 + dx + dy));
+				const double btemp = 2 * ctx->one_plus_e2 / ((dx + dy) * (1.0 + dx + dy));
 				const double b0 = 1.0 - 0.5 * (dx + (dx * dx)) * btemp;
-				const double b3 = 0.5 * (e_2 - (dy + (dy * dy)) * btemp);
+				const double b3 = 0.5 * (ctx->e_2 - (dy + (dy * dy)) * btemp);
 				const double xys = 1.0 + dx + dy;
 				const double xy1 = 1.0 / xys;
-				const double b1 = (e_2 * xys - 4 * dy) * xy1;
+				const double b1 = (ctx->e_2 * xys - 4 * dy) * xy1;
 				const double b2 = 2 * (dy - dx + 1.0) * xy1;
 				const double b4 = b0 + b1 + b2 + b3 + btemp;
-				const double b5 = btemp * data[k].z;
-				briggs[briggs_index].b[0] = b0;
-				briggs[briggs_index].b[1] = b1;
-				briggs[briggs_index].b[2] = b2;
-				briggs[briggs_index].b[3] = b3;
-				briggs[briggs_index].b[4] = b4;
-				briggs[briggs_index].b[5] = b5;
+				const double b5 = btemp * ctx->data[k].z;
+				ctx->briggs[briggs_index].b[0] = b0;
+				ctx->briggs[briggs_index].b[1] = b1;
+				ctx->briggs[briggs_index].b[2] = b2;
+				ctx->briggs[briggs_index].b[3] = b3;
+				ctx->briggs[briggs_index].b[4] = b4;
+				ctx->briggs[briggs_index].b[5] = b5;
 				briggs_index++;
 			}
 		}
 	}
 }
 
-void set_grid_parameters() {
-	block_n_rows = (n_rows - 1) / grid + 1;
-	block_n_columns = (n_columns - 1) / grid + 1;
-	grid_xinc = grid * xinc;
-	grid_yinc = grid * yinc;
-	grid_east = grid * m_rows;
-	r_grid_xinc = 1.0 / grid_xinc;
-	r_grid_yinc = 1.0 / grid_yinc;
+static void set_grid_parameters(struct mb_surface_ctx *ctx) {
+	ctx->block_n_rows = (ctx->n_rows - 1) / ctx->grid + 1;
+	ctx->block_n_columns = (ctx->n_columns - 1) / ctx->grid + 1;
+	ctx->grid_xinc = ctx->grid * ctx->xinc;
+	ctx->grid_yinc = ctx->grid * ctx->yinc;
+	ctx->grid_east = ctx->grid * ctx->m_rows;
+	ctx->r_grid_xinc = 1.0 / ctx->grid_xinc;
+	ctx->r_grid_yinc = 1.0 / ctx->grid_yinc;
 }
 
-void initialize_grid() {
+static void initialize_grid(struct mb_surface_ctx *ctx) {
 	// For the initial gridsize, compute weighted averages of data inside the search radius
 	// and assign the values to u[i,j] where i,j are multiples of gridsize.
-	const int irad = ceil(radius / grid_xinc);
-	const int jrad = ceil(radius / grid_yinc);
-	const double rfact = -4.5 / (radius * radius);
-
-	for (int i = 0; i < block_n_columns; i++) {
-		const double x0 = xmin + i * grid_xinc;
-		for (int j = 0; j < block_n_rows; j++) {
-			const double y0 = ymin + j * grid_yinc;
+	const int irad = ceil(ctx->radius / ctx->grid_xinc);
+	const int jrad = ceil(ctx->radius / ctx->grid_yinc);
+	const double rfact = -4.5 / (ctx->radius * ctx->radius);
+
+	for (int i = 0; i < ctx->block_n_columns; i++) {
+		const double x0 = ctx->xmin + i * ctx->grid_xinc;
+		for (int j = 0; j < ctx->block_n_rows; j++) {
+			const double y0 = ctx->ymin + j * ctx->grid_yinc;
 			int imin = i - irad;
 			if (imin < 0)
 				imin = 0;
 			int imax = i + irad;
-			if (imax >= block_n_columns)
-				imax = block_n_columns - 1;
+			if (imax >= ctx->block_n_columns)
+				imax = ctx->block_n_columns - 1;
 			int jmin = j - jrad;
 			if (jmin < 0)
 				jmin = 0;
 			int jmax = j + jrad;
-			if (jmax >= block_n_rows)
-				jmax = block_n_rows - 1;
-			const int index_1 = imin * block_n_rows + jmin;
-			const int index_2 = imax * block_n_rows + jmax + 1;
+			if (jmax >= ctx->block_n_rows)
+				jmax = ctx->block_n_rows - 1;
+			const int index_1 = imin * ctx->block_n_rows + jmin;
+			const int index_2 = imax * ctx->block_n_rows + jmax + 1;
 			double sum_w = 0.0;
                         double sum_zw = 0.0;
 			int k = 0;
-			while (k < npoints && data[k].index < index_1)
+			while (k < ctx->npoints && ctx->data[k].index < index_1)
 				k++;
-			for (int ki = imin; k < npoints && ki <= imax && data[k].index < index_2; ki++) {
-				for (int kj = jmin; k < npoints && kj <= jmax && data[k].index < index_2; kj++) {
-					const int k_index = ki * block_n_rows + kj;
-					while (k < npoints && data[k].index < k_index)
+			for (int ki = imin; k < ctx->npoints && ki <= imax && ctx->data[k].index < index_2; ki++) {
+				for (int kj = jmin; k < ctx->npoints && kj <= jmax && ctx->data[k].index < index_2; kj++) {
+					const int k_index = ki * ctx->block_n_rows + kj;
+					while (k < ctx->npoints && ctx->data[k].index < k_index)
 						k++;
-					while (k < npoints && data[k].index == k_index) {
-						const double r = (data[k].x - x0) * (data[k].x - x0) + (data[k].y - y0) * (data[k].y - y0);
+					while (k < ctx->npoints && ctx->data[k].index == k_index) {
+						const double r = (ctx->data[k].x - x0) * (ctx->data[k].x - x0) + (ctx->data[k].y - y0) * (ctx->data[k].y - y0);
 						const double weight = exp(rfact * r);
 						sum_w += weight;
-						sum_zw += weight * data[k].z;
+						sum_zw += weight * ctx->data[k].z;
 						k++;
 					}
 				}
@@ -471,35 +506,38 @@ void initialize_grid() {
 				/*
 				fprintf (stderr, "surface: Warning: no data inside search radius at: %.8lg %.8lg\n", x0, y0);
 				*/
-				u[ij_sw_corner + (i * m_rows + j) * grid] = z_mean;
+				ctx->u[ctx->ij_sw_corner + (i * ctx->m_rows + j) * ctx->grid] = ctx->z_mean;
 			}
 			else {
-				u[ij_sw_corner + (i * m_rows + j) * grid] = sum_zw / sum_w;
+				ctx->u[ctx->ij_sw_corner + (i * ctx->m_rows + j) * ctx->grid] = sum_zw / sum_w;
 			}
 		}
 	}
 }
 
 /* This function rewritten by D.W. Caress 5/3/94 */
-void read_data(int ndat, float *xdat, float *ydat, float *zdat) {
+static void read_data(struct mb_surface_ctx *ctx, int ndat, float *xdat, float *ydat, float *zdat) {
 	int kmax = 0;
 	int kmin = 0;
 	double zmin = 1.0e38;
 	double zmax = -1.0e38;
 
-	status = mb_mallocd(local_verbose, __FILE__, __LINE__, ndat * sizeof(struct MB_SURFACE_DATA), (void **)&data, &local_error);
+	ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, MAX(ndat, 1) * sizeof(struct MB_SURFACE_DATA),
+	                         (void **)&ctx->data, &ctx->local_error);
+	if (ctx->status != MB_SUCCESS)
+		return;
 
 	/* Read in xyz data and computes index no and store it in a structure */
 	int k = 0;
-	z_mean = 0;
+	ctx->z_mean = 0;
 	for (int idat = 0; idat < ndat; idat++) {
-		const int i = floor(((xdat[idat] - xmin) * r_grid_xinc) + 0.5);
-		const int j = floor(((ydat[idat] - ymin) * r_grid_yinc) + 0.5);
-		if (i >= 0 && i < block_n_columns && j >= 0 && j < block_n_rows) {
-			data[k].index = i * block_n_rows + j;
-			data[k].x = xdat[idat];
-			data[k].y = ydat[idat];
-			data[k].z = zdat[idat];
+		const int i = floor(((xdat[idat] - ctx->xmin) * ctx->r_grid_xinc) + 0.5);
+		const int j = floor(((ydat[idat] - ctx->ymin) * ctx->r_grid_yinc) + 0.5);
+		if (i >= 0 && i < ctx->block_n_columns && j >= 0 && j < ctx->block_n_rows) {
+			ctx->data[k].index = i * ctx->block_n_rows + j;
+			ctx->data[k].x = xdat[idat];
+			ctx->data[k].y = ydat[idat];
+			ctx->data[k].z = zdat[idat];
 			if (zmin > zdat[idat]) {
 				zmin = zdat[idat];
 				kmin = k;
@@ -509,14 +547,14 @@ void read_data(int ndat, float *xdat, float *ydat, float *zdat) {
 				kmax = k;
 			}
 			k++;
-			z_mean += zdat[idat];
+			ctx->z_mean += zdat[idat];
 		}
 	}
 
-	npoints = k;
-	z_mean /= k;
-	if (converge_limit == 0.0) {
-		converge_limit = 0.001 * z_scale; /* c_l = 1 ppt of L2 scale */
+	ctx->npoints = k;
+	ctx->z_mean /= k;
+	if (ctx->converge_limit == 0.0) {
+		ctx->converge_limit = 0.001 * ctx->z_scale; /* c_l = 1 ppt of L2 scale */
 	}
 	/*
 	if (local_verbose) {
@@ -527,17 +565,17 @@ void read_data(int ndat, float *xdat, float *ydat, float *zdat) {
 	}
 	*/
 
-	if (set_low == 1)
-		low_limit = data[kmin].z;
-	else if (set_low == 2 && low_limit > data[kmin].z) {
+	if (ctx->set_low == 1)
+		ctx->low_limit = ctx->data[kmin].z;
+	else if (ctx->set_low == 2 && ctx->low_limit > ctx->data[kmin].z) {
 		/*	low_limit = data[kmin].z;	*/
 		/*
 		fprintf (stderr, "surface: Warning:  Your lower value is > than min data value.\n");
 		*/
 	}
-	if (set_high == 1)
-		high_limit = data[kmax].z;
-	else if (set_high == 2 && high_limit < data[kmax].z) {
+	if (ctx->set_high == 1)
+		ctx->high_limit = ctx->data[kmax].z;
+	else if (ctx->set_high == 2 && ctx->high_limit < ctx->data[kmax].z) {
 		/*	high_limit = data[kmax].z;	*/
 		/*
 		fprintf (stderr, "surface: Warning:  Your upper value is < than max data value.\n");
@@ -546,112 +584,218 @@ void read_data(int ndat, float *xdat, float *ydat, float *zdat) {
 }
 
 /* this function rewritten from write_output() by D.W. Caress 5/3/94 */
-void get_output(float *sgrid) {
-        int index = ij_sw_corner;
-	for (int i = 0; i < n_columns; i++, index += m_rows)
-		for (int j = 0; j < n_rows; j++) {
-			sgrid[j * n_columns + i] = u[index + n_rows - j - 1];
+static void get_output(struct mb_surface_ctx *ctx, float *sgrid) {
+        int index = ctx->ij_sw_corner;
+	for (int i = 0; i < ctx->n_columns; i++, index += ctx->m_rows)
+		for (int j = 0; j < ctx->n_rows; j++) {
+			sgrid[j * ctx->n_columns + i] = ctx->u[index + ctx->n_rows - j - 1];
 		}
 }
 
-int iterate(int mode) {
-	int k, kase, ij_v2;
+static void set_boundaries(struct mb_surface_ctx *ctx) {
+	const double x_0_const = 4.0 * (1.0 - ctx->boundary_tension) / (2.0 - ctx->boundary_tension);
+	const double x_1_const = (3 * ctx->boundary_tension - 2.0) / (2.0 - ctx->boundary_tension);
+	const double y_denom = 2 * ctx->epsilon * (1.0 - ctx->boundary_tension) + ctx->boundary_tension;
+	const double y_0_const = 4 * ctx->epsilon * (1.0 - ctx->boundary_tension) / y_denom;
+	const double y_1_const = (ctx->boundary_tension - 2 * ctx->epsilon * (1.0 - ctx->boundary_tension)) / y_denom;
+	int kase;
 	int x_case, y_case, x_w_case, x_e_case, y_s_case, y_n_case;
-	int iteration_count = 0;
 
-	double current_limit = converge_limit / grid;
-	double change;
-	double max_change = 0.0;
-	double busum, sum_ij;
-	double b0, b1, b2, b3, b4, b5;
-
-	const double x_0_const = 4.0 * (1.0 - boundary_tension) / (2.0 - boundary_tension);
-	const double x_1_const = (3 * boundary_tension - 2.0) / (2.0 - boundary_tension);
-	const double y_denom = 2 * epsilon * (1.0 - boundary_tension) + boundary_tension;
-	const double y_0_const = 4 * epsilon * (1.0 - boundary_tension) / y_denom;
-	const double y_1_const = (boundary_tension - 2 * epsilon * (1.0 - boundary_tension)) / y_denom;
-
-	do {
-		int briggs_index = 0; /* Reset the constraint table stack pointer  */
-
-		max_change = -1.0;
-
-		/* Fill in auxiliary boundary values (in new way) */
-
-		/* First set d2[]/dn2 = 0 along edges:  */
-		/* New experiment : (1-T)d2[]/dn2 + Td[]/dn = 0  */
-
-		for (int i = 0; i < n_columns; i += grid) {
-			/* set d2[]/dy2 = 0 on south side:  */
-			int ij = ij_sw_corner + i * m_rows;
-			/* u[ij - 1] = 2 * u[ij] - u[ij + grid];  */
-			u[ij - 1] = y_0_const * u[ij] + y_1_const * u[ij + grid];
-			/* set d2[]/dy2 = 0 on north side:  */
-			ij = ij_nw_corner + i * m_rows;
-			/* u[ij + 1] = 2 * u[ij] - u[ij - grid];  */
-			u[ij + 1] = y_0_const * u[ij] + y_1_const * u[ij - grid];
-		}
+	/* Fill in auxiliary boundary values (in new way) */
 
-		for (int j = 0; j < n_rows; j += grid) {
-			/* set d2[]/dx2 = 0 on west side:  */
-			int ij = ij_sw_corner + j;
-			/* u[ij - m_rows] = 2 * u[ij] - u[ij + grid_east];  */
-			u[ij - m_rows] = x_1_const * u[ij + grid_east] + x_0_const * u[ij];
-			/* set d2[]/dx2 = 0 on east side:  */
-			ij = ij_se_corner + j;
-			/* u[ij + m_rows] = 2 * u[ij] - u[ij - grid_east];  */
-			u[ij + m_rows] = x_1_const * u[ij - grid_east] + x_0_const * u[ij];
-		}
+	/* First set d2[]/dn2 = 0 along edges:  */
+	/* New experiment : (1-T)d2[]/dn2 + Td[]/dn = 0  */
 
-		/* Now set d2[]/dxdy = 0 at each corner:  */
-		int ij = ij_sw_corner;
-		u[ij - m_rows - 1] = u[ij + grid_east - 1] + u[ij - m_rows + grid] - u[ij + grid_east + grid];
+	for (int i = 0; i < ctx->n_columns; i += ctx->grid) {
+		/* set d2[]/dy2 = 0 on south side:  */
+		int ij = ctx->ij_sw_corner + i * ctx->m_rows;
+		/* u[ij - 1] = 2 * u[ij] - u[ij + grid];  */
+		ctx->u[ij - 1] = y_0_const * ctx->u[ij] + y_1_const * ctx->u[ij + ctx->grid];
+		/* set d2[]/dy2 = 0 on north side:  */
+		ij = ctx->ij_nw_corner + i * ctx->m_rows;
+		/* u[ij + 1] = 2 * u[ij] - u[ij - grid];  */
+		ctx->u[ij + 1] = y_0_const * ctx->u[ij] + y_1_const * ctx->u[ij - ctx->grid];
+	}
 
-		ij = ij_nw_corner;
-		u[ij - m_rows + 1] = u[ij + grid_east + 1] + u[ij - m_rows - grid] - u[ij + grid_east - grid];
+	for (int j = 0; j < ctx->n_rows; j += ctx->grid) {
+		/* set d2[]/dx2 = 0 on west side:  */
+		int ij = ctx->ij_sw_corner + j;
+		/* u[ij - m_rows] = 2 * u[ij] - u[ij + grid_east];  */
+		ctx->u[ij - ctx->m_rows] = x_1_const * ctx->u[ij + ctx->grid_east] + x_0_const * ctx->u[ij];
+		/* set d2[]/dx2 = 0 on east side:  */
+		ij = ctx->ij_se_corner + j;
+		/* u[ij + m_rows] = 2 * u[ij] - u[ij - grid_east];  */
+		ctx->u[ij + ctx->m_rows] = x_1_const * ctx->u[ij - ctx->grid_east] + x_0_const * ctx->u[ij];
+	}
 
-		ij = ij_se_corner;
-		u[ij + m_rows - 1] = u[ij - grid_east - 1] + u[ij + m_rows + grid] - u[ij - grid_east + grid];
+	/* Now set d2[]/dxdy = 0 at each corner:  */
+	int ij = ctx->ij_sw_corner;
+	ctx->u[ij - ctx->m_rows - 1] = ctx->u[ij + ctx->grid_east - 1] + ctx->u[ij - ctx->m_rows + ctx->grid] - ctx->u[ij + ctx->grid_east + ctx->grid];
 
-		ij = ij_ne_corner;
-		u[ij + m_rows + 1] = u[ij - grid_east + 1] + u[ij + m_rows - grid] - u[ij - grid_east - grid];
+	ij = ctx->ij_nw_corner;
+	ctx->u[ij - ctx->m_rows + 1] = ctx->u[ij + ctx->grid_east + 1] + ctx->u[ij - ctx->m_rows - ctx->grid] - ctx->u[ij + ctx->grid_east - ctx->grid];
 
-		/* Now set (1-T)dC/dn + Tdu/dn = 0 at each edge :  */
-		/* New experiment:  only dC/dn = 0  */
+	ij = ctx->ij_se_corner;
+	ctx->u[ij + ctx->m_rows - 1] = ctx->u[ij - ctx->grid_east - 1] + ctx->u[ij + ctx->m_rows + ctx->grid] - ctx->u[ij - ctx->grid_east + ctx->grid];
 
-		x_w_case = 0;
-		x_e_case = block_n_columns - 1;
-		for (int i = 0; i < n_columns; i += grid, x_w_case++, x_e_case--) {
+	ij = ctx->ij_ne_corner;
+	ctx->u[ij + ctx->m_rows + 1] = ctx->u[ij - ctx->grid_east + 1] + ctx->u[ij + ctx->m_rows - ctx->grid] - ctx->u[ij - ctx->grid_east - ctx->grid];
 
-			if (x_w_case < 2)
-				x_case = x_w_case;
-			else if (x_e_case < 2)
-				x_case = 4 - x_e_case;
-			else
-				x_case = 2;
-
-			/* South side :  */
-			kase = x_case * 5;
-			ij = ij_sw_corner + i * m_rows;
-			u[ij + offset[kase][11]] = (u[ij + offset[kase][0]] +
-			                            eps_m2 * (u[ij + offset[kase][1]] + u[ij + offset[kase][3]] - u[ij + offset[kase][8]] -
-			                                      u[ij + offset[kase][10]]) +
-			                            two_plus_em2 * (u[ij + offset[kase][9]] - u[ij + offset[kase][2]]));
-			/*  + tense * eps_m2 * (u[ij + offset[kase][2]] - u[ij + offset[kase][9]]) / (1.0 - tense);  */
-			/* North side :  */
-			kase = x_case * 5 + 4;
-			ij = ij_nw_corner + i * m_rows;
-			u[ij + offset[kase][0]] = -(-u[ij + offset[kase][11]] +
-			                            eps_m2 * (u[ij + offset[kase][1]] + u[ij + offset[kase][3]] - u[ij + offset[kase][8]] -
-			                                      u[ij + offset[kase][10]]) +
-			                            two_plus_em2 * (u[ij + offset[kase][9]] - u[ij + offset[kase][2]]));
-			/*  - tense * eps_m2 * (u[ij + offset[kase][2]] - u[ij + offset[kase][9]]) / (1.0 - tense);  */
+	/* Now set (1-T)dC/dn + Tdu/dn = 0 at each edge :  */
+	/* New experiment:  only dC/dn = 0  */
+
+	x_w_case = 0;
+	x_e_case = ctx->block_n_columns - 1;
+	for (int i = 0; i < ctx->n_columns; i += ctx->grid, x_w_case++, x_e_case--) {
+
+		if (x_w_case < 2)
+			x_case = x_w_case;
+		else if (x_e_case < 2)
+			x_case = 4 - x_e_case;
+		else
+			x_case = 2;
+
+		/* South side :  */
+		kase = x_case * 5;
+		ij = ctx->ij_sw_corner + i * ctx->m_rows;
+		ctx->u[ij + ctx->offset[kase][11]] = (ctx->u[ij + ctx->offset[kase][0]] +
+		                            ctx->eps_m2 * (ctx->u[ij + ctx->offset[kase][1]] + ctx->u[ij + ctx->offset[kase][3]] - ctx->u[ij + ctx->offset[kase][8]] -
+		                                      ctx->u[ij + ctx->offset[kase][10]]) +
+		                            ctx->two_plus_em2 * (ctx->u[ij + ctx->offset[kase][9]] - ctx->u[ij + ctx->offset[kase][2]]));
+		/*  + tense * eps_m2 * (u[ij + offset[kase][2]] - u[ij + offset[kase][9]]) / (1.0 - tense);  */
+		/* North side :  */
+		kase = x_case * 5 + 4;
+		ij = ctx->ij_nw_corner + i * ctx->m_rows;
+		ctx->u[ij + ctx->offset[kase][0]] = -(-ctx->u[ij + ctx->offset[kase][11]] +
+		                            ctx->eps_m2 * (ctx->u[ij + ctx->offset[kase][1]] + ctx->u[ij + ctx->offset[kase][3]] - ctx->u[ij + ctx->offset[kase][8]] -
+		                                      ctx->u[ij + ctx->offset[kase][10]]) +
+		                            ctx->two_plus_em2 * (ctx->u[ij + ctx->offset[kase][9]] - ctx->u[ij + ctx->offset[kase][2]]));
+		/*  - tense * eps_m2 * (u[ij + offset[kase][2]] - u[ij + offset[kase][9]]) / (1.0 - tense);  */
+	}
+
+	y_s_case = 0;
+	y_n_case = ctx->block_n_rows - 1;
+	for (int j = 0; j < ctx->n_rows; j += ctx->grid, y_s_case++, y_n_case--) {
+
+		if (y_s_case < 2)
+			y_case = y_s_case;
+		else if (y_n_case < 2)
+			y_case = 4 - y_n_case;
+		else
+			y_case = 2;
+
+		/* West side :  */
+		kase = y_case;
+		ij = ctx->ij_sw_corner + j;
+		ctx->u[ij + ctx->offset[kase][4]] = ctx->u[ij + ctx->offset[kase][7]] +
+		                          ctx->eps_p2 * (ctx->u[ij + ctx->offset[kase][3]] + ctx->u[ij + ctx->offset[kase][10]] - ctx->u[ij + ctx->offset[kase][1]] -
+		                                    ctx->u[ij + ctx->offset[kase][8]]) +
+		                          ctx->two_plus_ep2 * (ctx->u[ij + ctx->offset[kase][5]] - ctx->u[ij + ctx->offset[kase][6]]);
+		/*  + tense * (u[ij + offset[kase][6]] - u[ij + offset[kase][5]]) / (1.0 - tense);  */
+		/* East side :  */
+		kase = 20 + y_case;
+		ij = ctx->ij_se_corner + j;
+		ctx->u[ij + ctx->offset[kase][7]] = -(-ctx->u[ij + ctx->offset[kase][4]] +
+		                            ctx->eps_p2 * (ctx->u[ij + ctx->offset[kase][3]] + ctx->u[ij + ctx->offset[kase][10]] - ctx->u[ij + ctx->offset[kase][1]] -
+		                                      ctx->u[ij + ctx->offset[kase][8]]) +
+		                            ctx->two_plus_ep2 * (ctx->u[ij + ctx->offset[kase][5]] - ctx->u[ij + ctx->offset[kase][6]]));
+		/*  - tense * (u[ij + offset[kase][6]] - u[ij + offset[kase][5]]) / (1.0 - tense);  */
+	}
+}
+
+/* Relaxes node ij at column i, row j, returning the absolute change */
+static double update_node(struct mb_surface_ctx *ctx, int i, int j, int ij, int kase, int briggs_index) {
+	double sum_ij = 0.0;
+
+	if (ctx->iu[ij] == 0) { /* Point is unconstrained  */
+		for (int k = 0; k < 12; k++) {
+			sum_ij += (ctx->u[ij + ctx->offset[kase][k]] * ctx->coeff[0][k]);
+		}
+	}
+	else { /* Point is constrained  */
+		const double b0 = ctx->briggs[briggs_index].b[0];
+		const double b1 = ctx->briggs[briggs_index].b[1];
+		const double b2 = ctx->briggs[briggs_index].b[2];
+		const double b3 = ctx->briggs[briggs_index].b[3];
+		const double b4 = ctx->briggs[briggs_index].b[4];
+		const double b5 = ctx->briggs[briggs_index].b[5];
+		double busum;
+		if (ctx->iu[ij] < 3) {
+			if (ctx->iu[ij] == 1) { /* Point is in quadrant 1  */
+				busum = b0 * ctx->u[ij + ctx->offset[kase][10]] + b1 * ctx->u[ij + ctx->offset[kase][9]] + b2 * ctx->u[ij + ctx->offset[kase][5]] +
+				        b3 * ctx->u[ij + ctx->offset[kase][1]];
+			}
+			else { /* Point is in quadrant 2  */
+				busum = b0 * ctx->u[ij + ctx->offset[kase][8]] + b1 * ctx->u[ij + ctx->offset[kase][9]] + b2 * ctx->u[ij + ctx->offset[kase][6]] +
+				        b3 * ctx->u[ij + ctx->offset[kase][3]];
+			}
+		}
+		else {
+			if (ctx->iu[ij] == 3) { /* Point is in quadrant 3  */
+				busum = b0 * ctx->u[ij + ctx->offset[kase][1]] + b1 * ctx->u[ij + ctx->offset[kase][2]] + b2 * ctx->u[ij + ctx->offset[kase][6]] +
+				        b3 * ctx->u[ij + ctx->offset[kase][10]];
+			}
+			else { /* Point is in quadrant 4  */
+				busum = b0 * ctx->u[ij + ctx->offset[kase][3]] + b1 * ctx->u[ij + ctx->offset[kase][2]] + b2 * ctx->u[ij + ctx->offset[kase][5]] +
+				        b3 * ctx->u[ij + ctx->offset[kase][8]];
+			}
 		}
+		for (int k = 0; k < 12; k++) {
+			sum_ij += (ctx->u[ij + ctx->offset[kase][k]] * ctx->coeff[1][k]);
+		}
+		sum_ij = (sum_ij + ctx->a0_const_2 * (busum + b5)) / (ctx->a0_const_1 + ctx->a0_const_2 * b4);
+	}
+
+	/* New relaxation here  */
+	sum_ij = ctx->u[ij] * ctx->relax_old + sum_ij * ctx->relax_new;
+
+	if (ctx->constrained) { /* Must check limits.  Note lower/upper is v2 format and need ij_v2! */
+		const int ij_v2 = (ctx->n_rows - j - 1) * ctx->n_columns + i;
+		if (ctx->set_low /*&& !GMT_is_fnan((double)lower[ij_v2])*/ && sum_ij < ctx->lower[ij_v2])
+			sum_ij = ctx->lower[ij_v2];
+		else if (ctx->set_high /*&& !GMT_is_fnan((double)upper[ij_v2])*/ && sum_ij > ctx->upper[ij_v2])
+			sum_ij = ctx->upper[ij_v2];
+	}
+
+	const double change = fabs(sum_ij - ctx->u[ij]);
+	ctx->u[ij] = sum_ij;
+	return (change);
+}
+
+/* Relaxes the nodes in block columns block_i_start to block_i_end - 1, starting
+    with constraint briggs_index. If color >= 0 only nodes of that color are
+    relaxed, where the color (block_i + 3 * block_j) % 5 differs between any two
+    nodes coupled by the 12 point stencil, so that nodes of one color can be
+    relaxed concurrently. */
+static double sweep_columns(struct mb_surface_ctx *ctx, int block_i_start, int block_i_end, int color, int briggs_index) {
+	double max_change = -1.0;
+
+	for (int block_i = block_i_start; block_i < block_i_end; block_i++) {
+		const int i = block_i * ctx->grid;
+		const int x_w_case = block_i;
+		const int x_e_case = ctx->block_n_columns - 1 - block_i;
+		int x_case;
+		if (x_w_case < 2)
+			x_case = x_w_case;
+		else if (x_e_case < 2)
+			x_case = 4 - x_e_case;
+		else
+			x_case = 2;
+
+		int ij = ctx->ij_sw_corner + i * ctx->m_rows;
+		for (int block_j = 0, j = 0; j < ctx->n_rows; block_j++, j += ctx->grid, ij += ctx->grid) {
 
-		y_s_case = 0;
-		y_n_case = block_n_rows - 1;
-		for (int j = 0; j < n_rows; j += grid, y_s_case++, y_n_case--) {
+			if (ctx->iu[ij] == 5)
+				continue; /* Point is fixed  */
+			const int node_briggs_index = briggs_index;
+			if (ctx->iu[ij] != 0)
+				briggs_index++;
+			if (color >= 0 && (block_i + 3 * block_j) % 5 != color)
+				continue;
 
+			const int y_s_case = block_j;
+			const int y_n_case = ctx->block_n_rows - 1 - block_j;
+			int y_case;
 			if (y_s_case < 2)
 				y_case = y_s_case;
 			else if (y_n_case < 2)
@@ -659,151 +803,199 @@ int iterate(int mode) {
 			else
 				y_case = 2;
 
-			/* West side :  */
-			kase = y_case;
-			ij = ij_sw_corner + j;
-			u[ij + offset[kase][4]] = u[ij + offset[kase][7]] +
-			                          eps_p2 * (u[ij + offset[kase][3]] + u[ij + offset[kase][10]] - u[ij + offset[kase][1]] -
-			                                    u[ij + offset[kase][8]]) +
-			                          two_plus_ep2 * (u[ij + offset[kase][5]] - u[ij + offset[kase][6]]);
-			/*  + tense * (u[ij + offset[kase][6]] - u[ij + offset[kase][5]]) / (1.0 - tense);  */
-			/* East side :  */
-			kase = 20 + y_case;
-			ij = ij_se_corner + j;
-			u[ij + offset[kase][7]] = -(-u[ij + offset[kase][4]] +
-			                            eps_p2 * (u[ij + offset[kase][3]] + u[ij + offset[kase][10]] - u[ij + offset[kase][1]] -
-			                                      u[ij + offset[kase][8]]) +
-			                            two_plus_ep2 * (u[ij + offset[kase][5]] - u[ij + offset[kase][6]]));
-			/*  - tense * (u[ij + offset[kase][6]] - u[ij + offset[kase][5]]) / (1.0 - tense);  */
+			const double change = update_node(ctx, i, j, ij, x_case * 5 + y_case, node_briggs_index);
+			if (change > max_change)
+				max_change = change;
 		}
+	}
 
-		/* That's it for the boundary points.  Now loop over all data  */
-
-		x_w_case = 0;
-		x_e_case = block_n_columns - 1;
-		for (int i = 0; i < n_columns; i += grid, x_w_case++, x_e_case--) {
-
-			if (x_w_case < 2)
-				x_case = x_w_case;
-			else if (x_e_case < 2)
-				x_case = 4 - x_e_case;
-			else
-				x_case = 2;
+	return (max_change);
+}
 
-			y_s_case = 0;
-			y_n_case = block_n_rows - 1;
+/* Shared state of the threads relaxing one grid in parallel */
+struct mb_surface_sweep {
+	struct mb_surface_ctx *ctx;
+	int nthreads;
+	int *briggs_column; /* Index of first constraint in each block column */
+	double max_change[MB_THREAD_MAX];
+	double current_limit;
+	int mode;
+	int iteration_count;
+	int done;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int barrier_count;
+	int barrier_generation;
+};
 
-			ij = ij_sw_corner + i * m_rows;
+struct mb_surface_sweep_thread {
+	struct mb_surface_sweep *sweep;
+	int ithread;
+};
 
-			for (int j = 0; j < n_rows; j += grid, ij += grid, y_s_case++, y_n_case--) {
+static void sweep_barrier(struct mb_surface_sweep *sweep) {
+	pthread_mutex_lock(&sweep->mutex);
+	const int generation = sweep->barrier_generation;
+	if (++sweep->barrier_count == sweep->nthreads) {
+		sweep->barrier_count = 0;
+		sweep->barrier_generation++;
+		pthread_cond_broadcast(&sweep->cond);
+	}
+	else {
+		while (generation == sweep->barrier_generation)
+			pthread_cond_wait(&sweep->cond, &sweep->mutex);
+	}
+	pthread_mutex_unlock(&sweep->mutex);
+}
 
-				if (iu[ij] == 5)
-					continue; /* Point is fixed  */
+static void *sweep_thread(void *arg) {
+	struct mb_surface_sweep_thread *thread = (struct mb_surface_sweep_thread *)arg;
+	struct mb_surface_sweep *sweep = thread->sweep;
+	struct mb_surface_ctx *ctx = sweep->ctx;
+	const int block_i_start = thread->ithread * ctx->block_n_columns / sweep->nthreads;
+	const int block_i_end = (thread->ithread + 1) * ctx->block_n_columns / sweep->nthreads;
+
+	while (!sweep->done) {
+		/* boundary values are set by the first thread alone */
+		if (thread->ithread == 0)
+			set_boundaries(ctx);
+		sweep_barrier(sweep);
+
+		double max_change = -1.0;
+		for (int color = 0; color < 5; color++) {
+			const double change = sweep_columns(ctx, block_i_start, block_i_end, color, sweep->briggs_column[block_i_start]);
+			if (change > max_change)
+				max_change = change;
+			sweep_barrier(sweep);
+		}
+		sweep->max_change[thread->ithread] = max_change;
+		sweep_barrier(sweep);
+
+		/* the first thread checks for convergence once every thread has
+		    finished the sweep */
+		if (thread->ithread == 0) {
+			max_change = -1.0;
+			for (int i = 0; i < sweep->nthreads; i++)
+				if (sweep->max_change[i] > max_change)
+					max_change = sweep->max_change[i];
+			sweep->iteration_count++;
+			ctx->total_iterations++;
+			max_change *= ctx->z_scale; /* Put max_change into z units  */
+			sweep->max_change[0] = max_change;
+			if (ctx->local_verbose > 1)
+				fprintf(stderr, "%4d\t%c\t%8d\t%10lg\t%10lg\t%10d\n", ctx->grid, ctx->mode_type[sweep->mode],
+				        sweep->iteration_count, max_change, sweep->current_limit, ctx->total_iterations);
+			if (!(max_change > sweep->current_limit && sweep->iteration_count < ctx->max_iterations))
+				sweep->done = TRUE;
+		}
+		sweep_barrier(sweep);
+	}
 
-				if (y_s_case < 2)
-					y_case = y_s_case;
-				else if (y_n_case < 2)
-					y_case = 4 - y_n_case;
-				else
-					y_case = 2;
+	return (NULL);
+}
 
-				kase = x_case * 5 + y_case;
-				sum_ij = 0.0;
+/* Relaxes the grid until it converges. With nthreads > 0 the nodes are
+    relaxed in the five color order of sweep_columns() whatever the number
+    of threads, so the result does not depend on it; otherwise they are
+    relaxed in the serial order of the original surface program. */
+static int iterate(struct mb_surface_ctx *ctx, int mode) {
+	int iteration_count = 0;
+	double current_limit = ctx->converge_limit / ctx->grid;
+	double max_change = 0.0;
 
-				if (iu[ij] == 0) { /* Point is unconstrained  */
-					for (k = 0; k < 12; k++) {
-						sum_ij += (u[ij + offset[kase][k]] * coeff[0][k]);
-					}
-				}
-				else { /* Point is constrained  */
-
-					b0 = briggs[briggs_index].b[0];
-					b1 = briggs[briggs_index].b[1];
-					b2 = briggs[briggs_index].b[2];
-					b3 = briggs[briggs_index].b[3];
-					b4 = briggs[briggs_index].b[4];
-					b5 = briggs[briggs_index].b[5];
-					briggs_index++;
-					if (iu[ij] < 3) {
-						if (iu[ij] == 1) { /* Point is in quadrant 1  */
-							busum = b0 * u[ij + offset[kase][10]] + b1 * u[ij + offset[kase][9]] + b2 * u[ij + offset[kase][5]] +
-							        b3 * u[ij + offset[kase][1]];
-						}
-						else { /* Point is in quadrant 2  */
-							busum = b0 * u[ij + offset[kase][8]] + b1 * u[ij + offset[kase][9]] + b2 * u[ij + offset[kase][6]] +
-							        b3 * u[ij + offset[kase][3]];
-						}
-					}
-					else {
-						if (iu[ij] == 3) { /* Point is in quadrant 3  */
-							busum = b0 * u[ij + offset[kase][1]] + b1 * u[ij + offset[kase][2]] + b2 * u[ij + offset[kase][6]] +
-							        b3 * u[ij + offset[kase][10]];
-						}
-						else { /* Point is in quadrant 4  */
-							busum = b0 * u[ij + offset[kase][3]] + b1 * u[ij + offset[kase][2]] + b2 * u[ij + offset[kase][5]] +
-							        b3 * u[ij + offset[kase][8]];
-						}
-					}
-					for (k = 0; k < 12; k++) {
-						sum_ij += (u[ij + offset[kase][k]] * coeff[1][k]);
-					}
-					sum_ij = (sum_ij + a0_const_2 * (busum + b5)) / (a0_const_1 + a0_const_2 * b4);
-				}
+	if (ctx->nthreads > 0) {
+		const int nthreads = MAX(1, MIN(ctx->nthreads, ctx->block_n_columns / 4));
+		struct mb_surface_sweep sweep;
+		struct mb_surface_sweep_thread threads[MB_THREAD_MAX];
+		pthread_t thread_ids[MB_THREAD_MAX];
+		sweep.ctx = ctx;
+		sweep.nthreads = nthreads;
+		sweep.current_limit = current_limit;
+		sweep.mode = mode;
+		sweep.iteration_count = 0;
+		sweep.done = FALSE;
+		sweep.barrier_count = 0;
+		sweep.barrier_generation = 0;
+
+		/* index the constraints by block column */
+		sweep.briggs_column = NULL;
+		ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, (ctx->block_n_columns + 1) * sizeof(int),
+		                         (void **)&sweep.briggs_column, &ctx->local_error);
+		if (ctx->status != MB_SUCCESS)
+			return (0);
+		sweep.briggs_column[0] = 0;
+		for (int block_i = 0; block_i < ctx->block_n_columns; block_i++) {
+			int nconstraint = 0;
+			const int ij = ctx->ij_sw_corner + block_i * ctx->grid * ctx->m_rows;
+			for (int j = 0; j < ctx->n_rows; j += ctx->grid)
+				if (ctx->iu[ij + j] > 0 && ctx->iu[ij + j] < 5)
+					nconstraint++;
+			sweep.briggs_column[block_i + 1] = sweep.briggs_column[block_i] + nconstraint;
+		}
 
-				/* New relaxation here  */
-				sum_ij = u[ij] * relax_old + sum_ij * relax_new;
+		pthread_mutex_init(&sweep.mutex, NULL);
+		pthread_cond_init(&sweep.cond, NULL);
+		for (int i = 0; i < nthreads; i++) {
+			threads[i].sweep = &sweep;
+			threads[i].ithread = i;
+			if (i > 0)
+				pthread_create(&thread_ids[i], NULL, sweep_thread, &threads[i]);
+		}
+		sweep_thread(&threads[0]);
+		for (int i = 1; i < nthreads; i++)
+			pthread_join(thread_ids[i], NULL);
+		pthread_cond_destroy(&sweep.cond);
+		pthread_mutex_destroy(&sweep.mutex);
+		int error = MB_ERROR_NO_ERROR;
+		mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&sweep.briggs_column, &error);
+		iteration_count = sweep.iteration_count;
+		max_change = sweep.max_change[0];
+	}
+	else {
+		do {
+			set_boundaries(ctx);
 
-				if (constrained) { /* Must check limits.  Note lower/upper is v2 format and need ij_v2! */
-					ij_v2 = (n_rows - j - 1) * n_columns + i;
-					if (set_low /*&& !GMT_is_fnan((double)lower[ij_v2])*/ && sum_ij < lower[ij_v2])
-						sum_ij = lower[ij_v2];
-					else if (set_high /*&& !GMT_is_fnan((double)upper[ij_v2])*/ && sum_ij > upper[ij_v2])
-						sum_ij = upper[ij_v2];
-				}
+			/* That's it for the boundary points.  Now loop over all data  */
+			max_change = sweep_columns(ctx, 0, ctx->block_n_columns, -1, 0);
 
-				change = fabs(sum_ij - u[ij]);
-				u[ij] = sum_ij;
-				if (change > max_change)
-					max_change = change;
-			}
-		}
-		iteration_count++;
-		total_iterations++;
-		max_change *= z_scale; /* Put max_change into z units  */
-		if (local_verbose > 1)
-			fprintf(stderr, "%4d\t%c\t%8d\t%10lg\t%10lg\t%10d\n", grid, mode_type[mode], iteration_count, max_change,
-			        current_limit, total_iterations);
+			iteration_count++;
+			ctx->total_iterations++;
+			max_change *= ctx->z_scale; /* Put max_change into z units  */
+			if (ctx->local_verbose > 1)
+				fprintf(stderr, "%4d\t%c\t%8d\t%10lg\t%10lg\t%10d\n", ctx->grid, ctx->mode_type[mode], iteration_count, max_change,
+				        current_limit, ctx->total_iterations);
 
-	} while (max_change > current_limit && iteration_count < max_iterations);
+		} while (max_change > current_limit && iteration_count < ctx->max_iterations);
+	}
 
-	if (local_verbose)
-		fprintf(stderr, "%4d\t%c\t%8d\t%10lg\t%10lg\t%10d\n", grid, mode_type[mode], iteration_count, max_change, current_limit,
-		        total_iterations);
+	if (ctx->local_verbose)
+		fprintf(stderr, "%4d\t%c\t%8d\t%10lg\t%10lg\t%10d\n", ctx->grid, ctx->mode_type[mode], iteration_count, max_change, current_limit,
+		        ctx->total_iterations);
 
 	return (iteration_count);
 }
 
 
-void check_errors() {
-	const double x_0_const = 4.0 * (1.0 - boundary_tension) / (2.0 - boundary_tension);
-	const double x_1_const = (3 * boundary_tension - 2.0) / (2.0 - boundary_tension);
-	const double y_denom = 2 * epsilon * (1.0 - boundary_tension) + boundary_tension;
-	const double y_0_const = 4 * epsilon * (1.0 - boundary_tension) / y_denom;
-	const double y_1_const = (boundary_tension - 2 * epsilon * (1.0 - boundary_tension)) / y_denom;
+static void check_errors(struct mb_surface_ctx *ctx) {
+	const double x_0_const = 4.0 * (1.0 - ctx->boundary_tension) / (2.0 - ctx->boundary_tension);
+	const double x_1_const = (3 * ctx->boundary_tension - 2.0) / (2.0 - ctx->boundary_tension);
+	const double y_denom = 2 * ctx->epsilon * (1.0 - ctx->boundary_tension) + ctx->boundary_tension;
+	const double y_0_const = 4 * ctx->epsilon * (1.0 - ctx->boundary_tension) / y_denom;
+	const double y_1_const = (ctx->boundary_tension - 2 * ctx->epsilon * (1.0 - ctx->boundary_tension)) / y_denom;
 
 	// move_over = offset[kase][12], but grid = 1 so move_over is easy
 	const int move_over[12] = {
 		2,
-		1 - m_rows,
+		1 - ctx->m_rows,
 		1,
-		1 + m_rows,
-		-2 * m_rows,
-		-m_rows,
-		m_rows,
-		2 * m_rows,
-		-1 - m_rows,
+		1 + ctx->m_rows,
+		-2 * ctx->m_rows,
+		-ctx->m_rows,
+		ctx->m_rows,
+		2 * ctx->m_rows,
+		-1 - ctx->m_rows,
 		-1,
-		-1 + m_rows,
+		-1 + ctx->m_rows,
 		-2,
 	};
 
@@ -811,106 +1003,106 @@ void check_errors() {
 	double mean_squared_error = 0.0;
 
 	/* First update the boundary values  */
-	for (int i = 0; i < n_columns; i++) {
-		int ij = ij_sw_corner + i * m_rows;
-		u[ij - 1] = y_0_const * u[ij] + y_1_const * u[ij + 1];
-		ij = ij_nw_corner + i * m_rows;
-		u[ij + 1] = y_0_const * u[ij] + y_1_const * u[ij - 1];
+	for (int i = 0; i < ctx->n_columns; i++) {
+		int ij = ctx->ij_sw_corner + i * ctx->m_rows;
+		ctx->u[ij - 1] = y_0_const * ctx->u[ij] + y_1_const * ctx->u[ij + 1];
+		ij = ctx->ij_nw_corner + i * ctx->m_rows;
+		ctx->u[ij + 1] = y_0_const * ctx->u[ij] + y_1_const * ctx->u[ij - 1];
 	}
 
-	for (int j = 0; j < n_rows; j++) {
-		int ij = ij_sw_corner + j;
-		u[ij - m_rows] = x_1_const * u[ij + m_rows] + x_0_const * u[ij];
-		ij = ij_se_corner + j;
-		u[ij + m_rows] = x_1_const * u[ij - m_rows] + x_0_const * u[ij];
+	for (int j = 0; j < ctx->n_rows; j++) {
+		int ij = ctx->ij_sw_corner + j;
+		ctx->u[ij - ctx->m_rows] = x_1_const * ctx->u[ij + ctx->m_rows] + x_0_const * ctx->u[ij];
+		ij = ctx->ij_se_corner + j;
+		ctx->u[ij + ctx->m_rows] = x_1_const * ctx->u[ij - ctx->m_rows] + x_0_const * ctx->u[ij];
 	}
 
-	int ij = ij_sw_corner;
-	u[ij - m_rows - 1] = u[ij + m_rows - 1] + u[ij - m_rows + 1] - u[ij + m_rows + 1];
-	ij = ij_nw_corner;
-	u[ij - m_rows + 1] = u[ij + m_rows + 1] + u[ij - m_rows - 1] - u[ij + m_rows - 1];
-	ij = ij_se_corner;
-	u[ij + m_rows - 1] = u[ij - m_rows - 1] + u[ij + m_rows + 1] - u[ij - m_rows + 1];
-	ij = ij_ne_corner;
-	u[ij + m_rows + 1] = u[ij - m_rows + 1] + u[ij + m_rows - 1] - u[ij - m_rows - 1];
-
-	for (int i = 0; i < n_columns; i++) {
-
-		ij = ij_sw_corner + i * m_rows;
-		u[ij + move_over[11]] =
-		    (u[ij + move_over[0]] +
-		     eps_m2 * (u[ij + move_over[1]] + u[ij + move_over[3]] - u[ij + move_over[8]] - u[ij + move_over[10]]) +
-		     two_plus_em2 * (u[ij + move_over[9]] - u[ij + move_over[2]]));
-
-		ij = ij_nw_corner + i * m_rows;
-		u[ij + move_over[0]] =
-		    -(-u[ij + move_over[11]] +
-		      eps_m2 * (u[ij + move_over[1]] + u[ij + move_over[3]] - u[ij + move_over[8]] - u[ij + move_over[10]]) +
-		      two_plus_em2 * (u[ij + move_over[9]] - u[ij + move_over[2]]));
+	int ij = ctx->ij_sw_corner;
+	ctx->u[ij - ctx->m_rows - 1] = ctx->u[ij + ctx->m_rows - 1] + ctx->u[ij - ctx->m_rows + 1] - ctx->u[ij + ctx->m_rows + 1];
+	ij = ctx->ij_nw_corner;
+	ctx->u[ij - ctx->m_rows + 1] = ctx->u[ij + ctx->m_rows + 1] + ctx->u[ij - ctx->m_rows - 1] - ctx->u[ij + ctx->m_rows - 1];
+	ij = ctx->ij_se_corner;
+	ctx->u[ij + ctx->m_rows - 1] = ctx->u[ij - ctx->m_rows - 1] + ctx->u[ij + ctx->m_rows + 1] - ctx->u[ij - ctx->m_rows + 1];
+	ij = ctx->ij_ne_corner;
+	ctx->u[ij + ctx->m_rows + 1] = ctx->u[ij - ctx->m_rows + 1] + ctx->u[ij + ctx->m_rows - 1] - ctx->u[ij - ctx->m_rows - 1];
+
+	for (int i = 0; i < ctx->n_columns; i++) {
+
+		ij = ctx->ij_sw_corner + i * ctx->m_rows;
+		ctx->u[ij + move_over[11]] =
+		    (ctx->u[ij + move_over[0]] +
+		     ctx->eps_m2 * (ctx->u[ij + move_over[1]] + ctx->u[ij + move_over[3]] - ctx->u[ij + move_over[8]] - ctx->u[ij + move_over[10]]) +
+		     ctx->two_plus_em2 * (ctx->u[ij + move_over[9]] - ctx->u[ij + move_over[2]]));
+
+		ij = ctx->ij_nw_corner + i * ctx->m_rows;
+		ctx->u[ij + move_over[0]] =
+		    -(-ctx->u[ij + move_over[11]] +
+		      ctx->eps_m2 * (ctx->u[ij + move_over[1]] + ctx->u[ij + move_over[3]] - ctx->u[ij + move_over[8]] - ctx->u[ij + move_over[10]]) +
+		      ctx->two_plus_em2 * (ctx->u[ij + move_over[9]] - ctx->u[ij + move_over[2]]));
 	}
 
-	for (int j = 0; j < n_rows; j++) {
+	for (int j = 0; j < ctx->n_rows; j++) {
 
-		ij = ij_sw_corner + j;
-		u[ij + move_over[4]] =
-		    u[ij + move_over[7]] +
-		    eps_p2 * (u[ij + move_over[3]] + u[ij + move_over[10]] - u[ij + move_over[1]] - u[ij + move_over[8]]) +
-		    two_plus_ep2 * (u[ij + move_over[5]] - u[ij + move_over[6]]);
+		ij = ctx->ij_sw_corner + j;
+		ctx->u[ij + move_over[4]] =
+		    ctx->u[ij + move_over[7]] +
+		    ctx->eps_p2 * (ctx->u[ij + move_over[3]] + ctx->u[ij + move_over[10]] - ctx->u[ij + move_over[1]] - ctx->u[ij + move_over[8]]) +
+		    ctx->two_plus_ep2 * (ctx->u[ij + move_over[5]] - ctx->u[ij + move_over[6]]);
 
-		ij = ij_se_corner + j;
-		u[ij + move_over[7]] =
-		    -(-u[ij + move_over[4]] +
-		      eps_p2 * (u[ij + move_over[3]] + u[ij + move_over[10]] - u[ij + move_over[1]] - u[ij + move_over[8]]) +
-		      two_plus_ep2 * (u[ij + move_over[5]] - u[ij + move_over[6]]));
+		ij = ctx->ij_se_corner + j;
+		ctx->u[ij + move_over[7]] =
+		    -(-ctx->u[ij + move_over[4]] +
+		      ctx->eps_p2 * (ctx->u[ij + move_over[3]] + ctx->u[ij + move_over[10]] - ctx->u[ij + move_over[1]] - ctx->u[ij + move_over[8]]) +
+		      ctx->two_plus_ep2 * (ctx->u[ij + move_over[5]] - ctx->u[ij + move_over[6]]));
 	}
 
 	/* That resets the boundary values.  Now we can test all data.
 	    Note that this loop checks all values, even though only nearest were used.  */
 
-	for (int k = 0; k < npoints; k++) {
-		int i = data[k].index / n_rows;
-		int j = data[k].index % n_rows;
-		ij = ij_sw_corner + i * m_rows + j;
-		if (iu[ij] == 5)
+	for (int k = 0; k < ctx->npoints; k++) {
+		int i = ctx->data[k].index / ctx->n_rows;
+		int j = ctx->data[k].index % ctx->n_rows;
+		ij = ctx->ij_sw_corner + i * ctx->m_rows + j;
+		if (ctx->iu[ij] == 5)
 			continue;
-		const double x0 = xmin + i * xinc;
-		const double y0 = ymin + j * yinc;
-		const double dx = (data[k].x - x0) * r_xinc;
-		const double dy = (data[k].y - y0) * r_yinc;
-
-		const double du_dx = 0.5 * (u[ij + move_over[6]] - u[ij + move_over[5]]);
-		const double du_dy = 0.5 * (u[ij + move_over[2]] - u[ij + move_over[9]]);
-		const double d2u_dx2 = u[ij + move_over[6]] + u[ij + move_over[5]] - 2 * u[ij];
-		const double d2u_dy2 = u[ij + move_over[2]] + u[ij + move_over[9]] - 2 * u[ij];
-		const double d2u_dxdy = 0.25 * (u[ij + move_over[3]] - u[ij + move_over[1]] - u[ij + move_over[10]] + u[ij + move_over[8]]);
-		const double d3u_dx3 = 0.5 * (u[ij + move_over[7]] - 2 * u[ij + move_over[6]] + 2 * u[ij + move_over[5]] - u[ij + move_over[4]]);
-		const double d3u_dy3 = 0.5 * (u[ij + move_over[0]] - 2 * u[ij + move_over[2]] + 2 * u[ij + move_over[9]] - u[ij + move_over[11]]);
-		const double d3u_dx2dy = 0.5 * ((u[ij + move_over[3]] + u[ij + move_over[1]] - 2 * u[ij + move_over[2]]) -
-		                   (u[ij + move_over[10]] + u[ij + move_over[8]] - 2 * u[ij + move_over[9]]));
-		const double d3u_dxdy2 = 0.5 * ((u[ij + move_over[3]] + u[ij + move_over[10]] - 2 * u[ij + move_over[6]]) -
-		                   (u[ij + move_over[1]] + u[ij + move_over[8]] - 2 * u[ij + move_over[5]]));
+		const double x0 = ctx->xmin + i * ctx->xinc;
+		const double y0 = ctx->ymin + j * ctx->yinc;
+		const double dx = (ctx->data[k].x - x0) * ctx->r_xinc;
+		const double dy = (ctx->data[k].y - y0) * ctx->r_yinc;
+
+		const double du_dx = 0.5 * (ctx->u[ij + move_over[6]] - ctx->u[ij + move_over[5]]);
+		const double du_dy = 0.5 * (ctx->u[ij + move_over[2]] - ctx->u[ij + move_over[9]]);
+		const double d2u_dx2 = ctx->u[ij + move_over[6]] + ctx->u[ij + move_over[5]] - 2 * ctx->u[ij];
+		const double d2u_dy2 = ctx->u[ij + move_over[2]] + ctx->u[ij + move_over[9]] - 2 * ctx->u[ij];
+		const double d2u_dxdy = 0.25 * (ctx->u[ij + move_over[3]] - ctx->u[ij + move_over[1]] - ctx->u[ij + move_over[10]] + ctx->u[ij + move_over[8]]);
+		const double d3u_dx3 = 0.5 * (ctx->u[ij + move_over[7]] - 2 * ctx->u[ij + move_over[6]] + 2 * ctx->u[ij + move_over[5]] - ctx->u[ij + move_over[4]]);
+		const double d3u_dy3 = 0.5 * (ctx->u[ij + move_over[0]] - 2 * ctx->u[ij + move_over[2]] + 2 * ctx->u[ij + move_over[9]] - ctx->u[ij + move_over[11]]);
+		const double d3u_dx2dy = 0.5 * ((ctx->u[ij + move_over[3]] + ctx->u[ij + move_over[1]] - 2 * ctx->u[ij + move_over[2]]) -
+		                   (ctx->u[ij + move_over[10]] + ctx->u[ij + move_over[8]] - 2 * ctx->u[ij + move_over[9]]));
+		const double d3u_dxdy2 = 0.5 * ((ctx->u[ij + move_over[3]] + ctx->u[ij + move_over[10]] - 2 * ctx->u[ij + move_over[6]]) -
+		                   (ctx->u[ij + move_over[1]] + ctx->u[ij + move_over[8]] - 2 * ctx->u[ij + move_over[5]]));
 
 		/* 3rd order Taylor approx:  */
 
-		const double z_est = u[ij] + dx * (du_dx + dx * ((0.5 * d2u_dx2) + dx * (d3u_dx3 / 6.0))) +
+		const double z_est = ctx->u[ij] + dx * (du_dx + dx * ((0.5 * d2u_dx2) + dx * (d3u_dx3 / 6.0))) +
 		        dy * (du_dy + dy * ((0.5 * d2u_dy2) + dy * (d3u_dy3 / 6.0))) + dx * dy * (d2u_dxdy) + (0.5 * dx * d3u_dx2dy) +
 		        (0.5 * dy * d3u_dxdy2);
 
-		const double z_err = z_est - data[k].z;
+		const double z_err = z_est - ctx->data[k].z;
 		mean_error += z_err;
 		mean_squared_error += (z_err * z_err);
 	}
-	mean_error /= npoints;
-	mean_squared_error = sqrt(mean_squared_error / npoints);
+	mean_error /= ctx->npoints;
+	mean_squared_error = sqrt(mean_squared_error / ctx->npoints);
 
-	const int n_nodes = n_columns * n_rows;
+	const int n_nodes = ctx->n_columns * ctx->n_rows;
 	double curvature = 0.0;
 
-	for (int i = 0; i < n_columns; i++) {
-		for (int j = 0; j < n_rows; j++) {
-			ij = ij_sw_corner + i * m_rows + j;
-			const double c = u[ij + move_over[6]] + u[ij + move_over[5]] + u[ij + move_over[2]] + u[ij + move_over[9]] -
-			    4.0 * u[ij + move_over[6]];
+	for (int i = 0; i < ctx->n_columns; i++) {
+		for (int j = 0; j < ctx->n_rows; j++) {
+			ij = ctx->ij_sw_corner + i * ctx->m_rows + j;
+			const double c = ctx->u[ij + move_over[6]] + ctx->u[ij + move_over[5]] + ctx->u[ij + move_over[2]] + ctx->u[ij + move_over[9]] -
+			    4.0 * ctx->u[ij + move_over[6]];
 			curvature += (c * c);
 		}
 	}
@@ -920,14 +1112,14 @@ void check_errors() {
 	fprintf (stderr,"\t%8d\t%8d\t%.8lg\t%.8lg\t%.8lg\n", npoints, n_nodes, mean_error, mean_squared_error,
 	   curvature);
    */
-	if (local_verbose) {
+	if (ctx->local_verbose) {
 		fprintf(stderr, "\nSpline interpolation fit information:\n");
 		fprintf(stderr, "Data points   nodes    mean error     rms error     curvature\n");
-		fprintf(stderr, "%9d %9d   %10g   %10g  %10g\n", npoints, n_nodes, mean_error, mean_squared_error, curvature);
+		fprintf(stderr, "%9d %9d   %10g   %10g  %10g\n", ctx->npoints, n_nodes, mean_error, mean_squared_error, curvature);
 	}
 }
 
-int remove_planar_trend() {
+static int remove_planar_trend(struct mb_surface_ctx *ctx) {
 	double xx = 0.0;
 	double yy = 0.0;
 	double zz = 0.0;
@@ -940,11 +1132,11 @@ int remove_planar_trend() {
 	double syy = 0.0;
 	double syz = 0.0;
 
-	for (int i = 0; i < npoints; i++) {
+	for (int i = 0; i < ctx->npoints; i++) {
 
-		xx = (data[i].x - xmin) * r_xinc;
-		yy = (data[i].y - ymin) * r_yinc;
-		zz = data[i].z;
+		xx = (ctx->data[i].x - ctx->xmin) * ctx->r_xinc;
+		yy = (ctx->data[i].y - ctx->ymin) * ctx->r_yinc;
+		zz = ctx->data[i].z;
 
 		sx += xx;
 		sy += yy;
@@ -956,43 +1148,43 @@ int remove_planar_trend() {
 		syz += (yy * zz);
 	}
 
-	const double d = npoints * sxx * syy + 2 * sx * sy * sxy - npoints * sxy * sxy - sx * sx * syy - sy * sy * sxx;
+	const double d = ctx->npoints * sxx * syy + 2 * sx * sy * sxy - ctx->npoints * sxy * sxy - sx * sx * syy - sy * sy * sxx;
 
 	if (d == 0.0) {
-		plane_c0 = plane_c1 = plane_c2 = 0.0;
+		ctx->plane_c0 = ctx->plane_c1 = ctx->plane_c2 = 0.0;
 		return (0);
 	}
 
 	const double a = sz * sxx * syy + sx * sxy * syz + sy * sxy * sxz - sz * sxy * sxy - sx * sxz * syy - sy * syz * sxx;
-	const double b = npoints * sxz * syy + sz * sy * sxy + sy * sx * syz - npoints * sxy * syz - sz * sx * syy - sy * sy * sxz;
-	const double c = npoints * sxx * syz + sx * sy * sxz + sz * sx * sxy - npoints * sxy * sxz - sx * sx * syz - sz * sy * sxx;
+	const double b = ctx->npoints * sxz * syy + sz * sy * sxy + sy * sx * syz - ctx->npoints * sxy * syz - sz * sx * syy - sy * sy * sxz;
+	const double c = ctx->npoints * sxx * syz + sx * sy * sxz + sz * sx * sxy - ctx->npoints * sxy * sxz - sx * sx * syz - sz * sy * sxx;
 
-	plane_c0 = a / d;
-	plane_c1 = b / d;
-	plane_c2 = c / d;
+	ctx->plane_c0 = a / d;
+	ctx->plane_c1 = b / d;
+	ctx->plane_c2 = c / d;
 
-	for (int i = 0; i < npoints; i++) {
+	for (int i = 0; i < ctx->npoints; i++) {
 
-		xx = (data[i].x - xmin) * r_xinc;
-		yy = (data[i].y - ymin) * r_yinc;
+		xx = (ctx->data[i].x - ctx->xmin) * ctx->r_xinc;
+		yy = (ctx->data[i].y - ctx->ymin) * ctx->r_yinc;
 
-		data[i].z -= (plane_c0 + plane_c1 * xx + plane_c2 * yy);
+		ctx->data[i].z -= (ctx->plane_c0 + ctx->plane_c1 * xx + ctx->plane_c2 * yy);
 	}
 
 	return (0);
 }
 
-int replace_planar_trend() {
-	for (int i = 0; i < n_columns; i++) {
-		for (int j = 0; j < n_rows; j++) {
-			const int ij = ij_sw_corner + i * m_rows + j;
-			u[ij] = (u[ij] * z_scale) + (plane_c0 + plane_c1 * i + plane_c2 * j);
+static int replace_planar_trend(struct mb_surface_ctx *ctx) {
+	for (int i = 0; i < ctx->n_columns; i++) {
+		for (int j = 0; j < ctx->n_rows; j++) {
+			const int ij = ctx->ij_sw_corner + i * ctx->m_rows + j;
+			ctx->u[ij] = (ctx->u[ij] * ctx->z_scale) + (ctx->plane_c0 + ctx->plane_c1 * i + ctx->plane_c2 * j);
 		}
 	}
 	return (0);
 }
 
-int throw_away_unusables() {
+static int throw_away_unusables(struct mb_surface_ctx *ctx) {
 	/* This is a new routine to eliminate data which will become
 	    unusable on the final iteration, when grid = 1.
 	    It assumes grid = 1 and set_grid_parameters has been
@@ -1003,28 +1195,29 @@ int throw_away_unusables() {
 	    of a new implementation using core memory for b[6]
 	    coefficients, eliminating calls to temp file.
 	*/
-	qsort((char *)data, npoints, sizeof(struct MB_SURFACE_DATA), (void *)compare_points);
+	set_distances(ctx);
+	qsort((char *)ctx->data, ctx->npoints, sizeof(struct MB_SURFACE_DATA), compare_points);
 
 	/* If more than one datum is indexed to same node, only the first should be kept.
 	    Mark the additional ones as OUTSIDE
 	*/
 	int last_index = -1;
 	int n_outside = 0;
-	for (int k = 0; k < npoints; k++) {
-		if (data[k].index == last_index) {
-			data[k].index = OUTSIDE;
+	for (int k = 0; k < ctx->npoints; k++) {
+		if (ctx->data[k].index == last_index) {
+			ctx->data[k].index = OUTSIDE;
 			n_outside++;
 		}
 		else {
-			last_index = data[k].index;
+			last_index = ctx->data[k].index;
 		}
 	}
 	/* Sort again; this time the OUTSIDE points will be thrown away  */
-	qsort((char *)data, npoints, sizeof(struct MB_SURFACE_DATA), (void *)compare_points);
-	npoints -= n_outside;
-	status =
-	    mb_reallocd(local_verbose, __FILE__, __LINE__, npoints * sizeof(struct MB_SURFACE_DATA), (void **)&data, &local_error);
-	if (local_verbose && (n_outside)) {
+	qsort((char *)ctx->data, ctx->npoints, sizeof(struct MB_SURFACE_DATA), compare_points);
+	ctx->npoints -= n_outside;
+	ctx->status = mb_reallocd(ctx->local_verbose, __FILE__, __LINE__, MAX(ctx->npoints, 1) * sizeof(struct MB_SURFACE_DATA),
+	                          (void **)&ctx->data, &ctx->local_error);
+	if (ctx->local_verbose && (n_outside)) {
 		fprintf(stderr, "surface: %d unusable points were supplied; these will be ignored.\n", n_outside);
 		fprintf(stderr, "\tYou should have pre-processed the data with blockmean or blockmedian.\n");
 	}
@@ -1032,36 +1225,39 @@ int throw_away_unusables() {
 	return (0);
 }
 
-int rescale_z_values() {
+static int rescale_z_values(struct mb_surface_ctx *ctx) {
 	double ssz = 0.0;
 
-	for (int i = 0; i < npoints; i++) {
-		ssz += (data[i].z * data[i].z);
+	for (int i = 0; i < ctx->npoints; i++) {
+		ssz += (ctx->data[i].z * ctx->data[i].z);
 	}
 
 	/* Set z_scale = rms(z):  */
 
-	z_scale = sqrt(ssz / npoints);
-	r_z_scale = 1.0 / z_scale;
+	ctx->z_scale = sqrt(ssz / ctx->npoints);
+	ctx->r_z_scale = 1.0 / ctx->z_scale;
 
-	for (int i = 0; i < npoints; i++) {
-		data[i].z *= r_z_scale;
+	for (int i = 0; i < ctx->npoints; i++) {
+		ctx->data[i].z *= ctx->r_z_scale;
 	}
 	return (0);
 }
 
-void load_constraints(char *low, char *high) {
+static void load_constraints(struct mb_surface_ctx *ctx, char *low, char *high) {
 	(void)low;  // Unused parameter
 	(void)high;  // Unused parameter
 	/*	struct GRD_HEADER hdr;*/
 
 	/* Load lower/upper limits, verify range, deplane, and rescale */
 
-	if (set_low > 0) {
-		status = mb_mallocd(local_verbose, __FILE__, __LINE__, n_columns * n_rows * sizeof(float), (void **)&lower, &local_error);
-		if (set_low < 3)
-			for (int i = 0; i < n_columns * n_rows; i++)
-				lower[i] = low_limit;
+	if (ctx->set_low > 0) {
+		ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, ctx->n_columns * ctx->n_rows * sizeof(float),
+		                         (void **)&ctx->lower, &ctx->local_error);
+		if (ctx->status != MB_SUCCESS)
+			return;
+		if (ctx->set_low < 3)
+			for (int i = 0; i < ctx->n_columns * ctx->n_rows; i++)
+				ctx->lower[i] = ctx->low_limit;
 		/* Comment this out:
 		        else {
 		            if (read_grd_info (low, &hdr)) {
@@ -1085,21 +1281,24 @@ void load_constraints(char *low, char *high) {
 		        }
 		*/
 
-		for (int j = 0, ij = 0; j < n_rows; j++) {
-			const double yy = n_rows - j - 1;  // TODO(schwehr): Why is yy a double?
-			for (int i = 0; i < n_columns; i++, ij++) {
+		for (int j = 0, ij = 0; j < ctx->n_rows; j++) {
+			const double yy = ctx->n_rows - j - 1;  // TODO(schwehr): Why is yy a double?
+			for (int i = 0; i < ctx->n_columns; i++, ij++) {
 				/*if (GMT_is_fnan ((double)lower[ij])) continue;*/
-				lower[ij] -= (plane_c0 + plane_c1 * i + plane_c2 * yy);
-				lower[ij] *= r_z_scale;
+				ctx->lower[ij] -= (ctx->plane_c0 + ctx->plane_c1 * i + ctx->plane_c2 * yy);
+				ctx->lower[ij] *= ctx->r_z_scale;
 			}
 		}
-		constrained = TRUE;
+		ctx->constrained = TRUE;
 	}
-	if (set_high > 0) {
-		status = mb_mallocd(local_verbose, __FILE__, __LINE__, n_columns * n_rows * sizeof(float), (void **)&upper, &local_error);
-		if (set_high < 3)
-			for (int i = 0; i < n_columns * n_rows; i++)
-				upper[i] = high_limit;
+	if (ctx->set_high > 0) {
+		ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, ctx->n_columns * ctx->n_rows * sizeof(float),
+		                         (void **)&ctx->upper, &ctx->local_error);
+		if (ctx->status != MB_SUCCESS)
+			return;
+		if (ctx->set_high < 3)
+			for (int i = 0; i < ctx->n_columns * ctx->n_rows; i++)
+				ctx->upper[i] = ctx->high_limit;
 		/* Comment this out:
 		        else {
 		            if (read_grd_info (high, &hdr)) {
@@ -1122,19 +1321,19 @@ void load_constraints(char *low, char *high) {
 		            if (n_trimmed) fprintf (stderr, "surface: %d upper limit values < max data, reset to max data!\n");
 		        }
 		*/
-		for (int j = 0, ij = 0; j < n_rows; j++) {
-			const double yy = n_rows - j - 1;  // TODO(schwehr): Why is yy a double?
-			for (int i = 0; i < n_columns; i++, ij++) {
+		for (int j = 0, ij = 0; j < ctx->n_rows; j++) {
+			const double yy = ctx->n_rows - j - 1;  // TODO(schwehr): Why is yy a double?
+			for (int i = 0; i < ctx->n_columns; i++, ij++) {
 				/*if (GMT_is_fnan ((double)upper[ij])) continue;*/
-				upper[ij] -= (plane_c0 + plane_c1 * i + plane_c2 * yy);
-				upper[ij] *= r_z_scale;
+				ctx->upper[ij] -= (ctx->plane_c0 + ctx->plane_c1 * i + ctx->plane_c2 * yy);
+				ctx->upper[ij] *= ctx->r_z_scale;
 			}
 		}
-		constrained = TRUE;
+		ctx->constrained = TRUE;
 	}
 }
 
-int get_prime_factors(int n, int f[]) {
+static int get_prime_factors(int n, int f[]) {
 	/* Fills the integer array f with the prime factors of n.
 	 * Returns the number of locations filled in f, which is
 	 * one if n is prime.
@@ -1250,7 +1449,7 @@ int get_prime_factors(int n, int f[]) {
 // #define IABS(i) (((i) < 0) ? -(i) : (i))
 static int IABS(int i) {return i < 0 ? -i : i;}
 
-int gcd_euclid(int a, int b) {
+static int gcd_euclid(int a, int b) {
 	/* Returns the greatest common divisor of u and v by Euclid's method.
 	 * I have experimented also with Stein's method, which involves only
 	 * subtraction and left/right shifting; Euclid is faster, both for
@@ -1271,8 +1470,149 @@ int gcd_euclid(int a, int b) {
 	return (u);
 }
 
-int mb_surface(int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin, double xxmax, double yymin,
-               double yymax, double xxinc, double yyinc, double ttension, float *sgrid) {
+/*--------------------------------------------------------------------*/
+/* Fits a surface to the data using the state in ctx, which must be
+    zeroed on entry. Everything allocated here is freed before return. */
+static int surface_fit(struct mb_surface_ctx *ctx, int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin,
+                       double xxmax, double yymin, double yymax, double xxinc, double yyinc, double ttension, int nthreads,
+                       float *sgrid) {
+	/* set defaults */
+	ctx->max_iterations = 250;
+	ctx->local_error = MB_ERROR_NO_ERROR;
+	ctx->status = MB_SUCCESS;
+	ctx->epsilon = 1.0;
+	ctx->z_scale = 1.0;
+	ctx->r_z_scale = 1.0;
+	ctx->relax_new = 1.4;
+	ctx->mode_type[0] = 'I';
+	ctx->mode_type[1] = 'D';
+	ctx->nthreads = MAX(0, MIN(nthreads, MB_THREAD_MAX));
+
+	/* copy parameters */
+	ctx->xmin = xxmin;
+	ctx->xmax = xxmax;
+	ctx->ymin = yymin;
+	ctx->ymax = yymax;
+	ctx->xinc = xxinc;
+	ctx->yinc = yyinc;
+	ctx->tension = ttension;
+	ctx->total_iterations = 0;
+
+	/* set local verbose */
+	if (verbose > 0)
+		ctx->local_verbose = TRUE;
+	else
+		ctx->local_verbose = FALSE;
+
+	/* New in v4.3:  Default to unconstrained:  */
+	ctx->set_low = ctx->set_high = 0;
+
+	if (ctx->tension != 0.0) {
+		ctx->boundary_tension = ctx->tension;
+		ctx->interior_tension = ctx->tension;
+	}
+	ctx->relax_old = 1.0 - ctx->relax_new;
+
+	ctx->n_columns = rint((ctx->xmax - ctx->xmin) / ctx->xinc) + 1;
+	ctx->n_rows = rint((ctx->ymax - ctx->ymin) / ctx->yinc) + 1;
+	ctx->m_columns = ctx->n_columns + 4;
+	ctx->m_rows = ctx->n_rows + 4;
+	ctx->r_xinc = 1.0 / ctx->xinc;
+	ctx->r_yinc = 1.0 / ctx->yinc;
+
+	/* New idea: set grid = 1, read data, setting index.  Then throw
+	    away data that can't be used in end game, constraining
+	    size of briggs->b[6] structure.  */
+
+	ctx->grid = 1;
+	set_grid_parameters(ctx);
+	read_data(ctx, ndat, xdat, ydat, zdat);
+	if (ctx->status == MB_SUCCESS)
+		throw_away_unusables(ctx);
+	if (ctx->status == MB_SUCCESS) {
+		remove_planar_trend(ctx);
+		rescale_z_values(ctx);
+
+		char low[100];
+		char high[100];
+		load_constraints(ctx, low, high);
+	}
+
+	/* Set up factors and reset grid to first value  */
+	if (ctx->status == MB_SUCCESS) {
+		ctx->grid = gcd_euclid(ctx->n_columns - 1, ctx->n_rows - 1);
+		ctx->n_fact = get_prime_factors(ctx->grid, ctx->factors);
+		set_grid_parameters(ctx);
+		while (ctx->block_n_columns < 4 || ctx->block_n_rows < 4) {
+			smart_divide(ctx);
+			set_grid_parameters(ctx);
+		}
+		set_offset(ctx);
+		set_index(ctx);
+		/* Now the data are ready to go for the first iteration.  */
+
+		/* Allocate more space  */
+		ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, MAX(ctx->npoints, 1) * sizeof(struct MB_SURFACE_BRIGGS),
+		                         (void **)&ctx->briggs, &ctx->local_error);
+		if (ctx->status == MB_SUCCESS)
+			ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, ctx->m_columns * ctx->m_rows * sizeof(char),
+			                         (void **)&ctx->iu, &ctx->local_error);
+		if (ctx->status == MB_SUCCESS)
+			ctx->status = mb_mallocd(ctx->local_verbose, __FILE__, __LINE__, ctx->m_columns * ctx->m_rows * sizeof(float),
+			                         (void **)&ctx->u, &ctx->local_error);
+		if (ctx->status == MB_SUCCESS) {
+			memset(ctx->iu, 0, ctx->m_columns * ctx->m_rows * sizeof(char));
+			memset(ctx->u, 0, ctx->m_columns * ctx->m_rows * sizeof(float));
+		}
+	}
+
+	if (ctx->status == MB_SUCCESS) {
+		if (ctx->radius > 0)
+			initialize_grid(ctx); /* Fill in nodes with a weighted avg in a search radius  */
+
+		set_coefficients(ctx);
+
+		ctx->old_grid = ctx->grid;
+		find_nearest_point(ctx);
+		iterate(ctx, 1);
+
+		while (ctx->grid > 1 && ctx->status == MB_SUCCESS) {
+			smart_divide(ctx);
+			set_grid_parameters(ctx);
+			set_offset(ctx);
+			set_index(ctx);
+			fill_in_forecast(ctx);
+			iterate(ctx, 0);
+			ctx->old_grid = ctx->grid;
+			find_nearest_point(ctx);
+			iterate(ctx, 1);
+		}
+	}
+
+	if (ctx->status == MB_SUCCESS) {
+		if (ctx->local_verbose)
+			check_errors(ctx);
+
+		replace_planar_trend(ctx);
+
+		get_output(ctx, sgrid);
+	}
+
+	int error = MB_ERROR_NO_ERROR;
+	mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&ctx->data, &error);
+	mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&ctx->briggs, &error);
+	mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&ctx->iu, &error);
+	mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&ctx->u, &error);
+	mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&ctx->lower, &error);
+	mb_freed(ctx->local_verbose, __FILE__, __LINE__, (void **)&ctx->upper, &error);
+
+	return (ctx->status);
+}
+/*--------------------------------------------------------------------*/
+/* Fits the whole grid, relaxing it with nthreads threads; nthreads = 0
+    keeps the serial relaxation order of the original surface program */
+static int mb_surface_threaded(int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin, double xxmax,
+                               double yymin, double yymax, double xxinc, double yyinc, double ttension, int nthreads, float *sgrid) {
 	if (verbose >= 2) {
 		fprintf(stderr, "\ndbg2  MBBA function <%s> called\n", __func__);
 		fprintf(stderr, "dbg2  Input arguments:\n");
@@ -1282,147 +1622,366 @@ int mb_surface(int verbose, int ndat, float *xdat, float *ydat, float *zdat, dou
 		fprintf(stderr, "dbg2       yymin:      %f\n", yymin);
 		fprintf(stderr, "dbg2       yymax:      %f\n", yymax);
 		fprintf(stderr, "dbg2       xxinc:      %f\n", xxinc);
-		fprintf(stderr, "dbg2       xxinc:      %f\n", xxinc);
+		fprintf(stderr, "dbg2       yyinc:      %f\n", yyinc);
 		fprintf(stderr, "dbg2       ttension:   %f\n", ttension);
+		fprintf(stderr, "dbg2       nthreads:   %d\n", nthreads);
 		fprintf(stderr, "dbg2       ndat:       %d\n", ndat);
 		for (int i = 0; i < ndat; i++)
 			fprintf(stderr, "dbg2       data:       %f %f %f\n", xdat[i], ydat[i], zdat[i]);
 	}
 
-	/* copy parameters */
-	xmin = xxmin;
-	xmax = xxmax;
-	ymin = yymin;
-	ymax = yymax;
-	xinc = xxinc;
-	yinc = yyinc;
-	tension = ttension;
-	total_iterations = 0;
-
-	/* set local verbose */
-	if (verbose > 0)
-		local_verbose = TRUE;
-	else
-		local_verbose = FALSE;
-
-	/* New in v4.3:  Default to unconstrained:  */
-	set_low = set_high = 0;
-
-	// bool serror = false;
-	// if (xmin >= xmax || ymin >= ymax)
-	// 	serror = true;
-	// if (xinc <= 0.0 || yinc <= 0.0)
-	// 	serror = true;
-
-	if (tension != 0.0) {
-		boundary_tension = tension;
-		interior_tension = tension;
+	struct mb_surface_ctx *ctx = NULL;
+	int error = MB_ERROR_NO_ERROR;
+	int status = mb_mallocd(verbose, __FILE__, __LINE__, sizeof(struct mb_surface_ctx), (void **)&ctx, &error);
+	if (status == MB_SUCCESS) {
+		memset(ctx, 0, sizeof(struct mb_surface_ctx));
+		status = surface_fit(ctx, verbose, ndat, xdat, ydat, zdat, xxmin, xxmax, yymin, yymax, xxinc, yyinc, ttension, nthreads, sgrid);
+		error = ctx->local_error;
+		int free_error = MB_ERROR_NO_ERROR;
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&ctx, &free_error);
 	}
-	relax_old = 1.0 - relax_new;
 
-	n_columns = rint((xmax - xmin) / xinc) + 1;
-	n_rows = rint((ymax - ymin) / yinc) + 1;
-	m_columns = n_columns + 4;
-	m_rows = n_rows + 4;
-	r_xinc = 1.0 / xinc;
-	r_yinc = 1.0 / yinc;
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+		fprintf(stderr, "dbg2  Return values:\n");
+		fprintf(stderr, "dbg2       error:      %d\n", error);
+		const int n_columns = rint((xxmax - xxmin) / xxinc) + 1;
+		const int n_rows = rint((yymax - yymin) / yyinc) + 1;
+		for (int i = 0; status == MB_SUCCESS && i < n_columns * n_rows; i++)
+			fprintf(stderr, "dbg2       grid:       %d %f\n", i, sgrid[i]);
+		fprintf(stderr, "dbg2  Return status:\n");
+		fprintf(stderr, "dbg2       status:     %d\n", status);
+	}
 
-	/* New stuff here for v4.3:  Check out the grid dimensions:  */
-	grid = gcd_euclid(n_columns - 1, n_rows - 1);
+	return (status);
+}
+/*--------------------------------------------------------------------*/
+int mb_surface(int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin, double xxmax, double yymin,
+               double yymax, double xxinc, double yyinc, double ttension, float *sgrid) {
+	return (mb_surface_threaded(verbose, ndat, xdat, ydat, zdat, xxmin, xxmax, yymin, yymax, xxinc, yyinc, ttension, 0, sgrid));
+}
+/*--------------------------------------------------------------------*/
+/* Shared state of the threads fitting the tiles of mb_surface_tiled() */
+struct mb_surface_tiles {
+	int verbose;
+	float *xdat, *ydat, *zdat;
+	double xmin, ymax, xinc, yinc, tension;
+	int n_columns, n_rows;
+	int ntile_x, ntile_y;
+	int *core_x, *core_y; /* Tile core boundaries in nodes, ntile + 1 values each */
+	int half_overlap;     /* Half width of the blending zone in nodes */
+	int pad;              /* Nodes fit beyond the blending zone on every side */
+	int *tile_start;      /* Start of each tile in tile_index, ntile + 1 values */
+	int *tile_index;      /* Indices of the data points used by each tile */
+	float **tile_grid;    /* Blending region of each fitted tile */
+	int nthreads_tile;    /* Threads relaxing each tile */
+	int next_tile;
+	int status;
+	int error;
+	pthread_mutex_t mutex;
+};
 
-	/*
-	if (local_verbose || size_query || grid == 1) fprintf (stderr, "W: %.3lf E: %.3lf S: %.3lf N: %.3lf n_columns: %d n_rows: %d\n",
-	    xmin, xmax, ymin, ymax, n_columns, n_rows);
-	if (grid == 1) fprintf(stderr,"surface:  WARNING:  Your grid dimensions are mutually prime.\n");
-	if (grid == 1 || size_query) suggest_sizes_for_surface(n_columns-1, n_rows-1);
-	if (size_query) exit(0);
-	*/
+/* Returns the node range b0..b1 - 1 of the output grid that the tile with
+    core c[k] to c[k + 1] - 1 contributes to */
+static void tile_blend_range(const struct mb_surface_tiles *tiles, const int *c, int n, int k, int *b0, int *b1) {
+	*b0 = MAX(c[k] - tiles->half_overlap, 0);
+	*b1 = MIN(c[k + 1] + tiles->half_overlap, n);
+}
 
-	/* New idea: set grid = 1, read data, setting index.  Then throw
-	    away data that can't be used in end game, constraining
-	    size of briggs->b[6] structure.  */
+/* Returns the node range i0..i1 fit for the tile with core c[k] to
+    c[k + 1] - 1, padded beyond the blending zone and kept inside the grid
+    where possible, with a number of intervals that has small prime factors */
+static void tile_range(const struct mb_surface_tiles *tiles, const int *c, int n, int k, int *i0, int *i1) {
+	*i0 = MAX(c[k] - tiles->half_overlap - tiles->pad, 0);
+	*i1 = MIN(c[k + 1] + tiles->half_overlap + tiles->pad, n) - 1;
+	if (*i1 - *i0 > 16) {
+		const int length = 16 * ((*i1 - *i0 + 15) / 16);
+		if (*i0 + length > n - 1)
+			*i0 = MAX(n - 1 - length, 0);
+		*i1 = *i0 + length;
+	}
+}
 
-	grid = 1;
-	set_grid_parameters();
-	read_data(ndat, xdat, ydat, zdat);
-	throw_away_unusables();
-	remove_planar_trend();
-	rescale_z_values();
+/* Returns the blending weight of tile k at node n for core boundaries c */
+static double tile_weight(const struct mb_surface_tiles *tiles, const int *c, int ntile, int k, int n) {
+	const int h = tiles->half_overlap;
+	if (h > 0 && k > 0 && n < c[k] + h)
+		return ((n - (c[k] - h) + 0.5) / (2 * h));
+	if (h > 0 && k < ntile - 1 && n >= c[k + 1] - h)
+		return ((c[k + 1] + h - n - 0.5) / (2 * h));
+	return (1.0);
+}
 
-	char low[100];
-	char high[100];
-	load_constraints(low, high);
+static void *tile_thread(void *arg) {
+	struct mb_surface_tiles *tiles = (struct mb_surface_tiles *)arg;
+	float *xdat = NULL, *ydat = NULL, *zdat = NULL, *tgrid = NULL;
+	int ndat_alloc = 0;
+	int ngrid_alloc = 0;
+
+	while (TRUE) {
+		pthread_mutex_lock(&tiles->mutex);
+		const int itile = tiles->next_tile++;
+		const int done = (itile >= tiles->ntile_x * tiles->ntile_y || tiles->status != MB_SUCCESS);
+		pthread_mutex_unlock(&tiles->mutex);
+		if (done)
+			break;
+
+		const int kx = itile % tiles->ntile_x;
+		const int ky = itile / tiles->ntile_x;
+		int i0, i1, j0, j1, bi0, bi1, bj0, bj1;
+		tile_range(tiles, tiles->core_x, tiles->n_columns, kx, &i0, &i1);
+		tile_range(tiles, tiles->core_y, tiles->n_rows, ky, &j0, &j1);
+		tile_blend_range(tiles, tiles->core_x, tiles->n_columns, kx, &bi0, &bi1);
+		tile_blend_range(tiles, tiles->core_y, tiles->n_rows, ky, &bj0, &bj1);
+		const int tile_n_columns = i1 - i0 + 1;
+		const int tile_n_rows = j1 - j0 + 1;
+
+		/* gather the data of this tile */
+		const int ndat = tiles->tile_start[itile + 1] - tiles->tile_start[itile];
+		int status = MB_SUCCESS;
+		int error = MB_ERROR_NO_ERROR;
+		if (ndat > ndat_alloc) {
+			ndat_alloc = ndat;
+			status = mb_reallocd(tiles->verbose, __FILE__, __LINE__, ndat_alloc * sizeof(float), (void **)&xdat, &error);
+			if (status == MB_SUCCESS)
+				status = mb_reallocd(tiles->verbose, __FILE__, __LINE__, ndat_alloc * sizeof(float), (void **)&ydat, &error);
+			if (status == MB_SUCCESS)
+				status = mb_reallocd(tiles->verbose, __FILE__, __LINE__, ndat_alloc * sizeof(float), (void **)&zdat, &error);
+		}
+		if (status == MB_SUCCESS && tile_n_columns * tile_n_rows > ngrid_alloc) {
+			ngrid_alloc = tile_n_columns * tile_n_rows;
+			status = mb_reallocd(tiles->verbose, __FILE__, __LINE__, ngrid_alloc * sizeof(float), (void **)&tgrid, &error);
+		}
+		if (status == MB_SUCCESS)
+			status = mb_mallocd(tiles->verbose, __FILE__, __LINE__, (bi1 - bi0) * (bj1 - bj0) * sizeof(float),
+			                    (void **)&tiles->tile_grid[itile], &error);
+		if (status != MB_SUCCESS) {
+			pthread_mutex_lock(&tiles->mutex);
+			tiles->status = status;
+			tiles->error = error;
+			pthread_mutex_unlock(&tiles->mutex);
+			break;
+		}
+		for (int k = 0; k < ndat; k++) {
+			const int kk = tiles->tile_index[tiles->tile_start[itile] + k];
+			xdat[k] = tiles->xdat[kk];
+			ydat[k] = tiles->ydat[kk];
+			zdat[k] = tiles->zdat[kk];
+		}
 
-	/* Set up factors and reset grid to first value  */
+		/* fit the tile - node (i, j) of the output grid is at
+		    x = xmin + i * xinc, y = ymax - j * yinc */
+		struct mb_surface_ctx *ctx = NULL;
+		status = mb_mallocd(tiles->verbose, __FILE__, __LINE__, sizeof(struct mb_surface_ctx), (void **)&ctx, &error);
+		if (status == MB_SUCCESS) {
+			memset(ctx, 0, sizeof(struct mb_surface_ctx));
+			status = surface_fit(ctx, tiles->verbose, ndat, xdat, ydat, zdat, tiles->xmin + i0 * tiles->xinc,
+			                     tiles->xmin + i1 * tiles->xinc, tiles->ymax - j1 * tiles->yinc, tiles->ymax - j0 * tiles->yinc,
+			                     tiles->xinc, tiles->yinc, tiles->tension, tiles->nthreads_tile, tgrid);
+			error = ctx->local_error;
+			int free_error = MB_ERROR_NO_ERROR;
+			mb_freed(tiles->verbose, __FILE__, __LINE__, (void **)&ctx, &free_error);
+		}
+		if (status != MB_SUCCESS) {
+			pthread_mutex_lock(&tiles->mutex);
+			tiles->status = status;
+			tiles->error = error;
+			pthread_mutex_unlock(&tiles->mutex);
+			break;
+		}
 
-	grid = gcd_euclid(n_columns - 1, n_rows - 1);
-	n_fact = get_prime_factors(grid, factors);
-	set_grid_parameters();
-	while (block_n_columns < 4 || block_n_rows < 4) {
-		smart_divide();
-		set_grid_parameters();
+		/* keep the part of the tile that is blended into the output grid */
+		for (int j = bj0; j < bj1; j++)
+			memcpy(&tiles->tile_grid[itile][(j - bj0) * (bi1 - bi0)], &tgrid[(j - j0) * tile_n_columns + (bi0 - i0)],
+			       (bi1 - bi0) * sizeof(float));
 	}
-	set_offset();
-	set_index();
-	/* Now the data are ready to go for the first iteration.  */
-
-	/* Allocate more space  */
 
-	status =
-	    mb_mallocd(local_verbose, __FILE__, __LINE__, npoints * sizeof(struct MB_SURFACE_BRIGGS), (void **)&briggs, &local_error);
-	status = mb_mallocd(local_verbose, __FILE__, __LINE__, m_columns * m_rows * sizeof(char), (void **)&iu, &local_error);
-	status = mb_mallocd(local_verbose, __FILE__, __LINE__, m_columns * m_rows * sizeof(float), (void **)&u, &local_error);
+	int error = MB_ERROR_NO_ERROR;
+	mb_freed(tiles->verbose, __FILE__, __LINE__, (void **)&xdat, &error);
+	mb_freed(tiles->verbose, __FILE__, __LINE__, (void **)&ydat, &error);
+	mb_freed(tiles->verbose, __FILE__, __LINE__, (void **)&zdat, &error);
+	mb_freed(tiles->verbose, __FILE__, __LINE__, (void **)&tgrid, &error);
 
-	if (radius > 0)
-		initialize_grid(); /* Fill in nodes with a weighted avg in a search radius  */
-
-	/*
-	if (local_verbose) fprintf(stderr,"Grid\tMode\tIteration\tMax Change\tConv Limit\tTotal Iterations\n");
-	*/
+	return (NULL);
+}
 
-	set_coefficients();
+/*--------------------------------------------------------------------*/
+int mb_surface_tiled(int verbose, int ndat, float *xdat, float *ydat, float *zdat, double xxmin, double xxmax, double yymin,
+                     double yymax, double xxinc, double yyinc, double ttension, int tile_dim, int tile_overlap, int nthreads,
+                     float *sgrid) {
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBBA function <%s> called\n", __func__);
+		fprintf(stderr, "dbg2  Input arguments:\n");
+		fprintf(stderr, "dbg2       verbose:      %d\n", verbose);
+		fprintf(stderr, "dbg2       xxmin:        %f\n", xxmin);
+		fprintf(stderr, "dbg2       xxmax:        %f\n", xxmax);
+		fprintf(stderr, "dbg2       yymin:        %f\n", yymin);
+		fprintf(stderr, "dbg2       yymax:        %f\n", yymax);
+		fprintf(stderr, "dbg2       xxinc:        %f\n", xxinc);
+		fprintf(stderr, "dbg2       yyinc:        %f\n", yyinc);
+		fprintf(stderr, "dbg2       ttension:     %f\n", ttension);
+		fprintf(stderr, "dbg2       tile_dim:     %d\n", tile_dim);
+		fprintf(stderr, "dbg2       tile_overlap: %d\n", tile_overlap);
+		fprintf(stderr, "dbg2       nthreads:     %d\n", nthreads);
+		fprintf(stderr, "dbg2       ndat:         %d\n", ndat);
+	}
 
-	old_grid = grid;
-	find_nearest_point();
-	iterate(1);
+	struct mb_surface_tiles tiles;
+	memset(&tiles, 0, sizeof(tiles));
+	tiles.verbose = verbose;
+	tiles.xdat = xdat;
+	tiles.ydat = ydat;
+	tiles.zdat = zdat;
+	tiles.xmin = xxmin;
+	tiles.ymax = yymax;
+	tiles.xinc = xxinc;
+	tiles.yinc = yyinc;
+	tiles.tension = ttension;
+	tiles.n_columns = rint((xxmax - xxmin) / xxinc) + 1;
+	tiles.n_rows = rint((yymax - yymin) / yyinc) + 1;
+	tiles.status = MB_SUCCESS;
+	tiles.error = MB_ERROR_NO_ERROR;
+	nthreads = MAX(1, MIN(nthreads, MB_THREAD_MAX));
+
+	/* lay out the tiles - the cores partition the grid, each tile is
+	    blended over half the overlap beyond its core on every side, and
+	    fit over a further padding so that the fit is free of the tile
+	    edge effects where it is blended */
+	if (tile_dim <= 0)
+		tile_dim = MB_SURFACE_TILE_DIM;
+	if (tile_overlap <= 0)
+		tile_overlap = MB_SURFACE_TILE_OVERLAP;
+	tile_dim = MAX(tile_dim, 32);
+	tile_overlap = MIN(tile_overlap, tile_dim / 8);
+	tiles.half_overlap = tile_overlap / 2;
+	tiles.pad = 2 * tile_overlap;
+	const int core_dim = tile_dim - 2 * tiles.half_overlap - 2 * tiles.pad;
+	tiles.ntile_x = MAX(1, (tiles.n_columns + core_dim - 1) / core_dim);
+	tiles.ntile_y = MAX(1, (tiles.n_rows + core_dim - 1) / core_dim);
+	const int ntile = tiles.ntile_x * tiles.ntile_y;
+
+	/* a single tile is just a threaded fit of the whole grid */
+	if (ntile == 1)
+		return (mb_surface_threaded(verbose, ndat, xdat, ydat, zdat, xxmin, xxmax, yymin, yymax, xxinc, yyinc, ttension, nthreads,
+		                            sgrid));
+
+	int *tile_count = NULL;
+	tiles.status = mb_mallocd(verbose, __FILE__, __LINE__, (tiles.ntile_x + 1) * sizeof(int), (void **)&tiles.core_x, &tiles.error);
+	if (tiles.status == MB_SUCCESS)
+		tiles.status = mb_mallocd(verbose, __FILE__, __LINE__, (tiles.ntile_y + 1) * sizeof(int), (void **)&tiles.core_y, &tiles.error);
+	if (tiles.status == MB_SUCCESS)
+		tiles.status = mb_mallocd(verbose, __FILE__, __LINE__, (ntile + 1) * sizeof(int), (void **)&tiles.tile_start, &tiles.error);
+	if (tiles.status == MB_SUCCESS)
+		tiles.status = mb_mallocd(verbose, __FILE__, __LINE__, ntile * sizeof(int), (void **)&tile_count, &tiles.error);
+	if (tiles.status == MB_SUCCESS)
+		tiles.status = mb_mallocd(verbose, __FILE__, __LINE__, ntile * sizeof(float *), (void **)&tiles.tile_grid, &tiles.error);
+	if (tiles.status == MB_SUCCESS) {
+		memset(tiles.tile_start, 0, (ntile + 1) * sizeof(int));
+		memset(tile_count, 0, ntile * sizeof(int));
+		memset(tiles.tile_grid, 0, ntile * sizeof(float *));
+	}
 
-	while (grid > 1) {
-		smart_divide();
-		set_grid_parameters();
-		set_offset();
-		set_index();
-		fill_in_forecast();
-		iterate(0);
-		old_grid = grid;
-		find_nearest_point();
-		iterate(1);
+	if (tiles.status == MB_SUCCESS) {
+		for (int k = 0; k <= tiles.ntile_x; k++)
+			tiles.core_x[k] = (int)(((long)k * tiles.n_columns) / tiles.ntile_x);
+		for (int k = 0; k <= tiles.ntile_y; k++)
+			tiles.core_y[k] = (int)(((long)k * tiles.n_rows) / tiles.ntile_y);
+
+		/* bucket the data by tile, counting first and then filling,
+		    keeping points within one node of each tile */
+		const int reach = (tiles.half_overlap + tiles.pad) / MAX(core_dim, 1) + 2;
+		for (int pass = 0; pass < 2 && tiles.status == MB_SUCCESS; pass++) {
+			for (int k = 0; k < ndat; k++) {
+				const double di = (xdat[k] - xxmin) / xxinc;
+				const double dj = (yymax - ydat[k]) / yyinc;
+				const int gx = MIN(MAX((int)(di * tiles.ntile_x / tiles.n_columns), 0), tiles.ntile_x - 1);
+				const int gy = MIN(MAX((int)(dj * tiles.ntile_y / tiles.n_rows), 0), tiles.ntile_y - 1);
+				for (int ky = MAX(gy - reach, 0); ky <= MIN(gy + reach, tiles.ntile_y - 1); ky++) {
+					int j0, j1;
+					tile_range(&tiles, tiles.core_y, tiles.n_rows, ky, &j0, &j1);
+					if (dj < j0 - 1 || dj > j1 + 1)
+						continue;
+					for (int kx = MAX(gx - reach, 0); kx <= MIN(gx + reach, tiles.ntile_x - 1); kx++) {
+						int i0, i1;
+						tile_range(&tiles, tiles.core_x, tiles.n_columns, kx, &i0, &i1);
+						if (di < i0 - 1 || di > i1 + 1)
+							continue;
+						const int itile = ky * tiles.ntile_x + kx;
+						if (pass == 0)
+							tiles.tile_start[itile + 1]++;
+						else
+							tiles.tile_index[tiles.tile_start[itile] + tile_count[itile]++] = k;
+					}
+				}
+			}
+			if (pass == 0) {
+				for (int itile = 0; itile < ntile; itile++)
+					tiles.tile_start[itile + 1] += tiles.tile_start[itile];
+				tiles.status = mb_mallocd(verbose, __FILE__, __LINE__, MAX(tiles.tile_start[ntile], 1) * sizeof(int),
+				                          (void **)&tiles.tile_index, &tiles.error);
+			}
+		}
 	}
 
-	if (local_verbose)
-		check_errors();
+	/* fit the tiles in parallel, splitting any threads left over
+	    between the tiles */
+	if (tiles.status == MB_SUCCESS) {
+		const int nthreads_tile = MIN(nthreads, ntile);
+		tiles.nthreads_tile = MAX(1, nthreads / nthreads_tile);
+		pthread_mutex_init(&tiles.mutex, NULL);
+		pthread_t thread_ids[MB_THREAD_MAX];
+		for (int i = 1; i < nthreads_tile; i++)
+			pthread_create(&thread_ids[i], NULL, tile_thread, &tiles);
+		tile_thread(&tiles);
+		for (int i = 1; i < nthreads_tile; i++)
+			pthread_join(thread_ids[i], NULL);
+		pthread_mutex_destroy(&tiles.mutex);
+	}
 
-	replace_planar_trend();
+	/* blend the tiles into the output grid in tile order, so that the
+	    result does not depend on the order the tiles were fit in - the
+	    weights of overlapping tiles sum to one */
+	if (tiles.status == MB_SUCCESS) {
+		memset(sgrid, 0, tiles.n_columns * tiles.n_rows * sizeof(float));
+		for (int itile = 0; itile < ntile; itile++) {
+			const int kx = itile % tiles.ntile_x;
+			const int ky = itile / tiles.ntile_x;
+			int bi0, bi1, bj0, bj1;
+			tile_blend_range(&tiles, tiles.core_x, tiles.n_columns, kx, &bi0, &bi1);
+			tile_blend_range(&tiles, tiles.core_y, tiles.n_rows, ky, &bj0, &bj1);
+			const float *tgrid = tiles.tile_grid[itile];
+			for (int j = bj0; j < bj1; j++) {
+				const double wy = tile_weight(&tiles, tiles.core_y, tiles.ntile_y, ky, j);
+				for (int i = bi0; i < bi1; i++) {
+					const double w = wy * tile_weight(&tiles, tiles.core_x, tiles.ntile_x, kx, i);
+					sgrid[j * tiles.n_columns + i] += w * tgrid[(j - bj0) * (bi1 - bi0) + (i - bi0)];
+				}
+			}
+		}
+	}
 
-	get_output(sgrid);
+	int error = MB_ERROR_NO_ERROR;
+	mb_freed(verbose, __FILE__, __LINE__, (void **)&tiles.core_x, &error);
+	mb_freed(verbose, __FILE__, __LINE__, (void **)&tiles.core_y, &error);
+	mb_freed(verbose, __FILE__, __LINE__, (void **)&tiles.tile_start, &error);
+	mb_freed(verbose, __FILE__, __LINE__, (void **)&tiles.tile_index, &error);
+	mb_freed(verbose, __FILE__, __LINE__, (void **)&tile_count, &error);
+	for (int itile = 0; tiles.tile_grid != NULL && itile < ntile; itile++)
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&tiles.tile_grid[itile], &error);
+	mb_freed(verbose, __FILE__, __LINE__, (void **)&tiles.tile_grid, &error);
 
-	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&data, &local_error);
-	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&briggs, &local_error);
-	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&iu, &local_error);
-	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&u, &local_error);
-	if (set_low)
-		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&lower, &local_error);
-	if (set_high)
-		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&upper, &local_error);
+	const int status = tiles.status;
 
 	if (verbose >= 2) {
 		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
 		fprintf(stderr, "dbg2  Return values:\n");
-		fprintf(stderr, "dbg2       error:      %d\n", local_error);
-		for (int i = 0; i < m_columns * m_rows; i++)
-			fprintf(stderr, "dbg2       grid:       %d %f\n", i, sgrid[i]);
+		fprintf(stderr, "dbg2       ntile_x:    %d\n", tiles.ntile_x);
+		fprintf(stderr, "dbg2       ntile_y:    %d\n", tiles.ntile_y);
+		fprintf(stderr, "dbg2       error:      %d\n", tiles.error);
 		fprintf(stderr, "dbg2  Return status:\n");
 		fprintf(stderr, "dbg2       status:     %d\n", status);
 	}
 
 	return (status);
 }
+/*--------------------------------------------------------------------*/
@@ -66,6 +66,8 @@
 #define MBEV_ALLOCK_NUM 1024
 #define MBEV_NODATA -10000000.0
 #define MBEV_NUM_ESF_OPEN_MAX 25
+#define MBEV_GRID_CELL_DIRTY 0x01
+#define MBEV_GRID_CELL_STALE 0x02
 
 typedef enum {
      MBEV_GRID_ALGORITHM_SIMPLEMEAN = 0,
@@ -203,8 +205,21 @@ struct mbev_grid_struct {
         /// Value denoting 'no data'
 	float nodatavalue;
 
-	float *sum;
-	float *wgt;
+        /// Per cell accumulators of the weighted depths, the weights, the
+        /// weighted squared depths and the number of contributing soundings,
+        /// so that edits and bias changes only adjust the affected cells
+	double *sum;
+	double *wgt;
+	double *sum2;
+	int *num;
+
+        /// Cells whose accumulators changed since their values were calculated
+        /// (MBEV_GRID_CELL_DIRTY) or, for the shoal bias algorithm, that lost
+        /// their shoalest sounding and must be regridded (MBEV_GRID_CELL_STALE)
+	char *cellflag;
+	int *dirty;
+	int num_dirty;
+	int num_stale;
 
         /// Depth values
   	float *val;
@@ -340,6 +355,7 @@ int mbeditviz_make_grid(void);
 int mbeditviz_grid_beam(struct mbev_file_struct *file, struct mbev_ping_struct *ping, int ibeam,
                         bool beam_ok, bool apply_now);
 
+int mbeditviz_update_grid(void);
 int mbeditviz_make_grid_simple(void);
 int mbeditviz_destroy_grid(void);
 int mbeditviz_selectregion(size_t instance);
@@ -354,12 +370,6 @@ void mbeditviz_mb3dsoundings_flagsparsevoxels(int sizemultiplier, int nsoundingt
 void mbeditviz_mb3dsoundings_colorsoundings(int color);
 void mbeditviz_mb3dsoundings_optimizebiasvalues(int mode, double *rollbias, double *pitchbias, double *headingbias,
                                                 double *timelag, double *snell);
-void mbeditviz_mb3dsoundings_getbiasvariance(double local_grid_xmin, double local_grid_xmax, double local_grid_ymin,
-                                             double local_grid_ymax, int local_grid_nx, int local_grid_ny, double local_grid_dx,
-                                             double local_grid_dy, double *local_grid_first, double *local_grid_sum,
-                                             double *local_grid_sum2, double *local_grid_variance, int *local_grid_num,
-                                             double rollbias, double pitchbias, double headingbias, double timelag, double snell,
-                                             int *variance_total_num, double *variance_total);
 
 void BxUnmanageCB(Widget w, XtPointer client, XtPointer call);
 void BxManageCB(Widget w, XtPointer client, XtPointer call);
@@ -24,6 +24,7 @@
 
 #include <ctype.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -145,6 +146,12 @@ int mbeditviz_init(int argc, char **argv,
   mbev_grid.nodatavalue = 0.0;
   mbev_grid.sum = NULL;
   mbev_grid.wgt = NULL;
+  mbev_grid.sum2 = NULL;
+  mbev_grid.num = NULL;
+  mbev_grid.cellflag = NULL;
+  mbev_grid.dirty = NULL;
+  mbev_grid.num_dirty = 0;
+  mbev_grid.num_stale = 0;
   mbev_grid.val = NULL;
   mbev_grid.sgm = NULL;
   for (int i = 0; i < 4; i++) {
@@ -1683,20 +1690,12 @@ int mbeditviz_load_file(int ifile, bool assertLock) {
   return (mbev_status);
 }
 /*--------------------------------------------------------------------*/
-int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_ping_struct *ping, double rollbias, double pitchbias,
-                            double headingbias, double timelag, double *heading, double *sonardepth, double *rolldelta,
-                            double *pitchdelta) {
-  if (mbev_verbose >= 2) {
-    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
-    fprintf(stderr, "dbg2  Input arguments:\n");
-    fprintf(stderr, "dbg2       file:        %p\n", file);
-    fprintf(stderr, "dbg2       ping:        %p\n", ping);
-    fprintf(stderr, "dbg2       rollbias:    %f\n", rollbias);
-    fprintf(stderr, "dbg2       pitchbias:   %f\n", pitchbias);
-    fprintf(stderr, "dbg2       headingbias: %f\n", headingbias);
-    fprintf(stderr, "dbg2       timelag:     %f\n", timelag);
-  }
-
+/* Interpolate the attitude, heading and sonar depth of a ping at a time lag
+   and combine them with bias values; this touches no globals beyond reading
+   the verbosity, so it can be used from the bias optimization threads. */
+static void mbeditviz_bias_attitude(struct mbev_file_struct *file, struct mbev_ping_struct *ping, double rollbias, double pitchbias,
+                                    double headingbias, double timelag, double *heading, double *sonardepth, double *rolldelta,
+                                    double *pitchdelta, int *error) {
   double time_d;
   int iheading = 0;
   int isonardepth = 0;
@@ -1712,7 +1711,7 @@ int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_
     // int intstat;
     if (timelag != 0.0 && file->n_async_sonardepth > 0) {
       /* intstat = */ mb_linear_interp(mbev_verbose, file->async_sonardepth_time_d - 1, file->async_sonardepth_sonardepth - 1,
-                                 file->n_async_sonardepth, time_d, sonardepth, &isonardepth, &mbev_error);
+                                 file->n_async_sonardepth, time_d, sonardepth, &isonardepth, error);
     }
     else {
       *sonardepth = ping->sonardepth;
@@ -1721,7 +1720,7 @@ int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_
     /* if asyncronous heading available, interpolate new value */
     if (timelag != 0.0 && file->n_async_heading > 0) {
       /* intstat = */ mb_linear_interp_heading(mbev_verbose, file->async_heading_time_d - 1, file->async_heading_heading - 1,
-                                         file->n_async_heading, time_d, &headingasync, &iheading, &mbev_error);
+                                         file->n_async_heading, time_d, &headingasync, &iheading, error);
     }
     else {
       headingasync = ping->heading;
@@ -1730,9 +1729,9 @@ int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_
     /* if asynchronous roll and pitch available, interpolate new values */
     if (timelag != 0.0 && file->n_async_attitude > 0) {
       /* intstat = */ mb_linear_interp(mbev_verbose, file->async_attitude_time_d - 1, file->async_attitude_roll - 1,
-                                 file->n_async_attitude, time_d, &rollasync, &iattitude, &mbev_error);
+                                 file->n_async_attitude, time_d, &rollasync, &iattitude, error);
       /* intstat = */ mb_linear_interp(mbev_verbose, file->async_attitude_time_d - 1, file->async_attitude_pitch - 1,
-                                 file->n_async_attitude, time_d, &pitchasync, &iattitude, &mbev_error);
+                                 file->n_async_attitude, time_d, &pitchasync, &iattitude, error);
     }
     else {
       rollasync = ping->roll;
@@ -1745,7 +1744,7 @@ int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_
         rollbias, pitchbias, headingbias,           // In: New Bias to apply
         rollasync, pitchasync, headingasync,        // In: New nav attitude to apply
         rolldelta, pitchdelta, heading,             // Out: Calculated rolldelta, pitchdelta and heading
-        &mbev_error);
+        error);
 
     /*
     fprintf(stderr,"sonardepth: %f %f   %f %d\n", *sonardepth, ping->sonardepth,*sonardepth-ping->sonardepth, isonardepth);
@@ -1754,6 +1753,24 @@ int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_
     iattitude); fprintf(stderr,"pitchdelta: %f %f   pitch:%f %f   %d\n", *pitchdelta, pitchbias, pitchasync, ping->pitch,
     iattitude);*/
   }
+}
+/*--------------------------------------------------------------------*/
+int mbeditviz_apply_biasesandtimelag(struct mbev_file_struct *file, struct mbev_ping_struct *ping, double rollbias, double pitchbias,
+                            double headingbias, double timelag, double *heading, double *sonardepth, double *rolldelta,
+                            double *pitchdelta) {
+  if (mbev_verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       file:        %p\n", file);
+    fprintf(stderr, "dbg2       ping:        %p\n", ping);
+    fprintf(stderr, "dbg2       rollbias:    %f\n", rollbias);
+    fprintf(stderr, "dbg2       pitchbias:   %f\n", pitchbias);
+    fprintf(stderr, "dbg2       headingbias: %f\n", headingbias);
+    fprintf(stderr, "dbg2       timelag:     %f\n", timelag);
+  }
+
+  mbeditviz_bias_attitude(file, ping, rollbias, pitchbias, headingbias, timelag, heading, sonardepth, rolldelta, pitchdelta,
+                          &mbev_error);
 
   if (mbev_verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
@@ -2401,6 +2418,31 @@ int mbeditviz_get_grid_bounds() {
   return (mbev_status);
 }
 
+/*--------------------------------------------------------------------*/
+static int mbeditviz_alloc_grid() {
+  const size_t ncells = (size_t)mbev_grid.n_columns * mbev_grid.n_rows;
+  if ((mbev_grid.sum = (double *)calloc(ncells, sizeof(double))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.wgt = (double *)calloc(ncells, sizeof(double))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.sum2 = (double *)calloc(ncells, sizeof(double))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.num = (int *)calloc(ncells, sizeof(int))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.cellflag = (char *)calloc(ncells, sizeof(char))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.dirty = (int *)malloc(ncells * sizeof(int))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.val = (float *)calloc(ncells, sizeof(float))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  if ((mbev_grid.sgm = (float *)calloc(ncells, sizeof(float))) == NULL)
+    mbev_error = MB_ERROR_MEMORY_FAIL;
+  mbev_grid.num_dirty = 0;
+  mbev_grid.num_stale = 0;
+
+  return (mbev_error == MB_ERROR_NO_ERROR ? MB_SUCCESS : MB_FAILURE);
+}
+
 /*--------------------------------------------------------------------*/
 int mbeditviz_setup_grid() {
   if (mbev_verbose >= 2) {
@@ -2497,24 +2539,8 @@ int mbeditviz_setup_grid() {
   }
 
   /* allocate memory for grid */
-  if (mbev_status == MB_SUCCESS) {
-    if ((mbev_grid.sum = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if ((mbev_grid.wgt = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if ((mbev_grid.val = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if ((mbev_grid.sgm = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if (mbev_error == MB_ERROR_NO_ERROR) {
-      memset(mbev_grid.sum, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-      memset(mbev_grid.wgt, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-      memset(mbev_grid.val, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-      memset(mbev_grid.sgm, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-    }
-    else
-      mbev_status = MB_FAILURE;
-  }
+  if (mbev_status == MB_SUCCESS)
+    mbev_status = mbeditviz_alloc_grid();
 
   if (mbev_verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
@@ -2594,11 +2620,15 @@ int mbeditviz_make_grid() {
     fprintf(stderr, "Algorithm: Shoal Bias\n");
   fprintf(stderr, "Interpolation: %d\n\n", mbev_grid_interpolation);
 
-  /* zero the grid arrays */
-  memset(mbev_grid.sum, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-  memset(mbev_grid.wgt, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-  /* memset(mbev_grid.val, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));*/
-  memset(mbev_grid.sgm, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
+  /* zero the grid accumulators */
+  const size_t ncells = (size_t)mbev_grid.n_columns * mbev_grid.n_rows;
+  memset(mbev_grid.sum, 0, ncells * sizeof(double));
+  memset(mbev_grid.wgt, 0, ncells * sizeof(double));
+  memset(mbev_grid.sum2, 0, ncells * sizeof(double));
+  memset(mbev_grid.num, 0, ncells * sizeof(int));
+  memset(mbev_grid.cellflag, 0, ncells * sizeof(char));
+  mbev_grid.num_dirty = 0;
+  mbev_grid.num_stale = 0;
 
   /* loop over loaded files */
   int filecount = 0;
@@ -2618,14 +2648,20 @@ int mbeditviz_make_grid() {
       }
     }
   }
+
+  /* every cell is calculated below */
+  memset(mbev_grid.cellflag, 0, ncells * sizeof(char));
+  mbev_grid.num_dirty = 0;
+
   mbev_grid.nodatavalue = MBEV_NODATA;
   bool first = true;
   for (int i = 0; i < mbev_grid.n_columns; i++)
     for (int j = 0; j < mbev_grid.n_rows; j++) {
       const int k = i * mbev_grid.n_rows + j;
       if (mbev_grid.wgt[k] > 0.0) {
-        mbev_grid.val[k] = mbev_grid.sum[k] / mbev_grid.wgt[k];
-        mbev_grid.sgm[k] = sqrt(fabs(mbev_grid.sgm[k] / mbev_grid.wgt[k] - mbev_grid.val[k] * mbev_grid.val[k]));
+        const double mean = mbev_grid.sum[k] / mbev_grid.wgt[k];
+        mbev_grid.val[k] = mean;
+        mbev_grid.sgm[k] = sqrt(fabs(mbev_grid.sum2[k] / mbev_grid.wgt[k] - mean * mean));
         if (first) {
           mbev_grid.min = mbev_grid.val[k];
           mbev_grid.max = mbev_grid.val[k];
@@ -2659,6 +2695,96 @@ int mbeditviz_make_grid() {
   return (mbev_status);
 }
 
+/*--------------------------------------------------------------------*/
+/* Recalculate one grid cell from its accumulators. */
+static void mbeditviz_grid_cell(int kk) {
+  if (mbev_grid.wgt[kk] > 0.0) {
+    const double mean = mbev_grid.sum[kk] / mbev_grid.wgt[kk];
+    mbev_grid.val[kk] = mean;
+    mbev_grid.sgm[kk] = sqrt(fabs(mbev_grid.sum2[kk] / mbev_grid.wgt[kk] - mean * mean));
+    mbev_grid.min = MIN(mbev_grid.min, mbev_grid.val[kk]);
+    mbev_grid.max = MAX(mbev_grid.max, mbev_grid.val[kk]);
+    mbev_grid.smin = MIN(mbev_grid.smin, mbev_grid.sgm[kk]);
+    mbev_grid.smax = MAX(mbev_grid.smax, mbev_grid.sgm[kk]);
+  }
+  else {
+    mbev_grid.val[kk] = mbev_grid.nodatavalue;
+    mbev_grid.sgm[kk] = mbev_grid.nodatavalue;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* Add (beam_ok) or remove a weighted sounding from the accumulators of a cell.
+   A cell left without soundings is zeroed so that rounding errors from
+   repeated additions and removals cannot accumulate. */
+static void mbeditviz_grid_accumulate(int i, int j, double weight, double z, bool beam_ok) {
+  const int kk = i * mbev_grid.n_rows + j;
+  if (beam_ok) {
+    mbev_grid.wgt[kk] += weight;
+    mbev_grid.sum[kk] += weight * z;
+    mbev_grid.sum2[kk] += weight * z * z;
+    mbev_grid.num[kk]++;
+  }
+  else if (mbev_grid.num[kk] <= 1) {
+    mbev_grid.wgt[kk] = 0.0;
+    mbev_grid.sum[kk] = 0.0;
+    mbev_grid.sum2[kk] = 0.0;
+    mbev_grid.num[kk] = 0;
+  }
+  else {
+    mbev_grid.wgt[kk] -= weight;
+    mbev_grid.sum[kk] -= weight * z;
+    mbev_grid.sum2[kk] -= weight * z * z;
+    mbev_grid.num[kk]--;
+    if (mbev_grid.wgt[kk] < MBEV_GRID_WEIGHT_TINY)
+      mbev_grid.wgt[kk] = 0.0;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* Add or remove a sounding from a shoal bias cell, which holds the shoalest
+   sounding. Removing the shoalest sounding of a cell that still has others
+   marks the cell stale to be regridded by mbeditviz_update_grid(). */
+static void mbeditviz_grid_shoal(int i, int j, double z, bool beam_ok) {
+  const int kk = i * mbev_grid.n_rows + j;
+  if (beam_ok) {
+    if (mbev_grid.num[kk] == 0 || z > mbev_grid.sum[kk]) {
+      mbev_grid.wgt[kk] = 1.0;
+      mbev_grid.sum[kk] = z;
+      mbev_grid.sum2[kk] = z * z;
+    }
+    mbev_grid.num[kk]++;
+  }
+  else if (mbev_grid.num[kk] <= 1) {
+    mbev_grid.wgt[kk] = 0.0;
+    mbev_grid.sum[kk] = 0.0;
+    mbev_grid.sum2[kk] = 0.0;
+    mbev_grid.num[kk] = 0;
+  }
+  else {
+    mbev_grid.num[kk]--;
+    if (z >= mbev_grid.sum[kk] && !(mbev_grid.cellflag[kk] & MBEV_GRID_CELL_STALE)) {
+      mbev_grid.cellflag[kk] |= MBEV_GRID_CELL_STALE;
+      mbev_grid.num_stale++;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* Recalculate a changed cell and show it now, or queue it for
+   mbeditviz_update_grid(). */
+static void mbeditviz_grid_touch(int i, int j, bool apply_now) {
+  const int kk = i * mbev_grid.n_rows + j;
+  if (apply_now && !(mbev_grid.cellflag[kk] & MBEV_GRID_CELL_STALE)) {
+    mbeditviz_grid_cell(kk);
+    mbview_updateprimarygridcell(mbev_verbose, 0, i, j, mbev_grid.val[kk], &mbev_error);
+  }
+  else if (!(mbev_grid.cellflag[kk] & MBEV_GRID_CELL_DIRTY)) {
+    mbev_grid.cellflag[kk] |= MBEV_GRID_CELL_DIRTY;
+    mbev_grid.dirty[mbev_grid.num_dirty++] = kk;
+  }
+}
+
 /*--------------------------------------------------------------------*/
 int mbeditviz_grid_beam(struct mbev_file_struct *file, struct mbev_ping_struct *ping, int ibeam,
                         bool beam_ok,
@@ -2687,97 +2813,26 @@ int mbeditviz_grid_beam(struct mbev_file_struct *file, struct mbev_ping_struct *
     int foot_wix, foot_wiy, foot_lix, foot_liy, foot_dix, foot_diy;
     int ix1, ix2, iy1, iy2;
 
+    if (isnan(ping->bathcorr[ibeam])) {
+      fprintf(stderr, "\nFunction mbeditviz_grid_beam(): Encountered NaN value in swath data from file: %s\n",
+              file->path);
+      fprintf(stderr, "     Ping time: %4.4d/%2.2d/%2.2d %2.2d:%2.2d:%2.2d.%6.6d\n", ping->time_i[0], ping->time_i[1],
+              ping->time_i[2], ping->time_i[3], ping->time_i[4], ping->time_i[5], ping->time_i[6]);
+      fprintf(stderr, "     Beam bathymetry: beam:%d flag:%d bath:<%f %f> acrosstrack:%f alongtrack:%f\n", ibeam,
+              ping->beamflag[ibeam], ping->bath[ibeam], ping->bathcorr[ibeam], ping->bathacrosstrack[ibeam],
+              ping->bathalongtrack[ibeam]);
+    }
+
     /* shoal bias gridding mode */
     if (mbev_grid_algorithm == MBEV_GRID_ALGORITHM_SHOALBIAS) {
-      /* get location in grid arrays */
-      const int kk = i * mbev_grid.n_rows + j;
-
-      if (isnan(ping->bathcorr[ibeam])) {
-        fprintf(stderr, "\nFunction mbeditviz_grid_beam(): Encountered NaN value in swath data from file: %s\n",
-                file->path);
-        fprintf(stderr, "     Ping time: %4.4d/%2.2d/%2.2d %2.2d:%2.2d:%2.2d.%6.6d\n", ping->time_i[0], ping->time_i[1],
-                ping->time_i[2], ping->time_i[3], ping->time_i[4], ping->time_i[5], ping->time_i[6]);
-        fprintf(stderr, "     Beam bathymetry: beam:%d flag:%d bath:<%f %f> acrosstrack:%f alongtrack:%f\n", ibeam,
-                ping->beamflag[ibeam], ping->bath[ibeam], ping->bathcorr[ibeam], ping->bathacrosstrack[ibeam],
-                ping->bathalongtrack[ibeam]);
-      }
-
-      /* add to weights and sums */
-      if (beam_ok && (-ping->bathcorr[ibeam]) >  mbev_grid.sum[kk]) {
-        mbev_grid.wgt[kk] = 1.0;
-        mbev_grid.sum[kk] = (-ping->bathcorr[ibeam]);
-        mbev_grid.sgm[kk] = ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
-      }
-
-      /* recalculate grid cell if desired */
-      if (apply_now) {
-        /* recalculate grid cell */
-        if (mbev_grid.wgt[kk] > 0.0) {
-          mbev_grid.val[kk] = mbev_grid.sum[kk] / mbev_grid.wgt[kk];
-          mbev_grid.sgm[kk] = sqrt(fabs(mbev_grid.sgm[kk] / mbev_grid.wgt[kk] - mbev_grid.val[kk] * mbev_grid.val[kk]));
-          mbev_grid.min = MIN(mbev_grid.min, mbev_grid.val[kk]);
-          mbev_grid.max = MAX(mbev_grid.max, mbev_grid.val[kk]);
-          mbev_grid.smin = MIN(mbev_grid.smin, mbev_grid.sgm[kk]);
-          mbev_grid.smax = MAX(mbev_grid.smax, mbev_grid.sgm[kk]);
-        }
-        else {
-          mbev_grid.val[kk] = mbev_grid.nodatavalue;
-          mbev_grid.sgm[kk] = mbev_grid.nodatavalue;
-        }
-
-        /* update grid in mbview display */
-        mbview_updateprimarygridcell(mbev_verbose, 0, i, j, mbev_grid.val[kk], &mbev_error);
-      }
+      mbeditviz_grid_shoal(i, j, -ping->bathcorr[ibeam], beam_ok);
+      mbeditviz_grid_touch(i, j, apply_now);
     }
 
     /* simple gridding mode */
     else if (file->topo_type != MB_TOPOGRAPHY_TYPE_MULTIBEAM || mbev_grid_algorithm == MBEV_GRID_ALGORITHM_SIMPLEMEAN) {
-      /* get location in grid arrays */
-      const int kk = i * mbev_grid.n_rows + j;
-
-      if (isnan(ping->bathcorr[ibeam])) {
-        fprintf(stderr, "\nFunction mbeditviz_grid_beam(): Encountered NaN value in swath data from file: %s\n",
-                file->path);
-        fprintf(stderr, "     Ping time: %4.4d/%2.2d/%2.2d %2.2d:%2.2d:%2.2d.%6.6d\n", ping->time_i[0], ping->time_i[1],
-                ping->time_i[2], ping->time_i[3], ping->time_i[4], ping->time_i[5], ping->time_i[6]);
-        fprintf(stderr, "     Beam bathymetry: beam:%d flag:%d bath:<%f %f> acrosstrack:%f alongtrack:%f\n", ibeam,
-                ping->beamflag[ibeam], ping->bath[ibeam], ping->bathcorr[ibeam], ping->bathacrosstrack[ibeam],
-                ping->bathalongtrack[ibeam]);
-      }
-
-      /* add to weights and sums */
-      if (beam_ok) {
-        mbev_grid.wgt[kk] += 1.0;
-        mbev_grid.sum[kk] += (-ping->bathcorr[ibeam]);
-        mbev_grid.sgm[kk] += ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
-      }
-      else {
-        mbev_grid.wgt[kk] -= 1.0;
-        mbev_grid.sum[kk] -= (-ping->bathcorr[ibeam]);
-        mbev_grid.sgm[kk] -= ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
-        if (mbev_grid.wgt[kk] < MBEV_GRID_WEIGHT_TINY)
-          mbev_grid.wgt[kk] = 0.0;
-      }
-
-      /* recalculate grid cell if desired */
-      if (apply_now) {
-        /* recalculate grid cell */
-        if (mbev_grid.wgt[kk] > 0.0) {
-          mbev_grid.val[kk] = mbev_grid.sum[kk] / mbev_grid.wgt[kk];
-          mbev_grid.sgm[kk] = sqrt(fabs(mbev_grid.sgm[kk] / mbev_grid.wgt[kk] - mbev_grid.val[kk] * mbev_grid.val[kk]));
-          mbev_grid.min = MIN(mbev_grid.min, mbev_grid.val[kk]);
-          mbev_grid.max = MAX(mbev_grid.max, mbev_grid.val[kk]);
-          mbev_grid.smin = MIN(mbev_grid.smin, mbev_grid.sgm[kk]);
-          mbev_grid.smax = MAX(mbev_grid.smax, mbev_grid.sgm[kk]);
-        }
-        else {
-          mbev_grid.val[kk] = mbev_grid.nodatavalue;
-          mbev_grid.sgm[kk] = mbev_grid.nodatavalue;
-        }
-
-        /* update grid in mbview display */
-        mbview_updateprimarygridcell(mbev_verbose, 0, i, j, mbev_grid.val[kk], &mbev_error);
-      }
+      mbeditviz_grid_accumulate(i, j, 1.0, -ping->bathcorr[ibeam], beam_ok);
+      mbeditviz_grid_touch(i, j, apply_now);
     }
 
     /* else footprint gridding algorithm */
@@ -2856,48 +2911,74 @@ int mbeditviz_grid_beam(struct mbev_file_struct *file, struct mbev_ping_struct *
 
           /* if beam affects cell apply using weight */
           if (use_weight == MBEV_USE_YES) {
-            /* get location in grid arrays */
-            const int kk = ii * mbev_grid.n_rows + jj;
-
-            /* add to weights and sums */
-            if (beam_ok) {
-              mbev_grid.wgt[kk] += weight;
-              mbev_grid.sum[kk] += weight * (-ping->bathcorr[ibeam]);
-              mbev_grid.sgm[kk] += weight * ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
-            }
-            else {
-              mbev_grid.wgt[kk] -= weight;
-              mbev_grid.sum[kk] -= weight * (-ping->bathcorr[ibeam]);
-              mbev_grid.sgm[kk] -= weight * ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
-              if (mbev_grid.wgt[kk] < MBEV_GRID_WEIGHT_TINY)
-                mbev_grid.wgt[kk] = 0.0;
-            }
+            mbeditviz_grid_accumulate(ii, jj, weight, -ping->bathcorr[ibeam], beam_ok);
+            mbeditviz_grid_touch(ii, jj, apply_now);
+          }
+        }
+    }
+  }
 
-            /* recalculate grid cell if desired */
-            if (apply_now) {
-              /* recalculate grid cell */
-              if (mbev_grid.wgt[kk] > 0.0) {
-                mbev_grid.val[kk] = mbev_grid.sum[kk] / mbev_grid.wgt[kk];
-                mbev_grid.sgm[kk] =
-                    sqrt(fabs(mbev_grid.sgm[kk] / mbev_grid.wgt[kk] - mbev_grid.val[kk] * mbev_grid.val[kk]));
-                mbev_grid.min = MIN(mbev_grid.min, mbev_grid.val[kk]);
-                mbev_grid.max = MAX(mbev_grid.max, mbev_grid.val[kk]);
-                mbev_grid.smin = MIN(mbev_grid.smin, mbev_grid.sgm[kk]);
-                mbev_grid.smax = MAX(mbev_grid.smax, mbev_grid.sgm[kk]);
-              }
-              else {
-                mbev_grid.val[kk] = mbev_grid.nodatavalue;
-                mbev_grid.sgm[kk] = mbev_grid.nodatavalue;
-              }
+  if (mbev_verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       error:      %d\n", mbev_error);
+    fprintf(stderr, "dbg2  Return status:\n");
+    fprintf(stderr, "dbg2       mbev_status: %d\n", mbev_status);
+  }
+
+  return (mbev_status);
+}
+
+/*--------------------------------------------------------------------*/
+/* Recalculate the grid cells queued by mbeditviz_grid_beam() and show them,
+   first regridding the shoal bias cells that lost their shoalest sounding. */
+int mbeditviz_update_grid() {
+  if (mbev_verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+  }
 
-              /* update grid in mbview display */
-              mbview_updateprimarygridcell(mbev_verbose, 0, ii, jj, mbev_grid.val[kk], &mbev_error);
+  if (mbev_grid.num_stale > 0) {
+    for (int idirty = 0; idirty < mbev_grid.num_dirty; idirty++) {
+      const int kk = mbev_grid.dirty[idirty];
+      if (mbev_grid.cellflag[kk] & MBEV_GRID_CELL_STALE) {
+        mbev_grid.wgt[kk] = 0.0;
+        mbev_grid.sum[kk] = 0.0;
+        mbev_grid.sum2[kk] = 0.0;
+        mbev_grid.num[kk] = 0;
+      }
+    }
+    for (int ifile = 0; ifile < mbev_num_files; ifile++) {
+      struct mbev_file_struct *file = &mbev_files[ifile];
+      if (file->load_status) {
+        for (int iping = 0; iping < file->num_pings; iping++) {
+          struct mbev_ping_struct *ping = &(file->pings[iping]);
+          for (int ibeam = 0; ibeam < ping->beams_bath; ibeam++) {
+            if (mb_beam_ok(ping->beamflag[ibeam])) {
+              const int i = (ping->bathx[ibeam] - mbev_grid.boundsutm[0] + 0.5 * mbev_grid.dx) / mbev_grid.dx;
+              const int j = (ping->bathy[ibeam] - mbev_grid.boundsutm[2] + 0.5 * mbev_grid.dy) / mbev_grid.dy;
+              if (i >= 0 && i < mbev_grid.n_columns && j >= 0 && j < mbev_grid.n_rows
+                  && (mbev_grid.cellflag[i * mbev_grid.n_rows + j] & MBEV_GRID_CELL_STALE))
+                mbeditviz_grid_shoal(i, j, -ping->bathcorr[ibeam], true);
             }
           }
         }
+      }
     }
+    mbev_grid.num_stale = 0;
   }
 
+  for (int idirty = 0; idirty < mbev_grid.num_dirty; idirty++) {
+    const int kk = mbev_grid.dirty[idirty];
+    mbev_grid.cellflag[kk] = 0;
+    mbeditviz_grid_cell(kk);
+    mbview_updateprimarygridcell(mbev_verbose, 0, kk / mbev_grid.n_rows, kk % mbev_grid.n_rows, mbev_grid.val[kk],
+                                 &mbev_error);
+    mbview_updatesecondarygridcell(mbev_verbose, 0, kk / mbev_grid.n_rows, kk % mbev_grid.n_rows, mbev_grid.sgm[kk],
+                                   &mbev_error);
+  }
+  mbev_grid.num_dirty = 0;
+
   if (mbev_verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
     fprintf(stderr, "dbg2  Return values:\n");
@@ -3062,24 +3143,8 @@ int mbeditviz_make_grid_simple() {
   }
 
   /* allocate memory for grid */
-  if (mbev_status == MB_SUCCESS) {
-    if ((mbev_grid.sum = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if ((mbev_grid.wgt = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if ((mbev_grid.val = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if ((mbev_grid.sgm = (float *)malloc(mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float))) == NULL)
-      mbev_error = MB_ERROR_MEMORY_FAIL;
-    if (mbev_error == MB_ERROR_NO_ERROR) {
-      memset(mbev_grid.sum, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-      memset(mbev_grid.wgt, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-      memset(mbev_grid.val, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-      memset(mbev_grid.sgm, 0, mbev_grid.n_columns * mbev_grid.n_rows * sizeof(float));
-    }
-    else
-      mbev_status = MB_FAILURE;
-  }
+  if (mbev_status == MB_SUCCESS)
+    mbev_status = mbeditviz_alloc_grid();
 
   /* make grid */
   if (mbev_status == MB_SUCCESS) {
@@ -3104,7 +3169,8 @@ int mbeditviz_make_grid_simple() {
               const int k = i * mbev_grid.n_rows + j;
               mbev_grid.sum[k] += (-ping->bathcorr[ibeam]);
               mbev_grid.wgt[k] += 1.0;
-              mbev_grid.sgm[k] += ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
+              mbev_grid.sum2[k] += ping->bathcorr[ibeam] * ping->bathcorr[ibeam];
+              mbev_grid.num[k]++;
             }
           }
         }
@@ -3116,8 +3182,9 @@ int mbeditviz_make_grid_simple() {
       for (int j = 0; j < mbev_grid.n_rows; j++) {
         const int k = i * mbev_grid.n_rows + j;
         if (mbev_grid.wgt[k] > 0.0) {
-          mbev_grid.val[k] = mbev_grid.sum[k] / mbev_grid.wgt[k];
-          mbev_grid.sgm[k] = sqrt(fabs(mbev_grid.sgm[k] / mbev_grid.wgt[k] - mbev_grid.val[k] * mbev_grid.val[k]));
+          const double mean = mbev_grid.sum[k] / mbev_grid.wgt[k];
+          mbev_grid.val[k] = mean;
+          mbev_grid.sgm[k] = sqrt(fabs(mbev_grid.sum2[k] / mbev_grid.wgt[k] - mean * mean));
           if (first) {
             mbev_grid.min = mbev_grid.val[k];
             mbev_grid.max = mbev_grid.val[k];
@@ -3259,10 +3326,24 @@ int mbeditviz_destroy_grid() {
       free(mbev_grid.val);
     if (mbev_grid.sgm != NULL)
       free(mbev_grid.sgm);
+    if (mbev_grid.sum2 != NULL)
+      free(mbev_grid.sum2);
+    if (mbev_grid.num != NULL)
+      free(mbev_grid.num);
+    if (mbev_grid.cellflag != NULL)
+      free(mbev_grid.cellflag);
+    if (mbev_grid.dirty != NULL)
+      free(mbev_grid.dirty);
     mbev_grid.sum = NULL;
     mbev_grid.wgt = NULL;
     mbev_grid.val = NULL;
     mbev_grid.sgm = NULL;
+    mbev_grid.sum2 = NULL;
+    mbev_grid.num = NULL;
+    mbev_grid.cellflag = NULL;
+    mbev_grid.dirty = NULL;
+    mbev_grid.num_dirty = 0;
+    mbev_grid.num_stale = 0;
 
     /* release projection */
     mb_proj_free(mbev_verbose, &(mbev_grid.pjptr), &mbev_error);
@@ -3948,8 +4029,11 @@ void mbeditviz_mb3dsoundings_edit(int ifile, int iping, int ibeam, char beamflag
     ping->beamflag[ibeam] = beamflag;
   }
 
-  /* redisplay grid if flush specified */
+  /* redisplay grid if flush specified, first regridding any shoal bias
+     cells that lost their shoalest sounding */
   if (flush != MB3DSDG_EDIT_NOFLUSH) {
+    if (mbev_grid.num_dirty > 0)
+      mbeditviz_update_grid();
     mbview_plothigh(0);
   }
 
@@ -4129,7 +4213,24 @@ void mbeditviz_mb3dsoundings_biasapply(double rollbias, double pitchbias, double
   // double mtodeglon, mtodeglat;
   // double beam_xtrack, beam_ltrack, beam_z;
 
-  /* apply bias parameters to swath data */
+  /* apply bias parameters to swath data, remembering the old position of
+     each gridded sounding that moves - if more than a quarter of the loaded
+     soundings move then removing and re-adding each one costs more than
+     regridding from scratch, so give up on the list and regrid everything */
+  struct mbev_moved_struct {
+    struct mbev_file_struct *file;
+    struct mbev_ping_struct *ping;
+    int ibeam;
+    double bathcorr;
+    double bathx;
+    double bathy;
+  };
+  struct mbev_moved_struct *moved = NULL;
+  int num_moved = 0;
+  int num_moved_alloc = 0;
+  const int num_moved_max = mbev_num_soundings_loaded / 4;
+  bool regrid_all = false;
+  int num_changed = 0;
   for (int ifile = 0; ifile < mbev_num_files; ifile++) {
     struct mbev_file_struct *file = &mbev_files[ifile];
     if (file->load_status) {
@@ -4155,23 +4256,86 @@ void mbeditviz_mb3dsoundings_biasapply(double rollbias, double pitchbias, double
             }
 
             /* apply rotations and recalculate position */
+            double bathcorr, bathlon, bathlat, bathx, bathy;
             mbeditviz_beam_position(ping->navlon, ping->navlat, mtodeglon, mtodeglat,
                         beam_z, beam_xtrack, beam_ltrack, sonardepth, rolldelta, pitchdelta, heading,
-                        &(ping->bathcorr[ibeam]), &(ping->bathlon[ibeam]), &(ping->bathlat[ibeam]));
-            mb_proj_forward(mbev_verbose, mbev_grid.pjptr, ping->bathlon[ibeam], ping->bathlat[ibeam],
-                    &ping->bathx[ibeam], &ping->bathy[ibeam], &mbev_error);
+                        &bathcorr, &bathlon, &bathlat);
+            mb_proj_forward(mbev_verbose, mbev_grid.pjptr, bathlon, bathlat, &bathx, &bathy, &mbev_error);
+            ping->bathlon[ibeam] = bathlon;
+            ping->bathlat[ibeam] = bathlat;
+            if (bathcorr != ping->bathcorr[ibeam] || bathx != ping->bathx[ibeam] || bathy != ping->bathy[ibeam]) {
+              if (!regrid_all && mb_beam_ok(ping->beamflag[ibeam]) && mbev_grid.status != MBEV_GRID_NONE) {
+                if (num_moved >= num_moved_max) {
+                  regrid_all = true;
+                }
+                else {
+                  if (num_moved >= num_moved_alloc) {
+                    num_moved_alloc = (num_moved_alloc > 0 ? 2 * num_moved_alloc : MBEV_ALLOCK_NUM);
+                    mbev_status = mb_reallocd(mbev_verbose, __FILE__, __LINE__,
+                                              num_moved_alloc * sizeof(struct mbev_moved_struct), (void **)&moved,
+                                              &mbev_error);
+                    if (mbev_status != MB_SUCCESS) {
+                      num_moved_alloc = 0;
+                      regrid_all = true;
+                    }
+                  }
+                  if (!regrid_all) {
+                    moved[num_moved].file = file;
+                    moved[num_moved].ping = ping;
+                    moved[num_moved].ibeam = ibeam;
+                    moved[num_moved].bathcorr = ping->bathcorr[ibeam];
+                    moved[num_moved].bathx = ping->bathx[ibeam];
+                    moved[num_moved].bathy = ping->bathy[ibeam];
+                    num_moved++;
+                  }
+                }
+              }
+              ping->bathcorr[ibeam] = bathcorr;
+              ping->bathx[ibeam] = bathx;
+              ping->bathy[ibeam] = bathy;
+              num_changed++;
+            }
           }
         }
       }
     }
   }
 
-  /* recalculate grid */
-  mbeditviz_make_grid();
+  if (mbev_grid.status != MBEV_GRID_NONE && regrid_all) {
+    /* recalculate grid */
+    if (mbev_verbose > 0)
+      fprintf(stderr, "Bias change moved %d soundings, regridding\n", num_changed);
+    mbeditviz_make_grid();
+
+    /* update the grid to mbview */
+    mbview_updateprimarygrid(mbev_verbose, 0, mbev_grid.n_columns, mbev_grid.n_rows, mbev_grid.val, &mbev_error);
+    mbview_updatesecondarygrid(mbev_verbose, 0, mbev_grid.n_columns, mbev_grid.n_rows, mbev_grid.sgm, &mbev_error);
+  }
+  else if (mbev_grid.status != MBEV_GRID_NONE) {
+    /* move each changed sounding out of its old cells and into its new ones */
+    for (int imoved = 0; imoved < num_moved; imoved++) {
+      struct mbev_ping_struct *ping = moved[imoved].ping;
+      const int ibeam = moved[imoved].ibeam;
+      const double bathcorr = ping->bathcorr[ibeam];
+      const double bathx = ping->bathx[ibeam];
+      const double bathy = ping->bathy[ibeam];
+      ping->bathcorr[ibeam] = moved[imoved].bathcorr;
+      ping->bathx[ibeam] = moved[imoved].bathx;
+      ping->bathy[ibeam] = moved[imoved].bathy;
+      mbeditviz_grid_beam(moved[imoved].file, ping, ibeam, false, false);
+      ping->bathcorr[ibeam] = bathcorr;
+      ping->bathx[ibeam] = bathx;
+      ping->bathy[ibeam] = bathy;
+      mbeditviz_grid_beam(moved[imoved].file, ping, ibeam, true, false);
+    }
 
-  /* update the grid to mbview */
-  mbview_updateprimarygrid(mbev_verbose, 0, mbev_grid.n_columns, mbev_grid.n_rows, mbev_grid.val, &mbev_error);
-  mbview_updatesecondarygrid(mbev_verbose, 0, mbev_grid.n_columns, mbev_grid.n_rows, mbev_grid.sgm, &mbev_error);
+    /* recalculate and redisplay only the affected grid cells */
+    if (mbev_verbose > 0)
+      fprintf(stderr, "Bias change moved %d soundings, updating %d grid cells\n", num_changed, mbev_grid.num_dirty);
+    mbeditviz_update_grid();
+  }
+  if (moved != NULL)
+    mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&moved, &mbev_error);
 
   /* turn message of */
   (*hideMessage)();
@@ -4480,6 +4644,348 @@ void mbeditviz_mb3dsoundings_colorsoundings(int color) {
   }
 }
 /*--------------------------------------------------------------------*/
+/* Bias optimization works on a copy of the selected sounding geometry so
+   that the variance of many bias value sets can be calculated at once on
+   separate threads without touching the soundings or the ping arrays.
+   Each ping keeps its projected navigation position and the derivatives of
+   the local selection frame position with respect to easting and northing
+   in meters, which replaces the per sounding projection of
+   mbeditviz_mb3dsoundings_bias() with a linear transform. */
+#define MBEV_BIAS_PROJECT_DELTA 10.0
+
+struct mbev_bias_ping {
+  struct mbev_file_struct *file;
+  struct mbev_ping_struct *ping;
+  int beam_start;
+  int beam_end;
+  double x0;
+  double y0;
+  double dxde;
+  double dxdn;
+  double dyde;
+  double dydn;
+};
+
+struct mbev_bias_beam {
+  double xtrack;
+  double ltrack;
+  double z;
+};
+
+struct mbev_bias_model {
+  int num_pings;
+  int num_beams;
+  struct mbev_bias_ping *pings;
+  struct mbev_bias_beam *beams;
+  double grid_xmin;
+  double grid_ymin;
+  double grid_dx;
+  double grid_dy;
+  int grid_n_columns;
+  int grid_n_rows;
+};
+
+struct mbev_bias_trial {
+  double rollbias;
+  double pitchbias;
+  double headingbias;
+  double timelag;
+  double snell;
+  int variance_total_num;
+  double variance_total;
+};
+
+struct mbev_bias_thread {
+  const struct mbev_bias_model *model;
+  struct mbev_bias_trial *trials;
+  int num_trials;
+  int ithread;
+  int nthreads;
+  double *grid_first;
+  double *grid_sum;
+  double *grid_sum2;
+  int *grid_num;
+};
+
+/*--------------------------------------------------------------------*/
+static void mbeditviz_bias_local_position(double easting, double northing, double *x, double *y) {
+  const double xx = easting - mbev_selected.xorigin;
+  const double yy = northing - mbev_selected.yorigin;
+  *x = xx * mbev_selected.sinbearing + yy * mbev_selected.cosbearing;
+  *y = -xx * mbev_selected.cosbearing + yy * mbev_selected.sinbearing;
+}
+/*--------------------------------------------------------------------*/
+static int mbeditviz_bias_model_init(struct mbev_bias_model *model, double grid_xmin, double grid_ymin, double grid_dx,
+                                     double grid_dy, int grid_n_columns, int grid_n_rows) {
+  memset(model, 0, sizeof(struct mbev_bias_model));
+  model->grid_xmin = grid_xmin;
+  model->grid_ymin = grid_ymin;
+  model->grid_dx = grid_dx;
+  model->grid_dy = grid_dy;
+  model->grid_n_columns = grid_n_columns;
+  model->grid_n_rows = grid_n_rows;
+
+  /* count the unflagged soundings and the pings they come from */
+  int num_pings = 0;
+  int num_beams = 0;
+  int ifilelast = -1;
+  int ipinglast = -1;
+  for (int i = 0; i < mbev_selected.num_soundings; i++) {
+    struct mb3dsoundings_sounding_struct *sounding = &mbev_selected.soundings[i];
+    if (mb_beam_ok(sounding->beamflag)) {
+      if (sounding->ifile != ifilelast || sounding->iping != ipinglast) {
+        num_pings++;
+        ifilelast = sounding->ifile;
+        ipinglast = sounding->iping;
+      }
+      num_beams++;
+    }
+  }
+  if (num_beams == 0)
+    return (MB_SUCCESS);
+
+  int status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, num_pings * sizeof(struct mbev_bias_ping), (void **)&model->pings,
+                          &mbev_error);
+  if (status == MB_SUCCESS)
+    status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, num_beams * sizeof(struct mbev_bias_beam), (void **)&model->beams,
+                        &mbev_error);
+  if (status != MB_SUCCESS) {
+    if (model->pings != NULL)
+      mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&model->pings, &mbev_error);
+    return (status);
+  }
+
+  /* copy the sonar relative sounding positions and linearize the
+     projection around the navigation of each ping */
+  ifilelast = -1;
+  ipinglast = -1;
+  for (int i = 0; i < mbev_selected.num_soundings; i++) {
+    struct mb3dsoundings_sounding_struct *sounding = &mbev_selected.soundings[i];
+    if (!mb_beam_ok(sounding->beamflag))
+      continue;
+    struct mbev_file_struct *file = &mbev_files[sounding->ifile];
+    struct mbev_ping_struct *ping = &(file->pings[sounding->iping]);
+    if (sounding->ifile != ifilelast || sounding->iping != ipinglast) {
+      struct mbev_bias_ping *bping = &model->pings[model->num_pings];
+      model->num_pings++;
+      bping->file = file;
+      bping->ping = ping;
+      bping->beam_start = model->num_beams;
+      double mtodeglon;
+      double mtodeglat;
+      mb_coor_scale(mbev_verbose, ping->navlat, &mtodeglon, &mtodeglat);
+      double easting;
+      double northing;
+      double xe;
+      double ye;
+      double xn;
+      double yn;
+      mb_proj_forward(mbev_verbose, mbev_grid.pjptr, ping->navlon, ping->navlat, &easting, &northing, &mbev_error);
+      mbeditviz_bias_local_position(easting, northing, &bping->x0, &bping->y0);
+      mb_proj_forward(mbev_verbose, mbev_grid.pjptr, ping->navlon + mtodeglon * MBEV_BIAS_PROJECT_DELTA, ping->navlat, &easting,
+                      &northing, &mbev_error);
+      mbeditviz_bias_local_position(easting, northing, &xe, &ye);
+      mb_proj_forward(mbev_verbose, mbev_grid.pjptr, ping->navlon, ping->navlat + mtodeglat * MBEV_BIAS_PROJECT_DELTA, &easting,
+                      &northing, &mbev_error);
+      mbeditviz_bias_local_position(easting, northing, &xn, &yn);
+      bping->dxde = (xe - bping->x0) / MBEV_BIAS_PROJECT_DELTA;
+      bping->dyde = (ye - bping->y0) / MBEV_BIAS_PROJECT_DELTA;
+      bping->dxdn = (xn - bping->x0) / MBEV_BIAS_PROJECT_DELTA;
+      bping->dydn = (yn - bping->y0) / MBEV_BIAS_PROJECT_DELTA;
+      ifilelast = sounding->ifile;
+      ipinglast = sounding->iping;
+    }
+    struct mbev_bias_beam *bbeam = &model->beams[model->num_beams];
+    bbeam->xtrack = ping->bathacrosstrack[sounding->ibeam];
+    bbeam->ltrack = ping->bathalongtrack[sounding->ibeam];
+    bbeam->z = ping->bath[sounding->ibeam] - ping->sonardepth;
+    model->num_beams++;
+    model->pings[model->num_pings - 1].beam_end = model->num_beams;
+  }
+
+  return (MB_SUCCESS);
+}
+/*--------------------------------------------------------------------*/
+static void mbeditviz_bias_model_free(struct mbev_bias_model *model) {
+  if (model->pings != NULL)
+    mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&model->pings, &mbev_error);
+  if (model->beams != NULL)
+    mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&model->beams, &mbev_error);
+  model->num_pings = 0;
+  model->num_beams = 0;
+}
+/*--------------------------------------------------------------------*/
+/* Calculate the mean of the depth variance in the local grid bins for one
+   set of bias values. The soundings are repositioned as
+   mbeditviz_mb3dsoundings_bias() does, except that the projection of each
+   sounding is a linear approximation about its ping's navigation (see
+   MBEV_BIAS_PROJECT_DELTA). Only the model and the grid arrays passed in
+   are used, so several can run at once. */
+static void mbeditviz_bias_evaluate(const struct mbev_bias_model *model, struct mbev_bias_trial *trial, double *grid_first,
+                                    double *grid_sum, double *grid_sum2, int *grid_num) {
+  const size_t num_cells = (size_t)model->grid_n_columns * model->grid_n_rows;
+  memset(grid_first, 0, num_cells * sizeof(double));
+  memset(grid_sum, 0, num_cells * sizeof(double));
+  memset(grid_sum2, 0, num_cells * sizeof(double));
+  memset(grid_num, 0, num_cells * sizeof(int));
+
+  int error = MB_ERROR_NO_ERROR;
+  for (int iping = 0; iping < model->num_pings; iping++) {
+    const struct mbev_bias_ping *bping = &model->pings[iping];
+    struct mbev_ping_struct *ping = bping->ping;
+    double heading = 0.0;
+    double sonardepth = 0.0;
+    double rolldelta = 0.0;
+    double pitchdelta = 0.0;
+    mbeditviz_bias_attitude(bping->file, ping, trial->rollbias, trial->pitchbias, trial->headingbias, trial->timelag, &heading,
+                            &sonardepth, &rolldelta, &pitchdelta, &error);
+
+    for (int ibeam = bping->beam_start; ibeam < bping->beam_end; ibeam++) {
+      double beam_xtrack = model->beams[ibeam].xtrack;
+      double beam_ltrack = model->beams[ibeam].ltrack;
+      double beam_z = model->beams[ibeam].z;
+      if (trial->snell != 1.0)
+        mbeditviz_snell_correction(trial->snell, (ping->roll + rolldelta), &beam_xtrack, &beam_ltrack, &beam_z);
+      double easting;
+      double northing;
+      double bath;
+      mb_platform_math_attitude_rotate_beam(mbev_verbose, beam_xtrack, beam_ltrack, beam_z, rolldelta, pitchdelta, heading,
+                                            &easting, &northing, &bath, &error);
+      const double x = bping->x0 + bping->dxde * easting + bping->dxdn * northing;
+      const double y = bping->y0 + bping->dyde * easting + bping->dydn * northing;
+      const int i = (x - model->grid_xmin) / model->grid_dx;
+      const int j = (y - model->grid_ymin) / model->grid_dy;
+      if (i >= 0 && i < model->grid_n_columns && j >= 0 && j < model->grid_n_rows) {
+        const int k = i * model->grid_n_rows + j;
+        if (grid_num[k] == 0)
+          grid_first[k] = -(bath + sonardepth);
+        const double z = -(bath + sonardepth) - grid_first[k];
+        grid_sum[k] += z;
+        grid_sum2[k] += z * z;
+        grid_num[k] += 1;
+      }
+    }
+  }
+
+  trial->variance_total = 0.0;
+  trial->variance_total_num = 0;
+  for (size_t k = 0; k < num_cells; k++) {
+    if (grid_num[k] > 0) {
+      trial->variance_total += (grid_sum2[k] - (grid_sum[k] * grid_sum[k] / grid_num[k])) / grid_num[k];
+      trial->variance_total_num++;
+    }
+  }
+  if (trial->variance_total_num > 0)
+    trial->variance_total /= trial->variance_total_num;
+}
+/*--------------------------------------------------------------------*/
+static void *mbeditviz_bias_thread(void *arg) {
+  struct mbev_bias_thread *thread = (struct mbev_bias_thread *)arg;
+  for (int itrial = thread->ithread; itrial < thread->num_trials; itrial += thread->nthreads)
+    mbeditviz_bias_evaluate(thread->model, &thread->trials[itrial], thread->grid_first, thread->grid_sum, thread->grid_sum2,
+                            thread->grid_num);
+  return (NULL);
+}
+/*--------------------------------------------------------------------*/
+/* Evaluate a set of trials, interleaved over the available threads. */
+static void mbeditviz_bias_evaluate_trials(struct mbev_bias_thread *threads, int nthreads, struct mbev_bias_trial *trials,
+                                           int num_trials) {
+  nthreads = MAX(1, MIN(nthreads, num_trials));
+  pthread_t thread_ids[MB_THREAD_MAX];
+  bool started[MB_THREAD_MAX];
+  for (int i = 0; i < nthreads; i++) {
+    threads[i].trials = trials;
+    threads[i].num_trials = num_trials;
+    threads[i].ithread = i;
+    threads[i].nthreads = nthreads;
+    started[i] = false;
+  }
+  for (int i = 1; i < nthreads; i++)
+    started[i] = (pthread_create(&thread_ids[i], NULL, mbeditviz_bias_thread, &threads[i]) == 0);
+  mbeditviz_bias_thread(&threads[0]);
+  for (int i = 1; i < nthreads; i++) {
+    if (started[i])
+      pthread_join(thread_ids[i], NULL);
+    else
+      mbeditviz_bias_thread(&threads[i]);
+  }
+}
+/*--------------------------------------------------------------------*/
+static double *mbeditviz_bias_parameter(struct mbev_bias_trial *trial, int parameter) {
+  if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_R)
+    return (&trial->rollbias);
+  else if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_P)
+    return (&trial->pitchbias);
+  else if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_H)
+    return (&trial->headingbias);
+  else if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_T)
+    return (&trial->timelag);
+  return (&trial->snell);
+}
+/*--------------------------------------------------------------------*/
+/* Search one bias parameter over niterate evenly spaced values within
+   +/- halfwidth of its current best value, keeping the others at their
+   best values. The values are evaluated together with the linearized
+   approximation of the sounding projection and then compared in order,
+   so the choice does not depend on the number of threads, but it may
+   differ slightly from the earlier sweep that reprojected every sounding. */
+static void mbeditviz_bias_search(struct mbev_bias_thread *threads, int nthreads, const char *stage, int parameter,
+                                  double halfwidth, int niterate, struct mbev_bias_trial *best, bool *first) {
+  struct mbev_bias_trial trials[32];
+  niterate = MIN(niterate, 32);
+
+  const char *name = "Snell correction";
+  char key = 's';
+  int precision = 3;
+  if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_R) {
+    name = "Roll Bias";
+    key = 'r';
+    precision = 2;
+  }
+  else if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_P) {
+    name = "Pitch Bias";
+    key = 'p';
+    precision = 2;
+  }
+  else if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_H) {
+    name = "Heading Bias";
+    key = 'h';
+    precision = 2;
+  }
+  else if (parameter == MB3DSDG_OPTIMIZEBIASVALUES_T) {
+    name = "Time Lag";
+    key = 't';
+    precision = 2;
+  }
+
+  const double start = *mbeditviz_bias_parameter(best, parameter) - halfwidth;
+  const double step = 2.0 * halfwidth / (niterate - 1);
+  for (int i = 0; i < niterate; i++) {
+    trials[i] = *best;
+    *mbeditviz_bias_parameter(&trials[i], parameter) = start + i * step;
+  }
+
+  mbeditviz_bias_evaluate_trials(threads, nthreads, trials, niterate);
+
+  mb_path message_string = "";
+  for (int i = 0; i < niterate; i++) {
+    const double value = *mbeditviz_bias_parameter(&trials[i], parameter);
+    char *marker = "       ";
+    if (trials[i].variance_total_num > 0 && (trials[i].variance_total < best->variance_total || *first)) {
+      *first = false;
+      *best = trials[i];
+      marker = " ******";
+    }
+    fprintf(stderr, "%-19s | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: %c:%5.*f  N:%d Var:%12.5f %s\n",
+            stage, best->rollbias, best->pitchbias, best->headingbias, best->timelag, best->snell, best->variance_total, key,
+            precision, value, trials[i].variance_total_num, trials[i].variance_total, marker);
+    snprintf(message_string, sizeof(message_string), "Optimizing biases: %s:%.*f Variance: %.3f %.3f", name,
+             (key == 's' ? 4 : 2), value,
+             trials[i].variance_total, best->variance_total);
+    (*showMessage)(message_string);
+  }
+}
+/*--------------------------------------------------------------------*/
 void mbeditviz_mb3dsoundings_optimizebiasvalues(int mode, double *rollbias_best, double *pitchbias_best, double *headingbias_best,
                                                 double *timelag_best, double *snell_best) {
   if (mbev_verbose > 0)
@@ -4496,528 +5002,155 @@ void mbeditviz_mb3dsoundings_optimizebiasvalues(int mode, double *rollbias_best,
     fprintf(stderr, "dbg2       snell_best:          %f\n", *snell_best);
   }
 
-  /* get and save initial bias values */
-  // const double rollbias_org = *rollbias_best;
-  // const double pitchbias_org = *pitchbias_best;
-  // const double headingbias_org = *headingbias_best;
-  // const double timelag_org = *timelag_best;
-  // const double snell_org = *snell_best;
-
   /* create grid of bins to calculate variance */
   const double local_grid_dx = 2 * mbev_grid.dx;
   const double local_grid_dy = 2 * mbev_grid.dy;
   const double local_grid_xmin = mbev_selected.xmin - 0.25 * (mbev_selected.xmax - mbev_selected.xmin);
-  double local_grid_xmax = mbev_selected.xmax + 0.25 * (mbev_selected.xmax - mbev_selected.xmin);
+  const double local_grid_xmax = mbev_selected.xmax + 0.25 * (mbev_selected.xmax - mbev_selected.xmin);
   const double local_grid_ymin = mbev_selected.ymin - 0.25 * (mbev_selected.ymax - mbev_selected.ymin);
-  double local_grid_ymax = mbev_selected.ymax + 0.25 * (mbev_selected.ymax - mbev_selected.ymin);
+  const double local_grid_ymax = mbev_selected.ymax + 0.25 * (mbev_selected.ymax - mbev_selected.ymin);
   const int local_grid_n_columns = (local_grid_xmax - local_grid_xmin) / local_grid_dx + 1;
   const int local_grid_n_rows = (local_grid_ymax - local_grid_ymin) / local_grid_dy + 1;
-  local_grid_xmax = local_grid_xmin + local_grid_n_columns * local_grid_dx;
-  local_grid_ymax = local_grid_ymin + local_grid_n_rows * local_grid_dy;
-
-  /* allocate arrays for calculating variance */
-  const size_t size_double = local_grid_n_columns * local_grid_n_rows * sizeof(double);
-  const size_t size_int = local_grid_n_columns * local_grid_n_rows * sizeof(int);
-  double *local_grid_first = NULL;
-  mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&local_grid_first, &mbev_error);
-  double *local_grid_sum = NULL;
-  mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&local_grid_sum, &mbev_error);
-  double *local_grid_sum2 = NULL;
-  mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&local_grid_sum2, &mbev_error);
-  double *local_grid_variance = NULL;
-  mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&local_grid_variance, &mbev_error);
-  int *local_grid_num = NULL;
-  mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_int, (void **)&local_grid_num, &mbev_error);
-
-  /* now loop over all different values of bias parameters looking for the
-   * combination that minimizes the overall variance
-   * - if a good set of values is found (measured by variace reduction)
-   * then set the values and apply them before returning */
-  fprintf(stderr,"\nMBeditviz: Optimizing Bias Parameters\n");
-  fprintf(stderr,"  Number of selected soundings: %d\n", mbev_selected.num_soundings);
-  if (mode == MB3DSDG_OPTIMIZEBIASVALUES_R)
-    fprintf(stderr,"  Mode: Roll Bias\n");
-  else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_P)
-    fprintf(stderr,"  Mode: Pitch Bias\n");
-  else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_H)
-    fprintf(stderr,"  Mode: Heading Bias\n");
-  else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_P + MB3DSDG_OPTIMIZEBIASVALUES_P)
-    fprintf(stderr,"  Mode: Roll Bias and Pitch Bias\n");
-  else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_P + MB3DSDG_OPTIMIZEBIASVALUES_P + MB3DSDG_OPTIMIZEBIASVALUES_H)
-    fprintf(stderr,"  Mode: Roll Bias and Pitch Bias and Heading Bias\n");
-  else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_T)
-    fprintf(stderr,"  Mode: Time Lag\n");
-  else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_S)
-    fprintf(stderr,"  Mode: Snell Correction\n");
-  fprintf(stderr,"------------------------\n");
-
-  /* set flag to set best total variance on first calculation */
-  bool first = true;
 
-  // TODO(schwehr): Localize variables.
-  mb_path message_string = "";
-  double variance_total;
-  double variance_total_best = 0.0;
-  int variance_total_num = 0;
-  double rollbias;
-  double pitchbias;
-  double headingbias;
-  double timelag;
-  double snell;
-  double rollbias_start, rollbias_end, drollbias;
-  double pitchbias_start, pitchbias_end, dpitchbias;
-  double headingbias_start, headingbias_end, dheadingbias;
-  // double timelag_start;
-  // double timelag_end;
-  // double dtimelag;
-  // double snell_start, snell_end;
-  // double dsnell;
-  // int niterate;
-  char *marker1 = "       ";
-  char *marker2 = " ******";
-  char *marker = NULL;
-
-  /* Roll bias */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_R) {
-    /* start with coarse roll bias */
-    int niterate = 11;
-    rollbias_start = *rollbias_best - 5.0;
-    rollbias_end = *rollbias_best + 5.0;
-    drollbias = (rollbias_end - rollbias_start) / (niterate - 1);
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      rollbias = rollbias_start + i * drollbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *rollbias_best = rollbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "COARSE ROLLBIAS:    | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: r:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            rollbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing Roll Bias:%.2f Variance: %.3f %.3f", rollbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
+  /* copy the geometry of the selected soundings */
+  struct mbev_bias_model model;
+  mbev_status = mbeditviz_bias_model_init(&model, local_grid_xmin, local_grid_ymin, local_grid_dx, local_grid_dy,
+                                          local_grid_n_columns, local_grid_n_rows);
 
-    /* now do fine roll bias */
-    niterate = 19;
-    rollbias_start = *rollbias_best - 0.9;
-    rollbias_end = *rollbias_best + 0.9;
-    drollbias = (rollbias_end - rollbias_start) / (niterate - 1);
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      rollbias = rollbias_start + i * drollbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *rollbias_best = rollbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE ROLLBIAS:      | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: r:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            rollbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Roll Bias:%.2f Variance: %.3f %.3f", rollbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
+  /* allocate arrays for calculating variance, one set per thread */
+  int nthreads = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+  nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  nthreads = MAX(1, MIN(nthreads, MB_THREAD_MAX));
+  struct mbev_bias_thread threads[MB_THREAD_MAX];
+  memset(threads, 0, sizeof(threads));
+  const size_t size_double = (size_t)local_grid_n_columns * local_grid_n_rows * sizeof(double);
+  const size_t size_int = (size_t)local_grid_n_columns * local_grid_n_rows * sizeof(int);
+  int nthreads_alloc = 0;
+  for (int i = 0; i < nthreads && mbev_status == MB_SUCCESS; i++) {
+    threads[i].model = &model;
+    mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&threads[i].grid_first, &mbev_error);
+    if (mbev_status == MB_SUCCESS)
+      mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&threads[i].grid_sum, &mbev_error);
+    if (mbev_status == MB_SUCCESS)
+      mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_double, (void **)&threads[i].grid_sum2, &mbev_error);
+    if (mbev_status == MB_SUCCESS)
+      mbev_status = mb_mallocd(mbev_verbose, __FILE__, __LINE__, size_int, (void **)&threads[i].grid_num, &mbev_error);
+    nthreads_alloc = i + 1;
+  }
+
+  /* make do with fewer threads if memory ran out partway through */
+  if (mbev_status != MB_SUCCESS && nthreads_alloc > 1) {
+    nthreads = nthreads_alloc - 1;
+    mbev_status = MB_SUCCESS;
+    mbev_error = MB_ERROR_NO_ERROR;
   }
-
-  /* Pitch bias */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_P) {
-    /* start with coarse pitch bias */
-    rollbias = *rollbias_best;
-    int niterate = 11;
-    pitchbias_start = *pitchbias_best - 5.0;
-    pitchbias_end = *pitchbias_best + 5.0;
-    dpitchbias = (pitchbias_end - pitchbias_start) / (niterate - 1);
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      pitchbias = pitchbias_start + i * dpitchbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *pitchbias_best = pitchbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "COARSE PITCHBIAS:     | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: p:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            pitchbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Pitch Bias:%.2f Variance: %.3f %.3f", pitchbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
-
-    /* now do fine pitch bias */
-    rollbias = *rollbias_best;
-    niterate = 19;
-    pitchbias_start = *pitchbias_best - 0.9;
-    pitchbias_end = *pitchbias_best + 0.9;
-    dpitchbias = (pitchbias_end - pitchbias_start) / (niterate - 1);
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      pitchbias = pitchbias_start + i * dpitchbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *pitchbias_best = pitchbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE PITCHBIAS:     | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: p:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            pitchbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Pitch Bias:%.2f Variance: %.3f %.3f", pitchbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
+  else {
+    nthreads = nthreads_alloc;
   }
 
-  /* Heading bias */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_H) {
-    /* start with coarse heading bias */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    int niterate = 11;
-    headingbias_start = *headingbias_best - 5.0;
-    headingbias_end = *headingbias_best + 5.0;
-    dheadingbias = (headingbias_end - headingbias_start) / (niterate - 1);
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      headingbias = headingbias_start + i * dheadingbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *headingbias_best = headingbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "COARSE HEADINGBIAS: | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: h:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            headingbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing Heading Bias:%.2f Variance: %.3f %.3f", headingbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
+  if (mbev_status == MB_SUCCESS) {
+    /* now loop over different values of bias parameters looking for the
+     * combination that minimizes the overall variance, coarse then fine
+     * for each parameter, evaluating each set of values in parallel
+     * - if a good set of values is found (measured by variance reduction)
+     * then set the values and apply them before returning */
+    fprintf(stderr, "\nMBeditviz: Optimizing Bias Parameters\n");
+    fprintf(stderr, "  Number of selected soundings: %d\n", mbev_selected.num_soundings);
+    fprintf(stderr, "  Number of threads: %d\n", nthreads);
+    if (mode == MB3DSDG_OPTIMIZEBIASVALUES_R)
+      fprintf(stderr, "  Mode: Roll Bias\n");
+    else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_P)
+      fprintf(stderr, "  Mode: Pitch Bias\n");
+    else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_H)
+      fprintf(stderr, "  Mode: Heading Bias\n");
+    else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_RP)
+      fprintf(stderr, "  Mode: Roll Bias and Pitch Bias\n");
+    else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_RPH)
+      fprintf(stderr, "  Mode: Roll Bias and Pitch Bias and Heading Bias\n");
+    else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_T)
+      fprintf(stderr, "  Mode: Time Lag\n");
+    else if (mode == MB3DSDG_OPTIMIZEBIASVALUES_S)
+      fprintf(stderr, "  Mode: Snell Correction\n");
+    fprintf(stderr, "------------------------\n");
+
+    /* set flag to set best total variance on first calculation */
+    bool first = true;
+    struct mbev_bias_trial best;
+    best.rollbias = *rollbias_best;
+    best.pitchbias = *pitchbias_best;
+    best.headingbias = *headingbias_best;
+    best.timelag = *timelag_best;
+    best.snell = *snell_best;
+    best.variance_total_num = 0;
+    best.variance_total = 0.0;
+
+    /* Roll bias */
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_R) {
+      mbeditviz_bias_search(threads, nthreads, "COARSE ROLLBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_R, 5.0, 11, &best, &first);
+      mbeditviz_bias_search(threads, nthreads, "FINE ROLLBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_R, 0.9, 19, &best, &first);
     }
 
-    /* now do fine heading bias */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    niterate = 19;
-    headingbias_start = *headingbias_best - 0.9;
-    headingbias_end = *headingbias_best + 0.9;
-    dheadingbias = (headingbias_end - headingbias_start) / (niterate - 1);
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      headingbias = headingbias_start + i * dheadingbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *headingbias_best = headingbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE HEADINGBIAS:   | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: h:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            headingbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Heading Bias:%.2f Variance: %.3f %.3f", headingbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
+    /* Pitch bias */
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_P) {
+      mbeditviz_bias_search(threads, nthreads, "COARSE PITCHBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_P, 5.0, 11, &best, &first);
+      mbeditviz_bias_search(threads, nthreads, "FINE PITCHBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_P, 0.9, 19, &best, &first);
     }
-  }
 
-  /* Redo roll bias if doing a combination of bias parameters */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_R && mode != MB3DSDG_OPTIMIZEBIASVALUES_R) {
-    /* now do fine roll bias */
-    int niterate = 19;
-    rollbias_start = *rollbias_best - 0.9;
-    rollbias_end = *rollbias_best + 0.9;
-    drollbias = (rollbias_end - rollbias_start) / (niterate - 1);
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      rollbias = rollbias_start + i * drollbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *rollbias_best = rollbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE ROLLBIAS:      | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: r:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            rollbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Roll Bias:%.2f Variance: %.3f %.3f", rollbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
+    /* Heading bias */
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_H) {
+      mbeditviz_bias_search(threads, nthreads, "COARSE HEADINGBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_H, 5.0, 11, &best, &first);
+      mbeditviz_bias_search(threads, nthreads, "FINE HEADINGBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_H, 0.9, 19, &best, &first);
     }
-  }
 
-  /* Redo pitch bias if doing a combination of bias parameters */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_P && mode != MB3DSDG_OPTIMIZEBIASVALUES_P) {
-    /* now do fine pitch bias */
-    rollbias = *rollbias_best;
-    int niterate = 19;
-    pitchbias_start = *pitchbias_best - 0.9;
-    pitchbias_end = *pitchbias_best + 0.9;
-    dpitchbias = (pitchbias_end - pitchbias_start) / (niterate - 1);
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      pitchbias = pitchbias_start + i * dpitchbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *pitchbias_best = pitchbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE PITCHBIAS:     | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: p:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            pitchbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Pitch Bias:%.2f Variance: %.3f %.3f", pitchbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
+    /* Redo roll, pitch and heading bias if doing a combination of bias parameters */
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_R && mode != MB3DSDG_OPTIMIZEBIASVALUES_R)
+      mbeditviz_bias_search(threads, nthreads, "FINE ROLLBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_R, 0.9, 19, &best, &first);
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_P && mode != MB3DSDG_OPTIMIZEBIASVALUES_P)
+      mbeditviz_bias_search(threads, nthreads, "FINE PITCHBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_P, 0.9, 19, &best, &first);
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_H && mode != MB3DSDG_OPTIMIZEBIASVALUES_H)
+      mbeditviz_bias_search(threads, nthreads, "FINE HEADINGBIAS:", MB3DSDG_OPTIMIZEBIASVALUES_H, 0.9, 19, &best, &first);
+
+    /* Time lag */
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_T) {
+      mbeditviz_bias_search(threads, nthreads, "COARSE TIME LAG:", MB3DSDG_OPTIMIZEBIASVALUES_T, 1.0, 21, &best, &first);
+      mbeditviz_bias_search(threads, nthreads, "FINE TIME LAG:", MB3DSDG_OPTIMIZEBIASVALUES_T, 0.09, 19, &best, &first);
     }
-  }
 
-  /* Redo heading bias if doing a combination of bias parameters */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_H && mode != MB3DSDG_OPTIMIZEBIASVALUES_H) {
-    /* now do fine heading bias */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    int niterate = 19;
-    headingbias_start = *headingbias_best - 0.9;
-    headingbias_end = *headingbias_best + 0.9;
-    dheadingbias = (headingbias_end - headingbias_start) / (niterate - 1);
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      headingbias = headingbias_start + i * dheadingbias;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *headingbias_best = headingbias;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE HEADINGBIAS:   | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: h:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            headingbias, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Heading Bias:%.2f Variance: %.3f %.3f", headingbias, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
+    /* Snell */
+    if (mode & MB3DSDG_OPTIMIZEBIASVALUES_S) {
+      mbeditviz_bias_search(threads, nthreads, "COARSE SNELL:", MB3DSDG_OPTIMIZEBIASVALUES_S, 0.1, 21, &best, &first);
+      mbeditviz_bias_search(threads, nthreads, "FINE SNELL:", MB3DSDG_OPTIMIZEBIASVALUES_S, 0.009, 19, &best, &first);
     }
-  }
 
-  /* Time lag */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_T) {
-    /* start with coarse time lag */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    int niterate = 21;
-          double timelag_start = *timelag_best - 1.0;
-    double timelag_end = *timelag_best + 1.0;
-    double dtimelag = (timelag_end - timelag_start) / (niterate - 1);
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      timelag = timelag_start + i * dtimelag;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *timelag_best = timelag;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "COARSE TIME LAG:    | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: t:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            timelag, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Time Lag:%.2f Variance: %.3f %.3f", timelag, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
-
-    /* now do fine time lag */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    niterate = 19;
-    timelag_start = *timelag_best - 0.09;
-    timelag_end = *timelag_best + 0.09;
-    dtimelag = (timelag_end - timelag_start) / (niterate - 1);
-    timelag = *timelag_best;
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      timelag = timelag_start + i * dtimelag;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *timelag_best = timelag;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE TIME LAG:      | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: t:%5.2f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            timelag, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Time Lag:%.2f Variance: %.3f %.3f", timelag, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
+    *rollbias_best = best.rollbias;
+    *pitchbias_best = best.pitchbias;
+    *headingbias_best = best.headingbias;
+    *timelag_best = best.timelag;
+    *snell_best = best.snell;
   }
-
-  /* Snell */
-  if (mode & MB3DSDG_OPTIMIZEBIASVALUES_S) {
-    /* start with coarse snell */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    int niterate = 21;
-    double snell_start = *snell_best - 0.1;
-    double snell_end = *snell_best + 0.1;
-    double dsnell = (snell_end - snell_start) / (niterate - 1);
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      snell = snell_start + i * dsnell;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *snell_best = snell;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "COARSE SNELL:       | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: s:%5.3f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            snell, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Snell correction:%.4f Variance: %.3f %.3f", snell, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
-
-    /* now do fine snell */
-    rollbias = *rollbias_best;
-    pitchbias = *pitchbias_best;
-    headingbias = *headingbias_best;
-    timelag = *timelag_best;
-    niterate = 19;
-    snell_start = *snell_best - 0.009;
-    snell_end = *snell_best + 0.009;
-    dsnell = (snell_end - snell_start) / (niterate - 1);
-    snell = *snell_best;
-    for (int i = 0; i < niterate; i++) {
-      snell = snell_start + i * dsnell;
-      mbeditviz_mb3dsoundings_getbiasvariance(
-          local_grid_xmin, local_grid_xmax, local_grid_ymin, local_grid_ymax, local_grid_n_columns, local_grid_n_rows, local_grid_dx,
-          local_grid_dy, local_grid_first, local_grid_sum, local_grid_sum2, local_grid_variance, local_grid_num, rollbias,
-          pitchbias, headingbias, timelag, snell, &variance_total_num, &variance_total);
-      if (variance_total_num > 0 && (variance_total < variance_total_best || first)) {
-        first = false;
-        *snell_best = snell;
-        variance_total_best = variance_total;
-        marker = marker2;
-      }
-      else
-        marker = marker1;
-      fprintf(stderr, "FINE SNELL:         | Best: r:%5.2f p:%5.2f h:%5.2f t:%5.2f s:%5.3f  var:%12.5f | Test: s:%5.3f  N:%d Var:%12.5f %s\n",
-            *rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best, variance_total_best,
-            snell, variance_total_num, variance_total, marker);
-      snprintf(message_string, sizeof(message_string), "Optimizing biases: Snell correction:%.4f Variance: %.3f %.3f", timelag, variance_total,
-              variance_total_best);
-      (*showMessage)(message_string);
-    }
+  else {
+    fprintf(stderr, "\nMBeditviz: Unable to allocate memory to optimize bias parameters\n");
   }
 
   /* turn off message dialog */
   (*hideMessage)();
 
   /* deallocate arrays for calculating variance */
-  mbev_status = mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&local_grid_first, &mbev_error);
-  mbev_status = mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&local_grid_sum, &mbev_error);
-  mbev_status = mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&local_grid_sum2, &mbev_error);
-  mbev_status = mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&local_grid_num, &mbev_error);
-  mbev_status = mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&local_grid_variance, &mbev_error);
-
+  for (int i = 0; i < MB_THREAD_MAX; i++) {
+    if (threads[i].grid_first != NULL)
+      mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&threads[i].grid_first, &mbev_error);
+    if (threads[i].grid_sum != NULL)
+      mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&threads[i].grid_sum, &mbev_error);
+    if (threads[i].grid_sum2 != NULL)
+      mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&threads[i].grid_sum2, &mbev_error);
+    if (threads[i].grid_num != NULL)
+      mb_freed(mbev_verbose, __FILE__, __LINE__, (void **)&threads[i].grid_num, &mbev_error);
+  }
+  mbeditviz_bias_model_free(&model);
+
+  /* apply the best bias values to the selected soundings */
   mbeditviz_mb3dsoundings_bias(*rollbias_best, *pitchbias_best, *headingbias_best, *timelag_best, *snell_best);
 
   if (mbev_verbose >= 2) {
@@ -5034,89 +5167,3 @@ void mbeditviz_mb3dsoundings_optimizebiasvalues(int mode, double *rollbias_best,
   }
 }
 /*--------------------------------------------------------------------*/
-void mbeditviz_mb3dsoundings_getbiasvariance(double local_grid_xmin, double local_grid_xmax, double local_grid_ymin,
-                                             double local_grid_ymax, int local_grid_n_columns, int local_grid_n_rows, double local_grid_dx,
-                                             double local_grid_dy, double *local_grid_first, double *local_grid_sum,
-                                             double *local_grid_sum2, double *local_grid_variance, int *local_grid_num,
-                                             double rollbias, double pitchbias, double headingbias, double timelag, double snell,
-                                             int *variance_total_num, double *variance_total) {
-  if (mbev_verbose >= 2) {
-    fprintf(stderr, "\ndbg2  Function <%s> called\n", __func__);
-    fprintf(stderr, "dbg2  Input arguments:\n");
-    fprintf(stderr, "dbg2       local_grid_xmin:     %f\n", local_grid_xmin);
-    fprintf(stderr, "dbg2       local_grid_xmax:     %f\n", local_grid_xmax);
-    fprintf(stderr, "dbg2       local_grid_ymin:     %f\n", local_grid_ymin);
-    fprintf(stderr, "dbg2       local_grid_ymax:     %f\n", local_grid_ymax);
-    fprintf(stderr, "dbg2       local_grid_n_columns:       %d\n", local_grid_n_columns);
-    fprintf(stderr, "dbg2       local_grid_n_rows:       %d\n", local_grid_n_rows);
-    fprintf(stderr, "dbg2       local_grid_dx:       %f\n", local_grid_dx);
-    fprintf(stderr, "dbg2       local_grid_dy:       %f\n", local_grid_dy);
-    fprintf(stderr, "dbg2       local_grid_first:    %p\n", local_grid_first);
-    fprintf(stderr, "dbg2       local_grid_sum:      %p\n", local_grid_sum);
-    fprintf(stderr, "dbg2       local_grid_sum2:     %p\n", local_grid_sum2);
-    fprintf(stderr, "dbg2       local_grid_variance: %p\n", local_grid_variance);
-    fprintf(stderr, "dbg2       local_grid_num:      %p\n", local_grid_num);
-    fprintf(stderr, "dbg2       rollbias:            %f\n", rollbias);
-    fprintf(stderr, "dbg2       pitchbias:           %f\n", pitchbias);
-    fprintf(stderr, "dbg2       headingbias:         %f\n", headingbias);
-    fprintf(stderr, "dbg2       timelag:             %f\n", timelag);
-    fprintf(stderr, "dbg2       snell:               %f\n", snell);
-  }
-
-  /* apply the current bias parameters to the selected soundings */
-  mbeditviz_mb3dsoundings_bias(rollbias, pitchbias, headingbias, timelag, snell);
-
-  /* initialize variance */
-  *variance_total = 0.0;
-  *variance_total_num = 0;
-  const size_t size_double = local_grid_n_columns * local_grid_n_rows * sizeof(double);
-  const size_t size_int = local_grid_n_columns * local_grid_n_rows * sizeof(int);
-  memset(local_grid_first, 0, size_double);
-  memset(local_grid_sum, 0, size_double);
-  memset(local_grid_sum2, 0, size_double);
-  memset(local_grid_variance, 0, size_double);
-  memset(local_grid_num, 0, size_int);
-
-  /* calculate variance of soundings in each bin, and then the total variance */
-  for (int isounding = 0; isounding < mbev_selected.num_soundings; isounding++) {
-    struct mb3dsoundings_sounding_struct *sounding = &mbev_selected.soundings[isounding];
-    if (mb_beam_ok(sounding->beamflag)) {
-      const int i = (sounding->x - local_grid_xmin) / local_grid_dx;
-      const int j = (sounding->y - local_grid_ymin) / local_grid_dy;
-      if (i >= 0 && i < local_grid_n_columns && j >= 0 && j < local_grid_n_rows) {
-        const int k = i * local_grid_n_rows + j;
-        if (local_grid_num[k] == 0)
-          local_grid_first[k] = sounding->z;
-        const double z = sounding->z - local_grid_first[k];
-        local_grid_sum[k] += z;
-        local_grid_sum2[k] += z * z;
-        local_grid_num[k] += 1;
-      }
-    }
-  }
-  for (int i = 0; i < local_grid_n_columns; i++) {
-    for (int j = 0; j < local_grid_n_rows; j++) {
-      const int k = i * local_grid_n_rows + j;
-      if (local_grid_num[k] > 0) {
-        local_grid_variance[k] =
-            (local_grid_sum2[k] - (local_grid_sum[k] * local_grid_sum[k] / local_grid_num[k])) / local_grid_num[k];
-        (*variance_total_num)++;
-        (*variance_total) += local_grid_variance[k];
-      }
-    }
-  }
-  if (*variance_total_num > 0)
-    (*variance_total) /= (*variance_total_num);
-  // fprintf(stderr,"variance_total_num:%d variance_total:%f\n",*variance_total_num,*variance_total);
-
-  if (mbev_verbose >= 2) {
-    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
-    fprintf(stderr, "dbg2  Return values:\n");
-    fprintf(stderr, "dbg2       error:               %d\n", mbev_error);
-    fprintf(stderr, "dbg2       variance_total_num:  %d\n", *variance_total_num);
-    fprintf(stderr, "dbg2       variance_total:      %f\n", *variance_total);
-    fprintf(stderr, "dbg2  Return status:\n");
-    fprintf(stderr, "dbg2       mbev_status:         %d\n", mbev_status);
-  }
-}
-/*--------------------------------------------------------------------*/
@@ -166,6 +166,53 @@ namespace stoqs
 		_spacing[1] = std::labs(_y_range[1] - _y_range[0]) / (double)(_dimension[1] - 1);
 	}
 
+	BathymetryReader::BathymetryReader(const Options& options) :
+	_netcdf_id(Bathymetry::get_netcdf_id(options.input_filepath().c_str()))
+	{
+		try
+		{
+			size_t side = Bathymetry::get_dimension_length(_netcdf_id, "side");
+			Bathymetry::get_variable_double_array(_netcdf_id, "x_range", _x_range, side);
+			Bathymetry::get_variable_double_array(_netcdf_id, "y_range", _y_range, side);
+			Bathymetry::get_variable_double_array(_netcdf_id, "z_range", _z_range, side);
+			Bathymetry::get_variable_double_array(_netcdf_id, "spacing", _spacing, side);
+			Bathymetry::get_variable_uint_array(_netcdf_id, "dimension", _dimension, side);
+			_z_id = Bathymetry::get_variable_id(_netcdf_id, "z");
+		}
+		catch (const std::exception&)
+		{
+			nc_close(_netcdf_id);
+
+			throw;
+		}
+
+		if (_dimension[0] < 2 || _dimension[1] < 2)
+		{
+			nc_close(_netcdf_id);
+
+			throw std::invalid_argument("bathymetry must have at least two rows and columns");
+		}
+	}
+
+	BathymetryReader::~BathymetryReader()
+	{
+		nc_close(_netcdf_id);
+	}
+
+	void BathymetryReader::read_rows(size_t y_start, size_t y_count, float *out) const
+	{
+		size_t start = y_start * _dimension[0];
+		size_t length = y_count * _dimension[0];
+		int return_value = nc_get_vara_float(_netcdf_id, _z_id, &start, &length, out);
+
+		if (return_value != NC_NOERR)
+			throw Bathymetry::NetCdfError(return_value, "failed to get float array data for rows "
+				+ std::to_string(y_start)
+				+ " to "
+				+ std::to_string(y_start + y_count - 1)
+				+ " of variable 'z'");
+	}
+
 	std::string Bathymetry::to_string() const
 	{
 		std::string out;
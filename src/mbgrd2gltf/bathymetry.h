@@ -13,6 +13,8 @@ namespace stoqs
 {
 	class Bathymetry
 	{
+		friend class BathymetryReader;
+
 	public: // types
 
 		class NetCdfError : public std::exception
@@ -83,6 +85,41 @@ namespace stoqs
 
 		std::string to_string() const;
 	};
+
+	// Reads the header of a GRD file up front and the altitudes on demand in
+	// blocks of rows, so grids larger than memory can be streamed
+	class BathymetryReader
+	{
+	private: // members
+
+		int _netcdf_id;
+		int _z_id;
+		double _x_range[2];
+		double _y_range[2];
+		double _z_range[2];
+		double _spacing[2];
+		unsigned _dimension[2];
+
+	public: // methods
+
+		BathymetryReader(const Options& options);
+		BathymetryReader(const BathymetryReader&) = delete;
+		BathymetryReader& operator=(const BathymetryReader&) = delete;
+		~BathymetryReader();
+
+		void read_rows(size_t y_start, size_t y_count, float *out) const;
+
+		inline double longitude_min() const { return _x_range[0]; }
+		inline double longitude_max() const { return _x_range[1]; }
+		inline double latitude_min() const { return _y_range[0]; }
+		inline double latitude_max() const { return _y_range[1]; }
+		inline double altitude_min() const { return _z_range[0]; }
+		inline double altitude_max() const { return _z_range[1]; }
+		inline double longitude_spacing() const { return _spacing[0]; }
+		inline double latitude_spacing() const { return _spacing[1]; }
+		inline unsigned size_x() const { return _dimension[0]; }
+		inline unsigned size_y() const { return _dimension[1]; }
+	};
 }
 
 #endif
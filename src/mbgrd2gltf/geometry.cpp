@@ -63,19 +63,13 @@ namespace stoqs
 
 		// Mimic https://github.com/GenericMappingTools/gmt/blob/be890649579be45e94269632786d08890a26dfea/src/gmt_map.c#L9094-L9108
 		// and   https://github.com/x3dom/x3dom/blob/3ace18318cd192e424546569932abfe3e1e2346a/src/nodes/Geospatial/GeoCoordinate.js#L380-L443
-		double F = 1.0 / WGS_84_INVERSE_FLATTENING;
-		double e_squared = F * ( 2.0 - F );
+		double position[3];
 
-		double sin_lon = sin(to_radians(longitude));
-		double cos_lon = cos(to_radians(longitude));
-		double sin_lat = sin(to_radians(latitude));
-		double cos_lat = cos(to_radians(latitude));
-
-		double N = WGS_84_SEMI_MAJOR_AXIS / sqrt (1.0 - e_squared * sin_lat * sin_lat);
-		double tmp = (N + altitude) * cos_lat;
-		x = tmp * cos_lon;
-		y = tmp * sin_lon;
-		z = (N * (1 - e_squared) + altitude) * sin_lat;
+		get_earth_centered_position(sin(to_radians(longitude)), cos(to_radians(longitude)),
+			sin(to_radians(latitude)), cos(to_radians(latitude)), altitude, position);
+		x = position[0];
+		y = position[1];
+		z = position[2];
 
 		//std::cerr << "WGS-84 x, y, z: " << x << ' ' << y << ' ' << z << '\n';
 		// [vagrant@localhost build]$ ./grd-to-gltf Monterey25.grd -e 10 -b
@@ -92,24 +86,53 @@ namespace stoqs
 		return Vertex(x, y, z, id);
 	}
 
+	void Geometry::get_earth_centered_position(double sin_lon, double cos_lon, double sin_lat, double cos_lat,
+		double altitude, double *out)
+	{
+		const double F = 1.0 / WGS_84_INVERSE_FLATTENING;
+		const double e_squared = F * ( 2.0 - F );
+
+		double N = WGS_84_SEMI_MAJOR_AXIS / sqrt (1.0 - e_squared * sin_lat * sin_lat);
+		double tmp = (N + altitude) * cos_lat;
+		out[0] = tmp * cos_lon;
+		out[1] = tmp * sin_lon;
+		out[2] = (N * (1 - e_squared) + altitude) * sin_lat;
+	}
+
 	Matrix<Vertex> Geometry::get_vertices(const Bathymetry& bathymetry, double vertical_exaggeration)
 	{
 		Matrix<Vertex> out(bathymetry.size_x(), bathymetry.size_y());
 		const auto& altitudes = bathymetry.altitudes();
 		uint32_t vertex_id = 1;
 
+		// the trigonometry only depends on the row or the column
+		std::vector<double> sin_lon(altitudes.size_x());
+		std::vector<double> cos_lon(altitudes.size_x());
+
+		for (size_t x = 0; x < altitudes.size_x(); ++x)
+		{
+			double theta = to_radians(get_longitude(bathymetry, x));
+			sin_lon[x] = sin(theta);
+			cos_lon[x] = cos(theta);
+		}
+
 		for (size_t y = 0; y < altitudes.size_y(); ++y)
 		{
+			double phi = to_radians(get_latitude(bathymetry, y));
+			double sin_lat = sin(phi);
+			double cos_lat = cos(phi);
+
 			for (size_t x = 0; x < altitudes.size_x(); ++x)
 			{
 				float altitude = altitudes.at(x, y);
 
 				if (!std::isnan(altitude))
 				{
-					double longitude = get_longitude(bathymetry, x);
-					double latitude = get_latitude(bathymetry, y);
 					double adjusted_altitude = (double)altitude * vertical_exaggeration;
-					out.at(x, y) = get_earth_centered_vertex(longitude, latitude, adjusted_altitude, vertex_id++);
+					double position[3];
+
+					get_earth_centered_position(sin_lon[x], cos_lon[x], sin_lat, cos_lat, adjusted_altitude, position);
+					out.at(x, y) = Vertex(position[0], position[1], position[2], vertex_id++);
 				}
 			}
 		}
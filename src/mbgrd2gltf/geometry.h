@@ -21,17 +21,20 @@ namespace stoqs
 
 	private: // methods
 
-		static double to_radians(double degrees);
 		static double get_longitude(const Bathymetry& bathymetry, size_t x);
 		static double get_latitude(const Bathymetry& bathymetry, size_t y);
 		static Vertex get_earth_centered_vertex(double longitude, double latitude, double altitude, uint32_t id);
 		static Matrix<Vertex> get_vertices(const Bathymetry& bathymetry, double vertical_exaggeration);
-		static std::vector<Triangle> get_triangles(const Matrix<Vertex>& vertices);
 
 	public: // methods
 
 		Geometry(const Bathymetry& bathymetry, const Options& options);
 
+		static double to_radians(double degrees);
+		static void get_earth_centered_position(double sin_lon, double cos_lon, double sin_lat, double cos_lat,
+			double altitude, double *out);
+		static std::vector<Triangle> get_triangles(const Matrix<Vertex>& vertices);
+
 		const Matrix<Vertex>& vertices() const { return _vertices; }
 		const std::vector<Triangle>& triangles() const { return _triangles; }
 	};
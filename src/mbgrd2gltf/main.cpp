@@ -3,6 +3,7 @@
 #include "geometry.h"
 #include "model.h"
 #include "options.h"
+#include "tiles.h"
 
 // standard library
 #include <iostream>
@@ -21,9 +22,16 @@ int main(int argc, char *argv[])
 		if (options.is_help())
 			return 0;
 
-		Bathymetry bathymetry(options);
-		Geometry geometry(bathymetry, options);
-		model::write_gltf(geometry, options);
+		if (options.is_tile_size_set())
+		{
+			tiles::write_tileset(options);
+		}
+		else
+		{
+			Bathymetry bathymetry(options);
+			Geometry geometry(bathymetry, options);
+			model::write_gltf(geometry, options);
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -181,11 +181,8 @@ namespace stoqs
 			return out;
 		}
 
-		void write_gltf(const Geometry& geometry, const Options& options)
+		tinygltf::Model get_model(const Matrix<Vertex>& vertices, const std::vector<Triangle>& triangles)
 		{
-			std::string output_filepath = options.output_filepath()
-				+ (options.is_binary_output() ? ".glb" : ".gltf");
-
 			tinygltf::Mesh mesh;
 			mesh.primitives =
 			{
@@ -198,8 +195,8 @@ namespace stoqs
 			tinygltf::Scene scene;
 			scene.nodes = { 0 };
 		
-			std::vector<float> vertex_buffer = get_vertex_buffer(geometry.vertices());
-			std::vector<uint32_t> index_buffer = get_index_buffer(geometry.triangles());
+			std::vector<float> vertex_buffer = get_vertex_buffer(vertices);
+			std::vector<uint32_t> index_buffer = get_index_buffer(triangles);
 
 			tinygltf::Model model;
 			model.scenes = { scene };
@@ -228,10 +225,33 @@ namespace stoqs
 			{
 				tinygltf::Material()
 			};
-			
+
+			return model;
+		}
+
+		void write_gltf(const Geometry& geometry, const Options& options)
+		{
+			std::string output_filepath = options.output_filepath()
+				+ (options.is_binary_output() ? ".glb" : ".gltf");
+
+			tinygltf::Model model = get_model(geometry.vertices(), geometry.triangles());
 			tinygltf::TinyGLTF gltf;
 
 			gltf.WriteGltfSceneToFile(&model, output_filepath, false, true, true, options.is_binary_output());
 		}
+
+		// writes one tile whose vertices are relative to the translation of its
+		// node, which keeps float precision for earth centered coordinates
+		void write_gltf(const Matrix<Vertex>& vertices, const std::vector<Triangle>& triangles,
+			const double *translation, const std::string& filepath, bool is_binary_output)
+		{
+			tinygltf::Model model = get_model(vertices, triangles);
+			model.nodes[0].translation = { translation[0], translation[1], translation[2] };
+
+			tinygltf::TinyGLTF gltf;
+
+			if (!gltf.WriteGltfSceneToFile(&model, filepath, false, true, true, is_binary_output))
+				throw std::runtime_error("failed to write tile: " + filepath);
+		}
 	}
 }
@@ -10,6 +10,8 @@ namespace stoqs
 	namespace model
 	{
 		void write_gltf(const Geometry& geometry, const Options& options);
+		void write_gltf(const Matrix<Vertex>& vertices, const std::vector<Triangle>& triangles,
+			const double *translation, const std::string& filepath, bool is_binary_output);
 	}
 }
 
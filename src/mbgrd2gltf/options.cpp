@@ -1,5 +1,6 @@
 #include "options.h"
 
+#include <cmath>
 #include <vector>
 #include <stdexcept>
 #include <iostream>
@@ -14,7 +15,9 @@
 const char * const usage_str =	  "usage: mbgrd2gltf <filepath> [-b | --binary] [(-o | --output) <output folder>]"\
 								"\n                              [(-e | --exaggeration) <vertical exaggeration>]"\
 								"\n                              [(-m | --max-size) <max size>]"\
-								"\n                              [(-c | --compression) <compression ratio>]";
+								"\n                              [(-c | --compression) <compression ratio>]"\
+								"\n                              [(-t | --tile-size) <tile size>]"\
+								"\n                              [(-j | --threads) <threads>]";
 
 const char * const help_str =	"\nvariables:"\
 								"\n"\
@@ -34,7 +37,15 @@ const char * const help_str =	"\nvariables:"\
 								"\n    <compression ratio>       decimal number representing the the amount"\
 								"\n                              of compression to apply to the buffer data of the"\
 								"\n                              output as a ratio of uncompressed size to"\
-								"\n                              compressed size";
+								"\n                              compressed size"\
+								"\n"\
+								"\n    <tile size>               number of grid cells along each side of a tile;"\
+								"\n                              when set, the grid is streamed in blocks of rows"\
+								"\n                              and written to the output folder as a quadtree of"\
+								"\n                              tiles with decimated levels of detail and a 3D"\
+								"\n                              Tiles tileset.json, instead of one glTF file"\
+								"\n"\
+								"\n    <threads>                 number of threads generating tiles in parallel";
 
 const char * const try_help_str = "try 'mbgrd2gltf [-h | --help]' for more information";
 
@@ -63,7 +74,11 @@ namespace stoqs
 		{ "-m", &Options::arg_max_size },
 		{ "--max-size", &Options::arg_max_size },
 		{ "-o", &Options::arg_output },
-		{ "--output", &Options::arg_output }
+		{ "--output", &Options::arg_output },
+		{ "-t", &Options::arg_tile_size },
+		{ "--tile-size", &Options::arg_tile_size },
+		{ "-j", &Options::arg_threads },
+		{ "--threads", &Options::arg_threads }
 	};
 
 	double parse_value(const char *token, const char *var_name)
@@ -123,6 +138,9 @@ namespace stoqs
 		if (_is_max_size_set > 0)
 			throw std::invalid_argument("compression ratio may not be set when max size is set");
 
+		if (_is_tile_size_set)
+			throw std::invalid_argument("compression ratio may not be set when tile size is set");
+
 		double value = get_value_double(args, size, i, "compression ratio");
 
 		if (value < 1.0)
@@ -141,6 +159,9 @@ namespace stoqs
 		if (_is_compression_set)
 			throw std::invalid_argument("max size may not be set when compression ratio is set");
 
+		if (_is_tile_size_set)
+			throw std::invalid_argument("max size may not be set when tile size is set");
+
 
 		double value = get_value_double(args, size, i, "max size");		
 		if (value < 0.0001)
@@ -167,6 +188,39 @@ namespace stoqs
 		_is_exaggeration_set = true;
 	}
 
+	void Options::arg_tile_size(const char **args, unsigned size, unsigned& i)
+	{
+		if (_is_tile_size_set)
+			throw std::invalid_argument("tile size may not be specified more than once");
+
+		if (_is_compression_set || _is_max_size_set)
+			throw std::invalid_argument("tile size may not be set when compression ratio or max size is set");
+
+		double value = get_value_double(args, size, i, "tile size");
+
+		if (value < 2.0 || value != std::floor(value))
+			throw std::invalid_argument("expected integer tile size >= 2 but got: "
+				+ std::to_string(value));
+
+		_tile_size = (size_t)value;
+		_is_tile_size_set = true;
+	}
+
+	void Options::arg_threads(const char **args, unsigned size, unsigned& i)
+	{
+		if (_is_thread_count_set)
+			throw std::invalid_argument("threads may not be specified more than once");
+
+		double value = get_value_double(args, size, i, "threads");
+
+		if (value < 1.0 || value != std::floor(value))
+			throw std::invalid_argument("expected integer threads >= 1 but got: "
+				+ std::to_string(value));
+
+		_thread_count = (unsigned)value;
+		_is_thread_count_set = true;
+	}
+
 	PathInfo get_path_info(const char *filepath)
 	{
 		const char *start_of_filename = filepath;
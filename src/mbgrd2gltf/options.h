@@ -20,12 +20,16 @@ namespace stoqs
 		double _compression_ratio = 1.0;
 		size_t _max_size = 0;
 		double _exaggeration = 1.0;
+		size_t _tile_size = 0;
+		unsigned _thread_count = 1;
 		bool _is_binary_output = false;
 		bool _is_help = false;
 		bool _is_compression_set = false;
 		bool _is_max_size_set = false;
 		bool _is_exaggeration_set = false;
 		bool _is_output_folder_set = false;
+		bool _is_tile_size_set = false;
+		bool _is_thread_count_set = false;
 
 		static const std::unordered_map<std::string, ArgCallback> arg_callbacks;
 
@@ -36,6 +40,8 @@ namespace stoqs
 		void arg_compression(const char **args, unsigned size, unsigned& i);
 		void arg_max_size(const char **args, unsigned size, unsigned& i);
 		void arg_exaggeration(const char **args, unsigned size, unsigned& i);
+		void arg_tile_size(const char **args, unsigned size, unsigned& i);
+		void arg_threads(const char **args, unsigned size, unsigned& i);
 
 	public: // members
 
@@ -46,12 +52,16 @@ namespace stoqs
 		double compression_ratio() const { return _compression_ratio; }
 		size_t max_size() const { return _max_size; }
 		double exaggeration() const { return _exaggeration; }
+		size_t tile_size() const { return _tile_size; }
+		unsigned thread_count() const { return _thread_count; }
 		bool is_binary_output() const { return _is_binary_output; }
 		bool is_help() const { return _is_help; }
 		bool is_compression_set() const { return _is_compression_set; }
 		bool is_max_size_set() const { return _is_max_size_set; }
 		bool is_exaggeration_set() const { return _is_exaggeration_set; }
 		bool is_output_folder_set() const { return _is_output_folder_set; }
+		bool is_tile_size_set() const { return _is_tile_size_set; }
+		bool is_thread_count_set() const { return _is_thread_count_set; }
 	};
 }
 
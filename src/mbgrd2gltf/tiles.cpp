@@ -0,0 +1,429 @@
+#include "tiles.h"
+
+// local includes
+#include "bathymetry.h"
+#include "geometry.h"
+#include "model.h"
+
+// standard library
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32) || defined(WIN32) || defined(WIN64)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// external libraries
+#include "tinygltf/json.hpp"
+
+#define METERS_PER_DEGREE 111319.49
+
+namespace stoqs
+{
+	namespace tiles
+	{
+		struct Tile
+		{
+			double region[6];	// west, south, east, north (radians), min & max height
+			bool has_content = false;
+		};
+
+		// Level 0 is the single root tile; every following level halves the step
+		// between the grid nodes it samples, down to the full grid resolution.
+		// The last row and column of the grid are sampled at every level so the
+		// levels cover the same extent. A level keeps only one band of
+		// tile_size + 1 sample rows, the last row of which is shared with the
+		// next band.
+		struct Level
+		{
+			size_t step;
+			size_t sample_count[2];
+			size_t tile_count[2];
+			double geometric_error;
+			std::vector<size_t> x_nodes;
+			std::vector<double> sin_lon;
+			std::vector<double> cos_lon;
+			Matrix<float> band;
+			std::vector<size_t> band_nodes;
+			size_t band_row_count = 0;
+			size_t band_index = 0;
+			std::vector<Tile> tiles;
+		};
+
+		struct Context
+		{
+			const Options& options;
+			const BathymetryReader& reader;
+			std::string folder;
+			size_t tile_size;
+			unsigned thread_count;
+		};
+
+		size_t get_sample_count(size_t node_count, size_t step)
+		{
+			return (node_count - 1 + step - 1) / step + 1;
+		}
+
+		size_t get_tile_count(size_t sample_count, size_t tile_size)
+		{
+			return (sample_count - 1 + tile_size - 1) / tile_size;
+		}
+
+		double get_longitude(const BathymetryReader& reader, size_t x)
+		{
+			return reader.longitude_min() + reader.longitude_spacing() * (double)x;
+		}
+
+		double get_latitude(const BathymetryReader& reader, size_t y)
+		{
+			return reader.latitude_max() - reader.latitude_spacing() * (double)y;
+		}
+
+		void make_directory(const std::string& path)
+		{
+			#if defined(_WIN32) || defined(WIN32) || defined(WIN64)
+			int return_value = _mkdir(path.c_str());
+			#else
+			int return_value = mkdir(path.c_str(), 0755);
+			#endif
+
+			if (return_value != 0 && errno != EEXIST)
+				throw std::runtime_error("failed to create folder: " + path);
+		}
+
+		std::string get_tile_path(size_t level, size_t x, size_t y, bool is_binary_output)
+		{
+			return std::to_string(level) + "/" + std::to_string(x) + "_" + std::to_string(y)
+				+ (is_binary_output ? ".glb" : ".gltf");
+		}
+
+		std::vector<Level> get_levels(const Context& context)
+		{
+			const size_t size_x = context.reader.size_x();
+			const size_t size_y = context.reader.size_y();
+			const size_t tile_size = context.tile_size;
+
+			// the root step is the smallest power of two fitting the grid in one tile
+			size_t root_step = 1;
+			size_t level_count = 1;
+
+			while (size_x - 1 > tile_size * root_step || size_y - 1 > tile_size * root_step)
+			{
+				root_step *= 2;
+				level_count += 1;
+			}
+
+			double latitude_middle = 0.5 * (context.reader.latitude_min() + context.reader.latitude_max());
+			double node_spacing = METERS_PER_DEGREE * std::max(context.reader.latitude_spacing(),
+				context.reader.longitude_spacing() * std::cos(Geometry::to_radians(latitude_middle)));
+
+			std::vector<Level> out(level_count);
+
+			for (size_t i = 0; i < level_count; ++i)
+			{
+				Level& level = out[i];
+
+				level.step = root_step >> i;
+				level.sample_count[0] = get_sample_count(size_x, level.step);
+				level.sample_count[1] = get_sample_count(size_y, level.step);
+				level.tile_count[0] = get_tile_count(level.sample_count[0], tile_size);
+				level.tile_count[1] = get_tile_count(level.sample_count[1], tile_size);
+				level.geometric_error = i + 1 < level_count ? node_spacing * (double)level.step : 0.0;
+				level.x_nodes.resize(level.sample_count[0]);
+				level.sin_lon.resize(level.sample_count[0]);
+				level.cos_lon.resize(level.sample_count[0]);
+
+				for (size_t x = 0; x < level.sample_count[0]; ++x)
+				{
+					size_t node = std::min(x * level.step, size_x - 1);
+					double theta = Geometry::to_radians(get_longitude(context.reader, node));
+
+					level.x_nodes[x] = node;
+					level.sin_lon[x] = std::sin(theta);
+					level.cos_lon[x] = std::cos(theta);
+				}
+
+				level.band = Matrix<float>(level.sample_count[0], tile_size + 1);
+				level.band_nodes.resize(tile_size + 1);
+				level.tiles.resize(level.tile_count[0] * level.tile_count[1]);
+			}
+
+			return out;
+		}
+
+		void write_tile(const Context& context, Level& level, size_t level_index, size_t tile_x,
+			const std::vector<double>& sin_lat, const std::vector<double>& cos_lat)
+		{
+			const double exaggeration = context.options.exaggeration();
+			const size_t x_start = tile_x * context.tile_size;
+			const size_t x_end = std::min(x_start + context.tile_size, level.sample_count[0] - 1);
+			const size_t y_end = level.band_row_count - 1;
+			Tile& tile = level.tiles[level.band_index * level.tile_count[0] + tile_x];
+
+			double west = get_longitude(context.reader, level.x_nodes[x_start]);
+			double east = get_longitude(context.reader, level.x_nodes[x_end]);
+			double north = get_latitude(context.reader, level.band_nodes[0]);
+			double south = get_latitude(context.reader, level.band_nodes[y_end]);
+
+			// vertices are stored relative to the tile center, rotated from the
+			// earth centered z up frame into the y up frame of glTF
+			double center[3];
+			double theta = Geometry::to_radians(0.5 * (west + east));
+			double phi = Geometry::to_radians(0.5 * (north + south));
+			Geometry::get_earth_centered_position(std::sin(theta), std::cos(theta), std::sin(phi), std::cos(phi),
+				0.0, center);
+
+			Matrix<Vertex> vertices(x_end - x_start + 1, y_end + 1);
+			uint32_t vertex_id = 1;
+			double altitude_min = INFINITY;
+			double altitude_max = -INFINITY;
+
+			for (size_t y = 0; y <= y_end; ++y)
+			{
+				for (size_t x = x_start; x <= x_end; ++x)
+				{
+					float altitude = level.band.at(x, y);
+
+					if (!std::isnan(altitude))
+					{
+						double adjusted_altitude = (double)altitude * exaggeration;
+						double position[3];
+
+						Geometry::get_earth_centered_position(level.sin_lon[x], level.cos_lon[x], sin_lat[y], cos_lat[y],
+							adjusted_altitude, position);
+						vertices.at(x - x_start, y) = Vertex(position[0] - center[0], position[2] - center[2],
+							center[1] - position[1], vertex_id++);
+						altitude_min = std::min(altitude_min, adjusted_altitude);
+						altitude_max = std::max(altitude_max, adjusted_altitude);
+					}
+				}
+			}
+
+			if (vertex_id == 1)
+			{
+				altitude_min = context.reader.altitude_min() * exaggeration;
+				altitude_max = context.reader.altitude_max() * exaggeration;
+			}
+
+			tile.region[0] = Geometry::to_radians(west);
+			tile.region[1] = Geometry::to_radians(south);
+			tile.region[2] = Geometry::to_radians(east);
+			tile.region[3] = Geometry::to_radians(north);
+			tile.region[4] = std::min(altitude_min, altitude_max);
+			tile.region[5] = std::max(altitude_min, altitude_max);
+
+			std::vector<Triangle> triangles = Geometry::get_triangles(vertices);
+
+			if (triangles.empty())
+				return;
+
+			double translation[3] = { center[0], center[2], -center[1] };
+			std::string filepath = context.folder
+				+ get_tile_path(level_index, tile_x, level.band_index, context.options.is_binary_output());
+
+			model::write_gltf(vertices, triangles, translation, filepath, context.options.is_binary_output());
+			tile.has_content = true;
+		}
+
+		// writes every tile of the current band of a level, spreading the tiles
+		// over the threads
+		void write_band(const Context& context, Level& level, size_t level_index)
+		{
+			std::vector<double> sin_lat(level.band_row_count);
+			std::vector<double> cos_lat(level.band_row_count);
+
+			for (size_t y = 0; y < level.band_row_count; ++y)
+			{
+				double phi = Geometry::to_radians(get_latitude(context.reader, level.band_nodes[y]));
+				sin_lat[y] = std::sin(phi);
+				cos_lat[y] = std::cos(phi);
+			}
+
+			std::atomic<size_t> next_tile(0);
+			std::exception_ptr error;
+			std::mutex error_mutex;
+
+			auto worker = [&]()
+			{
+				for (size_t x = next_tile++; x < level.tile_count[0]; x = next_tile++)
+				{
+					try
+					{
+						write_tile(context, level, level_index, x, sin_lat, cos_lat);
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(error_mutex);
+
+						if (!error)
+							error = std::current_exception();
+					}
+				}
+			};
+
+			size_t thread_count = std::min((size_t)context.thread_count, level.tile_count[0]);
+			std::vector<std::thread> threads;
+
+			for (size_t i = 1; i < thread_count; ++i)
+				threads.emplace_back(worker);
+
+			worker();
+
+			for (auto& thread : threads)
+				thread.join();
+
+			if (error)
+				std::rethrow_exception(error);
+		}
+
+		void add_row(Level& level, size_t node, const float *row)
+		{
+			size_t y = level.band_row_count++;
+
+			for (size_t x = 0; x < level.sample_count[0]; ++x)
+				level.band.at(x, y) = row[level.x_nodes[x]];
+
+			level.band_nodes[y] = node;
+		}
+
+		// the last row of a written band starts the next one
+		void next_band(Level& level)
+		{
+			size_t y = level.band_row_count - 1;
+
+			for (size_t x = 0; x < level.sample_count[0]; ++x)
+				level.band.at(x, 0) = level.band.at(x, y);
+
+			level.band_nodes[0] = level.band_nodes[y];
+			level.band_row_count = 1;
+			level.band_index += 1;
+		}
+
+		// builds the tile hierarchy, widening the height range of each tile to
+		// enclose its children
+		nlohmann::json get_tile_json(std::vector<Level>& levels, size_t level_index, size_t x, size_t y,
+			bool is_binary_output)
+		{
+			Level& level = levels[level_index];
+			Tile& tile = level.tiles[y * level.tile_count[0] + x];
+			nlohmann::json children = nlohmann::json::array();
+
+			if (level_index + 1 < levels.size())
+			{
+				const Level& child_level = levels[level_index + 1];
+
+				for (size_t child_y = 2 * y; child_y < std::min(2 * y + 2, child_level.tile_count[1]); ++child_y)
+				{
+					for (size_t child_x = 2 * x; child_x < std::min(2 * x + 2, child_level.tile_count[0]); ++child_x)
+					{
+						children.push_back(get_tile_json(levels, level_index + 1, child_x, child_y, is_binary_output));
+
+						const Tile& child = child_level.tiles[child_y * child_level.tile_count[0] + child_x];
+						tile.region[4] = std::min(tile.region[4], child.region[4]);
+						tile.region[5] = std::max(tile.region[5], child.region[5]);
+					}
+				}
+			}
+
+			nlohmann::json out;
+			out["boundingVolume"]["region"] = std::vector<double>(tile.region, tile.region + 6);
+			out["geometricError"] = level.geometric_error;
+
+			if (tile.has_content)
+				out["content"]["uri"] = get_tile_path(level_index, x, y, is_binary_output);
+
+			if (!children.empty())
+				out["children"] = children;
+
+			return out;
+		}
+
+		void write_tileset_json(const Context& context, std::vector<Level>& levels)
+		{
+			nlohmann::json tileset;
+			tileset["asset"]["version"] = "1.1";
+			tileset["asset"]["generator"] = "mbgrd2gltf";
+			tileset["geometricError"] = 2.0 * levels[0].geometric_error;
+			tileset["root"] = get_tile_json(levels, 0, 0, 0, context.options.is_binary_output());
+			tileset["root"]["refine"] = "REPLACE";
+
+			std::string filepath = context.folder + "tileset.json";
+			std::ofstream file(filepath);
+
+			if (!file)
+				throw std::runtime_error("failed to open tileset: " + filepath);
+
+			file << tileset.dump(1) << std::endl;
+		}
+
+		void write_tileset(const Options& options)
+		{
+			BathymetryReader reader(options);
+
+			Context context
+			{
+				options,
+				reader,
+				options.output_filepath() + "/",
+				options.tile_size(),
+				options.thread_count()
+			};
+
+			std::vector<Level> levels = get_levels(context);
+
+			make_directory(options.output_filepath());
+
+			for (size_t i = 0; i < levels.size(); ++i)
+				make_directory(context.folder + std::to_string(i));
+
+			// stream the grid one block of rows at a time, handing every row to
+			// the levels that sample it and writing each band as it fills
+			const size_t size_x = reader.size_x();
+			const size_t size_y = reader.size_y();
+			const size_t block_row_count = context.tile_size;
+			std::vector<float> block(block_row_count * size_x);
+
+			for (size_t block_start = 0; block_start < size_y; block_start += block_row_count)
+			{
+				size_t row_count = std::min(block_row_count, size_y - block_start);
+
+				reader.read_rows(block_start, row_count, block.data());
+
+				for (size_t i = 0; i < row_count; ++i)
+				{
+					size_t node = block_start + i;
+					bool is_last_row = node == size_y - 1;
+
+					for (size_t level_index = 0; level_index < levels.size(); ++level_index)
+					{
+						Level& level = levels[level_index];
+
+						if (node % level.step != 0 && !is_last_row)
+							continue;
+
+						add_row(level, node, &block[i * size_x]);
+
+						if (level.band_row_count == context.tile_size + 1 || is_last_row)
+						{
+							write_band(context, level, level_index);
+
+							if (!is_last_row)
+								next_band(level);
+						}
+					}
+				}
+			}
+
+			write_tileset_json(context, levels);
+		}
+	}
+}
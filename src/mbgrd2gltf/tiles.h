@@ -0,0 +1,15 @@
+#ifndef TILES_H
+#define TILES_H
+
+// local includes
+#include "options.h"
+
+namespace stoqs
+{
+	namespace tiles
+	{
+		void write_tileset(const Options& options);
+	}
+}
+
+#endif
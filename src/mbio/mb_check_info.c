@@ -592,6 +592,32 @@ bool mb_should_make_fnv(int verbose, int format) {
 }
 /*--------------------------------------------------------------------*/
 
+bool mb_should_make_index(int verbose, int format) {
+  bool result = false;
+
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+		fprintf(stderr, "dbg2  Input arguments:\n");
+		fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+		fprintf(stderr, "dbg2       format:     %d\n", format);
+	}
+
+  /* only formats whose drivers read each record from the current file
+      position, without state carried over from earlier records, can be
+      positioned using a record index */
+  if (format == MBF_MBLDEOIH)
+    result = true;
+
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+		fprintf(stderr, "dbg2  Return result:\n");
+		fprintf(stderr, "dbg2       result:     %d\n", result);
+	}
+
+	return (result);
+}
+/*--------------------------------------------------------------------*/
+
 int mb_make_info(int verbose, bool force, char *file, int format, int *error) {
 	if (verbose >= 2) {
 		fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
@@ -609,6 +635,8 @@ int mb_make_info(int verbose, bool force, char *file, int format, int *error) {
 	sprintf(fbtfile, "%s.fbt", file);
 	char fnvfile[MB_PATH_MAXLINE];
 	sprintf(fnvfile, "%s.fnv", file);
+	char idxfile[MB_PATH_MAXLINE];
+	sprintf(idxfile, "%s.idx", file);
 
 	int fstat;
 	struct stat file_status;
@@ -628,6 +656,10 @@ int mb_make_info(int verbose, bool force, char *file, int format, int *error) {
 	if ((fstat = stat(fnvfile, &file_status)) == 0 && (file_status.st_mode & S_IFMT) != S_IFDIR && file_status.st_size > 0) {
 		fnvmodtime = file_status.st_mtime;
 	}
+	int idxmodtime = 0;
+	if ((fstat = stat(idxfile, &file_status)) == 0 && (file_status.st_mode & S_IFMT) != S_IFDIR && file_status.st_size > 0) {
+		idxmodtime = file_status.st_mtime;
+	}
 
 	int status = MB_SUCCESS;
 	int shellstatus = 0;
@@ -670,6 +702,15 @@ int mb_make_info(int verbose, bool force, char *file, int format, int *error) {
       status = MB_FAILURE;
 	}
 
+	/* make new idx file if not there or out of date */
+	if ((force || (datmodtime > 0 && datmodtime > idxmodtime)) && mb_should_make_index(verbose, format)) {
+		if (verbose >= 1)
+			fprintf(stderr, "Generating idx file for %s\n", file);
+		int idx_error = MB_ERROR_NO_ERROR;
+		if (mb_make_index(verbose, file, format, &idx_error) != MB_SUCCESS)
+			status = MB_FAILURE;
+	}
+
 	if (verbose >= 2) {
 		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
 		fprintf(stderr, "dbg2  Return values:\n");
@@ -65,6 +65,8 @@ int mb_close(int verbose, void **mbio_ptr, int *error) {
     status &= mb_freed(verbose, __FILE__, __LINE__, (void **)&mb_io_ptr->xdrs3, error);
   if (mb_io_ptr->hdr_comment != NULL)
     status &= mb_freed(verbose, __FILE__, __LINE__, (void **)&mb_io_ptr->hdr_comment, error);
+  if (mb_io_ptr->fileindex != NULL)
+    status &= mb_freed(verbose, __FILE__, __LINE__, (void **)&mb_io_ptr->fileindex, error);
   status &= mb_deall_ioarrays(verbose, *mbio_ptr, error);
 
   /* close the files if normal */
@@ -309,11 +309,14 @@ int mb_get_basename(int verbose, char *path, int *error);
 int mb_check_info(int verbose, char *file, int lonflip, double bounds[4], bool *file_in_bounds, int *error);
 bool mb_should_make_fbt(int verbose, int format);
 bool mb_should_make_fnv(int verbose, int format);
+bool mb_should_make_index(int verbose, int format);
 int mb_make_info(int verbose, bool force, char *file, int format, int *error);
 int mb_get_fbt(int verbose, char *file, int *format, int *error);
 int mb_get_fnv(int verbose, char *file, int *format, int *error);
 int mb_get_ffa(int verbose, char *file, int *format, int *error);
 int mb_get_ffs(int verbose, char *file, int *format, int *error);
+int mb_make_index(int verbose, char *file, int format, int *error);
+int mb_read_index(int verbose, void *mbio_ptr, int *error);
 int mb_swathbounds(int verbose, int checkgood, int nbath, int nss,
                   char *beamflag, double *bathacrosstrack,
                   double *ss, double *ssacrosstrack,
@@ -335,6 +338,8 @@ int mb_write_init(int verbose, char *file, int format, void **mbio_ptr, int *bea
                   int *error);
 int mb_close(int verbose, void **mbio_ptr, int *error);
 int mb_read_ping(int verbose, void *mbio_ptr, void *store_ptr, int *kind, int *error);
+int mb_read_seek_ping(int verbose, void *mbio_ptr, int ping, int *error);
+int mb_read_seek_time(int verbose, void *mbio_ptr, double time_d, int *error);
 int mb_get_all(int verbose, void *mbio_ptr, void **store_ptr, int *kind, int time_i[7], double *time_d, double *navlon,
                   double *navlat, double *speed, double *heading, double *distance, double *altitude, double *sonardepth, int *nbath,
                   int *namp, int *nss, char *beamflag, double *bath, double *amp, double *bathacrosstrack, double *bathalongtrack,
@@ -357,6 +362,9 @@ int mb_fileio_open(int verbose, void *mbio_ptr, int *error);
 int mb_fileio_close(int verbose, void *mbio_ptr, int *error);
 int mb_fileio_get(int verbose, void *mbio_ptr, char *buffer, size_t *size, int *error);
 int mb_fileio_put(int verbose, void *mbio_ptr, char *buffer, size_t *size, int *error);
+int mb_fileio_map(int verbose, void *mbio_ptr, char **buffer, size_t *size, int *error);
+long mb_fileio_tell(int verbose, void *mbio_ptr);
+int mb_fileio_seek(int verbose, void *mbio_ptr, long offset, int whence);
 int mb_alloc(int verbose, void *mbio_ptr, void **store_ptr, int *error);
 int mb_deall(int verbose, void *mbio_ptr, void **store_ptr, int *error);
 int mb_get_store(int verbose, void *mbio_ptr, void **store_ptr, int *error);
@@ -671,6 +679,8 @@ int mb_rt(int verbose, void *modelptr, double source_depth, double source_angle,
           double surface_vel, double null_angle, int nplot_max,
           int *nplot, double *xplot, double *zplot, double *tplot,
           double *x, double *z, double *travel_time, int *ray_stat, int *error);
+int mb_rt_table_init(int verbose, void *modelptr, double tolerance, int *error);
+int mb_rt_table_stats(int verbose, void *modelptr, int *nlookup, int *nexact, int *error);
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -22,12 +22,29 @@
  *   mb_fileio_close  - cleanup i/o, called by mb_close()
  *   mb_fileio_get  - get bytes from input
  *   mb_fileio_put  - put bytes to output
+ *   mb_fileio_map  - get a pointer to bytes of a memory mapped input file
+ *   mb_fileio_tell - get the current file position
+ *   mb_fileio_seek - set the current file position
+ *
+ * When the fileiobuffer default (see mbdefaults) is negative and the format
+ * driver has set mb_io_ptr->file_mmap_ok, input files are memory mapped
+ * read-only. The FILE pointer mbfp remains open so that code testing it
+ * for NULL behaves as before, but the read position is then carried in
+ * mb_io_ptr->file_mmap_pos, so drivers supporting mmap must position the
+ * input with mb_fileio_seek() and mb_fileio_tell() rather than fseek()
+ * and ftell(). Drivers may also call mb_fileio_map() to obtain a pointer
+ * directly into the mapped file and parse records in place.
  *
  * Author:  D. W. Caress
  * Date:  23 May 2012
  */
 
 #include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "mb_define.h"
 #include "mb_io.h"
@@ -69,8 +86,32 @@ int mb_fileio_open(int verbose, void *mbio_ptr, int *error) {
                       >0  use fread() and fwrite() with user defined buffer
                       <0  use mmap for file i/o */
   int fileiobuffer;
+  mb_io_ptr->file_mmap = NULL;
+  mb_io_ptr->file_mmap_size = 0;
+  mb_io_ptr->file_mmap_pos = 0;
   if (status == MB_SUCCESS) {
     mb_fileiobuffer(verbose, &fileiobuffer);
+#ifndef _WIN32
+    /* map input files if requested and supported by the format driver,
+        falling back to stdio if the file cannot be mapped */
+    if (fileiobuffer < 0 && mb_io_ptr->filemode == MB_FILEMODE_READ && mb_io_ptr->file_mmap_ok) {
+      struct stat file_status;
+      const int fd = fileno(mb_io_ptr->mbfp);
+      if (fstat(fd, &file_status) == 0 && S_ISREG(file_status.st_mode) && file_status.st_size > 0) {
+        void *map = mmap(NULL, (size_t)file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+          mb_io_ptr->file_mmap = (char *)map;
+          mb_io_ptr->file_mmap_size = (size_t)file_status.st_size;
+          mb_io_ptr->file_mmap_pos = 0;
+          madvise(map, mb_io_ptr->file_mmap_size, MADV_SEQUENTIAL);
+          madvise(map, mb_io_ptr->file_mmap_size, MADV_WILLNEED);
+        }
+        else if (verbose > 0) {
+          fprintf(stderr, "\nUnable to mmap file %s, using fread() instead\n", mb_io_ptr->file);
+        }
+      }
+    }
+#endif
     if (fileiobuffer > 0) {
       /* the buffer size must be a multiple of 512, plus 8 to be efficient */
       const size_t fileiobufferbytes = (fileiobuffer * 1024) + 8;
@@ -90,6 +131,8 @@ int mb_fileio_open(int verbose, void *mbio_ptr, int *error) {
   if (verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
     fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       file_mmap:  %p\n", (void *)mb_io_ptr->file_mmap);
+    fprintf(stderr, "dbg2       mmap_size:  %zu\n", mb_io_ptr->file_mmap_size);
     fprintf(stderr, "dbg2       error:      %d\n", *error);
     fprintf(stderr, "dbg2  Return status:\n");
     fprintf(stderr, "dbg2       status:  %d\n", status);
@@ -108,6 +151,15 @@ int mb_fileio_close(int verbose, void *mbio_ptr, int *error) {
 
   struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
 
+#ifndef _WIN32
+  if (mb_io_ptr->file_mmap != NULL) {
+    munmap(mb_io_ptr->file_mmap, mb_io_ptr->file_mmap_size);
+    mb_io_ptr->file_mmap = NULL;
+    mb_io_ptr->file_mmap_size = 0;
+    mb_io_ptr->file_mmap_pos = 0;
+  }
+#endif
+
   if (mb_io_ptr->mbfp != NULL) {
     fclose(mb_io_ptr->mbfp);
     mb_io_ptr->mbfp = NULL;
@@ -142,7 +194,25 @@ int mb_fileio_get(int verbose, void *mbio_ptr, char *buffer, size_t *size, int *
   int status = MB_SUCCESS;
 
   size_t read_len = 0;
-  if (mb_io_ptr->mbfp != NULL) {
+  if (mb_io_ptr->file_mmap != NULL) {
+      /* copy expected number of bytes from the mapped file into buffer */
+      read_len = *size;
+      if (mb_io_ptr->file_mmap_pos >= mb_io_ptr->file_mmap_size)
+          read_len = 0;
+      else if (read_len > mb_io_ptr->file_mmap_size - mb_io_ptr->file_mmap_pos)
+          read_len = mb_io_ptr->file_mmap_size - mb_io_ptr->file_mmap_pos;
+      memcpy(buffer, &mb_io_ptr->file_mmap[mb_io_ptr->file_mmap_pos], read_len);
+      mb_io_ptr->file_mmap_pos += read_len;
+      if (read_len != *size) {
+          status = MB_FAILURE;
+          *error = MB_ERROR_EOF;
+          *size = read_len;
+      }
+      else {
+          *error = MB_ERROR_NO_ERROR;
+      }
+  }
+  else if (mb_io_ptr->mbfp != NULL) {
       /* read expected number of bytes into buffer */
       if ((read_len = fread(buffer, 1, *size, mb_io_ptr->mbfp)) != *size) {
           status = MB_FAILURE;
@@ -215,3 +285,103 @@ int mb_fileio_put(int verbose, void *mbio_ptr, char *buffer, size_t *size, int *
   return (status);
 }
 /*--------------------------------------------------------------------*/
+int mb_fileio_map(int verbose, void *mbio_ptr, char **buffer, size_t *size, int *error) {
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+    fprintf(stderr, "dbg2       mbio_ptr:   %p\n", (void *)mbio_ptr);
+    fprintf(stderr, "dbg2       buffer:     %p\n", (void *)buffer);
+    fprintf(stderr, "dbg2       size:       %p\n", (void *)size);
+    fprintf(stderr, "dbg2       *size:      %zu\n", *size);
+  }
+
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  int status = MB_SUCCESS;
+
+  /* return a pointer to the next *size bytes of the mapped file - the
+      bytes are read-only and remain valid until mb_fileio_close() */
+  *buffer = NULL;
+  if (mb_io_ptr->file_mmap == NULL) {
+    status = MB_FAILURE;
+    *error = MB_ERROR_BAD_PARAMETER;
+    *size = 0;
+  }
+  else if (mb_io_ptr->file_mmap_pos >= mb_io_ptr->file_mmap_size
+           || *size > mb_io_ptr->file_mmap_size - mb_io_ptr->file_mmap_pos) {
+    status = MB_FAILURE;
+    *error = MB_ERROR_EOF;
+    *size = mb_io_ptr->file_mmap_pos < mb_io_ptr->file_mmap_size
+              ? mb_io_ptr->file_mmap_size - mb_io_ptr->file_mmap_pos : 0;
+    mb_io_ptr->file_mmap_pos = mb_io_ptr->file_mmap_size;
+  }
+  else {
+    *buffer = &mb_io_ptr->file_mmap[mb_io_ptr->file_mmap_pos];
+    mb_io_ptr->file_mmap_pos += *size;
+    *error = MB_ERROR_NO_ERROR;
+  }
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       *buffer:    %p\n", (void *)*buffer);
+    fprintf(stderr, "dbg2       *size:      %zu\n", *size);
+    fprintf(stderr, "dbg2       error:      %d\n", *error);
+    fprintf(stderr, "dbg2  Return status:\n");
+    fprintf(stderr, "dbg2       status:  %d\n", status);
+  }
+
+  return (status);
+}
+/*--------------------------------------------------------------------*/
+long mb_fileio_tell(int verbose, void *mbio_ptr) {
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  long position = -1;
+  if (mb_io_ptr->file_mmap != NULL)
+    position = (long)mb_io_ptr->file_mmap_pos;
+  else if (mb_io_ptr->mbfp != NULL)
+    position = ftell(mb_io_ptr->mbfp);
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       position:   %ld\n", position);
+  }
+
+  return (position);
+}
+/*--------------------------------------------------------------------*/
+int mb_fileio_seek(int verbose, void *mbio_ptr, long offset, int whence) {
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  /* returns 0 on success and -1 on failure like fseek() */
+  int result = -1;
+  if (mb_io_ptr->file_mmap != NULL) {
+    long base = 0;
+    if (whence == SEEK_CUR)
+      base = (long)mb_io_ptr->file_mmap_pos;
+    else if (whence == SEEK_END)
+      base = (long)mb_io_ptr->file_mmap_size;
+    if (base + offset >= 0) {
+      mb_io_ptr->file_mmap_pos = (size_t)(base + offset);
+      result = 0;
+    }
+  }
+  else if (mb_io_ptr->mbfp != NULL) {
+    result = fseek(mb_io_ptr->mbfp, offset, whence);
+  }
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       offset:     %ld\n", offset);
+    fprintf(stderr, "dbg2       whence:     %d\n", whence);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       result:     %d\n", result);
+  }
+
+  return (result);
+}
+/*--------------------------------------------------------------------*/
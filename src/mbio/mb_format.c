@@ -4183,7 +4183,7 @@ int mb_get_basename(int verbose, char *path, int *error) {
   if (result != NULL && strlen(result) > 1)
     strcpy(path, &result[1]);
 
-  /* remove .fbt .fnv .inf .esf suffix if present */
+  /* remove .fbt .fnv .inf .esf .idx suffix if present */
   if (strlen(path) > 4) {
     const int i = strlen(path) - 4;
     if ((result = strstr(&path[i], ".fbt")) != NULL) {
@@ -4198,6 +4198,9 @@ int mb_get_basename(int verbose, char *path, int *error) {
     else if ((result = strstr(&path[i], ".esf")) != NULL) {
       path[i] = '\0';
     }
+    else if ((result = strstr(&path[i], ".idx")) != NULL) {
+      path[i] = '\0';
+    }
   }
 
   /* no error even if no path */
@@ -0,0 +1,435 @@
+/*--------------------------------------------------------------------
+ *    The MB-system:  mb_index.c  10/16/2026
+ *
+ *    Copyright (c) 2026 by
+ *    David W. Caress (caress@mbari.org)
+ *      Monterey Bay Aquarium Research Institute
+ *      Moss Landing, CA 95039
+ *    and Dale N. Chayes (dale@ldeo.columbia.edu)
+ *      Lamont-Doherty Earth Observatory
+ *      Palisades, NY 10964
+ *
+ *    See README file for copying and redistribution conditions.
+ *--------------------------------------------------------------------*/
+/*
+ * mb_index.c contains the functions handling persistent record index
+ * files, which allow random access into swath data files. The index
+ * file has the name of the data file followed by a ".idx" suffix and
+ * is generated alongside the ".inf", ".fbt" and ".fnv" ancillary files
+ * by mb_make_info().
+ *
+ * These functions include:
+ *   mb_make_index      - read a swath file and write its index file
+ *   mb_read_index      - load the index file of a file opened for reading
+ *   mb_read_seek_ping  - position the input at a survey ping by number
+ *   mb_read_seek_time  - position the input at the first survey ping at
+ *                        or after a time
+ *
+ * The index records the file offset, size, kind and time of every
+ * record returned by mb_read_ping(). Seeking is only possible for
+ * formats whose drivers read each record starting from the file
+ * position preceding the mb_read_ping() call, without state carried
+ * over from earlier records; these formats are listed in
+ * mb_should_make_index().
+ *
+ * The index file is big-endian, consisting of a 32 byte header:
+ *   char  magic[4]      "MBIX"
+ *   int   version       1
+ *   int   format        MBIO format id of the data file
+ *   int   num_records   number of records
+ *   long  file_size     size of the data file in bytes
+ *   long  file_modtime  modification time of the data file
+ * followed by num_records 24 byte records:
+ *   long   offset       file position of the start of the record
+ *   int    size         number of bytes in the record
+ *   int    kind         MBIO data record kind
+ *   double time_d       record time in epoch seconds (zero if none)
+ * An index whose file size or modification time does not match the
+ * data file is out of date and is ignored.
+ *
+ * Date:  October 16, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "mb_define.h"
+#include "mb_format.h"
+#include "mb_io.h"
+#include "mb_status.h"
+
+#define MB_INDEX_MAGIC "MBIX"
+#define MB_INDEX_VERSION 1
+#define MB_INDEX_HEADER_SIZE 32
+#define MB_INDEX_RECORD_SIZE 24
+#define MB_INDEX_ALLOC_STEP 10000
+
+/*--------------------------------------------------------------------*/
+int mb_make_index(int verbose, char *file, int format, int *error) {
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+    fprintf(stderr, "dbg2       file:       %s\n", file);
+    fprintf(stderr, "dbg2       format:     %d\n", format);
+  }
+
+  *error = MB_ERROR_NO_ERROR;
+  int status = MB_SUCCESS;
+
+  /* only index formats that can be read from an arbitrary record */
+  if (!mb_should_make_index(verbose, format)) {
+    status = MB_FAILURE;
+    *error = MB_ERROR_BAD_FORMAT;
+  }
+
+  /* get the size and modification time of the data file */
+  struct stat file_status;
+  if (status == MB_SUCCESS && (stat(file, &file_status) != 0 || (file_status.st_mode & S_IFMT) == S_IFDIR)) {
+    status = MB_FAILURE;
+    *error = MB_ERROR_OPEN_FAIL;
+  }
+
+  /* open the data file */
+  void *mbio_ptr = NULL;
+  if (status == MB_SUCCESS) {
+    double bounds[4] = {-360.0, 360.0, -90.0, 90.0};
+    int btime_i[7] = {1962, 2, 21, 10, 30, 0, 0};
+    int etime_i[7] = {2062, 2, 21, 10, 30, 0, 0};
+    double btime_d;
+    double etime_d;
+    int beams_bath;
+    int beams_amp;
+    int pixels_ss;
+    status = mb_read_init(verbose, file, format, 1, 0, bounds, btime_i, etime_i, 0.0, 0.0, &mbio_ptr, &btime_d, &etime_d,
+                          &beams_bath, &beams_amp, &pixels_ss, error);
+  }
+
+  /* read every record, saving its position, size, kind and time */
+  int num_records = 0;
+  int num_records_alloc = 0;
+  struct mb_io_indextable_struct *records = NULL;
+  if (status == MB_SUCCESS) {
+    struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+    void *store_ptr = mb_io_ptr->store_data;
+    bool done = false;
+    while (!done) {
+      const long offset = mb_fileio_tell(verbose, mbio_ptr);
+      int kind = MB_DATA_NONE;
+      status = mb_read_ping(verbose, mbio_ptr, store_ptr, &kind, error);
+      if (status == MB_SUCCESS || *error < MB_ERROR_NO_ERROR) {
+        if (num_records >= num_records_alloc) {
+          num_records_alloc += MB_INDEX_ALLOC_STEP;
+          status = mb_reallocd(verbose, __FILE__, __LINE__, num_records_alloc * sizeof(struct mb_io_indextable_struct),
+                               (void **)&records, error);
+          if (status != MB_SUCCESS)
+            break;
+        }
+        struct mb_io_indextable_struct *record = &records[num_records];
+        memset(record, 0, sizeof(struct mb_io_indextable_struct));
+        record->total_index_org = num_records;
+        record->total_index_sorted = num_records;
+        record->offset = offset;
+        record->size = (size_t)(mb_fileio_tell(verbose, mbio_ptr) - offset);
+        record->kind = (mb_u_char)kind;
+        if (status == MB_SUCCESS) {
+          int time_i[7];
+          double navlon, navlat, speed, heading, draft, roll, pitch, heave;
+          int nav_error = MB_ERROR_NO_ERROR;
+          if (mb_extract_nav(verbose, mbio_ptr, store_ptr, &kind, time_i, &record->time_d_org, &navlon, &navlat, &speed,
+                             &heading, &draft, &roll, &pitch, &heave, &nav_error) != MB_SUCCESS)
+            record->time_d_org = 0.0;
+          record->time_d_corrected = record->time_d_org;
+        }
+        num_records++;
+        status = MB_SUCCESS;
+        *error = MB_ERROR_NO_ERROR;
+      }
+      else {
+        done = true;
+        if (*error == MB_ERROR_EOF) {
+          status = MB_SUCCESS;
+          *error = MB_ERROR_NO_ERROR;
+        }
+      }
+    }
+    int close_error = MB_ERROR_NO_ERROR;
+    mb_close(verbose, &mbio_ptr, &close_error);
+  }
+
+  /* write the index file */
+  if (status == MB_SUCCESS) {
+    mb_pathplus idxfile;
+    snprintf(idxfile, sizeof(idxfile), "%s.idx", file);
+    FILE *fp = fopen(idxfile, "wb");
+    if (fp == NULL) {
+      status = MB_FAILURE;
+      *error = MB_ERROR_OPEN_FAIL;
+    }
+    else {
+      char buffer[MB_INDEX_HEADER_SIZE];
+      memcpy(buffer, MB_INDEX_MAGIC, 4);
+      mb_put_binary_int(false, MB_INDEX_VERSION, &buffer[4]);
+      mb_put_binary_int(false, format, &buffer[8]);
+      mb_put_binary_int(false, num_records, &buffer[12]);
+      mb_put_binary_long(false, (mb_s_long)file_status.st_size, &buffer[16]);
+      mb_put_binary_long(false, (mb_s_long)file_status.st_mtime, &buffer[24]);
+      if (fwrite(buffer, 1, MB_INDEX_HEADER_SIZE, fp) != MB_INDEX_HEADER_SIZE)
+        status = MB_FAILURE;
+      for (int i = 0; i < num_records && status == MB_SUCCESS; i++) {
+        mb_put_binary_long(false, (mb_s_long)records[i].offset, &buffer[0]);
+        mb_put_binary_int(false, (int)records[i].size, &buffer[8]);
+        mb_put_binary_int(false, (int)records[i].kind, &buffer[12]);
+        mb_put_binary_double(false, records[i].time_d_org, &buffer[16]);
+        if (fwrite(buffer, 1, MB_INDEX_RECORD_SIZE, fp) != MB_INDEX_RECORD_SIZE)
+          status = MB_FAILURE;
+      }
+      fclose(fp);
+      if (status != MB_SUCCESS) {
+        *error = MB_ERROR_WRITE_FAIL;
+        remove(idxfile);
+      }
+    }
+  }
+
+  if (records != NULL) {
+    int mem_error = MB_ERROR_NO_ERROR;
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&records, &mem_error);
+  }
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       num_records: %d\n", num_records);
+    fprintf(stderr, "dbg2       error:       %d\n", *error);
+    fprintf(stderr, "dbg2  Return status:\n");
+    fprintf(stderr, "dbg2       status:      %d\n", status);
+  }
+
+  return (status);
+}
+/*--------------------------------------------------------------------*/
+int mb_read_index(int verbose, void *mbio_ptr, int *error) {
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+    fprintf(stderr, "dbg2       mbio_ptr:   %p\n", (void *)mbio_ptr);
+  }
+
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  *error = MB_ERROR_NO_ERROR;
+  int status = MB_SUCCESS;
+
+  /* the index is only loaded once */
+  if (mb_io_ptr->fileindex != NULL) {
+    status = MB_SUCCESS;
+  }
+
+  /* the index is only useful for formats that can be read from an arbitrary record */
+  else if (mb_io_ptr->filemode != MB_FILEMODE_READ || !mb_should_make_index(verbose, mb_io_ptr->format)) {
+    status = MB_FAILURE;
+    *error = MB_ERROR_BAD_FORMAT;
+  }
+
+  else {
+    /* get the size and modification time of the data file */
+    struct stat file_status;
+    mb_pathplus idxfile;
+    snprintf(idxfile, sizeof(idxfile), "%s.idx", mb_io_ptr->file);
+    FILE *fp = NULL;
+    if (stat(mb_io_ptr->file, &file_status) != 0 || (fp = fopen(idxfile, "rb")) == NULL) {
+      status = MB_FAILURE;
+      *error = MB_ERROR_FILE_NOT_FOUND;
+    }
+
+    /* read and check the header */
+    int num_records = 0;
+    if (status == MB_SUCCESS) {
+      char buffer[MB_INDEX_HEADER_SIZE];
+      int version = 0;
+      int format = 0;
+      mb_s_long file_size = 0;
+      mb_s_long file_modtime = 0;
+      if (fread(buffer, 1, MB_INDEX_HEADER_SIZE, fp) == MB_INDEX_HEADER_SIZE && strncmp(buffer, MB_INDEX_MAGIC, 4) == 0) {
+        mb_get_binary_int(false, &buffer[4], &version);
+        mb_get_binary_int(false, &buffer[8], &format);
+        mb_get_binary_int(false, &buffer[12], &num_records);
+        mb_get_binary_long(false, &buffer[16], &file_size);
+        mb_get_binary_long(false, &buffer[24], &file_modtime);
+      }
+      if (version != MB_INDEX_VERSION || format != mb_io_ptr->format || num_records < 0
+          || file_size != (mb_s_long)file_status.st_size || file_modtime != (mb_s_long)file_status.st_mtime) {
+        status = MB_FAILURE;
+        *error = MB_ERROR_FILE_NOT_FOUND;
+      }
+    }
+
+    /* read the records */
+    if (status == MB_SUCCESS) {
+      status = mb_mallocd(verbose, __FILE__, __LINE__, MAX(num_records, 1) * sizeof(struct mb_io_indextable_struct),
+                          (void **)&mb_io_ptr->fileindex, error);
+    }
+    if (status == MB_SUCCESS) {
+      memset(mb_io_ptr->fileindex, 0, MAX(num_records, 1) * sizeof(struct mb_io_indextable_struct));
+      char buffer[MB_INDEX_RECORD_SIZE];
+      for (int i = 0; i < num_records && status == MB_SUCCESS; i++) {
+        if (fread(buffer, 1, MB_INDEX_RECORD_SIZE, fp) == MB_INDEX_RECORD_SIZE) {
+          struct mb_io_indextable_struct *record = &mb_io_ptr->fileindex[i];
+          mb_s_long offset;
+          int size;
+          int kind;
+          mb_get_binary_long(false, &buffer[0], &offset);
+          mb_get_binary_int(false, &buffer[8], &size);
+          mb_get_binary_int(false, &buffer[12], &kind);
+          mb_get_binary_double(false, &buffer[16], &record->time_d_org);
+          record->total_index_org = i;
+          record->total_index_sorted = i;
+          record->offset = (long)offset;
+          record->size = (size_t)size;
+          record->kind = (mb_u_char)kind;
+          record->time_d_corrected = record->time_d_org;
+        }
+        else {
+          status = MB_FAILURE;
+          *error = MB_ERROR_FILE_NOT_FOUND;
+        }
+      }
+      if (status == MB_SUCCESS) {
+        mb_io_ptr->num_fileindex = num_records;
+      }
+      else {
+        int mem_error = MB_ERROR_NO_ERROR;
+        mb_freed(verbose, __FILE__, __LINE__, (void **)&mb_io_ptr->fileindex, &mem_error);
+      }
+    }
+
+    if (fp != NULL)
+      fclose(fp);
+  }
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       num_fileindex: %d\n", mb_io_ptr->num_fileindex);
+    fprintf(stderr, "dbg2       error:         %d\n", *error);
+    fprintf(stderr, "dbg2  Return status:\n");
+    fprintf(stderr, "dbg2       status:        %d\n", status);
+  }
+
+  return (status);
+}
+/*--------------------------------------------------------------------*/
+/* position the input at the start of index record irecord */
+static int mb_read_seek_record(int verbose, struct mb_io_struct *mb_io_ptr, int irecord, int *error) {
+  const long offset = mb_io_ptr->fileindex[irecord].offset;
+  if (mb_fileio_seek(verbose, mb_io_ptr, offset, SEEK_SET) != 0) {
+    *error = MB_ERROR_EOF;
+    return (MB_FAILURE);
+  }
+
+  /* reset the read state so that the next read starts fresh */
+  mb_io_ptr->file_pos = offset;
+  mb_io_ptr->file_bytes = offset;
+  mb_io_ptr->pings_read = 0;
+  mb_io_ptr->error_save = MB_ERROR_NO_ERROR;
+  mb_io_ptr->need_new_ping = true;
+  mb_io_ptr->save_flag = false;
+
+  *error = MB_ERROR_NO_ERROR;
+  return (MB_SUCCESS);
+}
+/*--------------------------------------------------------------------*/
+int mb_read_seek_ping(int verbose, void *mbio_ptr, int ping, int *error) {
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+    fprintf(stderr, "dbg2       mbio_ptr:   %p\n", (void *)mbio_ptr);
+    fprintf(stderr, "dbg2       ping:       %d\n", ping);
+  }
+
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  /* load the index if needed */
+  int status = mb_read_index(verbose, mbio_ptr, error);
+
+  /* find the survey record - pings are counted from zero */
+  int irecord = -1;
+  if (status == MB_SUCCESS) {
+    for (int i = 0, iping = 0; i < mb_io_ptr->num_fileindex && irecord < 0; i++) {
+      if (mb_io_ptr->fileindex[i].kind == MB_DATA_DATA) {
+        if (iping == ping)
+          irecord = i;
+        iping++;
+      }
+    }
+    if (ping < 0 || irecord < 0) {
+      status = MB_FAILURE;
+      *error = MB_ERROR_EOF;
+    }
+  }
+
+  if (status == MB_SUCCESS)
+    status = mb_read_seek_record(verbose, mb_io_ptr, irecord, error);
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       irecord:    %d\n", irecord);
+    fprintf(stderr, "dbg2       error:      %d\n", *error);
+    fprintf(stderr, "dbg2  Return status:\n");
+    fprintf(stderr, "dbg2       status:     %d\n", status);
+  }
+
+  return (status);
+}
+/*--------------------------------------------------------------------*/
+int mb_read_seek_time(int verbose, void *mbio_ptr, double time_d, int *error) {
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+    fprintf(stderr, "dbg2  Input arguments:\n");
+    fprintf(stderr, "dbg2       verbose:    %d\n", verbose);
+    fprintf(stderr, "dbg2       mbio_ptr:   %p\n", (void *)mbio_ptr);
+    fprintf(stderr, "dbg2       time_d:     %f\n", time_d);
+  }
+
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  /* load the index if needed */
+  int status = mb_read_index(verbose, mbio_ptr, error);
+
+  /* find the first survey record at or after the requested time - the
+      records are scanned in file order so that the input is positioned
+      correctly even if the timestamps are not monotonic */
+  int irecord = -1;
+  if (status == MB_SUCCESS) {
+    for (int i = 0; i < mb_io_ptr->num_fileindex && irecord < 0; i++) {
+      if (mb_io_ptr->fileindex[i].kind == MB_DATA_DATA && mb_io_ptr->fileindex[i].time_d_org >= time_d)
+        irecord = i;
+    }
+    if (irecord < 0) {
+      status = MB_FAILURE;
+      *error = MB_ERROR_EOF;
+    }
+  }
+
+  if (status == MB_SUCCESS)
+    status = mb_read_seek_record(verbose, mb_io_ptr, irecord, error);
+
+  if (verbose >= 2) {
+    fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(stderr, "dbg2  Return values:\n");
+    fprintf(stderr, "dbg2       irecord:    %d\n", irecord);
+    fprintf(stderr, "dbg2       error:      %d\n", *error);
+    fprintf(stderr, "dbg2  Return status:\n");
+    fprintf(stderr, "dbg2       status:     %d\n", status);
+  }
+
+  return (status);
+}
+/*--------------------------------------------------------------------*/
@@ -500,6 +500,10 @@ struct mb_io_struct {
   long file_pos;               /* file position at start of last record read */
   long file_bytes;             /* number of bytes read from file */
   char *file_iobuffer;         /* file i/o buffer for fread() and fwrite() calls */
+  char *file_mmap;             /* read-only memory map of file (mmap file i/o mode) */
+  size_t file_mmap_size;       /* number of bytes in memory mapped file */
+  size_t file_mmap_pos;        /* current read position in memory mapped file */
+  bool file_mmap_ok;           /* if true the format driver supports mmap file i/o */
   FILE *mbfp2;                 /* file descriptor #2 */
   char file2[MB_PATH_MAXLINE]; /* file name #2 */
   long file2_pos;              /* file position #2 at start of last record read */
@@ -520,6 +524,10 @@ struct mb_io_struct {
   unsigned int num_indextable_alloc;
   struct mb_io_indextable_struct *indextable;
 
+  /* persistent record index loaded from the .idx file by mb_read_index() */
+  int num_fileindex;
+  struct mb_io_indextable_struct *fileindex;
+
   /* read or write history */
   bool fileheader;       /* indicates whether file header has
                         been read or written */
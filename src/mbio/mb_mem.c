@@ -21,7 +21,10 @@
  * Date:  March 1, 1993
  */
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,23 +33,203 @@
 #include "mb_io.h"
 #include "mb_status.h"
 
-/* memory allocation list variables */
+/* memory allocation list variables - the list is a hash table keyed by the
+    allocated pointer, split into shards selected by the pointer hash, each
+    with its own lock, so that threads allocating and freeing memory
+    concurrently rarely contend for a lock. The sequence numbers order
+    the list by allocation when it is printed. Source file names are kept
+    by reference and so must be string literals such as __FILE__. */
 static const int MB_MEMORY_ALLOC_STEP = 100;
-#define MB_MEMORY_HEAP_MAX 10000
-static bool mb_memory_list_enabled = true;
+#define MB_MEMORY_SHARD_NUM 64
+static const int MB_MEMORY_SHARD_SLOT_MIN = 64;
+struct mb_memory_entry {
+  void *ptr;
+  size_t size;
+  const char *sourcefile;
+  int sourceline;
+  unsigned long sequence;
+};
+struct mb_memory_shard {
+  pthread_mutex_t mutex;
+  int nalloc;
+  int nslot;
+  struct mb_memory_entry *entry;
+};
+static atomic_bool mb_memory_list_enabled = true;
 static bool mb_mem_debug = false;
-static int n_mb_alloc = 0;
-static void *mb_alloc_ptr[MB_MEMORY_HEAP_MAX];
-static size_t mb_alloc_size[MB_MEMORY_HEAP_MAX];
-static mb_name mb_alloc_sourcefile[MB_MEMORY_HEAP_MAX];
-static int mb_alloc_sourceline[MB_MEMORY_HEAP_MAX];
-static bool mb_alloc_overflow = false;
+static atomic_bool mb_alloc_overflow = false;
+static atomic_ulong mb_alloc_sequence = 0;
+static struct mb_memory_shard mb_memory_shards[MB_MEMORY_SHARD_NUM];
+static pthread_once_t mb_memory_once = PTHREAD_ONCE_INIT;
+
+/*--------------------------------------------------------------------*/
+static void mb_memory_init(void) {
+  for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++) {
+    pthread_mutex_init(&mb_memory_shards[ishard].mutex, NULL);
+    mb_memory_shards[ishard].nalloc = 0;
+    mb_memory_shards[ishard].nslot = 0;
+    mb_memory_shards[ishard].entry = NULL;
+  }
+}
+/*--------------------------------------------------------------------*/
+static bool mb_memory_list_on(void) {
+  return atomic_load_explicit(&mb_memory_list_enabled, memory_order_relaxed);
+}
+/*--------------------------------------------------------------------*/
+/* hash of a pointer - the low bits select the shard, the high bits the slot */
+static size_t mb_memory_hash(const void *ptr) {
+  uint64_t hash = (uint64_t)(uintptr_t)ptr;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return (size_t)hash;
+}
+/*--------------------------------------------------------------------*/
+static struct mb_memory_shard *mb_memory_shard_lock(const void *ptr) {
+  pthread_once(&mb_memory_once, mb_memory_init);
+  struct mb_memory_shard *shard = &mb_memory_shards[mb_memory_hash(ptr) % MB_MEMORY_SHARD_NUM];
+  pthread_mutex_lock(&shard->mutex);
+  return (shard);
+}
+/*--------------------------------------------------------------------*/
+/* returns the slot holding ptr, or the empty slot where it belongs */
+static int mb_memory_shard_find(const struct mb_memory_shard *shard, const void *ptr) {
+  const int mask = shard->nslot - 1;
+  int islot = (int)((mb_memory_hash(ptr) / MB_MEMORY_SHARD_NUM) & mask);
+  while (shard->entry[islot].ptr != NULL && shard->entry[islot].ptr != ptr)
+    islot = (islot + 1) & mask;
+  return (islot);
+}
+/*--------------------------------------------------------------------*/
+/* call with the shard locked - returns false if the table cannot grow */
+static bool mb_memory_shard_insert(struct mb_memory_shard *shard, const struct mb_memory_entry *entry) {
+  /* keep the table at most half full */
+  if (2 * (shard->nalloc + 1) > shard->nslot) {
+    const int nslot = shard->nslot > 0 ? 2 * shard->nslot : MB_MEMORY_SHARD_SLOT_MIN;
+    struct mb_memory_entry *table = (struct mb_memory_entry *)calloc(nslot, sizeof(struct mb_memory_entry));
+    if (table == NULL)
+      return (false);
+    struct mb_memory_entry *table_old = shard->entry;
+    const int nslot_old = shard->nslot;
+    shard->entry = table;
+    shard->nslot = nslot;
+    for (int islot = 0; islot < nslot_old; islot++)
+      if (table_old[islot].ptr != NULL)
+        shard->entry[mb_memory_shard_find(shard, table_old[islot].ptr)] = table_old[islot];
+    free(table_old);
+  }
+
+  const int islot = mb_memory_shard_find(shard, entry->ptr);
+  if (shard->entry[islot].ptr == NULL)
+    shard->nalloc++;
+  shard->entry[islot] = *entry;
+  return (true);
+}
+/*--------------------------------------------------------------------*/
+/* call with the shard locked - returns false if ptr is not in the list */
+static bool mb_memory_shard_remove(struct mb_memory_shard *shard, const void *ptr, struct mb_memory_entry *entry) {
+  if (shard->nalloc == 0 || ptr == NULL)
+    return (false);
+  int islot = mb_memory_shard_find(shard, ptr);
+  if (shard->entry[islot].ptr == NULL)
+    return (false);
+  if (entry != NULL)
+    *entry = shard->entry[islot];
+
+  /* shift back any following entries that would no longer be found */
+  const int mask = shard->nslot - 1;
+  for (int jslot = (islot + 1) & mask; shard->entry[jslot].ptr != NULL; jslot = (jslot + 1) & mask) {
+    const int kslot = (int)((mb_memory_hash(shard->entry[jslot].ptr) / MB_MEMORY_SHARD_NUM) & mask);
+    if (((jslot - kslot) & mask) >= ((jslot - islot) & mask)) {
+      shard->entry[islot] = shard->entry[jslot];
+      islot = jslot;
+    }
+  }
+  shard->entry[islot].ptr = NULL;
+  shard->nalloc--;
+  return (true);
+}
+/*--------------------------------------------------------------------*/
+static void mb_memory_add(void *ptr, size_t size, const char *sourcefile, int sourceline) {
+  struct mb_memory_entry entry;
+  entry.ptr = ptr;
+  entry.size = size;
+  entry.sourcefile = sourcefile;
+  entry.sourceline = sourceline;
+  entry.sequence = atomic_fetch_add_explicit(&mb_alloc_sequence, 1, memory_order_relaxed);
+  struct mb_memory_shard *shard = mb_memory_shard_lock(ptr);
+  const bool added = mb_memory_shard_insert(shard, &entry);
+  pthread_mutex_unlock(&shard->mutex);
+  if (!added) {
+    atomic_store(&mb_alloc_overflow, true);
+    if (mb_mem_debug)
+      fprintf(stderr, "NOTICE: mbm_mem overflow pointer allocated %p\n", ptr);
+  }
+}
+/*--------------------------------------------------------------------*/
+static bool mb_memory_remove(const void *ptr, struct mb_memory_entry *entry) {
+  struct mb_memory_shard *shard = mb_memory_shard_lock(ptr);
+  const bool removed = mb_memory_shard_remove(shard, ptr, entry);
+  pthread_mutex_unlock(&shard->mutex);
+  return (removed);
+}
+/*--------------------------------------------------------------------*/
+static int mb_memory_entry_compare(const void *a, const void *b) {
+  const unsigned long sequence_a = ((const struct mb_memory_entry *)a)->sequence;
+  const unsigned long sequence_b = ((const struct mb_memory_entry *)b)->sequence;
+  return (sequence_a > sequence_b) - (sequence_a < sequence_b);
+}
+/*--------------------------------------------------------------------*/
+/* returns a copy of the list in allocation order, or NULL if empty */
+static struct mb_memory_entry *mb_memory_snapshot(int *nalloc) {
+  pthread_once(&mb_memory_once, mb_memory_init);
+  *nalloc = 0;
+  for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++)
+    pthread_mutex_lock(&mb_memory_shards[ishard].mutex);
+  int ntotal = 0;
+  for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++)
+    ntotal += mb_memory_shards[ishard].nalloc;
+  struct mb_memory_entry *list = NULL;
+  if (ntotal > 0 && (list = (struct mb_memory_entry *)malloc(ntotal * sizeof(struct mb_memory_entry))) != NULL) {
+    for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++) {
+      const struct mb_memory_shard *shard = &mb_memory_shards[ishard];
+      for (int islot = 0; islot < shard->nslot; islot++)
+        if (shard->entry[islot].ptr != NULL)
+          list[(*nalloc)++] = shard->entry[islot];
+    }
+  }
+  for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++)
+    pthread_mutex_unlock(&mb_memory_shards[ishard].mutex);
+  if (list != NULL)
+    qsort(list, *nalloc, sizeof(struct mb_memory_entry), mb_memory_entry_compare);
+  return (list);
+}
+/*--------------------------------------------------------------------*/
+static int mb_memory_count(void) {
+  pthread_once(&mb_memory_once, mb_memory_init);
+  int nalloc = 0;
+  for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++) {
+    pthread_mutex_lock(&mb_memory_shards[ishard].mutex);
+    nalloc += mb_memory_shards[ishard].nalloc;
+    pthread_mutex_unlock(&mb_memory_shards[ishard].mutex);
+  }
+  return (nalloc);
+}
+/*--------------------------------------------------------------------*/
+static void mb_memory_print(const char *prefix) {
+  int nalloc = 0;
+  struct mb_memory_entry *list = mb_memory_snapshot(&nalloc);
+  for (int i = 0; i < nalloc; i++)
+    fprintf(stderr, "%si:%d  ptr:%p  size:%zu source:%s line:%d\n", prefix, i, list[i].ptr, list[i].size,
+            list[i].sourcefile != NULL ? list[i].sourcefile : "", list[i].sourceline);
+  free(list);
+}
 
 /*--------------------------------------------------------------------*/
 int mb_mem_list_enable(int verbose, int *error) {
 
   /* turn memory list on */
-  mb_memory_list_enabled = true;
+  atomic_store(&mb_memory_list_enabled, true);
 
   if (verbose >= 2 || mb_mem_debug) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
@@ -56,9 +239,7 @@ int mb_mem_list_enable(int verbose, int *error) {
 
   if (verbose >= 6 || mb_mem_debug) {
     fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-    for (int i = 0; i < n_mb_alloc; i++)
-      fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-              mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+    mb_memory_print("dbg6       ");
   }
 
   const int status = MB_SUCCESS;
@@ -78,7 +259,7 @@ int mb_mem_list_enable(int verbose, int *error) {
 int mb_mem_list_disable(int verbose, int *error) {
 
   /* turn memory list off */
-  mb_memory_list_enabled = false;
+  atomic_store(&mb_memory_list_enabled, false);
 
   if (verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
@@ -114,9 +295,7 @@ int mb_mem_debug_on(int verbose, int *error) {
 
   /* if (verbose >= 6 || mb_mem_debug) */ {
     fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-    for (int i = 0; i < n_mb_alloc; i++)
-      fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-              mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+    mb_memory_print("dbg6       ");
   }
 
   const int status = MB_SUCCESS;
@@ -146,9 +325,7 @@ int mb_mem_debug_off(int verbose, int *error) {
 
   if (verbose >= 6) {
     fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-    for (int i = 0; i < n_mb_alloc; i++)
-      fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-              mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+    mb_memory_print("dbg6       ");
   }
 
   const int status = MB_SUCCESS;
@@ -194,35 +371,23 @@ int mb_malloc(int verbose, size_t size, void **ptr, int *error) {
     status = MB_SUCCESS;
   }
 
-  if ((verbose >= 5 || mb_mem_debug) && size > 0) {
-    fprintf(stderr, "\ndbg5  Memory allocated in MBIO function <%s>\n", __func__);
-    fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", n_mb_alloc, (void *)*ptr, size);
-  }
-
   /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
+  if (mb_memory_list_on()) {
     /* add to list if size > 0 */
-    if (size > 0) {
-      if (n_mb_alloc < MB_MEMORY_HEAP_MAX) {
-        mb_alloc_ptr[n_mb_alloc] = *ptr;
-        mb_alloc_size[n_mb_alloc] = size;
-        n_mb_alloc++;
-      }
-      else {
-        mb_alloc_overflow = true;
-#ifdef MB_MEM_DEBUG
-        fprintf(stderr, "NOTICE: mbm_mem overflow pointer allocated %d in function %s\n", *ptr, __func__);
-#endif
-      }
+    if (size > 0 && *ptr != NULL)
+      mb_memory_add(*ptr, size, NULL, 0);
+
+    if ((verbose >= 5 || mb_mem_debug) && size > 0) {
+      fprintf(stderr, "\ndbg5  Memory allocated in MBIO function <%s>\n", __func__);
+      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", mb_memory_count() - 1, (void *)*ptr, size);
     }
 
     if (verbose >= 6 || mb_mem_debug) {
       fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("dbg6       ");
     }
   }
+
   if (verbose >= 2 || mb_mem_debug) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
     fprintf(stderr, "dbg2  Return values:\n");
@@ -267,35 +432,19 @@ int mb_mallocd(int verbose, const char *sourcefile, int sourceline, size_t size,
   }
 
   /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
+  if (mb_memory_list_on()) {
+    /* add to list if size > 0 */
+    if (size > 0 && *ptr != NULL)
+      mb_memory_add(*ptr, size, sourcefile, sourceline);
 
     if ((verbose >= 5 || mb_mem_debug) && size > 0) {
       fprintf(stderr, "\ndbg5  Memory allocated in MBIO function <%s>\n", __func__);
-      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", n_mb_alloc, (void *)*ptr, size);
-    }
-
-    /* add to list if size > 0 */
-    if (size > 0) {
-      if (n_mb_alloc < MB_MEMORY_HEAP_MAX) {
-        mb_alloc_ptr[n_mb_alloc] = *ptr;
-        mb_alloc_size[n_mb_alloc] = size;
-        strncpy(mb_alloc_sourcefile[n_mb_alloc], sourcefile, MB_NAME_LENGTH - 1);
-        mb_alloc_sourceline[n_mb_alloc] = sourceline;
-        n_mb_alloc++;
-      }
-      else {
-        mb_alloc_overflow = true;
-#ifdef MB_MEM_DEBUG
-        fprintf(stderr, "NOTICE: mbm_mem overflow pointer allocated %d in function %s\n", *ptr, __func__);
-#endif
-      }
+      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", mb_memory_count() - 1, (void *)*ptr, size);
     }
 
     if (verbose >= 6 || mb_mem_debug) {
       fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("dbg6       ");
     }
   }
 
@@ -321,17 +470,16 @@ int mb_realloc(int verbose, size_t size, void **ptr, int *error) {
     fprintf(stderr, "dbg2       *ptr:       %p\n", (void *)*ptr);
   }
 
-
-  /* keep list of allocated memory */
-  int iptr = -1;
-  if (mb_memory_list_enabled) {
-    /* check if pointer is in list */
-    for (int i = 0; i < n_mb_alloc; i++)
-      if (mb_alloc_ptr[i] == *ptr)
-        iptr = i;
-  }
+  /* keep list of allocated memory - take the pointer out of the list
+      while it is reallocated, keeping its source location */
+  const bool list_enabled = mb_memory_list_on();
+  bool listed = false;
+  struct mb_memory_entry entry;
+  if (list_enabled)
+    listed = mb_memory_remove(*ptr, &entry);
 
   /* if pointer is non-NULL use realloc */
+  void *ptr_old = *ptr;
   if (*ptr != NULL)
     *ptr = (char *)realloc(*ptr, size);
 
@@ -350,50 +498,30 @@ int mb_realloc(int verbose, size_t size, void **ptr, int *error) {
   }
 
   /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
-    /* if pointer was already in list update it */
-    if (status == MB_SUCCESS && iptr > -1) {
-      /* if pointer non-NULL update it */
-      if (size > 0 && *ptr != NULL) {
-        mb_alloc_ptr[iptr] = *ptr;
-        mb_alloc_size[iptr] = size;
-      }
-
-      /* else remove it from list */
-      else {
-        for (int i = iptr; i < n_mb_alloc - 1; i++) {
-          mb_alloc_ptr[i] = mb_alloc_ptr[i + 1];
-          mb_alloc_size[i] = mb_alloc_size[i + 1];
-        }
-        n_mb_alloc--;
-      }
+  if (list_enabled) {
+    /* if the pointer was in the list update it, unless it was freed -
+        if the reallocation failed the old memory is still allocated */
+    if (listed && status == MB_SUCCESS) {
+      if (size > 0 && *ptr != NULL)
+        mb_memory_add(*ptr, size, entry.sourcefile, entry.sourceline);
+    }
+    else if (listed) {
+      mb_memory_add(ptr_old, entry.size, entry.sourcefile, entry.sourceline);
     }
 
-    /* else add to list if possible if size > 0 */
+    /* else add to list if size > 0 */
     else if (status == MB_SUCCESS && size > 0) {
-      if (n_mb_alloc < MB_MEMORY_HEAP_MAX) {
-        mb_alloc_ptr[n_mb_alloc] = *ptr;
-        mb_alloc_size[n_mb_alloc] = size;
-        n_mb_alloc++;
-      }
-      else {
-        mb_alloc_overflow = true;
-#ifdef MB_MEM_DEBUG
-        fprintf(stderr, "NOTICE: mbm_mem overflow pointer allocated %p in function %s\n", *ptr, __func__);
-#endif
-      }
+      mb_memory_add(*ptr, size, NULL, 0);
     }
 
     if ((verbose >= 5 || mb_mem_debug) && size > 0) {
       fprintf(stderr, "\ndbg5  Memory reallocated in MBIO function <%s>\n", __func__);
-      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", n_mb_alloc, (void *)*ptr, size);
+      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", mb_memory_count() - 1, (void *)*ptr, size);
     }
 
     if (verbose >= 6 || mb_mem_debug) {
       fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("dbg6       ");
     }
   }
 
@@ -425,18 +553,16 @@ int mb_reallocd(int verbose, const char *sourcefile, int sourceline, size_t size
     fprintf(stderr, "dbg2       *ptr:       %p\n", (void *)*ptr);
   }
 
-  /* keep list of allocated memory */
-  int iptr = -1;
-  if (mb_memory_list_enabled) {
-    /* check if pointer is in list */
-    for (int i = 0; i < n_mb_alloc; i++) {
-      if (mb_alloc_ptr[i] == *ptr) {
-        iptr = i;
-      }
-    }
-  }
+  /* keep list of allocated memory - take the pointer out of the list
+      while it is reallocated */
+  const bool list_enabled = mb_memory_list_on();
+  bool listed = false;
+  struct mb_memory_entry entry;
+  if (list_enabled)
+    listed = mb_memory_remove(*ptr, &entry);
 
   /* if pointer is non-NULL use realloc */
+  void *ptr_old = *ptr;
   if (*ptr != NULL)
     *ptr = (char *)realloc(*ptr, size);
 
@@ -456,56 +582,24 @@ int mb_reallocd(int verbose, const char *sourcefile, int sourceline, size_t size
   }
 
   /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
-    /* if pointer was already in list update it */
-    if (status == MB_SUCCESS && iptr > -1) {
-      /* if pointer non-NULL update it */
-      if (size > 0 && *ptr != NULL) {
-        mb_alloc_ptr[iptr] = *ptr;
-        mb_alloc_size[iptr] = size;
-        strncpy(mb_alloc_sourcefile[iptr], sourcefile, MB_NAME_LENGTH - 1);
-        mb_alloc_sourceline[iptr] = sourceline;
-      }
+  if (list_enabled) {
+    /* if the reallocation failed the old memory is still allocated */
+    if (listed && status != MB_SUCCESS)
+      mb_memory_add(ptr_old, entry.size, entry.sourcefile, entry.sourceline);
 
-      /* else remove it from list */
-      else {
-        for (int i = iptr; i < n_mb_alloc - 1; i++) {
-          mb_alloc_ptr[i] = mb_alloc_ptr[i + 1];
-          mb_alloc_size[i] = mb_alloc_size[i + 1];
-          strncpy(mb_alloc_sourcefile[i], mb_alloc_sourcefile[i + 1], MB_NAME_LENGTH - 1);
-          mb_alloc_sourceline[i] = mb_alloc_sourceline[i + 1];
-        }
-        n_mb_alloc--;
-      }
-    }
-
-    /* else add to list if possible if size > 0 */
-    else if (status == MB_SUCCESS && size > 0) {
-      if (n_mb_alloc < MB_MEMORY_HEAP_MAX) {
-        mb_alloc_ptr[n_mb_alloc] = *ptr;
-        mb_alloc_size[n_mb_alloc] = size;
-        strncpy(mb_alloc_sourcefile[n_mb_alloc], sourcefile, MB_NAME_LENGTH - 1);
-        mb_alloc_sourceline[n_mb_alloc] = sourceline;
-        n_mb_alloc++;
-      }
-      else {
-        mb_alloc_overflow = true;
-        if (mb_mem_debug)
-          fprintf(stderr, "NOTICE: mbm_mem overflow pointer allocated %p in function %s\n", *ptr, __func__);
-      }
-    }
+    /* else add to list if size > 0 */
+    else if (status == MB_SUCCESS && size > 0 && *ptr != NULL)
+      mb_memory_add(*ptr, size, sourcefile, sourceline);
 
     if ((verbose >= 5 || mb_mem_debug) && size > 0) {
       fprintf(stderr, "\ndbg5  Memory reallocated in MBIO function <%s>\n", __func__);
-      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu source:%s line:%d\n", n_mb_alloc, (void *)*ptr, size, sourcefile,
-              sourceline);
+      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu source:%s line:%d\n", mb_memory_count() - 1, (void *)*ptr, size,
+              sourcefile, sourceline);
     }
 
     if (verbose >= 6 || mb_mem_debug) {
       fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("dbg6       ");
     }
   }
 
@@ -526,7 +620,6 @@ int mb_reallocd(int verbose, const char *sourcefile, int sourceline, size_t size
 }
 /*--------------------------------------------------------------------*/
 int mb_free(int verbose, void **ptr, int *error) {
-  verbose = 5;
   if (verbose >= 2 || mb_mem_debug) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
     fprintf(stderr, "dbg2  Input arguments:\n");
@@ -536,41 +629,19 @@ int mb_free(int verbose, void **ptr, int *error) {
 
   /* if keeping list of allocated memory then free memory only if it is in
       the list or list has overflowed */
-  if (mb_memory_list_enabled) {
-    /* check if pointer is in list */
-    int iptr = -1;
-    for (int i = 0; i < n_mb_alloc; i++) {
-      if (mb_alloc_ptr[i] == *ptr) {
-        iptr = i;
-      }
-    }
-
-    /* if pointer is in list remove it from list */
-    size_t ptrsize;
-    void *ptrvalue;
-    if (iptr > -1) {
-      /* remove it from list */
-      ptrvalue = mb_alloc_ptr[iptr];
-      ptrsize = mb_alloc_size[iptr];
-      for (int i = iptr; i < n_mb_alloc - 1; i++) {
-        mb_alloc_ptr[i] = mb_alloc_ptr[i + 1];
-        mb_alloc_size[i] = mb_alloc_size[i + 1];
-        strncpy(mb_alloc_sourcefile[i], mb_alloc_sourcefile[i + 1], MB_NAME_LENGTH - 1);
-        mb_alloc_sourceline[i] = mb_alloc_sourceline[i + 1];
-      }
-      n_mb_alloc--;
-
-      /* free the memory */
-      if (*ptr != NULL) {
-        free(*ptr);
-        *ptr = NULL;
-      }
+  if (mb_memory_list_on()) {
+    /* if pointer is in list remove it from list and free the memory */
+    struct mb_memory_entry entry;
+    const bool listed = mb_memory_remove(*ptr, &entry);
+    if (listed) {
+      free(*ptr);
+      *ptr = NULL;
     }
 
     /* else heap overflow has occurred */
-    else if (mb_alloc_overflow && *ptr != NULL) {
+    else if (atomic_load(&mb_alloc_overflow) && *ptr != NULL) {
 #ifdef MB_MEM_DEBUG
-      fprintf(stderr, "NOTICE: mbm_mem overflow pointer freed %d in function %s\n", *ptr, __func__);
+      fprintf(stderr, "NOTICE: mbm_mem overflow pointer freed %p in function %s\n", *ptr, __func__);
 #endif
 
       /* free the memory */
@@ -578,16 +649,14 @@ int mb_free(int verbose, void **ptr, int *error) {
       *ptr = NULL;
     }
 
-    if ((verbose >= 5 || mb_mem_debug) && iptr > -1) {
+    if ((verbose >= 5 || mb_mem_debug) && listed) {
       fprintf(stderr, "\ndbg5  Allocated memory freed in MBIO function <%s>\n", __func__);
-      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", iptr, ptrvalue, ptrsize);
+      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", mb_memory_count(), entry.ptr, entry.size);
     }
 
     if (verbose >= 6 || mb_mem_debug) {
       fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("dbg6       ");
     }
   }
 
@@ -625,39 +694,19 @@ int mb_freed(int verbose, const char *sourcefile, int sourceline, void **ptr, in
 
   /* if keeping list of allocated memory then free memory only if it is in
       the list or list has overflowed */
-  if (mb_memory_list_enabled) {
-    /* check if pointer is in list */
-    int iptr = -1;
-    for (int i = 0; i < n_mb_alloc; i++)
-      if (ptr != NULL && mb_alloc_ptr[i] == *ptr)
-        iptr = i;
-
-    /* if pointer is in list remove it from list */
-    size_t ptrsize;
-    long ptrvalue;
-    if (iptr > -1) {
-      /* remove it from list */
-      ptrvalue = (size_t)mb_alloc_ptr[iptr];
-      ptrsize = mb_alloc_size[iptr];
-      for (int i = iptr; i < n_mb_alloc - 1; i++) {
-        mb_alloc_ptr[i] = mb_alloc_ptr[i + 1];
-        mb_alloc_size[i] = mb_alloc_size[i + 1];
-        strncpy(mb_alloc_sourcefile[i], mb_alloc_sourcefile[i + 1], MB_NAME_LENGTH - 1);
-        mb_alloc_sourceline[i] = mb_alloc_sourceline[i + 1];
-      }
-      n_mb_alloc--;
-
-      /* free the memory */
-      if (*ptr != NULL) {
-        free(*ptr);
-        *ptr = NULL;
-      }
+  if (mb_memory_list_on()) {
+    /* if pointer is in list remove it from list and free the memory */
+    struct mb_memory_entry entry;
+    const bool listed = ptr != NULL && mb_memory_remove(*ptr, &entry);
+    if (listed) {
+      free(*ptr);
+      *ptr = NULL;
     }
 
     /* else  heap overflow has occurred */
-    else if (mb_alloc_overflow && *ptr != NULL) {
+    else if (atomic_load(&mb_alloc_overflow) && *ptr != NULL) {
   #ifdef MB_MEM_DEBUG
-      fprintf(stderr, "NOTICE: mbm_mem overflow pointer freed %d in function %s\n", *ptr, __func__);
+      fprintf(stderr, "NOTICE: mbm_mem overflow pointer freed %p in function %s\n", *ptr, __func__);
   #endif
 
       /* free the memory */
@@ -665,16 +714,14 @@ int mb_freed(int verbose, const char *sourcefile, int sourceline, void **ptr, in
       *ptr = NULL;
     }
 
-    if ((verbose >= 5 || mb_mem_debug) && iptr > -1) {
+    if ((verbose >= 5 || mb_mem_debug) && listed) {
       fprintf(stderr, "\ndbg5  Allocated memory freed in MBIO function <%s>\n", __func__);
-      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", iptr, (void *)ptrvalue, ptrsize);
+      fprintf(stderr, "dbg5       i:%d  ptr:%p  size:%zu\n", mb_memory_count(), entry.ptr, entry.size);
     }
 
     if (verbose >= 6 || mb_mem_debug) {
       fprintf(stderr, "\ndbg6  Allocated memory list in MBIO function <%s>\n", __func__);
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("dbg6       ");
     }
   }
 
@@ -707,23 +754,29 @@ int mb_memory_clear(int verbose, int *error) {
   }
 
   /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
+  if (mb_memory_list_on()) {
     /* loop over all allocated memory */
-    for (int i = 0; i < n_mb_alloc; i++) {
-      if (verbose >= 5 || mb_mem_debug) {
-        fprintf(stderr, "\ndbg5  Allocated memory freed in MBIO function <%s>\n", __func__);
-        fprintf(stderr, "dbg4       i:%d  ptr:%12p  size:%zu\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i]);
+    pthread_once(&mb_memory_once, mb_memory_init);
+    for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++) {
+      struct mb_memory_shard *shard = &mb_memory_shards[ishard];
+      pthread_mutex_lock(&shard->mutex);
+      for (int islot = 0; islot < shard->nslot; islot++) {
+        if (shard->entry[islot].ptr != NULL) {
+          if (verbose >= 5 || mb_mem_debug) {
+            fprintf(stderr, "\ndbg5  Allocated memory freed in MBIO function <%s>\n", __func__);
+            fprintf(stderr, "dbg4       ptr:%12p  size:%zu\n", shard->entry[islot].ptr, shard->entry[islot].size);
+          }
+
+          /* free the memory */
+          free(shard->entry[islot].ptr);
+        }
       }
-
-      /* free the memory */
-      if (mb_alloc_ptr[i] != NULL)
-        free(mb_alloc_ptr[i]);
-      mb_alloc_ptr[i] = NULL;
-      mb_alloc_size[i] = 0;
-      (mb_alloc_sourcefile[i])[0] = 0;
-      mb_alloc_sourceline[i] = 0;
+      free(shard->entry);
+      shard->entry = NULL;
+      shard->nslot = 0;
+      shard->nalloc = 0;
+      pthread_mutex_unlock(&shard->mutex);
     }
-    n_mb_alloc = 0;
   }
 
   /* assume success */
@@ -753,15 +806,22 @@ int mb_memory_status(int verbose, int *nalloc, int *nallocmax, int *overflow, si
   *overflow = 0;
   *allocsize = 0;
 
-  /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
+  /* keep list of allocated memory - the list grows as needed, so
+      nallocmax is the number of entries held before it next grows */
+  if (mb_memory_list_on()) {
     /* get status */
-    *nalloc = n_mb_alloc;
-    *nallocmax = MB_MEMORY_HEAP_MAX;
-    *overflow = mb_alloc_overflow;
-    *allocsize = 0;
-    for (int i = 0; i < n_mb_alloc; i++)
-      *allocsize += mb_alloc_size[i];
+    pthread_once(&mb_memory_once, mb_memory_init);
+    for (int ishard = 0; ishard < MB_MEMORY_SHARD_NUM; ishard++) {
+      const struct mb_memory_shard *shard = &mb_memory_shards[ishard];
+      pthread_mutex_lock(&mb_memory_shards[ishard].mutex);
+      *nalloc += shard->nalloc;
+      *nallocmax += shard->nslot / 2;
+      for (int islot = 0; islot < shard->nslot; islot++)
+        if (shard->entry[islot].ptr != NULL)
+          *allocsize += shard->entry[islot].size;
+      pthread_mutex_unlock(&mb_memory_shards[ishard].mutex);
+    }
+    *overflow = atomic_load(&mb_alloc_overflow);
   }
 
   /* assume success */
@@ -791,23 +851,20 @@ int mb_memory_list(int verbose, int *error) {
   }
 
   /* keep list of allocated memory */
-  if (mb_memory_list_enabled) {
+  if (mb_memory_list_on()) {
+    const int nalloc = mb_memory_count();
     if (verbose >= 4 || mb_mem_debug) {
-      if (n_mb_alloc > 0) {
+      if (nalloc > 0) {
         fprintf(stderr, "\ndbg4  Allocated memory list in MBIO function <%s>\n", __func__);
-        for (int i = 0; i < n_mb_alloc; i++)
-          fprintf(stderr, "dbg6       i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i],
-                  mb_alloc_size[i], mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+        mb_memory_print("dbg6       ");
       }
       else {
         fprintf(stderr, "\ndbg4  No memory currently allocated in MBIO function <%s>\n", __func__);
       }
     }
-    else if (n_mb_alloc > 0) {
+    else if (nalloc > 0) {
       fprintf(stderr, "\nWarning: some objects are still allocated in memory:\n");
-      for (int i = 0; i < n_mb_alloc; i++)
-        fprintf(stderr, "     i:%d  ptr:%p  size:%zu source:%s line:%d\n", i, (void *)mb_alloc_ptr[i], mb_alloc_size[i],
-                mb_alloc_sourcefile[i], mb_alloc_sourceline[i]);
+      mb_memory_print("     ");
       fprintf(stderr, "Probable failure in MB-System garbage collection...\n");
     }
   }
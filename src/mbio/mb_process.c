@@ -225,6 +225,7 @@ int mb_pr_readpar(int verbose, char *file, int lookforfiles, struct mb_process_s
 	process->mbp_tt_mult = 1.0;
 	process->mbp_angle_mode = MBP_ANGLES_SNELL;
 	process->mbp_corrected = true;
+	process->mbp_rt_table = 0.0;
 	process->mbp_static_mode = MBP_STATIC_OFF;
 	process->mbp_staticfile[0] = '\0';
 
@@ -607,6 +608,9 @@ int mb_pr_readpar(int verbose, char *file, int lookforfiles, struct mb_process_s
 				else if (strncmp(buffer, "SOUNDSPEEDREF", 13) == 0) {
 					sscanf(buffer, "%s %d", dummy, &process->mbp_corrected);
 				}
+				else if (strncmp(buffer, "RAYTABLE", 8) == 0) {
+					sscanf(buffer, "%s %lf", dummy, &process->mbp_rt_table);
+				}
 
 				/* static beam bathymetry correction */
 				else if (strncmp(buffer, "STATICMODE", 10) == 0) {
@@ -1231,6 +1235,7 @@ int mb_pr_readpar(int verbose, char *file, int lookforfiles, struct mb_process_s
 		fprintf(stderr, "dbg2       mbp_svp_mode:           %d\n", process->mbp_svp_mode);
 		fprintf(stderr, "dbg2       mbp_svpfile:            %s\n", process->mbp_svpfile);
 		fprintf(stderr, "dbg2       mbp_corrected:          %d\n", process->mbp_corrected);
+		fprintf(stderr, "dbg2       mbp_rt_table:           %f\n", process->mbp_rt_table);
 		fprintf(stderr, "dbg2       mbp_tt_mode:            %d\n", process->mbp_tt_mode);
 		fprintf(stderr, "dbg2       mbp_tt_mult:            %f\n", process->mbp_tt_mult);
 		fprintf(stderr, "dbg2       mbp_angle_mode:         %d\n", process->mbp_angle_mode);
@@ -1370,6 +1375,7 @@ int mb_pr_writepar(int verbose, char *file, struct mb_process_struct *process, i
 		fprintf(stderr, "dbg2       mbp_svp_mode:           %d\n", process->mbp_svp_mode);
 		fprintf(stderr, "dbg2       mbp_svpfile:            %s\n", process->mbp_svpfile);
 		fprintf(stderr, "dbg2       mbp_corrected:          %d\n", process->mbp_corrected);
+		fprintf(stderr, "dbg2       mbp_rt_table:           %f\n", process->mbp_rt_table);
 		fprintf(stderr, "dbg2       mbp_tt_mode:            %d\n", process->mbp_tt_mode);
 		fprintf(stderr, "dbg2       mbp_tt_mult:            %f\n", process->mbp_tt_mult);
 		fprintf(stderr, "dbg2       mbp_angle_mode:         %d\n", process->mbp_angle_mode);
@@ -1575,6 +1581,7 @@ int mb_pr_writepar(int verbose, char *file, struct mb_process_struct *process, i
 		fprintf(fp, "TTMULTIPLY %f\n", process->mbp_tt_mult);
 		fprintf(fp, "ANGLEMODE %d\n", process->mbp_angle_mode);
 		fprintf(fp, "SOUNDSPEEDREF %d\n", process->mbp_corrected);
+		fprintf(fp, "RAYTABLE %f\n", process->mbp_rt_table);
 		fprintf(fp, "STATICMODE %d\n", process->mbp_static_mode);
 		strcpy(relative_path, process->mbp_staticfile);
 		status = mb_get_relative_path(verbose, relative_path, pwd, error);
@@ -1807,6 +1814,7 @@ int mb_pr_compare(int verbose, struct mb_process_struct *process1,
 	if (process1->mbp_svp_mode != process2->mbp_svp_mode) (*num_difference)++;
 	if (strncmp(process1->mbp_svpfile, process2->mbp_svpfile, MBP_FILENAMESIZE) != 0) (*num_difference)++;
 	if (process1->mbp_corrected != process2->mbp_corrected) (*num_difference)++;
+	if (process1->mbp_rt_table != process2->mbp_rt_table) (*num_difference)++;
 	if (process1->mbp_tt_mode != process2->mbp_tt_mode) (*num_difference)++;
 	if (process1->mbp_tt_mult != process2->mbp_tt_mult) (*num_difference)++;
 	if (process1->mbp_angle_mode != process2->mbp_angle_mode) (*num_difference)++;
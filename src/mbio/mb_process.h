@@ -254,6 +254,9 @@
  *                                  #  2: adjust beams angles by Snell's law
  *                                  #     using array geometry
  *   SOUNDSPEEDREF boolean          # sets raytraced bathymetry to "corrected" values [1]
+ *   RAYTABLE tolerance             # sets raytracing by interpolation in precomputed
+ *                                  #   tables with the given position tolerance (m);
+ *                                  #   0 traces every ray exactly [0.0]
  *
  * STATIC BEAM BATHYMETRY OFFSETS:
  *   STATICMODE mode                # sets offsetting of bathymetry by per-beam statics [0]
@@ -833,6 +836,7 @@ struct mb_process_struct {
   double mbp_tt_mult;
   int mbp_angle_mode;
   int mbp_corrected;
+  double mbp_rt_table;
   int mbp_static_mode;
   char mbp_staticfile[MBP_FILENAMESIZE];
 
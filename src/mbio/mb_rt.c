@@ -24,6 +24,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "mb_define.h"
@@ -47,6 +48,13 @@ static const int MB_RT_PLOT_MODE_TABLE = 2;
 static const int MB_SSV_CORRECT = 1;
 static const int MB_SSV_INCORRECT = 2;
 
+/* raytracing lookup table defines */
+static const double MB_RT_TABLE_DEPTH_SPACING = 1.0;  /* m between source depth nodes */
+static const double MB_RT_TABLE_ANGLE_SPACING = 0.25; /* deg between takeoff angle nodes */
+static const int MB_RT_TABLE_NUMBER_TIME = 512;       /* travel time cells */
+static const int MB_RT_TABLE_NUMBER_DEPTH_MAX = 16;   /* source depth nodes held at once */
+static const double MB_RT_TABLE_TIME_FACTOR = 4.0;    /* time span relative to vertical ray */
+
 struct velocity_model {
 	/* velocity model */
 	int number_node;
@@ -86,6 +94,24 @@ struct velocity_model {
 	double *xx_plot;
 	double *zz_plot;
 	double *tt_plot;
+
+	/* raytracing lookup tables - for each source depth node the ray
+	    positions and status are tabulated against takeoff angle and
+	    travel time, and each cell between two depth nodes is flagged
+	    valid if its interpolation error is within tolerance */
+	double table_tolerance;
+	double table_time_max;
+	int table_number_depth;
+	int table_number_angle;
+	int table_number_time;
+	int table_number_alloc;
+	double *table_time;
+	double **table_x;
+	double **table_z;
+	char **table_status;
+	char **table_valid;
+	int table_nlookup;
+	int table_nexact;
 };
 
 /*--------------------------------------------------------------------------*/
@@ -165,6 +191,21 @@ int mb_rt_init(int verbose, int number_node, double *depth, double *velocity, vo
 	model->zz_plot = NULL;
 	model->tt_plot = NULL;
 
+	/* lookup tables are off until mb_rt_table_init() is called */
+	model->table_tolerance = 0.0;
+	model->table_time_max = 0.0;
+	model->table_number_depth = 0;
+	model->table_number_angle = 0;
+	model->table_number_time = 0;
+	model->table_number_alloc = 0;
+	model->table_time = NULL;
+	model->table_x = NULL;
+	model->table_z = NULL;
+	model->table_status = NULL;
+	model->table_valid = NULL;
+	model->table_nlookup = 0;
+	model->table_nexact = 0;
+
 	if (verbose >= 2) {
 		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
 		fprintf(stderr, "dbg2  Return values:\n");
@@ -187,7 +228,24 @@ int mb_rt_deall(int verbose, void **modelptr, int *error) {
 
 	/* deallocate memory for velocity model */
   struct velocity_model *model = (struct velocity_model *)*modelptr;
-	int status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->depth), error);
+	int status = MB_SUCCESS;
+	if (model->table_tolerance > 0.0) {
+		for (int k = 0; k < model->table_number_depth; k++) {
+			if (model->table_x[k] != NULL) {
+				status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_x[k]), error);
+				status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_z[k]), error);
+				status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_status[k]), error);
+			}
+			if (model->table_valid[k] != NULL)
+				status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_valid[k]), error);
+		}
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_time), error);
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_x), error);
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_z), error);
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_status), error);
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_valid), error);
+	}
+	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->depth), error);
 	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->velocity), error);
 	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->layer_mode), error);
 	status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->layer_gradient), error);
@@ -810,6 +868,408 @@ int mb_rt_vertical(int verbose, void *modelptr, int *error) {
 	return (status);
 }
 /*--------------------------------------------------------------------------*/
+/* trace the ray through the rest of the current layer or until tt_left is
+    exhausted */
+static int mb_rt_layer(int verbose, void *modelptr, int *error) {
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	int status = MB_SUCCESS;
+	if (model->layer_mode[model->layer] == MB_RT_LAYER_GRADIENT && model->pp > 0.0)
+		status = mb_rt_circular(verbose, modelptr, error);
+	else if (model->layer_mode[model->layer] == MB_RT_LAYER_GRADIENT)
+		status = mb_rt_vertical(verbose, modelptr, error);
+	else
+		status = mb_rt_line(verbose, modelptr, error);
+
+	return (status);
+}
+/*--------------------------------------------------------------------------*/
+/* trace a ray from source_depth at a takeoff angle (0 to 90 degrees, any
+    surface sound speed correction already applied) and sample its position
+    and status at the ntime ascending travel times. The ray is stepped from
+    one layer boundary to the next and each sample is found by a single
+    partial step from the start of the layer containing it. */
+static void mb_rt_table_trace(int verbose, void *modelptr, double source_depth, double source_angle, int ntime,
+                              const double *time, double *x, double *z, char *ray_status, int *error) {
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	/* initialize ray */
+	model->layer = -1;
+	for (int i = 0; i < model->number_layer; i++) {
+		if (source_depth >= model->layer_depth_top[i] && source_depth <= model->layer_depth_bottom[i])
+			model->layer = i;
+	}
+	model->vv_source = model->layer_vel_top[model->layer] +
+	                   model->layer_gradient[model->layer] * (source_depth - model->layer_depth_top[model->layer]);
+	model->sign_x = 1;
+	model->pp = sin(DTR * source_angle) / model->vv_source;
+	model->turned = source_angle >= 90.0;
+	model->ray_status = model->turned ? MB_RT_UP : MB_RT_DOWN;
+	model->xx = 0.0;
+	model->zz = source_depth;
+	model->tt = 0.0;
+	model->outofbounds = false;
+	model->plot_mode = MB_RT_PLOT_MODE_OFF;
+	model->number_plot_max = 0;
+	model->number_plot = 0;
+
+	int itime = 0;
+	while (itime < ntime) {
+		/* once the ray leaves the model it stays where it left */
+		if (model->outofbounds) {
+			x[itime] = model->xx;
+			z[itime] = model->zz;
+			ray_status[itime] = model->ray_status;
+			itime++;
+			continue;
+		}
+
+		/* trace through the rest of the layer */
+		const double xx = model->xx;
+		const double zz = model->zz;
+		const double tt = model->tt;
+		const int layer = model->layer;
+		const int turned = model->turned;
+		const int status_start = model->ray_status;
+		model->tt_left = time[ntime - 1] - tt + 1.0;
+		mb_rt_layer(verbose, modelptr, error);
+		const double xf = model->xf;
+		const double zf = model->zf;
+		const double dt = model->dt;
+		const int layer_end = model->layer;
+		const int turned_end = model->turned;
+		const int status_end = model->ray_status;
+
+		/* sample the ray where it is within the layer */
+		while (itime < ntime && time[itime] <= tt + dt) {
+			model->xx = xx;
+			model->zz = zz;
+			model->layer = layer;
+			model->turned = turned;
+			model->ray_status = status_start;
+			model->tt_left = MAX(time[itime] - tt, 0.0);
+			mb_rt_layer(verbose, modelptr, error);
+			x[itime] = model->xf;
+			z[itime] = model->zf;
+			ray_status[itime] = model->ray_status;
+			itime++;
+		}
+
+		/* move to the start of the next layer */
+		model->xx = xf;
+		model->zz = zf;
+		model->tt = tt + dt;
+		model->layer = layer_end;
+		model->turned = turned_end;
+		model->ray_status = status_end;
+		if (model->layer < 0) {
+			model->outofbounds = true;
+			model->ray_status = MB_RT_OUT_TOP;
+		}
+		else if (model->layer >= model->number_layer) {
+			model->outofbounds = true;
+			model->ray_status = MB_RT_OUT_BOTTOM;
+		}
+	}
+}
+/*--------------------------------------------------------------------------*/
+/* make sure the table for source depth node k exists, freeing the node
+    farthest from it if too many are held */
+static int mb_rt_table_node(int verbose, void *modelptr, int k, int *error) {
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	if (model->table_x[k] != NULL)
+		return (MB_SUCCESS);
+
+	int status = MB_SUCCESS;
+
+	/* free the farthest node and the cells next to it */
+	if (model->table_number_alloc >= MB_RT_TABLE_NUMBER_DEPTH_MAX) {
+		int kfree = -1;
+		for (int kk = 0; kk < model->table_number_depth; kk++) {
+			if (model->table_x[kk] != NULL && (kfree < 0 || abs(kk - k) > abs(kfree - k)))
+				kfree = kk;
+		}
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_x[kfree]), error);
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_z[kfree]), error);
+		status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_status[kfree]), error);
+		if (model->table_valid[kfree] != NULL)
+			status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_valid[kfree]), error);
+		if (kfree > 0 && model->table_valid[kfree - 1] != NULL)
+			status = mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_valid[kfree - 1]), error);
+		model->table_number_alloc--;
+	}
+
+	/* allocate and fill the node */
+	const int nnode = model->table_number_angle * (model->table_number_time + 1);
+	status = mb_mallocd(verbose, __FILE__, __LINE__, nnode * sizeof(double), (void **)&(model->table_x[k]), error);
+	if (status == MB_SUCCESS)
+		status = mb_mallocd(verbose, __FILE__, __LINE__, nnode * sizeof(double), (void **)&(model->table_z[k]), error);
+	if (status == MB_SUCCESS)
+		status = mb_mallocd(verbose, __FILE__, __LINE__, nnode * sizeof(char), (void **)&(model->table_status[k]), error);
+	if (status != MB_SUCCESS) {
+		int tmp_error = MB_ERROR_NO_ERROR;
+		if (model->table_x[k] != NULL)
+			mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_x[k]), &tmp_error);
+		if (model->table_z[k] != NULL)
+			mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_z[k]), &tmp_error);
+		return (status);
+	}
+	model->table_number_alloc++;
+	const double source_depth = model->depth[0] + k * MB_RT_TABLE_DEPTH_SPACING;
+	for (int i = 0; i < model->table_number_angle; i++) {
+		const int n = i * (model->table_number_time + 1);
+		mb_rt_table_trace(verbose, modelptr, source_depth, i * MB_RT_TABLE_ANGLE_SPACING, model->table_number_time + 1,
+		                  model->table_time, &model->table_x[k][n], &model->table_z[k][n], &model->table_status[k][n], error);
+	}
+
+	return (status);
+}
+/*--------------------------------------------------------------------------*/
+/* make sure the cells between source depth nodes k and k+1 have been
+    checked: the ray traced through the center of each cell, where the
+    interpolation error of a smooth ray path is largest, must lie within
+    the tolerance of the interpolated position */
+static int mb_rt_table_cells(int verbose, void *modelptr, int k, int *error) {
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	int status = mb_rt_table_node(verbose, modelptr, k, error);
+	if (status == MB_SUCCESS)
+		status = mb_rt_table_node(verbose, modelptr, k + 1, error);
+	if (status != MB_SUCCESS || model->table_valid[k] != NULL)
+		return (status);
+
+	const int ntime = model->table_number_time;
+	status = mb_mallocd(verbose, __FILE__, __LINE__, (model->table_number_angle - 1) * ntime * sizeof(char),
+	                    (void **)&(model->table_valid[k]), error);
+	double *time = NULL;
+	double *x = NULL;
+	double *z = NULL;
+	char *ray_status = NULL;
+	if (status == MB_SUCCESS)
+		status = mb_mallocd(verbose, __FILE__, __LINE__, ntime * sizeof(double), (void **)&time, error);
+	if (status == MB_SUCCESS)
+		status = mb_mallocd(verbose, __FILE__, __LINE__, ntime * sizeof(double), (void **)&x, error);
+	if (status == MB_SUCCESS)
+		status = mb_mallocd(verbose, __FILE__, __LINE__, ntime * sizeof(double), (void **)&z, error);
+	if (status == MB_SUCCESS)
+		status = mb_mallocd(verbose, __FILE__, __LINE__, ntime * sizeof(char), (void **)&ray_status, error);
+
+	if (status == MB_SUCCESS) {
+		for (int j = 0; j < ntime; j++)
+			time[j] = 0.5 * (model->table_time[j] + model->table_time[j + 1]);
+		const double source_depth = model->depth[0] + (k + 0.5) * MB_RT_TABLE_DEPTH_SPACING;
+		for (int i = 0; i < model->table_number_angle - 1; i++) {
+			mb_rt_table_trace(verbose, modelptr, source_depth, (i + 0.5) * MB_RT_TABLE_ANGLE_SPACING, ntime, time, x, z,
+			                  ray_status, error);
+			for (int j = 0; j < ntime; j++) {
+				bool valid = ray_status[j] != MB_RT_OUT_TOP && ray_status[j] != MB_RT_OUT_BOTTOM;
+				double xi = 0.0;
+				double zi = 0.0;
+				int dir = 0;
+				for (int kk = k; kk <= k + 1; kk++) {
+					for (int n = i * (ntime + 1) + j; n <= (i + 1) * (ntime + 1) + j; n += ntime + 1) {
+						for (int nn = n; nn <= n + 1; nn++) {
+							xi += 0.125 * model->table_x[kk][nn];
+							zi += 0.125 * model->table_z[kk][nn];
+							if (model->table_status[kk][nn] == MB_RT_OUT_TOP || model->table_status[kk][nn] == MB_RT_OUT_BOTTOM)
+								valid = false;
+						}
+
+						/* rays turning near the cell are not interpolated, as
+						    the path depth varies sharply with angle there */
+						for (int nn = MAX(n - 1, i * (ntime + 1)); nn <= MIN(n + 1, i * (ntime + 1) + ntime - 1); nn++) {
+							const double *table_z = model->table_z[kk];
+							const int dir_nn = table_z[nn + 1] > table_z[nn] ? 1 : (table_z[nn + 1] < table_z[nn] ? -1 : 0);
+							if (dir == 0)
+								dir = dir_nn;
+							else if (dir_nn != 0 && dir_nn != dir)
+								valid = false;
+						}
+					}
+				}
+				/* the interpolation error peaks near the cell center; half the
+				    tolerance is allowed there to cover the rest of the cell */
+				if (fabs(xi - x[j]) > 0.5 * model->table_tolerance || fabs(zi - z[j]) > 0.5 * model->table_tolerance)
+					valid = false;
+				model->table_valid[k][i * ntime + j] = valid;
+			}
+		}
+	}
+
+	int tmp_error = MB_ERROR_NO_ERROR;
+	if (time != NULL)
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&time, &tmp_error);
+	if (x != NULL)
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&x, &tmp_error);
+	if (z != NULL)
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&z, &tmp_error);
+	if (ray_status != NULL)
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&ray_status, &tmp_error);
+	if (status != MB_SUCCESS && model->table_valid[k] != NULL)
+		mb_freed(verbose, __FILE__, __LINE__, (void **)&(model->table_valid[k]), &tmp_error);
+
+	return (status);
+}
+/*--------------------------------------------------------------------------*/
+/* interpolate a ray end point from the lookup tables, returning false if
+    the ray is not covered by a valid table cell */
+static bool mb_rt_table_lookup(int verbose, void *modelptr, double source_depth, double source_angle, double end_time,
+                               double *x, double *z, int *ray_stat, int *error) {
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	const int ntime = model->table_number_time;
+	const double fk = (source_depth - model->depth[0]) / MB_RT_TABLE_DEPTH_SPACING;
+	const double fi = fabs(source_angle) / MB_RT_TABLE_ANGLE_SPACING;
+	const double fj = ntime * sqrt(MAX(end_time, 0.0) / model->table_time_max);
+	if (!(fk >= 0.0 && fk < model->table_number_depth - 1 && fi < model->table_number_angle - 1 && fj < ntime))
+		return (false);
+	const int k = (int)fk;
+	const int i = (int)fi;
+	const int j = (int)fj;
+	if (mb_rt_table_cells(verbose, modelptr, k, error) != MB_SUCCESS || !model->table_valid[k][i * ntime + j])
+		return (false);
+
+	/* trilinear interpolation in source depth, takeoff angle and travel time */
+	const double wk = fk - k;
+	const double wi = fi - i;
+	const double wj = (end_time - model->table_time[j]) / (model->table_time[j + 1] - model->table_time[j]);
+	const int n = i * (ntime + 1) + j;
+	double xx = 0.0;
+	double zz = 0.0;
+	for (int kk = 0; kk < 2; kk++) {
+		const double *table_x = model->table_x[k + kk];
+		const double *table_z = model->table_z[k + kk];
+		const double w = kk == 0 ? 1.0 - wk : wk;
+		xx += w * ((1.0 - wi) * ((1.0 - wj) * table_x[n] + wj * table_x[n + 1]) +
+		           wi * ((1.0 - wj) * table_x[n + ntime + 1] + wj * table_x[n + ntime + 2]));
+		zz += w * ((1.0 - wi) * ((1.0 - wj) * table_z[n] + wj * table_z[n + 1]) +
+		           wi * ((1.0 - wj) * table_z[n + ntime + 1] + wj * table_z[n + ntime + 2]));
+	}
+	*x = xx;
+	*z = zz;
+
+	/* the status is taken from the nearest node */
+	*ray_stat = model->table_status[wk < 0.5 ? k : k + 1][n + (wi < 0.5 ? 0 : ntime + 1) + (wj < 0.5 ? 0 : 1)];
+
+	return (true);
+}
+/*--------------------------------------------------------------------------*/
+int mb_rt_table_init(int verbose, void *modelptr, double tolerance, int *error) {
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+		fprintf(stderr, "dbg2  Input arguments:\n");
+		fprintf(stderr, "dbg2       verbose:          %d\n", verbose);
+		fprintf(stderr, "dbg2       modelptr:         %p\n", modelptr);
+		fprintf(stderr, "dbg2       tolerance:        %f\n", tolerance);
+	}
+
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	int status = MB_SUCCESS;
+
+	/* the time span covers rays up to a few times longer than the
+	    vertical ray through the whole model */
+	double time_vertical = 0.0;
+	for (int i = 0; i < model->number_layer; i++) {
+		if (model->layer_mode[i] == MB_RT_LAYER_GRADIENT)
+			time_vertical += fabs(log(model->layer_vel_bottom[i] / model->layer_vel_top[i]) / model->layer_gradient[i]);
+		else
+			time_vertical += (model->layer_depth_bottom[i] - model->layer_depth_top[i]) / model->layer_vel_top[i];
+	}
+
+	/* tables need at least two source depth nodes */
+	const int number_depth = (int)((model->depth[model->number_node - 1] - model->depth[0]) / MB_RT_TABLE_DEPTH_SPACING) + 1;
+	if (tolerance <= 0.0 || model->table_tolerance > 0.0 || number_depth < 2 || time_vertical <= 0.0) {
+		status = MB_FAILURE;
+		*error = MB_ERROR_BAD_PARAMETER;
+	}
+
+	/* allocate the table arrays - the tables themselves are built as the
+	    rays are traced */
+	if (status == MB_SUCCESS) {
+		model->table_number_depth = number_depth;
+		model->table_number_angle = (int)(90.0 / MB_RT_TABLE_ANGLE_SPACING) + 1;
+		model->table_number_time = MB_RT_TABLE_NUMBER_TIME;
+		model->table_time_max = MB_RT_TABLE_TIME_FACTOR * time_vertical;
+		status = mb_mallocd(verbose, __FILE__, __LINE__, (model->table_number_time + 1) * sizeof(double),
+		                    (void **)&(model->table_time), error);
+		if (status == MB_SUCCESS)
+			status = mb_mallocd(verbose, __FILE__, __LINE__, number_depth * sizeof(double *), (void **)&(model->table_x), error);
+		if (status == MB_SUCCESS)
+			status = mb_mallocd(verbose, __FILE__, __LINE__, number_depth * sizeof(double *), (void **)&(model->table_z), error);
+		if (status == MB_SUCCESS)
+			status = mb_mallocd(verbose, __FILE__, __LINE__, number_depth * sizeof(char *), (void **)&(model->table_status),
+			                    error);
+		if (status == MB_SUCCESS)
+			status = mb_mallocd(verbose, __FILE__, __LINE__, number_depth * sizeof(char *), (void **)&(model->table_valid),
+			                    error);
+	}
+	if (status == MB_SUCCESS) {
+		/* travel time nodes are spaced quadratically so that the short
+		    travel times of shallow water are resolved finely */
+		for (int j = 0; j <= model->table_number_time; j++) {
+			const double u = (double)j / model->table_number_time;
+			model->table_time[j] = model->table_time_max * u * u;
+		}
+		for (int k = 0; k < number_depth; k++) {
+			model->table_x[k] = NULL;
+			model->table_z[k] = NULL;
+			model->table_status[k] = NULL;
+			model->table_valid[k] = NULL;
+		}
+		model->table_number_alloc = 0;
+		model->table_nlookup = 0;
+		model->table_nexact = 0;
+		model->table_tolerance = tolerance;
+	}
+
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+		fprintf(stderr, "dbg2  Return values:\n");
+		fprintf(stderr, "dbg2       error:      %d\n", *error);
+		fprintf(stderr, "dbg2  Return status:\n");
+		fprintf(stderr, "dbg2       status:     %d\n", status);
+	}
+
+	return (status);
+}
+/*--------------------------------------------------------------------------*/
+int mb_rt_table_stats(int verbose, void *modelptr, int *nlookup, int *nexact, int *error) {
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
+		fprintf(stderr, "dbg2  Input arguments:\n");
+		fprintf(stderr, "dbg2       verbose:          %d\n", verbose);
+		fprintf(stderr, "dbg2       modelptr:         %p\n", modelptr);
+	}
+
+  /* get velocity model struct * */
+  struct velocity_model *model = (struct velocity_model *)modelptr;
+
+	*nlookup = model->table_nlookup;
+	*nexact = model->table_nexact;
+
+	const int status = MB_SUCCESS;
+
+	if (verbose >= 2) {
+		fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
+		fprintf(stderr, "dbg2  Return values:\n");
+		fprintf(stderr, "dbg2       nlookup:    %d\n", *nlookup);
+		fprintf(stderr, "dbg2       nexact:     %d\n", *nexact);
+		fprintf(stderr, "dbg2       error:      %d\n", *error);
+		fprintf(stderr, "dbg2  Return status:\n");
+		fprintf(stderr, "dbg2       status:     %d\n", status);
+	}
+
+	return (status);
+}
+/*--------------------------------------------------------------------------*/
 int mb_rt(int verbose, void *modelptr, double source_depth, double source_angle, double end_time, int ssv_mode,
           double surface_vel, double null_angle, int nplot_max,
           int *nplot, double *xplot, double *zplot, double *tplot,
@@ -897,6 +1357,22 @@ int mb_rt(int verbose, void *modelptr, double source_depth, double source_angle,
 	}
   // else do nothing
 
+	/* use the lookup tables if enabled and valid for this ray - building
+	    a table traces rays, so the source layer and velocity are restored
+	    if the ray has to be traced after all */
+	if (model->table_tolerance > 0.0 && nplot_max == 0) {
+		const int layer = model->layer;
+		const double vv_source = model->vv_source;
+		if (mb_rt_table_lookup(verbose, modelptr, source_depth, source_angle, end_time, x, z, ray_stat, error)) {
+			*travel_time = end_time;
+			model->table_nlookup++;
+			return (status);
+		}
+		model->layer = layer;
+		model->vv_source = vv_source;
+		model->table_nexact++;
+	}
+
 	/* now initialize ray */
 	if (source_angle > 0.0)
 		model->sign_x = 1;
@@ -960,12 +1436,7 @@ int mb_rt(int verbose, void *modelptr, double source_depth, double source_angle,
 	/* trace the ray */
 	while (!model->done && !model->outofbounds) {
 		/* trace ray through current layer */
-		if (model->layer_mode[model->layer] == MB_RT_LAYER_GRADIENT && model->pp > 0.0)
-			status = mb_rt_circular(verbose, modelptr, error);
-		else if (model->layer_mode[model->layer] == MB_RT_LAYER_GRADIENT)
-			status = mb_rt_vertical(verbose, modelptr, error);
-		else
-			status = mb_rt_line(verbose, modelptr, error);
+		status = mb_rt_layer(verbose, modelptr, error);
 
 		/* update ray */
 		model->tt = model->tt + model->dt;
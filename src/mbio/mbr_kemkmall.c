@@ -3805,8 +3805,8 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
   *file_indexed = false;
 
   /* set file position to the start */
-  fseek(mb_io_ptr->mbfp, 0, SEEK_SET);
-  mb_io_ptr->file_pos = ftell(mb_io_ptr->mbfp);
+  mb_fileio_seek(verbose, mbio_ptr, 0, SEEK_SET);
+  mb_io_ptr->file_pos = mb_fileio_tell(verbose, mbio_ptr);
 
   /* set status */
   int status = MB_SUCCESS;
@@ -3845,7 +3845,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
               "and make a data sample available. \n"
               "Have a nice day...\n");
       fprintf(stderr, "MBF_KEMKMALL skipped %d bytes before record %.4s at file pos %ld\n",
-                      skip, header.dgmType, ftell(mb_io_ptr->mbfp));
+                      skip, header.dgmType, mb_fileio_tell(verbose, mbio_ptr));
     }
 
     /* now parse the header and index the datagram */
@@ -3853,9 +3853,9 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
 
       /* verify datagram is intact - seek to end of the datagram and read last int
          - make survey mb_io_ptr->file_pos records the position of the start of the datagram */
-      mb_io_ptr->file_pos = ftell(mb_io_ptr->mbfp) - MBSYS_KMBES_HEADER_SIZE;
+      mb_io_ptr->file_pos = mb_fileio_tell(verbose, mbio_ptr) - MBSYS_KMBES_HEADER_SIZE;
       offset = (header.numBytesDgm - MBSYS_KMBES_HEADER_SIZE - sizeof(int));
-      fseek(mb_io_ptr->mbfp, offset, SEEK_CUR);
+      mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_CUR);
 
       read_len = sizeof(int);
       status = mb_fileio_get(verbose, mbio_ptr, (void *)&buffer[0], &read_len, error);
@@ -3874,7 +3874,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
                 header.dgmType, mb_io_ptr->file_pos, header.numBytesDgm, num_bytes_dgm_end);
 #endif
           mb_io_ptr->file_pos += HEADER_SKIP;
-          fseek(mb_io_ptr->mbfp, mb_io_ptr->file_pos, SEEK_SET);
+          mb_fileio_seek(verbose, mbio_ptr, mb_io_ptr->file_pos, SEEK_SET);
           emdgm_type = UNKNOWN;
           // valid_id = false;
         }
@@ -3901,7 +3901,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
             /* get ping info */
             /* skip past the header and the 2 shorts that make up the dgm partition part */
             offset = (mb_io_ptr->file_pos + MBSYS_KMBES_HEADER_SIZE + sizeof(int));
-            fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+            mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
 
             read_len = 12;
             status = mb_fileio_get(verbose, mbio_ptr, (void *)&buffer[0], &read_len, error);
@@ -3955,7 +3955,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
 
             if (status == MB_SUCCESS) {
               offset = (size_t) (mb_io_ptr->file_pos + header.numBytesDgm);
-              fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+              mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
             }
             // TODO: what happens if alloc fails - while condition?
             break;
@@ -3968,7 +3968,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
             /* get ping info */
             /* skip past the header and the 2 shorts that make up the dgm partition part */
             offset = (mb_io_ptr->file_pos + MBSYS_KMBES_HEADER_SIZE + sizeof(int));
-            fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+            mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
 
             read_len = 12;
             status = mb_fileio_get(verbose, mbio_ptr, (void *)&buffer[0], &read_len, error);
@@ -4022,7 +4022,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
 
             if (status == MB_SUCCESS) {
               offset = (size_t) (mb_io_ptr->file_pos + header.numBytesDgm);
-              fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+              mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
             }
             // TODO: what happens if alloc fails - while condition?
             break;
@@ -4035,7 +4035,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
             /* get ping info */
             /* skip past the header and the 2 shorts that make up the dgm partition part */
             offset = (mb_io_ptr->file_pos + MBSYS_KMBES_HEADER_SIZE + sizeof(int));
-            fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+            mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
 
             read_len = 12;
             status = mb_fileio_get(verbose, mbio_ptr, (void *)&buffer[0], &read_len, error);
@@ -4070,7 +4070,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
 
             if (status == MB_SUCCESS) {
               offset = (size_t) (mb_io_ptr->file_pos + header.numBytesDgm);
-              fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+              mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
             }
             // TODO: what happens if alloc fails - while condition?
             break;
@@ -4103,13 +4103,13 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
 
             if (status == MB_SUCCESS) {
               offset = (size_t) (mb_io_ptr->file_pos + header.numBytesDgm);
-              fseek(mb_io_ptr->mbfp, offset, SEEK_SET);
+              mb_fileio_seek(verbose, mbio_ptr, offset, SEEK_SET);
             }
             break;
         }
 
         /* update file position */
-        mb_io_ptr->file_pos = ftell(mb_io_ptr->mbfp);
+        mb_io_ptr->file_pos = mb_fileio_tell(verbose, mbio_ptr);
       }
     }
   }
@@ -4160,7 +4160,7 @@ int mbr_kemkmall_index_data(int verbose, void *mbio_ptr, void *store_ptr, int *e
 #endif
 
   /* set file position back to the start */
-  fseek(mb_io_ptr->mbfp, 0, SEEK_SET);
+  mb_fileio_seek(verbose, mbio_ptr, 0, SEEK_SET);
 
     if (verbose >= 2) {
         fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
@@ -4240,9 +4240,10 @@ int mbr_kemkmall_rd_data(int verbose, void *mbio_ptr, void *store_ptr, int *erro
       mb_get_date(verbose, store->time_d, store->time_i);
       emdgm_type = dgm_index->emdgm_type;
 
-      /* allocate memory to read the record if necessary */
+      /* allocate memory to read the record if necessary - not needed if
+          the file is memory mapped because the datagram is parsed in place */
       read_len = (size_t)dgm_index->header.numBytesDgm;
-      if (*bufferalloc <= read_len) {
+      if (mb_io_ptr->file_mmap == NULL && *bufferalloc <= read_len) {
         *bufferalloc = ((read_len / MBSYS_KMBES_START_BUFFER_SIZE) + 1) * MBSYS_KMBES_START_BUFFER_SIZE;
         status = mb_reallocd(verbose, __FILE__, __LINE__, *bufferalloc, (void **)bufferptr, error);
         if (status != MB_SUCCESS) {
@@ -4256,9 +4257,12 @@ int mbr_kemkmall_rd_data(int verbose, void *mbio_ptr, void *store_ptr, int *erro
 
       /* read the next datagram */
       if (status == MB_SUCCESS) {
-        fseek(mb_io_ptr->mbfp, dgm_index->file_pos, SEEK_SET);
-        status = mb_fileio_get(verbose, mbio_ptr, (void *)&buffer[0], &read_len, error);
-        mb_io_ptr->file_pos = ftell(mb_io_ptr->mbfp);
+        mb_fileio_seek(verbose, mbio_ptr, dgm_index->file_pos, SEEK_SET);
+        if (mb_io_ptr->file_mmap != NULL)
+          status = mb_fileio_map(verbose, mbio_ptr, &buffer, &read_len, error);
+        else
+          status = mb_fileio_get(verbose, mbio_ptr, (void *)&buffer[0], &read_len, error);
+        mb_io_ptr->file_pos = mb_fileio_tell(verbose, mbio_ptr);
       }
 
       // check for partitioned datagrams (i.e. multiple UDP packets that have
@@ -4618,7 +4622,7 @@ numOfDgms, dgmNum, header.numBytesDgm, dgm_index->index_org, dgm_index->ping_num
 
   /* get file position */
   if (mb_io_ptr->mbfp != NULL)
-    mb_io_ptr->file_bytes = ftell(mb_io_ptr->mbfp);
+    mb_io_ptr->file_bytes = mb_fileio_tell(verbose, mbio_ptr);
 
   if (verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> completed\n", __func__);
@@ -8621,6 +8625,9 @@ int mbr_register_kemkmall(int verbose, void *mbio_ptr, int *error) {
       &mb_io_ptr->nav_source, &mb_io_ptr->sensordepth_source, &mb_io_ptr->heading_source, &mb_io_ptr->attitude_source,
       &mb_io_ptr->svp_source, &mb_io_ptr->beamwidth_xtrack, &mb_io_ptr->beamwidth_ltrack, error);
 
+  /* datagrams may be parsed in place from memory mapped files */
+  mb_io_ptr->file_mmap_ok = true;
+
   /* set format and system specific function pointers */
   mb_io_ptr->mb_io_format_alloc = &mbr_alm_kemkmall;
   mb_io_ptr->mb_io_format_free = &mbr_dem_kemkmall;
@@ -450,7 +450,7 @@ int mbr_dem_reson7k3(int verbose, void *mbio_ptr, int *error) {
   // deallocating memory
   if (mb_io_ptr->filemode == MB_FILEMODE_WRITE) {
     // get file offset before writing FileCatalog
-    offset = ftell(mb_io_ptr->mbfp);
+    offset = mb_fileio_tell(verbose, mbio_ptr);
 
     // set the FileCatalog header values
     store->FileCatalog_write.header.Version = 5;
@@ -493,7 +493,7 @@ int mbr_dem_reson7k3(int verbose, void *mbio_ptr, int *error) {
 
     // now reset the size and offset of the FileCatalog record in the FileHeader
     // record at the start of the file
-    fseek(mb_io_ptr->mbfp, (long)*filecatalogoffsetoffset, SEEK_SET);
+    mb_fileio_seek(verbose, mbio_ptr, (long)*filecatalogoffsetoffset, SEEK_SET);
     int index = 0;
     mb_put_binary_int(true, write_len, &buffer[index]);
     index += 4;
@@ -501,7 +501,7 @@ int mbr_dem_reson7k3(int verbose, void *mbio_ptr, int *error) {
     index += 8;
     write_len = index;
     status = mb_fileio_put(verbose, mbio_ptr, buffer, &write_len, error);
-    fseek(mb_io_ptr->mbfp, 0L, SEEK_END);
+    mb_fileio_seek(verbose, mbio_ptr, 0L, SEEK_END);
   }
 
   /* deallocate memory for preprocessing parameters */
@@ -9656,7 +9656,7 @@ int mbr_reson7k3_rd_data(int verbose, void *mbio_ptr, void *store_ptr, int *erro
       /* if FileCatalog has been read then set file pointer to read the next
           record header on the sorted list of records */
       if (store->FileCatalog_read.n > 0 && *icatalog < store->FileCatalog_read.n) {
-        fseek(mb_io_ptr->mbfp, store->FileCatalog_read.filecatalogdata[*icatalog].offset, SEEK_SET);
+        mb_fileio_seek(verbose, mbio_ptr, store->FileCatalog_read.filecatalogdata[*icatalog].offset, SEEK_SET);
         (*icatalog)++;
       }
 
@@ -10512,10 +10512,10 @@ Have a nice day...:                              %4.4X | %d\n", store->type, sto
             && store->FileHeader.file_catalog_offset > 0
             && mb_io_ptr->mbfp != NULL) {
           // save current file location
-          int fpos_current = ftell(mb_io_ptr->mbfp);
+          int fpos_current = mb_fileio_tell(verbose, mbio_ptr);
 
           // move to start of FileCatalog record
-          /* int fstatus = */ fseek(mb_io_ptr->mbfp, store->FileHeader.file_catalog_offset, SEEK_SET);
+          /* int fstatus = */ mb_fileio_seek(verbose, mbio_ptr, store->FileHeader.file_catalog_offset, SEEK_SET);
 
           // Most of the time the FileHeader.file_catalog_size value is the size
           // of the entire FileCatalog record as per the format spec, but sometimes
@@ -10566,7 +10566,7 @@ Have a nice day...:                              %4.4X | %d\n", store->type, sto
           store->type = R7KRECID_FileHeader;
 
           // reset file position
-          /* fstatus = */ fseek(mb_io_ptr->mbfp, fpos_current, SEEK_SET);
+          /* fstatus = */ mb_fileio_seek(verbose, mbio_ptr, fpos_current, SEEK_SET);
           *icatalog = 1;
 
         }
@@ -10711,9 +10711,9 @@ Have a nice day...:                              %4.4X | %d\n", store->type, sto
   /* get file position - check file and socket, use appropriate ftell */
   if (mb_io_ptr->mbfp != NULL) {
        if (*save_flag)
-          mb_io_ptr->file_bytes = ftell(mb_io_ptr->mbfp) - *size;
+          mb_io_ptr->file_bytes = mb_fileio_tell(verbose, mbio_ptr) - *size;
       else
-          mb_io_ptr->file_bytes = ftell(mb_io_ptr->mbfp);
+          mb_io_ptr->file_bytes = mb_fileio_tell(verbose, mbio_ptr);
   }
 #ifdef MBTRN_ENABLED
   else if (mb_io_ptr->mbsp != NULL) {
@@ -11155,7 +11155,7 @@ int mbr_reson7k3_FileCatalog_update(int verbose, void *mbio_ptr, void *store_ptr
   mb_get_time(verbose, time_i, &(filecatalogdata->time_d));
   mbr_reson7k3_chk_pingrecord(verbose, header->RecordType, &filecatalogdata->pingrecord);
   filecatalogdata->size = size;
-  filecatalogdata->offset = ftell(mb_io_ptr->mbfp);
+  filecatalogdata->offset = mb_fileio_tell(verbose, mbio_ptr);
   filecatalogdata->record_type = header->RecordType;
   filecatalogdata->device_id = header->DeviceId;
   filecatalogdata->system_enumerator = header->SystemEnumerator;
@@ -21418,6 +21418,9 @@ int mbr_register_reson7k3(int verbose, void *mbio_ptr, int *error) {
       &mb_io_ptr->nav_source, &mb_io_ptr->sensordepth_source, &mb_io_ptr->heading_source, &mb_io_ptr->attitude_source,
       &mb_io_ptr->svp_source, &mb_io_ptr->beamwidth_xtrack, &mb_io_ptr->beamwidth_ltrack, error);
 
+  /* records may be read from memory mapped files */
+  mb_io_ptr->file_mmap_ok = true;
+
   /* set format and system specific function pointers */
   mb_io_ptr->mb_io_format_alloc = &mbr_alm_reson7k3;
   mb_io_ptr->mb_io_format_free = &mbr_dem_reson7k3;
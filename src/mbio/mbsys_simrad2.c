@@ -4437,9 +4437,51 @@ int mbsys_simrad2_copy(int verbose, void *mbio_ptr, void *store_ptr, void *copy_
 		tilt_save = (char *)copy->tilt;
 	}
 
+	/* make sure the copy has its own second head survey, water column
+	    and extra parameters structures so that no memory is shared */
+	struct mbsys_simrad2_ping_struct *ping2_save = copy->ping2;
+	if (store->ping2 != NULL && ping2_save == NULL)
+		status &= mb_mallocd(verbose, __FILE__, __LINE__, sizeof(struct mbsys_simrad2_ping_struct), (void **)&ping2_save,
+		                     error);
+	struct mbsys_simrad2_watercolumn_struct *wc_save = copy->wc;
+	if (store->wc != NULL && wc_save == NULL)
+		status &= mb_mallocd(verbose, __FILE__, __LINE__, sizeof(struct mbsys_simrad2_watercolumn_struct), (void **)&wc_save,
+		                     error);
+	struct mbsys_simrad2_extraparameters_struct *extraparameters_save = copy->extraparameters;
+	if (store->extraparameters != NULL && extraparameters_save == NULL) {
+		status &= mb_mallocd(verbose, __FILE__, __LINE__, sizeof(struct mbsys_simrad2_extraparameters_struct),
+		                     (void **)&extraparameters_save, error);
+		if (extraparameters_save != NULL)
+			memset(extraparameters_save, 0, sizeof(struct mbsys_simrad2_extraparameters_struct));
+	}
+
 	/* copy the main structure */
+	struct mbsys_simrad2_ping_struct *ping_old = copy->ping;
 	*copy = *store;
 
+	/* restore the structures owned by the copy and copy their contents */
+	copy->ping2 = ping2_save;
+	if (store->ping2 != NULL && ping2_save != NULL)
+		*ping2_save = *store->ping2;
+	copy->wc = wc_save;
+	if (store->wc != NULL && wc_save != NULL)
+		*wc_save = *store->wc;
+	copy->extraparameters = extraparameters_save;
+	if (store->extraparameters != NULL && extraparameters_save != NULL) {
+		char *xtr_data_save = extraparameters_save->xtr_data;
+		int xtr_nalloc_save = extraparameters_save->xtr_nalloc;
+		*extraparameters_save = *store->extraparameters;
+		extraparameters_save->xtr_data = xtr_data_save;
+		extraparameters_save->xtr_nalloc = xtr_nalloc_save;
+		if (extraparameters_save->xtr_data_size > extraparameters_save->xtr_nalloc) {
+			status &= mb_reallocd(verbose, __FILE__, __LINE__, extraparameters_save->xtr_data_size,
+			                      (void **)&extraparameters_save->xtr_data, error);
+			extraparameters_save->xtr_nalloc = extraparameters_save->xtr_data == NULL ? 0 : extraparameters_save->xtr_data_size;
+		}
+		if (extraparameters_save->xtr_data_size > 0 && extraparameters_save->xtr_nalloc >= extraparameters_save->xtr_data_size)
+			memcpy(extraparameters_save->xtr_data, store->extraparameters->xtr_data, extraparameters_save->xtr_data_size);
+	}
+
 	/* if needed copy the survey data structure */
 	if (store->kind == MB_DATA_DATA && store->ping != NULL && status == MB_SUCCESS) {
 		copy->ping = (struct mbsys_simrad2_ping_struct *)ping_save;
@@ -4447,6 +4489,8 @@ int mbsys_simrad2_copy(int verbose, void *mbio_ptr, void *store_ptr, void *copy_
 		struct mbsys_simrad2_ping_struct *ping_copy = (struct mbsys_simrad2_ping_struct *)copy->ping;
 		*ping_copy = *ping_store;
 	} else {
+		if (ping_old != NULL)
+			status &= mb_freed(verbose, __FILE__, __LINE__, (void **)&ping_old, error);
 		copy->ping = NULL;
 	}
 
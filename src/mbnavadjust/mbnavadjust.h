@@ -255,6 +255,9 @@ int mbnavadjust_referenceplussection_load(void);
 int mbnavadjust_referenceplussection_unload(void);
 int mbnavadjust_referencegrid_unload(void);
 int mbnavadjust_invertnav(void);
+void mbnavadjust_lsqr(struct mbna_matrix *matrix, double damp, double u[], double v[], double w[], double x[], double se[],
+                      double atol, double btol, double conlim, int itnlim, int *istop_out, int *itn_out, double *anorm_out,
+                      double *acond_out, double *rnorm_out, double *arnorm_out, double *xnorm_out);
 int mbnavadjust_applynav(void);
 int mbnavadjust_updategrid(void);
 int mbnavadjust_modelplot_plot(const char *sourcefile, int sourceline);
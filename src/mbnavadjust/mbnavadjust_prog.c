@@ -142,6 +142,20 @@ struct swath *swath1 = NULL;
 struct swath *swath2 = NULL;
 struct ping *ping = NULL;
 
+/* loaded sections kept after their crossing is unloaded, so that crossings
+   sharing a section are not reread and retriangulated each time they load */
+#define MBNA_SECTION_CACHE_MAX 8
+struct mbna_section_cache {
+  int file_id;
+  int section_id;
+  void *swathraw;
+  void *swath;
+  unsigned long last_use;
+};
+struct mbna_section_cache section_cache[MBNA_SECTION_CACHE_MAX];
+int section_cache_num = 0;
+unsigned long section_cache_clock = 0;
+
 /* misfit grid parameters */
 int grid_nx = 0;
 int grid_ny = 0;
@@ -181,6 +195,7 @@ void mbnavadjust_newpen(int icolor);
 void mbnavadjust_setline(int linewidth);
 void mbnavadjust_justify_string(double height, char *string, double *s);
 void mbnavadjust_plot_string(double x, double y, double hgt, double angle, char *label);
+static void mbnavadjust_section_cache_flush(void);
 
 /*--------------------------------------------------------------------*/
 int mbnavadjust_init_globals() {
@@ -512,6 +527,7 @@ int mbnavadjust_file_new(char *projectname) {
 
   /* get filenames and see if they can be generated */
   else {
+    mbnavadjust_section_cache_flush();
     char *slashptr = strrchr(projectname, '/');
     char *nameptr = slashptr != NULL ? slashptr + 1 : projectname;
     if (strlen(nameptr) > 4 && strcmp(&nameptr[strlen(nameptr) - 4], ".nvh") == 0)
@@ -658,6 +674,8 @@ int mbnavadjust_file_open(char *projectname) {
     strcpy(error3, "is already open.");
     status = MB_FAILURE;
   } else {
+    mbnavadjust_section_cache_flush();
+
     /* get filenames and see if they can be generated */
     char *slashptr = strrchr(projectname, '/');
     char *nameptr = slashptr != NULL ? slashptr + 1 : projectname;
@@ -3687,6 +3705,55 @@ int mbnavadjust_naverr_unset() {
   return (status);
 }
 /*--------------------------------------------------------------------*/
+/* Load a section, taking it from the section cache if it is there. */
+static int mbnavadjust_section_cache_load(int file_id, int section_id, void **swathraw_ptr, void **swath_ptr) {
+  for (int i = 0; i < section_cache_num; i++) {
+    if (section_cache[i].file_id == file_id && section_cache[i].section_id == section_id) {
+      *swathraw_ptr = section_cache[i].swathraw;
+      *swath_ptr = section_cache[i].swath;
+      section_cache[i] = section_cache[--section_cache_num];
+      return (MB_SUCCESS);
+    }
+  }
+  return (mbnavadjust_section_load(mbna_verbose, &project, file_id, section_id, swathraw_ptr, swath_ptr, &error));
+}
+/*--------------------------------------------------------------------*/
+/* Hand a loaded section to the section cache, unloading the least
+   recently used section if the cache is full. */
+static int mbnavadjust_section_cache_store(int file_id, int section_id, void **swathraw_ptr, void **swath_ptr) {
+  int status = MB_SUCCESS;
+  if (*swathraw_ptr == NULL || *swath_ptr == NULL)
+    return (mbnavadjust_section_unload(mbna_verbose, swathraw_ptr, swath_ptr, &error));
+
+  if (section_cache_num == MBNA_SECTION_CACHE_MAX) {
+    int ioldest = 0;
+    for (int i = 1; i < section_cache_num; i++)
+      if (section_cache[i].last_use < section_cache[ioldest].last_use)
+        ioldest = i;
+    status = mbnavadjust_section_unload(mbna_verbose, &section_cache[ioldest].swathraw, &section_cache[ioldest].swath,
+                                        &error);
+    section_cache[ioldest] = section_cache[--section_cache_num];
+  }
+  struct mbna_section_cache *entry = &section_cache[section_cache_num++];
+  entry->file_id = file_id;
+  entry->section_id = section_id;
+  entry->swathraw = *swathraw_ptr;
+  entry->swath = *swath_ptr;
+  entry->last_use = ++section_cache_clock;
+  *swathraw_ptr = NULL;
+  *swath_ptr = NULL;
+  return (status);
+}
+/*--------------------------------------------------------------------*/
+/* Unload all cached sections, required whenever a project is opened. */
+static void mbnavadjust_section_cache_flush(void) {
+  if (mbna_naverr_mode == MBNA_NAVERR_MODE_CROSSING)
+    mbnavadjust_crossing_unload();
+  for (int i = 0; i < section_cache_num; i++)
+    mbnavadjust_section_unload(mbna_verbose, &section_cache[i].swathraw, &section_cache[i].swath, &error);
+  section_cache_num = 0;
+}
+/*--------------------------------------------------------------------*/
 int mbnavadjust_crossing_load() {
   if (mbna_verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
@@ -3787,12 +3854,10 @@ int mbnavadjust_crossing_load() {
     /* load sections */
     snprintf(message, sizeof(message), "Loading section 1 of crossing %d...", mbna_current_crossing);
     do_message_update(message);
-    status = mbnavadjust_section_load(mbna_verbose, &project, mbna_file_id_1, mbna_section_1,
-                                          (void **)&swathraw1, (void **)&swath1, &error);
+    status = mbnavadjust_section_cache_load(mbna_file_id_1, mbna_section_1, (void **)&swathraw1, (void **)&swath1);
     snprintf(message, sizeof(message), "Loading section 2 of crossing %d...", mbna_current_crossing);
     do_message_update(message);
-    status = mbnavadjust_section_load(mbna_verbose, &project, mbna_file_id_2, mbna_section_2,
-                                          (void **)&swathraw2, (void **)&swath2, &error);
+    status = mbnavadjust_section_cache_load(mbna_file_id_2, mbna_section_2, (void **)&swathraw2, (void **)&swath2);
 
     /* get lon lat positions for soundings */
     snprintf(message, sizeof(message), "Transforming section 1 of crossing %d...", mbna_current_crossing);
@@ -3860,10 +3925,10 @@ int mbnavadjust_crossing_unload() {
 
   int status = MB_SUCCESS;
 
-  /* unload loaded crossing */
+  /* unload loaded crossing, keeping its sections in the section cache */
   if (mbna_naverr_mode == MBNA_NAVERR_MODE_CROSSING) {
-    status = mbnavadjust_section_unload(mbna_verbose, (void **)&swathraw1, (void **)&swath1, &error);
-    status = mbnavadjust_section_unload(mbna_verbose, (void **)&swathraw2, (void **)&swath2, &error);
+    status = mbnavadjust_section_cache_store(mbna_file_id_1, mbna_section_1, (void **)&swathraw1, (void **)&swath1);
+    status = mbnavadjust_section_cache_store(mbna_file_id_2, mbna_section_2, (void **)&swathraw2, (void **)&swath2);
 
     if (mbna_contour1.vector != NULL && mbna_contour1.nvector_alloc > 0) {
       free(mbna_contour1.vector);
@@ -4476,6 +4541,182 @@ int mbnavadjust_naverr_snavpoints(int ix, int iy) {
   return (status);
 }
 /*--------------------------------------------------------------------*/
+/* In place radix 2 complex FFT of n values spaced stride apart, using the
+   n / 2 entry twiddle table (cos, sin) of angle -2 pi k / n. The inverse
+   transform (sign > 0) is not normalized. */
+static void mbnavadjust_fft(int n, int stride, double *re, double *im, const double *twr, const double *twi, int sign) {
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      double t = re[i * stride];
+      re[i * stride] = re[j * stride];
+      re[j * stride] = t;
+      t = im[i * stride];
+      im[i * stride] = im[j * stride];
+      im[j * stride] = t;
+    }
+  }
+  for (int len = 2; len <= n; len <<= 1) {
+    const int half = len / 2;
+    const int step = n / len;
+    for (int k = 0; k < half; k++) {
+      const double wr = twr[k * step];
+      const double wi = sign > 0 ? -twi[k * step] : twi[k * step];
+      for (int i = k; i < n; i += len) {
+        const int a = i * stride;
+        const int b = (i + half) * stride;
+        const double tr = re[b] * wr - im[b] * wi;
+        const double ti = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/* Two dimensional FFT of an n x n array stored by rows. */
+static void mbnavadjust_fft2d(int n, double *re, double *im, const double *twr, const double *twi, int sign) {
+  for (int j = 0; j < n; j++)
+    mbnavadjust_fft(n, 1, &re[j * n], &im[j * n], twr, twi, sign);
+  for (int i = 0; i < n; i++)
+    mbnavadjust_fft(n, n, &re[i], &im[i], twr, twi, sign);
+}
+/*--------------------------------------------------------------------*/
+/* Calculate the summed squared misfit gridm and number of overlapping cells
+   gridnm between the gridded bathymetry grid1 and grid2 for every lateral
+   offset of the gridm_nx x gridm_ny misfit grid and every z offset. With
+   occupancy masks m1 and m2 and c the z offset relative to zoffset0,
+     sum m1 m2 (g2 - g1 + c)^2 = S + 2 c D + c^2 N
+   where S, D and N are sums of cross-correlations of the masks, depths and
+   squared depths. The correlations are computed with zero padded FFTs,
+   costing O(n log n) for the whole lateral offset surface, and each z offset
+   then costs one multiply-add per lateral offset. */
+static int mbnavadjust_misfit_fft(int nx, int ny, const double *g1, const int *n1, const double *g2, const int *n2,
+                                  int mnx, int mny, int nz, double z0, double dz, double zoffset0, double *gridm,
+                                  int *gridnm) {
+  /* pad to a power of two beyond the largest offset so the circular
+     correlation does not wrap */
+  int n = 1;
+  while (n < MAX(nx + mnx / 2, ny + mny / 2))
+    n <<= 1;
+  const int nn = n * n;
+
+  double *work = (double *)malloc(sizeof(double) * (10 * nn + n));
+  if (work == NULL)
+    return (MB_FAILURE);
+  double *are = &work[0];
+  double *aim = &work[nn];
+  double *bre = &work[2 * nn];
+  double *bim = &work[3 * nn];
+  double *qre = &work[4 * nn];
+  double *qim = &work[5 * nn];
+  double *cre = &work[6 * nn];
+  double *cim = &work[7 * nn];
+  double *sre = &work[8 * nn];
+  double *sim = &work[9 * nn];
+  double *twr = &work[10 * nn];
+  double *twi = &twr[n / 2];
+  for (int k = 0; k < n / 2; k++) {
+    twr[k] = cos(2.0 * M_PI * k / n);
+    twi[k] = -sin(2.0 * M_PI * k / n);
+  }
+
+  /* depths relative to their mean keep the correlations well conditioned */
+  double zref = 0.0;
+  int nref = 0;
+  for (int k = 0; k < nx * ny; k++) {
+    if (n1[k] > 0) {
+      zref += g1[k];
+      nref++;
+    }
+    if (n2[k] > 0) {
+      zref += g2[k];
+      nref++;
+    }
+  }
+  if (nref > 0)
+    zref /= nref;
+
+  /* pack pairs of real arrays into complex arrays: mask + i depth for each
+     grid, and the squared depths of both grids */
+  memset(work, 0, sizeof(double) * 6 * nn);
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i < nx; i++) {
+      const int k = i + j * nx;
+      const int kk = i + j * n;
+      if (n1[k] > 0) {
+        are[kk] = 1.0;
+        aim[kk] = g1[k] - zref;
+        qre[kk] = aim[kk] * aim[kk];
+      }
+      if (n2[k] > 0) {
+        bre[kk] = 1.0;
+        bim[kk] = g2[k] - zref;
+        qim[kk] = bim[kk] * bim[kk];
+      }
+    }
+  mbnavadjust_fft2d(n, are, aim, twr, twi, -1);
+  mbnavadjust_fft2d(n, bre, bim, twr, twi, -1);
+  mbnavadjust_fft2d(n, qre, qim, twr, twi, -1);
+
+  /* separate the spectra of the packed arrays and form the spectra of
+       N + i D  with N = corr(m1, m2), D = corr(m1, m2 g2) - corr(m1 g1, m2)
+       S = corr(m1, m2 g2^2) + corr(m1 g1^2, m2) - 2 corr(m1 g1, m2 g2)
+     where corr(f, g)(o) = sum f(p) g(p + o) transforms to conj(F) G */
+  for (int jy = 0; jy < n; jy++)
+    for (int ix = 0; ix < n; ix++) {
+      const int k = ix + jy * n;
+      const int kr = ((n - ix) % n) + ((n - jy) % n) * n;
+      const double m1r = 0.5 * (are[k] + are[kr]);
+      const double m1i = 0.5 * (aim[k] - aim[kr]);
+      const double z1r = 0.5 * (aim[k] + aim[kr]);
+      const double z1i = -0.5 * (are[k] - are[kr]);
+      const double m2r = 0.5 * (bre[k] + bre[kr]);
+      const double m2i = 0.5 * (bim[k] - bim[kr]);
+      const double z2r = 0.5 * (bim[k] + bim[kr]);
+      const double z2i = -0.5 * (bre[k] - bre[kr]);
+      const double q1r = 0.5 * (qre[k] + qre[kr]);
+      const double q1i = 0.5 * (qim[k] - qim[kr]);
+      const double q2r = 0.5 * (qim[k] + qim[kr]);
+      const double q2i = -0.5 * (qre[k] - qre[kr]);
+      const double nr = m1r * m2r + m1i * m2i;
+      const double ni = m1r * m2i - m1i * m2r;
+      const double dr = (m1r * z2r + m1i * z2i) - (z1r * m2r + z1i * m2i);
+      const double di = (m1r * z2i - m1i * z2r) - (z1r * m2i - z1i * m2r);
+      cre[k] = nr - di;
+      cim[k] = ni + dr;
+      sre[k] = (m1r * q2r + m1i * q2i) + (q1r * m2r + q1i * m2i) - 2.0 * (z1r * z2r + z1i * z2i);
+      sim[k] = (m1r * q2i - m1i * q2r) + (q1r * m2i - q1i * m2r) - 2.0 * (z1r * z2i - z1i * z2r);
+    }
+  mbnavadjust_fft2d(n, cre, cim, twr, twi, 1);
+  mbnavadjust_fft2d(n, sre, sim, twr, twi, 1);
+
+  /* assemble the misfit sums for each lateral and z offset */
+  for (int ic = 0; ic < mnx; ic++)
+    for (int jc = 0; jc < mny; jc++) {
+      const int ioff = (mnx / 2) - ic;
+      const int joff = (mny / 2) - jc;
+      const int ko = ((ioff + n) % n) + ((joff + n) % n) * n;
+      const int count = (int)floor(cre[ko] / nn + 0.5);
+      const double d = cim[ko] / nn;
+      const double ss = sre[ko] / nn;
+      for (int kc = 0; kc < nz; kc++) {
+        const int lc = kc + nz * (ic + jc * mnx);
+        const double c = z0 + dz * kc - zoffset0;
+        gridnm[lc] = count;
+        gridm[lc] = count > 0 ? MAX(0.0, ss + 2.0 * c * d + c * c * count) : 0.0;
+      }
+    }
+
+  free(work);
+  return (MB_SUCCESS);
+}
+/*--------------------------------------------------------------------*/
 int mbnavadjust_get_misfit() {
   if (mbna_verbose >= 2) {
     fprintf(stderr, "\ndbg2  MBIO function <%s> called\n", __func__);
@@ -4705,35 +4946,39 @@ int mbnavadjust_get_misfit() {
       k,gridn1[k],grid1[k],gridn2[k],grid2[k]); */
     }
 
-    /* calculate gridded misfit over lateral and z offsets */
-    for (int ic = 0; ic < gridm_nx; ic++)
-      for (int jc = 0; jc < gridm_ny; jc++)
-        for (int kc = 0; kc < nzmisfitcalc; kc++) {
-          lc = kc + nzmisfitcalc * (ic + jc * gridm_nx);
-          gridm[lc] = 0.0;
-          gridnm[lc] = 0;
-
-          ioff = (gridm_nx / 2) - ic;
-          joff = (gridm_ny / 2) - jc;
-          zoff = zmin + zoff_dz * kc;
-
-          istart = MAX(-ioff, 0);
-          iend = grid_nx - MAX(0, ioff);
-          jstart = MAX(-joff, 0);
-          jend = grid_ny - MAX(0, joff);
-          for (int i1 = istart; i1 < iend; i1++)
-            for (int j1 = jstart; j1 < jend; j1++) {
-              i2 = i1 + ioff;
-              j2 = j1 + joff;
-              k1 = i1 + j1 * grid_nx;
-              k2 = i2 + j2 * grid_nx;
-              if (gridn1[k1] > 0 && gridn2[k2] > 0) {
-                gridm[lc] += (grid2[k2] - grid1[k1] + zoff - mbna_offset_z) *
-                             (grid2[k2] - grid1[k1] + zoff - mbna_offset_z);
-                gridnm[lc]++;
+    /* calculate gridded misfit over lateral and z offsets, by brute force
+       if the FFT work arrays cannot be allocated */
+    if (mbnavadjust_misfit_fft(grid_nx, grid_ny, grid1, gridn1, grid2, gridn2, gridm_nx, gridm_ny, nzmisfitcalc, zmin,
+                               zoff_dz, mbna_offset_z, gridm, gridnm) != MB_SUCCESS) {
+      for (int ic = 0; ic < gridm_nx; ic++)
+        for (int jc = 0; jc < gridm_ny; jc++)
+          for (int kc = 0; kc < nzmisfitcalc; kc++) {
+            lc = kc + nzmisfitcalc * (ic + jc * gridm_nx);
+            gridm[lc] = 0.0;
+            gridnm[lc] = 0;
+
+            ioff = (gridm_nx / 2) - ic;
+            joff = (gridm_ny / 2) - jc;
+            zoff = zmin + zoff_dz * kc;
+
+            istart = MAX(-ioff, 0);
+            iend = grid_nx - MAX(0, ioff);
+            jstart = MAX(-joff, 0);
+            jend = grid_ny - MAX(0, joff);
+            for (int i1 = istart; i1 < iend; i1++)
+              for (int j1 = jstart; j1 < jend; j1++) {
+                i2 = i1 + ioff;
+                j2 = j1 + joff;
+                k1 = i1 + j1 * grid_nx;
+                k2 = i2 + j2 * grid_nx;
+                if (gridn1[k1] > 0 && gridn2[k2] > 0) {
+                  gridm[lc] += (grid2[k2] - grid1[k1] + zoff - mbna_offset_z) *
+                               (grid2[k2] - grid1[k1] + zoff - mbna_offset_z);
+                  gridnm[lc]++;
+                }
               }
-            }
-        }
+          }
+    }
     misfit_min = 0.0;
     misfit_max = 0.0;
     mbna_minmisfit = 0.0;
@@ -7125,8 +7370,8 @@ int mbnavadjust_autosetsvsvertical() {
       //  fprintf(stderr," | b:%10.6f\n",u[i]);
       //  }
 
-      mblsqr_lsqr(nrows_ba, ncols_ba, &mb_aprod, damp, &matrix, u, v, w, x, se, atol, btol, conlim, itnlim, stderr,
-                  &istop_out, &itn_out, &anorm_out, &acond_out, &rnorm_out, &arnorm_out, &xnorm_out);
+      mbnavadjust_lsqr(&matrix, damp, u, v, w, x, se, atol, btol, conlim, itnlim, &istop_out, &itn_out, &anorm_out,
+                       &acond_out, &rnorm_out, &arnorm_out, &xnorm_out);
 
       /* save solution */
       for (int ifile = 0; ifile < project.num_files; ifile++) {
@@ -7774,6 +8019,31 @@ void mb_aprod(int mode, int m, int n, double x[], double y[], void *UsrWrk) {
   }
 }
 /*--------------------------------------------------------------------*/
+/* Solve the inversion problem held in matrix with LSQR. The fixed stride
+   fill is compressed to sparse row form with a precomputed transpose so
+   that the matrix products and vector kernels run on all processors; if
+   that cannot be allocated the products fall back to mb_aprod. */
+void mbnavadjust_lsqr(struct mbna_matrix *matrix, double damp, double u[], double v[], double w[], double x[], double se[],
+                      double atol, double btol, double conlim, int itnlim, int *istop_out, int *itn_out, double *anorm_out,
+                      double *acond_out, double *rnorm_out, double *arnorm_out, double *xnorm_out) {
+#ifdef _SC_NPROCESSORS_ONLN
+  mbcblas_set_num_threads((int)sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+
+  struct mblsqr_csr csr;
+  if (mblsqr_csr_init(mbna_verbose, matrix->m, matrix->n, matrix->ia_dim, matrix->nia, matrix->ia, matrix->a, &csr, &error)
+      == MB_SUCCESS) {
+    mblsqr_lsqr(matrix->m, matrix->n, &mblsqr_csr_aprod, damp, &csr, u, v, w, x, se, atol, btol, conlim, itnlim, stderr,
+                istop_out, itn_out, anorm_out, acond_out, rnorm_out, arnorm_out, xnorm_out);
+    mblsqr_csr_deall(mbna_verbose, &csr, &error);
+  }
+  else {
+    fprintf(stderr, "Unable to build sparse row matrix (error %d), using serial matrix products\n", error);
+    mblsqr_lsqr(matrix->m, matrix->n, &mb_aprod, damp, matrix, u, v, w, x, se, atol, btol, conlim, itnlim, stderr,
+                istop_out, itn_out, anorm_out, acond_out, rnorm_out, arnorm_out, xnorm_out);
+  }
+}
+/*--------------------------------------------------------------------*/
 
 int mbnavadjust_invertnav() {
   if (mbna_verbose >= 2) {
@@ -9131,8 +9401,8 @@ fprintf(stderr, "\nGlobal ties Z %d:\n", nglobaltiez);
       //  fprintf(stderr," | b:%10.6f\n",u[i]);
       //  }
 
-      mblsqr_lsqr(nrows_ba, ncols_ba, &mb_aprod, damp, &matrix, u, v, w, x, se, atol, btol, conlim, itnlim, stderr,
-                  &istop_out, &itn_out, &anorm_out, &acond_out, &rnorm_out, &arnorm_out, &xnorm_out);
+      mbnavadjust_lsqr(&matrix, damp, u, v, w, x, se, atol, btol, conlim, itnlim, &istop_out, &itn_out, &anorm_out,
+                       &acond_out, &rnorm_out, &arnorm_out, &xnorm_out);
 
       /* save solution */
       double rms_solution = 0.0;
@@ -10494,8 +10764,8 @@ fprintf(stderr, "\nGlobal ties Z %d:\n", nglobaltiez);
       //  fprintf(stderr," | b:%10.6f\n",u[i]);
       //  }
 
-      mblsqr_lsqr(matrix.m, matrix.n, &mb_aprod, damp, &matrix, u, v, w, x, se, atol, btol, conlim, itnlim, stderr, &istop_out,
-                  &itn_out, &anorm_out, &acond_out, &rnorm_out, &arnorm_out, &xnorm_out);
+      mbnavadjust_lsqr(&matrix, damp, u, v, w, x, se, atol, btol, conlim, itnlim, &istop_out, &itn_out, &anorm_out,
+                       &acond_out, &rnorm_out, &arnorm_out, &xnorm_out);
 
       fprintf(stderr, "\nInversion by LSQR completed\n");
       fprintf(stderr, "\tReason for termination:       %d\n", istop_out);
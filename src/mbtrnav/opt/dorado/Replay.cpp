@@ -116,10 +116,6 @@ Replay::~Replay()
 {
 
     free(logdir);
-    if (trn_log)  delete(trn_log);
-    if (dvl_log)  delete(dvl_log);
-    if (nav_log)  delete(nav_log);
-    if (mbtrn_log)  delete(mbtrn_log);
     free(trn_attr->_mapFileName);
     free(trn_attr->_particlesName);
     free(trn_attr->_vehicleCfgName);
@@ -127,11 +123,12 @@ Replay::~Replay()
     free(trn_attr->_resonCfgName);
     free(trn_attr->_terrainNavServer);
     free(trn_attr->_lrauvDvlFilename);
-    fclose(dvl_csv);
+    if(NULL!=dvl_csv) fclose(dvl_csv);
     if(NULL!=trn_log) delete trn_log;
     if(NULL!=dvl_log) delete dvl_log;
     if(NULL!=nav_log) delete nav_log;
     if(NULL!=mbtrn_log) delete mbtrn_log;
+    if(NULL!=tnav_log) delete tnav_log;
 //    if (trn_attr) delete trn_attr;
     delete trn_attr;
 }
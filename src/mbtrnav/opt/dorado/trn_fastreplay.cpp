@@ -0,0 +1,433 @@
+/****************************************************************************/
+/* Summary  : Convert TRN mission logs to the columnar replay log format   */
+/*            and replay them through a native TerrainNav as fast as the   */
+/*            filters allow, reporting throughput and per-phase latency.   */
+/* Filename : trn_fastreplay.cpp                                            */
+/* Project  : MB-System / TRN                                               */
+/* Version  : 1.0                                                           */
+/* Created  : 10/16/2026                                                    */
+/****************************************************************************/
+/* Modification History:                                                    */
+/* Began with a copy of trn_pfbench                                         */
+/****************************************************************************/
+
+#include <unistd.h>
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Replay.h"
+#include "TNavReplayLog.h"
+#include "TRNUtils.h"
+#include "TerrainNav.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double, std::milli> Millis;
+
+// Gives access to the terrainAid.cfg settings of a mission
+class ConvertReplay : public Replay
+{
+public:
+  ConvertReplay(const char *logdir, const char *map)
+    : Replay(logdir, map, "native")
+  {
+  }
+
+  // The names as given in terrainAid.cfg; call before connectTRN(),
+  // which prefixes them with the TRN_MAPFILES and TRN_DATAFILES paths
+  void getConfig(TNavReplayConfig *cfg)
+  {
+    memset(cfg, 0, sizeof(*cfg));
+    if (trn_attr->_mapFileName)
+      strncpy(cfg->mapFile, trn_attr->_mapFileName, TNAV_REPLAY_NAME_LEN - 1);
+    if (trn_attr->_vehicleCfgName)
+      strncpy(cfg->vehicleCfgFile, trn_attr->_vehicleCfgName, TNAV_REPLAY_NAME_LEN - 1);
+    if (trn_attr->_particlesName)
+      strncpy(cfg->particlesFile, trn_attr->_particlesName, TNAV_REPLAY_NAME_LEN - 1);
+    cfg->mapType             = trn_attr->_map_type;
+    cfg->filterType          = trn_attr->_filter_type;
+    cfg->forceLowGradeFilter = trn_attr->_forceLowGradeFilter;
+    cfg->allowFilterReinits  = trn_attr->_allowFilterReinits;
+    cfg->modifiedWeighting   = trn_attr->_useModifiedWeighting;
+  }
+};
+
+// Per-phase latencies in ms
+struct PhaseTimes
+{
+  const char *name;
+  std::vector<double> ms;
+  explicit PhaseTimes(const char *n) : name(n) {}
+};
+
+static void printPhase(PhaseTimes& p)
+{
+  double mean = 0., total = 0., p50 = 0., p95 = 0., pmax = 0.;
+  std::vector<double>& v = p.ms;
+  if (!v.empty())
+  {
+    for (size_t i = 0; i < v.size(); i++) total += v[i];
+    mean = total / v.size();
+    std::sort(v.begin(), v.end());
+    p50 = v[v.size() / 2];
+    p95 = v[std::min(v.size() - 1, (size_t)(0.95 * v.size()))];
+    pmax = v.back();
+  }
+  printf("%-9s %8zu %10.4f %10.4f %10.4f %10.4f %10.3f\n",
+         p.name, v.size(), mean, p50, p95, pmax, total / 1000.);
+}
+
+// Prefix a configured file name with the directory in env (as
+// Replay::connectTRN does); returns NULL for an empty name
+static char *trnPath(const char *env, const char *name)
+{
+  if (!name[0]) return NULL;
+  const char *dir = getenv(env);
+  char buf[REPLAY_PATHNAME_LENGTH];
+  snprintf(buf, sizeof(buf), "%s/%s", dir ? dir : ".", name);
+  return strdup(buf);
+}
+
+static TerrainNav *connectTRN(const TNavReplayConfig& cfg, const char *map, const char *logfile)
+{
+  char *mapFile = trnPath("TRN_MAPFILES", map ? map : cfg.mapFile);
+  char *vehicleCfg = trnPath("TRN_DATAFILES", cfg.vehicleCfgFile);
+  char *particles = trnPath("TRN_DATAFILES", cfg.particlesFile);
+  char *logname = strdup(logfile);
+  char *dot = strrchr(logname, '.');
+  if (dot && dot != logname && !strchr(dot, '/')) *dot = '\0';
+
+  fprintf(stdout, "fastreplay - Using TerrainNav with map %s and config %s\n",
+          mapFile, vehicleCfg);
+
+  TerrainNav *tercom = 0;
+  try
+  {
+    tercom = new TerrainNav(mapFile, vehicleCfg, particles,
+                            cfg.filterType, cfg.mapType,
+                            TRNUtils::basename(logname));
+  }
+  catch (Exception e)
+  {
+    fprintf(stderr, "fastreplay - Failed TRN initialization. Check TRN error messages...\n");
+    tercom = 0;
+  }
+
+  if (tercom && !tercom->initialized())
+  {
+    fprintf(stderr, "fastreplay - TRN not initialized. Check TRN error messages...\n");
+    delete tercom;
+    tercom = 0;
+  }
+
+  if (tercom)
+  {
+    // Same settings as Replay::connectTRN
+    tercom->setInterpMeasAttitude(true);
+    if (cfg.forceLowGradeFilter)
+      tercom->useLowGradeFilter();
+    else
+      tercom->useHighGradeFilter();
+    tercom->setFilterReinit(cfg.allowFilterReinits);
+    tercom->setModifiedWeighting(cfg.modifiedWeighting);
+  }
+
+  free(mapFile);
+  free(vehicleCfg);
+  free(particles);
+  free(logname);
+  return tercom;
+}
+
+// Motion and measurement updates of one record set, in time order as the
+// other replay tools do them
+static void updateTRN(TerrainNav *tercom, poseT *pt, measT *mt,
+                      PhaseTimes& motion, PhaseTimes& meas)
+{
+  Clock::time_point t0;
+
+  if (pt->time <= mt->time)
+  {
+    t0 = Clock::now();
+    tercom->motionUpdate(pt);
+    motion.ms.push_back(Millis(Clock::now() - t0).count());
+  }
+
+  t0 = Clock::now();
+  tercom->measUpdate(mt, mt->dataType);
+  meas.ms.push_back(Millis(Clock::now() - t0).count());
+
+  if (pt->time > mt->time)
+  {
+    t0 = Clock::now();
+    tercom->motionUpdate(pt);
+    motion.ms.push_back(Millis(Clock::now() - t0).count());
+  }
+}
+
+static void quietTRN()
+{
+  for (int id = 0; id < TL_N_MODULES; id++)
+    tl_mconfig((TLModuleID)id, TL_NONE, TL_ALL);
+}
+
+static int convert(const char *logdir, const char *map, const char *outfile,
+                   bool estimates, long maxrecords)
+{
+  ConvertReplay *r = new ConvertReplay(logdir, map);
+  TNavReplayConfig cfg;
+  r->getConfig(&cfg);
+
+  TerrainNav *tercom = 0;
+  if (estimates)
+  {
+    tercom = r->connectTRN();
+    if (NULL == tercom || !tercom->initialized())
+    {
+      fprintf(stderr," TRN initialization failed.\n");
+      delete tercom;
+      delete r;
+      return 1;
+    }
+  }
+
+  TNavReplayLogWriter log;
+  if (!log.open(outfile, cfg))
+  {
+    delete tercom;
+    delete r;
+    return 1;
+  }
+
+  // measT releases its arrays when it goes out of scope
+  poseT pt, mmse;
+  measT mt;
+  mt.numMeas    = 4;
+  mt.ranges     = (double *)calloc(TRN_MAX_BEAMS, sizeof(double));
+  mt.crossTrack = (double *)calloc(TRN_MAX_BEAMS, sizeof(double));
+  mt.alongTrack = (double *)calloc(TRN_MAX_BEAMS, sizeof(double));
+  mt.beamNums   = (int *)calloc(TRN_MAX_BEAMS, sizeof(int));
+  mt.altitudes  = (double *)calloc(TRN_MAX_BEAMS, sizeof(double));
+  mt.alphas     = (double *)calloc(TRN_MAX_BEAMS, sizeof(double));
+  mt.measStatus = (bool *)calloc(TRN_MAX_BEAMS, sizeof(bool));
+
+  PhaseTimes motion("motion"), meas("meas");
+  long nest = 0;
+  bool ok = true;
+  int s;
+  while (ok && (s = r->getNextRecordSet(&pt, &mt)) != 0
+         && (maxrecords <= 0 || log.numRecords() < maxrecords))
+  {
+    if (s < 0) continue;
+
+    bool est = false;
+    if (tercom)
+    {
+      updateTRN(tercom, &pt, &mt, motion, meas);
+      if (tercom->lastMeasSuccessful())
+      {
+        tercom->estimatePose(&mmse, TRN_EST_MMSE);
+        est = true;
+        nest++;
+      }
+    }
+    ok = log.write(pt, mt, est ? &mmse : NULL);
+  }
+
+  long nrec = log.numRecords();
+  ok = log.close() && ok;
+  uint64_t size = log.fileSize();
+
+  printf("Wrote %ld records (%ld with estimates) to %s\n", nrec, nest, outfile);
+  if (nrec > 0)
+    printf("  %llu bytes, %.1f bytes/record\n", (unsigned long long)size, (double)size / nrec);
+
+  delete tercom;
+  delete r;
+  return ok ? 0 : 1;
+}
+
+static int replay(const char *infile, const char *map, double tstart, double tend,
+                  long maxrecords, double tolerance)
+{
+  TNavReplayLogReader log;
+  if (!log.open(infile))
+    return 1;
+
+  printf("Replay log : %s\n"
+         "  %ld records in %zu blocks, time %.3f to %.3f\n",
+         infile, log.numRecords(), log.numBlocks(), log.startTime(), log.endTime());
+
+  if (tstart > 0. && !log.seek(tstart))
+  {
+    fprintf(stderr," No records at or after time %.3f\n", tstart);
+    return 1;
+  }
+
+  TerrainNav *tercom = connectTRN(log.config(), map, infile);
+  if (NULL == tercom)
+    return 1;
+
+  poseT pt, mmse, ref;
+  measT mt;
+  PhaseTimes read("read"), motion("motion"), meas("meas"), estimate("estimate");
+  long nrec = 0, nbad = 0, nmeas = 0, ncompared = 0, nunmatched = 0;
+  double maxdiff = 0., sumsq = 0.;
+  bool hasRef = false;
+
+  Clock::time_point start = Clock::now();
+  while (maxrecords <= 0 || nrec < maxrecords)
+  {
+    Clock::time_point t0 = Clock::now();
+    int s = log.read(&pt, &mt, &ref, &hasRef);
+    read.ms.push_back(Millis(Clock::now() - t0).count());
+    if (s == 0) break;
+    if (s < 0)
+    {
+      nbad++;
+      continue;
+    }
+    if (tend > 0. && pt.time > tend) break;
+    nrec++;
+
+    updateTRN(tercom, &pt, &mt, motion, meas);
+
+    if (tercom->lastMeasSuccessful())
+    {
+      nmeas++;
+      t0 = Clock::now();
+      tercom->estimatePose(&mmse, TRN_EST_MMSE);
+      estimate.ms.push_back(Millis(Clock::now() - t0).count());
+
+      if (hasRef)
+      {
+        double d = sqrt((mmse.x - ref.x)*(mmse.x - ref.x) + (mmse.y - ref.y)*(mmse.y - ref.y));
+        maxdiff = std::max(maxdiff, d);
+        sumsq += d*d;
+        ncompared++;
+      }
+      else
+        nunmatched++;
+    }
+    else if (hasRef)
+      nunmatched++;
+  }
+  double wall = Millis(Clock::now() - start).count() / 1000.;
+
+  printf("\n%ld records, %ld measurement updates, %.3f s, %.1f records/s\n",
+         nrec, nmeas, wall, wall > 0. ? nrec / wall : 0.);
+  if (nbad > 0)
+    printf("  %ld corrupt blocks skipped\n", nbad);
+
+  printf("\n%-9s %8s %10s %10s %10s %10s %10s\n",
+         "phase", "count", "mean_ms", "p50_ms", "p95_ms", "max_ms", "total_s");
+  printPhase(read);
+  printPhase(motion);
+  printPhase(meas);
+  printPhase(estimate);
+
+  int status = 0;
+  if (ncompared > 0 || nunmatched > 0)
+  {
+    printf("\nMMSE vs logged estimates: %ld compared, max %.3f m, rms %.3f m, "
+           "%ld updates without a match\n",
+           ncompared, maxdiff, ncompared > 0 ? sqrt(sumsq / ncompared) : 0., nunmatched);
+    if (tolerance >= 0. && (maxdiff > tolerance || nunmatched > 0))
+    {
+      printf("FAILED: differences exceed %.3f m\n", tolerance);
+      status = 2;
+    }
+  }
+  else if (tolerance >= 0.)
+  {
+    printf("\nThe log has no estimates to compare against\n");
+    status = 2;
+  }
+  printf("reinits: %d\n", tercom->getNumReinits());
+
+  delete tercom;
+  return status;
+}
+
+int main(int argc, char* argv[])
+{
+  char *map = 0, *logdir = 0, *infile = 0, *outfile = 0;
+  bool estimates = false, verbose = false;
+  double tstart = 0., tend = 0., tolerance = -1.;
+  long maxrecords = 0;
+  int c;
+
+  while ( (c = getopt(argc, argv, "d:ei:l:m:o:t:u:v")) != EOF )
+  {
+    if (c == 'l') {
+      free(logdir);
+      logdir = strdup(optarg);
+    }
+    else if (c == 'o') {
+      free(outfile);
+      outfile = strdup(optarg);
+    }
+    else if (c == 'i') {
+      free(infile);
+      infile = strdup(optarg);
+    }
+    else if (c == 'm') {
+      free(map);
+      map = strdup(optarg);
+    }
+    else if (c == 'e')
+      estimates = true;
+    else if (c == 't') {
+      tstart = atof(optarg);
+      const char *comma = strchr(optarg, ',');
+      if (comma) tend = atof(comma + 1);
+    }
+    else if (c == 'u')
+      maxrecords = atol(optarg);
+    else if (c == 'd')
+      tolerance = atof(optarg);
+    else if (c == 'v')
+      verbose = true;
+  }
+
+  if (!((logdir && outfile) || infile))
+  {
+    fprintf(stderr," No log specified.\n"
+                  "Usage:\n"
+                  "  trn-fastreplay -l dir -o file [-m map -e -u num -v]\n"
+                  "  trn-fastreplay -i file [-m map -t start[,end] -u num -d tol -v]\n"
+                  "    -l dir    Mission log directory to convert (any log trn-replay reads)\n"
+                  "    -o file   Replay log to write\n"
+                  "    -e        Run TRN while converting and log its MMSE estimates\n"
+                  "    -i file   Replay log to replay through a native TerrainNav\n"
+                  "    -m map    Alternate map name to override the logged map\n"
+                  "    -t s[,e]  Replay only record sets with pose times from s (to e)\n"
+                  "    -u num    Stop after num record sets\n"
+                  "    -d tol    Exit with status 2 if the MMSE estimates differ from the\n"
+                  "              logged ones by more than tol meters (build TRN with\n"
+                  "              TRN_NORAND for repeatable particle filter estimates)\n"
+                  "    -v        Keep TRN module logging (off by default)\n"
+                  "  TRN_MAPFILES and TRN_DATAFILES locate the map and configuration files.\n");
+    free(logdir);
+    free(outfile);
+    free(infile);
+    free(map);
+    return 1;
+  }
+
+  if (!verbose) quietTRN();
+
+  int status;
+  if (infile)
+    status = replay(infile, map, tstart, tend, maxrecords, tolerance);
+  else
+    status = convert(logdir, map, outfile, estimates, maxrecords);
+
+  free(logdir);
+  free(outfile);
+  free(infile);
+  free(map);
+  return status;
+}
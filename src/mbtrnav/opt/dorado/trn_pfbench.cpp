@@ -0,0 +1,203 @@
+/****************************************************************************/
+/* Summary  : Time particle filter measurement updates over a replayed     */
+/*            TRN mission log for a range of particle and thread counts.   */
+/* Filename : trn_pfbench.cpp                                               */
+/* Project  : MB-System / TRN                                               */
+/* Version  : 1.0                                                           */
+/* Created  : 10/16/2026                                                    */
+/****************************************************************************/
+/* Modification History:                                                    */
+/* Began with a copy of trn_replay                                          */
+/****************************************************************************/
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Replay.h"
+#include "TNavConfig.h"
+#include "TNavParticleFilter.h"
+#include "TerrainNav.h"
+
+// Parse a comma separated list of positive integers
+static std::vector<int> parseList(const char *arg)
+{
+  std::vector<int> values;
+  char *list = strdup(arg);
+  for (char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ","))
+  {
+    int v = atoi(tok);
+    if (v > 0) values.push_back(v);
+  }
+  free(list);
+  return values;
+}
+
+// Apply the benchmark settings to a (possibly newly created) filter
+static TNavParticleFilter *configureFilter(TerrainNav *tercom, int nparticles, int nthreads)
+{
+  TNavParticleFilter *pf = dynamic_cast<TNavParticleFilter*>(tercom->tNavFilter);
+  if (pf)
+  {
+    pf->setNumParticles(nparticles);
+    pf->setNumThreads(nthreads);
+  }
+  return pf;
+}
+
+int main(int argc, char* argv[])
+{
+  char *map = 0, *logdir = 0;
+  std::vector<int> particles, threads;
+  long maxupdates = 0;
+  int c;
+
+  particles.push_back(1000);
+  particles.push_back(2500);
+  particles.push_back(5000);
+  particles.push_back(MAX_PARTICLES);
+  threads.push_back(1);
+  threads.push_back(0);
+
+  while ( (c = getopt(argc, argv, "l:m:n:t:u:")) != EOF )
+  {
+    if (c == 'l') {
+      free(logdir);
+      logdir = strdup(optarg);
+    }
+    else if (c == 'm') {
+      free(map);
+      map = strdup(optarg);
+    }
+    else if (c == 'n')
+      particles = parseList(optarg);
+    else if (c == 't') {
+      // 0 is allowed here and selects one thread per core
+      threads.clear();
+      char *list = strdup(optarg);
+      for (char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ","))
+        threads.push_back(std::max(0, atoi(tok)));
+      free(list);
+    }
+    else if (c == 'u')
+      maxupdates = atol(optarg);
+  }
+
+  if (!logdir || particles.empty() || threads.empty())
+  {
+    fprintf(stderr," No log directory specified.\n"
+                  "Usage:\n  trn-pfbench -l dir [-m map -n n1,n2,... -t t1,t2,... -u num]\n"
+                  "    -l dir  The log directory of a particle filter mission to replay\n"
+                  "    -m map  Alternate map name to override the map specified in terrainAid.cfg\n"
+                  "    -n list Particle counts to time (default 1000,2500,5000,%d)\n"
+                  "    -t list Measurement update thread counts, 0 = one per core (default 1,0)\n"
+                  "    -u num  Stop each replay after num measurement updates\n",
+                  MAX_PARTICLES);
+    free(logdir);
+    free(map);
+    return 1;
+  }
+
+  tl_mconfig(TL_TNAV_PARTICLE_FILTER, TL_NC, TL_NC);
+  tl_mconfig(TL_TNAV_FILTER, TL_NC, TL_NC);
+
+  printf("%9s %8s %8s %10s %10s %10s %10s %8s\n",
+         "particles", "threads", "updates", "mean_ms", "p50_ms", "p95_ms", "max_ms", "reinits");
+
+  for (size_t ip = 0; ip < particles.size(); ip++)
+  {
+    for (size_t it = 0; it < threads.size(); it++)
+    {
+      // Always run TRN natively so that only the filter is timed
+      Replay *r = new Replay(logdir, map, "native");
+      TerrainNav *tercom = r->connectTRN();
+      if (NULL == tercom)
+      {
+        fprintf(stderr," TRN initialization failed.\n");
+        delete r;
+        free(logdir);
+        free(map);
+        return 1;
+      }
+
+      TNavFilter *current = tercom->tNavFilter;
+      TNavParticleFilter *pf = configureFilter(tercom, particles[ip], threads[it]);
+      if (NULL == pf)
+      {
+        fprintf(stderr," The mission in %s does not use the particle filter.\n", logdir);
+        delete tercom;
+        delete r;
+        free(logdir);
+        free(map);
+        return 1;
+      }
+      int nthreads = pf->getNumThreads();
+
+      // measT releases its arrays when it goes out of scope
+      poseT pt;
+      measT mt;
+      mt.numMeas    = 4;
+      mt.ranges     = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+      mt.crossTrack = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+      mt.alongTrack = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+      mt.beamNums   = (int *)malloc(TRN_MAX_BEAMS*sizeof(int));
+      mt.altitudes  = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+      mt.alphas     = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+      mt.measStatus = (bool *)malloc(TRN_MAX_BEAMS*sizeof(bool));
+
+      std::vector<double> latency;
+      int s;
+      while ((s = r->getNextRecordSet(&pt, &mt)) != 0
+             && (maxupdates <= 0 || (long)latency.size() < maxupdates))
+      {
+        if (s < 0) continue;
+
+        if (pt.time <= mt.time)
+          tercom->motionUpdate(&pt);
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        tercom->measUpdate(&mt, mt.dataType);
+        std::chrono::duration<double, std::milli> dt = std::chrono::steady_clock::now() - t0;
+
+        if (pt.time > mt.time)
+          tercom->motionUpdate(&pt);
+
+        // Only count updates that reached the filter
+        if (tercom->lastMeasSuccessful())
+          latency.push_back(dt.count());
+
+        // A reinit replaces the filter object
+        if (tercom->tNavFilter != current)
+        {
+          current = tercom->tNavFilter;
+          configureFilter(tercom, particles[ip], threads[it]);
+        }
+      }
+
+      double mean = 0., p50 = 0., p95 = 0., pmax = 0.;
+      if (!latency.empty())
+      {
+        for (size_t i = 0; i < latency.size(); i++) mean += latency[i];
+        mean /= latency.size();
+        std::sort(latency.begin(), latency.end());
+        p50 = latency[latency.size() / 2];
+        p95 = latency[std::min(latency.size() - 1, (size_t)(0.95 * latency.size()))];
+        pmax = latency.back();
+      }
+      printf("%9d %8d %8zu %10.3f %10.3f %10.3f %10.3f %8d\n",
+             particles[ip], nthreads, latency.size(), mean, p50, p95, pmax,
+             tercom->getNumReinits());
+      fflush(stdout);
+
+      delete tercom;
+      delete r;
+      TNavConfig::instance(true);
+    }
+  }
+
+  free(logdir);
+  free(map);
+  return 0;
+}
@@ -0,0 +1,256 @@
+/****************************************************************************/
+/* Summary  : Compare the direct and FFT correlation and motion blurring of */
+/*            the point mass filter over a replayed TRN mission log.       */
+/* Filename : trn_pmfbench.cpp                                              */
+/* Project  : MB-System / TRN                                               */
+/* Version  : 1.0                                                           */
+/* Created  : 10/16/2026                                                    */
+/****************************************************************************/
+/* Modification History:                                                    */
+/* Began with a copy of trn_pfbench                                         */
+/****************************************************************************/
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Replay.h"
+#include "TNavConfig.h"
+#include "TNavPointMassFilter.h"
+#include "TerrainNav.h"
+
+// Replays any mission through the point mass filter, whatever filter it
+// was logged with
+class PointMassReplay : public Replay
+{
+public:
+  PointMassReplay(const char *logdir, const char *map)
+    : Replay(logdir, map, "native")
+  {
+    trn_attr->_filter_type = 1;
+  }
+};
+
+// Parse a comma separated list of FFT modes
+static std::vector<int> parseModes(const char *arg)
+{
+  std::vector<int> values;
+  char *list = strdup(arg);
+  for (char *tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ","))
+  {
+    int v = atoi(tok);
+    if (v >= PMF_FFT_OFF && v <= PMF_FFT_ALWAYS) values.push_back(v);
+  }
+  free(list);
+  return values;
+}
+
+static const char *modeName(int mode)
+{
+  switch (mode)
+  {
+    case PMF_FFT_OFF:    return "direct";
+    case PMF_FFT_AUTO:   return "auto";
+    case PMF_FFT_ALWAYS: return "fft";
+  }
+  return "?";
+}
+
+// Apply the benchmark settings to a (possibly newly created) filter
+static TNavPointMassFilter *configureFilter(TerrainNav *tercom, int mode, int interp)
+{
+  TNavPointMassFilter *pmf = dynamic_cast<TNavPointMassFilter*>(tercom->tNavFilter);
+  if (pmf)
+  {
+    pmf->setFFTMode(mode);
+    if (interp >= 0) tercom->setMapInterpMethod(interp);
+  }
+  return pmf;
+}
+
+// mean, median, 95th percentile and maximum of v (sorts v)
+static void stats(std::vector<double>& v, double *mean, double *p50, double *p95, double *pmax)
+{
+  *mean = *p50 = *p95 = *pmax = 0.;
+  if (v.empty()) return;
+  for (size_t i = 0; i < v.size(); i++) *mean += v[i];
+  *mean /= v.size();
+  std::sort(v.begin(), v.end());
+  *p50 = v[v.size() / 2];
+  *p95 = v[std::min(v.size() - 1, (size_t)(0.95 * v.size()))];
+  *pmax = v.back();
+}
+
+int main(int argc, char* argv[])
+{
+  char *map = 0, *logdir = 0;
+  std::vector<int> modes;
+  int interp = 0;
+  long maxupdates = 0;
+  int c;
+
+  modes.push_back(PMF_FFT_OFF);
+  modes.push_back(PMF_FFT_AUTO);
+
+  while ( (c = getopt(argc, argv, "f:i:l:m:u:")) != EOF )
+  {
+    if (c == 'l') {
+      free(logdir);
+      logdir = strdup(optarg);
+    }
+    else if (c == 'm') {
+      free(map);
+      map = strdup(optarg);
+    }
+    else if (c == 'f')
+      modes = parseModes(optarg);
+    else if (c == 'i')
+      interp = atoi(optarg);
+    else if (c == 'u')
+      maxupdates = atol(optarg);
+  }
+
+  if (!logdir || modes.empty())
+  {
+    fprintf(stderr," No log directory specified.\n"
+                  "Usage:\n  trn-pmfbench -l dir [-m map -f m1,m2,... -i method -u num]\n"
+                  "    -l dir    The log directory of a mission to replay through the point mass filter\n"
+                  "    -m map    Alternate map name to override the map specified in terrainAid.cfg\n"
+                  "    -f list   FFT modes to time: %d direct, %d auto, %d always (default %d,%d)\n"
+                  "    -i method Map interpolation method; the FFT correlation needs 0, nearest\n"
+                  "              neighbor (default 0, -1 keeps the TRN setting)\n"
+                  "    -u num    Stop each replay after num measurement updates\n"
+                  "  The first mode is the reference for the MMSE differences.\n"
+                  "  Motion blurring is only timed when TRN is built with MOTION_BLUR_METHOD 1.\n",
+                  PMF_FFT_OFF, PMF_FFT_AUTO, PMF_FFT_ALWAYS, PMF_FFT_OFF, PMF_FFT_AUTO);
+    free(logdir);
+    free(map);
+    return 1;
+  }
+
+  tl_mconfig(TL_TNAV_POINT_MASS_FILTER, TL_NC, TL_NC);
+  tl_mconfig(TL_TNAV_FILTER, TL_NC, TL_NC);
+
+  printf("%-7s %8s %10s %10s %10s %10s %10s %12s %8s\n",
+         "mode", "updates", "mean_ms", "p50_ms", "p95_ms", "max_ms", "motion_ms",
+         "mmse_diff_m", "reinits");
+
+  // MMSE north and east after each update of the reference run
+  std::vector<double> refN, refE;
+
+  for (size_t im = 0; im < modes.size(); im++)
+  {
+    // Always run TRN natively so that only the filter is timed
+    Replay *r = new PointMassReplay(logdir, map);
+    TerrainNav *tercom = r->connectTRN();
+    if (NULL == tercom)
+    {
+      fprintf(stderr," TRN initialization failed.\n");
+      delete r;
+      free(logdir);
+      free(map);
+      return 1;
+    }
+
+    TNavFilter *current = tercom->tNavFilter;
+    if (NULL == configureFilter(tercom, modes[im], interp))
+    {
+      fprintf(stderr," TRN did not create a point mass filter.\n");
+      delete tercom;
+      delete r;
+      free(logdir);
+      free(map);
+      return 1;
+    }
+
+    // measT releases its arrays when it goes out of scope
+    poseT pt, mmse;
+    measT mt;
+    mt.numMeas    = 4;
+    mt.ranges     = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+    mt.crossTrack = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+    mt.alongTrack = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+    mt.beamNums   = (int *)malloc(TRN_MAX_BEAMS*sizeof(int));
+    mt.altitudes  = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+    mt.alphas     = (double *)malloc(TRN_MAX_BEAMS*sizeof(double));
+    mt.measStatus = (bool *)malloc(TRN_MAX_BEAMS*sizeof(bool));
+
+    std::vector<double> latency, motion;
+    double maxdiff = 0.;
+    size_t nupdates = 0;
+    int s;
+    while ((s = r->getNextRecordSet(&pt, &mt)) != 0
+           && (maxupdates <= 0 || (long)latency.size() < maxupdates))
+    {
+      if (s < 0) continue;
+
+      std::chrono::steady_clock::time_point t0;
+      std::chrono::duration<double, std::milli> dt;
+
+      if (pt.time <= mt.time)
+      {
+        t0 = std::chrono::steady_clock::now();
+        tercom->motionUpdate(&pt);
+        dt = std::chrono::steady_clock::now() - t0;
+        motion.push_back(dt.count());
+      }
+
+      t0 = std::chrono::steady_clock::now();
+      tercom->measUpdate(&mt, mt.dataType);
+      dt = std::chrono::steady_clock::now() - t0;
+
+      if (pt.time > mt.time)
+      {
+        t0 = std::chrono::steady_clock::now();
+        tercom->motionUpdate(&pt);
+        std::chrono::duration<double, std::milli> dm = std::chrono::steady_clock::now() - t0;
+        motion.push_back(dm.count());
+      }
+
+      // Only count updates that reached the filter
+      if (tercom->lastMeasSuccessful())
+      {
+        latency.push_back(dt.count());
+
+        tercom->estimatePose(&mmse, TRN_EST_MMSE);
+        if (im == 0)
+        {
+          refN.push_back(mmse.x);
+          refE.push_back(mmse.y);
+        }
+        else if (nupdates < refN.size())
+        {
+          maxdiff = std::max(maxdiff, std::max(fabs(mmse.x - refN[nupdates]),
+                                               fabs(mmse.y - refE[nupdates])));
+        }
+        nupdates++;
+      }
+
+      // A reinit replaces the filter object
+      if (tercom->tNavFilter != current)
+      {
+        current = tercom->tNavFilter;
+        configureFilter(tercom, modes[im], interp);
+      }
+    }
+
+    double mean, p50, p95, pmax, mmean, m50, m95, mmax;
+    size_t nmeas = latency.size();
+    stats(latency, &mean, &p50, &p95, &pmax);
+    stats(motion, &mmean, &m50, &m95, &mmax);
+    printf("%-7s %8zu %10.3f %10.3f %10.3f %10.3f %10.3f %12.3g %8d\n",
+           modeName(modes[im]), nmeas, mean, p50, p95, pmax, mmean,
+           (im == 0 ? 0. : maxdiff), tercom->getNumReinits());
+    fflush(stdout);
+
+    delete tercom;
+    delete r;
+    TNavConfig::instance(true);
+  }
+
+  free(logdir);
+  free(map);
+  return 0;
+}
@@ -0,0 +1,845 @@
+#include "LinearOctree.hpp"
+
+#include "OctreeSupport.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+/* LinearOctree Class
+Read-only, index based octree.  See LinearOctree.hpp for the layout and file format.
+The measurement functions match those of Octree (Octree.cpp), and return the same
+results for a LinearOctree converted from an Octree file.
+*/
+
+// Meausrement functions
+
+/* RayTrace:
+Trace from the startPoint along the directionVector until a non EmptyValue node is hit.
+If the ray misses all nonempty nodes, '-1' will be returned.  The stepping is the same as
+Octree::RayTrace: move from the entry point of the current leaf to its exit side, then
+step the path one leaf across that side.
+*/
+template <class ValueType>
+double
+LinearOctree<ValueType>::
+RayTrace(const Vector& startPoint, const Vector& directionVector) const {
+	LeafCursor cursor;
+	cursor.depth = -1;
+	return RayTrace(cursor, startPoint, directionVector);
+}
+
+/* Batch RayTrace:
+distances[k] is RayTrace(startPoints[k], directionVectors[k]).  The rays are traced in
+RayOrderKey order through one LeafCursor, so that each leaf lookup reuses the part of
+the tree walked by the previous one.
+*/
+template <class ValueType>
+void
+LinearOctree<ValueType>::
+RayTrace(int numRays, const Vector* startPoints, const Vector* directionVectors, double* distances) const {
+	if(numRays <= 0) {
+		return;
+	}
+
+	std::vector<std::pair<uint64_t, int> > order(numRays);
+	for(int k = 0; k < numRays; k++) {
+		order[k].first = RayOrderKey(startPoints[k], directionVectors[k]);
+		order[k].second = k;
+	}
+	std::sort(order.begin(), order.end());
+
+	LeafCursor cursor;
+	cursor.depth = -1;
+	for(int i = 0; i < numRays; i++) {
+		const int k = order[i].second;
+		distances[k] = RayTrace(cursor, startPoints[k], directionVectors[k]);
+	}
+}
+
+/* RayTrace using (and updating) the ancestors of the last leaf found through cursor
+*/
+template <class ValueType>
+double
+LinearOctree<ValueType>::
+RayTrace(LeafCursor& cursor, const Vector& startPoint, const Vector& directionVector) const {
+	Vector transitionPoint;
+	Vector deltaToTransitionPoint;
+	Vector deltaToCorner;
+	Vector nodeLowerBounds;
+	Vector nodeUpperBounds;
+	double distance;
+	double Xratio, Yratio, Zratio;
+	const LinearNode* node;
+	Path path;
+	int depth;
+
+	if(NULL == Nodes) {
+		return -1.0;
+	}
+
+	//get to the octree
+	if(ContainsPoint(startPoint)) {
+		transitionPoint = startPoint;
+		distance = 0.0;
+	} else {
+		distance = RayTraceToThisOctree(transitionPoint, startPoint, directionVector);
+		if(-1.0 == distance) {
+			//we missed entirely
+			return distance;
+		}
+	}
+
+	// the corner of each leaf which separates the three sides we might exit
+	// depends only on the direction
+	const bool upperX = (directionVector.x >= 0);
+	const bool upperY = (directionVector.y >= 0);
+	const bool upperZ = (directionVector.z >= 0);
+
+	path = FindPathToPoint(transitionPoint);
+	node = GetLeafOnPath(cursor, depth, path.x, path.y, path.z);
+
+	while(node->value == EmptyValue) {
+		CalculateBoundsFromPath(nodeLowerBounds, nodeUpperBounds, path, depth);
+		deltaToCorner.SetValues(
+			(upperX ? nodeUpperBounds.x : nodeLowerBounds.x) - transitionPoint.x,
+			(upperY ? nodeUpperBounds.y : nodeLowerBounds.y) - transitionPoint.y,
+			(upperZ ? nodeUpperBounds.z : nodeLowerBounds.z) - transitionPoint.z);
+
+		//eliminate any directions in which the direction vector is 0
+		Xratio = (directionVector.x == 0.0) ? -1.0 : deltaToCorner.x / directionVector.x;
+		Yratio = (directionVector.y == 0.0) ? -1.0 : deltaToCorner.y / directionVector.y;
+		Zratio = (directionVector.z == 0.0) ? -1.0 : deltaToCorner.z / directionVector.z;
+
+		switch(Octree_PickMinPositiveRatio(Xratio, Yratio, Zratio)) {
+			case 1://X
+				deltaToTransitionPoint.SetValues(
+					deltaToCorner.x,
+					deltaToCorner.x * directionVector.y / directionVector.x,
+					deltaToCorner.x * directionVector.z / directionVector.x);
+				transitionPoint = transitionPoint + deltaToTransitionPoint;
+				path = FindPathToPointFromNode(transitionPoint, path, depth);
+				path.x += (upperX << 1) - 1;
+				if(! PathElementIsValid(path.x)) {
+					return -1.0;
+				}
+				break;
+			case 2://Y
+				deltaToTransitionPoint.SetValues(
+					deltaToCorner.y * directionVector.x / directionVector.y,
+					deltaToCorner.y,
+					deltaToCorner.y * directionVector.z / directionVector.y);
+				transitionPoint = transitionPoint + deltaToTransitionPoint;
+				path = FindPathToPointFromNode(transitionPoint, path, depth);
+				path.y += (upperY << 1) - 1;
+				if(! PathElementIsValid(path.y)) {
+					return -1.0;
+				}
+				break;
+			case 3://Z
+				deltaToTransitionPoint.SetValues(
+					deltaToCorner.z * directionVector.x / directionVector.z,
+					deltaToCorner.z * directionVector.y / directionVector.z,
+					deltaToCorner.z);
+				transitionPoint = transitionPoint + deltaToTransitionPoint;
+				path = FindPathToPointFromNode(transitionPoint, path, depth);
+				path.z += (upperZ << 1) - 1;
+				if(! PathElementIsValid(path.z)) {
+					return -1.0;
+				}
+				break;
+			default:
+				//zero direction vector
+				return -1.0;
+		}
+
+		distance += deltaToTransitionPoint.Norm();
+		node = GetLeafOnPath(cursor, depth, path.x, path.y, path.z);
+	}
+	return distance;
+}
+
+/* Query:
+Return the value stored in the leaf containing the queryPoint, or OffMapValue if the
+point is outside the octree.
+*/
+template <class ValueType>
+ValueType
+LinearOctree<ValueType>::
+Query(const Vector& queryPoint) const {
+	if(NULL != Nodes && ContainsPoint(queryPoint)) {
+		int depth;
+		Path path = FindPathToPoint(queryPoint);
+		return GetLeafOnPath(depth, path.x, path.y, path.z)->value;
+	}
+	return OffMapValue;
+}
+
+/* Interpolating Query:
+Linear interpolation between the 8 leaves around the query point, as Octree::InterpolatingQuery.
+Neighbors which lie off the map contribute OffMapValue.
+*/
+template <class ValueType>
+double
+LinearOctree<ValueType>::
+InterpolatingQuery(const Vector& queryPoint) const {
+	if(NULL == Nodes || !ContainsPoint(queryPoint)) {
+		return static_cast<double>(OffMapValue);
+	}
+
+	Path path;
+	Vector percentageTowardThisNodeCenter;
+	int adjacentPathDirection[3];
+	double interpolatedValue = 0.0;
+	int depth;
+
+	//get an extra bit of precision on the path to find which corner of the leaf we are in
+	path.x = static_cast<unsigned int>(2.0 * (queryPoint.x - LowerBounds.x) / TrueResolution.x);
+	path.y = static_cast<unsigned int>(2.0 * (queryPoint.y - LowerBounds.y) / TrueResolution.y);
+	path.z = static_cast<unsigned int>(2.0 * (queryPoint.z - LowerBounds.z) / TrueResolution.z);
+
+	adjacentPathDirection[0] = ((path.x & 1) << 1) - 1;
+	adjacentPathDirection[1] = ((path.y & 1) << 1) - 1;
+	adjacentPathDirection[2] = ((path.z & 1) << 1) - 1;
+
+	path.x >>= 1;
+	path.y >>= 1;
+	path.z >>= 1;
+
+	percentageTowardThisNodeCenter.SetValues(
+		1 - std::abs(((queryPoint.x - LowerBounds.x) / TrueResolution.x) - path.x - 0.5),
+		1 - std::abs(((queryPoint.y - LowerBounds.y) / TrueResolution.y) - path.y - 0.5),
+		1 - std::abs(((queryPoint.z - LowerBounds.z) / TrueResolution.z) - path.z - 0.5));
+
+	/* index bits select this leaf (0) or the adjacent leaf (1) on each axis,
+	in the same x, y, z bit order as child numbers
+	*/
+	for(int index = 0; index < 8; index++) {
+		const bool adjacentX = (0 != (index & 4));
+		const bool adjacentY = (0 != (index & 2));
+		const bool adjacentZ = (0 != (index & 1));
+		const unsigned int Xpath = path.x + (adjacentX ? adjacentPathDirection[0] : 0);
+		const unsigned int Ypath = path.y + (adjacentY ? adjacentPathDirection[1] : 0);
+		const unsigned int Zpath = path.z + (adjacentZ ? adjacentPathDirection[2] : 0);
+		const double weight =
+			(adjacentX ? 1 - percentageTowardThisNodeCenter.x : percentageTowardThisNodeCenter.x) *
+			(adjacentY ? 1 - percentageTowardThisNodeCenter.y : percentageTowardThisNodeCenter.y) *
+			(adjacentZ ? 1 - percentageTowardThisNodeCenter.z : percentageTowardThisNodeCenter.z);
+
+		if(PathElementIsValid(Xpath) && PathElementIsValid(Ypath) && PathElementIsValid(Zpath)) {
+			interpolatedValue += weight * static_cast<double>(GetLeafOnPath(depth, Xpath, Ypath, Zpath)->value);
+		} else {
+			interpolatedValue += weight * static_cast<double>(OffMapValue);
+		}
+	}
+	return interpolatedValue;
+}
+
+// Constructors and such
+template <class ValueType>
+LinearOctree<ValueType>::
+LinearOctree()
+:
+LowerBounds(Vector()),
+UpperBounds(Vector()),
+Size(Vector()),
+TrueResolution(Vector()),
+MaxDepth(0),
+OffMapValue(static_cast<ValueType>(0)),
+EmptyValue(static_cast<ValueType>(0)),
+OctreeNodeType(OctreeType::BinaryOccupancy),
+Nodes(NULL),
+NumNodes(0),
+NodeStore(),
+MapBase(NULL),
+MapLength(0)
+{}
+
+template <class ValueType>
+LinearOctree<ValueType>::
+~LinearOctree() {
+	Clear();
+}
+
+// release the node array (unmap or free)
+template <class ValueType>
+void
+LinearOctree<ValueType>::
+Clear(void) {
+	if(NULL != MapBase) {
+		munmap(MapBase, MapLength);
+		MapBase = NULL;
+		MapLength = 0;
+	}
+	std::vector<LinearNode>().swap(NodeStore);
+	Nodes = NULL;
+	NumNodes = 0;
+}
+
+// copy the octree properties from a file header
+template <class ValueType>
+void
+LinearOctree<ValueType>::
+SetProperties(const LinearHeader& header) {
+	LowerBounds.SetValues(header.LowerBounds[0], header.LowerBounds[1], header.LowerBounds[2]);
+	UpperBounds.SetValues(header.UpperBounds[0], header.UpperBounds[1], header.UpperBounds[2]);
+	Size.SetValues(header.Size[0], header.Size[1], header.Size[2]);
+	TrueResolution.SetValues(header.TrueResolution[0], header.TrueResolution[1], header.TrueResolution[2]);
+	MaxDepth = header.MaxDepth;
+	for(int depth = 0; depth <= MaxDepth; depth++) {
+		NodeSizes[depth] = Size;
+		NodeSizes[depth] /= (static_cast<double>(1 << depth));
+	}
+	OffMapValue = header.OffMapValue;
+	EmptyValue = header.EmptyValue;
+	OctreeNodeType = static_cast<OctreeType::EnumOctreeType>(header.OctreeNodeType);
+}
+
+// Save, Load, and Print
+/* Load function:
+Map a linear octree file written by SaveToFile into memory.  The nodes are used
+in place; if the file can not be mapped, it is read into memory instead.
+*/
+template <class ValueType>
+bool
+LinearOctree<ValueType>::
+LoadFromFile(const char* filename) {
+	LinearHeader header;
+	struct stat fileStat;
+
+	Clear();
+
+	int fd = open(filename, O_RDONLY);
+	if(fd < 0) {
+		std::cout << "LinearOctree::LoadFromFile - Unable to open: " << filename << std::endl;
+		return false;
+	}
+
+	//check the header before trusting anything else in the file
+	if(fstat(fd, &fileStat) != 0
+			|| read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)
+			|| strncmp(header.Magic, LINEAR_OCTREE_MAGIC, sizeof(header.Magic)) != 0
+			|| header.Version != LINEAR_OCTREE_VERSION
+			|| header.ValueSize != sizeof(ValueType)
+			|| header.NodeSize != sizeof(LinearNode)
+			|| header.NodeOffset < sizeof(LinearHeader)
+			|| header.NumNodes < 1
+			|| header.MaxDepth < 0 || header.MaxDepth > 31
+			|| (uint64_t)fileStat.st_size < header.NodeOffset + header.NumNodes * header.NodeSize) {
+		std::cout << "LinearOctree::LoadFromFile - " << filename << " is not a valid linear octree file" << std::endl;
+		close(fd);
+		return false;
+	}
+	SetProperties(header);
+	NumNodes = header.NumNodes;
+
+	MapLength = header.NodeOffset + NumNodes * sizeof(LinearNode);
+	MapBase = mmap(NULL, MapLength, PROT_READ, MAP_SHARED, fd, 0);
+	if(MAP_FAILED == MapBase) {
+		//fall back to reading the node array
+		MapBase = NULL;
+		MapLength = 0;
+		NodeStore.resize(NumNodes);
+		if(lseek(fd, header.NodeOffset, SEEK_SET) != (off_t)header.NodeOffset
+				|| read(fd, &NodeStore[0], NumNodes * sizeof(LinearNode)) != (ssize_t)(NumNodes * sizeof(LinearNode))) {
+			std::cout << "LinearOctree::LoadFromFile - read failed: " << filename << std::endl;
+			Clear();
+			close(fd);
+			return false;
+		}
+		Nodes = &NodeStore[0];
+	} else {
+		Nodes = reinterpret_cast<const LinearNode*>(static_cast<const char*>(MapBase) + header.NodeOffset);
+	}
+	close(fd);
+
+	std::cout << "\nLinear octree file <" << filename << "> " << (IsMapped() ? "mapped" : "loaded") << "\n";
+	std::cout << "Num Nodes: " << NumNodes << "\tNode Size: " << (NumNodes * sizeof(LinearNode)) / 1048576 << " MB \n";
+	return true;
+}
+
+/* Load Octree file:
+Read an Octree file (.bo) written by Octree::SaveToFile directly into the linear
+layout, without building the pointer tree.
+*/
+template <class ValueType>
+bool
+LinearOctree<ValueType>::
+LoadFromOctreeFile(const char* filename) {
+	LinearHeader header;
+	int32_t octreeNodeType;
+
+	Clear();
+	memset(&header, 0, sizeof(header));
+
+	std::FILE* loadFile = std::fopen(filename, "rb");
+	if(loadFile == NULL) {
+		std::cout << "LinearOctree::LoadFromOctreeFile - Unable to open: " << filename << std::endl;
+		return false;
+	}
+
+	// matched to Octree::SaveToFile
+	bool ok = (std::fread(header.LowerBounds, sizeof(double), 3, loadFile) == 3)
+		&& (std::fread(header.UpperBounds, sizeof(double), 3, loadFile) == 3)
+		&& (std::fread(header.Size, sizeof(double), 3, loadFile) == 3)
+		&& (std::fread(header.TrueResolution, sizeof(double), 3, loadFile) == 3)
+		&& (std::fread(&header.MaxDepth, sizeof(int), 1, loadFile) == 1)
+		&& (std::fread(&header.OffMapValue, sizeof(ValueType), 1, loadFile) == 1)
+		&& (std::fread(&header.EmptyValue, sizeof(ValueType), 1, loadFile) == 1)
+		&& (std::fread(&octreeNodeType, sizeof(OctreeType::EnumOctreeType), 1, loadFile) == 1)
+		&& (header.MaxDepth >= 0) && (header.MaxDepth <= 31);
+	header.OctreeNodeType = octreeNodeType;
+
+	if(ok) {
+		SetProperties(header);
+
+		// each node is a value and a hasChildren flag in the file,
+		// which bounds the number of nodes to expect
+		long treeStart = std::ftell(loadFile);
+		if(std::fseek(loadFile, 0, SEEK_END) == 0) {
+			long fileEnd = std::ftell(loadFile);
+			if(fileEnd > treeStart) {
+				NodeStore.reserve((fileEnd - treeStart) / (sizeof(ValueType) + sizeof(bool)));
+			}
+		}
+		std::fseek(loadFile, treeStart, SEEK_SET);
+
+		NodeStore.resize(1);
+		ok = ReadOctreeNode(loadFile, 0, 0);
+	}
+	std::fclose(loadFile);
+
+	if(!ok) {
+		std::cout << "LinearOctree::LoadFromOctreeFile - read failed: " << filename << std::endl;
+		Clear();
+		return false;
+	}
+	Nodes = &NodeStore[0];
+	NumNodes = NodeStore.size();
+	return true;
+}
+
+/* Octree file node reader (recursive, depth first):
+Reads the node at index, allocating a contiguous group of eight for its children.
+*/
+template <class ValueType>
+bool
+LinearOctree<ValueType>::
+ReadOctreeNode(std::FILE* loadFile, uint64_t index, int depth) {
+	ValueType value;
+	bool hasChildren;
+
+	if(std::fread(&value, sizeof(ValueType), 1, loadFile) != 1
+			|| std::fread(&hasChildren, sizeof(bool), 1, loadFile) != 1) {
+		return false;
+	}
+	NodeStore[index].value = value;
+	NodeStore[index].children = 0;
+
+	if(hasChildren) {
+		uint64_t firstChild = NodeStore.size();
+		if(depth >= MaxDepth || firstChild + 8 > UINT32_MAX) {
+			//corrupt file, or too many nodes to index
+			return false;
+		}
+		// NodeStore may move as it grows; always index it
+		NodeStore.resize(firstChild + 8);
+		NodeStore[index].children = static_cast<uint32_t>(firstChild);
+		for(int childNumber = 0; childNumber < 8; childNumber++) {
+			if(!ReadOctreeNode(loadFile, firstChild + childNumber, depth + 1)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* Save function:
+Writes the header and node array; see LinearOctree.hpp for the format.
+*/
+template <class ValueType>
+bool
+LinearOctree<ValueType>::
+SaveToFile(const char* filename) const {
+	LinearHeader header;
+	char padding[LINEAR_OCTREE_ALIGN];
+
+	if(NULL == Nodes) {
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memset(padding, 0, sizeof(padding));
+	strncpy(header.Magic, LINEAR_OCTREE_MAGIC, sizeof(header.Magic));
+	header.Version = LINEAR_OCTREE_VERSION;
+	header.ValueSize = sizeof(ValueType);
+	header.NodeSize = sizeof(LinearNode);
+	header.NodeOffset = ((sizeof(LinearHeader) + LINEAR_OCTREE_ALIGN - 1) / LINEAR_OCTREE_ALIGN) * LINEAR_OCTREE_ALIGN;
+	header.NumNodes = NumNodes;
+	header.LowerBounds[0] = LowerBounds.x;
+	header.LowerBounds[1] = LowerBounds.y;
+	header.LowerBounds[2] = LowerBounds.z;
+	header.UpperBounds[0] = UpperBounds.x;
+	header.UpperBounds[1] = UpperBounds.y;
+	header.UpperBounds[2] = UpperBounds.z;
+	header.Size[0] = Size.x;
+	header.Size[1] = Size.y;
+	header.Size[2] = Size.z;
+	header.TrueResolution[0] = TrueResolution.x;
+	header.TrueResolution[1] = TrueResolution.y;
+	header.TrueResolution[2] = TrueResolution.z;
+	header.MaxDepth = MaxDepth;
+	header.OctreeNodeType = OctreeNodeType;
+	header.OffMapValue = OffMapValue;
+	header.EmptyValue = EmptyValue;
+
+	std::FILE* saveFile = std::fopen(filename, "wb");
+	if(saveFile == NULL) {
+		std::cout << "Unable to open: " << filename << std::endl;
+		return false;
+	}
+	std::fwrite(&header, sizeof(header), 1, saveFile);
+	std::fwrite(padding, header.NodeOffset - sizeof(header), 1, saveFile);
+	std::fwrite(Nodes, sizeof(LinearNode), NumNodes, saveFile);
+
+	if(std::ferror(saveFile)) {
+		std::fclose(saveFile);
+		return false;
+	}
+	return (std::fclose(saveFile) == 0);
+}
+
+/* Converter:
+Octree file (.bo) to linear octree file.
+*/
+template <class ValueType>
+bool
+LinearOctree<ValueType>::
+ConvertFromOctreeFile(const char* octreeFile, const char* linearFile) {
+	LinearOctree<ValueType> linearOctree;
+	return linearOctree.LoadFromOctreeFile(octreeFile) && linearOctree.SaveToFile(linearFile);
+}
+
+/* File type test:
+True if the file starts with the linear octree magic.
+*/
+template <class ValueType>
+bool
+LinearOctree<ValueType>::
+IsLinearOctreeFile(const char* filename) {
+	char magic[8];
+	bool retval = false;
+	std::FILE* testFile = std::fopen(filename, "rb");
+	if(testFile != NULL) {
+		retval = (std::fread(magic, sizeof(magic), 1, testFile) == 1)
+			&& (strncmp(magic, LINEAR_OCTREE_MAGIC, sizeof(magic)) == 0);
+		std::fclose(testFile);
+	}
+	return retval;
+}
+
+// print properties (and node statistics, if ts is not NULL)
+template <class ValueType>
+void
+LinearOctree<ValueType>::
+Print(OTreeStats *ts) const {
+	std::cout << "LowerBounds:\t";
+	LowerBounds.Print();
+	std::cout << "UpperBounds:\t";
+	UpperBounds.Print();
+	std::cout << "MaxDepth:\t" << MaxDepth << std::endl;
+	std::cout << "Size:\t\t";
+	Size.Print();
+	std::cout << "TrueResolution:\t";
+	TrueResolution.Print();
+	std::cout << "OctreeType:\t" << OctreeNodeType << std::endl;
+	std::cout << "valueType sz:\t" << sizeof(ValueType) << std::endl;
+	std::cout << "nodes:\t\t" << NumNodes << (IsMapped() ? " (mapped)" : "") << std::endl;
+
+	if(NULL != ts && NULL != Nodes) {
+		memset(ts, 0, sizeof(OTreeStats));
+		ts->depth = MaxDepth;
+		ts->nodes = NumNodes;
+		for(uint64_t index = 0; index < NumNodes; index++) {
+			if(0 != Nodes[index].children) {
+				ts->branches++;
+			} else {
+				ts->leaves++;
+			}
+		}
+		int wkey=12;
+		int wval=30;
+		std::cout << std::setfill(' ');
+		std::cout << std::setw(wkey) << "branches :" << std::setw(wval) << ts->branches << std::endl;
+		std::cout << std::setw(wkey) << "leaves :" << std::setw(wval) << ts->leaves << std::endl;
+		std::cout << std::setw(wkey) << "RAM size :" << std::setw(wval) << NumNodes * sizeof(LinearNode) << std::endl;
+	}
+	std::cout << std::endl;
+}
+
+// Now for some private functions: paths and bounds (see Octree.cpp)
+
+template <class ValueType>
+Path
+LinearOctree<ValueType>::
+FindPathToPoint(const Vector& desiredPoint) const {
+	Path path;
+	const unsigned int maxPath = (1U << MaxDepth) - 1;
+
+	if(desiredPoint.x <= LowerBounds.x) {
+		path.x = 0;
+	} else if(desiredPoint.x >= UpperBounds.x) {
+		path.x = maxPath;
+	} else {
+		path.x = static_cast<unsigned int>((desiredPoint.x - LowerBounds.x) / TrueResolution.x);
+	}
+	if(desiredPoint.y <= LowerBounds.y) {
+		path.y = 0;
+	} else if(desiredPoint.y >= UpperBounds.y) {
+		path.y = maxPath;
+	} else {
+		path.y = static_cast<unsigned int>((desiredPoint.y - LowerBounds.y) / TrueResolution.y);
+	}
+	if(desiredPoint.z <= LowerBounds.z) {
+		path.z = 0;
+	} else if(desiredPoint.z >= UpperBounds.z) {
+		path.z = maxPath;
+	} else {
+		path.z = static_cast<unsigned int>((desiredPoint.z - LowerBounds.z) / TrueResolution.z);
+	}
+	return path;
+}
+
+/* Path to the leaf within the node on path at depth which is closest to desiredPoint
+*/
+template <class ValueType>
+Path
+LinearOctree<ValueType>::
+FindPathToPointFromNode(const Vector& desiredPoint, const Path& path, const int depth) const {
+	Path tempPath = FindPathToPoint(desiredPoint);
+	unsigned int lowerPathBitsHI = ((unsigned int)(1 << (MaxDepth - depth)) - 1);
+
+	if(tempPath.x < (path.x & ~lowerPathBitsHI)) {
+		tempPath.x = path.x & ~lowerPathBitsHI;
+	} else if(tempPath.x > (path.x | lowerPathBitsHI)) {
+		tempPath.x = path.x | lowerPathBitsHI;
+	}
+	if(tempPath.y < (path.y & ~lowerPathBitsHI)) {
+		tempPath.y = path.y & ~lowerPathBitsHI;
+	} else if(tempPath.y > (path.y | lowerPathBitsHI)) {
+		tempPath.y = path.y | lowerPathBitsHI;
+	}
+	if(tempPath.z < (path.z & ~lowerPathBitsHI)) {
+		tempPath.z = path.z & ~lowerPathBitsHI;
+	} else if(tempPath.z > (path.z | lowerPathBitsHI)) {
+		tempPath.z = path.z | lowerPathBitsHI;
+	}
+	return tempPath;
+}
+
+template <class ValueType>
+void
+LinearOctree<ValueType>::
+CalculateBoundsFromPath(Vector& nodeLowerBounds, Vector& nodeUpperBounds, const Path& path, const int depth) const {
+	const Vector& multiplier = NodeSizes[depth];
+	nodeLowerBounds.SetValues(
+		(static_cast<double>(path.x >>(MaxDepth - depth))) * multiplier.x,
+		(static_cast<double>(path.y >>(MaxDepth - depth))) * multiplier.y,
+		(static_cast<double>(path.z >>(MaxDepth - depth))) * multiplier.z);
+	nodeUpperBounds.SetValues(
+		(static_cast<double>((path.x >>(MaxDepth - depth)) + 1)) * multiplier.x,
+		(static_cast<double>((path.y >>(MaxDepth - depth)) + 1)) * multiplier.y,
+		(static_cast<double>((path.z >>(MaxDepth - depth)) + 1)) * multiplier.z);
+
+	nodeUpperBounds += LowerBounds;
+	nodeLowerBounds += LowerBounds;
+}
+
+/* Accessing nodes by their path:
+Returns the leaf located along the input path, and sets its depth.
+A child group which would lie outside the node array (corrupt file) ends the walk.
+*/
+template <class ValueType>
+const typename LinearOctree<ValueType>::LinearNode*
+LinearOctree<ValueType>::
+GetLeafOnPath(int& depth, const unsigned int Xpath, const unsigned int Ypath, const unsigned int Zpath) const {
+	const LinearNode* node = Nodes;
+	// a depth 0 tree is a single leaf; there are no path bits to test
+	unsigned int bitmask = (MaxDepth > 0) ? (1U << (MaxDepth - 1)) : 0U;
+
+	for(depth = 0; depth < MaxDepth; depth++) {
+		const uint64_t firstChild = node->children;
+		if(0 == firstChild || firstChild + 8 > NumNodes) {
+			return node;
+		}
+		int childNumber =
+			((0 != (Xpath & bitmask)) << 2)
+			| ((0 != (Ypath & bitmask)) << 1)
+			| (0 != (Zpath & bitmask));
+		bitmask >>= 1;
+		node = Nodes + firstChild + childNumber;
+	}
+	return node;
+}
+
+/* Accessing nodes by their path, through a cursor:
+The node at depth d on a path is selected by the top d bits of each path element, so the
+new path and the cursor's path share every node down to the depth of the highest bit in
+which they differ (and down to the cursor's leaf if they do not differ at all).  The walk
+starts from that node, and the cursor is updated to the new leaf.
+*/
+template <class ValueType>
+const typename LinearOctree<ValueType>::LinearNode*
+LinearOctree<ValueType>::
+GetLeafOnPath(LeafCursor& cursor, int& depth, const unsigned int Xpath, const unsigned int Ypath,
+			  const unsigned int Zpath) const {
+	int startDepth = 0;
+
+	if(cursor.depth < 0) {
+		cursor.nodes[0] = 0;
+	} else {
+		unsigned int diff = (Xpath ^ cursor.path.x) | (Ypath ^ cursor.path.y) | (Zpath ^ cursor.path.z);
+		startDepth = cursor.depth;
+		if(0 != diff) {
+			int highestBit = 0;
+			while(diff >>= 1) {
+				highestBit++;
+			}
+			if(MaxDepth - 1 - highestBit < startDepth) {
+				startDepth = MaxDepth - 1 - highestBit;
+			}
+		}
+	}
+
+	const LinearNode* node = Nodes + cursor.nodes[startDepth];
+	for(depth = startDepth; depth < MaxDepth; depth++) {
+		const uint64_t firstChild = node->children;
+		if(0 == firstChild || firstChild + 8 > NumNodes) {
+			break;
+		}
+		const unsigned int bitmask = 1U << (MaxDepth - 1 - depth);
+		int childNumber =
+			((0 != (Xpath & bitmask)) << 2)
+			| ((0 != (Ypath & bitmask)) << 1)
+			| (0 != (Zpath & bitmask));
+		node = Nodes + firstChild + childNumber;
+		cursor.nodes[depth + 1] = static_cast<uint32_t>(node - Nodes);
+	}
+
+	cursor.path.x = Xpath;
+	cursor.path.y = Ypath;
+	cursor.path.z = Zpath;
+	cursor.depth = depth;
+	return node;
+}
+
+/* Sort key for the batch RayTrace: the octant of the direction in the top 3 bits, then
+the Morton code of the top 20 bits of the start point's path.  Start points outside the
+octree all get the same Morton code.
+*/
+template <class ValueType>
+uint64_t
+LinearOctree<ValueType>::
+RayOrderKey(const Vector& startPoint, const Vector& directionVector) const {
+	uint64_t key =
+		((uint64_t)(directionVector.x >= 0) << 2)
+		| ((uint64_t)(directionVector.y >= 0) << 1)
+		| (uint64_t)(directionVector.z >= 0);
+
+	Path path;
+	if(ContainsPoint(startPoint)) {
+		path = FindPathToPoint(startPoint);
+	}
+	const int shift = (MaxDepth > 20) ? MaxDepth - 20 : 0;
+	for(int bit = 19; bit >= 0; bit--) {
+		key = (key << 3)
+			| (((path.x >> shift) >> bit & 1) << 2)
+			| (((path.y >> shift) >> bit & 1) << 1)
+			| ((path.z >> shift) >> bit & 1);
+	}
+	return key;
+}
+
+/* RayTrace to this Octree (see Octree::RayTraceToThisOctree)
+*/
+template <class ValueType>
+double
+LinearOctree<ValueType>::
+RayTraceToThisOctree(Vector& transitionPoint, const Vector& startPoint, const Vector& directionVector) const {
+	Vector deltaToEntryPoint;
+	Vector deltaToCorner;
+	Vector relevantCorner(
+		(directionVector.x >= 0.0) ? LowerBounds.x : UpperBounds.x,
+		(directionVector.y >= 0.0) ? LowerBounds.y : UpperBounds.y,
+		(directionVector.z >= 0.0) ? LowerBounds.z : UpperBounds.z);
+	double Xratio, Yratio, Zratio;
+	int entranceSide;
+
+	deltaToCorner = relevantCorner - startPoint;
+	Xratio = (directionVector.x == 0) ? -1.0 : deltaToCorner.x / directionVector.x;
+	Yratio = (directionVector.y == 0) ? -1.0 : deltaToCorner.y / directionVector.y;
+	Zratio = (directionVector.z == 0) ? -1.0 : deltaToCorner.z / directionVector.z;
+
+	entranceSide = Octree_PickMaxRatio(Xratio, Yratio, Zratio);
+	if(Xratio < 0.0) {
+		//we missed completely
+		return -1.0;
+	}
+
+	switch(entranceSide) {
+		case 1://X
+			deltaToEntryPoint.SetValues(
+				deltaToCorner.x,
+				deltaToCorner.x * directionVector.y / directionVector.x,
+				deltaToCorner.x * directionVector.z / directionVector.x);
+			transitionPoint = startPoint + deltaToEntryPoint;
+			if((transitionPoint.y < LowerBounds.y)
+					|| (transitionPoint.y > UpperBounds.y)
+					|| (transitionPoint.z < LowerBounds.z)
+					|| (transitionPoint.z > UpperBounds.z)) {
+				return -1.0;
+			}
+			break;
+		case 2://Y
+			deltaToEntryPoint.SetValues(
+				deltaToCorner.y * directionVector.x / directionVector.y,
+				deltaToCorner.y,
+				deltaToCorner.y * directionVector.z / directionVector.y);
+			transitionPoint = startPoint + deltaToEntryPoint;
+			if((transitionPoint.x < LowerBounds.x)
+					|| (transitionPoint.x > UpperBounds.x)
+					|| (transitionPoint.z < LowerBounds.z)
+					|| (transitionPoint.z > UpperBounds.z)) {
+				return -1.0;
+			}
+			break;
+		case 3://Z
+			deltaToEntryPoint.SetValues(
+				deltaToCorner.z * directionVector.x / directionVector.z,
+				deltaToCorner.z * directionVector.y / directionVector.z,
+				deltaToCorner.z);
+			transitionPoint = startPoint + deltaToEntryPoint;
+			if((transitionPoint.x < LowerBounds.x)
+					|| (transitionPoint.x > UpperBounds.x)
+					|| (transitionPoint.y < LowerBounds.y)
+					|| (transitionPoint.y > UpperBounds.y)) {
+				return -1.0;
+			}
+			break;
+	}
+
+	//we hit the octree
+	return deltaToEntryPoint.Norm();
+}
+
+
+template class LinearOctree<bool>;
@@ -0,0 +1,177 @@
+#ifndef LinearOctree_H
+#define LinearOctree_H
+
+#include "OctreeSupport.hpp"
+#include "Octree.hpp"
+
+#include <stdint.h>
+#include <cstdio>
+#include <vector>
+
+/*! Overarching Goal of LinearOctree:
+LinearOctree is a read-only, pointerless representation of an Octree (see Octree.hpp for
+the description of octrees, Paths and OctreeTypes).  It is intended for maps that are built
+once (mbgrd2octree, grdOctreeMaker, ...) and then used many times by TRN, where the time
+to rebuild a pointer tree node by node at startup and the scattered memory accesses of
+RayTrace through heap-allocated nodes dominate.
+
+Octree files (.bo) written by Octree::SaveToFile are converted to linear octree files
+with ConvertFromOctreeFile (or the octree2linear utility).  Linear octree files are
+mapped directly into memory by LoadFromFile; nothing is parsed or allocated per node,
+so pages of the tree are only read from disk when a ray first passes through them.
+*/
+
+/*! Description of the linear layout:
+The nodes are stored in a single array of LinearNode.  The root is node 0.  The eight
+children of a branch node are stored as a contiguous group, in child number order
+(x, y, z path bits; i.e. Morton order), and the branch node stores the index of the
+first child.  A child index of 0 marks a leaf (the root is never a child).
+
+Groups of children are allocated in depth first order as the tree is converted, so each
+subtree occupies a contiguous range of the array and the array as a whole is in Morton
+(Z-curve) order of the octree volume: nodes which are close in space are close in memory.
+
+Finding the child of node n along a path is then
+	Nodes[Nodes[n].children + childNumber]
+with no pointer chasing and no per-node allocation.
+
+Leaf lookups made while tracing a ray start from the deepest ancestor the path shares with
+the previous lookup rather than from the root (see LeafCursor).  Successive steps of a ray
+share all but the last few levels of their path, and so do rays that start close together:
+the batch form of RayTrace traces its rays grouped by the octant of their direction and in
+Morton order of their start points, so most lookups only descend the bottom of the tree.
+*/
+
+/*! Description of the linear octree file:
+	LinearHeader (magic, version, sizes, and the same properties as Octree::MapHeader)
+	padding to LinearHeader::NodeOffset
+	NumNodes LinearNodes
+The file is written in host byte order; LoadFromFile rejects files whose magic, version,
+value size or node size do not match the reader.
+*/
+
+#define LINEAR_OCTREE_MAGIC "LOCTREE"
+#define LINEAR_OCTREE_VERSION 1
+// node array offset alignment (bytes)
+#define LINEAR_OCTREE_ALIGN 64
+
+template <class ValueType>
+class LinearOctree {
+	public:
+		struct LinearHeader_s{
+			char Magic[8];
+			uint32_t Version;
+			uint32_t ValueSize;
+			uint32_t NodeSize;
+			uint32_t NodeOffset;
+			uint64_t NumNodes;
+			double LowerBounds[3];
+			double UpperBounds[3];
+			double Size[3];
+			double TrueResolution[3];
+			int32_t MaxDepth;
+			int32_t OctreeNodeType;
+			ValueType OffMapValue;
+			ValueType EmptyValue;
+		};
+		typedef struct LinearHeader_s LinearHeader;
+
+		struct LinearNode_s{
+			uint32_t children;
+			ValueType value;
+		};
+		typedef struct LinearNode_s LinearNode;
+
+		//for making map measurements
+		double RayTrace(const Vector& startPoint, const Vector& directionVector) const;
+		void RayTrace(int numRays, const Vector* startPoints, const Vector* directionVectors,
+					  double* distances) const;
+		ValueType Query(const Vector& queryPoint) const;
+		double InterpolatingQuery(const Vector& queryPoint) const;
+
+		//constructors and such
+		LinearOctree();
+		~LinearOctree();
+
+		//save and load
+		bool LoadFromFile(const char* filename);
+		bool LoadFromOctreeFile(const char* filename);
+		bool SaveToFile(const char* filename) const;
+		static bool ConvertFromOctreeFile(const char* octreeFile, const char* linearFile);
+		static bool IsLinearOctreeFile(const char* filename);
+
+		//print
+		void Print(OTreeStats *ts=NULL) const;
+
+		//Get functions
+		Vector GetTrueResolution(void) const { return this->TrueResolution; }
+		Vector GetLowerBounds(void) const { return this->LowerBounds; }
+		Vector GetUpperBounds(void) const { return this->UpperBounds; }
+		uint64_t GetNumNodes(void) const { return this->NumNodes; }
+		bool IsMapped(void) const { return (this->MapBase != NULL); }
+
+	private: // helper functions
+		// Path functions
+		Path FindPathToPoint(const Vector& desiredPoint) const;
+		Path FindPathToPointFromNode(const Vector& desiredPoint, const Path& path, const int depth) const;
+		bool PathElementIsValid(const unsigned int pathElement) const {
+			return (pathElement < (1U << MaxDepth));
+		}
+
+		// Bounds and ContainsPoint
+		void CalculateBoundsFromPath(Vector& nodeLowerBounds, Vector& nodeUpperBounds, const Path& path, const int depth) const;
+		bool ContainsPoint(const Vector& point) const {
+			return point.StrictlyLessThan(UpperBounds) && point.StrictlyGreaterOrEqualTo(LowerBounds);
+		}
+
+		// accessing nodes by their path
+		const LinearNode* GetLeafOnPath(int& depth, const unsigned int Xpath, const unsigned int Ypath,
+										const unsigned int Zpath) const;
+
+		// the path and ancestors of the last leaf found through a LeafCursor, so that the
+		// next lookup only descends from the deepest node the two paths share
+		struct LeafCursor_s{
+			Path path;
+			int depth; // depth of the last leaf, -1 before the first lookup
+			uint32_t nodes[32]; // node index at each depth along path
+		};
+		typedef struct LeafCursor_s LeafCursor;
+		const LinearNode* GetLeafOnPath(LeafCursor& cursor, int& depth, const unsigned int Xpath,
+										const unsigned int Ypath, const unsigned int Zpath) const;
+
+		// RayTrace helpers
+		double RayTrace(LeafCursor& cursor, const Vector& startPoint, const Vector& directionVector) const;
+		uint64_t RayOrderKey(const Vector& startPoint, const Vector& directionVector) const;
+		double RayTraceToThisOctree(Vector& transitionPoint, const Vector& startPoint, const Vector& directionVector) const;
+
+		// load helpers
+		bool ReadOctreeNode(std::FILE* loadFile, uint64_t index, int depth);
+		void SetProperties(const LinearHeader& header);
+		void Clear(void);
+
+		// not copyable (may own a file mapping)
+		LinearOctree(const LinearOctree<ValueType>& octreeToCopy);
+		LinearOctree& operator=(const LinearOctree<ValueType>& rightHandSide);
+
+	private: // variables
+		Vector LowerBounds;
+		Vector UpperBounds;
+		Vector Size;
+		Vector TrueResolution;
+
+		int MaxDepth;
+		// Size / 2^depth, the size of a node at each depth
+		Vector NodeSizes[32];
+		ValueType OffMapValue;
+		ValueType EmptyValue;
+		OctreeType::EnumOctreeType OctreeNodeType;
+
+		// node array: points into MapBase when mapped, otherwise into NodeStore
+		const LinearNode* Nodes;
+		uint64_t NumNodes;
+		std::vector<LinearNode> NodeStore;
+		void* MapBase;
+		size_t MapLength;
+};
+
+#endif
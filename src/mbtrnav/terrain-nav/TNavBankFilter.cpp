@@ -9,6 +9,9 @@
  * -----------------------------------------------------------------------------
  ******************************************************************************/
 
+#include <stdarg.h>
+#include <sstream>
+
 #include "TNavConfig.h"
 #include "TNavBankFilter.h"
 #include "mapio.h"
@@ -27,6 +30,47 @@ operator[](int index){
     }
 }
 
+void
+TNavBankFilter::bfFilterUpdateT::
+reset(int nParticles){
+    ok = true;
+    messages.clear();
+    measWeights.resize(nParticles);
+    hasAlphas = false;
+    hasNIS = false;
+    subcloudNIS = 0;
+    hasMeasVariance = false;
+    measVariance = 0;
+    measWeightsText.clear();
+}
+
+void
+TNavBankFilter::bfFilterUpdateT::
+log(const char* format, ...){
+    char buf[TL_RING_BYTES];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    messages.push_back(buf);
+}
+
+void
+TNavBankFilter::bfFilterUpdateT::
+flushLog(){
+    for(size_t i = 0; i < messages.size(); i++){
+        //logs() ends stderr output with a newline unless the format has one
+        std::string& m = messages[i];
+        if(!m.empty() && m[m.size() - 1] == '\n'){
+            m.erase(m.size() - 1);
+            logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG), "%s\n", m.c_str());
+        }else{
+            logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG), "%s", m.c_str());
+        }
+    }
+    messages.clear();
+}
+
 //TNavBankFilter:: //Reload Map Issue
 //TNavBankFilter(char* mapName, char* vehicleSpecs, char* directory, const double* windowVar,
 //				   const int& mapType) : TNavFilter(mapName, vehicleSpecs, directory, windowVar, mapType) {
@@ -35,6 +79,7 @@ TNavBankFilter(TerrainMap* terrainMap, char* vehicleSpecs, char* directory, cons
                const int& mapType)
 : TNavFilter(terrainMap, vehicleSpecs, directory, windowVar, mapType), numFilters(0), bfLogs(NULL), logCount(0)
 {
+    this->filterPool = new TNavThreadPool(BF_FILTER_THREADS);
     initVariables();
     this->tempUseBeam = new bool[TRN_MAX_BEAMS];
     this->useBeam     = new bool[TRN_MAX_BEAMS];
@@ -56,6 +101,22 @@ TNavBankFilter::
     deleteLogs();
     delete [] tempUseBeam;
     delete [] useBeam;
+    delete filterPool;
+}
+
+void
+TNavBankFilter::
+setNumThreads(int nThreads) {
+    delete filterPool;
+    filterPool = new TNavThreadPool(nThreads);
+}
+
+void
+TNavBankFilter::
+sizeWeightArrays() {
+    for(int filterIndex = 0; filterIndex < MAX_NUM_FILTERS; filterIndex++){
+        this->weights[filterIndex].resize(filterIndex < this->numFilters ? this->nParticles : 0);
+    }
 }
 
 int
@@ -185,6 +246,7 @@ setModifiedWeighting(const int use)
 
     // allocate logs for filters (will delete any existing logs)
     allocateLogs();
+    sizeWeightArrays();
 }
 
 //********************************************************************************
@@ -246,7 +308,6 @@ measUpdate(measT& currMeas) {
     Matrix beamsIF(3, currMeas.numMeas);
     int beamIndices[currMeas.numMeas];  //beamsVF to currMeas index correspondence
     //	double sumSquaresWeights = 0;
-    double sumMeasWeights;
     //double effSampSize = 0.0;
     int nBeamsUsed=0;
     double attitude[3] = {lastNavPose->phi, lastNavPose->theta, lastNavPose->psi};
@@ -255,9 +316,7 @@ measUpdate(measT& currMeas) {
     bool successfulMeas = false;
 
     //double nisVal = 0.0;
-    double totalVar[currMeas.numMeas];
     double mapVar = 1;//map variance for adding into sensor variance
-    double modMapVar = 0.01;//map variance for calculating delta_rms and alpha
 
     // initialize beamIndices
     // some C versions may not permit array[n]={0} initialization
@@ -430,734 +489,793 @@ measUpdate(measT& currMeas) {
                      "Forcing Subcloud Comparison\n");
             }
 
+            //The filters of the bank only read the particles and the
+            //projected beams, so they are updated concurrently. Anything a
+            //filter produces besides its own state is kept in
+            //filterUpdates and applied here in filter order.
             for(int filterIndex = 0; filterIndex < this->numFilters; filterIndex++){
+                this->filterUpdates[filterIndex].reset(nParticles);
+            }
+            const int* beamIndicesP = beamIndices;
+            std::function<void(int, int, int)> updateFilters =
+                [&](int chunk, int begin, int end) {
+                    for(int filterIndex = begin; filterIndex < end; filterIndex++){
+                        this->filterUpdates[filterIndex].ok =
+                            measUpdateFilter(filterIndex, currMeas, beamsVF, beamsIF,
+                                             beamIndicesP, mapVar, nBeamsUsed, test_beams);
+                    }
+                };
+            if(USE_CONTOUR_MATCHING && !USE_RANGE_CORR) {
+                //contour matching moves the shared particles in depth, so
+                //the filters must see each other's updates
+                updateFilters(0, 0, this->numFilters);
+            } else {
+                filterPool->run(this->numFilters, 1, updateFilters);
+            }
 
-                bfLogs[filterIndex]->setUsedBeams(nBeamsUsed);
+            for(int filterIndex = 0; filterIndex < this->numFilters; filterIndex++){
+                bfFilterUpdateT& update = this->filterUpdates[filterIndex];
+                update.flushLog();
+                if(update.hasNIS) {
+                    this->SubcloudNIS = update.subcloudNIS;
+                }
+                if(update.hasAlphas) {
+                    for(int i = 0; i < beamsVF.Ncols(); i++) {
+                        currMeas.alphas[i] = update.alphas[i];
+                    }
+                }
+                if(!update.ok) {
+                    bfLogs[filterIndex]->write();
+                    return false;
+                }
+                nSoundings += beamsVF.Ncols();
+                if(update.hasMeasVariance) {
+                    measVariance = update.measVariance;
+                }
+                if(saveDirectory != NULL) {
+                    measWeightsFile << update.measWeightsText;
+                }
+                bfLogs[filterIndex]->write();
+            }
+            if(saveDirectory != NULL) {
+                measWeightsFile << endl;
+            }
 
-                sumMeasWeights = 0;
-                double sumWeights = 0;
-                //				sumSquaresWeights = 0;
+        }
 
-                bool conditionForUsingBeamInFilter[TRN_MAX_BEAMS];
-                for(int indexM = 0; indexM < beamsVF.Ncols(); indexM++){
-                    //Beam-Filter selection goes here
-                    //two stage selection:
-                    //- stage 1 is beam based; if doing area selection, filters use all beams
-                    //- stage 2 is area based; the filter selects the regions of the map to treat the expected measurements as if they were Nan
-
-
-                    //filterConfiguration sets numFilters
-                    //switch(configuration) sets conditionForUsingBeamInFilter
-                    //switch(configuration) sets AreaCheckFunction
-                    //- each AreaCheckFunction takes filterIndex and beamEndPoint and returns bool treatExpectedMeasurementAsNan
-                    //configuration sets bool reinitOnConvergence
-
-                    /* DVL
-                     #
-                     #                  x
-                     #                  ^
-                     #                  |
-                     #                1 | 3
-                     #                  |------> y
-                     #                4   2
-                     #                       */
-                    switch(this->filterConfiguration){
-                            //configurations:
-                            //1 filter only
-                        case 0:
-                            conditionForUsingBeamInFilter[indexM] = true;
-                            break;
-
-                            //2 beam detection L/R
-                        case 1:
-                            //dvl test is different from reson test
-                            if(currMeas.dataType == TRN_SENSOR_DVL){
-                                if(beamIndices[indexM] == 0 || beamIndices[indexM] == 4){
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
-                                }else{
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
-                                }
-                            }
-                            else if(currMeas.dataType == TRN_SENSOR_MB){
-                                if(beamIndices[indexM] < 6){
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
-                                }else{
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
-                                }
-                            }
-                            break;
-                            //3 beam detection L/M/R
-                        case 2:
-                            //dvl test is different from reson test
-                            if(currMeas.dataType == TRN_SENSOR_DVL){
-                                if((beamIndices[indexM] == 0) || (beamIndices[indexM] == 4)){
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
-                                }else{
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
-                                }
-                            }
-                            //3 filter only with
-                            else if(currMeas.dataType == TRN_SENSOR_MB){
-                                if(beamIndices[indexM] < 5){
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
-                                }else if(beamIndices[indexM] > 7){
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
-                                }else{
-                                    conditionForUsingBeamInFilter[indexM] = (filterIndex == 2);
-                                }
-                            }
-                            break;
-                            //all area based selections
-                        case 3:
-                        case 4:
-                        case 5:
-                            conditionForUsingBeamInFilter[indexM] = true;
-                            break;
-                        default:
-                            conditionForUsingBeamInFilter[indexM] = true;
-                            break;
-                            //group of tiles
-                            //- 3 filters
-                            //- 11 filters
-                            //
-                            //group of along track stripes
-                            //- 3 groups of 10m wide stripes
-                            //- 6 groups of half overlapping 10m wide stripes
-                            //
-                            //3 along track stripes L/M/R
-                            //across track reinit once converged -- init new filter every N meters
-                            //mix of across track reinit once converged and 3 along track
+    }
 
-                    }
-                }
+#ifdef USE_MATLAB
+    plotMapMatlab(mapForPloting.depths, mapForPloting.xpts,
+                  mapForPloting.ypts, "title('Sub-Map and Post-Resampling Particle Distribution');", "figure(1)");
+    mapPlotted = 1;
+    plotParticleDistMatlab(allParticles, "figure(1)");
+#endif
 
+    //if measurement successfully added, recheck estimator convergence
+    //if(successfulMeas)
+    //   checkConvergence();
 
 
-                for(int indexM = 0; indexM < beamsVF.Ncols(); indexM++){
-                    double K = this->depthBiasCov[filterIndex] / (this->depthBiasCov[filterIndex] + mapVar + currMeas.covariance[beamIndices[indexM]]);
-                    if(conditionForUsingBeamInFilter[indexM]){
-
-                        bool loggedNan = false;
-                        for(int indexP = 0; indexP < nParticles; indexP++){
-                            if(this->treatBeamAsNan(filterIndex, beamsIF.SubMatrix(1,3,indexM+1,indexM+1), allParticles[indexP])){
-                                continue;
-                            }
-                            double tmpx = (1-K) * this->depthBias[filterIndex][indexP] + K * allParticles[indexP].expectedMeasDiff[indexM];
-
-                            if(ISNIN(tmpx)){
-                                if(!loggedNan){
-                                    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                                         "Filter %i\tdeapthBias would have been set to Nan. indexP: %i\tindexM: %i\n", filterIndex, indexP, indexM);
-                                    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                                         "Old Depth Bias: %0.2f\tDepthBiasCov: %0.2f\tK: %0.3f\tExpectedMeasDiff: %0.2f\tcurrMeas.covariance: %0.2f\n",
-                                         this->depthBias[filterIndex][indexP], this->depthBiasCov[filterIndex], K, allParticles[indexP].expectedMeasDiff[indexM], currMeas.covariance[beamIndices[indexM]]);
-                                    loggedNan = true;
-                                }
-                            }else{
-                                this->depthBias[filterIndex][indexP] = tmpx;
-                            }
-
-                            if(ISNIN(this->depthBias[filterIndex][indexP])){
-                                this->depthBias[filterIndex][indexP] = 0.0;
-                                logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                                     "Filter %i\tdeapthBias set to zero to clear nan issue. indexP: %i\n", filterIndex, indexP);
-                            }
+    poseT biasPose;
+    for(int filterIndex = 0; filterIndex < this->numFilters; filterIndex++){
+        this->computeMMSE(&biasPose, filterIndex);
+        biasPose -= *lastNavPose;
 
-                        }
-                        this->depthBiasCov[filterIndex] = (1-K) * this->depthBiasCov[filterIndex];
-                    }
-                }
+        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
+             "Filter %i\tNorthBias: %0.1f\tEastBias: %0.1f\tDepthBias: %0.1f\tNorthVariance: %0.1f\tEastVariance: %0.1f\tDepthVariance: %0.1f\tthis->DepthBiasCov: %0.1f\n",
+             filterIndex, biasPose.x, biasPose.y, biasPose.z, biasPose.covariance[0], biasPose.covariance[2], biasPose.covariance[5], this->depthBiasCov[filterIndex]);
+    }
+
+    return successfulMeas;
+
+}
 
+//********************************************************************************
 
+bool
+TNavBankFilter::
+measUpdateFilter(int filterIndex, const measT& currMeas, const Matrix& beamsVF,
+                 const Matrix& beamsIF, const int* beamIndices, double mapVar,
+                 int nBeamsUsed, bool test_beams) {
+    bfFilterUpdateT& update = this->filterUpdates[filterIndex];
 
+    bfLogs[filterIndex]->setUsedBeams(nBeamsUsed);
 
+    double sumMeasWeights = 0;
+    double sumWeights = 0;
+    //				sumSquaresWeights = 0;
 
-                //BEGIN SUBCLOUD COMPARISON
-                //if(!test_beams && USE_SUBCLOUD_COMPARISON){
-                if((!test_beams && TRN_WT_SUBCL == this->useModifiedWeighting ) || (TRN_FORCE_SUBCL == this->useModifiedWeighting)){
-                    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                         "\nFilter %i\tWeighting particles with subcloud comparison\n", filterIndex);
-                    bool atLeastOneBeamUsed = false;
-
-                    //tempWeights allows reverting (ignoring this measirement) if it results in Nan values somehow
-                    double tempWeights[nParticles];
-                    double tempWindowedNis[nParticles];
-                    int numBeamsForEachParticle[nParticles];
-                    for(int indexP = 0; indexP < nParticles; indexP++) {
-                        tempWeights[indexP] = this->weights[filterIndex].weights[indexP];
-                        tempWindowedNis[indexP] = 0.0;
-                        numBeamsForEachParticle[indexP] = 0;
+    double totalVar[currMeas.numMeas];
+    double modMapVar = 0.01;//map variance for calculating delta_rms and alpha
+
+    bool conditionForUsingBeamInFilter[TRN_MAX_BEAMS];
+    for(int indexM = 0; indexM < beamsVF.Ncols(); indexM++){
+        //Beam-Filter selection goes here
+        //two stage selection:
+        //- stage 1 is beam based; if doing area selection, filters use all beams
+        //- stage 2 is area based; the filter selects the regions of the map to treat the expected measurements as if they were Nan
+
+
+        //filterConfiguration sets numFilters
+        //switch(configuration) sets conditionForUsingBeamInFilter
+        //switch(configuration) sets AreaCheckFunction
+        //- each AreaCheckFunction takes filterIndex and beamEndPoint and returns bool treatExpectedMeasurementAsNan
+        //configuration sets bool reinitOnConvergence
+
+        /* DVL
+         #
+         #                  x
+         #                  ^
+         #                  |
+         #                1 | 3
+         #                  |------> y
+         #                4   2
+         #                       */
+        switch(this->filterConfiguration){
+                //configurations:
+                //1 filter only
+            case 0:
+                conditionForUsingBeamInFilter[indexM] = true;
+                break;
+
+                //2 beam detection L/R
+            case 1:
+                //dvl test is different from reson test
+                if(currMeas.dataType == TRN_SENSOR_DVL){
+                    if(beamIndices[indexM] == 0 || beamIndices[indexM] == 4){
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
+                    }else{
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
                     }
+                }
+                else if(currMeas.dataType == TRN_SENSOR_MB){
+                    if(beamIndices[indexM] < 6){
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
+                    }else{
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
+                    }
+                }
+                break;
+                //3 beam detection L/M/R
+            case 2:
+                //dvl test is different from reson test
+                if(currMeas.dataType == TRN_SENSOR_DVL){
+                    if((beamIndices[indexM] == 0) || (beamIndices[indexM] == 4)){
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
+                    }else{
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
+                    }
+                }
+                //3 filter only with
+                else if(currMeas.dataType == TRN_SENSOR_MB){
+                    if(beamIndices[indexM] < 5){
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 0);
+                    }else if(beamIndices[indexM] > 7){
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 1);
+                    }else{
+                        conditionForUsingBeamInFilter[indexM] = (filterIndex == 2);
+                    }
+                }
+                break;
+                //all area based selections
+            case 3:
+            case 4:
+            case 5:
+                conditionForUsingBeamInFilter[indexM] = true;
+                break;
+            default:
+                conditionForUsingBeamInFilter[indexM] = true;
+                break;
+                //group of tiles
+                //- 3 filters
+                //- 11 filters
+                //
+                //group of along track stripes
+                //- 3 groups of 10m wide stripes
+                //- 6 groups of half overlapping 10m wide stripes
+                //
+                //3 along track stripes L/M/R
+                //across track reinit once converged -- init new filter every N meters
+                //mix of across track reinit once converged and 3 along track
 
-                    //loop through beams; find subcloud for each beam; adjust subcloud weights
-                    for(int indexM = 0; indexM < beamsVF.Ncols(); indexM++){
-                        if(useBeam[indexM] || !conditionForUsingBeamInFilter[indexM]){
-                            continue;
-                        }
+        }
+    }
 
-                        //particle indices in subcloud
-                        int particleIndicies[nParticles];
-                        int numParticlesWithBeamM = 0;
-
-                        //indices for particles not in the subcloud; needed for correctly handling their weights
-                        int nonSubcloudIndicies[nParticles];
-                        int nonSubcloudCount = 0;
-
-                        //we need to normalize the conditional distribution of particles with beam M
-                        double tempSubcloudWeights[nParticles];
-                        double sumWeightsInSubcloud = 0.0;
-
-                        for(int indexP = 0; indexP < nParticles; indexP++){
-                            if(!ISNIN(allParticles[indexP].expectedMeasDiff[indexM]) && !this->treatBeamAsNan(filterIndex, beamsIF.SubMatrix(1,3,indexM+1,indexM+1), allParticles[indexP])){
-                                particleIndicies[numParticlesWithBeamM] = indexP;
-                                tempSubcloudWeights[numParticlesWithBeamM] = this->weights[filterIndex].weights[indexP];
-                                sumWeightsInSubcloud += tempSubcloudWeights[numParticlesWithBeamM];
-                                numParticlesWithBeamM++;
-                                numBeamsForEachParticle[indexP]++;
-                            }
-                            else{
-                                nonSubcloudIndicies[nonSubcloudCount] = indexP;
-                                nonSubcloudCount++;
-                            }
-                        }
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tbeam number: %i\tnum in subcloud: %i\tnum not in subcloud: %i\n", filterIndex, indexM, numParticlesWithBeamM, nonSubcloudCount);
 
-                        bfLogs[filterIndex]->setSubcloudCounts(indexM, numParticlesWithBeamM);
 
-                        if((numParticlesWithBeamM < 0.001 * nParticles) || (sumWeightsInSubcloud < 0.001)){
-                            logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                                 "Filter %i\tinsufficient particles or particle weight in subcloud for beam %i\n", filterIndex, indexM);
-                            continue;
-                        }
+    for(int indexM = 0; indexM < beamsVF.Ncols(); indexM++){
+        double K = this->depthBiasCov[filterIndex] / (this->depthBiasCov[filterIndex] + mapVar + currMeas.covariance[beamIndices[indexM]]);
+        if(conditionForUsingBeamInFilter[indexM]){
 
-                        //for calculating alpha and weight updates
-                        double weightUpdatesForSubcloud[nParticles];
-                        double totalVariance = mapVar + currMeas.covariance[beamIndices[indexM]] + this->depthBiasCov[filterIndex];
-                        double meanExpectedMeasurementDifference = 0;
-                        double partialDeltaRmsComputation = 0;
-                        double partialOneMinusSumSquareWeights = 1;
-                        double subcloudInnovationVariance = 0.0;
-
-                        for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
-                            double adjustedInnovation = allParticles[particleIndicies[indexS]].expectedMeasDiff[indexM] - this->depthBias[filterIndex][particleIndicies[indexS]];//averageInnovation[particleIndicies[indexS]];
-
-                            //weight update
-                            weightUpdatesForSubcloud[indexS] = exp(-0.5 * pow(adjustedInnovation,2) / totalVariance);
-
-                            //normalize subcloud weights
-                            tempSubcloudWeights[indexS] = tempSubcloudWeights[indexS]/sumWeightsInSubcloud;
-
-                            //delta_rms_squared calculations
-                            meanExpectedMeasurementDifference += adjustedInnovation * tempSubcloudWeights[indexS];
-                            partialDeltaRmsComputation += adjustedInnovation * adjustedInnovation * tempSubcloudWeights[indexS];
-                            partialOneMinusSumSquareWeights -= tempSubcloudWeights[indexS] * tempSubcloudWeights[indexS];
-
-                            if(ISNIN(meanExpectedMeasurementDifference)){
-                                logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                                     "Filter %i\tSubcloudIndex: %i\ttempSubcloudWeight: %f\tadjustedInnovaiton: %f\texpectedMeasDiff: %f\tdepthBias: %f\tdepthCov: %f\n",
-                                     filterIndex, indexS, tempSubcloudWeights[indexS], adjustedInnovation, allParticles[particleIndicies[indexS]].expectedMeasDiff[indexM],
-                                     this->depthBias[filterIndex][particleIndicies[indexS]], this->depthBiasCov[filterIndex]);
-                                break;
-                            }
-
-                            //for particle NIS calculations; part of Subcloud NIS
-                            subcloudInnovationVariance += pow(adjustedInnovation, 2) * this->weights[filterIndex].weights[particleIndicies[indexS]] -
-                            pow(adjustedInnovation * this->weights[filterIndex].weights[particleIndicies[indexS]], 2);
-
-                            tempWindowedNis[particleIndicies[indexS]] += pow(adjustedInnovation,2) / (totalVariance + subcloudInnovationVariance);
-
-                            /*
-                             if(indexS == 0){
-                             printf("averageInnovation: %f\tinnovation: %f\tadjustedInnovaiton%f\n", averageInnovation[particleIndicies[indexS]],
-                             allParticles[particleIndicies[indexS]].expectedMeasDiff[indexM], adjustedInnovation);
-                             }
-                             */
-                        }
+            bool loggedNan = false;
+            for(int indexP = 0; indexP < nParticles; indexP++){
+                if(this->treatBeamAsNan(filterIndex, beamsIF(1,indexM+1), beamsIF(2,indexM+1), allParticles[indexP])){
+                    continue;
+                }
+                double tmpx = (1-K) * this->depthBias[filterIndex][indexP] + K * allParticles[indexP].expectedMeasDiff[indexM];
+
+                if(ISNIN(tmpx)){
+                    if(!loggedNan){
+                        update.log(
+                             "Filter %i\tdeapthBias would have been set to Nan. indexP: %i\tindexM: %i\n", filterIndex, indexP, indexM);
+                        update.log(
+                             "Old Depth Bias: %0.2f\tDepthBiasCov: %0.2f\tK: %0.3f\tExpectedMeasDiff: %0.2f\tcurrMeas.covariance: %0.2f\n",
+                             this->depthBias[filterIndex][indexP], this->depthBiasCov[filterIndex], K, allParticles[indexP].expectedMeasDiff[indexM], currMeas.covariance[beamIndices[indexM]]);
+                        loggedNan = true;
+                    }
+                }else{
+                    this->depthBias[filterIndex][indexP] = tmpx;
+                }
 
-                        double alpha;
-                        double delta_rms_squared = partialDeltaRmsComputation - meanExpectedMeasurementDifference * meanExpectedMeasurementDifference - (partialOneMinusSumSquareWeights * modMapVar);
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tpartialDeltaRmsComputation: %f\tterrainVariance: %f\t1-SumSquareWeights: %f\n", filterIndex, partialDeltaRmsComputation, partialDeltaRmsComputation - meanExpectedMeasurementDifference * meanExpectedMeasurementDifference, partialOneMinusSumSquareWeights);
+                if(ISNIN(this->depthBias[filterIndex][indexP])){
+                    this->depthBias[filterIndex][indexP] = 0.0;
+                    update.log(
+                         "Filter %i\tdeapthBias set to zero to clear nan issue. indexP: %i\n", filterIndex, indexP);
+                }
 
-                        if(delta_rms_squared <= 0){
-                            alpha = 0;
-                        }
-                        else{
-                            alpha = (delta_rms_squared *(mapVar + currMeas.covariance[beamIndices[indexM]]))
-                            / ((delta_rms_squared + modMapVar) * (mapVar + currMeas.covariance[beamIndices[indexM]]) + (modMapVar * (currMeas.covariance[beamIndices[indexM]] + mapVar)));
-                        }
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tmeanExpectedMeasDiff: %f\tdelta_rms_squared: %f\talpha: %f\n", filterIndex, meanExpectedMeasurementDifference, delta_rms_squared, alpha);
+            }
+            this->depthBiasCov[filterIndex] = (1-K) * this->depthBiasCov[filterIndex];
+        }
+    }
 
-                        bfLogs[filterIndex]->setMeanExpMeasDif(indexM, meanExpectedMeasurementDifference);
-                        bfLogs[filterIndex]->setAlpha(indexM, alpha);
 
-                        //apply alpha
-                        for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
-                            weightUpdatesForSubcloud[indexS] = pow(weightUpdatesForSubcloud[indexS], alpha);
-                        }
 
-                        //calculate eta (normalization constant for subcloud weights)
-                        double etaNumerator = 0;
-                        double etaDenominator = 0;
-                        for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
-                            etaDenominator += this->weights[filterIndex].weights[particleIndicies[indexS]] * weightUpdatesForSubcloud[indexS];
-                            etaNumerator += this->weights[filterIndex].weights[particleIndicies[indexS]];
-                        }
 
-                        //apply weight updates to tempWeights in subcloud
-                        for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
-                            tempWeights[particleIndicies[indexS]] *= weightUpdatesForSubcloud[indexS];
-                        }
 
-                        //apply weight updates to tempWeights not in subcloud
-                        double oneOverEta =  etaDenominator / etaNumerator;
-                        for(int indexS = 0; indexS < nonSubcloudCount; indexS++){
-                            tempWeights[nonSubcloudIndicies[indexS]] *= oneOverEta;
-                        }
-                        atLeastOneBeamUsed = true;
-                    }
-                    //particle windowed NIS update
-                    this->SubcloudNIS = 0;
-                    for(int indexP = 0; indexP < nParticles; indexP++){
-                        if(numBeamsForEachParticle[indexP] > 0){
-                            //old allParticles[indexP].windowedNis[allParticles[indexP].windowIndex] = tempWindowedNis[indexP] / numBeamsForEachParticle[indexP];
-                            this->windowedNis[filterIndex][indexP][this->windowIndex[filterIndex][indexP]] = tempWindowedNis[indexP] / numBeamsForEachParticle[indexP];
-                            //old allParticles[indexP].windowIndex = (allParticles[indexP].windowIndex + 1) % 20;
-                            this->windowIndex[filterIndex][indexP] = (this->windowIndex[filterIndex][indexP] + 1) % 20;
-                        }
+    //BEGIN SUBCLOUD COMPARISON
+    //if(!test_beams && USE_SUBCLOUD_COMPARISON){
+    if((!test_beams && TRN_WT_SUBCL == this->useModifiedWeighting ) || (TRN_FORCE_SUBCL == this->useModifiedWeighting)){
+        update.log(
+             "\nFilter %i\tWeighting particles with subcloud comparison\n", filterIndex);
+        bool atLeastOneBeamUsed = false;
 
-                        double particleNisValue = 0;
-                        for(int indexW = 0; indexW < 20; indexW ++){
-                            //old particleNisValue += allParticles[indexP].windowedNis[indexW];
-                            particleNisValue += this->windowedNis[filterIndex][indexP][indexW];
+        //tempWeights allows reverting (ignoring this measirement) if it results in Nan values somehow
+        std::vector<double> tempWeights(nParticles);
+        std::vector<double> tempWindowedNis(nParticles);
+        std::vector<int> numBeamsForEachParticle(nParticles);
+        for(int indexP = 0; indexP < nParticles; indexP++) {
+            tempWeights[indexP] = this->weights[filterIndex].weights[indexP];
+            tempWindowedNis[indexP] = 0.0;
+            numBeamsForEachParticle[indexP] = 0;
+        }
 
-                        }
+        //loop through beams; find subcloud for each beam; adjust subcloud weights
+        for(int indexM = 0; indexM < beamsVF.Ncols(); indexM++){
+            if(useBeam[indexM] || !conditionForUsingBeamInFilter[indexM]){
+                continue;
+            }
 
-                        this->SubcloudNIS += this->weights[filterIndex].weights[indexP] * particleNisValue/20.0;
+            //particle indices in subcloud
+            std::vector<int> particleIndicies(nParticles);
+            int numParticlesWithBeamM = 0;
 
-                    }
-                    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                         "Filter %i\tSubcloudNIS: %f\n", filterIndex, this->SubcloudNIS);
+            //indices for particles not in the subcloud; needed for correctly handling their weights
+            std::vector<int> nonSubcloudIndicies(nParticles);
+            int nonSubcloudCount = 0;
 
-                    bfLogs[filterIndex]->setSubcloudNIS(this->SubcloudNIS);
+            //we need to normalize the conditional distribution of particles with beam M
+            std::vector<double> tempSubcloudWeights(nParticles);
+            double sumWeightsInSubcloud = 0.0;
 
+            for(int indexP = 0; indexP < nParticles; indexP++){
+                if(!ISNIN(allParticles[indexP].expectedMeasDiff[indexM]) && !this->treatBeamAsNan(filterIndex, beamsIF(1,indexM+1), beamsIF(2,indexM+1), allParticles[indexP])){
+                    particleIndicies[numParticlesWithBeamM] = indexP;
+                    tempSubcloudWeights[numParticlesWithBeamM] = this->weights[filterIndex].weights[indexP];
+                    sumWeightsInSubcloud += tempSubcloudWeights[numParticlesWithBeamM];
+                    numParticlesWithBeamM++;
+                    numBeamsForEachParticle[indexP]++;
+                }
+                else{
+                    nonSubcloudIndicies[nonSubcloudCount] = indexP;
+                    nonSubcloudCount++;
+                }
+            }
+            update.log(
+                 "Filter %i\tbeam number: %i\tnum in subcloud: %i\tnum not in subcloud: %i\n", filterIndex, indexM, numParticlesWithBeamM, nonSubcloudCount);
 
-                    //check for nan values before allowing the update into the filter weights
-                    bool nanWeights = false;
-                    double tempSumWeights = 0;
-                    for(int indexP = 0; indexP < nParticles; indexP++) {
-                        nanWeights = nanWeights || ISNIN(tempWeights[indexP]);
-                        tempSumWeights += tempWeights[indexP];
-                    }
-                    if(nanWeights){
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tSubcloud weighting FAILED due to NAN weights.\n", filterIndex);
-                    } else if(tempSumWeights == 0){
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tSubcloud Weighting FAILED due to sumWeights == 0. \n", filterIndex);
-                    } else if(!atLeastOneBeamUsed){
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tNo beams used in subcloud update\n", filterIndex);
-                    } else{
-                        for(int indexP = 0; indexP < nParticles; indexP++) {
-                            this->weights[filterIndex].weights[indexP] = tempWeights[indexP];
-                        }
-                    }
+            bfLogs[filterIndex]->setSubcloudCounts(indexM, numParticlesWithBeamM);
 
-                }
-                //END SUBCLOUD COMPARISON
+            if((numParticlesWithBeamM < 0.001 * nParticles) || (sumWeightsInSubcloud < 0.001)){
+                update.log(
+                     "Filter %i\tinsufficient particles or particle weight in subcloud for beam %i\n", filterIndex, indexM);
+                continue;
+            }
 
+            //for calculating alpha and weight updates
+            std::vector<double> weightUpdatesForSubcloud(nParticles);
+            double totalVariance = mapVar + currMeas.covariance[beamIndices[indexM]] + this->depthBiasCov[filterIndex];
+            double meanExpectedMeasurementDifference = 0;
+            double partialDeltaRmsComputation = 0;
+            double partialOneMinusSumSquareWeights = 1;
+            double subcloudInnovationVariance = 0.0;
+
+            for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
+                double adjustedInnovation = allParticles[particleIndicies[indexS]].expectedMeasDiff[indexM] - this->depthBias[filterIndex][particleIndicies[indexS]];//averageInnovation[particleIndicies[indexS]];
+
+                //weight update
+                weightUpdatesForSubcloud[indexS] = exp(-0.5 * pow(adjustedInnovation,2) / totalVariance);
+
+                //normalize subcloud weights
+                tempSubcloudWeights[indexS] = tempSubcloudWeights[indexS]/sumWeightsInSubcloud;
+
+                //delta_rms_squared calculations
+                meanExpectedMeasurementDifference += adjustedInnovation * tempSubcloudWeights[indexS];
+                partialDeltaRmsComputation += adjustedInnovation * adjustedInnovation * tempSubcloudWeights[indexS];
+                partialOneMinusSumSquareWeights -= tempSubcloudWeights[indexS] * tempSubcloudWeights[indexS];
+
+                if(ISNIN(meanExpectedMeasurementDifference)){
+                    update.log(
+                         "Filter %i\tSubcloudIndex: %i\ttempSubcloudWeight: %f\tadjustedInnovaiton: %f\texpectedMeasDiff: %f\tdepthBias: %f\tdepthCov: %f\n",
+                         filterIndex, indexS, tempSubcloudWeights[indexS], adjustedInnovation, allParticles[particleIndicies[indexS]].expectedMeasDiff[indexM],
+                         this->depthBias[filterIndex][particleIndicies[indexS]], this->depthBiasCov[filterIndex]);
+                    break;
+                }
 
-                /* BEGIN cross beam comparison edits*/
-                // Only used when there are no beams with good expectations on all particles
+                //for particle NIS calculations; part of Subcloud NIS
+                subcloudInnovationVariance += pow(adjustedInnovation, 2) * this->weights[filterIndex].weights[particleIndicies[indexS]] -
+                pow(adjustedInnovation * this->weights[filterIndex].weights[particleIndicies[indexS]], 2);
 
-                //int MAX_CROSS_BEAM_COMPARISONS = 5;
-                //int USE_CROSS_BEAM_COMPARISON = 1;
+                tempWindowedNis[particleIndicies[indexS]] += pow(adjustedInnovation,2) / (totalVariance + subcloudInnovationVariance);
 
-                /*Force Cross beam Comparison even when normal weighting can be done
-                 for(int indexM=0; indexM < beamsVF.Ncols(); indexM++){
-                 useBeam[indexM] = false;
+                /*
+                 if(indexS == 0){
+                 printf("averageInnovation: %f\tinnovation: %f\tadjustedInnovaiton%f\n", averageInnovation[particleIndicies[indexS]],
+                 allParticles[particleIndicies[indexS]].expectedMeasDiff[indexM], adjustedInnovation);
                  }
-                 temp = false;
                  */
+            }
 
-                // used to be if((!temp && USE_CROSS_BEAM_COMPARISON) && !(SEARCH_ALIGN_STATE || ALLOW_ATTITUDE_SEARCH || SEARCH_PSI_BERG)){
-                if((!test_beams && TRN_WT_XBEAM == this->useModifiedWeighting) &&
-                   !(SEARCH_ALIGN_STATE || ALLOW_ATTITUDE_SEARCH || SEARCH_PSI_BERG)){
-                    // !temp means no beams are good for normal comparison
-                    //the SEARCH_* flags would have each particle have a different orientation relative to the map,
-                    //	which isn't accounted for yet.
-                    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                         "Filter %i\tWeighting particles with cross beam comparison.\n", filterIndex);
-
-                    //compile a list of beams to use for cross beam comparison
-                    //	can be different beams for each particle (that's the point)
-                    //	max of MAX_CROSS_BEAM_COMPARISONS
-                    //	Also find the particle with the fewest good beams in case it's less
-                    //	currently takes beams in numbered order rather than randomly or ordered by terrain information
-                    int numGoodBeamsParticle[nParticles];
-                    int goodBeamIndicies[nParticles * MAX_CROSS_BEAM_COMPARISONS];
-                    for(int indexP = 0; indexP < nParticles; indexP++) {
-                        numGoodBeamsParticle[indexP] = 0;
-                    }
+            double alpha;
+            double delta_rms_squared = partialDeltaRmsComputation - meanExpectedMeasurementDifference * meanExpectedMeasurementDifference - (partialOneMinusSumSquareWeights * modMapVar);
+            update.log(
+                 "Filter %i\tpartialDeltaRmsComputation: %f\tterrainVariance: %f\t1-SumSquareWeights: %f\n", filterIndex, partialDeltaRmsComputation, partialDeltaRmsComputation - meanExpectedMeasurementDifference * meanExpectedMeasurementDifference, partialOneMinusSumSquareWeights);
 
-                    int minNumBeams = beamsVF.Ncols();
-                    for(int indexP = 0; indexP < nParticles; indexP++) {
-                        for(int indexM=0; indexM < beamsVF.Ncols(); indexM++){
+            if(delta_rms_squared <= 0){
+                alpha = 0;
+            }
+            else{
+                alpha = (delta_rms_squared *(mapVar + currMeas.covariance[beamIndices[indexM]]))
+                / ((delta_rms_squared + modMapVar) * (mapVar + currMeas.covariance[beamIndices[indexM]]) + (modMapVar * (currMeas.covariance[beamIndices[indexM]] + mapVar)));
+            }
+            update.log(
+                 "Filter %i\tmeanExpectedMeasDiff: %f\tdelta_rms_squared: %f\talpha: %f\n", filterIndex, meanExpectedMeasurementDifference, delta_rms_squared, alpha);
 
-                            // No nan beams, and no beams which can be used normally
-                            // if(!(isnan(allParticles[indexP].expectedMeasDiff[indexM]) || useBeam[indexM])){
-                            if(!(ISNIN(allParticles[indexP].expectedMeasDiff[indexM]) || useBeam[indexM] || !conditionForUsingBeamInFilter[indexM])){
-                                goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + numGoodBeamsParticle[indexP]] = indexM;
+            bfLogs[filterIndex]->setMeanExpMeasDif(indexM, meanExpectedMeasurementDifference);
+            bfLogs[filterIndex]->setAlpha(indexM, alpha);
 
-                                numGoodBeamsParticle[indexP] += 1;
-                                if(numGoodBeamsParticle[indexP] >=MAX_CROSS_BEAM_COMPARISONS){
-                                    break;
-                                }
-                            }
-                        }
-                        if(minNumBeams > numGoodBeamsParticle[indexP]){
-                            minNumBeams = numGoodBeamsParticle[indexP];
-                        }
-                    }
+            //apply alpha
+            for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
+                weightUpdatesForSubcloud[indexS] = pow(weightUpdatesForSubcloud[indexS], alpha);
+            }
 
-                    //tempWeights allows reverting (ignoring this measirement) if it results in Nan values somehow
-                    double tempWeights[nParticles];
-                    for(int indexP = 0; indexP < nParticles; indexP++) {
-                        tempWeights[indexP] = this->weights[filterIndex].weights[indexP];
-                    }
+            //calculate eta (normalization constant for subcloud weights)
+            double etaNumerator = 0;
+            double etaDenominator = 0;
+            for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
+                etaDenominator += this->weights[filterIndex].weights[particleIndicies[indexS]] * weightUpdatesForSubcloud[indexS];
+                etaNumerator += this->weights[filterIndex].weights[particleIndicies[indexS]];
+            }
 
-                    //compute the weight updates
-                    double tempWeightUpdate[nParticles];
-                    for(int beamNumber=0; beamNumber < minNumBeams; beamNumber++){
+            //apply weight updates to tempWeights in subcloud
+            for(int indexS = 0; indexS < numParticlesWithBeamM; indexS++){
+                tempWeights[particleIndicies[indexS]] *= weightUpdatesForSubcloud[indexS];
+            }
 
-                        double partialDeltaRmsComputation = 0;
-                        double partialMeanTerrainDepth = 0;
-                        double partialOneMinusSumSquareWeights = 1;
-                        double maxSensorVar = 0;
+            //apply weight updates to tempWeights not in subcloud
+            double oneOverEta =  etaDenominator / etaNumerator;
+            for(int indexS = 0; indexS < nonSubcloudCount; indexS++){
+                tempWeights[nonSubcloudIndicies[indexS]] *= oneOverEta;
+            }
+            atLeastOneBeamUsed = true;
+        }
+        //particle windowed NIS update
+        update.hasNIS = true;
+        update.subcloudNIS = 0;
+        for(int indexP = 0; indexP < nParticles; indexP++){
+            if(numBeamsForEachParticle[indexP] > 0){
+                //old allParticles[indexP].windowedNis[allParticles[indexP].windowIndex] = tempWindowedNis[indexP] / numBeamsForEachParticle[indexP];
+                this->windowedNis[filterIndex][indexP][this->windowIndex[filterIndex][indexP]] = tempWindowedNis[indexP] / numBeamsForEachParticle[indexP];
+                //old allParticles[indexP].windowIndex = (allParticles[indexP].windowIndex + 1) % 20;
+                this->windowIndex[filterIndex][indexP] = (this->windowIndex[filterIndex][indexP] + 1) % 20;
+            }
 
-                        //for each particle
-                        //	pick a beam
-                        //	calculate it's likelihood with p(h)==1 assumption
-                        //	calculate it's contribution to delta_rms (alpha precursor)
-                        for(int indexP = 0; indexP < nParticles; indexP++) {
+            double particleNisValue = 0;
+            for(int indexW = 0; indexW < 20; indexW ++){
+                //old particleNisValue += allParticles[indexP].windowedNis[indexW];
+                particleNisValue += this->windowedNis[filterIndex][indexP][indexW];
 
-                            double totalVariance = 10;
-                            totalVariance = mapVar + currMeas.covariance[beamIndices[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]]];
-                            if(maxSensorVar < currMeas.covariance[beamIndices[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]]]){
-                                maxSensorVar = currMeas.covariance[beamIndices[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]]];
-                            }
+            }
 
-                            tempWeightUpdate[indexP] = exp(-0.5 * pow(allParticles[indexP].expectedMeasDiff[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]] -
-                                                                      this->depthBias[filterIndex][indexP],2) / totalVariance);
-                            double beamEndpointTerrainDepth = 0;
-                            beamEndpointTerrainDepth = allParticles[indexP].position[2] + beamsVF(3, goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber] + 1);
+            update.subcloudNIS += this->weights[filterIndex].weights[indexP] * particleNisValue/20.0;
 
-                            partialDeltaRmsComputation += beamEndpointTerrainDepth * beamEndpointTerrainDepth * this->weights[filterIndex].weights[indexP];
-                            partialMeanTerrainDepth += beamEndpointTerrainDepth * this->weights[filterIndex].weights[indexP];
-                            partialOneMinusSumSquareWeights -= this->weights[filterIndex].weights[indexP] * this->weights[filterIndex].weights[indexP];
+        }
+        update.log(
+             "Filter %i\tSubcloudNIS: %f\n", filterIndex, update.subcloudNIS);
 
-                        }
+        bfLogs[filterIndex]->setSubcloudNIS(update.subcloudNIS);
 
-                        //calculate delta_rms then alpha
-                        double alpha;
-                        double delta_rms_squared = partialDeltaRmsComputation - partialMeanTerrainDepth * partialMeanTerrainDepth - (partialOneMinusSumSquareWeights * mapVar);
-                        if(delta_rms_squared <= 0){
-                            alpha = 0;
-                        }
-                        else{
-                            //This alpha is always smaller than Shandor's for the same delta_rms (trust the measurement less)
-                            alpha = delta_rms_squared / (delta_rms_squared + mapVar + maxSensorVar);
-                        }
 
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\talpha: %f\tMeanTerrainDepth: %f\n", filterIndex, alpha, partialMeanTerrainDepth);
-                        //set alpha for currMeas for logging
-                        //!currMeas.alphas[i] = alpha; // This seems to break things when turned on
+        //check for nan values before allowing the update into the filter weights
+        bool nanWeights = false;
+        double tempSumWeights = 0;
+        for(int indexP = 0; indexP < nParticles; indexP++) {
+            nanWeights = nanWeights || ISNIN(tempWeights[indexP]);
+            tempSumWeights += tempWeights[indexP];
+        }
+        if(nanWeights){
+            update.log(
+                 "Filter %i\tSubcloud weighting FAILED due to NAN weights.\n", filterIndex);
+        } else if(tempSumWeights == 0){
+            update.log(
+                 "Filter %i\tSubcloud Weighting FAILED due to sumWeights == 0. \n", filterIndex);
+        } else if(!atLeastOneBeamUsed){
+            update.log(
+                 "Filter %i\tNo beams used in subcloud update\n", filterIndex);
+        } else{
+            for(int indexP = 0; indexP < nParticles; indexP++) {
+                this->weights[filterIndex].weights[indexP] = tempWeights[indexP];
+            }
+        }
 
+    }
+    //END SUBCLOUD COMPARISON
 
-                        //modify the weight updates by alpha and apply them to the tempWeights
-                        for(int indexP = 0; indexP < nParticles; indexP++) {
-                            tempWeights[indexP] *= pow(tempWeightUpdate[indexP], alpha);
-                        }
-                    }
 
-                    //check for nan values before allowing the update into the filter weights
-                    bool nanWeights = false;
-                    for(int indexP = 0; indexP < nParticles; indexP++) {
-                        //nanWeights = nanWeights || isnan(tempWeights[indexP]);
-                        nanWeights = nanWeights || ISNIN(tempWeights[indexP]);
-                    }
-                    if(nanWeights){
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-                             "Filter %i\tCross beam comparison FAILED due to NAN weights.\n", filterIndex);
-                    }
-                    else{
-                        for(int indexP = 0; indexP < nParticles; indexP++) {
-                            this->weights[filterIndex].weights[indexP] = tempWeights[indexP];
-                        }
-                    }
-                }
+    /* BEGIN cross beam comparison edits*/
+    // Only used when there are no beams with good expectations on all particles
 
-                /* END cross beam comparison edits*/
+    //int MAX_CROSS_BEAM_COMPARISONS = 5;
+    //int USE_CROSS_BEAM_COMPARISON = 1;
 
-                //Here we trigger between using the modified weighting scheme concocted by Shandor
-                //and the standard TRN weighting
+    /*Force Cross beam Comparison even when normal weighting can be done
+     for(int indexM=0; indexM < beamsVF.Ncols(); indexM++){
+     useBeam[indexM] = false;
+     }
+     temp = false;
+     */
 
-                //TODO: Figure out if we are going to do any different correlation for octree vs dem
+    // used to be if((!temp && USE_CROSS_BEAM_COMPARISON) && !(SEARCH_ALIGN_STATE || ALLOW_ATTITUDE_SEARCH || SEARCH_PSI_BERG)){
+    if((!test_beams && TRN_WT_XBEAM == this->useModifiedWeighting) &&
+       !(SEARCH_ALIGN_STATE || ALLOW_ATTITUDE_SEARCH || SEARCH_PSI_BERG)){
+        // !temp means no beams are good for normal comparison
+        //the SEARCH_* flags would have each particle have a different orientation relative to the map,
+        //	which isn't accounted for yet.
+        update.log(
+             "Filter %i\tWeighting particles with cross beam comparison.\n", filterIndex);
+
+        //compile a list of beams to use for cross beam comparison
+        //	can be different beams for each particle (that's the point)
+        //	max of MAX_CROSS_BEAM_COMPARISONS
+        //	Also find the particle with the fewest good beams in case it's less
+        //	currently takes beams in numbered order rather than randomly or ordered by terrain information
+        std::vector<int> numGoodBeamsParticle(nParticles);
+        std::vector<int> goodBeamIndicies(nParticles * MAX_CROSS_BEAM_COMPARISONS);
+        for(int indexP = 0; indexP < nParticles; indexP++) {
+            numGoodBeamsParticle[indexP] = 0;
+        }
 
-                //Compute the variance used to update the particle weights using normal or modified weighting
-                // used to be if(!this->useModifiedWeighting) {
-                if(TRN_WT_NONE == this->useModifiedWeighting) {
-                    //set variance for each beam
-                    for(int i = 0; i < beamsVF.Ncols(); i++) {
-                        //Need to set the map variance some how, right now will assume it is a fixed value...
-                        totalVar[i] = mapVar + currMeas.covariance[beamIndices[i]];
-                        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBankFilter::Filter %i\tVariance for beam %i is %.2f \n", filterIndex, beamIndices[i-1], totalVar[i]);
-                    }
-                }
-                else
-                {
-                    //Implement modified algorithm
-                    //*** TODO Un-hard code the number of measurements used
-
-                    double* mapInfoCov = new double[beamsVF.Ncols()](); 	//;[4] ={0.0, 0.0, 0.0, 0.0};
-                    double* mapSquared = new double[beamsVF.Ncols()](); 	//[4]  = {0.0, 0.0, 0.0, 0.0};   //
-                    double* mapMean = new double[beamsVF.Ncols()](); 			//[4]  = {0.0, 0.0, 0.0, 0.0};		//mean value of expected measurement
-                    double* mapVariance = new double[beamsVF.Ncols()](); 	//[4] = {0.0, 0.0, 0.0, 0.0};	//variance of expected measurements
-                    double* beamVar = new double[beamsVF.Ncols()](); 			//[4] = {0.0, 0.0, 0.0, 0.0};		//variance of range measurements
-
-                    //			double mapInfoCov[4] ={0.0, 0.0, 0.0, 0.0};
-                    //			double mapSquared[4]  = {0.0, 0.0, 0.0, 0.0};   //
-                    //			double mapMean[4]  = {0.0, 0.0, 0.0, 0.0};		//mean value of expected measurement
-                    //			double mapVariance[4] = {0.0, 0.0, 0.0, 0.0};	//variance of expected measurements
-                    //			double beamVar[4] = {0.0, 0.0, 0.0, 0.0};		//variance of range measurements
-
-                    //Compute mean and square of expected measurement
-                    for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
-                        // what if false for every iteration of the loop?
-                        if(this->useBeam[beamInd] && conditionForUsingBeamInFilter[beamInd]){	//edit to allow using any good beams from measurement
-                            for(int i = 0; i < nParticles; i++) {
-                                //As we already have the expected measurement difference, compute mean and square of measurement difference
-                                mapSquared[beamInd] += pow(allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i], 2) * this->weights[filterIndex].weights[i];
-                                mapMean[beamInd] += (allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i]) * this->weights[filterIndex].weights[i];
-                            }
-                        }
-                    }
+        int minNumBeams = beamsVF.Ncols();
+        for(int indexP = 0; indexP < nParticles; indexP++) {
+            for(int indexM=0; indexM < beamsVF.Ncols(); indexM++){
 
-                    double baseSensorVar = 0;
+                // No nan beams, and no beams which can be used normally
+                // if(!(isnan(allParticles[indexP].expectedMeasDiff[indexM]) || useBeam[indexM])){
+                if(!(ISNIN(allParticles[indexP].expectedMeasDiff[indexM]) || useBeam[indexM] || !conditionForUsingBeamInFilter[indexM])){
+                    goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + numGoodBeamsParticle[indexP]] = indexM;
 
-                    modMapVar = .01;  //assume map noise is about .15m^2 - but still use the value pulled from the map file
-                    baseSensorVar = mapVar - modMapVar;
-                    if(baseSensorVar < 0) {
-                        baseSensorVar = 0;
+                    numGoodBeamsParticle[indexP] += 1;
+                    if(numGoodBeamsParticle[indexP] >=MAX_CROSS_BEAM_COMPARISONS){
+                        break;
                     }
+                }
+            }
+            if(minNumBeams > numGoodBeamsParticle[indexP]){
+                minNumBeams = numGoodBeamsParticle[indexP];
+            }
+        }
 
-                    //Compute variance of expected measurements and variance used in modified measurement update
-                    for(int i = 0; i < beamsVF.Ncols(); i++) {
+        //tempWeights allows reverting (ignoring this measirement) if it results in Nan values somehow
+        std::vector<double> tempWeights(nParticles);
+        for(int indexP = 0; indexP < nParticles; indexP++) {
+            tempWeights[indexP] = this->weights[filterIndex].weights[indexP];
+        }
 
-                        beamVar[i] = currMeas.covariance[beamIndices[i]];
-                        mapVariance[i] = mapSquared[i] - pow(mapMean[i], 2);
-                        if(mapVariance[i] > modMapVar) {
-                            mapInfoCov[i] = mapVariance[i] - modMapVar;
-                        } else {
-                            mapInfoCov[i] = 0.0000001;
-                        }
+        //compute the weight updates
+        std::vector<double> tempWeightUpdate(nParticles);
+        for(int beamNumber=0; beamNumber < minNumBeams; beamNumber++){
+
+            double partialDeltaRmsComputation = 0;
+            double partialMeanTerrainDepth = 0;
+            double partialOneMinusSumSquareWeights = 1;
+            double maxSensorVar = 0;
+
+            //for each particle
+            //	pick a beam
+            //	calculate it's likelihood with p(h)==1 assumption
+            //	calculate it's contribution to delta_rms (alpha precursor)
+            for(int indexP = 0; indexP < nParticles; indexP++) {
+
+                double totalVariance = 10;
+                totalVariance = mapVar + currMeas.covariance[beamIndices[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]]];
+                if(maxSensorVar < currMeas.covariance[beamIndices[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]]]){
+                    maxSensorVar = currMeas.covariance[beamIndices[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]]];
+                }
 
-                        totalVar[i] = ((beamVar[i] + baseSensorVar + modMapVar) * mapVariance[i] + (baseSensorVar + beamVar[i]) * modMapVar) /
-                        mapInfoCov[i];
-                        //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBankFilter::Modified Variance for beam %i is %.2f \n", i, totalVar[i]);
+                tempWeightUpdate[indexP] = exp(-0.5 * pow(allParticles[indexP].expectedMeasDiff[goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber]] -
+                                                          this->depthBias[filterIndex][indexP],2) / totalVariance);
+                double beamEndpointTerrainDepth = 0;
+                beamEndpointTerrainDepth = allParticles[indexP].position[2] + beamsVF(3, goodBeamIndicies[indexP * MAX_CROSS_BEAM_COMPARISONS + beamNumber] + 1);
 
-                        //ALPHA
-                        // Valid values are 0 <= alpha <= 1
-                        // Use -0.1 as an encoding for NaN
-                        //
-                        if(totalVar[i] > 0.0){
-                            //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"Alpha[%u]\t%f\n", i, currMeas.alphas[i]);
-                            currMeas.alphas[i] = (baseSensorVar + beamVar[i] + modMapVar) / totalVar[i];
-                            //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"Alpha[%u]\t%f\n", i, currMeas.alphas[i]);
+                partialDeltaRmsComputation += beamEndpointTerrainDepth * beamEndpointTerrainDepth * this->weights[filterIndex].weights[indexP];
+                partialMeanTerrainDepth += beamEndpointTerrainDepth * this->weights[filterIndex].weights[indexP];
+                partialOneMinusSumSquareWeights -= this->weights[filterIndex].weights[indexP] * this->weights[filterIndex].weights[indexP];
 
-                        }else{
-                            // NaN is encoded as a value < 0
-                            //
-                            currMeas.alphas[i] = -0.1;
+            }
 
-                        }
-                        //END ALPHA
-                    }
+            //calculate delta_rms then alpha
+            double alpha;
+            double delta_rms_squared = partialDeltaRmsComputation - partialMeanTerrainDepth * partialMeanTerrainDepth - (partialOneMinusSumSquareWeights * mapVar);
+            if(delta_rms_squared <= 0){
+                alpha = 0;
+            }
+            else{
+                //This alpha is always smaller than Shandor's for the same delta_rms (trust the measurement less)
+                alpha = delta_rms_squared / (delta_rms_squared + mapVar + maxSensorVar);
+            }
 
-                    //			for (i = 0; i < beamsVF.Ncols(); i++) logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated mapVariance for beam %i as %.2f \n", i, mapVariance(i));
-                    //			logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBankFilter::mapVariance = {%.2f,%.2f,%.2f,%.2f}\n",mapVariance[0],
-                    //				mapVariance[1],mapVariance[2],mapVariance[3]);
+            update.log(
+                 "Filter %i\talpha: %f\tMeanTerrainDepth: %f\n", filterIndex, alpha, partialMeanTerrainDepth);
+            //set alpha for currMeas for logging
+            //!currMeas.alphas[i] = alpha; // This seems to break things when turned on
 
-                    delete [] mapInfoCov;
-                    delete [] mapSquared;
-                    delete [] mapMean;
-                    delete [] mapVariance;
-                    delete [] beamVar;
-                }
 
-                //Loop through & compute measurement update weights for all particles
-                double sumSquaredError = 0;
+            //modify the weight updates by alpha and apply them to the tempWeights
+            for(int indexP = 0; indexP < nParticles; indexP++) {
+                tempWeights[indexP] *= pow(tempWeightUpdate[indexP], alpha);
+            }
+        }
 
-                //		TODO: Beam Variance can be computed ahead of time (implement later)
-                //		for (int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) sumInvVar += (1.0/(totalVar[beamInd]));
+        //check for nan values before allowing the update into the filter weights
+        bool nanWeights = false;
+        for(int indexP = 0; indexP < nParticles; indexP++) {
+            //nanWeights = nanWeights || isnan(tempWeights[indexP]);
+            nanWeights = nanWeights || ISNIN(tempWeights[indexP]);
+        }
+        if(nanWeights){
+            update.log(
+                 "Filter %i\tCross beam comparison FAILED due to NAN weights.\n", filterIndex);
+        }
+        else{
+            for(int indexP = 0; indexP < nParticles; indexP++) {
+                this->weights[filterIndex].weights[indexP] = tempWeights[indexP];
+            }
+        }
+    }
 
-                for(int i = 0; i < nParticles; i++) {
-                    sumSquaredError = 0;
-                    double sumWeightedError = 0;
-                    double sumInvVar = 0;
-
-                    currMeasWeights[i] = 1;
-
-                    for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
-                        if(this->useBeam[beamInd] && conditionForUsingBeamInFilter[beamInd]){	//edit to allow using any good beams from measurement
-
-                            //As we already have the expected measurement difference, just apply the measurement model to it
-                            sumWeightedError += (1.0 / (totalVar[beamInd])) * allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i]; //Weighted mean error
-                            sumSquaredError += (1.0 / (totalVar[beamInd])) * pow(allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i], 2); //Weighted Squared Error
-                            sumInvVar += (1.0 / (totalVar[beamInd]));		//Beam Variance
-                            //					logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:totalVar[%i] is %f\n",beamInd,totalVar[beamInd]);
-                            if(ISNIN(sumSquaredError))
-                            {
-                                logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"Filter %i\tTNavBF:Sum of squared error for particle %i beam %i is nan \n", filterIndex, i, beamInd);
-
-                                bfLogs[filterIndex]->write();
-
-                                return false;
-                                //		     logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:totalVar[%i] is %f\n",beamInd,totalVar[beamInd]);
-                                //		     logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:expectedMeasDiff[%i] is %f \n",beamInd,allParticles[i].expectedMeasDiff[beamInd]);
-                            }
-                        }
-                    }
+    /* END cross beam comparison edits*/
 
-                    //Compute new measurement weight
-                    if(USE_CONTOUR_MATCHING && !USE_RANGE_CORR) {
-                        double currDepthBias = (1.0 / sumInvVar) * sumWeightedError;
-                        allParticles[i].position[2] -= currDepthBias;
-                        for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
-                            if(this->useBeam[beamInd] && conditionForUsingBeamInFilter[beamInd]){	//edit to allow using any good beams from measurement
-                                allParticles[i].expectedMeasDiff[beamInd] -= currDepthBias;
-                            }
-                        }
+    //Here we trigger between using the modified weighting scheme concocted by Shandor
+    //and the standard TRN weighting
 
-                        //calculate likelihood equation.
-                        //currMeasWeights[i] = exp(-0.5*(sumSquaredError-2*currDepthBias*sumWeightedError+pow(currDepthBias,2)*sumInvVar));
-                        currMeasWeights[i] = exp(-0.5 * (sumSquaredError - currDepthBias * sumWeightedError));
-                        //newWeight *= exp(-0.5*(currDepthBias*currDepthBias));
-                    } else {
-                        currMeasWeights[i] = exp(-0.5 * sumSquaredError);
-                    }
+    //TODO: Figure out if we are going to do any different correlation for octree vs dem
 
-                    sumWeights += this->weights[filterIndex].weights[i] * currMeasWeights[i];
-                    sumMeasWeights += currMeasWeights[i];
+    //Compute the variance used to update the particle weights using normal or modified weighting
+    // used to be if(!this->useModifiedWeighting) {
+    if(TRN_WT_NONE == this->useModifiedWeighting) {
+        //set variance for each beam
+        for(int i = 0; i < beamsVF.Ncols(); i++) {
+            //Need to set the map variance some how, right now will assume it is a fixed value...
+            totalVar[i] = mapVar + currMeas.covariance[beamIndices[i]];
+            update.log("TNavBankFilter::Filter %i\tVariance for beam %i is %.2f \n", filterIndex, beamIndices[i-1], totalVar[i]);
+        }
+    }
+    else
+    {
+        //Implement modified algorithm
+        //*** TODO Un-hard code the number of measurements used
+
+        double* mapInfoCov = new double[beamsVF.Ncols()](); 	//;[4] ={0.0, 0.0, 0.0, 0.0};
+        double* mapSquared = new double[beamsVF.Ncols()](); 	//[4]  = {0.0, 0.0, 0.0, 0.0};   //
+        double* mapMean = new double[beamsVF.Ncols()](); 			//[4]  = {0.0, 0.0, 0.0, 0.0};		//mean value of expected measurement
+        double* mapVariance = new double[beamsVF.Ncols()](); 	//[4] = {0.0, 0.0, 0.0, 0.0};	//variance of expected measurements
+        double* beamVar = new double[beamsVF.Ncols()](); 			//[4] = {0.0, 0.0, 0.0, 0.0};		//variance of range measurements
+
+        //			double mapInfoCov[4] ={0.0, 0.0, 0.0, 0.0};
+        //			double mapSquared[4]  = {0.0, 0.0, 0.0, 0.0};   //
+        //			double mapMean[4]  = {0.0, 0.0, 0.0, 0.0};		//mean value of expected measurement
+        //			double mapVariance[4] = {0.0, 0.0, 0.0, 0.0};	//variance of expected measurements
+        //			double beamVar[4] = {0.0, 0.0, 0.0, 0.0};		//variance of range measurements
+
+        //Compute mean and square of expected measurement
+        for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
+            // what if false for every iteration of the loop?
+            if(this->useBeam[beamInd] && conditionForUsingBeamInFilter[beamInd]){	//edit to allow using any good beams from measurement
+                for(int i = 0; i < nParticles; i++) {
+                    //As we already have the expected measurement difference, compute mean and square of measurement difference
+                    mapSquared[beamInd] += pow(allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i], 2) * this->weights[filterIndex].weights[i];
+                    mapMean[beamInd] += (allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i]) * this->weights[filterIndex].weights[i];
                 }
+            }
+        }
 
-                logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:: Filter %i\tsumSquaredError = %f \n", filterIndex, sumSquaredError);
-                logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:: Filter %i\tsumWeights = %f \n", filterIndex, sumWeights);
+        double baseSensorVar = 0;
 
-                bfLogs[filterIndex]->setSumWeights(sumWeights);
-                bfLogs[filterIndex]->setSumSquaredError(sumSquaredError);
+        update.hasAlphas = true;
 
-                //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Filter %i\tCalculating NIS Matrices \n");
+        modMapVar = .01;  //assume map noise is about .15m^2 - but still use the value pulled from the map file
+        baseSensorVar = mapVar - modMapVar;
+        if(baseSensorVar < 0) {
+            baseSensorVar = 0;
+        }
 
-                //SymmetricMatrix mapMeasVarMat(beamsVF.Ncols());  			//Variance in expected map measurements
-                //ColumnVector measDiffMean(beamsVF.Ncols());						//Mean difference between actual and expected measurements
-                //computeInnovationsMatrices(allParticles, mapMeasVarMat, measDiffMean);  //Compute variance matrix for expected measurements
+        //Compute variance of expected measurements and variance used in modified measurement update
+        for(int i = 0; i < beamsVF.Ncols(); i++) {
 
-                //		logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Current number of measurements is: %i \n",currMeas.numMeas);
-                //		logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Size of measurement matrix is: %i \n",beamsVF.Ncols());
-                //		logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Size of covariance matrix is: %i \n",mapMeasVarMat.Ncols());
-                //	 for(i = 1; i < beamsVF.Ncols() + 1; i++) {
-                //	    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated measDiffMean for beam %i as %.2f. Range = %.2f \n",
-                //		 beamIndices[i-1], measDiffMean(i), currMeas.ranges[i-1]);
-                //	 }
+            beamVar[i] = currMeas.covariance[beamIndices[i]];
+            mapVariance[i] = mapSquared[i] - pow(mapMean[i], 2);
+            if(mapVariance[i] > modMapVar) {
+                mapInfoCov[i] = mapVariance[i] - modMapVar;
+            } else {
+                mapInfoCov[i] = 0.0000001;
+            }
 
-                //if(mapMeasVarMat.Nrows() > 0) {
-                //	logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Filter %i\tFirst Term of Map Covariance Matrix is %.2f \n", filterIndex, mapMeasVarMat(1, 1));
-                //}
+            totalVar[i] = ((beamVar[i] + baseSensorVar + modMapVar) * mapVariance[i] + (baseSensorVar + beamVar[i]) * modMapVar) /
+            mapInfoCov[i];
+            //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBankFilter::Modified Variance for beam %i is %.2f \n", i, totalVar[i]);
 
-                //calculateNIS(mapMeasVarMat, measDiffMean, nisVal, currMeas, beamIndices);
+            //ALPHA
+            // Valid values are 0 <= alpha <= 1
+            // Use -0.1 as an encoding for NaN
+            //
+            if(totalVar[i] > 0.0){
+                //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"Alpha[%u]\t%f\n", i, currMeas.alphas[i]);
+                update.alphas[i] = (baseSensorVar + beamVar[i] + modMapVar) / totalVar[i];
+                //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"Alpha[%u]\t%f\n", i, currMeas.alphas[i]);
 
-                //old logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated NIS Value : %.2f \tnumBeams normalized NIS: %.2f\n", nisVal,nisVal/beamsVF.Ncols());
-                //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated NIS Value : %.2f \tnumBeams normalized NIS: %.2f\n", nisVal*beamsVF.Ncols(),nisVal);
+            }else{
+                // NaN is encoded as a value < 0
+                //
+                update.alphas[i] = -0.1;
 
-                //updateNISwindow(nisVal);
+            }
+            //END ALPHA
+        }
 
-                //Keep track of the number of soundings used since the last resampling
-                nSoundings += beamsVF.Ncols();
+        //			for (i = 0; i < beamsVF.Ncols(); i++) logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated mapVariance for beam %i as %.2f \n", i, mapVariance(i));
+        //			logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBankFilter::mapVariance = {%.2f,%.2f,%.2f,%.2f}\n",mapVariance[0],
+        //				mapVariance[1],mapVariance[2],mapVariance[3]);
 
-                bfLogs[filterIndex]->setSoundings(nSoundings);
+        delete [] mapInfoCov;
+        delete [] mapSquared;
+        delete [] mapMean;
+        delete [] mapVariance;
+        delete [] beamVar;
+    }
 
-                measVariance = 0;
+    //Loop through & compute measurement update weights for all particles
+    double sumSquaredError = 0;
+    ostringstream measWeightsText;
 
-                //Apply measurement weights and normalize the distribution
-                if(sumWeights == 0.0){
+    //		TODO: Beam Variance can be computed ahead of time (implement later)
+    //		for (int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) sumInvVar += (1.0/(totalVar[beamInd]));
 
-                    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"\nFilter %i\tParticle Weights not updated due to sumWeights == 0.0\n\n", filterIndex);
-                }
-                /*else if(nisVal>=NIS_WINDOW_LENGTH*1.4){ //TODO: Don't hard code in 1.4, use MAX_NIS_VALUE, but that #define is not defined in the scope of the particle filter
-                 logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"\nParticle Weights not updated because current NIS >= %f\n",NIS_WINDOW_LENGTH*1.4);
-                 }*/
-                else{
-                    for(int i = 0; i < nParticles; i++) {
-                        this->weights[filterIndex].weights[i] *= currMeasWeights[i] / sumWeights;
-                        //TODO if inovations are too large, particle weights go nan.
-                        //currMeasWeight was not nan for the particular failure I examined.
-                        //sumWeights == 0.0
-
-                        //						sumSquaresWeights += pow(this->weights[filterIndex].weights[i], 2);
-                        //compute variance of measurement weights
-                        currMeasWeights[i] /= sumMeasWeights;
-                        measVariance += pow(currMeasWeights[i] - 1.0 / nParticles, 2) / nParticles;
-                        if(saveDirectory != NULL) {
-                            //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"%.2f",currMeasWeights[i]);
-                            measWeightsFile << currMeasWeights[i] << "\t";
-                        }
-                    }
-                }
-                //effSampSize = 1.0 / sumSquaresWeights;
+    for(int i = 0; i < nParticles; i++) {
+        sumSquaredError = 0;
+        double sumWeightedError = 0;
+        double sumInvVar = 0;
 
-                bfLogs[filterIndex]->write();
+        update.measWeights[i] = 1;
+
+        for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
+            if(this->useBeam[beamInd] && conditionForUsingBeamInFilter[beamInd]){	//edit to allow using any good beams from measurement
+
+                //As we already have the expected measurement difference, just apply the measurement model to it
+                sumWeightedError += (1.0 / (totalVar[beamInd])) * allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i]; //Weighted mean error
+                sumSquaredError += (1.0 / (totalVar[beamInd])) * pow(allParticles[i].expectedMeasDiff[beamInd] - this->depthBias[filterIndex][i], 2); //Weighted Squared Error
+                sumInvVar += (1.0 / (totalVar[beamInd]));		//Beam Variance
+                //					logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:totalVar[%i] is %f\n",beamInd,totalVar[beamInd]);
+                if(ISNIN(sumSquaredError))
+                {
+                    update.log("Filter %i\tTNavBF:Sum of squared error for particle %i beam %i is nan \n", filterIndex, i, beamInd);
 
+                    return false;
+                    //		     logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:totalVar[%i] is %f\n",beamInd,totalVar[beamInd]);
+                    //		     logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF:expectedMeasDiff[%i] is %f \n",beamInd,allParticles[i].expectedMeasDiff[beamInd]);
+                }
             }
-            if(saveDirectory != NULL) {
-                measWeightsFile << endl;
+        }
+
+        //Compute new measurement weight
+        if(USE_CONTOUR_MATCHING && !USE_RANGE_CORR) {
+            double currDepthBias = (1.0 / sumInvVar) * sumWeightedError;
+            allParticles[i].position[2] -= currDepthBias;
+            for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
+                if(this->useBeam[beamInd] && conditionForUsingBeamInFilter[beamInd]){	//edit to allow using any good beams from measurement
+                    allParticles[i].expectedMeasDiff[beamInd] -= currDepthBias;
+                }
             }
 
+            //calculate likelihood equation.
+            //currMeasWeights[i] = exp(-0.5*(sumSquaredError-2*currDepthBias*sumWeightedError+pow(currDepthBias,2)*sumInvVar));
+            update.measWeights[i] = exp(-0.5 * (sumSquaredError - currDepthBias * sumWeightedError));
+            //newWeight *= exp(-0.5*(currDepthBias*currDepthBias));
+        } else {
+            update.measWeights[i] = exp(-0.5 * sumSquaredError);
         }
 
+        sumWeights += this->weights[filterIndex].weights[i] * update.measWeights[i];
+        sumMeasWeights += update.measWeights[i];
     }
 
-#ifdef USE_MATLAB
-    plotMapMatlab(mapForPloting.depths, mapForPloting.xpts,
-                  mapForPloting.ypts, "title('Sub-Map and Post-Resampling Particle Distribution');", "figure(1)");
-    mapPlotted = 1;
-    plotParticleDistMatlab(allParticles, "figure(1)");
-#endif
+    update.log("TNavBF:: Filter %i\tsumSquaredError = %f \n", filterIndex, sumSquaredError);
+    update.log("TNavBF:: Filter %i\tsumWeights = %f \n", filterIndex, sumWeights);
 
-    //if measurement successfully added, recheck estimator convergence
-    //if(successfulMeas)
-    //   checkConvergence();
+    bfLogs[filterIndex]->setSumWeights(sumWeights);
+    bfLogs[filterIndex]->setSumSquaredError(sumSquaredError);
 
+    //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Filter %i\tCalculating NIS Matrices \n");
 
-    poseT biasPose;
-    for(int filterIndex = 0; filterIndex < this->numFilters; filterIndex++){
-        this->computeMMSE(&biasPose, filterIndex);
-        biasPose -= *lastNavPose;
+    //SymmetricMatrix mapMeasVarMat(beamsVF.Ncols());  			//Variance in expected map measurements
+    //ColumnVector measDiffMean(beamsVF.Ncols());						//Mean difference between actual and expected measurements
+    //computeInnovationsMatrices(allParticles, mapMeasVarMat, measDiffMean);  //Compute variance matrix for expected measurements
 
-        logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),
-             "Filter %i\tNorthBias: %0.1f\tEastBias: %0.1f\tDepthBias: %0.1f\tNorthVariance: %0.1f\tEastVariance: %0.1f\tDepthVariance: %0.1f\tthis->DepthBiasCov: %0.1f\n",
-             filterIndex, biasPose.x, biasPose.y, biasPose.z, biasPose.covariance[0], biasPose.covariance[2], biasPose.covariance[5], this->depthBiasCov[filterIndex]);
-    }
+    //		logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Current number of measurements is: %i \n",currMeas.numMeas);
+    //		logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Size of measurement matrix is: %i \n",beamsVF.Ncols());
+    //		logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Size of covariance matrix is: %i \n",mapMeasVarMat.Ncols());
+    //	 for(i = 1; i < beamsVF.Ncols() + 1; i++) {
+    //	    logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated measDiffMean for beam %i as %.2f. Range = %.2f \n",
+    //		 beamIndices[i-1], measDiffMean(i), currMeas.ranges[i-1]);
+    //	 }
 
-    return successfulMeas;
+    //if(mapMeasVarMat.Nrows() > 0) {
+    //	logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Filter %i\tFirst Term of Map Covariance Matrix is %.2f \n", filterIndex, mapMeasVarMat(1, 1));
+    //}
 
-}
+    //calculateNIS(mapMeasVarMat, measDiffMean, nisVal, currMeas, beamIndices);
 
-//********************************************************************************
+    //old logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated NIS Value : %.2f \tnumBeams normalized NIS: %.2f\n", nisVal,nisVal/beamsVF.Ncols());
+    //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::Calculated NIS Value : %.2f \tnumBeams normalized NIS: %.2f\n", nisVal*beamsVF.Ncols(),nisVal);
+
+    //updateNISwindow(nisVal);
+
+    //Keep track of the number of soundings used since the last resampling
+    //(nSoundings itself is advanced when this filter's update is applied)
+    bfLogs[filterIndex]->setSoundings(nSoundings + (filterIndex + 1) * beamsVF.Ncols());
+
+    update.hasMeasVariance = true;
+    update.measVariance = 0;
+
+    //Apply measurement weights and normalize the distribution
+    if(sumWeights == 0.0){
+
+        update.log("\nFilter %i\tParticle Weights not updated due to sumWeights == 0.0\n\n", filterIndex);
+    }
+    /*else if(nisVal>=NIS_WINDOW_LENGTH*1.4){ //TODO: Don't hard code in 1.4, use MAX_NIS_VALUE, but that #define is not defined in the scope of the particle filter
+     update.log("\nParticle Weights not updated because current NIS >= %f\n",NIS_WINDOW_LENGTH*1.4);
+     }*/
+    else{
+        for(int i = 0; i < nParticles; i++) {
+            this->weights[filterIndex].weights[i] *= update.measWeights[i] / sumWeights;
+            //TODO if inovations are too large, particle weights go nan.
+            //currMeasWeight was not nan for the particular failure I examined.
+            //sumWeights == 0.0
+
+            //						sumSquaresWeights += pow(this->weights[filterIndex].weights[i], 2);
+            //compute variance of measurement weights
+            update.measWeights[i] /= sumMeasWeights;
+            update.measVariance += pow(update.measWeights[i] - 1.0 / nParticles, 2) / nParticles;
+            if(saveDirectory != NULL) {
+                //logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"%.2f",update.measWeights[i]);
+                measWeightsText << update.measWeights[i] << "\t";
+            }
+        }
+    }
+    //effSampSize = 1.0 / sumSquaresWeights;
+
+    update.measWeightsText = measWeightsText.str();
+    return true;
+}
 
 void
 TNavBankFilter::
@@ -1215,7 +1333,6 @@ motionUpdate(poseT& currNavPose) {
     double cep;
     double driftStddev;
     double fractionProbMassAdjacent, fractionProbMassCorner, fractionProbMassRemaining;
-    double sumWeights;
 
     //Update each particle's position individually
     cep = (this->vehicle->driftRate / 100.0) * (sqrt(diffPose.x * diffPose.x + diffPose.y * diffPose.y));
@@ -1238,29 +1355,29 @@ motionUpdate(poseT& currNavPose) {
         motionUpdateParticle(allParticles[i], diffPose);//, velocity_sf_sigma, gyroStddev);
     }
 
-    for(int filterIndex = 0; filterIndex < this->numFilters; filterIndex++){
-        WeightArray tempWeights(this->nParticles);
-        sumWeights = 0;
+    //each filter blurs its own weights
+    filterPool->run(this->numFilters, 1, [&](int chunk, int begin, int end) {
+        for(int filterIndex = begin; filterIndex < end; filterIndex++){
+            WeightArray tempWeights(this->weights[filterIndex]);
+            double sumWeights = 0;
 
-        for(int i = 0; i < nParticles; i++) {
-            tempWeights.weights[i] = this->weights[filterIndex].weights[i];
-        }
-        for(int i = 0; i < nParticles; i++) {
-            this->weights[filterIndex].weights[i] = fractionProbMassRemaining * tempWeights[i] +
-            fractionProbMassAdjacent * tempWeights[i + this->PmfGridSize] +
-            fractionProbMassAdjacent * tempWeights[i - this->PmfGridSize] +
-            fractionProbMassAdjacent * tempWeights[i + 1] +
-            fractionProbMassAdjacent * tempWeights[i - 1] +
-            fractionProbMassCorner * tempWeights[i + (this->PmfGridSize + 1)] +
-            fractionProbMassCorner * tempWeights[i + (this->PmfGridSize - 1)] +
-            fractionProbMassCorner * tempWeights[i - (this->PmfGridSize + 1)] +
-            fractionProbMassCorner * tempWeights[i - (this->PmfGridSize - 1)];
-            sumWeights += this->weights[filterIndex].weights[i];
-        }
-        for(int i = 0; i < nParticles; i++) {
-            this->weights[filterIndex].weights[i] = this->weights[filterIndex].weights[i] / sumWeights;
+            for(int i = 0; i < nParticles; i++) {
+                this->weights[filterIndex].weights[i] = fractionProbMassRemaining * tempWeights[i] +
+                fractionProbMassAdjacent * tempWeights[i + this->PmfGridSize] +
+                fractionProbMassAdjacent * tempWeights[i - this->PmfGridSize] +
+                fractionProbMassAdjacent * tempWeights[i + 1] +
+                fractionProbMassAdjacent * tempWeights[i - 1] +
+                fractionProbMassCorner * tempWeights[i + (this->PmfGridSize + 1)] +
+                fractionProbMassCorner * tempWeights[i + (this->PmfGridSize - 1)] +
+                fractionProbMassCorner * tempWeights[i - (this->PmfGridSize + 1)] +
+                fractionProbMassCorner * tempWeights[i - (this->PmfGridSize - 1)];
+                sumWeights += this->weights[filterIndex].weights[i];
+            }
+            for(int i = 0; i < nParticles; i++) {
+                this->weights[filterIndex].weights[i] = this->weights[filterIndex].weights[i] / sumWeights;
+            }
         }
-    }
+    });
 
     //Apply attitude measurement update if integrating for phi/theta states
     if(INTEG_PHI_THETA) {
@@ -1826,6 +1943,7 @@ initVariables() {
         logs(TL_OMASK(TL_TNAV_BANK_FILTER, TL_LOG),"TNavBF::nParticles > MAX_NUM_FILTERS \n");
         this->numFilters = MAX_NUM_FILTERS;
     }
+    sizeWeightArrays();
 
 }
 
@@ -1840,6 +1958,8 @@ initParticleDist(const particleT& initialGuess) {
     //double tempX, tempY;
     fstream particleFile; //Used for loading particles from a specified file
 
+    sizeWeightArrays();
+
     /*
      tempCov.Row(1) << initWindowVar[0];
      tempCov.Row(2) << initWindowVar[1] << initWindowVar[2];
@@ -1951,10 +2071,6 @@ initParticleDist(const particleT& initialGuess) {
     }
 
     //set size for each weight array
-    for(int filterIndex = 0; filterIndex < this->numFilters; filterIndex++){
-        this->weights[filterIndex].size = this->nParticles;
-    }
-
     for(int filterIndex = 0; filterIndex < numFilters; filterIndex++){
         for(int i = 0; i < nParticles; i++) {
             //old this->allParticles[i].windowIndex = 0;
@@ -2124,8 +2240,8 @@ homerMeasUpdate(const measT& currMeas) {
 
 bool
 TNavBankFilter::
-treatBeamAsNan(int filterIndex, Matrix beamIF, const particleT &particle){
-    //printf("%f\t%f\t%f\n", beamIF(1,1), beamIF(2,1), beamIF(3,1));
+treatBeamAsNan(int filterIndex, double beamN, double beamE, const particleT &particle){
+    //printf("%f\t%f\n", beamN, beamE);
     switch(this->filterConfiguration){
         case 0: //1 filter
         case 1: //2 filter beam based
@@ -2135,10 +2251,10 @@ treatBeamAsNan(int filterIndex, Matrix beamIF, const particleT &particle){
 
 
         case 3: // 6x 20m overlapping stripes; 3 N-S, 3 E-W
-            return ((int)((10*filterIndex + beamIF(1,1) + particle.position[0]) * (filterIndex<3) + (10*filterIndex + beamIF(2,1) + particle.position[1]) * (filterIndex>=3)) % 30) >= 10;
+            return ((int)((10*filterIndex + beamN + particle.position[0]) * (filterIndex<3) + (10*filterIndex + beamE + particle.position[1]) * (filterIndex>=3)) % 30) >= 10;
             break;
         case 4:// 6x 10m non-overlapping stripes; 3 N-S, 3 E-W
-            return ((int)((10*filterIndex + beamIF(1,1) + particle.position[0]) * (filterIndex<3) + (10*filterIndex + beamIF(2,1) + particle.position[1]) * (filterIndex>=3)) % 30) < 10;
+            return ((int)((10*filterIndex + beamN + particle.position[0]) * (filterIndex<3) + (10*filterIndex + beamE + particle.position[1]) * (filterIndex>=3)) % 30) < 10;
             break;
         default:
             return false;
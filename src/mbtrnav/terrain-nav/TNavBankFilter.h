@@ -23,6 +23,7 @@
 #include <fstream>
 #include <iomanip>
 #include <time.h>
+#include <string>
 #include <vector>
 
 #include <newmatap.h>
@@ -35,6 +36,7 @@
 #include "structDefs.h"
 #include "myOutput.h"
 #include "trn_log.h"
+#include "TNavThreadPool.h"
 
 #include "TerrainMap.h"
 
@@ -70,20 +72,23 @@ I've tested with either 1 or 2. It doesn't have to be an int.
 #define MAX_NUM_FILTERS 12
 #define MAX_NUM_PARTICLES 10000
 
+#ifndef BF_FILTER_THREADS    //number of threads updating the filters of the
+#define BF_FILTER_THREADS 0  //bank concurrently (0 = number of cores)
+#endif
+
+//weights of the particles of one filter; reading outside [0, size) gives 0
 struct WeightArray{
 	int size;
-	double weights[MAX_NUM_PARTICLES];
-    explicit WeightArray(int isize)
-    :size(isize)
+	std::vector<double> weights;
+    explicit WeightArray(int isize = 0)
+    :size(isize), weights(isize, 0.)
     {
-        int i=0;
-        for(i=0;i<MAX_NUM_PARTICLES;i++)
-        weights[i]=0.;
     }
-	WeightArray():size(MAX_NUM_PARTICLES){
-        int i=0;
-        for(i=0;i<MAX_NUM_PARTICLES;i++)
-        weights[i]=0.;
+    //keeps the existing weights; new ones are 0
+    void resize(int isize)
+    {
+        size = isize;
+        weights.resize(isize, 0.);
     }
 	double operator[](int index);
 };
@@ -362,6 +367,25 @@ class TNavBankFilter : public TNavFilter
     double old = PmfGridResolution; PmfGridResolution = pgr; return old;
   }
 
+
+  /* Function: setNumThreads()
+   * Usage: setNumThreads(4)
+   * -------------------------------------------------------------------------*/
+  /*! Sets the number of threads used to update the filters of the bank in
+   * measUpdate and motionUpdate. A value of 0 uses one thread per core. Each
+   * filter is updated by a single thread, so more threads than filters are
+   * not used. Results do not depend on the number of threads.
+   */
+  void setNumThreads(int nThreads);
+
+
+  /* Function: getNumThreads()
+   * Usage: n = getNumThreads()
+   * -------------------------------------------------------------------------*/
+  /*! Returns the number of threads used to update the filters of the bank.
+   */
+  int getNumThreads() const { return filterPool->numThreads(); }
+
   //Public structures and components of a TNavBankFilter object:
   /*********************************************************/
   
@@ -573,7 +597,51 @@ class TNavBankFilter : public TNavFilter
    */
 		int defineAndLoadSubMap(const Matrix &beamsVF);
 
-  bool treatBeamAsNan(int filterIndex, Matrix beamIF, const particleT &particle);
+  bool treatBeamAsNan(int filterIndex, double beamN, double beamE, const particleT &particle);
+
+
+  /*!bfFilterUpdateT holds what one filter of the bank produces during
+   * measUpdate besides its own weights and depth bias: the log messages and
+   * the results that the filters used to write to shared members in turn.
+   * These are applied in filter order once all filters are done.*/
+  struct bfFilterUpdateT {
+    bool ok;                            //false if a squared error was NaN
+    std::vector<std::string> messages;  //log messages, in order
+    std::vector<double> measWeights;    //measurement weight of each particle
+    bool hasAlphas;                     //alphas computed (modified weighting)
+    double alphas[TRN_MAX_BEAMS];
+    bool hasNIS;                        //subcloudNIS computed
+    double subcloudNIS;
+    bool hasMeasVariance;               //measVariance computed
+    double measVariance;
+    std::string measWeightsText;        //this filter's part of measWeights.txt
+
+    void reset(int nParticles);
+    void log(const char* format, ...);  //logs() is not thread safe
+    void flushLog();
+  };
+
+
+  /* Function: measUpdateFilter
+   * Usage: ok = measUpdateFilter(filterIndex, currMeas, beamsVF, ...);
+   * -------------------------------------------------------------------------*/
+  /*! Updates the depth bias and particle weights of one filter of the bank
+   * with the projected beams of the current measurement, putting everything
+   * else it produces in filterUpdates[filterIndex]. Only reads the particles
+   * (unless contour matching), so different filters may be updated
+   * concurrently. Returns false if a particle's squared error is NaN.
+   */
+  bool measUpdateFilter(int filterIndex, const measT& currMeas, const Matrix& beamsVF,
+                        const Matrix& beamsIF, const int* beamIndices, double mapVar,
+                        int nBeamsUsed, bool test_beams);
+
+
+  /* Function: sizeWeightArrays
+   * Usage: sizeWeightArrays();
+   * -------------------------------------------------------------------------*/
+  /*! Sizes the weight arrays of the filters in use to nParticles.
+   */
+  void sizeWeightArrays();
 
     int deleteLogs();
     int allocateLogs();
@@ -618,8 +686,6 @@ class TNavBankFilter : public TNavFilter
   double w_slow;
   double w_fast;
   
-  //!array of current measurement weights (initialized when first measurement update is applied)
-  double currMeasWeights[MAX_PARTICLES];
 
   bool KruChanges_;
   
@@ -633,6 +699,8 @@ class TNavBankFilter : public TNavFilter
   int PmfGridSize;
   double PmfGridResolution;
   WeightArray weights[MAX_NUM_FILTERS];
+  bfFilterUpdateT filterUpdates[MAX_NUM_FILTERS];
+  TNavThreadPool* filterPool;
   double depthBias [MAX_NUM_FILTERS][MAX_NUM_PARTICLES];
   double depthBiasCov[MAX_NUM_FILTERS];
   
@@ -0,0 +1,265 @@
+/* FILENAME      : TNavFFT.cpp
+ * DATE          : 10/16/26
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ ******************************************************************************/
+
+#include "TNavFFT.h"
+
+#include <math.h>
+#include <complex>
+#include <vector>
+
+#ifdef WITH_FFTW
+#include <fftw3.h>
+#include <mutex>
+#endif
+
+typedef std::complex<double> cplx;
+
+// Time of one complex transform per element and per log2(length), relative
+// to a multiply-add of conv2. The built-in value was measured with
+// trn-pmfbench; FFTW is typically three to four times faster.
+#ifdef WITH_FFTW
+#define FFT_COST_FACTOR 0.5
+#else
+#define FFT_COST_FACTOR 1.8
+#endif
+
+#ifdef WITH_FFTW
+
+// The FFTW planner is not thread safe; plan execution is.
+static std::mutex fftwPlanMutex;
+
+// In place 2D transform of the rows x cols row-major array data. The inverse
+// transform is not scaled.
+static void fft2(std::vector<cplx>& data, int rows, int cols, bool inverse) {
+	fftw_complex* p = reinterpret_cast<fftw_complex*>(&data[0]);
+	fftw_plan plan;
+	{
+		std::lock_guard<std::mutex> lock(fftwPlanMutex);
+		plan = fftw_plan_dft_2d(rows, cols, p, p,
+					inverse ? FFTW_BACKWARD : FFTW_FORWARD,
+					FFTW_ESTIMATE);
+	}
+	fftw_execute(plan);
+	std::lock_guard<std::mutex> lock(fftwPlanMutex);
+	fftw_destroy_plan(plan);
+}
+
+#else
+
+// Twiddle factors exp(-+2*pi*i*k/n), k = 0..n/2-1, for a length n transform
+static void makeTwiddles(std::vector<cplx>& w, int n, bool inverse) {
+	double step = (inverse ? 2.0 : -2.0) * M_PI / n;
+	w.resize(n > 1 ? n / 2 : 1);
+	w[0] = 1.0;
+	for(int k = 1; k < n / 2; k++) {
+		w[k] = cplx(cos(step * k), sin(step * k));
+	}
+}
+
+// In place iterative radix-2 transform of n (a power of two) values
+static void fft1(cplx* x, int n, const cplx* w) {
+	//bit reversal permutation
+	for(int i = 1, j = 0; i < n; i++) {
+		int bit = n >> 1;
+		for(; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if(i < j) {
+			cplx t = x[i];
+			x[i] = x[j];
+			x[j] = t;
+		}
+	}
+
+	for(int len = 2; len <= n; len <<= 1) {
+		int half = len >> 1;
+		int step = n / len;
+		for(int i = 0; i < n; i += len) {
+			cplx* a = x + i;
+			cplx* b = x + i + half;
+			for(int k = 0; k < half; k++) {
+				//written out: std::complex multiplication checks for
+				//infinities and is not inlined at -O2
+				const cplx& wk = w[k * step];
+				double tr = wk.real() * b[k].real() - wk.imag() * b[k].imag();
+				double ti = wk.real() * b[k].imag() + wk.imag() * b[k].real();
+				b[k] = cplx(a[k].real() - tr, a[k].imag() - ti);
+				a[k] = cplx(a[k].real() + tr, a[k].imag() + ti);
+			}
+		}
+	}
+}
+
+// Number of columns transformed together, so that the column pass reads
+// whole cache lines of the row-major array
+#define FFT_COLUMN_BLOCK 8
+
+// In place 2D transform of the rows x cols row-major array data. The inverse
+// transform is not scaled.
+static void fft2(std::vector<cplx>& data, int rows, int cols, bool inverse) {
+	std::vector<cplx> w;
+
+	makeTwiddles(w, cols, inverse);
+	for(int r = 0; r < rows; r++) {
+		fft1(&data[r * cols], cols, &w[0]);
+	}
+
+	makeTwiddles(w, rows, inverse);
+	std::vector<cplx> block(FFT_COLUMN_BLOCK * rows);
+	for(int c0 = 0; c0 < cols; c0 += FFT_COLUMN_BLOCK) {
+		int nc = (cols - c0 < FFT_COLUMN_BLOCK) ? cols - c0 : FFT_COLUMN_BLOCK;
+		for(int r = 0; r < rows; r++) {
+			for(int k = 0; k < nc; k++) {
+				block[k * rows + r] = data[r * cols + c0 + k];
+			}
+		}
+		for(int k = 0; k < nc; k++) {
+			fft1(&block[k * rows], rows, &w[0]);
+		}
+		for(int r = 0; r < rows; r++) {
+			for(int k = 0; k < nc; k++) {
+				data[r * cols + c0 + k] = block[k * rows + r];
+			}
+		}
+	}
+}
+
+#endif
+
+int fftSize(int n) {
+	int size = 1;
+	while(size < n) {
+		size <<= 1;
+	}
+	return size;
+}
+
+double fftCost(int rows, int cols) {
+	double n = double(rows) * double(cols);
+	return FFT_COST_FACTOR * n * log2(n > 2 ? n : 2);
+}
+
+Matrix fftConv2(const Matrix& A, const Matrix& H) {
+	int aRows = A.Nrows();
+	int aCols = A.Ncols();
+	int hRows = H.Nrows();
+	int hCols = H.Ncols();
+	int hx = hRows / 2;
+	int hy = hCols / 2;
+	int P = fftSize(aRows + hRows - 1);
+	int Q = fftSize(aCols + hCols - 1);
+
+	//A goes in the real part and the flipped filter in the imaginary part of
+	//one complex array, so that a single forward transform serves both
+	std::vector<cplx> z(P * Q, cplx(0.0, 0.0));
+	for(int r = 0; r < aRows; r++) {
+		for(int c = 0; c < aCols; c++) {
+			z[r * Q + c] = A(r + 1, c + 1);
+		}
+	}
+	for(int h = 0; h < hRows; h++) {
+		for(int k = 0; k < hCols; k++) {
+			int idx = ((hx - h + P) % P) * Q + (hy - k + Q) % Q;
+			z[idx] += cplx(0.0, H(h + 1, k + 1));
+		}
+	}
+
+	fft2(z, P, Q, false);
+
+	//For real a and h with Z = FFT(a + i*h),
+	//FFT(a)*FFT(h) = (Z(k)^2 - conj(Z(-k))^2) / 4i
+	std::vector<cplx> y(P * Q);
+	for(int r = 0; r < P; r++) {
+		int rn = (P - r) % P;
+		for(int c = 0; c < Q; c++) {
+			cplx zk = z[r * Q + c];
+			cplx zm = conj(z[rn * Q + (Q - c) % Q]);
+			y[r * Q + c] = (zk * zk - zm * zm) * cplx(0.0, -0.25);
+		}
+	}
+
+	fft2(y, P, Q, true);
+
+	Matrix B(aRows, aCols);
+	double scale = 1.0 / (double(P) * double(Q));
+	for(int r = 0; r < aRows; r++) {
+		for(int c = 0; c < aCols; c++) {
+			B(r + 1, c + 1) = y[r * Q + c].real() * scale;
+		}
+	}
+	return B;
+}
+
+void fftCorrelationSums(const Matrix& A, int n, const int* rowOffsets,
+			const int* colOffsets, const double* weights,
+			const double* values, Matrix& sumError,
+			Matrix& sumSqError) {
+	int aRows = A.Nrows();
+	int aCols = A.Ncols();
+	int P = fftSize(aRows);
+	int Q = fftSize(aCols);
+
+	//Errors are formed relative to the mean of A, so that the squared error
+	//is not the small difference of large sums when A and values are depths
+	double ref = A.Sum() / (double(aRows) * double(aCols));
+
+	//a in the real part and a^2 in the imaginary part
+	std::vector<cplx> za(P * Q, cplx(0.0, 0.0));
+	for(int r = 0; r < aRows; r++) {
+		for(int c = 0; c < aCols; c++) {
+			double a = A(r + 1, c + 1) - ref;
+			za[r * Q + c] = cplx(a, a * a);
+		}
+	}
+
+	//The correlation sum_m w_m*a(i + r_m, j + c_m) is the convolution of a
+	//with a kernel holding w_m at (-r_m, -c_m). weights go in the real part
+	//and weights*values in the imaginary part of the kernel.
+	double sumWD = 0.0, sumWDsq = 0.0;
+	std::vector<cplx> zk(P * Q, cplx(0.0, 0.0));
+	for(int m = 0; m < n; m++) {
+		double d = values[m] - ref;
+		int idx = ((P - rowOffsets[m]) % P) * Q + (Q - colOffsets[m]) % Q;
+		zk[idx] += cplx(weights[m], weights[m] * d);
+		sumWD += weights[m] * d;
+		sumWDsq += weights[m] * d * d;
+	}
+
+	fft2(za, P, Q, false);
+	fft2(zk, P, Q, false);
+
+	//separate the two real kernels and multiply:
+	//y1 = FFT(a + i*a^2)*FFT(w)   -> sum w*a   + i*sum w*a^2
+	//y2 = FFT(a + i*a^2)*FFT(w*d) -> sum w*d*a (real part)
+	std::vector<cplx> y1(P * Q), y2(P * Q);
+	for(int r = 0; r < P; r++) {
+		int rn = (P - r) % P;
+		for(int c = 0; c < Q; c++) {
+			cplx zkk = zk[r * Q + c];
+			cplx zkm = conj(zk[rn * Q + (Q - c) % Q]);
+			cplx fw = (zkk + zkm) * 0.5;
+			cplx fwd = (zkk - zkm) * cplx(0.0, -0.5);
+			y1[r * Q + c] = za[r * Q + c] * fw;
+			y2[r * Q + c] = za[r * Q + c] * fwd;
+		}
+	}
+
+	fft2(y1, P, Q, true);
+	fft2(y2, P, Q, true);
+
+	double scale = 1.0 / (double(P) * double(Q));
+	for(int i = 0; i < sumError.Nrows(); i++) {
+		for(int j = 0; j < sumError.Ncols(); j++) {
+			double sumWA = y1[i * Q + j].real() * scale;
+			double sumWAsq = y1[i * Q + j].imag() * scale;
+			double sumWDA = y2[i * Q + j].real() * scale;
+			sumError(i + 1, j + 1) = sumWD - sumWA;
+			sumSqError(i + 1, j + 1) = sumWDsq - 2.0 * sumWDA + sumWAsq;
+		}
+	}
+}
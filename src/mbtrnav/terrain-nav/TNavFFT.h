@@ -0,0 +1,71 @@
+/* FILENAME      : TNavFFT.h
+ * DATE          : 10/16/26
+ * DESCRIPTION   : FFT based 2D convolution and shift correlation used by the
+ *                 point mass filter. A small built-in radix-2 FFT is used
+ *                 unless the library is built with WITH_FFTW, in which case
+ *                 the transforms are done by FFTW3. Both backends return the
+ *                 same results as the direct sums to within floating point
+ *                 rounding.
+ * DEPENDENCIES  : newmat; FFTW3 (optional)
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ *
+ ******************************************************************************/
+
+#ifndef _TNavFFT_h
+#define _TNavFFT_h
+
+#include <newmat.h>
+
+#ifdef use_namespace
+using namespace NEWMAT;
+#endif
+
+/* Function: fftSize(n)
+ * Usage: P = fftSize(numRows);
+ * -------------------------------------------------------------------------*/
+/*! Returns the transform length used for n samples (the smallest power of
+ * two >= n).
+ */
+int fftSize(int n);
+
+
+/* Function: fftCost(rows, cols)
+ * Usage: cost = fftCost(fftSize(rows), fftSize(cols));
+ * -------------------------------------------------------------------------*/
+/*! Estimates the time of one rows x cols complex transform in units of the
+ * multiply-adds of a direct sum over Matrix elements, so that callers can
+ * choose between the direct and FFT paths.
+ */
+double fftCost(int rows, int cols);
+
+
+/* Function: fftConv2(A, H)
+ * Usage: B = fftConv2(A, H);
+ * -------------------------------------------------------------------------*/
+/*! Computes the same filtered matrix as conv2(A, H) (see matrixArrayCalcs.h)
+ * using FFTs. The returned matrix B is the same size as A.
+ */
+Matrix fftConv2(const Matrix& A, const Matrix& H);
+
+
+/* Function: fftCorrelationSums(A, n, rowOffsets, colOffsets, weights, values,
+ *                              sumError, sumSqError)
+ * Usage: fftCorrelationSums(window, nBeams, r, c, w, z, sumErr, sumSqErr);
+ * -------------------------------------------------------------------------*/
+/*! For every shift (i,j) of the output matrices (0-based), computes the
+ * weighted error sums of n values against shifted elements of A:
+ *   e_m(i,j)         = values[m] - A(i + rowOffsets[m], j + colOffsets[m])
+ *   sumError(i,j)    = sum_m weights[m]*e_m(i,j)
+ *   sumSqError(i,j)  = sum_m weights[m]*e_m(i,j)^2
+ * sumError and sumSqError must already have the size of the shift grid, and
+ * every shifted element must lie within A (offsets >= 0 and
+ * offset + grid size <= size of A).
+ */
+void fftCorrelationSums(const Matrix& A, int n, const int* rowOffsets,
+			const int* colOffsets, const double* weights,
+			const double* values, Matrix& sumError,
+			Matrix& sumSqError);
+
+#endif
@@ -0,0 +1,122 @@
+/* FILENAME      : TNavKernels.cpp
+ * DATE          : 10/16/26
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ ******************************************************************************/
+
+#include "TNavKernels.h"
+
+// Select the widest double precision vector unit available at compile time.
+// Only separate add, subtract and multiply instructions are used (no fused
+// multiply-add) so the vector lanes round like the scalar tail loops.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TNAV_VLEN 4
+typedef __m256d vdouble;
+#define vload(p)     _mm256_loadu_pd(p)
+#define vstore(p, a) _mm256_storeu_pd(p, a)
+#define vset1(x)     _mm256_set1_pd(x)
+#define vadd(a, b)   _mm256_add_pd(a, b)
+#define vsub(a, b)   _mm256_sub_pd(a, b)
+#define vmul(a, b)   _mm256_mul_pd(a, b)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TNAV_VLEN 2
+typedef __m128d vdouble;
+#define vload(p)     _mm_loadu_pd(p)
+#define vstore(p, a) _mm_storeu_pd(p, a)
+#define vset1(x)     _mm_set1_pd(x)
+#define vadd(a, b)   _mm_add_pd(a, b)
+#define vsub(a, b)   _mm_sub_pd(a, b)
+#define vmul(a, b)   _mm_mul_pd(a, b)
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TNAV_VLEN 2
+typedef float64x2_t vdouble;
+#define vload(p)     vld1q_f64(p)
+#define vstore(p, a) vst1q_f64(p, a)
+#define vset1(x)     vdupq_n_f64(x)
+#define vadd(a, b)   vaddq_f64(a, b)
+#define vsub(a, b)   vsubq_f64(a, b)
+#define vmul(a, b)   vmulq_f64(a, b)
+#endif
+
+
+void projectBeams(int n, const double* north, const double* east,
+		  const double* down, const double* dir,
+		  double* beamN, double* beamE, double* beamZ) {
+	int k = 0;
+#ifdef TNAV_VLEN
+	vdouble dN = vset1(dir[0]);
+	vdouble dE = vset1(dir[1]);
+	vdouble dZ = vset1(dir[2]);
+	for(; k + TNAV_VLEN <= n; k += TNAV_VLEN) {
+		vstore(beamN + k, vadd(vload(north + k), dN));
+		vstore(beamE + k, vadd(vload(east + k), dE));
+		vstore(beamZ + k, vadd(vload(down + k), dZ));
+	}
+#endif
+	for(; k < n; k++) {
+		beamN[k] = north[k] + dir[0];
+		beamE[k] = east[k] + dir[1];
+		beamZ[k] = down[k] + dir[2];
+	}
+}
+
+//********************************************************************************
+
+void accumBeamErrors(int n, const double* diff, double invVar,
+		     double* sumWeightedError, double* sumSquaredError) {
+	int k = 0;
+#ifdef TNAV_VLEN
+	vdouble w = vset1(invVar);
+	for(; k + TNAV_VLEN <= n; k += TNAV_VLEN) {
+		vdouble d = vload(diff + k);
+		vstore(sumWeightedError + k, vadd(vload(sumWeightedError + k), vmul(w, d)));
+		vstore(sumSquaredError + k, vadd(vload(sumSquaredError + k), vmul(w, vmul(d, d))));
+	}
+#endif
+	for(; k < n; k++) {
+		sumWeightedError[k] += invVar * diff[k];
+		sumSquaredError[k] += invVar * (diff[k] * diff[k]);
+	}
+}
+
+//********************************************************************************
+
+void gaussianLogLikelihoods(int n, const double* sumSquaredError,
+			    const double* sumWeightedError, double invSumInvVar,
+			    bool removeBias, double* depthBias,
+			    double* logLikelihood) {
+	int k = 0;
+	if(removeBias) {
+#ifdef TNAV_VLEN
+		vdouble s = vset1(invSumInvVar);
+		vdouble h = vset1(-0.5);
+		for(; k + TNAV_VLEN <= n; k += TNAV_VLEN) {
+			vdouble swe = vload(sumWeightedError + k);
+			vdouble bias = vmul(s, swe);
+			vstore(depthBias + k, bias);
+			vstore(logLikelihood + k, vmul(h, vsub(vload(sumSquaredError + k), vmul(bias, swe))));
+		}
+#endif
+		for(; k < n; k++) {
+			depthBias[k] = invSumInvVar * sumWeightedError[k];
+			logLikelihood[k] = -0.5 * (sumSquaredError[k] - depthBias[k] * sumWeightedError[k]);
+		}
+	} else {
+#ifdef TNAV_VLEN
+		vdouble z = vset1(0.);
+		vdouble h = vset1(-0.5);
+		for(; k + TNAV_VLEN <= n; k += TNAV_VLEN) {
+			vstore(depthBias + k, z);
+			vstore(logLikelihood + k, vmul(h, vload(sumSquaredError + k)));
+		}
+#endif
+		for(; k < n; k++) {
+			depthBias[k] = 0.;
+			logLikelihood[k] = -0.5 * sumSquaredError[k];
+		}
+	}
+}
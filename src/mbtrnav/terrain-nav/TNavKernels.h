@@ -0,0 +1,59 @@
+/* FILENAME      : TNavKernels.h
+ * DATE          : 10/16/26
+ * DESCRIPTION   : Vector kernels used by the particle filter measurement
+ *                 update. They operate on structure-of-arrays particle data
+ *                 (one contiguous array per quantity) so that several particles
+ *                 are handled per instruction. AVX is used when the library is
+ *                 built with it enabled (e.g. -mavx2), SSE2 on other x86_64
+ *                 builds and NEON on aarch64; otherwise plain loops are used.
+ *                 Every lane performs the same operations in the same order
+ *                 as the scalar code, so results do not depend on the path.
+ * DEPENDENCIES  : none
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ *
+ ******************************************************************************/
+
+#ifndef _TNavKernels_h
+#define _TNavKernels_h
+
+/* Function: projectBeams(n, north, east, down, dir, beamN, beamE, beamZ)
+ * Usage: projectBeams(nParticles, north, east, down, beamVector, bN, bE, bZ);
+ * -------------------------------------------------------------------------*/
+/*! Computes the end points of one beam vector dir (N,E,D) applied to n
+ * positions: beamN[k] = north[k] + dir[0], and so on.
+ */
+void projectBeams(int n, const double* north, const double* east,
+		  const double* down, const double* dir,
+		  double* beamN, double* beamE, double* beamZ);
+
+
+/* Function: accumBeamErrors(n, diff, invVar, sumWeightedError, sumSquaredError)
+ * Usage: accumBeamErrors(nParticles, diffs, 1.0/var, swe, sse);
+ * -------------------------------------------------------------------------*/
+/*! Adds one beam's contribution to the per-particle error sums:
+ * sumWeightedError[k] += invVar*diff[k] and
+ * sumSquaredError[k] += invVar*(diff[k]*diff[k]).
+ */
+void accumBeamErrors(int n, const double* diff, double invVar,
+		     double* sumWeightedError, double* sumSquaredError);
+
+
+/* Function: gaussianLogLikelihoods(n, sse, swe, invSumInvVar, removeBias,
+ *                                  depthBias, logLikelihood)
+ * Usage: gaussianLogLikelihoods(nParticles, sse, swe, 1.0/sumInvVar, true,
+ *                               bias, ll);
+ * -------------------------------------------------------------------------*/
+/*! Computes the Gaussian measurement log-likelihood of n particles from their
+ * error sums. If removeBias is set, the weighted mean error
+ * depthBias[k] = invSumInvVar*swe[k] is removed first (contour matching) and
+ * logLikelihood[k] = -0.5*(sse[k] - depthBias[k]*swe[k]); otherwise
+ * depthBias[k] = 0 and logLikelihood[k] = -0.5*sse[k].
+ */
+void gaussianLogLikelihoods(int n, const double* sumSquaredError,
+			    const double* sumWeightedError, double invSumInvVar,
+			    bool removeBias, double* depthBias,
+			    double* logLikelihood);
+
+#endif
@@ -12,6 +12,7 @@
 #include "TNavConfig.h"
 #include "TNavParticleFilter.h"
 #include "TNavPFLog.h"
+#include "TNavKernels.h"
 #include "mapio.h"
 
 #define MAX_CROSS_BEAM_COMPARISONS  5
@@ -32,11 +33,17 @@ navData_x_(0.), navData_y_(0.)
     int i=0;
     for(i=0;i<MAX_PARTICLES;i++){
         currMeasWeights[i]=0.0;
+        measDepthBias[i]=0.0;
     }
+	maxParticles = MAX_PARTICLES;
 	initVariables();
 	this->tempUseBeam = new bool[TRN_MAX_BEAMS];
 	this->useBeam     = new bool[TRN_MAX_BEAMS];
 	this->pfLog = new TNavPFLog(DataLog::BinaryFormat);
+	this->measPool = new TNavThreadPool(PF_MEAS_THREADS);
+	this->measChunks.resize(measPool->numThreads());
+	this->measSoA = new pfParticleSoAT;
+	this->measSoA->stride = 0;
 }
 
 
@@ -54,6 +61,8 @@ TNavParticleFilter::
 	delete [] tempUseBeam;
 	delete [] useBeam;
   delete pfLog;
+	delete measPool;
+	delete measSoA;
 }
 
 //********************************************************************************
@@ -108,7 +117,6 @@ measUpdate(measT& currMeas) {
 	printf("Forcing Subcloud in PF\n");
 	*/
 	Matrix beamsVF(3, currMeas.numMeas);
-	Matrix tempBeamsVF(3, currMeas.numMeas);
 	int beamIndices[currMeas.numMeas];  //beamsVF to currMeas index correspondence
 	double sumSquaresWeights = 0;
 	double sumWeights = 0;
@@ -193,85 +201,79 @@ measUpdate(measT& currMeas) {
 					beamsVF = applyRotation(attitude, beamsVF);
 				}
 			}
-			//
-			// Only used when searching psi berg.
-			tempBeamsVF = beamsVF;
-			double tempAttitude[3];
-
-			//Get the expected measurement differences
+			//Get the expected measurement differences. The particles are split
+			//into contiguous blocks that are handled in parallel, each with its
+			//own scratch space. The per-block results are combined in block
+			//order so the outcome does not depend on the number of threads.
 			for(i=0; i < currMeas.numMeas && i < TRN_MAX_BEAMS; i++ )
 			{
 				this->useBeam[i]=true;
 			}
-			for(i = 0; i < nParticles; i++) {
-				if(!ALLOW_ATTITUDE_SEARCH && SEARCH_PSI_BERG)
-				{
-					//
-					// tempBeamsVF stores beamsVF so that each particle does its own rotation.
-					tempAttitude[0] = attitude[0];
-					tempAttitude[1] = attitude[1];
-					tempAttitude[2] = attitude[2] - allParticles[i].psiBerg;
-
-					beamsVF = applyRotation(tempAttitude, tempBeamsVF);
+			int nChunks = measPool->numChunks(nParticles, PF_MIN_PARTICLES_PER_THREAD);
+			for(int chunk = 0; chunk < nChunks; chunk++) {
+				measChunks[chunk].mapVar = mapVar;
+				measChunks[chunk].nBeamsUsed = 0;
+				measChunks[chunk].badParticle = -1;
+				for(int indx = 0; indx < beamsVF.Ncols(); indx++) {
+					measChunks[chunk].useBeam[indx] = true;
 				}
-				//Edit to allow using only one beam from a measurement
-				// sets this->tempUseBeam
-
-
-				getExpectedMeasDiffParticle(allParticles[i], beamsVF, currMeas.ranges, beamIndices, mapVar);
-
+			}
+			measSoA->stride = nParticles;
+			if(measSoA->measDiff.size() < (size_t)beamsVF.Ncols() * nParticles) {
+				measSoA->measDiff.resize((size_t)beamsVF.Ncols() * nParticles);
+			}
+			const int* beamIndicesP = beamIndices;
+			measPool->run(nParticles, PF_MIN_PARTICLES_PER_THREAD,
+				[&](int chunk, int begin, int end) {
+					getExpectedMeasDiffChunk(chunk, begin, end, beamsVF, attitude,
+						currMeas.ranges, beamIndicesP);
+				});
+
+			int badParticle = -1;
+			for(int chunk = 0; chunk < nChunks; chunk++) {
 				for( int indx=0; indx < beamsVF.Ncols(); indx++ )
 				{
-					this->useBeam[indx] = this->useBeam[indx] && this->tempUseBeam[indx];
+					this->useBeam[indx] = this->useBeam[indx] && measChunks[chunk].useBeam[indx];
 				}
-
-				//
-				// Check for this particular particle:
-				nBeamsUsed = 0;
-				for(int j = 0; j < beamsVF.Ncols(); j++) {
-					if(this->tempUseBeam[j]){
-						nBeamsUsed++;
-					}
+				//mapVar and the beam count come from the last particle processed
+				mapVar = measChunks[chunk].mapVar;
+				nBeamsUsed = measChunks[chunk].nBeamsUsed;
+				if(measChunks[chunk].badParticle >= 0) {
+					badParticle = measChunks[chunk].badParticle;
+					break;
 				}
+			}
 
-				pfLog->setUsedBeams(nBeamsUsed);
-
-				bool atLeastOneBeamGood = nBeamsUsed > 0;
-
-				//if(!getExpectedMeasDiffParticle(allParticles[i], beamsVF, currMeas.ranges, beamIndices, mapVar)) {
-				//if any of the measurement projections fail due to falling in NaN region of map!
-
+			pfLog->setUsedBeams(nBeamsUsed);
 
-				//if(!atLeastOneBeamGood && !USE_SUBCLOUD_COMPARISON){
-				if(!atLeastOneBeamGood && (TRN_WT_SUBCL != this->useModifiedWeighting  && TRN_FORCE_SUBCL != this->useModifiedWeighting)){
-					//none of the beams was good for this particular particle.
-					logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
-						"TNavPF::Measurement from time = %.2f sec. not included.",currMeas.time);
-					//"encountered NaN values in the correlation map segment for all beams on one particle.\n",
-					logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
-						"Particle[%d] has NaN for all beam ranges, with roll = %.1f, "
-						"pitch = %.1f, yaw = %.1f degrees.\n",
-						i, allParticles[i].attitude[0]*180./PI,
-						allParticles[i].attitude[1]*180./PI,
-						allParticles[i].attitude[2]*180./PI);
-					logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
-						"x = %.1f, y = %.1f z = %.1f.\n",
-						allParticles[i].position[0],
-						allParticles[i].position[1],
-						allParticles[i].position[2]);
-					logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
-						"[ %.1f  %.1f  %.1f  %.3f  %.3f  %.3f];\n",
-						allParticles[i].position[0],
-						allParticles[i].position[1],
-						allParticles[i].position[2],
-						allParticles[i].attitude[0],
-						allParticles[i].attitude[1],
-						allParticles[i].attitude[2]);
-					return false;
-				}
-				// release resources allocated in call to
-				// getExpectedMeasDiffParticle(), above
-				//if( (i+1) != nParticles) delete [] useBeam;
+			//if(!USE_SUBCLOUD_COMPARISON), a particle with no good beams
+			//stops the update
+			if(badParticle >= 0) {
+				i = badParticle;
+				//none of the beams was good for this particular particle.
+				logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
+					"TNavPF::Measurement from time = %.2f sec. not included.",currMeas.time);
+				//"encountered NaN values in the correlation map segment for all beams on one particle.\n",
+				logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
+					"Particle[%d] has NaN for all beam ranges, with roll = %.1f, "
+					"pitch = %.1f, yaw = %.1f degrees.\n",
+					i, allParticles[i].attitude[0]*180./PI,
+					allParticles[i].attitude[1]*180./PI,
+					allParticles[i].attitude[2]*180./PI);
+				logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
+					"x = %.1f, y = %.1f z = %.1f.\n",
+					allParticles[i].position[0],
+					allParticles[i].position[1],
+					allParticles[i].position[2]);
+				logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),
+					"[ %.1f  %.1f  %.1f  %.3f  %.3f  %.3f];\n",
+					allParticles[i].position[0],
+					allParticles[i].position[1],
+					allParticles[i].position[2],
+					allParticles[i].attitude[0],
+					allParticles[i].attitude[1],
+					allParticles[i].attitude[2]);
+				return false;
 			}
 
 			bool temp = false;
@@ -706,63 +708,57 @@ measUpdate(measT& currMeas) {
 
 			//Loop through & compute measurement update weights for all particles
 			double sumSquaredError = 0.;
-			double sumWeightedError = 0.;
-			double sumInvVar = 0.;
-			double currDepthBias = 0.;
 
 //		TODO: Beam Variance can be computed ahead of time (implement later)
 //		for (int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) sumInvVar += (1.0/(totalVar[beamInd]));
 
-			for(i = 0; i < nParticles; i++) {
-				sumSquaredError = 0.;
-				sumWeightedError = 0.;
-				sumInvVar = 0.;
-
-				currMeasWeights[i] = 1;
-
-				for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
-					if(this->useBeam[beamInd]){	//edit to allow using any good beams from measurement
-
-						//As we already have the expected measurement difference, just apply the measurement model to it
-						sumWeightedError += (1.0 / (totalVar[beamInd])) * allParticles[i].expectedMeasDiff[beamInd]; //Weighted mean error
-						sumSquaredError += (1.0 / (totalVar[beamInd])) * pow(allParticles[i].expectedMeasDiff[beamInd], 2); //Weighted Squared Error
-						sumInvVar += (1.0 / (totalVar[beamInd]));		//Beam Variance
-						//					logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:totalVar[%i] is %f\n",beamInd,totalVar[beamInd]);
-						if(ISNIN(sumSquaredError))
-						{
-							logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:Sum of squared error for particle %i beam %i is nan \n", i, beamInd);
-
-						  pfLog->write();
-
-							return false;
-							//		     logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:totalVar[%i] is %f\n",beamInd,totalVar[beamInd]);
-							//		     logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:expectedMeasDiff[%i] is %f \n",beamInd,allParticles[i].expectedMeasDiff[beamInd]);
-						}
-					}
+			//The measurement model is applied to each particle in parallel.
+			//The contour matching depth biases and the weight sums are then
+			//applied in particle order.
+			for(int chunk = 0; chunk < nChunks; chunk++) {
+				measChunks[chunk].badParticle = -1;
+				measChunks[chunk].badBeam = -1;
+				measChunks[chunk].sumSquaredError = 0.;
+			}
+			const double* totalVarP = totalVar;
+			measPool->run(nParticles, PF_MIN_PARTICLES_PER_THREAD,
+				[&](int chunk, int begin, int end) {
+					computeMeasWeightsChunk(chunk, begin, end, beamsVF.Ncols(), totalVarP);
+				});
+
+			int nWeighted = nParticles;
+			int badBeam = -1;
+			for(int chunk = 0; chunk < nChunks; chunk++) {
+				sumSquaredError = measChunks[chunk].sumSquaredError;
+				if(measChunks[chunk].badParticle >= 0) {
+					nWeighted = measChunks[chunk].badParticle;
+					badBeam = measChunks[chunk].badBeam;
+					break;
 				}
+			}
 
-				//Compute new measurement weight
+			for(i = 0; i < nWeighted; i++) {
 				if(USE_CONTOUR_MATCHING && !USE_RANGE_CORR) {
-					currDepthBias = (1.0 / sumInvVar) * sumWeightedError;
-					allParticles[i].position[2] -= currDepthBias;
+					allParticles[i].position[2] -= measDepthBias[i];
 					for(int beamInd = 0; beamInd < beamsVF.Ncols(); beamInd++) {
 						if(this->useBeam[beamInd]){	//edit to allow using any good beams from measurement
-							allParticles[i].expectedMeasDiff[beamInd] -= currDepthBias;
+							allParticles[i].expectedMeasDiff[beamInd] -= measDepthBias[i];
 						}
 					}
-
-					//calculate likelihood equation.
-					//currMeasWeights[i] = exp(-0.5*(sumSquaredError-2*currDepthBias*sumWeightedError+pow(currDepthBias,2)*sumInvVar));
-					currMeasWeights[i] = exp(-0.5 * (sumSquaredError - currDepthBias * sumWeightedError));
-					//newWeight *= exp(-0.5*(currDepthBias*currDepthBias));
-				} else {
-					currMeasWeights[i] = exp(-0.5 * sumSquaredError);
 				}
 
 				sumWeights += allParticles[i].weight * currMeasWeights[i];
 				sumMeasWeights += currMeasWeights[i];
 			}
 
+			if(badBeam >= 0) {
+				logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:Sum of squared error for particle %i beam %i is nan \n", nWeighted, badBeam);
+
+				pfLog->write();
+
+				return false;
+			}
+
 			logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:: sumSquaredError = %f \n", sumSquaredError);
 			logs(TL_OMASK(TL_TNAV_PARTICLE_FILTER, TL_LOG),"TNavPF:: sumWeights = %f \n", sumWeights);
 
@@ -1252,7 +1248,7 @@ initVariables() {
 	resampParticles = particleArray2;
 
 	//The particle filter will start out with the maximum number of particles
-	nParticles = MAX_PARTICLES;
+	nParticles = maxParticles;
 
 	//Initialize counter for soundings used in correlation
 	nSoundings = 0;
@@ -1343,8 +1339,8 @@ initParticleDist(const particleT& initialGuess) {
 			//Read the number of particles in the file
 			particleFile.getline(temp,10); //First line is the total number of particles in the file
 			nParticles = atoi(temp);
-			if(nParticles > MAX_PARTICLES){
-				nParticles = MAX_PARTICLES;
+			if(nParticles > maxParticles){
+				nParticles = maxParticles;
 			}
 
 			//Read the number of states the file is giving
@@ -1636,6 +1632,13 @@ homerMeasUpdate(const measT& currMeas) {
 bool
 TNavParticleFilter::
 getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, double* beamRanges, const int* beamIndices, double& mapVar) {
+	return getExpectedMeasDiffParticle(particle, beamsSF, beamRanges, beamIndices, mapVar, this->tempUseBeam);
+}
+
+bool
+TNavParticleFilter::
+getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, double* beamRanges, const int* beamIndices, double& mapVar,
+	bool* particleUseBeam) {
 //Update Expected Measurement Differences
 // This function takes in a particle (particle) and the beams in the ??? frame
 // (beamsSF), and the ranges (beamRanges)
@@ -1645,7 +1648,7 @@ getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, double*
 // ray tracing (USE_RANGE_CORR) or the standard projection method (NOTHING SELECTED)
 //
 // It also outputs the map variance (mapVar) that is also later used with particle
-// weighting
+// weighting, and flags the beams usable for this particle in particleUseBeam
 
 
 	int i;
@@ -1704,7 +1707,7 @@ getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, double*
 		// if(isnan(tempExpectedMeasDiff[i])){
 		if(ISNIN(tempExpectedMeasDiff[i])){
 			//tempExpectedMeasDiff[i] = 0;
-			this->tempUseBeam[i] = false; //beam hit map hole or missed -> don't use this beam to compare particles
+			particleUseBeam[i] = false; //beam hit map hole or missed -> don't use this beam to compare particles
 			/*if(!USE_MAP_NAN){
 				return false;
 			}
@@ -1712,7 +1715,7 @@ getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, double*
 		}
 		else
 		{
-			this->tempUseBeam[i] = true;
+			particleUseBeam[i] = true;
 			goodBeams = true;            // OK, at least one beam is good
 		}
 
@@ -1724,6 +1727,187 @@ getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, double*
 
 //********************************************************************************
 
+void
+TNavParticleFilter::
+getExpectedMeasDiffChunk(int chunk, int begin, int end, const Matrix& beamsVF,
+	const double* attitude, double* beamRanges, const int* beamIndices) {
+	pfMeasChunkT& mc = measChunks[chunk];
+	bool stopOnBadParticle = (TRN_WT_SUBCL != this->useModifiedWeighting &&
+		TRN_FORCE_SUBCL != this->useModifiedWeighting);
+	int nBeams = beamsVF.Ncols();
+	int stride = measSoA->stride;
+	double* measDiff = measSoA->measDiff.data();
+
+	if(!SEARCH_ALIGN_STATE && !ALLOW_ATTITUDE_SEARCH && !SEARCH_PSI_BERG) {
+		//Every particle sees the same beam directions, so the differences
+		//are computed one beam at a time for the whole block of particles.
+		for(int i = begin; i < end; i++) {
+			measSoA->north[i] = allParticles[i].position[0];
+			measSoA->east[i] = allParticles[i].position[1];
+			measSoA->down[i] = allParticles[i].position[2];
+		}
+
+		double beamVector[3];
+		for(int j = 0; j < nBeams; j++) {
+			beamVector[0] = beamsVF(1, j + 1);
+			beamVector[1] = beamsVF(2, j + 1);
+			beamVector[2] = beamsVF(3, j + 1);
+			terrainMap->GetRangeErrors(mc.mapVar, end - begin, measSoA->north + begin,
+				measSoA->east + begin, measSoA->down + begin, beamVector,
+				beamRanges[beamIndices[j]], measDiff + (size_t)j * stride + begin);
+		}
+
+		for(int i = begin; i < end; i++) {
+			std::vector<double>& diff = allParticles[i].expectedMeasDiff;
+			diff.resize(nBeams);
+			mc.nBeamsUsed = 0;
+			for(int j = 0; j < nBeams; j++) {
+				diff[j] = measDiff[(size_t)j * stride + i];
+				bool good = !ISNIN(diff[j]);
+				mc.useBeam[j] = mc.useBeam[j] && good;
+				if(good) {
+					mc.nBeamsUsed++;
+				}
+			}
+
+			if(mc.nBeamsUsed == 0 && stopOnBadParticle) {
+				mc.badParticle = i;
+				return;
+			}
+		}
+		return;
+	}
+
+	Matrix beamsBerg;
+	double tempAttitude[3];
+
+	for(int i = begin; i < end; i++) {
+		const Matrix* beams = &beamsVF;
+		if(!ALLOW_ATTITUDE_SEARCH && SEARCH_PSI_BERG)
+		{
+			//
+			// Each particle does its own rotation when searching psi berg.
+			tempAttitude[0] = attitude[0];
+			tempAttitude[1] = attitude[1];
+			tempAttitude[2] = attitude[2] - allParticles[i].psiBerg;
+
+			beamsBerg = applyRotation(tempAttitude, beamsVF);
+			beams = &beamsBerg;
+		}
+
+		getExpectedMeasDiffParticle(allParticles[i], *beams, beamRanges, beamIndices, mc.mapVar, mc.tempUseBeam);
+
+		mc.nBeamsUsed = 0;
+		for(int j = 0; j < nBeams; j++) {
+			measDiff[(size_t)j * stride + i] = allParticles[i].expectedMeasDiff[j];
+			mc.useBeam[j] = mc.useBeam[j] && mc.tempUseBeam[j];
+			if(mc.tempUseBeam[j]) {
+				mc.nBeamsUsed++;
+			}
+		}
+
+		if(mc.nBeamsUsed == 0 && stopOnBadParticle) {
+			mc.badParticle = i;
+			return;
+		}
+	}
+}
+
+//********************************************************************************
+
+void
+TNavParticleFilter::
+computeMeasWeightsChunk(int chunk, int begin, int end, int nBeams, const double* totalVar) {
+	pfMeasChunkT& mc = measChunks[chunk];
+	int stride = measSoA->stride;
+	const double* measDiff = measSoA->measDiff.data();
+	double* sumWeightedError = measSoA->sumWeightedError;
+	double* sumSquaredError = measSoA->sumSquaredError;
+	double sumInvVar = 0.;
+
+	for(int i = begin; i < end; i++) {
+		sumWeightedError[i] = 0.;
+		sumSquaredError[i] = 0.;
+	}
+
+	//Accumulate the weighted errors beam by beam over the block
+	for(int beamInd = 0; beamInd < nBeams; beamInd++) {
+		if(this->useBeam[beamInd]){	//edit to allow using any good beams from measurement
+			double invVar = 1.0 / (totalVar[beamInd]);
+			accumBeamErrors(end - begin, measDiff + (size_t)beamInd * stride + begin, invVar,
+				sumWeightedError + begin, sumSquaredError + begin);
+			sumInvVar += invVar;		//Beam Variance
+		}
+	}
+
+	//NaN errors stay NaN, so only the final sums need checking
+	int nGood = end - begin;
+	for(int i = begin; i < end; i++) {
+		if(ISNIN(sumSquaredError[i])) {
+			nGood = i - begin;
+			break;
+		}
+	}
+
+	//Compute new measurement weights. The depth bias is removed from the
+	//particles by measUpdate once all weights are known.
+	gaussianLogLikelihoods(nGood, sumSquaredError + begin, sumWeightedError + begin,
+		1.0 / sumInvVar, USE_CONTOUR_MATCHING && !USE_RANGE_CORR,
+		measDepthBias + begin, measSoA->logLikelihood + begin);
+	for(int i = begin; i < begin + nGood; i++) {
+		currMeasWeights[i] = exp(measSoA->logLikelihood[i]);
+	}
+
+	if(nGood < end - begin) {
+		//find the beam that made the sum NaN
+		int i = begin + nGood;
+		double sse = 0.;
+		currMeasWeights[i] = 1;
+		measDepthBias[i] = 0.;
+		for(int beamInd = 0; beamInd < nBeams; beamInd++) {
+			if(this->useBeam[beamInd]) {
+				double d = measDiff[(size_t)beamInd * stride + i];
+				sse += (1.0 / (totalVar[beamInd])) * (d * d);
+				if(ISNIN(sse)) {
+					mc.badBeam = beamInd;
+					break;
+				}
+			}
+		}
+		mc.badParticle = i;
+		mc.sumSquaredError = sse;
+		return;
+	}
+	mc.sumSquaredError = sumSquaredError[end - 1];
+}
+
+//********************************************************************************
+
+void
+TNavParticleFilter::
+setNumThreads(int nThreads) {
+	delete measPool;
+	measPool = new TNavThreadPool(nThreads);
+	measChunks.resize(measPool->numThreads());
+}
+
+//********************************************************************************
+
+void
+TNavParticleFilter::
+setNumParticles(int nParticles) {
+	if(nParticles < 1) {
+		nParticles = 1;
+	}
+	if(nParticles > MAX_PARTICLES) {
+		nParticles = MAX_PARTICLES;
+	}
+	this->maxParticles = nParticles;
+	this->nParticles = nParticles;
+}
+
+//********************************************************************************
+
 // Assume that diffPose is inertially referenced.  diffPose.psi is inertial heading change.
 
 void
@@ -29,6 +29,7 @@
 #include "TerrainMap.h"
 #include "MathP.h"
 #include "TNavPFLog.h"
+#include "TNavThreadPool.h"
 
 #include <newmatap.h>
 #include <newmatio.h>
@@ -219,6 +220,9 @@ class TNavParticleFilter : public TNavFilter
    */
 	bool getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF, 
 								double* beamRanges, const int* beamIndices, double& mapVar);
+	bool getExpectedMeasDiffParticle(particleT& particle, const Matrix& beamsSF,
+								double* beamRanges, const int* beamIndices, double& mapVar,
+								bool* particleUseBeam);
 
 
   /* Function: motionUpdate
@@ -286,6 +290,34 @@ class TNavParticleFilter : public TNavFilter
   void saveCurrParticles(ofstream &outputFile);
 
 
+  /* Function: setNumThreads()
+   * Usage: setNumThreads(4)
+   * -------------------------------------------------------------------------*/
+  /*! Sets the number of threads used to compute the expected measurement
+   * differences and measurement weights of the particles in measUpdate.
+   * A value of 0 uses one thread per core. Results do not depend on the
+   * number of threads.
+   */
+  void setNumThreads(int nThreads);
+
+
+  /* Function: getNumThreads()
+   * Usage: n = getNumThreads()
+   * -------------------------------------------------------------------------*/
+  /*! Returns the number of threads used by measUpdate.
+   */
+  int getNumThreads() const { return measPool->numThreads(); }
+
+
+  /* Function: setNumParticles()
+   * Usage: setNumParticles(2500)
+   * -------------------------------------------------------------------------*/
+  /*! Limits the number of particles to nParticles (at most MAX_PARTICLES).
+   * Takes effect the next time the particle distribution is initialized.
+   */
+  void setNumParticles(int nParticles);
+
+
   //Public structures and components of a TNavParticleFilter object:
   /*********************************************************/
   
@@ -331,6 +363,59 @@ class TNavParticleFilter : public TNavFilter
   bool homerMeasUpdate(const measT& currMeas);
 
 
+  /*!pfMeasChunkT holds the scratch space and partial results of one block of
+   * particles processed by a measUpdate thread.*/
+  struct pfMeasChunkT {
+    bool tempUseBeam[TRN_MAX_BEAMS];  //good beams for the current particle
+    bool useBeam[TRN_MAX_BEAMS];      //beams good for every particle in the block
+    double mapVar;                    //map variance after the last particle
+    int nBeamsUsed;                   //good beams for the last particle done
+    int badParticle;                  //first particle with NaN results or -1
+    int badBeam;                      //beam giving a NaN squared error or -1
+    double sumSquaredError;           //squared error of the last particle
+  };
+
+
+  /*!pfParticleSoAT holds the particle quantities used by the measurement
+   * update as structure-of-arrays, one contiguous array per quantity, so the
+   * range and likelihood kernels can process several particles at a time.
+   * Positions are gathered from allParticles at the start of each update.*/
+  struct pfParticleSoAT {
+    double north[MAX_PARTICLES];            //particle N position
+    double east[MAX_PARTICLES];             //particle E position
+    double down[MAX_PARTICLES];             //particle D position
+    double sumWeightedError[MAX_PARTICLES]; //inverse variance weighted error
+    double sumSquaredError[MAX_PARTICLES];  //inverse variance weighted squared error
+    double logLikelihood[MAX_PARTICLES];    //measurement log-likelihood
+    std::vector<double> measDiff;           //expected measurement differences,
+                                            //measDiff[beam*stride + particle]
+    int stride;                             //particles per beam row of measDiff
+  };
+
+
+  /* Function: getExpectedMeasDiffChunk
+   * Usage: getExpectedMeasDiffChunk(chunk, begin, end, ...);
+   * -------------------------------------------------------------------------*/
+  /*! Computes the expected measurement differences of particles [begin, end)
+   * into measChunks[chunk]. Stops at the first particle for which no beam can
+   * be used unless subcloud weighting is enabled.
+   */
+  void getExpectedMeasDiffChunk(int chunk, int begin, int end,
+				const Matrix& beamsVF, const double* attitude,
+				double* beamRanges, const int* beamIndices);
+
+
+  /* Function: computeMeasWeightsChunk
+   * Usage: computeMeasWeightsChunk(chunk, begin, end, ...);
+   * -------------------------------------------------------------------------*/
+  /*! Computes currMeasWeights and measDepthBias for particles [begin, end)
+   * without modifying the particles. Stops at the first particle with a NaN
+   * squared error.
+   */
+  void computeMeasWeightsChunk(int chunk, int begin, int end, int nBeams,
+				const double* totalVar);
+
+
   /* Function: motionUpdateParticle
    * Usage: motionUpdateParticle(particle, dx, dy, dz, dphi, dtheta, dpsi, 
    * lastPsi, dt);
@@ -537,6 +622,19 @@ class TNavParticleFilter : public TNavFilter
   bool* tempUseBeam;
   bool* useBeam;
 
+  //!thread pool and per-block scratch space for the measurement update
+  TNavThreadPool* measPool;
+  std::vector<pfMeasChunkT> measChunks;
+
+  //!contour matching depth bias computed for each particle by measUpdate
+  double measDepthBias[MAX_PARTICLES];
+
+  //!structure-of-arrays particle data for the measurement update
+  pfParticleSoAT* measSoA;
+
+  //!upper limit on nParticles set by setNumParticles()
+  int maxParticles;
+
   double navData_x_, navData_y_;
 
   TNavPFLog  *pfLog;
@@ -10,11 +10,24 @@
  *****************************************************************************/
 
 #include "TNavPointMassFilter.h"
+#include "TNavFFT.h"
 #include "MathP.h"
 #include "TerrainMapDEM.h"
 #include "mapio.h"
 #include "trn_log.h"
 
+#include <algorithm>
+#include <vector>
+
+//Costs of the direct correlation sums in the units of fftCost() (multiply-adds
+//of conv2), measured on synthetic maps: per beam and hypothesis when the map
+//is interpolated at the hypotheses, per beam and hypothesis when map
+//submatrices are compared (HYP_RES 0), and per grid point of each copy of the
+//submap made by GetMapT.
+#define PMF_INTERP_CORR_COST 70.0
+#define PMF_SHIFT_CORR_COST  10.0
+#define PMF_MAP_COPY_COST    4.0
+
 //TNavPointMassFilter::TNavPointMassFilter(char* mapName, char* vehicleSpecs, char* directory, const double* windowVar,
 //		const int& mapType) : TNavFilter(mapName, vehicleSpecs, directory, windowVar, mapType) {
 TNavPointMassFilter::TNavPointMassFilter(TerrainMap* terrainMap, char* vehicleSpecs, char* directory, const double* windowVar,
@@ -428,6 +441,7 @@ void TNavPointMassFilter::initVariables() {
 	//initialize corrData
 	numCorr = 0;
 	corrData = NULL;
+	fftMode = PMF_FFT_AUTO;
 	
 	//initialize depth bias variables
 	currMeasPointer = 0;
@@ -660,8 +674,10 @@ Matrix TNavPointMassFilter::generateCorrelationSurf(bool& containsNaN) {
 	double totalNaN = 0;
 	containsNaN = false;
 	
-	//Cycle through all beams to generate squared error matrix
-	for(int m = 1; m <= numCorr; m++) {
+	//Use FFT correlations when they give the same sums faster; otherwise
+	//cycle through all beams to generate squared error matrix
+	bool correlatedFFT = generateCorrelationSumsFFT(Esq, currProdInvVar);
+	for(int m = 1; m <= numCorr && !correlatedFFT; m++) {
 		depthMeas = lastNavPose->z + corrData[numCorr - m].dz;
 		extractDepthCompareValues(MapValues, ZVar, m);
 		
@@ -801,6 +817,161 @@ Matrix TNavPointMassFilter::generateCorrelationSurf(bool& containsNaN) {
 	return Like;
 }
 
+bool TNavPointMassFilter::generateCorrelationSumsFFT(Matrix& Esq,
+		Matrix& currProdInvVar) {
+	if(this->fftMode == PMF_FFT_OFF || this->mapType != 1 || numCorr < 1 ||
+			this->terrainMap->GetInterpMethod() != 0) {
+		return false;
+	}
+	
+	//The hypothesis grid must lie on the map grid
+	double dx = fabs(terrainMap->Getdx());
+	double dy = fabs(terrainMap->Getdy());
+	if(fabs(fabs(priorPDF->dx) - dx) > 1.e-9 * dx ||
+			fabs(fabs(priorPDF->dy) - dy) > 1.e-9 * dy) {
+		return false;
+	}
+	
+	int numRows = hypBounds[1] - hypBounds[0] + 1;
+	int numCols = hypBounds[3] - hypBounds[2] + 1;
+	
+	//Compare the estimated cost of the four transforms with the direct sums.
+	//The map window spans the hypotheses plus the spread of the beams, and
+	//the submap copied by GetMapT is about the same size.
+	if(this->fftMode == PMF_FFT_AUTO) {
+		double minDx = corrData[0].dx, maxDx = corrData[0].dx;
+		double minDy = corrData[0].dy, maxDy = corrData[0].dy;
+		for(int i = 1; i < numCorr; i++) {
+			minDx = std::min(minDx, corrData[i].dx);
+			maxDx = std::max(maxDx, corrData[i].dx);
+			minDy = std::min(minDy, corrData[i].dy);
+			maxDy = std::max(maxDy, corrData[i].dy);
+		}
+		int windowRows = numRows + int(ceil((maxDx - minDx) / dx)) + 1;
+		int windowCols = numCols + int(ceil((maxDy - minDy) / dy)) + 1;
+		double mapCopyCost = PMF_MAP_COPY_COST * double(windowRows) * windowCols;
+		double directCost;
+		if(HYP_RES == 0) {
+			directCost = numCorr * (PMF_SHIFT_CORR_COST * double(numRows) * numCols +
+									mapCopyCost);
+		} else {
+			directCost = numCorr * PMF_INTERP_CORR_COST * double(numRows) * numCols;
+		}
+		if(4.0 * fftCost(fftSize(windowRows), fftSize(windowCols)) + mapCopyCost >=
+				directCost) {
+			return false;
+		}
+	}
+	
+	mapT mapForComparison;
+	if(!terrainMap->GetMapT(mapForComparison)) {
+		return false;
+	}
+	int numX = mapForComparison.numX;
+	int numY = mapForComparison.numY;
+	
+	//Find the map row and column compared with the first hypothesis for each
+	//beam, the same way extractDepthCompareValues does, and check that the
+	//remaining hypotheses compare with consecutive rows and columns
+	std::vector<int> mapRow(numCorr), mapCol(numCorr);
+	std::vector<double> hypDistSq(numCorr);
+	int minRow = numX, maxRow = 0, minCol = numY, maxCol = 0;
+	for(int m = 1; m <= numCorr; m++) {
+		double locX = corrData[numCorr - m].dx;
+		double locY = corrData[numCorr - m].dy;
+		int row0 = closestPtUniformArray(locX + priorPDF->xpts[hypBounds[0] - 1],
+										 mapForComparison.xpts[0],
+										 mapForComparison.xpts[numX - 1], numX);
+		int col0 = closestPtUniformArray(locY + priorPDF->ypts[hypBounds[2] - 1],
+										 mapForComparison.ypts[0],
+										 mapForComparison.ypts[numY - 1], numY);
+		if(HYP_RES == 0) {
+			while(row0 + numRows > numX) {
+				row0--;
+			}
+			while(col0 + numCols > numY) {
+				col0--;
+			}
+			hypDistSq[m - 1] = -1.0;
+		} else {
+			for(int i = 1; i < numRows; i++) {
+				if(closestPtUniformArray(locX + priorPDF->xpts[hypBounds[0] - 1 + i],
+										 mapForComparison.xpts[0],
+										 mapForComparison.xpts[numX - 1], numX) != row0 + i) {
+					return false;
+				}
+			}
+			for(int j = 1; j < numCols; j++) {
+				if(closestPtUniformArray(locY + priorPDF->ypts[hypBounds[2] - 1 + j],
+										 mapForComparison.ypts[0],
+										 mapForComparison.ypts[numY - 1], numY) != col0 + j) {
+					return false;
+				}
+			}
+			//nearest neighbor interpolation adds a variogram term for the
+			//distance to the grid point, which is the same for every hypothesis
+			hypDistSq[m - 1] = pow(mapForComparison.xpts[row0] - locX -
+								   priorPDF->xpts[hypBounds[0] - 1], 2) +
+							   pow(mapForComparison.ypts[col0] - locY -
+								   priorPDF->ypts[hypBounds[2] - 1], 2);
+		}
+		if(row0 < 0 || col0 < 0) {
+			return false;
+		}
+		mapRow[m - 1] = row0;
+		mapCol[m - 1] = col0;
+		minRow = std::min(minRow, row0);
+		maxRow = std::max(maxRow, row0);
+		minCol = std::min(minCol, col0);
+		maxCol = std::max(maxCol, col0);
+	}
+	
+	//The map window under all beams must be free of NaN data and have a
+	//single variance so that every hypothesis gets the same beam weights
+	int windowRows = maxRow - minRow + numRows;
+	int windowCols = maxCol - minCol + numCols;
+	Matrix window = mapForComparison.depths.SubMatrix(minRow + 1,
+					minRow + windowRows, minCol + 1, minCol + windowCols);
+	double mapVar = mapForComparison.depthVariance(minRow + 1, minCol + 1);
+	for(int i = 1; i <= windowRows; i++) {
+		for(int j = 1; j <= windowCols; j++) {
+			if(ISNIN(window(i, j)) ||
+					mapForComparison.depthVariance(minRow + i, minCol + j) != mapVar) {
+				return false;
+			}
+			window(i, j) = fabs(window(i, j));
+		}
+	}
+	
+	std::vector<int> rowOffsets(numCorr), colOffsets(numCorr);
+	std::vector<double> weights(numCorr), depthMeas(numCorr);
+	double sumInvVar = 0.0;
+	double prodInvVar = 1.0;
+	for(int m = 1; m <= numCorr; m++) {
+		double var = mapVar + corrData[numCorr - m].var;
+		if(hypDistSq[m - 1] >= 0.0) {
+			var += evalVariogram(sqrt(hypDistSq[m - 1]));
+		}
+		rowOffsets[m - 1] = mapRow[m - 1] - minRow;
+		colOffsets[m - 1] = mapCol[m - 1] - minCol;
+		weights[m - 1] = 1.0 / var;
+		depthMeas[m - 1] = lastNavPose->z + corrData[numCorr - m].dz;
+		sumInvVar += weights[m - 1];
+		prodInvVar *= weights[m - 1];
+	}
+	
+	Matrix SumError(numRows, numCols);
+	fftCorrelationSums(window, numCorr, &rowOffsets[0], &colOffsets[0],
+					   &weights[0], &depthMeas[0], SumError, Esq);
+					   
+	this->currSumInvVar.SubMatrix(hypBounds[0], hypBounds[1],
+								  hypBounds[2], hypBounds[3]) += sumInvVar;
+	currProdInvVar = prodInvVar;
+	this->currSumError.SubMatrix(hypBounds[0], hypBounds[1],
+								 hypBounds[2], hypBounds[3]) += SumError;
+	return true;
+}
+
 
 void TNavPointMassFilter::extractDepthCompareValues(Matrix& depthMat,
 		Matrix& varMat,
@@ -1114,8 +1285,26 @@ bool TNavPointMassFilter::motionBlur_convolve(const SymmetricMatrix Cov) {
 	//convPDF = 1.0;
 	convPDF *= (1.0 / convPDF.Sum());
 	
-	//convolve current PDF with gaussian blur PDF
-	newPDF = conv2(this->priorPDF->depths, convPDF);
+	//convolve current PDF with gaussian blur PDF, using FFTs when the
+	//blurring matrix is large enough for them to be faster
+	double directCost = double(this->priorPDF->numX) * this->priorPDF->numY *
+						convPDF.Nrows() * convPDF.Ncols();
+	double transformCost = 2.0 * fftCost(fftSize(this->priorPDF->numX + convPDF.Nrows() - 1),
+										 fftSize(this->priorPDF->numY + convPDF.Ncols() - 1));
+	if(this->fftMode == PMF_FFT_ALWAYS ||
+			(this->fftMode == PMF_FFT_AUTO && transformCost < directCost)) {
+		newPDF = fftConv2(this->priorPDF->depths, convPDF);
+		//remove the rounding noise of the transforms around zero probability
+		for(i = 1; i <= newPDF.Nrows(); i++) {
+			for(j = 1; j <= newPDF.Ncols(); j++) {
+				if(newPDF(i, j) < 0.0) {
+					newPDF(i, j) = 0.0;
+				}
+			}
+		}
+	} else {
+		newPDF = conv2(this->priorPDF->depths, convPDF);
+	}
 	
 	newPDF *= (1.0 / newPDF.Sum());
 	this->priorPDF->depths = newPDF;
@@ -58,6 +58,11 @@
 #define DEPTH_FILTER_LENGTH 1 //indicates number of prev. measurements used for 
 #endif                        //depth bias calculation
 
+//FFT use by the correlation and convolution motion blurring (see setFFTMode)
+#define PMF_FFT_OFF    0  //always use the direct sums
+#define PMF_FFT_AUTO   1  //use FFTs where they apply and are expected to be faster
+#define PMF_FFT_ALWAYS 2  //use FFTs wherever they apply
+
 
 /*!
  * Class: TNavPointMassFilter
@@ -189,6 +194,21 @@ class TNavPointMassFilter : public TNavFilter
    */
   bool getLikeSurf(mapT &currLikeSurf);
 
+
+  /* Function: setFFTMode
+   * Usage: setFFTMode(PMF_FFT_OFF);
+   * ------------------------------------------------------------------------*/
+  /*! Selects whether generateCorrelationSurf and motionBlur_convolve may use
+   * FFTs instead of direct sums (PMF_FFT_OFF, PMF_FFT_AUTO or PMF_FFT_ALWAYS;
+   * the default is PMF_FFT_AUTO). The correlation FFT only applies when each
+   * beam compares against a shifted copy of the map: nearest neighbor map
+   * interpolation with the hypothesis grid on the map grid, uniform map
+   * variance and no NaN map data under the hypotheses. Otherwise the direct
+   * sums are used in every mode.
+   */
+  void setFFTMode(int mode) { fftMode = mode; }
+  int getFFTMode() const { return fftMode; }
+
  private:
 
   /* Function: initVariables()
@@ -233,6 +253,18 @@ class TNavPointMassFilter : public TNavFilter
   Matrix generateCorrelationSurf(bool &containsNaN); 
 
 
+  /* Helper Function: generateCorrelationSumsFFT
+   * Usage: done = generateCorrelationSumsFFT(Esq, currProdInvVar);
+   * -------------------------------------------------------------------------*/
+  /*! Computes the squared error matrix Esq, the product of inverse variances
+   * and the currSumInvVar and currSumError terms of generateCorrelationSurf
+   * over all beams with FFT correlations (see setFFTMode). Returns false,
+   * leaving everything unchanged, if the FFT does not apply or is not
+   * expected to be faster; the caller then uses the direct sums.
+   */
+  bool generateCorrelationSumsFFT(Matrix &Esq, Matrix &currProdInvVar);
+
+
   /* Helper Function: extractDepthCompareValues
    * Usage: extractDepthCompareValues(depthVals, beamNum)
    * -------------------------------------------------------------------------*/
@@ -333,6 +365,9 @@ class TNavPointMassFilter : public TNavFilter
   corrT* corrData;
   int numCorr;
 
+  //!FFT use by the correlation and motion blurring (PMF_FFT_*)
+  int fftMode;
+
   //!integer array of boundaries on priorPDF specifying the non-zero elements
   int hypBounds[4];
 
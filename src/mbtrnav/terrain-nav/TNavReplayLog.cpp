@@ -0,0 +1,714 @@
+/* FILENAME      : TNavReplayLog.cpp
+ * DATE          : 10/16/26
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ ******************************************************************************/
+
+#include "TNavReplayLog.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Record columns of doubles
+enum {
+	COL_POSE_TIME = 0, COL_POSE_X, COL_POSE_Y, COL_POSE_Z,
+	COL_POSE_VX, COL_POSE_VY, COL_POSE_VZ,
+	COL_POSE_PHI, COL_POSE_THETA, COL_POSE_PSI,
+	COL_POSE_WX, COL_POSE_WY, COL_POSE_WZ,
+	COL_MEAS_TIME, COL_MEAS_X, COL_MEAS_Y, COL_MEAS_Z,
+	COL_MEAS_PHI, COL_MEAS_THETA, COL_MEAS_PSI,
+	COL_EST_TIME, COL_EST_X, COL_EST_Y, COL_EST_Z,
+	COL_EST_PHI, COL_EST_THETA, COL_EST_PSI, COL_EST_PSI_BERG,
+	COL_EST_VAR_X, COL_EST_VAR_Y, COL_EST_VAR_Z, COL_EST_VAR_PSI_BERG,
+	NUM_DOUBLE_COLS
+};
+
+// Record columns of integers
+enum {
+	COL_FLAGS = 0, COL_DATA_TYPE, COL_PING_NUMBER, COL_NUM_MEAS,
+	NUM_INT_COLS
+};
+
+// Beam columns
+enum {
+	COL_RANGES = 0, COL_CROSS_TRACK, COL_ALONG_TRACK, COL_ALTITUDES,
+	NUM_BEAM_DOUBLE_COLS
+};
+enum {
+	COL_BEAM_NUMS = 0, COL_MEAS_STATUS,
+	NUM_BEAM_INT_COLS
+};
+
+// COL_FLAGS bits
+#define FLAG_DVL_VALID    0x1
+#define FLAG_GPS_VALID    0x2
+#define FLAG_BOTTOM_LOCK  0x4
+#define FLAG_ESTIMATE     0x8
+
+// Indices of the estimate variances in poseT::covariance (see TerrainNavLog)
+#define COV_X        0
+#define COV_Y        2
+#define COV_Z        5
+#define COV_PSI_BERG 44
+
+void TNavReplayColumns::clear() {
+	values.clear();
+	ints.clear();
+	beamValues.clear();
+	beamInts.clear();
+	beamStart.clear();
+	numRecords = 0;
+	numBeams = 0;
+}
+
+/*----------------------------------------------------------------------------
+/ Column encoding
+/----------------------------------------------------------------------------*/
+
+static uint32_t checksum(const uint8_t *data, size_t size) {
+	uint32_t h = 2166136261u;
+	for(size_t i = 0; i < size; i++) {
+		h = (h ^ data[i]) * 16777619u;
+	}
+	return h;
+}
+
+// Doubles are stored as the XOR of their bits with the previous value of the
+// column: a control byte with the number of leading (high nibble) and
+// trailing (low nibble) zero bytes of the XOR, followed by the remaining
+// bytes. Unchanged values take one byte.
+static void putDoubles(std::vector<uint8_t> &out, const double *v, size_t n,
+		       size_t stride) {
+	uint64_t prev = 0;
+	for(size_t i = 0; i < n; i++) {
+		uint64_t bits;
+		memcpy(&bits, &v[i * stride], sizeof(bits));
+		uint64_t x = bits ^ prev;
+		prev = bits;
+
+		int lead = 0, trail = 0;
+		if(x == 0) {
+			lead = 8;
+		} else {
+			while(((x >> (56 - 8 * lead)) & 0xff) == 0) lead++;
+			while(((x >> (8 * trail)) & 0xff) == 0) trail++;
+		}
+		out.push_back((uint8_t)((lead << 4) | trail));
+		for(int b = trail; b < 8 - lead; b++) {
+			out.push_back((uint8_t)(x >> (8 * b)));
+		}
+	}
+}
+
+static bool getDoubles(const uint8_t *&p, const uint8_t *end, double *v,
+		       size_t n, size_t stride) {
+	uint64_t prev = 0;
+	for(size_t i = 0; i < n; i++) {
+		if(p >= end) return false;
+		int lead = *p >> 4;
+		int trail = *p & 0xf;
+		p++;
+		if(lead + trail > 8 || (lead < 8 && end - p < 8 - lead - trail)) return false;
+
+		uint64_t x = 0;
+		for(int b = trail; b < 8 - lead; b++) {
+			x |= (uint64_t)(*p++) << (8 * b);
+		}
+		prev ^= x;
+		memcpy(&v[i * stride], &prev, sizeof(prev));
+	}
+	return true;
+}
+
+// Integers are stored as the zigzag varint of the difference to the previous
+// value of the column
+static void putInts(std::vector<uint8_t> &out, const int64_t *v, size_t n,
+		    size_t stride) {
+	int64_t prev = 0;
+	for(size_t i = 0; i < n; i++) {
+		int64_t d = (int64_t)((uint64_t)v[i * stride] - (uint64_t)prev);
+		prev = v[i * stride];
+		uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+		while(z >= 0x80) {
+			out.push_back((uint8_t)(z | 0x80));
+			z >>= 7;
+		}
+		out.push_back((uint8_t)z);
+	}
+}
+
+static bool getInts(const uint8_t *&p, const uint8_t *end, int64_t *v,
+		    size_t n, size_t stride) {
+	int64_t prev = 0;
+	for(size_t i = 0; i < n; i++) {
+		uint64_t z = 0;
+		int shift = 0;
+		do {
+			if(p >= end || shift > 63) return false;
+			z |= (uint64_t)(*p & 0x7f) << shift;
+			shift += 7;
+		} while(*p++ & 0x80);
+		int64_t d = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+		prev = (int64_t)((uint64_t)prev + (uint64_t)d);
+		v[i * stride] = prev;
+	}
+	return true;
+}
+
+// Upper bound of the encoded size of a block: 9 bytes per double and 10 per
+// integer
+static uint64_t maxDataSize(uint64_t numRecords, uint64_t numBeams) {
+	return numRecords * (9 * NUM_DOUBLE_COLS + 10 * NUM_INT_COLS)
+		+ numBeams * (9 * NUM_BEAM_DOUBLE_COLS + 10 * NUM_BEAM_INT_COLS);
+}
+
+static void encodeColumns(const TNavReplayColumns &cols, std::vector<uint8_t> &out) {
+	out.clear();
+	size_t nr = cols.numRecords;
+	size_t nb = cols.numBeams;
+	for(int c = 0; c < NUM_DOUBLE_COLS; c++) {
+		putDoubles(out, &cols.values[c], nr, NUM_DOUBLE_COLS);
+	}
+	for(int c = 0; c < NUM_INT_COLS; c++) {
+		putInts(out, &cols.ints[c], nr, NUM_INT_COLS);
+	}
+	for(int c = 0; c < NUM_BEAM_DOUBLE_COLS && nb > 0; c++) {
+		putDoubles(out, &cols.beamValues[c], nb, NUM_BEAM_DOUBLE_COLS);
+	}
+	for(int c = 0; c < NUM_BEAM_INT_COLS && nb > 0; c++) {
+		putInts(out, &cols.beamInts[c], nb, NUM_BEAM_INT_COLS);
+	}
+}
+
+static bool decodeColumns(const std::vector<uint8_t> &data, uint32_t numRecords,
+			  uint32_t numBeams, TNavReplayColumns &cols) {
+	cols.numRecords = numRecords;
+	cols.numBeams = numBeams;
+	cols.values.resize((size_t)numRecords * NUM_DOUBLE_COLS);
+	cols.ints.resize((size_t)numRecords * NUM_INT_COLS);
+	cols.beamValues.resize((size_t)numBeams * NUM_BEAM_DOUBLE_COLS);
+	cols.beamInts.resize((size_t)numBeams * NUM_BEAM_INT_COLS);
+	cols.beamStart.resize(numRecords);
+
+	const uint8_t *p = data.empty() ? NULL : &data[0];
+	const uint8_t *end = p + data.size();
+	bool ok = true;
+	for(int c = 0; ok && c < NUM_DOUBLE_COLS; c++) {
+		ok = getDoubles(p, end, &cols.values[c], numRecords, NUM_DOUBLE_COLS);
+	}
+	for(int c = 0; ok && c < NUM_INT_COLS; c++) {
+		ok = getInts(p, end, &cols.ints[c], numRecords, NUM_INT_COLS);
+	}
+	for(int c = 0; ok && c < NUM_BEAM_DOUBLE_COLS && numBeams > 0; c++) {
+		ok = getDoubles(p, end, &cols.beamValues[c], numBeams, NUM_BEAM_DOUBLE_COLS);
+	}
+	for(int c = 0; ok && c < NUM_BEAM_INT_COLS && numBeams > 0; c++) {
+		ok = getInts(p, end, &cols.beamInts[c], numBeams, NUM_BEAM_INT_COLS);
+	}
+	if(!ok || p != end) return false;
+
+	//the beam counts must add up to the beams of the block
+	uint64_t beam = 0;
+	for(uint32_t r = 0; r < numRecords; r++) {
+		int64_t n = cols.ints[r * NUM_INT_COLS + COL_NUM_MEAS];
+		if(n < 0 || n > TRN_MAX_BEAMS) return false;
+		cols.beamStart[r] = (uint32_t)beam;
+		beam += n;
+	}
+	return beam == numBeams;
+}
+
+/*----------------------------------------------------------------------------
+/ TNavReplayLogWriter
+/----------------------------------------------------------------------------*/
+
+TNavReplayLogWriter::
+TNavReplayLogWriter(int blockRecords) :
+file_(NULL), blockRecords_(blockRecords > 0 ? blockRecords : TNAV_REPLAY_BLOCK_RECORDS),
+numRecords_(0), offset_(0)
+{
+}
+
+TNavReplayLogWriter::
+~TNavReplayLogWriter() {
+	close();
+}
+
+bool
+TNavReplayLogWriter::
+open(const char *fileName, const TNavReplayConfig &config) {
+	close();
+
+	file_ = fopen(fileName, "wb");
+	if(NULL == file_) {
+		fprintf(stderr, "TNavReplayLogWriter::open - Unable to create %s\n", fileName);
+		return false;
+	}
+
+	TNavReplayHeader header;
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, TNAV_REPLAY_MAGIC, sizeof(header.magic));
+	header.version = TNAV_REPLAY_VERSION;
+	header.blockRecords = blockRecords_;
+	header.config = config;
+
+	numRecords_ = 0;
+	offset_ = 0;
+	block_.clear();
+	index_.clear();
+	if(!writeBytes(&header, sizeof(header))) {
+		fprintf(stderr, "TNavReplayLogWriter::open - Unable to write %s\n", fileName);
+		fclose(file_);
+		file_ = NULL;
+		return false;
+	}
+	return true;
+}
+
+bool
+TNavReplayLogWriter::
+write(const poseT &pt, const measT &mt, const poseT *estimate) {
+	if(NULL == file_) return false;
+
+	size_t r = block_.numRecords;
+	block_.values.resize((r + 1) * NUM_DOUBLE_COLS);
+	block_.ints.resize((r + 1) * NUM_INT_COLS);
+	double *v = &block_.values[r * NUM_DOUBLE_COLS];
+	int64_t *iv = &block_.ints[r * NUM_INT_COLS];
+
+	v[COL_POSE_TIME] = pt.time;
+	v[COL_POSE_X] = pt.x;
+	v[COL_POSE_Y] = pt.y;
+	v[COL_POSE_Z] = pt.z;
+	v[COL_POSE_VX] = pt.vx;
+	v[COL_POSE_VY] = pt.vy;
+	v[COL_POSE_VZ] = pt.vz;
+	v[COL_POSE_PHI] = pt.phi;
+	v[COL_POSE_THETA] = pt.theta;
+	v[COL_POSE_PSI] = pt.psi;
+	v[COL_POSE_WX] = pt.wx;
+	v[COL_POSE_WY] = pt.wy;
+	v[COL_POSE_WZ] = pt.wz;
+	v[COL_MEAS_TIME] = mt.time;
+	v[COL_MEAS_X] = mt.x;
+	v[COL_MEAS_Y] = mt.y;
+	v[COL_MEAS_Z] = mt.z;
+	v[COL_MEAS_PHI] = mt.phi;
+	v[COL_MEAS_THETA] = mt.theta;
+	v[COL_MEAS_PSI] = mt.psi;
+
+	if(estimate) {
+		v[COL_EST_TIME] = estimate->time;
+		v[COL_EST_X] = estimate->x;
+		v[COL_EST_Y] = estimate->y;
+		v[COL_EST_Z] = estimate->z;
+		v[COL_EST_PHI] = estimate->phi;
+		v[COL_EST_THETA] = estimate->theta;
+		v[COL_EST_PSI] = estimate->psi;
+		v[COL_EST_PSI_BERG] = estimate->psi_berg;
+		v[COL_EST_VAR_X] = estimate->covariance[COV_X];
+		v[COL_EST_VAR_Y] = estimate->covariance[COV_Y];
+		v[COL_EST_VAR_Z] = estimate->covariance[COV_Z];
+		v[COL_EST_VAR_PSI_BERG] = estimate->covariance[COV_PSI_BERG];
+	} else {
+		//repeat the previous estimate, which costs one byte per column
+		for(int c = COL_EST_TIME; c < NUM_DOUBLE_COLS; c++) {
+			v[c] = (r > 0) ? v[c - NUM_DOUBLE_COLS] : 0.;
+		}
+	}
+
+	int numMeas = mt.numMeas;
+	if(numMeas < 0) numMeas = 0;
+	if(numMeas > TRN_MAX_BEAMS) numMeas = TRN_MAX_BEAMS;
+
+	iv[COL_FLAGS] = (pt.dvlValid ? FLAG_DVL_VALID : 0)
+		| (pt.gpsValid ? FLAG_GPS_VALID : 0)
+		| (pt.bottomLock ? FLAG_BOTTOM_LOCK : 0)
+		| (estimate ? FLAG_ESTIMATE : 0);
+	iv[COL_DATA_TYPE] = mt.dataType;
+	iv[COL_PING_NUMBER] = mt.ping_number;
+	iv[COL_NUM_MEAS] = numMeas;
+
+	size_t b0 = block_.numBeams;
+	block_.beamValues.resize((b0 + numMeas) * NUM_BEAM_DOUBLE_COLS);
+	block_.beamInts.resize((b0 + numMeas) * NUM_BEAM_INT_COLS);
+	for(int i = 0; i < numMeas; i++) {
+		double *bv = &block_.beamValues[(b0 + i) * NUM_BEAM_DOUBLE_COLS];
+		int64_t *bi = &block_.beamInts[(b0 + i) * NUM_BEAM_INT_COLS];
+		bv[COL_RANGES] = mt.ranges ? mt.ranges[i] : 0.;
+		bv[COL_CROSS_TRACK] = mt.crossTrack ? mt.crossTrack[i] : 0.;
+		bv[COL_ALONG_TRACK] = mt.alongTrack ? mt.alongTrack[i] : 0.;
+		bv[COL_ALTITUDES] = mt.altitudes ? mt.altitudes[i] : 0.;
+		bi[COL_BEAM_NUMS] = mt.beamNums ? mt.beamNums[i] : i;
+		bi[COL_MEAS_STATUS] = mt.measStatus ? mt.measStatus[i] : 0;
+	}
+	block_.numBeams += numMeas;
+	block_.numRecords++;
+	numRecords_++;
+
+	if((int)block_.numRecords >= blockRecords_) {
+		return flushBlock();
+	}
+	return true;
+}
+
+bool
+TNavReplayLogWriter::
+flushBlock() {
+	if(block_.numRecords == 0) return true;
+
+	encodeColumns(block_, data_);
+
+	TNavReplayBlockHeader bh;
+	memset(&bh, 0, sizeof(bh));
+	bh.magic = TNAV_REPLAY_BLOCK_MAGIC;
+	bh.numRecords = block_.numRecords;
+	bh.numBeams = block_.numBeams;
+	bh.dataSize = data_.size();
+	bh.checksum = checksum(data_.empty() ? NULL : &data_[0], data_.size());
+	bh.startTime = block_.values[COL_POSE_TIME];
+	bh.endTime = block_.values[(block_.numRecords - 1) * NUM_DOUBLE_COLS + COL_POSE_TIME];
+
+	TNavReplayIndexEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.startTime = bh.startTime;
+	entry.endTime = bh.endTime;
+	entry.offset = offset_;
+	entry.numRecords = bh.numRecords;
+	index_.push_back(entry);
+
+	block_.clear();
+	return writeBytes(&bh, sizeof(bh))
+		&& (data_.empty() || writeBytes(&data_[0], data_.size()));
+}
+
+bool
+TNavReplayLogWriter::
+writeBytes(const void *data, size_t size) {
+	if(fwrite(data, 1, size, file_) != size) return false;
+	offset_ += size;
+	return true;
+}
+
+bool
+TNavReplayLogWriter::
+close() {
+	if(NULL == file_) return true;
+
+	bool ok = flushBlock();
+
+	TNavReplayTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	trailer.indexOffset = offset_;
+	trailer.numBlocks = index_.size();
+	strncpy(trailer.magic, TNAV_REPLAY_INDEX_MAGIC, sizeof(trailer.magic));
+
+	ok = ok && (index_.empty()
+		    || writeBytes(&index_[0], index_.size() * sizeof(TNavReplayIndexEntry)));
+	ok = ok && writeBytes(&trailer, sizeof(trailer));
+	ok = (fclose(file_) == 0) && ok;
+	file_ = NULL;
+	index_.clear();
+
+	if(!ok) {
+		fprintf(stderr, "TNavReplayLogWriter::close - write failed\n");
+	}
+	return ok;
+}
+
+/*----------------------------------------------------------------------------
+/ TNavReplayLogReader
+/----------------------------------------------------------------------------*/
+
+TNavReplayLogReader::
+TNavReplayLogReader() :
+file_(NULL), numRecords_(0), blockNum_(0), nextBlock_(0), record_(0)
+{
+	memset(&header_, 0, sizeof(header_));
+}
+
+TNavReplayLogReader::
+~TNavReplayLogReader() {
+	close();
+}
+
+void
+TNavReplayLogReader::
+close() {
+	if(file_) fclose(file_);
+	file_ = NULL;
+	numRecords_ = 0;
+	index_.clear();
+	block_.clear();
+	blockNum_ = nextBlock_ = 0;
+	record_ = 0;
+}
+
+bool
+TNavReplayLogReader::
+open(const char *fileName) {
+	struct stat fileStat;
+
+	close();
+	file_ = fopen(fileName, "rb");
+	if(NULL == file_) {
+		fprintf(stderr, "TNavReplayLogReader::open - Unable to open %s\n", fileName);
+		return false;
+	}
+
+	if(fstat(fileno(file_), &fileStat) != 0
+			|| fread(&header_, sizeof(header_), 1, file_) != 1
+			|| strncmp(header_.magic, TNAV_REPLAY_MAGIC, sizeof(header_.magic)) != 0
+			|| header_.version != TNAV_REPLAY_VERSION) {
+		fprintf(stderr, "TNavReplayLogReader::open - %s is not a replay log\n", fileName);
+		close();
+		return false;
+	}
+
+	//names are written NUL padded, but do not rely on it
+	header_.config.mapFile[TNAV_REPLAY_NAME_LEN - 1] = '\0';
+	header_.config.vehicleCfgFile[TNAV_REPLAY_NAME_LEN - 1] = '\0';
+	header_.config.particlesFile[TNAV_REPLAY_NAME_LEN - 1] = '\0';
+
+	if(!loadIndex(fileStat.st_size) && !rebuildIndex(fileStat.st_size)) {
+		fprintf(stderr, "TNavReplayLogReader::open - %s has no readable blocks\n", fileName);
+		close();
+		return false;
+	}
+
+	numRecords_ = 0;
+	for(size_t i = 0; i < index_.size(); i++) {
+		numRecords_ += index_[i].numRecords;
+	}
+	blockNum_ = index_.size();
+	nextBlock_ = 0;
+	record_ = 0;
+	return true;
+}
+
+bool
+TNavReplayLogReader::
+loadIndex(off_t fileSize) {
+	TNavReplayTrailer trailer;
+	off_t trailerOffset = fileSize - (off_t)sizeof(trailer);
+
+	if(trailerOffset < (off_t)sizeof(header_)
+			|| fseeko(file_, trailerOffset, SEEK_SET) != 0
+			|| fread(&trailer, sizeof(trailer), 1, file_) != 1
+			|| strncmp(trailer.magic, TNAV_REPLAY_INDEX_MAGIC, sizeof(trailer.magic)) != 0
+			|| trailer.indexOffset + (uint64_t)trailer.numBlocks * sizeof(TNavReplayIndexEntry)
+			!= (uint64_t)trailerOffset) {
+		return false;
+	}
+
+	index_.resize(trailer.numBlocks);
+	if(trailer.numBlocks > 0
+			&& (fseeko(file_, trailer.indexOffset, SEEK_SET) != 0
+			    || fread(&index_[0], sizeof(TNavReplayIndexEntry), index_.size(), file_)
+			    != index_.size())) {
+		index_.clear();
+		return false;
+	}
+	return true;
+}
+
+// Recovers the index of a log that was not closed by walking the block
+// headers up to the first incomplete block
+bool
+TNavReplayLogReader::
+rebuildIndex(off_t fileSize) {
+	TNavReplayBlockHeader bh;
+	off_t offset = sizeof(header_);
+
+	index_.clear();
+	while(offset + (off_t)sizeof(bh) <= fileSize
+			&& fseeko(file_, offset, SEEK_SET) == 0
+			&& fread(&bh, sizeof(bh), 1, file_) == 1
+			&& bh.magic == TNAV_REPLAY_BLOCK_MAGIC
+			&& offset + (off_t)sizeof(bh) + (off_t)bh.dataSize <= fileSize) {
+		TNavReplayIndexEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.startTime = bh.startTime;
+		entry.endTime = bh.endTime;
+		entry.offset = offset;
+		entry.numRecords = bh.numRecords;
+		index_.push_back(entry);
+		offset += sizeof(bh) + bh.dataSize;
+	}
+
+	if(!index_.empty()) {
+		fprintf(stderr, "TNavReplayLogReader - log was not closed, recovered %zu blocks\n",
+			index_.size());
+	}
+	return !index_.empty();
+}
+
+bool
+TNavReplayLogReader::
+loadBlock(size_t block) {
+	TNavReplayBlockHeader bh;
+	const TNavReplayIndexEntry &entry = index_[block];
+
+	blockNum_ = index_.size();
+	block_.clear();
+	bool ok = fseeko(file_, entry.offset, SEEK_SET) == 0
+		&& fread(&bh, sizeof(bh), 1, file_) == 1
+		&& bh.magic == TNAV_REPLAY_BLOCK_MAGIC
+		&& bh.numRecords == entry.numRecords
+		&& bh.numRecords <= header_.blockRecords
+		&& bh.numBeams <= bh.numRecords * (uint64_t)TRN_MAX_BEAMS
+		&& bh.dataSize <= maxDataSize(bh.numRecords, bh.numBeams);
+	if(ok) {
+		data_.resize(bh.dataSize);
+		ok = bh.dataSize == 0 || fread(&data_[0], 1, bh.dataSize, file_) == bh.dataSize;
+	}
+	ok = ok && checksum(data_.empty() ? NULL : &data_[0], data_.size()) == bh.checksum
+		&& decodeColumns(data_, bh.numRecords, bh.numBeams, block_);
+
+	if(!ok) {
+		fprintf(stderr, "TNavReplayLogReader - block %zu at offset %llu is corrupt\n",
+			block, (unsigned long long)entry.offset);
+		block_.clear();
+		return false;
+	}
+	blockNum_ = block;
+	nextBlock_ = block + 1;
+	record_ = 0;
+	return true;
+}
+
+int
+TNavReplayLogReader::
+read(poseT *pt, measT *mt, poseT *estimate, bool *hasEstimate) {
+	if(NULL == file_) return 0;
+
+	while(record_ >= block_.numRecords) {
+		if(nextBlock_ >= index_.size()) return 0;
+		if(!loadBlock(nextBlock_)) {
+			//skip the bad block on the next call
+			nextBlock_++;
+			return -1;
+		}
+	}
+
+	uint32_t r = record_++;
+	const double *v = &block_.values[r * NUM_DOUBLE_COLS];
+	const int64_t *iv = &block_.ints[r * NUM_INT_COLS];
+
+	pt->time = v[COL_POSE_TIME];
+	pt->x = v[COL_POSE_X];
+	pt->y = v[COL_POSE_Y];
+	pt->z = v[COL_POSE_Z];
+	pt->vx = v[COL_POSE_VX];
+	pt->vy = v[COL_POSE_VY];
+	pt->vz = v[COL_POSE_VZ];
+	pt->phi = v[COL_POSE_PHI];
+	pt->theta = v[COL_POSE_THETA];
+	pt->psi = v[COL_POSE_PSI];
+	pt->wx = v[COL_POSE_WX];
+	pt->wy = v[COL_POSE_WY];
+	pt->wz = v[COL_POSE_WZ];
+	pt->dvlValid = (iv[COL_FLAGS] & FLAG_DVL_VALID) != 0;
+	pt->gpsValid = (iv[COL_FLAGS] & FLAG_GPS_VALID) != 0;
+	pt->bottomLock = (iv[COL_FLAGS] & FLAG_BOTTOM_LOCK) != 0;
+
+	mt->time = v[COL_MEAS_TIME];
+	mt->x = v[COL_MEAS_X];
+	mt->y = v[COL_MEAS_Y];
+	mt->z = v[COL_MEAS_Z];
+	mt->phi = v[COL_MEAS_PHI];
+	mt->theta = v[COL_MEAS_THETA];
+	mt->psi = v[COL_MEAS_PSI];
+	mt->dataType = (int)iv[COL_DATA_TYPE];
+	mt->ping_number = (unsigned int)iv[COL_PING_NUMBER];
+	mt->numMeas = (int)iv[COL_NUM_MEAS];
+
+	size_t n = mt->numMeas > 0 ? mt->numMeas : 1;
+	mt->ranges = (double *)realloc(mt->ranges, n * sizeof(double));
+	mt->crossTrack = (double *)realloc(mt->crossTrack, n * sizeof(double));
+	mt->alongTrack = (double *)realloc(mt->alongTrack, n * sizeof(double));
+	mt->altitudes = (double *)realloc(mt->altitudes, n * sizeof(double));
+	mt->alphas = (double *)realloc(mt->alphas, n * sizeof(double));
+	mt->beamNums = (int *)realloc(mt->beamNums, n * sizeof(int));
+	mt->measStatus = (bool *)realloc(mt->measStatus, n * sizeof(bool));
+
+	uint32_t b0 = block_.beamStart[r];
+	for(int i = 0; i < mt->numMeas; i++) {
+		const double *bv = &block_.beamValues[(b0 + i) * NUM_BEAM_DOUBLE_COLS];
+		const int64_t *bi = &block_.beamInts[(b0 + i) * NUM_BEAM_INT_COLS];
+		mt->ranges[i] = bv[COL_RANGES];
+		mt->crossTrack[i] = bv[COL_CROSS_TRACK];
+		mt->alongTrack[i] = bv[COL_ALONG_TRACK];
+		mt->altitudes[i] = bv[COL_ALTITUDES];
+		mt->alphas[i] = 0.;
+		mt->beamNums[i] = (int)bi[COL_BEAM_NUMS];
+		mt->measStatus[i] = bi[COL_MEAS_STATUS] != 0;
+	}
+
+	bool logged = (iv[COL_FLAGS] & FLAG_ESTIMATE) != 0;
+	if(hasEstimate) *hasEstimate = logged;
+	if(estimate && logged) {
+		estimate->time = v[COL_EST_TIME];
+		estimate->x = v[COL_EST_X];
+		estimate->y = v[COL_EST_Y];
+		estimate->z = v[COL_EST_Z];
+		estimate->phi = v[COL_EST_PHI];
+		estimate->theta = v[COL_EST_THETA];
+		estimate->psi = v[COL_EST_PSI];
+		estimate->psi_berg = v[COL_EST_PSI_BERG];
+		estimate->covariance[COV_X] = v[COL_EST_VAR_X];
+		estimate->covariance[COV_Y] = v[COL_EST_VAR_Y];
+		estimate->covariance[COV_Z] = v[COL_EST_VAR_Z];
+		estimate->covariance[COV_PSI_BERG] = v[COL_EST_VAR_PSI_BERG];
+	}
+	return 1;
+}
+
+bool
+TNavReplayLogReader::
+seek(double time) {
+	if(NULL == file_) return false;
+
+	//first block that ends at or after time
+	size_t lo = 0, hi = index_.size();
+	while(lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if(index_[mid].endTime < time) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if(lo >= index_.size()) {
+		nextBlock_ = index_.size();
+		record_ = block_.numRecords;
+		return false;
+	}
+
+	if(lo != blockNum_ && !loadBlock(lo)) {
+		nextBlock_ = lo + 1;
+		record_ = block_.numRecords;
+		return false;
+	}
+	nextBlock_ = lo + 1;
+	record_ = 0;
+	while(record_ < block_.numRecords
+			&& block_.values[record_ * NUM_DOUBLE_COLS + COL_POSE_TIME] < time) {
+		record_++;
+	}
+	return record_ < block_.numRecords || nextBlock_ < index_.size();
+}
+
+double
+TNavReplayLogReader::
+startTime() const {
+	return index_.empty() ? 0. : index_.front().startTime;
+}
+
+double
+TNavReplayLogReader::
+endTime() const {
+	return index_.empty() ? 0. : index_.back().endTime;
+}
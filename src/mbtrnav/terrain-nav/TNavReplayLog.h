@@ -0,0 +1,257 @@
+/* FILENAME      : TNavReplayLog.h
+ * DATE          : 10/16/26
+ * DESCRIPTION   : Compact columnar binary log of TRN inputs (poseT and measT
+ *                 record sets) and, optionally, the MMSE estimate TRN made
+ *                 from them. It is written once from a mission log and read
+ *                 back by trn-fastreplay to drive TerrainNav as fast as the
+ *                 filters allow, without the per-field parsing of the
+ *                 DataLog formats.
+ * DEPENDENCIES  : structDefs.h
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ *
+ ******************************************************************************/
+
+#ifndef _TNavReplayLog_h
+#define _TNavReplayLog_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include <vector>
+
+#include "structDefs.h"
+
+/*! Description of the replay log file:
+ *	TNavReplayHeader (magic, version and the TRN configuration of the mission)
+ *	blocks, each a TNavReplayBlockHeader followed by its compressed columns
+ *	the block index, one TNavReplayIndexEntry per block
+ *	TNavReplayTrailer (offset of the index, number of blocks, magic)
+ *
+ * A block holds up to TNAV_REPLAY_BLOCK_RECORDS records. Each field of the
+ * records (pose time, pose x, ..., beam ranges, ...) is stored as a separate
+ * column within the block, so that successive values of a field are adjacent
+ * and compress well: floating point columns store the XOR of each value with
+ * the previous one with its zero bytes dropped, integer columns store the
+ * zigzag varint of the difference to the previous value. The beam columns
+ * hold the beams of all records of the block, numMeas per record.
+ *
+ * The index gives the time span and file offset of every block, so a reader
+ * can seek to a time without decoding the blocks before it. A log that was
+ * not closed (no trailer) is still readable; the index is then rebuilt by
+ * walking the block headers.
+ *
+ * The file is written in host byte order.
+ */
+
+#define TNAV_REPLAY_MAGIC "TRNRPLY"
+#define TNAV_REPLAY_INDEX_MAGIC "TRNRIDX"
+#define TNAV_REPLAY_BLOCK_MAGIC 0x4b4c4254 // "TBLK"
+#define TNAV_REPLAY_VERSION 1
+#define TNAV_REPLAY_NAME_LEN 256
+#ifndef TNAV_REPLAY_BLOCK_RECORDS
+#define TNAV_REPLAY_BLOCK_RECORDS 512
+#endif
+
+//!TRN settings needed to replay a log (see the terrainAid.cfg keys of Replay)
+struct TNavReplayConfig
+{
+	char mapFile[TNAV_REPLAY_NAME_LEN];
+	char vehicleCfgFile[TNAV_REPLAY_NAME_LEN];
+	char particlesFile[TNAV_REPLAY_NAME_LEN];
+	int32_t mapType;
+	int32_t filterType;
+	int32_t forceLowGradeFilter;
+	int32_t allowFilterReinits;
+	int32_t modifiedWeighting;
+	int32_t reserved;
+};
+
+struct TNavReplayHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t blockRecords;
+	TNavReplayConfig config;
+};
+
+struct TNavReplayBlockHeader
+{
+	uint32_t magic;
+	uint32_t numRecords;
+	uint32_t numBeams;
+	uint32_t dataSize;     // bytes of column data following the header
+	uint32_t checksum;     // FNV-1a of the column data
+	uint32_t reserved;
+	double startTime;      // pose time of the first and last record
+	double endTime;
+};
+
+struct TNavReplayIndexEntry
+{
+	double startTime;
+	double endTime;
+	uint64_t offset;
+	uint32_t numRecords;
+	uint32_t reserved;
+};
+
+struct TNavReplayTrailer
+{
+	uint64_t indexOffset;
+	uint32_t numBlocks;
+	uint32_t reserved;
+	char magic[8];
+};
+
+
+/*! Columns of one block, decoded. Shared by the writer, which fills it one
+ * record at a time, and the reader, which decodes a whole block into it.
+ */
+struct TNavReplayColumns
+{
+	std::vector<double> values;      // floating point record fields, record by record
+	std::vector<int64_t> ints;       // integer record fields, record by record
+	std::vector<double> beamValues;  // floating point beam fields, beam by beam
+	std::vector<int64_t> beamInts;   // integer beam fields, beam by beam
+	std::vector<uint32_t> beamStart; // first beam of each record (reader only)
+	uint32_t numRecords;
+	uint32_t numBeams;
+
+	TNavReplayColumns() : numRecords(0), numBeams(0) {}
+	void clear();
+};
+
+
+class TNavReplayLogWriter
+{
+ public:
+
+  /* Constructor: TNavReplayLogWriter(blockRecords)
+   * Usage: log = new TNavReplayLogWriter();
+   * -------------------------------------------------------------------------*/
+  /*! Creates a writer that compresses blockRecords records per block. Larger
+   * blocks compress better; smaller blocks make seeks cheaper.
+   */
+  explicit TNavReplayLogWriter(int blockRecords = TNAV_REPLAY_BLOCK_RECORDS);
+
+  /* Destructor: ~TNavReplayLogWriter()
+   * -------------------------------------------------------------------------*/
+  /*! Closes the log if it is open.
+   */
+  ~TNavReplayLogWriter();
+
+  /* Function: open(fileName, config)
+   * Usage: ok = log->open("mission.trl", config);
+   * -------------------------------------------------------------------------*/
+  /*! Creates (or truncates) fileName and writes the header. Returns false if
+   * the file could not be created.
+   */
+  bool open(const char *fileName, const TNavReplayConfig &config);
+
+  /* Function: write(pt, mt, estimate)
+   * Usage: ok = log->write(pt, mt, &mmse);
+   * -------------------------------------------------------------------------*/
+  /*! Appends a record set. estimate is the MMSE estimate TRN made after the
+   * updates with pt and mt, or NULL if there is none. Records should be
+   * written in order of pose time for seeks to find them. Missing measT
+   * arrays are written as zeros. Returns false on a write error.
+   */
+  bool write(const poseT &pt, const measT &mt, const poseT *estimate = NULL);
+
+  /* Function: close()
+   * Usage: ok = log->close();
+   * -------------------------------------------------------------------------*/
+  /*! Writes the last block, the block index and the trailer and closes the
+   * file. Returns false on a write error.
+   */
+  bool close();
+
+  long numRecords() const { return numRecords_; }
+  uint64_t fileSize() const { return offset_; }
+
+ private:
+
+  bool flushBlock();
+  bool writeBytes(const void *data, size_t size);
+
+  FILE *file_;
+  int blockRecords_;
+  long numRecords_;
+  uint64_t offset_;
+  TNavReplayColumns block_;
+  std::vector<uint8_t> data_;
+  std::vector<TNavReplayIndexEntry> index_;
+
+  TNavReplayLogWriter(const TNavReplayLogWriter&);
+  TNavReplayLogWriter& operator=(const TNavReplayLogWriter&);
+};
+
+
+class TNavReplayLogReader
+{
+ public:
+
+  TNavReplayLogReader();
+  ~TNavReplayLogReader();
+
+  /* Function: open(fileName)
+   * Usage: ok = log->open("mission.trl");
+   * -------------------------------------------------------------------------*/
+  /*! Opens a replay log and loads its block index, rebuilding the index if
+   * the log was not closed. Returns false if the file is not a replay log.
+   */
+  bool open(const char *fileName);
+
+  void close();
+
+  /* Function: read(pt, mt, estimate, hasEstimate)
+   * Usage: while ((s = log->read(&pt, &mt, &mmse, &hasMmse)) > 0) ...
+   * -------------------------------------------------------------------------*/
+  /*! Reads the next record set into pt and mt. The measT arrays are
+   * (re)allocated with realloc to numMeas entries, as Replay does; the
+   * covariance array is not touched. If estimate is not NULL it receives the
+   * logged estimate, and hasEstimate whether there was one.
+   * Returns 1 if a record was read, 0 at the end of the log and -1 if a block
+   * is corrupt.
+   */
+  int read(poseT *pt, measT *mt, poseT *estimate = NULL, bool *hasEstimate = NULL);
+
+  /* Function: seek(time)
+   * Usage: ok = log->seek(startTime);
+   * -------------------------------------------------------------------------*/
+  /*! Positions the log at the first record with a pose time >= time. Only the
+   * block containing that record is decoded. Returns false if there is no
+   * such record or its block is corrupt.
+   */
+  bool seek(double time);
+
+  const TNavReplayConfig& config() const { return header_.config; }
+  long numRecords() const { return numRecords_; }
+  size_t numBlocks() const { return index_.size(); }
+  double startTime() const;
+  double endTime() const;
+
+ private:
+
+  bool loadIndex(off_t fileSize);
+  bool rebuildIndex(off_t fileSize);
+  bool loadBlock(size_t block);
+
+  FILE *file_;
+  TNavReplayHeader header_;
+  long numRecords_;
+  std::vector<TNavReplayIndexEntry> index_;
+  TNavReplayColumns block_;
+  std::vector<uint8_t> data_;
+  size_t blockNum_;  // index of the block in block_, index_.size() if none
+  size_t nextBlock_; // block to load when block_ is used up
+  uint32_t record_;  // next record of block_
+
+  TNavReplayLogReader(const TNavReplayLogReader&);
+  TNavReplayLogReader& operator=(const TNavReplayLogReader&);
+};
+
+#endif
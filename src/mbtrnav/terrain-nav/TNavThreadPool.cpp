@@ -0,0 +1,148 @@
+/* FILENAME      : TNavThreadPool.cpp
+ * DATE          : 10/16/26
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ ******************************************************************************/
+
+#include "TNavThreadPool.h"
+
+TNavThreadPool::
+TNavThreadPool(int nThreads) :
+fn_(NULL), n_(0), nChunks_(0), generation_(0), pending_(0), stop_(false)
+{
+	if(nThreads <= 0) {
+		nThreads = (int)std::thread::hardware_concurrency();
+	}
+	if(nThreads < 1) {
+		nThreads = 1;
+	}
+	if(nThreads > TNAV_MAX_THREADS) {
+		nThreads = TNAV_MAX_THREADS;
+	}
+	nThreads_ = nThreads;
+	errors_.resize(nThreads_);
+
+	for(int i = 1; i < nThreads_; i++) {
+		workers_.push_back(std::thread(&TNavThreadPool::workerLoop, this, i));
+	}
+}
+
+
+TNavThreadPool::
+~TNavThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	startCond_.notify_all();
+	for(size_t i = 0; i < workers_.size(); i++) {
+		workers_[i].join();
+	}
+}
+
+//********************************************************************************
+
+int
+TNavThreadPool::
+numChunks(int n, int minChunk) const {
+	if(minChunk < 1) {
+		minChunk = 1;
+	}
+	int nChunks = n / minChunk;
+	if(nChunks > nThreads_) {
+		nChunks = nThreads_;
+	}
+	if(nChunks < 1) {
+		nChunks = 1;
+	}
+	return nChunks;
+}
+
+//********************************************************************************
+
+void
+TNavThreadPool::
+runChunk(int chunk) {
+	int begin = (int)((long)n_ * chunk / nChunks_);
+	int end = (int)((long)n_ * (chunk + 1) / nChunks_);
+	try {
+		(*fn_)(chunk, begin, end);
+	} catch(...) {
+		errors_[chunk] = std::current_exception();
+	}
+}
+
+//********************************************************************************
+
+void
+TNavThreadPool::
+workerLoop(int worker) {
+	unsigned long seen = 0;
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			startCond_.wait(lock, [&]{ return stop_ || generation_ != seen; });
+			if(stop_) {
+				return;
+			}
+			seen = generation_;
+			if(worker >= nChunks_) {
+				continue;
+			}
+		}
+
+		runChunk(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(--pending_ == 0) {
+				doneCond_.notify_one();
+			}
+		}
+	}
+}
+
+//********************************************************************************
+
+void
+TNavThreadPool::
+run(int n, int minChunk, const std::function<void(int, int, int)>& fn) {
+	if(n <= 0) {
+		return;
+	}
+	int nChunks = numChunks(n, minChunk);
+
+	// Single chunk: no need to wake anybody up
+	if(nChunks == 1) {
+		fn(0, 0, n);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		fn_ = &fn;
+		n_ = n;
+		nChunks_ = nChunks;
+		pending_ = nChunks - 1;
+		for(int i = 0; i < nChunks; i++) {
+			errors_[i] = std::exception_ptr();
+		}
+		generation_++;
+	}
+	startCond_.notify_all();
+
+	runChunk(0);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		doneCond_.wait(lock, [&]{ return pending_ == 0; });
+		fn_ = NULL;
+	}
+
+	for(int i = 0; i < nChunks; i++) {
+		if(errors_[i]) {
+			std::rethrow_exception(errors_[i]);
+		}
+	}
+}
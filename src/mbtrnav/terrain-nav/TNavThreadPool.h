@@ -0,0 +1,103 @@
+/* FILENAME      : TNavThreadPool.h
+ * DATE          : 10/16/26
+ * DESCRIPTION   : TNavThreadPool is a small fixed-size pool of worker threads
+ *                 used by the TRN filters to split per-particle work across
+ *                 cores. Work is always partitioned into the same contiguous
+ *                 index ranges for a given pool size so that callers can
+ *                 reduce per-chunk results in a deterministic order.
+ * DEPENDENCIES  : none (C++11 standard library)
+ * -----------------------------------------------------------------------------
+ * Modification History
+ * -----------------------------------------------------------------------------
+ *
+ ******************************************************************************/
+
+#ifndef _TNavThreadPool_h
+#define _TNavThreadPool_h
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//!maximum number of threads in a TNavThreadPool
+#ifndef TNAV_MAX_THREADS
+#define TNAV_MAX_THREADS 16
+#endif
+
+class TNavThreadPool
+{
+ public:
+
+  /* Constructor: TNavThreadPool(nThreads)
+   * Usage: pool = new TNavThreadPool(4);
+   * -------------------------------------------------------------------------*/
+  /*! Creates a pool that runs work on nThreads threads, one of which is the
+   * calling thread. A value of 0 selects the number of available cores.
+   * The value is clamped to [1, TNAV_MAX_THREADS].
+   */
+  explicit TNavThreadPool(int nThreads = 0);
+
+
+  /* Destructor: ~TNavThreadPool()
+   * Usage: delete pool;
+   * -------------------------------------------------------------------------*/
+  /*! Stops and joins all worker threads.
+   */
+  ~TNavThreadPool();
+
+
+  /* Function: numThreads()
+   * Usage: n = pool->numThreads();
+   * -------------------------------------------------------------------------*/
+  /*! Returns the number of threads (including the caller) used by run().
+   */
+  int numThreads() const { return nThreads_; }
+
+
+  /* Function: numChunks(n, minChunk)
+   * Usage: nChunks = pool->numChunks(nParticles, 64);
+   * -------------------------------------------------------------------------*/
+  /*! Returns the number of chunks run() will split n items into when each
+   * chunk must hold at least minChunk items.
+   */
+  int numChunks(int n, int minChunk) const;
+
+
+  /* Function: run(n, minChunk, fn)
+   * Usage: pool->run(nParticles, 64, fn);
+   * -------------------------------------------------------------------------*/
+  /*! Splits [0, n) into numChunks(n, minChunk) contiguous ranges and calls
+   * fn(chunk, begin, end) once for each, chunk 0 on the calling thread and
+   * the rest on the workers. Blocks until all chunks complete. If any chunk
+   * throws, the exception from the lowest numbered chunk is rethrown here.
+   */
+  void run(int n, int minChunk, const std::function<void(int, int, int)>& fn);
+
+ private:
+
+  TNavThreadPool(const TNavThreadPool&);
+  TNavThreadPool& operator=(const TNavThreadPool&);
+
+  void workerLoop(int worker);
+  void runChunk(int chunk);
+
+  int nThreads_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable startCond_;
+  std::condition_variable doneCond_;
+
+  // state of the current run, guarded by mutex_
+  const std::function<void(int, int, int)>* fn_;
+  int n_;
+  int nChunks_;
+  unsigned long generation_;
+  int pending_;
+  bool stop_;
+  std::vector<std::exception_ptr> errors_;
+};
+
+#endif
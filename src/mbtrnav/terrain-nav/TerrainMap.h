@@ -11,6 +11,7 @@
 
 #include <cmath>
 #include "structDefs.h"
+#include "TNavThreadPool.h"
 
 #define VARIOGRAM_FRACTAL_DIM 2.234
 #define VARIOGRAM_ALPHA 0.0066
@@ -32,6 +33,47 @@ class TerrainMap{
 		virtual ~TerrainMap(void){}
 		
 		virtual double GetRangeError(double& mapVariance, const double* const startPoint, const double* const directionVector, double expectedDistance) = 0;
+
+		//Batch form of GetRangeError for n start points given as separate
+		//north, east and down arrays that share one direction vector and range.
+		//rangeErrors[k] holds the result for point k and mapVariance is left as
+		//GetRangeError would leave it after the last point.
+		virtual void GetRangeErrors(double& mapVariance, int n, const double* north, const double* east,
+					    const double* down, const double* const directionVector,
+					    double expectedDistance, double* rangeErrors) {
+			double startPoint[3];
+			for(int k = 0; k < n; k++) {
+				startPoint[0] = north[k];
+				startPoint[1] = east[k];
+				startPoint[2] = down[k];
+				rangeErrors[k] = GetRangeError(mapVariance, startPoint, directionVector, expectedDistance);
+			}
+		}
+
+		//Casts n rays into the map. Ray k starts at origins[3k..3k+2] (north, east,
+		//down) and points along directions[3k..3k+2], which need not be unit length.
+		//ranges[k] is the distance from the origin to the first intersection with the
+		//map, or NAN if the ray misses the map or reaches a hole in it. If variances
+		//is not NULL, variances[k] is the map variance for that range. The rays are
+		//traced in whatever order is cheapest for the map, so batches of rays from
+		//nearby origins cost less per ray than the same rays cast one at a time.
+		virtual void RayCast(int n, const double* origins, const double* directions,
+				     double* ranges, double* variances) = 0;
+
+		//RayCast with the rays split into contiguous blocks of at least minChunk
+		//rays across the threads of pool. A NULL pool casts on the calling thread.
+		void ParallelRayCast(TNavThreadPool* pool, int n, const double* origins,
+				     const double* directions, double* ranges, double* variances,
+				     int minChunk = 256) {
+			if(NULL == pool) {
+				RayCast(n, origins, directions, ranges, variances);
+				return;
+			}
+			pool->run(n, minChunk, [&](int, int begin, int end) {
+				RayCast(end - begin, origins + 3 * begin, directions + 3 * begin,
+					ranges + begin, (NULL == variances) ? NULL : variances + begin);
+			});
+		}
 		//virtual double QueryMap(double const * const queryPoint) = 0;
 		
 		virtual int loadSubMap(const double xcen, const double ycen, double* mapWidth,
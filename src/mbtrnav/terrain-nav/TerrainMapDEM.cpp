@@ -2,9 +2,14 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include "mapio.h"
 #include "genFilterDefs.h"
 #include "trn_log.h"
+#include "TNavKernels.h"
+
+//number of points GetRangeErrors() projects at a time
+#define RANGE_ERROR_BLOCK 256
 
 
 double
@@ -64,6 +69,78 @@ GetRangeError(double& mapVariance, const double* const startPoint, const double*
 	}
     return rangeError;
 }
+
+// Batch form of the projection method. Depths are looked up with
+// interpolateDepthFast(), which does not allocate and skips the interpolation
+// variance; only the variance of the last point is reported, so only that
+// point and the points the fast lookup cannot handle use interpolateDepth().
+void
+TerrainMapDEM::
+GetRangeErrors(double& mapVariance, int n, const double* north, const double* east,
+	const double* down, const double* const directionVector, double measuredDistance,
+	double* rangeErrors) {
+	if(USE_RANGE_CORR || this->map.xpts == NULL ||
+	   (this->interpMapMethod != 0 && this->interpMapMethod != 1)) {
+		TerrainMap::GetRangeErrors(mapVariance, n, north, east, down, directionVector,
+			measuredDistance, rangeErrors);
+		return;
+	}
+
+	double beamN[RANGE_ERROR_BLOCK], beamE[RANGE_ERROR_BLOCK], beamZ[RANGE_ERROR_BLOCK];
+	for(int k0 = 0; k0 < n; k0 += RANGE_ERROR_BLOCK) {
+		int m = (n - k0 < RANGE_ERROR_BLOCK) ? n - k0 : RANGE_ERROR_BLOCK;
+		projectBeams(m, north + k0, east + k0, down + k0, directionVector, beamN, beamE, beamZ);
+
+		for(int k = 0; k < m; k++) {
+			double mapZ;
+			if(k0 + k == n - 1 || !interpolateDepthFast(beamN[k], beamE[k], mapZ)) {
+				interpolateDepth(beamN[k], beamE[k], mapZ, mapVariance);
+			}
+
+			//same outcome as GetRangeError()
+			if(!ISNIN(mapZ) && !ISNIN(beamZ[k])) {
+				rangeErrors[k0 + k] = beamZ[k] - mapZ;
+			} else if(!USE_MAP_NAN) {
+				rangeErrors[k0 + k] = ISNIN(mapZ) ? mapZ : beamZ[k];
+			} else {
+				rangeErrors[k0 + k] = 0;
+			}
+		}
+	}
+}
+
+// Casts each ray with castRayDDA(). The variance of a range is the
+// interpolation variance of the map at the intersection.
+void
+TerrainMapDEM::
+RayCast(int n, const double* origins, const double* directions, double* ranges,
+	double* variances) {
+	for(int k = 0; k < n; k++) {
+		const double* origin = origins + 3 * k;
+		const double* direction = directions + 3 * k;
+		double length = sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+			direction[2] * direction[2]);
+		double u[3] = {0., 0., 0.};
+
+		ranges[k] = NAN;
+		if(this->map.xpts != NULL && length > 0.) {
+			u[0] = direction[0] / length;
+			u[1] = direction[1] / length;
+			u[2] = direction[2] / length;
+			ranges[k] = castRayDDA(origin, u);
+		}
+
+		if(variances != NULL) {
+			variances[k] = NAN;
+			if(!ISNIN(ranges[k])) {
+				double z;
+				interpolateDepth(origin[0] + ranges[k] * u[0], origin[1] + ranges[k] * u[1],
+					z, variances[k]);
+			}
+		}
+	}
+}
+
 /*
 double
 TerrainMapDEM::
@@ -77,6 +154,8 @@ QueryMap(const double* const queryPoint) {
 TerrainMapDEM::
 TerrainMapDEM(const char* mapName) {
 	interpMapMethod = 0;
+	lastCenN = lastCenE = 0.;
+	haveLastCen = false;
 	this->refMap = new refMapT;
 	setRefMap(mapName);
 }
@@ -86,6 +165,7 @@ TerrainMapDEM::
 loadSubMap(const double xcen, const double ycen, double* mapWidth, double vehN, double vehE)
 {
 	int mapStatus = this->extractSubMap(xcen, ycen, mapWidth);
+	prefetchSubMap(xcen, ycen, mapWidth);
 
 	switch(mapStatus) {
 
@@ -112,6 +192,29 @@ loadSubMap(const double xcen, const double ycen, double* mapWidth, double vehN,
 	return mapStatus;
 }
 
+// Queues the map tiles of the submap one window ahead of the vehicle for
+// loading in the background. The track is extrapolated from the motion of
+// the submap center since the previous call.
+void
+TerrainMapDEM::
+prefetchSubMap(const double xcen, const double ycen, const double* mapWidth) {
+	double dN = xcen - lastCenN;
+	double dE = ycen - lastCenE;
+	double dist = sqrt(dN * dN + dE * dE);
+
+	if(haveLastCen && dist > 0.) {
+		double lead = (mapWidth[0] > mapWidth[1]) ? mapWidth[0] : mapWidth[1];
+		double north = xcen + lead * dN / dist;
+		double east = ycen + lead * dE / dist;
+		mapsrc_tiles_prefetch(this->refMap->src, east, north, mapWidth[1], mapWidth[0]);
+		mapsrc_tiles_prefetch(this->refMap->varSrc, east, north, mapWidth[1], mapWidth[0]);
+	}
+
+	lastCenN = xcen;
+	lastCenE = ycen;
+	haveLastCen = true;
+}
+
 TerrainMapDEM::
 ~TerrainMapDEM() {
 	delete refMap;
@@ -124,6 +227,7 @@ setLowResMap(const char* mapName){
 	if(this->refMap->lowResSrc == NULL) {
 		this->refMap->lowResSrc = mapsrc_init();
 		mapsrc_fill(mapName, this->refMap->lowResSrc);
+		mapsrc_tiles_enable(this->refMap->lowResSrc, MAPIO_TILE_DIM, MAPIO_TILE_CACHE_SIZE);
 	}
 
 	if(this->refMap->lowResSrc->status != MAPSRC_IS_FILLED) {
@@ -238,6 +342,10 @@ setRefMap(const char* mapName){
 		mapsrc_free(&this->refMap->varSrc);
 	}
 
+	//serve submap extraction from in-memory tiles rather than netCDF reads
+	mapsrc_tiles_enable(this->refMap->src, MAPIO_TILE_DIM, MAPIO_TILE_CACHE_SIZE);
+	mapsrc_tiles_enable(this->refMap->varSrc, MAPIO_TILE_DIM, MAPIO_TILE_CACHE_SIZE);
+
 	//set map bounds structure for new reference map
 	this->refMap->bounds = mapbounds_init();
 	tempBounds = mapbounds_init();
@@ -326,6 +434,150 @@ computeMapRayIntersection(const double* position, double* u, double& r, double&
 }
 
 
+double
+TerrainMapDEM::
+castRayDDA(const double* origin, const double* u) {
+	const double* xpts = this->map.xpts;
+	const double* ypts = this->map.ypts;
+	int nRows = this->map.depths.Nrows();
+	int nCols = this->map.depths.Ncols();
+
+	if(nRows < 2 || nCols < 2) {
+		return NAN;
+	}
+
+	//clip the ray to the horizontal extent of the map
+	const double lower[2] = {xpts[0], ypts[0]};
+	const double upper[2] = {xpts[nRows - 1], ypts[nCols - 1]};
+	double tEnter = 0.;
+	double tExit = HUGE_VAL;
+	for(int a = 0; a < 2; a++) {
+		if(u[a] == 0.) {
+			if(origin[a] < lower[a] || origin[a] > upper[a]) {
+				return NAN;
+			}
+		} else {
+			double ta = (lower[a] - origin[a]) / u[a];
+			double tb = (upper[a] - origin[a]) / u[a];
+			if(ta > tb) {
+				std::swap(ta, tb);
+			}
+			tEnter = std::max(tEnter, ta);
+			tExit = std::min(tExit, tb);
+		}
+	}
+	if(tEnter > tExit) {
+		return NAN;
+	}
+
+	//cell containing the entry point
+	double t = tEnter;
+	int i = lowerBound(origin[0] + t * u[0], xpts, nRows);
+	int j = lowerBound(origin[1] + t * u[1], ypts, nCols);
+	i = std::min(std::max(i, 0), nRows - 2);
+	j = std::min(std::max(j, 0), nCols - 2);
+
+	//distances along the ray to the next cell boundary in x and y
+	int stepI = (u[0] > 0.) ? 1 : -1;
+	int stepJ = (u[1] > 0.) ? 1 : -1;
+	double tNextX = (u[0] == 0.) ? HUGE_VAL : (xpts[i + (u[0] > 0.)] - origin[0]) / u[0];
+	double tNextY = (u[1] == 0.) ? HUGE_VAL : (ypts[j + (u[1] > 0.)] - origin[1]) / u[1];
+
+	//walk the cells the ray crosses until it meets the surface
+	while(true) {
+		double tCellExit = std::min(std::min(tNextX, tNextY), tExit);
+		double tHit = intersectCell(i, j, origin, u, t, tCellExit);
+		if(tHit != -1.) {
+			return tHit;
+		}
+		if(tCellExit >= tExit) {
+			return NAN;
+		}
+
+		if(tNextX < tNextY) {
+			i += stepI;
+			t = tNextX;
+			if(i < 0 || i > nRows - 2) {
+				return NAN;
+			}
+			tNextX = (xpts[i + (u[0] > 0.)] - origin[0]) / u[0];
+		} else {
+			j += stepJ;
+			t = tNextY;
+			if(j < 0 || j > nCols - 2) {
+				return NAN;
+			}
+			tNextY = (ypts[j + (u[1] > 0.)] - origin[1]) / u[1];
+		}
+	}
+}
+
+double
+TerrainMapDEM::
+intersectCell(int i, int j, const double* origin, const double* u, double t0, double t1) {
+	const double* xpts = this->map.xpts;
+	const double* ypts = this->map.ypts;
+	const Real* z = this->map.depths.Store();
+	int nCols = this->map.depths.Ncols();
+
+	double z00 = z[i * nCols + j];
+	double z10 = z[(i + 1) * nCols + j];
+	double z01 = z[i * nCols + j + 1];
+	double z11 = z[(i + 1) * nCols + j + 1];
+	if(ISNIN(z00) || ISNIN(z10) || ISNIN(z01) || ISNIN(z11)) {
+		return NAN;
+	}
+	//depths are positive down, as in computeMapRayIntersection()
+	z00 = fabs(z00);
+	z10 = fabs(z10);
+	z01 = fabs(z01);
+	z11 = fabs(z11);
+
+	//cell coordinates (0 to 1) of the ray at t0 and their rates of change
+	double s0 = (origin[0] + t0 * u[0] - xpts[i]) / (xpts[i + 1] - xpts[i]);
+	double r0 = (origin[1] + t0 * u[1] - ypts[j]) / (ypts[j + 1] - ypts[j]);
+	double ds = u[0] / (xpts[i + 1] - xpts[i]);
+	double dr = u[1] / (ypts[j + 1] - ypts[j]);
+
+	//ray depth minus surface depth at t0 + tau is C + B*tau + A*tau^2
+	double b = z10 - z00;
+	double c = z01 - z00;
+	double d = z00 - z10 - z01 + z11;
+	double C = origin[2] + t0 * u[2] - (z00 + b * s0 + c * r0 + d * s0 * r0);
+	double B = u[2] - (b * ds + c * dr + d * (s0 * dr + r0 * ds));
+	double A = -d * ds * dr;
+
+	if(C >= 0.) {
+		return t0;
+	}
+
+	//smallest positive root
+	double tau = -1.;
+	if(A == 0.) {
+		if(B > 0.) {
+			tau = -C / B;
+		}
+	} else {
+		double disc = B * B - 4. * A * C;
+		if(disc >= 0.) {
+			//C < 0, so q != 0
+			double q = -0.5 * (B + ((B >= 0.) ? sqrt(disc) : -sqrt(disc)));
+			double root1 = q / A;
+			double root2 = C / q;
+			if(root1 > root2) {
+				std::swap(root1, root2);
+			}
+			tau = (root1 > 0.) ? root1 : root2;
+		}
+	}
+
+	if(tau <= 0. || t0 + tau > t1) {
+		return -1.;
+	}
+	return t0 + tau;
+}
+
+
 //Interpolate functions
 void
 TerrainMapDEM::
@@ -412,6 +664,43 @@ interpolateDepth(double xi, double yi, double& zi, double& var) {
 	return;
 }
 
+// Computes the same depth as interpolateDepth() for the nearest neighbor and
+// bilinear methods, reading the submap directly. Returns false when
+// interpolateDepth() is needed instead: a grid value used is NaN or the point
+// is off the submap edge.
+bool
+TerrainMapDEM::
+interpolateDepthFast(double xi, double yi, double& zi) {
+	const double* xpts = this->map.xpts;
+	const double* ypts = this->map.ypts;
+	const Real* z = this->map.depths.Store();
+	int nRows = this->map.depths.Nrows();
+	int nCols = this->map.depths.Ncols();
+
+	if(this->interpMapMethod == 0) {
+		int x1 = closestPtUniformArray(xi, xpts[0], xpts[nRows - 1], nRows);
+		int y1 = closestPtUniformArray(yi, ypts[0], ypts[nCols - 1], nCols);
+		zi = z[x1 * nCols + y1];
+		return !ISNIN(zi);
+	}
+
+	int x1 = lowerBound(xi, xpts, nRows);
+	int y1 = lowerBound(yi, ypts, nCols);
+	if((x1 >= nRows - 1) || (x1 < 0) || (y1 >= nCols - 1) || (y1 < 0)) {
+		return false;
+	}
+
+	//weights and summation order as in bilinearInterp()
+	double t = (xi - xpts[x1]) / (xpts[x1 + 1] - xpts[x1]);
+	double u = (yi - ypts[y1]) / (ypts[y1 + 1] - ypts[y1]);
+	zi = 0.0;
+	zi += ((1 - t) * (1 - u)) * z[x1 * nCols + y1];
+	zi += (t * (1 - u)) * z[(x1 + 1) * nCols + y1];
+	zi += (t * u) * z[(x1 + 1) * nCols + y1 + 1];
+	zi += ((1 - t) * u) * z[x1 * nCols + y1 + 1];
+	return !ISNIN(zi);
+}
+
 double
 TerrainMapDEM::
 getNearestLowResMapPoint(const double north, const double east, double& nearestNorth, double& nearestEast) {
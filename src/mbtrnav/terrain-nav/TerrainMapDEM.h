@@ -51,6 +51,11 @@ Documentation form TNavFilter and ParticleFilter is grouped together at the bott
 class TerrainMapDEM : public TerrainMap{
 	public:
 		double GetRangeError(double& mapVariance, const double* const startPoint, const double* const directionVector, double expectedDistance);
+		void GetRangeErrors(double& mapVariance, int n, const double* north, const double* east,
+				    const double* down, const double* const directionVector,
+				    double expectedDistance, double* rangeErrors);
+		void RayCast(int n, const double* origins, const double* directions,
+			     double* ranges, double* variances);
 		//double QueryMap(double const * const queryPoint);
 		
 		int loadSubMap(const double xcen, const double ycen, double* mapWidth,
@@ -73,7 +78,10 @@ class TerrainMapDEM : public TerrainMap{
 		
 	private:
 		bool computeMapRayIntersection(const double* position, double *u, double& r, double &var);   
+		double castRayDDA(const double* origin, const double* u);
+		double intersectCell(int i, int j, const double* origin, const double* u, double t0, double t1);
 		void interpolateDepth(double xi, double yi, double &zi, double &var);
+		bool interpolateDepthFast(double xi, double yi, double &zi);
 		double getNearestLowResMapPoint(const double north, const double east, double& nearestNorth, double& nearestEast);
 		double computeInterpDepthVariance(int* xIndices, int* yIndices, ColumnVector Weights);
 		
@@ -81,11 +89,16 @@ class TerrainMapDEM : public TerrainMap{
 		int extractSubMap(const double north, const double east, double* mapParams);
 		void convertMapdataToMapT(mapdata* currMapStruct);
 		int extractVarMap(const double north, const double east, double* mapParams);
+		void prefetchSubMap(const double xcen, const double ycen, const double* mapWidth);
 	
 	private:
 		//were public
 		mapT map;
 		refMapT* refMap;
+
+		//center of the last submap requested, used to predict the next one
+		double lastCenN, lastCenE;
+		bool haveLastCen;
 		
 		
 		
@@ -126,6 +139,26 @@ class TerrainMapDEM : public TerrainMap{
   //bool computeMapRayIntersection(const double* position, double *u, double &r,
 	//			 double &var);   
 
+  /* Helper Function: castRayDDA
+   * Usage: r = castRayDDA(origin, u)
+   * -------------------------------------------------------------------------*/
+  /*! Returns the distance along the unit vector u from origin to the first
+   * point at or below the bilinear surface through the extracted map's grid
+   * points, walking the grid cells the ray crosses in order (a 2D DDA), or NAN
+   * if the ray leaves the extracted map or enters a cell with a missing depth
+   * first. Unlike computeMapRayIntersection, the first intersection is always
+   * found and the cost is bounded by the number of cells crossed. Used by
+   * RayCast.
+   */
+
+  /* Helper Function: intersectCell
+   * Usage: t = intersectCell(i, j, origin, u, t0, t1)
+   * -------------------------------------------------------------------------*/
+  /*! Returns the smallest t in [t0, t1] at which origin + t*u is at or below
+   * the bilinear surface of grid cell (i, j), -1 if there is none, or NAN if
+   * a corner of the cell has no depth.
+   */
+
 	//TODO: This should go to TerrainMap
   /* Helper Function: interpolateDepth
    * Usage: interpolateDepth(xi, yi, zi, variance)
@@ -22,6 +22,7 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fstream>
+#include <vector>
 
 #include "TerrainMapOctree.h"
 #include "OctreeSupport.hpp"
@@ -43,6 +44,7 @@
 TerrainMapOctree::TerrainMapOctree(const char* mapName)
 :
 OctreeMap(NULL),
+LinearMap(NULL),
 numTiles_(0),
 minDistTile_(0),
 lastMinDistTile_(0),
@@ -85,8 +87,7 @@ tiles_(NULL)
    logs(TL_LOG,"TerrainMapOctree::Octree tile load %s took %f seconds.",
       tiles_[0].mapName, duration);
 
-   OctreeMap = tiles_[0].octreeMap;
-   OctreeMap->Print();
+   useTile(tiles_[0]);
 
 }
 
@@ -97,7 +98,7 @@ TerrainMapOctree::~TerrainMapOctree()
    {
       for (int i = 0; i < numTiles_; i++)
       {
-         if (tiles_[i].octreeMap) tiles_[i].unload();
+         tiles_[i].unload();
           if (tiles_[i].mapName) free(tiles_[i].mapName); //delete tiles_[i].mapName;
       }
       delete [] tiles_;
@@ -124,9 +125,11 @@ double TerrainMapOctree::GetRangeError(double& mapVariance,
    Vector octreeVectorDirectionVector (directionVector[0], directionVector[1], directionVector[2]);
 
    //TODO work out variance properly
-   mapVariance = OctreeMap->GetTrueResolution().Norm()/1.0;//1.73;//3.4641 is 2*sqrt(3)
+   mapVariance = GetTrueResolution().Norm()/1.0;//1.73;//3.4641 is 2*sqrt(3)
 
-   double predictedDistance = OctreeMap->RayTrace(octreeVectorStartPoint, octreeVectorDirectionVector);
+   double predictedDistance = (LinearMap != NULL)
+      ? LinearMap->RayTrace(octreeVectorStartPoint, octreeVectorDirectionVector)
+      : OctreeMap->RayTrace(octreeVectorStartPoint, octreeVectorDirectionVector);
    if (predictedDistance == -1)
    {
       //missed the map
@@ -135,10 +138,78 @@ double TerrainMapOctree::GetRangeError(double& mapVariance,
    return expectedDistance - predictedDistance;
 }
 
+
+// Batch form of GetRangeError. Linear octree maps trace the whole batch
+// with LinearOctree's batch RayTrace, which orders the rays so that they
+// share the upper levels of the tree; Octree maps trace one point at a time.
+void TerrainMapOctree::GetRangeErrors(double& mapVariance, int n,
+   const double* north, const double* east, const double* down,
+   const double* const directionVector, double expectedDistance,
+   double* rangeErrors)
+{
+   if (LinearMap == NULL || NULL == directionVector || n <= 0)
+   {
+      TerrainMap::GetRangeErrors(mapVariance, n, north, east, down,
+         directionVector, expectedDistance, rangeErrors);
+      return;
+   }
+
+   //same as GetRangeError()
+   mapVariance = GetTrueResolution().Norm()/1.0;
+
+   std::vector<Vector> startPoints(n);
+   std::vector<Vector> directionVectors(n,
+      Vector(directionVector[0], directionVector[1], directionVector[2]));
+   for (int k = 0; k < n; k++)
+      startPoints[k].SetValues(north[k], east[k], down[k]);
+
+   LinearMap->RayTrace(n, &startPoints[0], &directionVectors[0], rangeErrors);
+
+   for (int k = 0; k < n; k++)
+   {
+      //NAN if the ray missed the map
+      rangeErrors[k] = (rangeErrors[k] == -1) ? NAN : expectedDistance - rangeErrors[k];
+   }
+}
+
+
+void TerrainMapOctree::RayCast(int n, const double* origins,
+   const double* directions, double* ranges, double* variances)
+{
+   if (n <= 0) return;
+
+   std::vector<Vector> startPoints(n);
+   std::vector<Vector> directionVectors(n);
+   for (int k = 0; k < n; k++)
+   {
+      startPoints[k].SetValues(origins[3*k], origins[3*k+1], origins[3*k+2]);
+      directionVectors[k].SetValues(directions[3*k], directions[3*k+1], directions[3*k+2]);
+   }
+
+   if (LinearMap != NULL)
+   {
+      LinearMap->RayTrace(n, &startPoints[0], &directionVectors[0], ranges);
+   }
+   else
+   {
+      for (int k = 0; k < n; k++)
+         ranges[k] = OctreeMap->RayTrace(startPoints[k], directionVectors[k]);
+   }
+
+   //TODO work out variance properly (as GetRangeError())
+   double mapVariance = GetTrueResolution().Norm()/1.0;
+   for (int k = 0; k < n; k++)
+   {
+      if (ranges[k] == -1) ranges[k] = NAN;
+      if (variances != NULL) variances[k] = mapVariance;
+   }
+}
+
 #ifdef WITH_QUERYMAP
 double TerrainMapOctree::QueryMap(const double* const queryPoint)
 {
    //return static_cast<double>(OctreeMap->Query(queryPoint));
+   if (LinearMap != NULL) return LinearMap->InterpolatingQuery(queryPoint);
    return OctreeMap->InterpolatingQuery(queryPoint);
 }
 #endif
@@ -164,7 +235,7 @@ bool TerrainMapOctree::tileLoadTest()
             tiles_[i].mapName);
       if (tiles_[i].load())
       {
-         tiles_[i].octreeMap->Print();
+         tiles_[i].print();
          if (!tiles_[i].unload())
             logs(TL_LOG|TL_SERR,"TerrainMapOctree::unload of tile %s failed",
                tiles_[i].mapName);
@@ -403,8 +474,7 @@ int TerrainMapOctree::loadSubMap(const double xcen, const double ycen,
 
       // Switch the pointer and we're ready to use
       lastMinDistTile_ = minDistTile_;
-      OctreeMap = tiles_[minDistTile_].octreeMap;
-      OctreeMap->Print();
+      useTile(tiles_[minDistTile_]);
 
    }
 
@@ -413,8 +483,8 @@ int TerrainMapOctree::loadSubMap(const double xcen, const double ycen,
 
 bool TerrainMapOctree::withinRefMap(const double northPos, const double eastPos)
 {
-   Vector LowerBounds = OctreeMap->GetLowerBounds();
-   Vector UpperBounds = OctreeMap->GetUpperBounds();
+   Vector LowerBounds = (LinearMap != NULL) ? LinearMap->GetLowerBounds() : OctreeMap->GetLowerBounds();
+   Vector UpperBounds = (LinearMap != NULL) ? LinearMap->GetUpperBounds() : OctreeMap->GetUpperBounds();
 
    return ((northPos < UpperBounds.x)
       && (northPos > LowerBounds.x)
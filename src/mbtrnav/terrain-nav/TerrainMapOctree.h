@@ -3,6 +3,7 @@
 
 #include "TerrainMap.h"
 #include "Octree.hpp"
+#include "LinearOctree.hpp"
 
 #include "mapio.h"
 
@@ -11,11 +12,19 @@ class PlanarFitNode;
 TerrainMapOctree is a wrapper for the Octreeclass to make it useful for TNavFilter.
 
 Several of these functions are DEM specific, and are included here only to standardize the interface for the two map types.
+
+Map (or tile) files may be Octree files (.bo), which are loaded into an Octree, or linear
+octree files (see LinearOctree.hpp, octree2linear), which are mapped into a LinearOctree.
 */
 
 class TerrainMapOctree : public TerrainMap{
 	public:
 		double GetRangeError(double& mapVariance, const double* const startPoint, const double* const directionVector, double expectedDistance);
+		void GetRangeErrors(double& mapVariance, int n, const double* north, const double* east,
+				    const double* down, const double* const directionVector,
+				    double expectedDistance, double* rangeErrors);
+		void RayCast(int n, const double* origins, const double* directions,
+			     double* ranges, double* variances);
 
 #ifdef WITH_QUERYMAP
 		double QueryMap(const double[3] queryPoint);
@@ -38,8 +47,8 @@ class TerrainMapOctree : public TerrainMap{
 		bool GetMapT(mapT& currMap);
 		bool GetMapBounds(double* currMapBounds);
 
-		double Getdx(void){ return OctreeMap->GetTrueResolution().x; }
-		double Getdy(void){ return OctreeMap->GetTrueResolution().y; }
+		double Getdx(void){ return GetTrueResolution().x; }
+		double Getdy(void){ return GetTrueResolution().y; }
 
 
 	private:
@@ -49,12 +58,15 @@ class TerrainMapOctree : public TerrainMap{
 		// Center values not used in this iteration
 		//double northingCenter_, eastEastingCenter_, westEastingCenter_;
 
+		// current tile map; exactly one of these is set
 		Octree<bool> *OctreeMap;
+		LinearOctree<bool> *LinearMap;
 		int numTiles_, minDistTile_, lastMinDistTile_;
 
 		struct MapTile
 		{
 		   Octree<bool> *octreeMap;
+		   LinearOctree<bool> *linearMap;
 		   char *mapName;
 		   double northing;
 		   double easting;
@@ -62,6 +74,7 @@ class TerrainMapOctree : public TerrainMap{
             MapTile()
             :
             octreeMap(NULL),
+            linearMap(NULL),
             mapName(NULL),
             northing(0.),
             easting(0.)
@@ -70,11 +83,16 @@ class TerrainMapOctree : public TerrainMap{
 		   bool load()
 		   {
 		   	// unload unless the map is NULL
-		   	if (octreeMap != NULL) unload();
+		   	if (octreeMap != NULL || linearMap != NULL) unload();
 
-		   	// Load file mapName
+		   	// Load file mapName (linear octree files are mapped, not loaded)
 		   	if (mapName != NULL)
 		   	{
+		   		if (LinearOctree<bool>::IsLinearOctreeFile(mapName))
+		   		{
+		   			linearMap = new LinearOctree<bool>();
+		   			return linearMap->LoadFromFile(mapName);
+		   		}
 		   		octreeMap = new Octree<bool>();
 		   		return octreeMap->LoadFromFile(mapName);
 		   	}
@@ -82,6 +100,12 @@ class TerrainMapOctree : public TerrainMap{
 		   		return false;
 		   }
 
+		   void print()
+		   {
+		   	if (linearMap != NULL) linearMap->Print();
+		   	else if (octreeMap != NULL) octreeMap->Print();
+		   }
+
 		   bool unload()
 		   {
 		   	// Unless the map is already NULL, delete the octree from memory
@@ -90,12 +114,29 @@ class TerrainMapOctree : public TerrainMap{
 		   		delete octreeMap;
 		   		octreeMap = NULL;
 		   	}
+		   	if (linearMap != NULL)
+		   	{
+		   		delete linearMap;
+		   		linearMap = NULL;
+		   	}
 
 		   	return true;
 		   }
 		};
 
 		MapTile *tiles_;
+
+		void useTile(MapTile& tile)
+		{
+			OctreeMap = tile.octreeMap;
+			LinearMap = tile.linearMap;
+			tile.print();
+		}
+
+		Vector GetTrueResolution(void) const
+		{
+			return (LinearMap != NULL) ? LinearMap->GetTrueResolution() : OctreeMap->GetTrueResolution();
+		}
 };
 
 #endif
@@ -9,6 +9,154 @@
 
 #include "mapio.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// The netCDF library is not thread safe. Every nc_* call holds this lock
+// since mapsrc_find may be called from the particle filter measurement update
+// threads and map tiles are loaded on a background thread while other maps
+// are being opened.
+static std::mutex mapio_nc_mutex;
+
+// Index of the x and y dimensions in netCDF start/count arrays
+#define MAPIO_XI 1
+#define MAPIO_YI 0
+
+typedef std::shared_ptr<const std::vector<float> > maptile_ptr;
+
+// LRU cache of square blocks of a map's z grid (see mapsrc_tiles_enable)
+struct maptiles {
+	struct mapsrc* src;
+	size_t dim;             // tile edge length in cells
+	size_t ntx;             // number of tiles along x
+	size_t nty;             // number of tiles along y
+	size_t max_tiles;       // maximum number of tiles kept
+	std::mutex mutex;       // guards everything below
+	std::condition_variable cond;
+	std::list<size_t> lru;  // tile keys, most recently used first
+	std::unordered_map<size_t, std::pair<maptile_ptr, std::list<size_t>::iterator> > tiles;
+	std::unordered_set<size_t> loading;  // tiles being read
+	std::deque<size_t> queue;            // tiles to prefetch
+	std::thread worker;
+	bool stop;
+};
+
+// Reads tile key from the netCDF file. Returns NULL on error.
+static maptile_ptr maptile_read(struct maptiles* t, size_t key) {
+	size_t start[2], count[2];
+	start[MAPIO_YI] = (key / t->ntx) * t->dim;
+	start[MAPIO_XI] = (key % t->ntx) * t->dim;
+	count[MAPIO_YI] = std::min(t->dim, t->src->ydimlen - start[MAPIO_YI]);
+	count[MAPIO_XI] = std::min(t->dim, t->src->xdimlen - start[MAPIO_XI]);
+
+	std::shared_ptr<std::vector<float> > tile = std::make_shared<std::vector<float> >(count[0] * count[1]);
+	std::lock_guard<std::mutex> lock(mapio_nc_mutex);
+	int err = nc_get_vara_float(t->src->ncid, t->src->zid, start, count, tile->data());
+	if(err != NC_NOERR) {
+		fprintf(stderr, "%s:%d %s\n", __func__, __LINE__, nc_strerror(err));
+		return maptile_ptr();
+	}
+	return tile;
+}
+
+// Adds a tile as the most recently used one, dropping the least recently
+// used tiles beyond max_tiles. Callers hold t->mutex.
+static void maptiles_insert(struct maptiles* t, size_t key, const maptile_ptr& tile) {
+	t->lru.push_front(key);
+	t->tiles[key] = std::make_pair(tile, t->lru.begin());
+	while(t->tiles.size() > t->max_tiles) {
+		t->tiles.erase(t->lru.back());
+		t->lru.pop_back();
+	}
+}
+
+// Returns tile (tx, ty), reading it unless it is cached. If the prefetch
+// thread is reading it, waits for that read instead.
+static maptile_ptr maptiles_get(struct maptiles* t, size_t tx, size_t ty) {
+	size_t key = ty * t->ntx + tx;
+	std::unique_lock<std::mutex> lock(t->mutex);
+	for(;;) {
+		auto it = t->tiles.find(key);
+		if(it != t->tiles.end()) {
+			t->lru.splice(t->lru.begin(), t->lru, it->second.second);
+			return it->second.first;
+		}
+		if(t->loading.count(key) == 0) {
+			break;
+		}
+		t->cond.wait(lock);
+	}
+
+	t->loading.insert(key);
+	lock.unlock();
+	maptile_ptr tile = maptile_read(t, key);
+	lock.lock();
+	t->loading.erase(key);
+	if(tile) {
+		maptiles_insert(t, key, tile);
+	}
+	t->cond.notify_all();
+	return tile;
+}
+
+// Copies the block of z at start/count out of the cached tiles.
+// Returns false if a tile could not be read.
+static bool maptiles_copy(struct maptiles* t, const size_t* start, const size_t* count, float* z) {
+	size_t x0 = start[MAPIO_XI], x1 = x0 + count[MAPIO_XI];
+	size_t y0 = start[MAPIO_YI], y1 = y0 + count[MAPIO_YI];
+
+	for(size_t ty = y0 / t->dim; ty * t->dim < y1; ty++) {
+		for(size_t tx = x0 / t->dim; tx * t->dim < x1; tx++) {
+			maptile_ptr tile = maptiles_get(t, tx, ty);
+			if(!tile) {
+				return false;
+			}
+			size_t tw = std::min(t->dim, t->src->xdimlen - tx * t->dim);
+			size_t xa = std::max(x0, tx * t->dim), xb = std::min(x1, (tx + 1) * t->dim);
+			size_t ya = std::max(y0, ty * t->dim), yb = std::min(y1, (ty + 1) * t->dim);
+			for(size_t y = ya; y < yb; y++) {
+				memcpy(z + (y - y0) * count[MAPIO_XI] + (xa - x0),
+					   tile->data() + (y - ty * t->dim) * tw + (xa - tx * t->dim),
+					   (xb - xa) * sizeof(float));
+			}
+		}
+	}
+	return true;
+}
+
+// Prefetch thread: reads queued tiles that are not yet cached
+static void maptiles_worker(struct maptiles* t) {
+	std::unique_lock<std::mutex> lock(t->mutex);
+	while(!t->stop) {
+		if(t->queue.empty()) {
+			t->cond.wait(lock);
+			continue;
+		}
+		size_t key = t->queue.front();
+		t->queue.pop_front();
+		if(t->tiles.count(key) != 0 || t->loading.count(key) != 0) {
+			continue;
+		}
+
+		t->loading.insert(key);
+		lock.unlock();
+		maptile_ptr tile = maptile_read(t, key);
+		lock.lock();
+		t->loading.erase(key);
+		if(tile) {
+			maptiles_insert(t, key, tile);
+		}
+		t->cond.notify_all();
+	}
+}
 
 //TODO this function fails to print which file or directory doesn't exist, making its error message near useless.
 int check_error(int status, struct mapsrc* src) {
@@ -38,6 +186,9 @@ void mapsrc_fill(const char* file, struct mapsrc* src) {
         double range[2];
         double delta;
 
+        // prefetch threads of other maps may be reading netCDF
+        std::lock_guard<std::mutex> lock(mapio_nc_mutex);
+
         // We don't refill existign strctures unless they've been free'd first
         if(src->x != NULL || src->y != NULL) {
             fprintf(stderr,
@@ -153,10 +304,24 @@ float mapsrc_find(struct mapsrc* src, double x, double y) {
             start[YI] = nearest(y, src->y, src->ydimlen);
             count[XI] = 1;
             count[YI] = 1;
-            float *z = (float*) malloc(count[YI] * count[XI] * sizeof(float));
-            check_error(nc_get_vara_float(src->ncid, src->zid, start, count, z), src);
-            z_out = *z;
-            free(z);
+            maptile_ptr tile;
+            if(NULL != src->tiles) {
+                struct maptiles* t = src->tiles;
+                tile = maptiles_get(t, start[XI] / t->dim, start[YI] / t->dim);
+            }
+            if(tile) {
+                struct maptiles* t = src->tiles;
+                size_t tw = std::min(t->dim, src->xdimlen - (start[XI] / t->dim) * t->dim);
+                z_out = (*tile)[(start[YI] % t->dim) * tw + start[XI] % t->dim];
+            } else {
+                float *z = (float*) malloc(count[YI] * count[XI] * sizeof(float));
+                {
+                    std::lock_guard<std::mutex> lock(mapio_nc_mutex);
+                    check_error(nc_get_vara_float(src->ncid, src->zid, start, count, z), src);
+                }
+                z_out = *z;
+                free(z);
+            }
         }
     }
 	return z_out;
@@ -176,14 +341,77 @@ struct mapsrc* mapsrc_init(void) {
 	src->ydimid = 0;
 	src->zid = 0;
 	src->status = MAPSRC_IS_EMPTY;
+	src->tiles = NULL;
 	return src;
 }
 
 
+int mapsrc_tiles_enable(struct mapsrc* src, int tile_dim, int max_tiles) {
+	if(NULL == src || !(src->status & MAPSRC_IS_FILLED) || tile_dim < 1 || max_tiles < 1) {
+		return MAPIO_READERROR;
+	}
+	if(NULL != src->tiles) {
+		return MAPIO_OK;
+	}
+
+	struct maptiles* t = new maptiles;
+	t->src = src;
+	t->dim = tile_dim;
+	t->ntx = (src->xdimlen + t->dim - 1) / t->dim;
+	t->nty = (src->ydimlen + t->dim - 1) / t->dim;
+	t->max_tiles = max_tiles;
+	t->stop = false;
+	t->worker = std::thread(maptiles_worker, t);
+	src->tiles = t;
+	return MAPIO_OK;
+}
+
+
+void mapsrc_tiles_prefetch(struct mapsrc* src, double x, double y, double xwidth, double ywidth) {
+	if(NULL == src || NULL == src->tiles) {
+		return;
+	}
+	struct maptiles* t = src->tiles;
+
+	// Same cells as mapdata_fill
+	size_t x0 = nearest(x - xwidth / 2, src->x, src->xdimlen) / t->dim;
+	size_t x1 = nearest(x + xwidth / 2, src->x, src->xdimlen) / t->dim;
+	size_t y0 = nearest(y - ywidth / 2, src->y, src->ydimlen) / t->dim;
+	size_t y1 = nearest(y + ywidth / 2, src->y, src->ydimlen) / t->dim;
+
+	{
+		std::lock_guard<std::mutex> lock(t->mutex);
+		for(size_t ty = y0; ty <= y1; ty++) {
+			for(size_t tx = x0; tx <= x1; tx++) {
+				size_t key = ty * t->ntx + tx;
+				// Never queue more than the cache can hold
+				if(t->queue.size() >= t->max_tiles) {
+					break;
+				}
+				if(t->tiles.count(key) == 0 && t->loading.count(key) == 0 &&
+				   std::find(t->queue.begin(), t->queue.end(), key) == t->queue.end()) {
+					t->queue.push_back(key);
+				}
+			}
+		}
+	}
+	t->cond.notify_all();
+}
+
+
 void mapsrc_free(struct mapsrc** psrc) {
     if(NULL != psrc){
         struct mapsrc* src = *psrc;
         if(NULL!=src){
+            if(src->tiles != NULL) {
+                {
+                    std::lock_guard<std::mutex> lock(src->tiles->mutex);
+                    src->tiles->stop = true;
+                }
+                src->tiles->cond.notify_all();
+                src->tiles->worker.join();
+                delete src->tiles;
+            }
             if(src->x != NULL) {
                 free(src->x);
             }
@@ -299,8 +527,11 @@ int mapdata_fill(struct mapsrc* src, struct mapdata* data, double x,
 	if(MAPIO_DEBUG) {
 		fprintf(stdout, "MAPIO::%s: Reading z from netcdf", pname);
 	}
-	err = nc_get_vara_float(src->ncid, src->zid, start, count, (float*) data->z);
-	check_error(err, src);
+	if(NULL == src->tiles || !maptiles_copy(src->tiles, start, count, (float*) data->z)) {
+		std::lock_guard<std::mutex> lock(mapio_nc_mutex);
+		err = nc_get_vara_float(src->ncid, src->zid, start, count, (float*) data->z);
+		check_error(err, src);
+	}
 	data->status = MAPDATA_IS_FILLED;
 
 	// Debug output used for compring results with matlab 'truth'
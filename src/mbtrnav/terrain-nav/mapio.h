@@ -92,6 +92,18 @@
 
 #define MAPBOUNDS_NEAR_EDGE 2
 
+/*!
+ * @brief Default tile edge length, in grid cells, used by mapsrc_tiles_enable
+ */
+#define MAPIO_TILE_DIM 128
+
+/*!
+ * @brief Default number of tiles kept in memory by mapsrc_tiles_enable
+ */
+#define MAPIO_TILE_CACHE_SIZE 256
+
+struct maptiles;
+
  
 /*!
  * @struct mapdata
@@ -150,6 +162,8 @@ struct mapdata {
  * @param ydimlen The number of values in y
  * @param zid The NetCDF variable id to the height/depth variable
  * @param status
+ * @param tiles The tile cache serving z reads, or NULL to read the netCDF
+ *     file directly (see mapsrc_tiles_enable)
  */
 struct mapsrc {
   int ncid;           // NetCDF file id
@@ -163,6 +177,7 @@ struct mapsrc {
   size_t ydimlen;     // Length of Y dimension
   int zid;            // NetCDF variable id to Z variable
   int status;         // Error status (see MAPIO_* values)
+  struct maptiles *tiles; // LRU tile cache or NULL
 };
 
 /*!
@@ -228,6 +243,36 @@ void mapsrc_free(struct mapsrc **psrc);
  
 float mapsrc_find(struct mapsrc *src, double x, double y);
 
+/*!
+ * function: mapsrc_tiles_enable
+ * @brief Serve z reads of a map from an in-memory tile cache
+ * @details Splits the grid into square tiles of tile_dim cells that are read
+ *      from the netCDF file on first use and kept in memory. mapdata_fill and
+ *      mapsrc_find then copy from the cached tiles instead of reading the file.
+ *      At most max_tiles tiles are kept; the least recently used tile is
+ *      dropped first. A background thread loads tiles requested with
+ *      mapsrc_tiles_prefetch. The cache is released by mapsrc_free.
+ * @param src A filled mapsrc structure
+ * @param tile_dim Tile edge length in grid cells
+ * @param max_tiles Maximum number of tiles kept in memory
+ * @return MAPIO_OK, or MAPIO_READERROR if src is not filled
+ */
+int mapsrc_tiles_enable(struct mapsrc *src, int tile_dim, int max_tiles);
+
+/*!
+ * function: mapsrc_tiles_prefetch
+ * @brief Load the tiles of a submap in the background
+ * @details Queues the tiles covering the submap that mapdata_fill would read
+ *      for the same arguments, so that a later mapdata_fill finds them in
+ *      memory. Does nothing if src has no tile cache.
+ * @param src The mapsrc structure
+ * @param x The easting of the submap center
+ * @param y The northing of the submap center
+ * @param xwidth The width of the submap in meters
+ * @param ywidth The height of the submap in meters
+ */
+void mapsrc_tiles_prefetch(struct mapsrc *src, double x, double y, double xwidth, double ywidth);
+
 /*!
  * function: mapsrc_init
  * @brief Initializes a mapsrc structure
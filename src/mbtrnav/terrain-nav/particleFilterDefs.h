@@ -8,6 +8,14 @@
 #define MAX_PARTICLES 10000 //10000 //14400 //3000 //20000 //
 #endif
 
+#ifndef PF_MEAS_THREADS      //number of threads used for the per-particle
+#define PF_MEAS_THREADS 0    //measurement update (0 = number of cores)
+#endif
+
+#ifndef PF_MIN_PARTICLES_PER_THREAD    //smallest particle block handed to a
+#define PF_MIN_PARTICLES_PER_THREAD 64 //measurement update thread
+#endif
+
 #ifndef USE_AUG_MCL      //boolean indicating if augmented MCL algorithm should 
 #define USE_AUG_MCL 0    //be used  
 #endif
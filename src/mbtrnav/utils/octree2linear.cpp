@@ -0,0 +1,199 @@
+/****************************************************************************/
+/* Summary  : Convert octree map files (.bo) to linear octree files, and    */
+/*            compare load and ray trace times of the two representations. */
+/* Filename : octree2linear.cpp                                             */
+/* Project  : MB-System / TRN                                               */
+/* Version  : 1.0                                                           */
+/* Created  : 10/16/2026                                                    */
+/****************************************************************************/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "OctreeSupport.hpp"
+#include "Octree.hpp"
+#include "LinearOctree.hpp"
+
+static void showHelp(void)
+{
+  fprintf(stderr,
+          "Usage:\n  octree2linear -i octree.bo [-o linear.lo] [-b] [-n rays] [-s seed]\n"
+          "    -i file  Octree map file written by Octree::SaveToFile (e.g. mbgrd2octree)\n"
+          "    -o file  Write the linear octree file\n"
+          "    -b       Benchmark load and RayTrace of the octree and linear octree,\n"
+          "             one ray at a time and as a batch\n"
+          "             (uses the -o file, or a temporary file if -o is not given)\n"
+          "    -n rays  Number of rays to trace in the benchmark (default 100000)\n"
+          "    -s seed  Random seed for the benchmark rays (default 1)\n");
+}
+
+// seconds since t0
+static double elapsed(const std::chrono::steady_clock::time_point& t0)
+{
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+  return dt.count();
+}
+
+// Make rays from the top and bottom faces of the map, pointing into the map,
+// so that both z up and z down maps are hit.
+static void makeRays(const LinearOctree<bool>& lo, int nrays, unsigned int seed,
+                     std::vector<Vector>& start, std::vector<Vector>& dir)
+{
+  Vector lower = lo.GetLowerBounds();
+  Vector upper = lo.GetUpperBounds();
+  Vector size = upper - lower;
+
+  srand(seed);
+  start.resize(nrays);
+  dir.resize(nrays);
+  for (int i = 0; i < nrays; i++)
+  {
+    double rx = (double)rand() / RAND_MAX;
+    double ry = (double)rand() / RAND_MAX;
+    double ax = ((double)rand() / RAND_MAX - 0.5);
+    double ay = ((double)rand() / RAND_MAX - 0.5);
+    bool down = (i & 1);
+    start[i].SetValues(lower.x + rx * size.x, lower.y + ry * size.y,
+                       down ? lower.z + 1.e-3 * size.z : upper.z - 1.e-3 * size.z);
+    dir[i].SetValues(ax, ay, down ? 1.0 : -1.0);
+  }
+}
+
+static int benchmark(const char *octreeFile, const char *linearFile, int nrays, unsigned int seed)
+{
+  std::chrono::steady_clock::time_point t0;
+
+  t0 = std::chrono::steady_clock::now();
+  Octree<bool> *ot = new Octree<bool>();
+  if (!ot->LoadFromFile(octreeFile))
+  {
+    fprintf(stderr, "octree2linear: could not load %s\n", octreeFile);
+    delete ot;
+    return 1;
+  }
+  double tLoadOctree = elapsed(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  LinearOctree<bool> *lo = new LinearOctree<bool>();
+  if (!lo->LoadFromFile(linearFile))
+  {
+    fprintf(stderr, "octree2linear: could not load %s\n", linearFile);
+    delete ot;
+    delete lo;
+    return 1;
+  }
+  double tLoadLinear = elapsed(t0);
+
+  std::vector<Vector> start, dir;
+  makeRays(*lo, nrays, seed, start, dir);
+  std::vector<double> rangeOctree(nrays), rangeLinear(nrays), rangeBatch(nrays);
+
+  // first pass over the linear octree pages in the tree from disk
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < nrays; i++)
+    rangeLinear[i] = lo->RayTrace(start[i], dir[i]);
+  double tTraceLinearCold = elapsed(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < nrays; i++)
+    rangeOctree[i] = ot->RayTrace(start[i], dir[i]);
+  double tTraceOctree = elapsed(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < nrays; i++)
+    rangeLinear[i] = lo->RayTrace(start[i], dir[i]);
+  double tTraceLinear = elapsed(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  lo->RayTrace(nrays, &start[0], &dir[0], &rangeBatch[0]);
+  double tTraceBatch = elapsed(t0);
+
+  int hits = 0, mismatches = 0;
+  for (int i = 0; i < nrays; i++)
+  {
+    if (rangeOctree[i] >= 0.) hits++;
+    if (rangeOctree[i] != rangeLinear[i] || rangeOctree[i] != rangeBatch[i]) mismatches++;
+  }
+
+  printf("\n%-8s %10s %14s %14s\n", "", "load_s", "raytrace_us", "rays/s");
+  printf("%-8s %10.3f %14.3f %14.0f\n", "octree", tLoadOctree,
+         1.e6 * tTraceOctree / nrays, nrays / tTraceOctree);
+  printf("%-8s %10.3f %14.3f %14.0f  (first pass %.3f us)\n", "linear", tLoadLinear,
+         1.e6 * tTraceLinear / nrays, nrays / tTraceLinear, 1.e6 * tTraceLinearCold / nrays);
+  printf("%-8s %10s %14.3f %14.0f\n", "batch", "",
+         1.e6 * tTraceBatch / nrays, nrays / tTraceBatch);
+  printf("rays %d  hits %d  mismatches %d\n", nrays, hits, mismatches);
+
+  delete ot;
+  delete lo;
+  return (mismatches == 0 ? 0 : 1);
+}
+
+int main(int argc, char* argv[])
+{
+  char *inFile = NULL, *outFile = NULL;
+  bool bench = false;
+  int nrays = 100000;
+  unsigned int seed = 1;
+  int c;
+
+  while ( (c = getopt(argc, argv, "bhi:n:o:s:")) != EOF )
+  {
+    if (c == 'b')
+      bench = true;
+    else if (c == 'i')
+      inFile = optarg;
+    else if (c == 'o')
+      outFile = optarg;
+    else if (c == 'n')
+      nrays = atoi(optarg);
+    else if (c == 's')
+      seed = (unsigned int)atoi(optarg);
+    else
+    {
+      showHelp();
+      return (c == 'h' ? 0 : 1);
+    }
+  }
+
+  if (NULL == inFile || (NULL == outFile && !bench) || nrays < 1)
+  {
+    showHelp();
+    return 1;
+  }
+
+  char tmpName[] = "/tmp/octree2linear-XXXXXX";
+  const char *linearFile = outFile;
+  if (NULL == linearFile)
+  {
+    int fd = mkstemp(tmpName);
+    if (fd < 0)
+    {
+      perror("octree2linear: mkstemp");
+      return 1;
+    }
+    close(fd);
+    linearFile = tmpName;
+  }
+
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  if (!LinearOctree<bool>::ConvertFromOctreeFile(inFile, linearFile))
+  {
+    fprintf(stderr, "octree2linear: conversion of %s failed\n", inFile);
+    if (NULL == outFile) unlink(tmpName);
+    return 1;
+  }
+  printf("octree2linear: converted %s to %s in %.3f s\n", inFile, linearFile, elapsed(t0));
+
+  int retval = 0;
+  if (bench)
+    retval = benchmark(inFile, linearFile, nrays, seed);
+
+  if (NULL == outFile) unlink(tmpName);
+  return retval;
+}
@@ -0,0 +1,421 @@
+///
+/// @file mcbuf-test.c
+/// @authors k. Headley
+/// @date 16 oct 2026
+
+/// Unit test and latency comparison for mcbuf
+
+/// Runs mcbuf_test(), then streams frames from a producer thread
+/// to a consumer thread through an mcbuf in MCB_MODE_MUTEX and
+/// MCB_MODE_SPSC, recording frame latency histograms with mstats.
+/// Frame contents may be replayed from a recorded data file
+/// (e.g. the s7k files served by emu7k).
+/// Compile test (in src directory) using
+/// gcc -o mcbuf-test mcbuf-test.c -L../bin -lmframe -lpthread -lm
+/// @sa doxygen-examples.c for more examples of Doxygen markup
+
+
+/////////////////////////
+// Terms of use
+/////////////////////////
+/*
+ Copyright Information
+ 
+ Copyright 2002-2026 MBARI
+ Monterey Bay Aquarium Research Institute, all rights reserved.
+ 
+ Terms of Use
+ 
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version. You can access the GPLv3 license at
+ http://www.gnu.org/licenses/gpl-3.0.html
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details
+ (http://www.gnu.org/licenses/gpl-3.0.html)
+ 
+ MBARI provides the documentation and software code "as is", with no warranty,
+ express or implied, as to the software, title, non-infringement of third party
+ rights, merchantability, or fitness for any particular purpose, the accuracy of
+ the code, or the performance or results which you may obtain from its use. You
+ assume the entire risk associated with use of the code, and you agree to be
+ responsible for the entire cost of repair or servicing of the program with
+ which you are using the code.
+ 
+ In no event shall MBARI be liable for any damages, whether general, special,
+ incidental or consequential damages, arising out of your use of the software,
+ including, but not limited to, the loss or corruption of your data or damages
+ of any kind resulting from use of the software, any prohibited use, or your
+ inability to use the software. You agree to defend, indemnify and hold harmless
+ MBARI and its officers, directors, and employees against any claim, loss,
+ liability or expense, including attorneys' fees, resulting from loss of or
+ damage to property or the injury to or death of any person arising out of the
+ use of the software.
+ 
+ The MBARI software is provided without obligation on the part of the
+ Monterey Bay Aquarium Research Institute to assist in its use, correction,
+ modification, or enhancement.
+ 
+ MBARI assumes no responsibility or liability for any third party and/or
+ commercial software required for the database or applications. Licensee agrees
+ to obtain and maintain valid licenses for any additional third party software
+ required.
+ */
+
+
+/////////////////////////
+// Headers
+/////////////////////////
+
+#if !defined(__QNX__)
+#include <getopt.h>
+#endif
+#include <sched.h>
+#include "mframe.h"
+#include "mcbuf.h"
+#include "mstats.h"
+#include "mthread.h"
+#include "mtime.h"
+
+/////////////////////////
+// Declarations
+/////////////////////////
+
+/// @typedef struct app_cfg_s app_cfg_t
+/// @brief application configuration parameter structure
+typedef struct app_cfg_s{
+    /// @var app_cfg_s::verbose
+    /// @brief show histogram bins
+    bool verbose;
+    /// @var app_cfg_s::frames
+    /// @brief number of frames to stream
+    uint32_t frames;
+    /// @var app_cfg_s::size
+    /// @brief frame payload size (bytes)
+    uint32_t size;
+    /// @var app_cfg_s::cap
+    /// @brief buffer capacity (bytes)
+    uint32_t cap;
+    /// @var app_cfg_s::batch
+    /// @brief max frames per consumer read
+    uint32_t batch;
+    /// @var app_cfg_s::rate
+    /// @brief producer frame rate (Hz, 0: unpaced)
+    double rate;
+    /// @var app_cfg_s::file
+    /// @brief replay data file path (NULL: generated data)
+    char *file;
+}app_cfg_t;
+
+/// @typedef struct frame_hdr_s frame_hdr_t
+/// @brief header written ahead of each frame
+typedef struct frame_hdr_s{
+    /// @var frame_hdr_s::seq
+    /// @brief frame sequence number
+    uint32_t seq;
+    /// @var frame_hdr_s::len
+    /// @brief payload length
+    uint32_t len;
+    /// @var frame_hdr_s::t_sent
+    /// @brief time producer started writing frame
+    double t_sent;
+}frame_hdr_t;
+
+/// @typedef struct bench_s bench_t
+/// @brief producer/consumer state for one run
+typedef struct bench_s{
+    app_cfg_t *cfg;
+    mcbuffer_t *cb;
+    byte *src;
+    uint32_t src_len;
+    mstats_hist_t *latency;
+    uint32_t errors;
+    uint64_t full_count;
+}bench_t;
+
+/////////////////////////
+// Function Definitions
+/////////////////////////
+
+/// @fn void s_show_help()
+/// @brief output user help message to stdout.
+/// @return none
+static void s_show_help()
+{
+    char help_message[] = "\nmcbuf unit test and mutex/spsc latency comparison\n";
+    char usage_message[] = "\nmcbuf-test [options]\n"
+    "--verbose     : show histogram bins\n"
+    "--help        : output help message\n"
+    "--frames=n    : number of frames [default 100000]\n"
+    "--size=n      : frame payload bytes [default 32768]\n"
+    "--cap=n       : buffer capacity bytes [default 1048576]\n"
+    "--batch=n     : max frames per consumer read [default 8]\n"
+    "--rate=f      : producer frame rate, Hz (0:unpaced) [default 0]\n"
+    "--file=s      : replay frame data from file (e.g. s7k data)\n"
+    "\n";
+    printf("%s",help_message);
+    printf("%s",usage_message);
+}
+// End function s_show_help
+
+/// @fn void s_parse_args(int argc, char ** argv, app_cfg_t * cfg)
+/// @brief parse command line args, set application configuration.
+/// @param[in] argc number of arguments
+/// @param[in] argv array of command line arguments (strings)
+/// @param[in] cfg application config structure
+/// @return none
+static void s_parse_args(int argc, char **argv, app_cfg_t *cfg)
+{
+    extern char WIN_DECLSPEC *optarg;
+    int option_index;
+    int c;
+    bool help=false;
+
+    static struct option options[] = {
+        {"verbose", no_argument, NULL, 0},
+        {"help", no_argument, NULL, 0},
+        {"frames", required_argument, NULL, 0},
+        {"size", required_argument, NULL, 0},
+        {"cap", required_argument, NULL, 0},
+        {"batch", required_argument, NULL, 0},
+        {"rate", required_argument, NULL, 0},
+        {"file", required_argument, NULL, 0},
+        {NULL, 0, NULL, 0}};
+
+    while ((c = getopt_long(argc, argv, "", options, &option_index)) != -1){
+        switch (c) {
+            case 0:
+                if (strcmp("verbose", options[option_index].name) == 0) {
+                    cfg->verbose=true;
+                }else if (strcmp("help", options[option_index].name) == 0) {
+                    help = true;
+                }else if (strcmp("frames", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->frames);
+                }else if (strcmp("size", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->size);
+                }else if (strcmp("cap", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->cap);
+                }else if (strcmp("batch", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->batch);
+                }else if (strcmp("rate", options[option_index].name) == 0) {
+                    sscanf(optarg,"%lf",&cfg->rate);
+                }else if (strcmp("file", options[option_index].name) == 0) {
+                    cfg->file=strdup(optarg);
+                }
+                break;
+            default:
+                help=true;
+                break;
+        }
+        if (help) {
+            s_show_help();
+            exit(0);
+        }
+    }
+    if (cfg->batch<1) {
+        cfg->batch=1;
+    }
+    if (cfg->cap < (cfg->size+sizeof(frame_hdr_t))) {
+        cfg->cap = cfg->size+sizeof(frame_hdr_t);
+    }
+}
+// End function s_parse_args
+
+/// @fn void *s_producer(void *arg)
+/// @brief write frames to buffer, optionally paced.
+/// @param[in] arg bench_t reference
+/// @return NULL
+static void *s_producer(void *arg)
+{
+    bench_t *bench = (bench_t *)arg;
+    app_cfg_t *cfg = bench->cfg;
+    frame_hdr_t hdr;
+    mcbuf_iov_t iov[2];
+    double t_start = mtime_dtime();
+    uint32_t i=0;
+    int status=MCB_OK;
+
+    for (i=0; i<cfg->frames; i++) {
+        if (cfg->rate>0.0) {
+            double t_next = t_start + (double)i/cfg->rate;
+            while (mtime_dtime() < t_next) {
+                sched_yield();
+            }
+        }
+        hdr.seq = i;
+        hdr.len = cfg->size;
+        hdr.t_sent = mtime_dtime();
+        iov[0].buf = (byte *)&hdr;
+        iov[0].len = sizeof(frame_hdr_t);
+        iov[1].buf = bench->src + ((uint64_t)i*cfg->size)%(bench->src_len-cfg->size+1);
+        iov[1].len = cfg->size;
+        while (mcbuf_writev(bench->cb,iov,2,MCB_NONE,&status) < 0) {
+            bench->full_count++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+// End function s_producer
+
+/// @fn void *s_consumer(void *arg)
+/// @brief read frames from buffer (up to batch frames per read),
+/// record latency.
+/// @param[in] arg bench_t reference
+/// @return NULL
+static void *s_consumer(void *arg)
+{
+    bench_t *bench = (bench_t *)arg;
+    app_cfg_t *cfg = bench->cfg;
+    uint32_t frame_len = sizeof(frame_hdr_t)+cfg->size;
+    frame_hdr_t *hdr = (frame_hdr_t *)malloc(cfg->batch*sizeof(frame_hdr_t));
+    byte *payload = (byte *)malloc((size_t)cfg->batch*cfg->size);
+    mcbuf_iov_t *iov = (mcbuf_iov_t *)malloc(2*cfg->batch*sizeof(mcbuf_iov_t));
+    uint32_t received=0;
+    uint32_t i=0;
+    int status=MCB_OK;
+
+    for (i=0; i<cfg->batch; i++) {
+        iov[2*i].buf = (byte *)&hdr[i];
+        iov[2*i].len = sizeof(frame_hdr_t);
+        iov[2*i+1].buf = payload+(size_t)i*cfg->size;
+        iov[2*i+1].len = cfg->size;
+    }
+
+    while (received<cfg->frames) {
+        uint32_t n = mcbuf_available(bench->cb)/frame_len;
+        if (n>cfg->batch) {
+            n=cfg->batch;
+        }
+        if (n==0) {
+            sched_yield();
+            continue;
+        }
+        if (mcbuf_readv(bench->cb,iov,2*n,MCB_NONE,&status) == (int)(n*frame_len)) {
+            double now = mtime_dtime();
+            for (i=0; i<n; i++) {
+                if (hdr[i].seq != received || hdr[i].len != cfg->size ||
+                    memcmp(payload+(size_t)i*cfg->size,
+                           bench->src + ((uint64_t)received*cfg->size)%(bench->src_len-cfg->size+1),cfg->size) != 0) {
+                    bench->errors++;
+                }
+                mstats_hist_add(bench->latency,now-hdr[i].t_sent);
+                received++;
+            }
+        }else{
+            bench->errors++;
+        }
+    }
+    free(iov);
+    free(payload);
+    free(hdr);
+    return NULL;
+}
+// End function s_consumer
+
+/// @fn int s_run(app_cfg_t *cfg, mcbuf_mode_t mode, byte *src, uint32_t src_len)
+/// @brief stream frames through a buffer in the specified mode
+/// and output latency statistics.
+/// @param[in] cfg application config
+/// @param[in] mode buffer mode
+/// @param[in] src frame source data
+/// @param[in] src_len frame source data length
+/// @return 0 on success, -1 otherwise
+static int s_run(app_cfg_t *cfg, mcbuf_mode_t mode, byte *src, uint32_t src_len)
+{
+    int retval=-1;
+    bench_t bench;
+    memset(&bench,0,sizeof(bench_t));
+    bench.cfg = cfg;
+    bench.cb = mcbuf_new_mode(cfg->cap,mode);
+    bench.src = src;
+    bench.src_len = src_len;
+    bench.latency = mstats_hist_new(80,1.0e-7,10.0);
+
+    if (NULL!=bench.cb && NULL!=bench.latency) {
+        mthread_thread_t *producer = mthread_thread_new();
+        mthread_thread_t *consumer = mthread_thread_new();
+        double t_start = mtime_dtime();
+        mthread_thread_start(consumer,s_consumer,&bench);
+        mthread_thread_start(producer,s_producer,&bench);
+        mthread_thread_join(producer);
+        mthread_thread_join(consumer);
+        double elapsed = mtime_dtime()-t_start;
+
+        fprintf(stderr,"\n%s: frames %u size %u cap %u batch %u rate %.1lf\n",
+                (mode==MCB_MODE_SPSC?"spsc":"mutex"),
+                cfg->frames,cfg->size,bench.cb->capacity,cfg->batch,cfg->rate);
+        fprintf(stderr,"  elapsed %.3lf s  %.1lf frames/s  %.1lf MB/s  full %"PRIu64"  errors %u\n",
+                elapsed,cfg->frames/elapsed,
+                (double)cfg->frames*cfg->size/elapsed/1.0e6,
+                bench.full_count,bench.errors);
+        mstats_hist_show(bench.latency,"latency (s)",cfg->verbose,2);
+        mthread_thread_destroy(&producer);
+        mthread_thread_destroy(&consumer);
+        retval = (bench.errors==0 ? 0 : -1);
+    }
+    mstats_hist_destroy(&bench.latency);
+    mcbuf_destroy(&bench.cb);
+    return retval;
+}
+// End function s_run
+
+/// @fn int main(int argc, char ** argv)
+/// @brief mcbuf-test main entry point.
+/// @param[in] argc number of command line arguments
+/// @param[in] argv array of command line arguments (strings)
+/// @return 0 on success, -1 otherwise
+int main(int argc, char **argv)
+{
+    // C89 declarations (for QNX portability)
+    int retval=-1;
+    app_cfg_t cfg={false,100000,32768,1048576,8,0.0,NULL};
+    byte *src=NULL;
+    uint32_t src_len=0;
+
+    s_parse_args(argc,argv,&cfg);
+
+    retval = mcbuf_test();
+
+    // frame source: replay file contents or generated bytes
+    if (NULL!=cfg.file) {
+        FILE *fp = fopen(cfg.file,"rb");
+        if (NULL!=fp) {
+            fseek(fp,0,SEEK_END);
+            long flen = ftell(fp);
+            fseek(fp,0,SEEK_SET);
+            src_len = (uint32_t)(flen>(64L<<20) ? (64L<<20) : flen);
+            if (src_len>=cfg.size && NULL!=(src=(byte *)malloc(src_len))) {
+                src_len = fread(src,1,src_len,fp);
+            }
+            fclose(fp);
+        }
+        if (NULL==src || src_len<cfg.size) {
+            fprintf(stderr,"could not load %u bytes from %s\n",cfg.size,cfg.file);
+            free(src);
+            src=NULL;
+        }
+    }
+    if (NULL==src) {
+        uint32_t i=0;
+        src_len = 4*cfg.size;
+        src = (byte *)malloc(src_len);
+        for (i=0; NULL!=src && i<src_len; i++) {
+            src[i] = (byte)(i*31+7);
+        }
+    }
+
+    if (NULL!=src) {
+        retval |= s_run(&cfg,MCB_MODE_MUTEX,src,src_len);
+        retval |= s_run(&cfg,MCB_MODE_SPSC,src,src_len);
+    }
+
+    free(src);
+    free(cfg.file);
+    return retval;
+}
+// End function main
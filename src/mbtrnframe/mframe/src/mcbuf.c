@@ -65,6 +65,19 @@ GNU General Public License for more details
 // Macros
 /////////////////////////
 
+// SPSC index access: the writer publishes whead and the reader
+// publishes rtail with release semantics; each side reads the
+// other's index with acquire semantics.
+#if defined(__ATOMIC_ACQUIRE)
+#define MCBUF_LOAD_RELAXED(p)    __atomic_load_n(p,__ATOMIC_RELAXED)
+#define MCBUF_LOAD_ACQUIRE(p)    __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define MCBUF_STORE_RELEASE(p,v) __atomic_store_n(p,v,__ATOMIC_RELEASE)
+#else
+#define MCBUF_LOAD_RELAXED(p)    (*(volatile uint32_t *)(p))
+#define MCBUF_LOAD_ACQUIRE(p)    __extension__({uint32_t v_=*(volatile uint32_t *)(p); __sync_synchronize(); v_;})
+#define MCBUF_STORE_RELEASE(p,v) do{__sync_synchronize(); *(volatile uint32_t *)(p)=(v);}while(0)
+#endif
+
 // These macros should only be defined for 
 // application main files rather than general C files
 /*
@@ -101,26 +114,63 @@ GNU General Public License for more details
 /////////////////////////
 
 /// @fn mcbuffer_t * mcbuf_new(uint32_t capacity)
-/// @brief return new circular buffer instance reference.
+/// @brief return new circular buffer instance reference (MCB_MODE_MUTEX).
 /// caller should release using mcbuf_destroy();
 /// @param[in] capacity buffer capacity (bytes)
 /// @return instance reference on success, NULL otherwise
 mcbuffer_t *mcbuf_new(uint32_t capacity)
 {
+    return mcbuf_new_mode(capacity,MCB_MODE_MUTEX);
+}
+// End function mcbuf_new
+
+
+/// @fn mcbuffer_t * mcbuf_new_mode(uint32_t capacity, mcbuf_mode_t mode)
+/// @brief return new circular buffer instance reference.
+/// In MCB_MODE_SPSC, capacity is rounded up to a power of two,
+/// and the buffer may be used by one reader thread and one writer thread
+/// without locking.
+/// caller should release using mcbuf_destroy();
+/// @param[in] capacity buffer capacity (bytes)
+/// @param[in] mode concurrency mode
+/// @return instance reference on success, NULL otherwise
+mcbuffer_t *mcbuf_new_mode(uint32_t capacity, mcbuf_mode_t mode)
+{
+    void *pidx=NULL;
     mcbuffer_t *self = (mcbuffer_t *)malloc(sizeof(mcbuffer_t));
     if (NULL!=self) {
+        memset(self,0,sizeof(mcbuffer_t));
+        self->mode = mode;
+        if (mode==MCB_MODE_SPSC) {
+            uint32_t pcap=1;
+            while (pcap<capacity && pcap<0x80000000) {
+                pcap<<=1;
+            }
+            capacity=pcap;
+            if (posix_memalign(&pidx,MCBUF_CACHELINE,sizeof(mcbuf_spsc_idx_t))==0) {
+                self->idx = (mcbuf_spsc_idx_t *)pidx;
+                memset(self->idx,0,sizeof(mcbuf_spsc_idx_t));
+            }
+        }else{
+            self->mutex = mthread_mutex_new();
+        }
         self->capacity = capacity;
         self->size=0;
         self->data = (byte *)malloc(capacity*sizeof(byte));
-        self->mutex = mthread_mutex_new();
         self->pwrite = self->data;
         self->pread = self->data;
+        if (NULL==self->data || (mode==MCB_MODE_SPSC && NULL==self->idx)) {
+            fprintf(stderr,"malloc failed (%p)\n",self->data);
+            mcbuf_destroy(&self);
+        }else{
+            memset(self->data,0,capacity);
+        }
     }else{
         fprintf(stderr,"malloc failed (%p)\n",self);
     }
     return self;
 }
-// End function mcbuf_new
+// End function mcbuf_new_mode
 
 
 /// @fn void mcbuf_destroy(mcbuffer_t ** pself)
@@ -135,6 +185,9 @@ void mcbuf_destroy(mcbuffer_t **pself)
             if (NULL != self->mutex) {
                 free(self->mutex);
             }
+            if (NULL != self->idx) {
+                free(self->idx);
+            }
             if (NULL != self->data) {
                 free(self->data);
             }
@@ -156,12 +209,19 @@ void mcbuf_show(mcbuffer_t *self, bool verbose, uint16_t indent)
 {
         if (NULL != self) {
             fprintf(stderr,"%*s[self     %10p]\n",indent,(indent>0?" ":""), self);
-            fprintf(stderr,"%*s[mutex    %10p]\n",indent,(indent>0?" ":""), self->mutex);
+            fprintf(stderr,"%*s[mode     %10s]\n",indent,(indent>0?" ":""), (self->mode==MCB_MODE_SPSC?"spsc":"mutex"));
             fprintf(stderr,"%*s[capacity  x%0x/%u]\n",indent,(indent>0?" ":""), self->capacity, self->capacity);
-            fprintf(stderr,"%*s[size     %10u]\n",indent,(indent>0?" ":""), self->size);
             fprintf(stderr,"%*s[data     %10p]\n",indent,(indent>0?" ":""), self->data);
-            fprintf(stderr,"%*s[pread    %10p]\n",indent,(indent>0?" ":""), self->pread);
-            fprintf(stderr,"%*s[pwrite   %10p]\n",indent,(indent>0?" ":""), self->pwrite);
+            if (self->mode==MCB_MODE_SPSC) {
+                fprintf(stderr,"%*s[idx      %10p]\n",indent,(indent>0?" ":""), self->idx);
+                fprintf(stderr,"%*s[whead    %10u]\n",indent,(indent>0?" ":""), self->idx->whead);
+                fprintf(stderr,"%*s[rtail    %10u]\n",indent,(indent>0?" ":""), self->idx->rtail);
+            }else{
+                fprintf(stderr,"%*s[mutex    %10p]\n",indent,(indent>0?" ":""), self->mutex);
+                fprintf(stderr,"%*s[size     %10u]\n",indent,(indent>0?" ":""), self->size);
+                fprintf(stderr,"%*s[pread    %10p]\n",indent,(indent>0?" ":""), self->pread);
+                fprintf(stderr,"%*s[pwrite   %10p]\n",indent,(indent>0?" ":""), self->pwrite);
+            }
             fprintf(stderr,"%*s[pend     %10p]\n",indent,(indent>0?" ":""), MCBUF_END(self));
             fprintf(stderr,"%*s[avail    %10u]\n",indent,(indent>0?" ":""), mcbuf_available(self));
             fprintf(stderr,"%*s[space    %10u]\n",indent,(indent>0?" ":""), mcbuf_space(self));
@@ -170,133 +230,261 @@ void mcbuf_show(mcbuffer_t *self, bool verbose, uint16_t indent)
 // End function mcbuf_show
 
 
-/// @fn int mcbuf_read(mcbuffer_t * self, byte * dest, uint32_t len, mcbuf_flag_t flags, int * status)
-/// @brief read from circular buffer into destination buffer.
+/// @fn uint32_t s_iov_len(mcbuf_iov_t * iov, uint32_t iovcnt)
+/// @brief total length of iov segments.
+/// @param[in] iov segment array
+/// @param[in] iovcnt number of segments
+/// @return total length (bytes), or 0 if any segment is invalid
+static uint32_t s_iov_len(mcbuf_iov_t *iov, uint32_t iovcnt)
+{
+    uint32_t retval=0;
+    uint32_t i=0;
+    for (i=0; i<iovcnt; i++) {
+        if (NULL==iov[i].buf && iov[i].len>0) {
+            return 0;
+        }
+        retval += iov[i].len;
+    }
+    return retval;
+}
+// End function s_iov_len
+
+
+/// @fn void s_ring_put(mcbuffer_t * self, uint32_t pos, mcbuf_iov_t * iov, uint32_t iovcnt, uint32_t len)
+/// @brief copy len bytes from iov segments into buffer starting at offset pos.
 /// @param[in] self cbuffer reference
-/// @param[in] dest destination buffer
-/// @param[in] len number of bytes to read
+/// @param[in] pos buffer offset (<capacity)
+/// @param[in] iov source segments
+/// @param[in] iovcnt number of segments
+/// @param[in] len number of bytes to copy
+/// @return none
+static void s_ring_put(mcbuffer_t *self, uint32_t pos, mcbuf_iov_t *iov, uint32_t iovcnt, uint32_t len)
+{
+    uint32_t i=0;
+    for (i=0; i<iovcnt && len>0; i++) {
+        byte *src = iov[i].buf;
+        uint32_t n = (iov[i].len<len ? iov[i].len : len);
+        len -= n;
+        while (n>0) {
+            uint32_t seg = self->capacity-pos;
+            if (seg>n) {
+                seg=n;
+            }
+            memcpy(self->data+pos,src,seg);
+            src += seg;
+            n -= seg;
+            pos += seg;
+            if (pos==self->capacity) {
+                pos=0;
+            }
+        }
+    }
+}
+// End function s_ring_put
+
+
+/// @fn void s_ring_get(mcbuffer_t * self, uint32_t pos, mcbuf_iov_t * iov, uint32_t iovcnt, uint32_t len, bool zero)
+/// @brief copy len bytes from buffer starting at offset pos into iov segments.
+/// @param[in] self cbuffer reference
+/// @param[in] pos buffer offset (<capacity)
+/// @param[in] iov destination segments
+/// @param[in] iovcnt number of segments
+/// @param[in] len number of bytes to copy
+/// @param[in] zero zero buffer bytes after copying
+/// @return none
+static void s_ring_get(mcbuffer_t *self, uint32_t pos, mcbuf_iov_t *iov, uint32_t iovcnt, uint32_t len, bool zero)
+{
+    uint32_t i=0;
+    for (i=0; i<iovcnt && len>0; i++) {
+        byte *dest = iov[i].buf;
+        uint32_t n = (iov[i].len<len ? iov[i].len : len);
+        len -= n;
+        while (n>0) {
+            uint32_t seg = self->capacity-pos;
+            if (seg>n) {
+                seg=n;
+            }
+            memcpy(dest,self->data+pos,seg);
+            if (zero) {
+                memset(self->data+pos,0,seg);
+            }
+            dest += seg;
+            n -= seg;
+            pos += seg;
+            if (pos==self->capacity) {
+                pos=0;
+            }
+        }
+    }
+}
+// End function s_ring_get
+
+
+/// @fn uint32_t s_xfer_len(uint32_t len, uint32_t avail, mcbuf_flag_t flags, int empty_status, int short_status, int * status)
+/// @brief number of bytes to transfer for a request.
+/// @param[in] len requested length
+/// @param[in] avail available data (read) or space (write)
+/// @param[in] flags behavior flags
+/// @param[in] empty_status status if avail is 0
+/// @param[in] short_status status if avail<len and partial not allowed
+/// @param[out] status contains exit/error status
+/// @return number of bytes to transfer
+static uint32_t s_xfer_len(uint32_t len, uint32_t avail, mcbuf_flag_t flags, int empty_status, int short_status, int *status)
+{
+    uint32_t retval=0;
+    if (avail==0) {
+        *status = empty_status;
+    }else if (avail>=len) {
+        retval=len;
+        *status=MCB_OK;
+    }else if ( (flags&MCB_ALLOW_PARTIAL) != 0 ) {
+        retval=avail;
+        *status=MCB_OK;
+    }else{
+        *status=short_status;
+    }
+    return retval;
+}
+// End function s_xfer_len
+
+
+/// @fn int mcbuf_readv(mcbuffer_t * self, mcbuf_iov_t * iov, uint32_t iovcnt, mcbuf_flag_t flags, int * status)
+/// @brief read from circular buffer into destination segments.
+/// Segments are filled in order; the read is a single operation
+/// (one lock in MCB_MODE_MUTEX, one index update in MCB_MODE_SPSC),
+/// so a reader may collect several frames per call.
+/// @param[in] self cbuffer reference
+/// @param[in] iov destination segments
+/// @param[in] iovcnt number of segments
 /// @param[in] flags read behavior flags
 /// @param[in] status contains exit/error status
 /// @return number of bytes read on success, -1 otherwise (status is set)
 /// @sa mcbuf_flag_t
-int mcbuf_read(mcbuffer_t *self, byte *dest, uint32_t len, mcbuf_flag_t flags, int *status)
+int mcbuf_readv(mcbuffer_t *self, mcbuf_iov_t *iov, uint32_t iovcnt, mcbuf_flag_t flags, int *status)
 {
     int retval = -1;
-    
-    if (NULL != self && NULL != dest && len>0) {
-        
+    uint32_t len = (NULL!=iov ? s_iov_len(iov,iovcnt) : 0);
+
+    if (NULL != self && NULL != self->data && len>0) {
         uint32_t read_len=0;
 
-        if (self->size==0) {
-            // buffer is empty
-            read_len=0;
-            *status = MCB_EMPTY;
-        }else{
-            if ( self->size >= len) {
-                // full read available
-                read_len=len;
-                *status=MCB_OK;
-            }else{
-                // partial read available
-                if ( (flags&MCB_ALLOW_PARTIAL) != 0 ) {
-                    // read partial
-                    read_len = self->size;
-                    *status=MCB_OK;
-                }else{
-                    // don't write
-                    read_len=0;
-                    *status=MCB_UFLOW;
-                }
+        if (self->mode==MCB_MODE_SPSC) {
+            mcbuf_spsc_idx_t *idx = self->idx;
+            uint32_t rtail = MCBUF_LOAD_RELAXED(&idx->rtail);
+            if ( (idx->rcache-rtail) < len) {
+                // refresh writer index only when needed
+                idx->rcache = MCBUF_LOAD_ACQUIRE(&idx->whead);
             }
-        }
-
-        mthread_mutex_lock(self->mutex);
-        if (read_len>0) {
-            uint32_t count=0;
-            for (count=0; count<read_len; count++) {
-                dest[count] = *self->pread;
-                *self->pread = 0x00;
-                self->size--;
-                if (self->pread==MCBUF_END(self)) {
-                    self->pread=self->data;
-                }else{
-                	self->pread++;
-                }
+            read_len = s_xfer_len(len,idx->rcache-rtail,flags,MCB_EMPTY,MCB_UFLOW,status);
+            if (read_len>0) {
+                s_ring_get(self,rtail&(self->capacity-1),iov,iovcnt,read_len,false);
+                MCBUF_STORE_RELEASE(&idx->rtail,rtail+read_len);
+                retval=read_len;
             }
-            retval=count;
+        }else{
+            mthread_mutex_lock(self->mutex);
+            read_len = s_xfer_len(len,self->size,flags,MCB_EMPTY,MCB_UFLOW,status);
+            if (read_len>0) {
+                uint32_t pos = self->pread-self->data;
+                s_ring_get(self,pos,iov,iovcnt,read_len,true);
+                self->pread = self->data+((pos+read_len)%self->capacity);
+                self->size -= read_len;
+                retval=read_len;
+            }
+            mthread_mutex_unlock(self->mutex);
         }
-        mthread_mutex_unlock(self->mutex);
-        
     }else{
         fprintf(stderr,"invalid argument\n");
     }
     return retval;
 }
-// End function mcbuf_read
+// End function mcbuf_readv
 
 
-
-/// @fn int mcbuf_write(mcbuffer_t * self, byte * src, uint32_t len, mcbuf_flag_t flags, int * status)
-/// @brief write to circular buffer.
+/// @fn int mcbuf_writev(mcbuffer_t * self, mcbuf_iov_t * iov, uint32_t iovcnt, mcbuf_flag_t flags, int * status)
+/// @brief write source segments to circular buffer.
+/// Segments are written in order as a single operation, so a
+/// reader never sees part of a batch (unless MCB_ALLOW_PARTIAL
+/// is set and there is not enough space).
 /// @param[in] self cbuffer reference
-/// @param[in] src source buffer
-/// @param[in] len number of bytes to read
+/// @param[in] iov source segments
+/// @param[in] iovcnt number of segments
 /// @param[in] flags write flags
 /// @param[in] status contains exit/error status
 /// @return number of bytes written on success, -1 otherwise (status is set)
 /// @sa mcbuf_flag_t
-int mcbuf_write(mcbuffer_t *self, byte *src, uint32_t len, mcbuf_flag_t flags, int *status)
+int mcbuf_writev(mcbuffer_t *self, mcbuf_iov_t *iov, uint32_t iovcnt, mcbuf_flag_t flags, int *status)
 {
     int retval = -1;
-    
-    if (NULL != self && NULL != src && len>0) {
-        
+    uint32_t len = (NULL!=iov ? s_iov_len(iov,iovcnt) : 0);
+
+    if (NULL != self && NULL != self->data && len>0) {
         uint32_t write_len=0;
 
-        if (self->size == self->capacity) {
-            // buffer is empty
-            write_len=0;
-            *status = MCB_FULL;
-        }else{
-            if ( mcbuf_space(self) >= len) {
-                // full read available
-                write_len=len;
-                *status=MCB_OK;
-            }else{
-                // partial read available
-                if ( (flags&MCB_ALLOW_PARTIAL) != 0 ) {
-                    // read partial
-                    write_len = mcbuf_space(self);
-                    *status=MCB_OK;
-                }else{
-                    // don't write
-                    write_len=0;
-                    *status=MCB_OFLOW;
-                }
+        if (self->mode==MCB_MODE_SPSC) {
+            mcbuf_spsc_idx_t *idx = self->idx;
+            uint32_t whead = MCBUF_LOAD_RELAXED(&idx->whead);
+            if ( (self->capacity-(whead-idx->wcache)) < len) {
+                // refresh reader index only when needed
+                idx->wcache = MCBUF_LOAD_ACQUIRE(&idx->rtail);
             }
-        }
-        
-        mthread_mutex_lock(self->mutex);
-        if (write_len>0) {
-            uint32_t count=0;
-            for (count=0; count<write_len; count++) {
-                *self->pwrite = src[count];
-                self->size++;
-                if (self->pwrite==MCBUF_END(self)) {
-                    self->pwrite=self->data;
-                }else{
-                    self->pwrite++;
-                }
+            write_len = s_xfer_len(len,self->capacity-(whead-idx->wcache),flags,MCB_FULL,MCB_OFLOW,status);
+            if (write_len>0) {
+                s_ring_put(self,whead&(self->capacity-1),iov,iovcnt,write_len);
+                MCBUF_STORE_RELEASE(&idx->whead,whead+write_len);
+                retval=write_len;
+            }
+        }else{
+            mthread_mutex_lock(self->mutex);
+            write_len = s_xfer_len(len,self->capacity-self->size,flags,MCB_FULL,MCB_OFLOW,status);
+            if (write_len>0) {
+                uint32_t pos = self->pwrite-self->data;
+                s_ring_put(self,pos,iov,iovcnt,write_len);
+                self->pwrite = self->data+((pos+write_len)%self->capacity);
+                self->size += write_len;
+                retval=write_len;
             }
-            retval=count;
+            mthread_mutex_unlock(self->mutex);
         }
-        mthread_mutex_unlock(self->mutex);
-        
     }else{
         fprintf(stderr,"invalid argument\n");
     }
     return retval;
 }
+// End function mcbuf_writev
+
+
+/// @fn int mcbuf_read(mcbuffer_t * self, byte * dest, uint32_t len, mcbuf_flag_t flags, int * status)
+/// @brief read from circular buffer into destination buffer.
+/// @param[in] self cbuffer reference
+/// @param[in] dest destination buffer
+/// @param[in] len number of bytes to read
+/// @param[in] flags read behavior flags
+/// @param[in] status contains exit/error status
+/// @return number of bytes read on success, -1 otherwise (status is set)
+/// @sa mcbuf_flag_t
+int mcbuf_read(mcbuffer_t *self, byte *dest, uint32_t len, mcbuf_flag_t flags, int *status)
+{
+    mcbuf_iov_t iov={dest,len};
+    return mcbuf_readv(self,&iov,1,flags,status);
+}
+// End function mcbuf_read
+
+
+/// @fn int mcbuf_write(mcbuffer_t * self, byte * src, uint32_t len, mcbuf_flag_t flags, int * status)
+/// @brief write to circular buffer.
+/// @param[in] self cbuffer reference
+/// @param[in] src source buffer
+/// @param[in] len number of bytes to read
+/// @param[in] flags write flags
+/// @param[in] status contains exit/error status
+/// @return number of bytes written on success, -1 otherwise (status is set)
+/// @sa mcbuf_flag_t
+int mcbuf_write(mcbuffer_t *self, byte *src, uint32_t len, mcbuf_flag_t flags, int *status)
+{
+    mcbuf_iov_t iov={src,len};
+    return mcbuf_writev(self,&iov,1,flags,status);
+}
 // End function mcbuf_write
 
 
@@ -308,9 +496,16 @@ uint32_t mcbuf_available(mcbuffer_t *self)
 {
     uint32_t retval = 0;
     if (NULL != self && NULL != self->data) {
-        retval=self->size;
+        if (self->mode==MCB_MODE_SPSC) {
+            uint32_t rtail = MCBUF_LOAD_ACQUIRE(&self->idx->rtail);
+            retval = MCBUF_LOAD_ACQUIRE(&self->idx->whead)-rtail;
+        }else{
+            mthread_mutex_lock(self->mutex);
+            retval=self->size;
+            mthread_mutex_unlock(self->mutex);
+        }
     }else{
-        fprintf(stderr,"invalid argument s[%p] d[%p]\n",self,self->data);
+        fprintf(stderr,"invalid argument s[%p]\n",self);
     }
     return retval;
 }
@@ -325,9 +520,9 @@ uint32_t mcbuf_space(mcbuffer_t *self)
 {
     uint32_t retval = 0;
     if (NULL != self && NULL != self->data) {
-        retval = self->capacity-self->size;
+        retval = self->capacity-mcbuf_available(self);
     }else{
-        fprintf(stderr,"invalid argument s[%p] d[%p]\n",self,self->data);
+        fprintf(stderr,"invalid argument s[%p]\n",self);
     }
     return retval;
 }
@@ -336,19 +531,26 @@ uint32_t mcbuf_space(mcbuffer_t *self)
 
 /// @fn int mcbuf_clear(mcbuffer_t * self)
 /// @brief clear circular buffer contents.
+/// In MCB_MODE_SPSC, the reader and writer must not be active.
 /// @param[in] self cbuffer reference
-/// @return 0 on success, -1 otherwise
+/// @return number of bytes discarded on success, -1 otherwise
 int mcbuf_clear(mcbuffer_t *self)
 {
     int retval = -1;
     if (NULL!=self && NULL!=self->data && self->capacity>0) {
-        retval=self->size;
+        retval=mcbuf_available(self);
         memset(self->data,0,self->capacity);
-        self->pread=self->data;
-        self->pwrite=self->data;
-        self->size=0;
+        if (self->mode==MCB_MODE_SPSC) {
+            memset(self->idx,0,sizeof(mcbuf_spsc_idx_t));
+        }else{
+            mthread_mutex_lock(self->mutex);
+            self->pread=self->data;
+            self->pwrite=self->data;
+            self->size=0;
+            mthread_mutex_unlock(self->mutex);
+        }
     }else{
-        fprintf(stderr,"invalid argument s[%p] d[%p] c[%u]\n",self,self->data,self->capacity);
+        fprintf(stderr,"invalid argument s[%p]\n",self);
     }
     return retval;
 }
@@ -358,10 +560,11 @@ int mcbuf_clear(mcbuffer_t *self)
 //int mcbuf_oflush(mcbuffer_t *self);
 //int mcbuf_resize(mcbuffer_t *self, uint32_t len);
 
-/// @fn int mcbuf_test()
-/// @brief cbuffer unit test(s).
+/// @fn int s_mcbuf_test_mode(mcbuf_mode_t mode)
+/// @brief cbuffer unit test(s) for one concurrency mode.
+/// @param[in] mode concurrency mode
 /// @return TBD
-int mcbuf_test()
+static int s_mcbuf_test_mode(mcbuf_mode_t mode)
 {
 #define RWCAP 32
     int retval=0;
@@ -369,7 +572,7 @@ int mcbuf_test()
     uint32_t rwcap=RWCAP;
     int ret=0;
     int status=MCB_OK;
-    mcbuffer_t *b = mcbuf_new(cap);
+    mcbuffer_t *b = mcbuf_new_mode(cap,mode);
     uint32_t avail = mcbuf_available(b);
     uint32_t space = mcbuf_space(b);
     byte wdata[RWCAP];
@@ -464,12 +667,47 @@ int mcbuf_test()
     assert(mcbuf_space(b)==cap);
     assert(MCBUF_IS_EMPTY(b)==true);
 
+    // batch write and read across the wrap point
+    mcbuf_write(b,wdata,10,MCB_NONE,&status);
+    mcbuf_read(b,rdata,10,MCB_NONE,&status);
+    {
+        mcbuf_iov_t wiov[3]={{wdata,3},{wdata+3,5},{wdata+8,4}};
+        byte r1[6];
+        byte r2[6];
+        mcbuf_iov_t riov[2]={{r1,6},{r2,6}};
+        ret = mcbuf_writev(b,wiov,3,MCB_NONE,&status);
+        assert(ret==12);
+        assert(status==MCB_OK);
+        assert(mcbuf_available(b)==12);
+        ret = mcbuf_writev(b,wiov,3,MCB_NONE,&status);
+        assert(ret==-1);
+        assert(status==MCB_OFLOW);
+        ret = mcbuf_readv(b,riov,2,MCB_NONE,&status);
+        assert(ret==12);
+        assert(status==MCB_OK);
+        assert(memcmp(r1,wdata,6)==0);
+        assert(memcmp(r2,wdata+6,6)==0);
+        assert(MCBUF_IS_EMPTY(b));
+    }
+
     fprintf(stderr,"test end:\n");
     mcbuf_show(b,true,5);
     mcbuf_destroy(&b);
     
     return retval;
 }
+// End function s_mcbuf_test_mode
+
+/// @fn int mcbuf_test()
+/// @brief cbuffer unit test(s).
+/// @return TBD
+int mcbuf_test()
+{
+    int retval=0;
+    retval |= s_mcbuf_test_mode(MCB_MODE_MUTEX);
+    retval |= s_mcbuf_test_mode(MCB_MODE_SPSC);
+    return retval;
+}
 // End function mcbuf_test
 
 
@@ -89,7 +89,10 @@
 /// @def MCBUF_IS_EMPTY(c)
 /// @brief returns true if buffer is empty
 /// @param[in] c cbuffer reference
-#define MCBUF_IS_EMPTY(c)   (c->size==0 ? true : false)
+#define MCBUF_IS_EMPTY(c)   (mcbuf_available(c)==0 ? true : false)
+/// @def MCBUF_CACHELINE
+/// @brief cache line size used to separate SPSC read and write indices
+#define MCBUF_CACHELINE 64
 //#define MCBUF_RWRAP(c)      ( ((c->data+c->capacity) - c->pread) + (self->pwrite - self->data) )
 //#define MCBUF_WWRAP(c)      ( ((c->data+c->capacity) - c->pwrite) + (self->pread - self->data) )
 //#define MCBUF_I2O(c)        (c->pwrite - c->pread)
@@ -120,25 +123,78 @@ typedef enum {MCB_NONE=0,MCB_ALLOW_PARTIAL=0x1} mcbuf_flag_t;
 /// MCB_EMPTY buffer empty
 /// MCB_OFLOW overflow  (e.g. write request exceeds available space)
 typedef enum {MCB_OK=0,MCB_UFLOW, MCB_EMPTY, MCB_FULL, MCB_OFLOW} mcbuf_status_t;
+/// @typedef enum mcbuf_mode_t mcbuf_mode_t
+/// @brief cbuffer concurrency mode, set at construction
+/// MCB_MODE_MUTEX reads and writes are serialized using a mutex;
+///                any number of reader and writer threads
+/// MCB_MODE_SPSC  lock-free; exactly one reader thread and
+///                one writer thread. Capacity is rounded up
+///                to a power of two.
+typedef enum {MCB_MODE_MUTEX=0, MCB_MODE_SPSC} mcbuf_mode_t;
+
+/// @typedef struct mcbuf_iov_s mcbuf_iov_t
+/// @brief buffer segment for batch read/write
+typedef struct mcbuf_iov_s{
+    /// @var mcbuf_iov_s::buf
+    /// @brief segment data
+    byte *buf;
+    /// @var mcbuf_iov_s::len
+    /// @brief segment length (bytes)
+    uint32_t len;
+}mcbuf_iov_t;
+
+/// @typedef struct mcbuf_spsc_idx_s mcbuf_spsc_idx_t
+/// @brief SPSC mode read/write indices.
+/// The indices increase monotonically (modulo 2^32) and are
+/// masked to locate data. Writer and reader fields are on
+/// separate cache lines; each side caches the last index
+/// it read from the other side.
+typedef struct mcbuf_spsc_idx_s{
+    /// @var mcbuf_spsc_idx_s::whead
+    /// @brief write index (written by writer)
+    uint32_t whead;
+    /// @var mcbuf_spsc_idx_s::wcache
+    /// @brief writer's copy of rtail
+    uint32_t wcache;
+    /// @var mcbuf_spsc_idx_s::wpad
+    /// @brief cache line padding
+    byte wpad[MCBUF_CACHELINE-2*sizeof(uint32_t)];
+    /// @var mcbuf_spsc_idx_s::rtail
+    /// @brief read index (written by reader)
+    uint32_t rtail;
+    /// @var mcbuf_spsc_idx_s::rcache
+    /// @brief reader's copy of whead
+    uint32_t rcache;
+    /// @var mcbuf_spsc_idx_s::rpad
+    /// @brief cache line padding
+    byte rpad[MCBUF_CACHELINE-2*sizeof(uint32_t)];
+}mcbuf_spsc_idx_t;
 
 /// @typedef struct mcbuffer_s mcbuffer_t
-/// @brief circular buffer structure. cbuffer is thread safe.
+/// @brief circular buffer structure. cbuffer is thread safe
+/// (in SPSC mode, for one reader and one writer thread).
 typedef struct mcbuffer_s{
+    /// @var mcbuffer_s::mode
+    /// @brief concurrency mode
+    mcbuf_mode_t mode;
     /// @var mcbuffer_s::capacity
     /// @brief buffer capacity
     uint32_t capacity;
     /// @var mcbuffer_s::size
-    /// @brief number of bytes currently in buffer
+    /// @brief number of bytes currently in buffer (MCB_MODE_MUTEX)
     uint32_t size;
     /// @var mcbuffer_s::mutex
-    /// @brief mutex
+    /// @brief mutex (MCB_MODE_MUTEX)
     mthread_mutex_t *mutex;
     /// @var mcbuffer_s::pwrite
-    /// @brief write (input) pointer
+    /// @brief write (input) pointer (MCB_MODE_MUTEX)
     byte *pwrite;
     /// @var mcbuffer_s::pread
-    /// @brief read (output) pointer
+    /// @brief read (output) pointer (MCB_MODE_MUTEX)
     byte *pread;
+    /// @var mcbuffer_s::idx
+    /// @brief read/write indices (MCB_MODE_SPSC)
+    mcbuf_spsc_idx_t *idx;
     /// @var mcbuffer_s::data
     /// @brief data buffer memory
     byte *data;
@@ -154,11 +210,14 @@ extern "C" {
 
 // Circular Buffer API
 mcbuffer_t *mcbuf_new(uint32_t capacity);
+mcbuffer_t *mcbuf_new_mode(uint32_t capacity, mcbuf_mode_t mode);
 void mcbuf_destroy(mcbuffer_t **pself);
 void mcbuf_show(mcbuffer_t *self, bool verbose, uint16_t indent);
 
 int mcbuf_read(mcbuffer_t *self, byte *dest, uint32_t len, mcbuf_flag_t flags, int *status);
 int mcbuf_write(mcbuffer_t *self, byte *src, uint32_t len, mcbuf_flag_t flags, int *status);
+int mcbuf_readv(mcbuffer_t *self, mcbuf_iov_t *iov, uint32_t iovcnt, mcbuf_flag_t flags, int *status);
+int mcbuf_writev(mcbuffer_t *self, mcbuf_iov_t *iov, uint32_t iovcnt, mcbuf_flag_t flags, int *status);
 uint32_t mcbuf_available(mcbuffer_t *self);
 uint32_t mcbuf_space(mcbuffer_t *self);
 int mcbuf_clear(mcbuffer_t *self);
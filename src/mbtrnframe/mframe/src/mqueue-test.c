@@ -0,0 +1,339 @@
+///
+/// @file mqueue-test.c
+/// @authors k. Headley
+/// @date 16 oct 2026
+
+/// Steady-state allocation test for pooled mqueue entries
+
+/// Streams items through pooled tail and circular queues and
+/// verifies (using mstats_alloc_count) that no entries are
+/// allocated from the heap once the pool is sized for the
+/// queue depth; then stresses a lock-free pool with concurrent
+/// get/put threads.
+/// Compile test (in src directory) using
+/// gcc -o mqueue-test mqueue-test.c -L../bin -lmframe -lpthread -lm
+/// @sa doxygen-examples.c for more examples of Doxygen markup
+
+
+/////////////////////////
+// Terms of use
+/////////////////////////
+/*
+ Copyright Information
+ 
+ Copyright 2002-2026 MBARI
+ Monterey Bay Aquarium Research Institute, all rights reserved.
+ 
+ Terms of Use
+ 
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version. You can access the GPLv3 license at
+ http://www.gnu.org/licenses/gpl-3.0.html
+ 
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details
+ (http://www.gnu.org/licenses/gpl-3.0.html)
+ 
+ MBARI provides the documentation and software code "as is", with no warranty,
+ express or implied, as to the software, title, non-infringement of third party
+ rights, merchantability, or fitness for any particular purpose, the accuracy of
+ the code, or the performance or results which you may obtain from its use. You
+ assume the entire risk associated with use of the code, and you agree to be
+ responsible for the entire cost of repair or servicing of the program with
+ which you are using the code.
+ 
+ In no event shall MBARI be liable for any damages, whether general, special,
+ incidental or consequential damages, arising out of your use of the software,
+ including, but not limited to, the loss or corruption of your data or damages
+ of any kind resulting from use of the software, any prohibited use, or your
+ inability to use the software. You agree to defend, indemnify and hold harmless
+ MBARI and its officers, directors, and employees against any claim, loss,
+ liability or expense, including attorneys' fees, resulting from loss of or
+ damage to property or the injury to or death of any person arising out of the
+ use of the software.
+ 
+ The MBARI software is provided without obligation on the part of the
+ Monterey Bay Aquarium Research Institute to assist in its use, correction,
+ modification, or enhancement.
+ 
+ MBARI assumes no responsibility or liability for any third party and/or
+ commercial software required for the database or applications. Licensee agrees
+ to obtain and maintain valid licenses for any additional third party software
+ required.
+ */
+
+
+
+/////////////////////////
+// Headers
+/////////////////////////
+
+#if !defined(__QNX__)
+#include <getopt.h>
+#endif
+#include <sched.h>
+#include "mframe.h"
+#include "mqueue.h"
+#include "mstats.h"
+#include "mthread.h"
+#include "mtime.h"
+
+/////////////////////////
+// Declarations
+/////////////////////////
+
+/// @typedef struct app_cfg_s app_cfg_t
+/// @brief application configuration parameter structure
+typedef struct app_cfg_s{
+    /// @var app_cfg_s::items
+    /// @brief number of items to stream
+    uint32_t items;
+    /// @var app_cfg_s::depth
+    /// @brief queue depth (pool capacity)
+    uint32_t depth;
+    /// @var app_cfg_s::threads
+    /// @brief number of lock-free stress threads
+    uint32_t threads;
+}app_cfg_t;
+
+/// @typedef struct stress_s stress_t
+/// @brief lock-free pool stress thread state
+typedef struct stress_s{
+    mq_pool_t *pool;
+    uint32_t iterations;
+    uint32_t id;
+    uint32_t errors;
+}stress_t;
+
+/////////////////////////
+// Function Definitions
+/////////////////////////
+
+/// @fn void s_show_help()
+/// @brief output user help message to stdout.
+/// @return none
+static void s_show_help()
+{
+    char help_message[] = "\nmqueue pooled entry test\n";
+    char usage_message[] = "\nmqueue-test [options]\n"
+    "--help        : output help message\n"
+    "--items=n     : number of items to stream [default 1000000]\n"
+    "--depth=n     : queue depth (pool capacity) [default 64]\n"
+    "--threads=n   : lock-free stress threads [default 4]\n"
+    "\n";
+    printf("%s",help_message);
+    printf("%s",usage_message);
+}
+// End function s_show_help
+
+/// @fn void s_parse_args(int argc, char ** argv, app_cfg_t * cfg)
+/// @brief parse command line args, set application configuration.
+/// @param[in] argc number of arguments
+/// @param[in] argv array of command line arguments (strings)
+/// @param[in] cfg application config structure
+/// @return none
+static void s_parse_args(int argc, char **argv, app_cfg_t *cfg)
+{
+    extern char WIN_DECLSPEC *optarg;
+    int option_index;
+    int c;
+    bool help=false;
+
+    static struct option options[] = {
+        {"help", no_argument, NULL, 0},
+        {"items", required_argument, NULL, 0},
+        {"depth", required_argument, NULL, 0},
+        {"threads", required_argument, NULL, 0},
+        {NULL, 0, NULL, 0}};
+
+    while ((c = getopt_long(argc, argv, "", options, &option_index)) != -1){
+        switch (c) {
+            case 0:
+                if (strcmp("help", options[option_index].name) == 0) {
+                    help = true;
+                }else if (strcmp("items", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->items);
+                }else if (strcmp("depth", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->depth);
+                }else if (strcmp("threads", options[option_index].name) == 0) {
+                    sscanf(optarg,"%u",&cfg->threads);
+                }
+                break;
+            default:
+                help=true;
+                break;
+        }
+        if (help) {
+            s_show_help();
+            exit(0);
+        }
+    }
+    if (cfg->depth<1) {
+        cfg->depth=1;
+    }
+}
+// End function s_parse_args
+
+/// @fn int s_tq_stream(app_cfg_t *cfg)
+/// @brief stream items through a pooled tail queue (FIFO, depth items queued).
+/// @param[in] cfg application config
+/// @return 0 on success, -1 otherwise
+static int s_tq_stream(app_cfg_t *cfg)
+{
+    int retval=-1;
+    mq_tqueue_t *q = mqtq_pnew(cfg->depth,MQP_NONE);
+    uint64_t a_start = mstats_alloc_count();
+    uint64_t expect=0;
+    uint32_t errors=0;
+    uint32_t i=0;
+    double t_start = mtime_dtime();
+
+    for (i=0; i<cfg->items; i++) {
+        xtq_entry_t *tqe=NULL;
+        mq_tqadd(q,(void *)(uintptr_t)i);
+        if (i+1>=cfg->depth) {
+            tqe = mq_tqfirst(q);
+            if ((uintptr_t)tqe->item != expect++) {
+                errors++;
+            }
+            mq_tnqdelete(q,tqe);
+        }
+    }
+    double elapsed = mtime_dtime()-t_start;
+    uint64_t a_count = mstats_alloc_count()-a_start;
+
+    fprintf(stderr,"tq: items %u depth %u  %.1lf items/s  heap allocs %"PRIu64"  errors %u\n",
+            cfg->items,cfg->depth,cfg->items/elapsed,a_count,errors);
+    retval = (a_count==0 && errors==0 ? 0 : -1);
+    mq_tnqdestroy(q);
+    return retval;
+}
+// End function s_tq_stream
+
+/// @fn int s_cq_stream(app_cfg_t *cfg)
+/// @brief stream items through a pooled circular queue (FIFO, depth items queued).
+/// @param[in] cfg application config
+/// @return 0 on success, -1 otherwise
+static int s_cq_stream(app_cfg_t *cfg)
+{
+    int retval=-1;
+    mq_cqueue_t *q = mqcq_pnew(cfg->depth,MQP_MUTEX);
+    uint64_t a_start = mstats_alloc_count();
+    uint64_t expect=0;
+    uint32_t errors=0;
+    uint32_t i=0;
+    double t_start = mtime_dtime();
+
+    for (i=0; i<cfg->items; i++) {
+        xcq_entry_t *cqe=NULL;
+        mq_cqadd(q,(void *)(uintptr_t)i);
+        if (i+1>=cfg->depth) {
+            cqe = mq_cqfirst(q);
+            if ((uintptr_t)cqe->item != expect++) {
+                errors++;
+            }
+            mq_cnqdelete(q,cqe);
+        }
+    }
+    double elapsed = mtime_dtime()-t_start;
+    uint64_t a_count = mstats_alloc_count()-a_start;
+
+    fprintf(stderr,"cq: items %u depth %u  %.1lf items/s  heap allocs %"PRIu64"  errors %u\n",
+            cfg->items,cfg->depth,cfg->items/elapsed,a_count,errors);
+    retval = (a_count==0 && errors==0 ? 0 : -1);
+    mq_cnqdestroy(q);
+    return retval;
+}
+// End function s_cq_stream
+
+/// @fn void *s_stress(void *arg)
+/// @brief get/put pool entries, checking that no entry
+/// is handed to two threads at once.
+/// @param[in] arg stress_t reference
+/// @return NULL
+static void *s_stress(void *arg)
+{
+    stress_t *st = (stress_t *)arg;
+    uint32_t i=0;
+    for (i=0; i<st->iterations; i++) {
+        uint32_t *node = (uint32_t *)mq_pool_get(st->pool,st->pool->node_size);
+        node[0] = st->id;
+        node[1] = i;
+        sched_yield();
+        if (node[0]!=st->id || node[1]!=i) {
+            st->errors++;
+        }
+        mq_pool_put(st->pool,node);
+    }
+    return NULL;
+}
+// End function s_stress
+
+/// @fn int s_pool_stress(app_cfg_t *cfg)
+/// @brief run concurrent get/put threads on a lock-free pool.
+/// @param[in] cfg application config
+/// @return 0 on success, -1 otherwise
+static int s_pool_stress(app_cfg_t *cfg)
+{
+    int retval=-1;
+    mq_pool_t *pool = mq_pool_new(2*sizeof(uint32_t),cfg->threads,MQP_LOCKFREE);
+    mthread_thread_t **threads = (mthread_thread_t **)malloc(cfg->threads*sizeof(mthread_thread_t *));
+    stress_t *st = (stress_t *)malloc(cfg->threads*sizeof(stress_t));
+    uint32_t errors=0;
+    uint32_t i=0;
+
+    if (NULL!=pool && NULL!=threads && NULL!=st) {
+        for (i=0; i<cfg->threads; i++) {
+            st[i].pool = pool;
+            st[i].iterations = cfg->items/cfg->threads;
+            st[i].id = i;
+            st[i].errors = 0;
+            threads[i] = mthread_thread_new();
+            mthread_thread_start(threads[i],s_stress,&st[i]);
+        }
+        for (i=0; i<cfg->threads; i++) {
+            mthread_thread_join(threads[i]);
+            mthread_thread_destroy(&threads[i]);
+            errors += st[i].errors;
+        }
+        fprintf(stderr,"pool: threads %u flags 0x%X heap allocs %"PRIu64"  errors %u\n",
+                cfg->threads,pool->flags,pool->heap_allocs,errors);
+        retval = (pool->heap_allocs==0 && errors==0 ? 0 : -1);
+    }
+    free(st);
+    free(threads);
+    mq_pool_destroy(&pool);
+    return retval;
+}
+// End function s_pool_stress
+
+/// @fn int main(int argc, char ** argv)
+/// @brief mqueue-test main entry point.
+/// @param[in] argc number of command line arguments
+/// @param[in] argv array of command line arguments (strings)
+/// @return 0 on success, -1 otherwise
+int main(int argc, char **argv)
+{
+    // C89 declarations (for QNX portability)
+    int retval=0;
+    app_cfg_t cfg={1000000,64,4};
+
+    s_parse_args(argc,argv,&cfg);
+
+    if (s_tq_stream(&cfg)!=0) {
+        retval=-1;
+    }
+    if (s_cq_stream(&cfg)!=0) {
+        retval=-1;
+    }
+    if (cfg.threads>0 && s_pool_stress(&cfg)!=0) {
+        retval=-1;
+    }
+    fprintf(stderr,"mqueue-test %s\n",(retval==0?"OK":"FAILED"));
+    return retval;
+}
+// End function main
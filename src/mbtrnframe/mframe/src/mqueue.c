@@ -64,11 +64,17 @@
 
 #include "mqueue.h"
 #include "mmem.h"
+#include "mstats.h"
 
 /////////////////////////
 // Macros
 /////////////////////////
 
+// MQP_LOCKFREE requires 64-bit compare and swap
+#if defined(__ATOMIC_ACQ_REL) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_8)
+#define MQ_POOL_HAVE_CAS64 1
+#endif
+
 /////////////////////////
 // Declarations 
 /////////////////////////
@@ -85,6 +91,171 @@
 // Function Definitions
 /////////////////////////
 
+/// @fn mq_pool_t *mq_pool_new(uint32_t node_size, uint32_t capacity, mq_pool_flags_t flags)
+/// @brief create queue entry pool with capacity preallocated entries.
+/// caller should release using mq_pool_destroy
+/// @param[in] node_size entry size (bytes)
+/// @param[in] capacity number of entries to preallocate
+/// @param[in] flags locking flags
+/// @return new pool on success, NULL otherwise
+mq_pool_t *mq_pool_new(uint32_t node_size, uint32_t capacity, mq_pool_flags_t flags)
+{
+    mq_pool_t *self = NULL;
+    if (node_size>0 && capacity>0) {
+        self = (mq_pool_t *)malloc(sizeof(mq_pool_t));
+        if (NULL!=self) {
+            uint32_t i=0;
+            memset(self,0,sizeof(mq_pool_t));
+            // keep entries pointer aligned
+            self->node_size = (node_size+sizeof(void *)-1) & ~(uint32_t)(sizeof(void *)-1);
+            self->capacity = capacity;
+#if !defined(MQ_POOL_HAVE_CAS64)
+            if ( (flags&MQP_LOCKFREE) != 0) {
+                flags = MQP_MUTEX;
+            }
+#endif
+            self->flags = flags;
+            self->nodes = (byte *)malloc((size_t)self->node_size*capacity);
+            self->next = (uint32_t *)malloc(capacity*sizeof(uint32_t));
+            if ( (flags&MQP_MUTEX) != 0) {
+                self->mutex = mthread_mutex_new();
+            }
+            if (NULL==self->nodes || NULL==self->next) {
+                mq_pool_destroy(&self);
+            }else{
+                // all entries start on the free list, in order
+                for (i=0; i<capacity; i++) {
+                    self->next[i] = (i+1<capacity ? i+2 : 0);
+                }
+                self->head = 1;
+            }
+        }
+    }
+    return self;
+}
+// End function mq_pool_new
+
+/// @fn void mq_pool_destroy(mq_pool_t **pself)
+/// @brief release pool resources. Entries taken from
+/// the pool must not be used after this call.
+/// @param[in] pself pointer to instance reference
+/// @return none
+void mq_pool_destroy(mq_pool_t **pself)
+{
+    if (NULL!=pself) {
+        mq_pool_t *self = *pself;
+        if (NULL!=self) {
+            if (NULL!=self->mutex) {
+                mthread_mutex_destroy(&self->mutex);
+            }
+            free(self->nodes);
+            free(self->next);
+            free(self);
+        }
+        *pself=NULL;
+    }
+}
+// End function mq_pool_destroy
+
+/// @fn void *mq_pool_get(mq_pool_t *self, uint32_t node_size)
+/// @brief get queue entry from pool. If the pool is NULL or
+/// empty, the entry is allocated from the heap and counted
+/// using mstats_alloc_add.
+/// @param[in] self pool reference (may be NULL)
+/// @param[in] node_size entry size (bytes)
+/// @return entry pointer on success, NULL otherwise
+void *mq_pool_get(mq_pool_t *self, uint32_t node_size)
+{
+    void *retval=NULL;
+
+    if (NULL!=self) {
+        uint32_t i=0;
+#if defined(MQ_POOL_HAVE_CAS64)
+        if ( (self->flags&MQP_LOCKFREE) != 0) {
+            // pop free list; the tag in the upper word of
+            // head changes on every update, preventing ABA
+            uint64_t old = __atomic_load_n(&self->head,__ATOMIC_ACQUIRE);
+            while ( (uint32_t)old != 0) {
+                uint32_t top = (uint32_t)old;
+                uint64_t new = (((old>>32)+1)<<32) | __atomic_load_n(&self->next[top-1],__ATOMIC_RELAXED);
+                if (__atomic_compare_exchange_n(&self->head,&old,new,false,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)) {
+                    i = top;
+                    break;
+                }
+            }
+        }else
+#endif
+        {
+            if (NULL!=self->mutex) {
+                mthread_mutex_lock(self->mutex);
+            }
+            i = (uint32_t)self->head;
+            if (i!=0) {
+                self->head = (((self->head>>32)+1)<<32) | self->next[i-1];
+            }
+            if (NULL!=self->mutex) {
+                mthread_mutex_unlock(self->mutex);
+            }
+        }
+        if (i!=0) {
+            retval = self->nodes+(size_t)(i-1)*self->node_size;
+        }else{
+#if defined(__ATOMIC_RELAXED)
+            __atomic_fetch_add(&self->heap_allocs,1,__ATOMIC_RELAXED);
+#else
+            self->heap_allocs++;
+#endif
+        }
+    }
+
+    if (NULL==retval) {
+        retval = malloc(NULL!=self ? self->node_size : node_size);
+        mstats_alloc_add(1);
+    }
+    return retval;
+}
+// End function mq_pool_get
+
+/// @fn void mq_pool_put(mq_pool_t *self, void *node)
+/// @brief return queue entry to pool (or free it, if it was
+/// allocated from the heap).
+/// @param[in] self pool reference (may be NULL)
+/// @param[in] node entry pointer
+/// @return none
+void mq_pool_put(mq_pool_t *self, void *node)
+{
+    if (NULL!=node) {
+        byte *pnode = (byte *)node;
+        if (NULL!=self && pnode>=self->nodes &&
+            pnode<(self->nodes+(size_t)self->capacity*self->node_size)) {
+            uint32_t i = (uint32_t)((pnode-self->nodes)/self->node_size)+1;
+#if defined(MQ_POOL_HAVE_CAS64)
+            if ( (self->flags&MQP_LOCKFREE) != 0) {
+                uint64_t old = __atomic_load_n(&self->head,__ATOMIC_ACQUIRE);
+                uint64_t new = 0;
+                do{
+                    __atomic_store_n(&self->next[i-1],(uint32_t)old,__ATOMIC_RELAXED);
+                    new = (((old>>32)+1)<<32) | i;
+                }while (!__atomic_compare_exchange_n(&self->head,&old,new,false,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE));
+            }else
+#endif
+            {
+                if (NULL!=self->mutex) {
+                    mthread_mutex_lock(self->mutex);
+                }
+                self->next[i-1] = (uint32_t)self->head;
+                self->head = (((self->head>>32)+1)<<32) | i;
+                if (NULL!=self->mutex) {
+                    mthread_mutex_unlock(self->mutex);
+                }
+            }
+        }else{
+            free(node);
+        }
+    }
+}
+// End function mq_pool_put
+
 /// @fn mq_tqueue_t *mqtq_new()
 /// @brief read create new tail queue
 /// @return new tail queue on success, NULL otherwise
@@ -92,6 +263,7 @@ mq_tqueue_t *mqtq_new()
 {
 	mq_tqueue_t *newq=(mq_tqueue_t *)malloc(sizeof(mq_tqueue_t));
 	newq->free_fn=NULL;
+	newq->pool=NULL;
 	mq_tnqinit(newq->head);
 	return newq;
 }
@@ -103,10 +275,26 @@ mq_tqueue_t *mqtq_xnew()
 {
 	mq_tqueue_t *newq=(mq_tqueue_t *)mm_alloc(sizeof(mq_tqueue_t));
 	newq->free_fn=NULL;
+	newq->pool=NULL;
 	mq_tnqinit(newq->head);
 	return newq;
 }
 
+/// @fn mq_tqueue_t *mqtq_pnew(uint32_t capacity, mq_pool_flags_t flags)
+/// @brief create new tail queue with capacity preallocated entries
+/// (used by mq_tqadd and mq_tnqdelete)
+/// @param[in] capacity number of preallocated entries
+/// @param[in] flags entry pool flags
+/// @return new tail queue on success, NULL otherwise
+mq_tqueue_t *mqtq_pnew(uint32_t capacity, mq_pool_flags_t flags)
+{
+	mq_tqueue_t *newq=mqtq_new();
+	if (NULL!=newq) {
+		newq->pool=mq_pool_new(sizeof(xtq_entry_t),capacity,flags);
+	}
+	return newq;
+}
+
 #if !defined(__CYGWIN__)
 /// @fn mq_cqueue_t *mqcq_new()
 /// @brief read create new circular queue
@@ -115,6 +303,7 @@ mq_cqueue_t *mqcq_new()
 {
 	mq_cqueue_t *newq=(mq_cqueue_t *)malloc(sizeof(mq_cqueue_t));
 	newq->free_fn=NULL;
+	newq->pool=NULL;
 	mq_cnqinit(newq->head);
 	return newq;
 }
@@ -126,7 +315,23 @@ mq_cqueue_t *mqcq_xnew()
 {
 	mq_cqueue_t *newq=(mq_cqueue_t *)mm_alloc(sizeof(mq_cqueue_t));
 	newq->free_fn=NULL;
+	newq->pool=NULL;
 	mq_cnqinit(newq->head);
 	return newq;
 }
+
+/// @fn mq_cqueue_t *mqcq_pnew(uint32_t capacity, mq_pool_flags_t flags)
+/// @brief create new circular queue with capacity preallocated entries
+/// (used by mq_cqadd and mq_cnqdelete)
+/// @param[in] capacity number of preallocated entries
+/// @param[in] flags entry pool flags
+/// @return new circular queue on success, NULL otherwise
+mq_cqueue_t *mqcq_pnew(uint32_t capacity, mq_pool_flags_t flags)
+{
+	mq_cqueue_t *newq=mqcq_new();
+	if (NULL!=newq) {
+		newq->pool=mq_pool_new(sizeof(xcq_entry_t),capacity,flags);
+	}
+	return newq;
+}
 #endif
\ No newline at end of file
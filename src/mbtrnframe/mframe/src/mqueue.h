@@ -32,7 +32,9 @@
 /// void thing_destroy(void *self);
 ///
 /// // create a list, here a cqueue (CIRCLEQ)
-/// mq_cqueue_t *thing_list=(mq_cqueue_t *)malloc(sizeof(mq_cqueue_t));
+/// // (or use mqcq_pnew(n,MQP_NONE) to preallocate n list entries,
+/// // which mq_cqadd(thing_list,tptr) and mq_cnqdelete will reuse)
+/// mq_cqueue_t *thing_list=mqcq_new();
 /// // a pointer to cqueue list elements
 /// xcq_entry_t *cqe=NULL;
 /// 
@@ -128,6 +130,7 @@
 // Includes 
 /////////////////////////
 #include "mframe.h"
+#include "mthread.h"
 
 /////////////////////////
 // Type Definitions
@@ -153,6 +156,46 @@ typedef struct xcq_entry xcq_entry_t;
 /// @brief queue free function type
 typedef void (* mq_qfree_fn)(void *ptr);
 
+/// @typedef enum mq_pool_flags_t mq_pool_flags_t
+/// @brief queue entry pool flags
+/// MQP_NONE     no locking (queue used by one thread)
+/// MQP_MUTEX    free list protected by mutex
+/// MQP_LOCKFREE lock-free free list (falls back to MQP_MUTEX
+///              if 64-bit atomics are unavailable)
+typedef enum {MQP_NONE=0, MQP_MUTEX=0x1, MQP_LOCKFREE=0x2} mq_pool_flags_t;
+
+/// @typedef struct mq_pool_s mq_pool_t
+/// @brief preallocated queue entry pool.
+/// Entries are taken from a fixed block of capacity nodes;
+/// when the block is exhausted, entries are allocated from the heap
+/// (and counted using mstats_alloc_add) and freed when returned.
+typedef struct mq_pool_s{
+    /// @var mq_pool_s::node_size
+    /// @brief entry size (bytes)
+    uint32_t node_size;
+    /// @var mq_pool_s::capacity
+    /// @brief number of preallocated entries
+    uint32_t capacity;
+    /// @var mq_pool_s::flags
+    /// @brief pool flags
+    mq_pool_flags_t flags;
+    /// @var mq_pool_s::nodes
+    /// @brief entry memory
+    byte *nodes;
+    /// @var mq_pool_s::next
+    /// @brief free list links (index+1, 0 terminates)
+    uint32_t *next;
+    /// @var mq_pool_s::head
+    /// @brief free list head: (tag<<32)|(index+1)
+    uint64_t head;
+    /// @var mq_pool_s::mutex
+    /// @brief free list mutex (MQP_MUTEX)
+    mthread_mutex_t *mutex;
+    /// @var mq_pool_s::heap_allocs
+    /// @brief number of entries allocated from heap
+    uint64_t heap_allocs;
+}mq_pool_t;
+
 // struct xtqueue definition
 TAILQ_HEAD(mq_tqhead,xtq_entry);
 
@@ -165,6 +208,9 @@ struct mq_tqueue_s{
     /// @var mq_tqueue_s::free_fn
     /// @brief free function
 	mq_qfree_fn free_fn;
+    /// @var mq_tqueue_s::pool
+    /// @brief entry pool (NULL: entries use heap)
+	mq_pool_t *pool;
 };
 
 /// @struct xtq_entry
@@ -189,6 +235,9 @@ struct mq_cqueue_s{
     /// @var mq_cqueue_s::free_fn
     /// @brief free function
 	mq_qfree_fn free_fn;
+    /// @var mq_cqueue_s::pool
+    /// @brief entry pool (NULL: entries use heap)
+	mq_pool_t *pool;
 };
 
 /// @struct xcq_entry
@@ -314,7 +363,7 @@ struct xcq_entry {
 /// @return none
 #define mq_cqadd(parent,var)   do{ \
 xcq_entry_t *cqe=NULL; \
-cqe=(xcq_entry_t *)malloc(sizeof(xcq_entry_t)); \
+cqe=(xcq_entry_t *)mq_pool_get((parent)->pool,sizeof(xcq_entry_t)); \
 cqe->item = var; \
 mq_cqput(parent,cqe); \
 }while(0)
@@ -326,7 +375,7 @@ mq_cqput(parent,cqe); \
 /// @return none
 #define mq_cnqadd(qname,var)   do{ \
 xcq_entry_t *cqe=NULL; \
-cqe=(xcq_entry_t *)malloc(sizeof(xcq_entry_t)); \
+cqe=(xcq_entry_t *)mq_pool_get(NULL,sizeof(xcq_entry_t)); \
 cqe->item = var; \
 mq_cnqput(qname,cqe); \
 }while(0)
@@ -341,7 +390,7 @@ if(parent!=NULL){ \
 mq_cnqremove(parent->head,var); \
 if(parent->free_fn !=NULL) \
 parent->free_fn(var->item); \
-free(var); \
+mq_pool_put(parent->pool,var); \
 } \
 }while(0)
 
@@ -356,6 +405,7 @@ while (!mq_cnqempty(parent->head)) { \
 cqe = mq_cnqlast(parent->head); \
 mq_cnqdelete(parent,cqe); \
 } \
+mq_pool_destroy(&parent->pool); \
 free(parent); \
 } \
 }while(0)
@@ -486,7 +536,7 @@ free(parent); \
 /// @return none
 #define mq_tqadd(parent,var)   do{ \
 xtq_entry_t *tqe=NULL; \
-tqe=(xtq_entry_t *)malloc(sizeof(xtq_entry_t)); \
+tqe=(xtq_entry_t *)mq_pool_get((parent)->pool,sizeof(xtq_entry_t)); \
 tqe->item = var; \
 mq_tqappend(parent,tqe); \
 }while(0)
@@ -498,7 +548,7 @@ mq_tqappend(parent,tqe); \
 /// @return none
 #define mq_tnqadd(qname,var)   do{ \
 xtq_entry_t *tqe=NULL; \
-tqe=(xtq_entry_t *)malloc(sizeof(xtq_entry_t)); \
+tqe=(xtq_entry_t *)mq_pool_get(NULL,sizeof(xtq_entry_t)); \
 tqe->item = var; \
 mq_tnqappend(qname,tqe); \
 }while(0)
@@ -510,7 +560,7 @@ mq_tnqappend(qname,tqe); \
 /// @return none
 #define mq_tnqpush(qname,var)   do{ \
 xtq_entry_t *tqe=NULL; \
-tqe=(xtq_entry_t *)malloc(sizeof(xtq_entry_t)); \
+tqe=(xtq_entry_t *)mq_pool_get(NULL,sizeof(xtq_entry_t)); \
 tqe->item = var; \
 mq_tnqinshead(qname,tqe); \
 }while(0)
@@ -526,7 +576,7 @@ mq_tnqremove(parent->head,var); \
 if(parent->free_fn !=NULL){ \
 parent->free_fn(var->item); \
 } \
-free(var); \
+mq_pool_put(parent->pool,var); \
 } \
 }while(0)
 
@@ -541,6 +591,7 @@ if(parent!=NULL){ \
 		tqe = mq_tnqlast(parent->head,mq_tqhead); \
         mq_tnqdelete(parent,tqe); \
 	} \
+	mq_pool_destroy(&parent->pool); \
 	free(parent); \
 } \
 }while(0)
@@ -556,11 +607,26 @@ if(parent!=NULL){ \
 // Exports
 /////////////////////////
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+mq_pool_t *mq_pool_new(uint32_t node_size, uint32_t capacity, mq_pool_flags_t flags);
+void mq_pool_destroy(mq_pool_t **pself);
+void *mq_pool_get(mq_pool_t *self, uint32_t node_size);
+void mq_pool_put(mq_pool_t *self, void *node);
+
 mq_tqueue_t *mqtq_new();	
 mq_tqueue_t *mqtq_xnew();
+mq_tqueue_t *mqtq_pnew(uint32_t capacity, mq_pool_flags_t flags);
 #if !defined(__CYGWIN__)
 mq_cqueue_t *mqcq_new();
 mq_cqueue_t *mqcq_xnew();
+mq_cqueue_t *mqcq_pnew(uint32_t capacity, mq_pool_flags_t flags);
+#endif
+
+#ifdef __cplusplus
+}
 #endif
 
 #endif // MQ_QUEUE_H
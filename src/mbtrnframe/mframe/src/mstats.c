@@ -100,6 +100,11 @@
 /////////////////////////
 // Module Global Variables
 /////////////////////////
+
+/// @var uint64_t g_mstats_alloc_count
+/// @brief number of heap allocations reported using mstats_alloc_add
+static uint64_t g_mstats_alloc_count=0;
+
 bool g_mstat_test_quit=false;
 
 /////////////////////////
@@ -356,6 +361,204 @@ void mstats_profile_destroy(mstats_profile_t **pself)
 }
 // End function mstats_profile_destroy
 
+/// @fn void mstats_alloc_add(int64_t n)
+/// @brief add to process-wide heap allocation counter.
+/// Called by modules (e.g. mqueue) on the allocation path so
+/// applications may check for steady-state allocation,
+/// e.g. MST_COUNTER_SET(stats->status[ch],mstats_alloc_count())
+/// @param[in] n number of allocations
+/// @return none
+void mstats_alloc_add(int64_t n)
+{
+#if defined(__ATOMIC_RELAXED)
+    __atomic_fetch_add(&g_mstats_alloc_count,n,__ATOMIC_RELAXED);
+#else
+    __sync_fetch_and_add(&g_mstats_alloc_count,n);
+#endif
+}
+// End function mstats_alloc_add
+
+/// @fn uint64_t mstats_alloc_count()
+/// @brief return process-wide heap allocation counter.
+/// @return number of allocations reported using mstats_alloc_add
+uint64_t mstats_alloc_count()
+{
+#if defined(__ATOMIC_RELAXED)
+    return __atomic_load_n(&g_mstats_alloc_count,__ATOMIC_RELAXED);
+#else
+    return __sync_fetch_and_add(&g_mstats_alloc_count,0);
+#endif
+}
+// End function mstats_alloc_count
+
+/// @fn mstats_hist_t *mstats_hist_new(uint32_t nbins, double min, double max)
+/// @brief create new histogram with nbins logarithmically spaced
+/// bins between min and max. Caller must release using mstats_hist_destroy.
+/// @param[in] nbins number of bins
+/// @param[in] min lower edge of first bin (>0)
+/// @param[in] max upper edge of last bin (>min)
+/// @return mstats_hist_t on success, NULL otherwise
+mstats_hist_t *mstats_hist_new(uint32_t nbins, double min, double max)
+{
+    mstats_hist_t *self = NULL;
+    if (nbins>0 && min>0.0 && max>min) {
+        self = (mstats_hist_t *)malloc(sizeof(mstats_hist_t));
+        if (NULL != self) {
+            memset(self,0,sizeof(mstats_hist_t));
+            self->min    = min;
+            self->max    = max;
+            self->nbins  = nbins;
+            self->lscale = (double)nbins/log(max/min);
+            self->bins   = (uint64_t *)malloc(nbins*sizeof(uint64_t));
+            if (NULL != self->bins) {
+                mstats_hist_reset(self);
+            }else{
+                free(self);
+                self=NULL;
+            }
+        }
+    }else{
+        fprintf(stderr,"%s - invalid argument nbins[%u] min[%lf] max[%lf]\n",__FUNCTION__,nbins,min,max);
+    }
+    return self;
+}
+// End function mstats_hist_new
+
+/// @fn void mstats_hist_destroy(mstats_hist_t **pself)
+/// @brief release mstats_hist_t resources
+/// @param[in] pself pointer to instance reference
+/// @return none
+void mstats_hist_destroy(mstats_hist_t **pself)
+{
+    if (NULL!=pself) {
+        mstats_hist_t *self=(*pself);
+        if (NULL!=self) {
+            free(self->bins);
+            free(self);
+        }
+        *pself=NULL;
+    }
+}
+// End function mstats_hist_destroy
+
+/// @fn void mstats_hist_reset(mstats_hist_t *self)
+/// @brief clear histogram counts
+/// @param[in] self histogram reference
+/// @return none
+void mstats_hist_reset(mstats_hist_t *self)
+{
+    if (NULL!=self) {
+        memset(self->bins,0,self->nbins*sizeof(uint64_t));
+        self->under=0;
+        self->over=0;
+        memset(&self->stats,0,sizeof(mstats_metstats_t));
+        self->stats.min=DBL_MAX;
+        self->stats.max=-DBL_MAX;
+    }
+}
+// End function mstats_hist_reset
+
+/// @fn void mstats_hist_add(mstats_hist_t *self, double value)
+/// @brief add a value to histogram
+/// @param[in] self histogram reference
+/// @param[in] value value
+/// @return none
+void mstats_hist_add(mstats_hist_t *self, double value)
+{
+    if (NULL!=self) {
+        if (value<self->min) {
+            self->under++;
+        }else if (value>=self->max) {
+            self->over++;
+        }else{
+            uint32_t i = (uint32_t)(log(value/self->min)*self->lscale);
+            self->bins[(i<self->nbins ? i : self->nbins-1)]++;
+        }
+        self->stats.n++;
+        self->stats.sum += value;
+        if (value<self->stats.min) {
+            self->stats.min = value;
+        }
+        if (value>self->stats.max) {
+            self->stats.max = value;
+        }
+        self->stats.avg = self->stats.sum/(double)self->stats.n;
+    }
+}
+// End function mstats_hist_add
+
+/// @fn double mstats_hist_quantile(mstats_hist_t *self, double q)
+/// @brief estimate quantile (e.g. 0.99) from histogram.
+/// Returns the upper edge of the bin containing the quantile,
+/// or the recorded max if it falls in the overflow.
+/// @param[in] self histogram reference
+/// @param[in] q quantile (0.0-1.0)
+/// @return quantile estimate, 0.0 if histogram is empty
+double mstats_hist_quantile(mstats_hist_t *self, double q)
+{
+    double retval=0.0;
+    if (NULL!=self && self->stats.n>0) {
+        uint64_t target = (uint64_t)ceil(q*(double)self->stats.n);
+        uint64_t count = self->under;
+        if (target<1) {
+            target=1;
+        }
+        if (count>=target) {
+            retval = self->min;
+        }else{
+            uint32_t i=0;
+            retval = self->stats.max;
+            for (i=0;i<self->nbins;i++) {
+                count += self->bins[i];
+                if (count>=target) {
+                    retval = self->min*exp((double)(i+1)/self->lscale);
+                    break;
+                }
+            }
+        }
+    }
+    return retval;
+}
+// End function mstats_hist_quantile
+
+/// @fn void mstats_hist_show(mstats_hist_t *self, const char *label, bool verbose, uint16_t indent)
+/// @brief output histogram summary to stderr.
+/// @param[in] self histogram reference
+/// @param[in] label histogram label
+/// @param[in] verbose also output non-empty bins
+/// @param[in] indent output indentation spaces
+/// @return none
+void mstats_hist_show(mstats_hist_t *self, const char *label, bool verbose, uint16_t indent)
+{
+    if (NULL != self) {
+        fprintf(stderr,"%*s[%s]\n",indent,(indent>0?" ":""), (NULL!=label?label:"hist"));
+        fprintf(stderr,"%*s[n        %10"PRIu64"]\n",indent,(indent>0?" ":""), self->stats.n);
+        fprintf(stderr,"%*s[min      %10.3e]\n",indent,(indent>0?" ":""), (self->stats.n>0?self->stats.min:0.0));
+        fprintf(stderr,"%*s[avg      %10.3e]\n",indent,(indent>0?" ":""), self->stats.avg);
+        fprintf(stderr,"%*s[p50      %10.3e]\n",indent,(indent>0?" ":""), mstats_hist_quantile(self,0.50));
+        fprintf(stderr,"%*s[p99      %10.3e]\n",indent,(indent>0?" ":""), mstats_hist_quantile(self,0.99));
+        fprintf(stderr,"%*s[p999     %10.3e]\n",indent,(indent>0?" ":""), mstats_hist_quantile(self,0.999));
+        fprintf(stderr,"%*s[max      %10.3e]\n",indent,(indent>0?" ":""), (self->stats.n>0?self->stats.max:0.0));
+        if (verbose) {
+            uint32_t i=0;
+            if (self->under>0) {
+                fprintf(stderr,"%*s[<%9.3e %10"PRIu64"]\n",indent,(indent>0?" ":""), self->min, self->under);
+            }
+            for (i=0;i<self->nbins;i++) {
+                if (self->bins[i]>0) {
+                    fprintf(stderr,"%*s[ %9.3e %10"PRIu64"]\n",indent,(indent>0?" ":""),
+                            self->min*exp((double)i/self->lscale), self->bins[i]);
+                }
+            }
+            if (self->over>0) {
+                fprintf(stderr,"%*s[>%9.3e %10"PRIu64"]\n",indent,(indent>0?" ":""), self->max, self->over);
+            }
+        }
+    }
+}
+// End function mstats_hist_show
+
+
 #if defined(WITH_MSTATS_TEST)
 /// @typedef enum mstats_event_id mstats_event_id
 /// @brief diagnostic event IDs
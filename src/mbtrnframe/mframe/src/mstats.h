@@ -282,6 +282,36 @@ typedef struct mstats_s{
     const char ***labels;
 }mstats_t;
 
+/// @typedef struct mstats_hist_s mstats_hist_t
+/// @brief histogram of a positive quantity (e.g. latency) using
+/// logarithmically spaced bins between min and max
+typedef struct mstats_hist_s{
+    /// @var mstats_hist_s::min
+    /// @brief lower edge of first bin
+    double min;
+    /// @var mstats_hist_s::max
+    /// @brief upper edge of last bin
+    double max;
+    /// @var mstats_hist_s::lscale
+    /// @brief bins per unit of log(value/min)
+    double lscale;
+    /// @var mstats_hist_s::nbins
+    /// @brief number of bins
+    uint32_t nbins;
+    /// @var mstats_hist_s::bins
+    /// @brief bin counts
+    uint64_t *bins;
+    /// @var mstats_hist_s::under
+    /// @brief number of values < min
+    uint64_t under;
+    /// @var mstats_hist_s::over
+    /// @brief number of values >= max
+    uint64_t over;
+    /// @var mstats_hist_s::stats
+    /// @brief n, sum, min, max, avg of all values
+    mstats_metstats_t stats;
+}mstats_hist_t;
+
 /// @typedef struct mstats_profile_s mstats_profile_t
 /// @brief structure for (application) stats
 typedef struct mstats_profile_s{
@@ -311,6 +341,14 @@ extern "C" {
     double mstats_dtime();
     mstats_profile_t *mstats_profile_new(uint32_t ev_counters, uint32_t status_counters, uint32_t tm_channels, const char ***channel_labels, double pstart, double psec);
 void mstats_profile_destroy(mstats_profile_t **pself);
+    void mstats_alloc_add(int64_t n);
+    uint64_t mstats_alloc_count();
+    mstats_hist_t *mstats_hist_new(uint32_t nbins, double min, double max);
+    void mstats_hist_destroy(mstats_hist_t **pself);
+    void mstats_hist_reset(mstats_hist_t *self);
+    void mstats_hist_add(mstats_hist_t *self, double value);
+    double mstats_hist_quantile(mstats_hist_t *self, double q);
+    void mstats_hist_show(mstats_hist_t *self, const char *label, bool verbose, uint16_t indent);
 
 #if defined(WITH_MSTATS_TEST)
     int mstats_test();
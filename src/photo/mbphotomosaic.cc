@@ -34,6 +34,8 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <thread>
 
 /* MB-System include files */
@@ -84,6 +86,10 @@ using namespace cv;
 #define MBPM_FORMAT_TIFF              1
 #define MBPM_FORMAT_PNG               2
 
+/* Width and height in pixels of the output mosaic tiles that serialize
+   writes by the processing threads */
+#define MBPM_TILE_DIM                 256
+
 // #define DEBUG 1
 
 char program_name[] = "mbphotomosaic";
@@ -156,14 +162,6 @@ struct mbpm_process_struct {
     double camera_heading;
     double camera_roll;
     double camera_pitch;
-
-    // Output image and priority map
-    Mat OutputImage;
-    Mat OutputPriority;
-#ifdef DEBUG
-    Mat OutputIntensityCorrection;
-    Mat OutputStandoff;
-#endif
 };
 
 struct mbpm_control_struct {
@@ -175,6 +173,18 @@ struct mbpm_control_struct {
     double mtodeglon;
     double mtodeglat;
 
+    // Output image and priority map shared by all processing threads, with
+    // one mutex for each tile of MBPM_TILE_DIM x MBPM_TILE_DIM pixels
+    Mat OutputImage;
+    Mat OutputPriority;
+#ifdef DEBUG
+    Mat OutputIntensityCorrection;
+    Mat OutputStandoff;
+#endif
+    int OutputTileDim[2];
+    std::unique_ptr<std::mutex[]> OutputTileMutex;
+    bool OutputShared;          // true if more than one thread writes the mosaic
+
     // Projection
     bool use_projection;
     void *pjptr;
@@ -879,6 +889,14 @@ void load_correction(int verbose, mb_path ImageCorrectionFile, struct mbpm_contr
 
 }
 
+/*--------------------------------------------------------------------*/
+/* Return the mutex of the output mosaic tile containing pixel i,j, which
+   must be held while comparing priorities with and writing to that pixel */
+inline std::mutex &output_tile_mutex(struct mbpm_control_struct *control, int i, int j)
+{
+    return control->OutputTileMutex[(j / MBPM_TILE_DIM) * control->OutputTileDim[0] + i / MBPM_TILE_DIM];
+}
+
 /*--------------------------------------------------------------------*/
 void process_image(int verbose, struct mbpm_process_struct *process,
                   struct mbpm_control_struct *control, int *status, int *error)
@@ -1543,22 +1561,23 @@ void process_image(int verbose, struct mbpm_process_struct *process,
                                 pixel_priority_use = 0.99 * pixel_priority;
                             else
                                 pixel_priority_use = 0.98 * pixel_priority;
-                            if (pixel_priority_use > process->OutputPriority.at<float>(jpix,ipix)) {
-                                process->OutputImage.at<Vec3b>(jpix,ipix)[0] = b;
-                                process->OutputImage.at<Vec3b>(jpix,ipix)[1] = g;
-                                process->OutputImage.at<Vec3b>(jpix,ipix)[2] = r;
-                                process->OutputPriority.at<float>(jpix,ipix) = pixel_priority_use;
+                            std::lock_guard<std::mutex> tileLock(output_tile_mutex(control, ipix, jpix));
+                            if (pixel_priority_use > control->OutputPriority.at<float>(jpix,ipix)) {
+                                control->OutputImage.at<Vec3b>(jpix,ipix)[0] = b;
+                                control->OutputImage.at<Vec3b>(jpix,ipix)[1] = g;
+                                control->OutputImage.at<Vec3b>(jpix,ipix)[2] = r;
+                                control->OutputPriority.at<float>(jpix,ipix) = pixel_priority_use;
 #ifdef DEBUG
-                                process->OutputIntensityCorrection.at<float>(jpix,ipix) = intensityCorrection;
-                                process->OutputStandoff.at<float>(jpix,ipix) = standoff;
+                                control->OutputIntensityCorrection.at<float>(jpix,ipix) = intensityCorrection;
+                                control->OutputStandoff.at<float>(jpix,ipix) = standoff;
 #endif
 //if (debugprint == MB_YES) {
 //fprintf(stream,"              Pixel used: i:%d j:%d  ipix:%d jpix:%d  BGR:%d %d %d Priority:%f %f\n",
 //i,j,ipix,jpix,
-//process->OutputImage.at<Vec3b>(jpix,ipix)[0],
-//process->OutputImage.at<Vec3b>(jpix,ipix)[1],
-//process->OutputImage.at<Vec3b>(jpix,ipix)[2],
-//pixel_priority_use, process->OutputPriority.at<float>(jpix,ipix));
+//control->OutputImage.at<Vec3b>(jpix,ipix)[0],
+//control->OutputImage.at<Vec3b>(jpix,ipix)[1],
+//control->OutputImage.at<Vec3b>(jpix,ipix)[2],
+//pixel_priority_use, control->OutputPriority.at<float>(jpix,ipix));
 //}
                             }
                         }
@@ -1920,9 +1939,13 @@ void process_image_sectioned(int verbose, struct mbpm_process_struct *process,
                                 }
 
                                 if (dstCornerPixels[icorner].x < 0 || dstCornerPixels[icorner].x >= control->OutputDim[0]
-                                    || dstCornerPixels[icorner].y < 0 || dstCornerPixels[icorner].y >= control->OutputDim[1]
-                                    || section_priority <= process->OutputPriority.at<float>(dstCornerPixels[icorner].y,dstCornerPixels[icorner].x))
+                                    || dstCornerPixels[icorner].y < 0 || dstCornerPixels[icorner].y >= control->OutputDim[1])
                                     use_section = false;
+                                else {
+                                    std::lock_guard<std::mutex> tileLock(output_tile_mutex(control, dstCornerPixels[icorner].x, dstCornerPixels[icorner].y));
+                                    if (section_priority <= control->OutputPriority.at<float>(dstCornerPixels[icorner].y,dstCornerPixels[icorner].x))
+                                        use_section = false;
+                                }
                             }
                         }
                     }
@@ -2279,10 +2302,20 @@ void process_image_sectioned(int verbose, struct mbpm_process_struct *process,
                                     r = saturate_cast<unsigned char>(Y + 1.403 * (Cr - 128));
                                 }
 
-                                process->OutputImage.at<Vec3b>(dj,di)[0] = b;
-                                process->OutputImage.at<Vec3b>(dj,di)[1] = g;
-                                process->OutputImage.at<Vec3b>(dj,di)[2] = r;
-                                process->OutputPriority.at<float>(dj,di) = section_priority;
+                                /* a section that passed the corner check is
+                                    written whole, but with several threads
+                                    another thread may have written a higher
+                                    priority pixel here since the check, and
+                                    that pixel is kept as the old merge of the
+                                    per-thread mosaics kept it */
+                                std::lock_guard<std::mutex> tileLock(output_tile_mutex(control, di, dj));
+                                if (!control->OutputShared
+                                    || section_priority >= control->OutputPriority.at<float>(dj,di)) {
+                                    control->OutputImage.at<Vec3b>(dj,di)[0] = b;
+                                    control->OutputImage.at<Vec3b>(dj,di)[1] = g;
+                                    control->OutputImage.at<Vec3b>(dj,di)[2] = r;
+                                    control->OutputPriority.at<float>(dj,di) = section_priority;
+                                }
                             }
                         }
                     }
@@ -2323,6 +2356,7 @@ int main(int argc, char** argv)
     mb_path   OutputImageFile;
     bool      outputimage_specified = false;
     int       output_format = MBPM_FORMAT_NONE;
+    control.OutputShared = false;
     control.priority_mode = MBPM_PRIORITY_CENTRALITY_ONLY;
     control.priority_weight = 1.0;
     control.standoff_target = 3.0;
@@ -3451,22 +3485,25 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
         fprintf(stream,"  control.OutputDim[1]: ydim:          %d\n",control.OutputDim[1]);
         }
 
-    /* If output file specified then create an an output image and priority map
-        in the processing structure for each processing thread. The images will
-        be combined after all processing is complete. */
+    /* If output file specified then create the output image and priority map
+        shared by all of the processing threads. The threads write directly
+        into the output image, holding the mutex of each tile they write to,
+        so memory use does not depend on the number of threads. */
     if (outputimage_specified) {
-        for (int ithread = 0; ithread < numThreads; ithread++) {
-            processPars[ithread].OutputImage.create(control.OutputDim[1], control.OutputDim[0], CV_8UC3);
-            processPars[ithread].OutputImage = Scalar::all(0);
-            processPars[ithread].OutputPriority.create(control.OutputDim[1], control.OutputDim[0], CV_32FC1);
-            processPars[ithread].OutputPriority = Scalar::all(0);
+        control.OutputImage.create(control.OutputDim[1], control.OutputDim[0], CV_8UC3);
+        control.OutputImage = Scalar::all(0);
+        control.OutputPriority.create(control.OutputDim[1], control.OutputDim[0], CV_32FC1);
+        control.OutputPriority = Scalar::all(0);
 #ifdef DEBUG
-            processPars[ithread].OutputIntensityCorrection.create(control.OutputDim[1], control.OutputDim[0], CV_32FC1);
-            processPars[ithread].OutputIntensityCorrection = Scalar::all(0);
-            processPars[ithread].OutputStandoff.create(control.OutputDim[1], control.OutputDim[0], CV_32FC1);
-            processPars[ithread].OutputStandoff = Scalar::all(0);
+        control.OutputIntensityCorrection.create(control.OutputDim[1], control.OutputDim[0], CV_32FC1);
+        control.OutputIntensityCorrection = Scalar::all(0);
+        control.OutputStandoff.create(control.OutputDim[1], control.OutputDim[0], CV_32FC1);
+        control.OutputStandoff = Scalar::all(0);
 #endif
-        }
+        control.OutputTileDim[0] = (control.OutputDim[0] + MBPM_TILE_DIM - 1) / MBPM_TILE_DIM;
+        control.OutputTileDim[1] = (control.OutputDim[1] + MBPM_TILE_DIM - 1) / MBPM_TILE_DIM;
+        control.OutputTileMutex.reset(new std::mutex[control.OutputTileDim[0] * control.OutputTileDim[1]]);
+        control.OutputShared = (numThreads > 1);
     }
 
     /* loop over the list of input images
@@ -4290,48 +4327,19 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
     /* close imagelist file */
     status = mb_imagelist_close(verbose, &imagelist_ptr, &error);
 
-    /* if more than one thread was used, combine the images into the image from
-        the first thread */
-    if (numThreads > 1) {
-        fprintf(stream, "\n");
-        for (int ithread = 1; ithread < numThreads; ithread++) {
-            fprintf(stream, "Merging mosaic from thread %d of %d\n", ithread, numThreads);
-            for (int i = 0; i < control.OutputDim[0]; i++) {
-                for (int j = 0; j < control.OutputDim[1]; j++) {
-                    if (processPars[ithread].OutputPriority.at<float>(j,i) > processPars[0].OutputPriority.at<float>(j,i)) {
-                        processPars[0].OutputImage.at<Vec3b>(j,i)[0] = processPars[ithread].OutputImage.at<Vec3b>(j,i)[0];
-                        processPars[0].OutputImage.at<Vec3b>(j,i)[1] = processPars[ithread].OutputImage.at<Vec3b>(j,i)[1];
-                        processPars[0].OutputImage.at<Vec3b>(j,i)[2] = processPars[ithread].OutputImage.at<Vec3b>(j,i)[2];
-                        processPars[0].OutputPriority.at<float>(j,i) = processPars[ithread].OutputPriority.at<float>(j,i);
-#ifdef DEBUG
-                        processPars[0].OutputIntensityCorrection.at<float>(j,i) = processPars[ithread].OutputIntensityCorrection.at<float>(j,i);
-                        processPars[0].OutputStandoff.at<float>(j,i) = processPars[ithread].OutputStandoff.at<float>(j,i);
-#endif
-                    }
-                }
-            }
-            processPars[ithread].OutputImage.release();
-            processPars[ithread].OutputPriority.release();
-#ifdef DEBUG
-            processPars[ithread].OutputIntensityCorrection.release();
-            processPars[ithread].OutputStandoff.release();
-#endif
-        }
-    }
-
     /* Write out the ouput image */
     if (outputimage_specified) {
         /* for tiff format just write out the existing image */
         if (output_format == MBPM_FORMAT_TIFF) {
-            status = imwrite(OutputImageFile, processPars[0].OutputImage);
-            processPars[0].OutputImage.release();
+            status = imwrite(OutputImageFile, control.OutputImage);
+            control.OutputImage.release();
         }
 
         /* for png format first add alpha channel and set black pixels to have
             alpha=0 to make those pixels transparent */
         else if (output_format == MBPM_FORMAT_PNG) {
             Mat OutputImageBGRA;
-            cvtColor(processPars[0].OutputImage, OutputImageBGRA, COLOR_BGR2BGRA);
+            cvtColor(control.OutputImage, OutputImageBGRA, COLOR_BGR2BGRA);
             for (int j = 0; j < OutputImageBGRA.rows; ++j) {
                 for (int i = 0; i < OutputImageBGRA.cols; ++i)
                 {
@@ -4344,7 +4352,7 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
                 }
             }
             status = imwrite(OutputImageFile, OutputImageBGRA);
-            processPars[0].OutputImage.release();
+            control.OutputImage.release();
             OutputImageBGRA.release();
         }
 
@@ -4400,7 +4408,7 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
             double xmax = control.OutputBounds[1];
             double ymin = control.OutputBounds[2];
             double ymax = control.OutputBounds[3];
-            double zmin = processPars[0].OutputPriority.at<float>(0,0);
+            double zmin = control.OutputPriority.at<float>(0,0);
             double zmax = zmin;
             double dx = control.OutputDx[0];
             double dy = control.OutputDx[1];
@@ -4418,7 +4426,7 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
             for (int i = 0; i < xdim; i++) {
                 for (int j = 0; j < ydim; j++) {
                     int k = i * ydim + (ydim - 1 - j);
-                    grid[k] = processPars[0].OutputPriority.at<float>(j,i);
+                    grid[k] = control.OutputPriority.at<float>(j,i);
                     zmin = MIN(zmin, grid[k]);
                     zmax = MAX(zmax, grid[k]);
                 }
@@ -4437,7 +4445,7 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
             for (int i = 0; i < xdim; i++) {
                 for (int j = 0; j < ydim; j++) {
                     int k = i * ydim + (ydim - 1 - j);
-                    grid[k] = processPars[0].OutputIntensityCorrection.at<float>(j,i);
+                    grid[k] = control.OutputIntensityCorrection.at<float>(j,i);
                     zmin = MIN(zmin, grid[k]);
                     zmax = MAX(zmax, grid[k]);
                 }
@@ -4456,7 +4464,7 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
             for (int i = 0; i < xdim; i++) {
                 for (int j = 0; j < ydim; j++) {
                     int k = i * ydim + (ydim - 1 - j);
-                    grid[k] = processPars[0].OutputStandoff.at<float>(j,i);
+                    grid[k] = control.OutputStandoff.at<float>(j,i);
                     zmin = MIN(zmin, grid[k]);
                     zmax = MAX(zmax, grid[k]);
                 }
@@ -4478,11 +4486,12 @@ control.OutputBounds[0], control.OutputBounds[1], control.OutputBounds[2], contr
             fprintf(stream, "Could not save: %s\n",OutputImageFile);
         }
 
-        processPars[0].OutputPriority.release();
+        control.OutputPriority.release();
 #ifdef DEBUG
-        processPars[0].OutputIntensityCorrection.release();
-        processPars[0].OutputStandoff.release();
+        control.OutputIntensityCorrection.release();
+        control.OutputStandoff.release();
 #endif
+        control.OutputTileMutex.reset();
     }
 
     /* release correction tables */
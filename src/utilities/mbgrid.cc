@@ -36,6 +36,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -43,7 +44,10 @@
 #include <ctime>
 #include <getopt.h>
 #include <limits>
+#include <mutex>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include "mb_aux.h"
 #include "mb_define.h"
@@ -86,9 +90,6 @@ typedef enum {
 /* flag for no data in grid */;
 constexpr int NO_DATA_FLAG = 99999;
 
-/* number of data to be allocated at a time */
-constexpr int REALLOC_STEP_SIZE = 25;
-
 /* usage of footprint based weight */
 typedef enum {
     MBGRID_USE_NO = 0,
@@ -119,7 +120,11 @@ constexpr double FOOT_THETA_MAX = 85.0;
     from GMT. If not, then the zgrid
     algorithm will be used.
     - The default is to use zgrid - to
-    change this uncomment the define below. */
+    change this uncomment the define below.
+    Only the surface algorithm uses --threads, fitting
+    the grid in overlapping tiles in parallel; the tiled
+    result differs slightly from a single global fit.
+    zgrid always runs serially. */
 /* #define USESURFACE */
 
 /* output stream for basic stuff (stdout if verbose <= 1,
@@ -140,7 +145,8 @@ constexpr char usage_message[] =
     "mbgrid   -Ifilelist -Oroot [-Adatatype -Bborder -Cclip[/mode] -Dxdim/ydim\n"
     "          -Edx/dy/units[!]  -Fmode[/threshold] -Ggridkind -Jprojection\n"
     "          -Kbackground -Llonflip -M -N -Ppings -Q  -Rwest/east/south/north\n"
-    "          -Rfactor  -Sspeed  -Ttension  -Utime  -V -Wscale -Xextend]";
+    "          -Rfactor  -Sspeed  -Ttension  -Utime  -V -Wscale -Xextend\n"
+    "          --threads=n_threads --median-memory=megabytes]";
 
 /*--------------------------------------------------------------------*/
 /* approximate error function altered from numerical recipes */
@@ -421,9 +427,341 @@ int mbgrid_weight(int verbose, double foot_a, double foot_b, double pcx, double
 
 /*--------------------------------------------------------------------*/
 
-int main(int argc, char **argv) {
-  int verbose = 0;
+/*--------------------------------------------------------------------*/
+/*
+ * Median filter gridding: soundings are accumulated as (cell, epoch, value)
+ * records in a fixed size buffer. When the buffer fills it is sorted by cell
+ * and written to a temporary run file, so memory use is bounded by the buffer
+ * size rather than by the sounding density. Once all data are read the cell
+ * sorted runs are merged and the median (or other percentile) of each cell
+ * is found by selection with std::nth_element rather than a full sort. The
+ * epoch of a cell is incremented when the -U time check discards the data
+ * already gridded in that cell, and only records from the final epoch of
+ * each cell are used.
+ */
+
+/* default memory used for median filter sounding records in MB */
+constexpr int MBGRID_MEDIAN_MEMORY_DEFAULT = 512;
+
+/* minimum number of records read at a time from each run file */
+constexpr size_t MBGRID_MEDIAN_READ_MIN = 1024;
+
+struct mbgrid_median_record_struct {
+  int kgrid;
+  int epoch;
+  double value;
+};
+
+/* cell sorted run of records, on disk if fp is not null */
+struct mbgrid_median_run_struct {
+  FILE *fp;
+  size_t nrecord;
+  struct mbgrid_median_record_struct *buffer;
+  size_t nbuffer;
+  size_t ibuffer;
+};
+
+struct mbgrid_median_struct {
+  size_t nrecord_alloc;
+  size_t nrecord;
+  struct mbgrid_median_record_struct *records;
+  std::vector<struct mbgrid_median_run_struct> runs;
+};
+
+/*--------------------------------------------------------------------*/
+int mbgrid_median_init(int verbose, size_t memory, struct mbgrid_median_struct *median, int *error) {
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  Function <%s> called\n", __func__);
+    fprintf(outfp, "dbg2  Input arguments:\n");
+    fprintf(outfp, "dbg2       verbose:    %d\n", verbose);
+    fprintf(outfp, "dbg2       memory:     %zu\n", memory);
+    fprintf(outfp, "dbg2       median:     %p\n", (void *)median);
+  }
+
+  median->nrecord_alloc = std::max(memory / sizeof(struct mbgrid_median_record_struct), MBGRID_MEDIAN_READ_MIN);
+  median->nrecord = 0;
+  median->records = nullptr;
+  median->runs.clear();
+  const int status = mb_mallocd(verbose, __FILE__, __LINE__,
+                                median->nrecord_alloc * sizeof(struct mbgrid_median_record_struct),
+                                (void **)&median->records, error);
+
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(outfp, "dbg2  Return values:\n");
+    fprintf(outfp, "dbg2       nrecord_alloc: %zu\n", median->nrecord_alloc);
+    fprintf(outfp, "dbg2       error:      %d\n", *error);
+    fprintf(outfp, "dbg2  Return status:\n");
+    fprintf(outfp, "dbg2       status:     %d\n", status);
+  }
+
+  return (status);
+}
+
+/*--------------------------------------------------------------------*/
+/* sort the buffered records by cell and write them to a temporary run file */
+int mbgrid_median_spill(int verbose, struct mbgrid_median_struct *median, int *error) {
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  Function <%s> called\n", __func__);
+    fprintf(outfp, "dbg2  Input arguments:\n");
+    fprintf(outfp, "dbg2       verbose:    %d\n", verbose);
+    fprintf(outfp, "dbg2       median:     %p\n", (void *)median);
+    fprintf(outfp, "dbg2       nrecord:    %zu\n", median->nrecord);
+    fprintf(outfp, "dbg2       nrun:       %zu\n", median->runs.size());
+  }
+
+  int status = MB_SUCCESS;
+
+  if (median->nrecord > 0) {
+    std::sort(median->records, median->records + median->nrecord,
+              [](const mbgrid_median_record_struct &a, const mbgrid_median_record_struct &b) {
+                return a.kgrid < b.kgrid;
+              });
+    struct mbgrid_median_run_struct run;
+    run.fp = tmpfile();
+    run.nrecord = median->nrecord;
+    run.buffer = nullptr;
+    run.nbuffer = 0;
+    run.ibuffer = 0;
+    if (run.fp == nullptr
+        || fwrite(median->records, sizeof(struct mbgrid_median_record_struct), median->nrecord, run.fp)
+            != median->nrecord
+        || fflush(run.fp) != 0) {
+      if (run.fp != nullptr)
+        fclose(run.fp);
+      *error = MB_ERROR_WRITE_FAIL;
+      status = MB_FAILURE;
+    }
+    else {
+      rewind(run.fp);
+      median->runs.push_back(run);
+      median->nrecord = 0;
+    }
+  }
+
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(outfp, "dbg2  Return values:\n");
+    fprintf(outfp, "dbg2       nrun:       %zu\n", median->runs.size());
+    fprintf(outfp, "dbg2       error:      %d\n", *error);
+    fprintf(outfp, "dbg2  Return status:\n");
+    fprintf(outfp, "dbg2       status:     %d\n", status);
+  }
+
+  return (status);
+}
+
+/*--------------------------------------------------------------------*/
+/* add a sounding value to cell kgrid */
+inline int mbgrid_median_add(int verbose, struct mbgrid_median_struct *median, int kgrid, int epoch, double value,
+                             int *error) {
+  if (median->nrecord >= median->nrecord_alloc
+      && mbgrid_median_spill(verbose, median, error) != MB_SUCCESS)
+    return (MB_FAILURE);
+  struct mbgrid_median_record_struct *record = &median->records[median->nrecord++];
+  record->kgrid = kgrid;
+  record->epoch = epoch;
+  record->value = value;
+  return (MB_SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+/* refill the read buffer of a run, returning false when it is exhausted;
+   a run file that ends before all of its records are read sets *error */
+bool mbgrid_median_run_next(struct mbgrid_median_run_struct *run, size_t nread_max, int *error) {
+  if (run->ibuffer < run->nbuffer)
+    return (true);
+  if (run->fp == nullptr || run->nrecord == 0)
+    return (false);
+  const size_t nread = std::min(run->nrecord, nread_max);
+  run->nbuffer = fread(run->buffer, sizeof(struct mbgrid_median_record_struct), nread, run->fp);
+  run->ibuffer = 0;
+  if (run->nbuffer != nread) {
+    fprintf(outfp, "\nUnable to read median filter run file: read %zu of %zu records\n", run->nbuffer, nread);
+    run->nbuffer = 0;
+    run->nrecord = 0;
+    *error = MB_ERROR_EOF;
+    return (false);
+  }
+  run->nrecord -= nread;
+  return (true);
+}
+
+/*--------------------------------------------------------------------*/
+/* merge the cell sorted runs and calculate the percentile value and the
+   deviation about it for every cell of the grid */
+int mbgrid_median_grid(int verbose, struct mbgrid_median_struct *median, double percentile, int gxdim, int gydim,
+                       const int *epoch, double clipvalue, double *grid, double *sigma, int *cnt, int *nbinset,
+                       int *error) {
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  Function <%s> called\n", __func__);
+    fprintf(outfp, "dbg2  Input arguments:\n");
+    fprintf(outfp, "dbg2       verbose:    %d\n", verbose);
+    fprintf(outfp, "dbg2       median:     %p\n", (void *)median);
+    fprintf(outfp, "dbg2       percentile: %f\n", percentile);
+    fprintf(outfp, "dbg2       gxdim:      %d\n", gxdim);
+    fprintf(outfp, "dbg2       gydim:      %d\n", gydim);
+    fprintf(outfp, "dbg2       clipvalue:  %f\n", clipvalue);
+  }
+
+  int status = MB_SUCCESS;
+  *error = MB_ERROR_NO_ERROR;
+
+  /* if everything fit in memory sort the buffer in place, otherwise spill
+     the remainder and split the buffer between the runs for reading */
+  size_t nread_max = 0;
+  if (median->runs.empty()) {
+    std::sort(median->records, median->records + median->nrecord,
+              [](const mbgrid_median_record_struct &a, const mbgrid_median_record_struct &b) {
+                return a.kgrid < b.kgrid;
+              });
+    struct mbgrid_median_run_struct run;
+    run.fp = nullptr;
+    run.nrecord = 0;
+    run.buffer = median->records;
+    run.nbuffer = median->nrecord;
+    run.ibuffer = 0;
+    median->runs.push_back(run);
+  }
+  else {
+    status = mbgrid_median_spill(verbose, median, error);
+    nread_max = std::max(median->nrecord_alloc / median->runs.size(), MBGRID_MEDIAN_READ_MIN);
+    for (size_t irun = 0; irun < median->runs.size() && status == MB_SUCCESS; irun++) {
+      struct mbgrid_median_run_struct *run = &median->runs[irun];
+      if (nread_max * (irun + 1) <= median->nrecord_alloc)
+        run->buffer = &median->records[nread_max * irun];
+      else
+        status = mb_mallocd(verbose, __FILE__, __LINE__, nread_max * sizeof(struct mbgrid_median_record_struct),
+                            (void **)&run->buffer, error);
+    }
+  }
+
+  /* merge the runs one cell at a time */
+  const size_t nrun = median->runs.size();
+  std::vector<double> values;
+  *nbinset = 0;
+  for (int kgrid = 0; kgrid < gxdim * gydim && status == MB_SUCCESS; kgrid++) {
+    values.clear();
+    for (size_t irun = 0; irun < nrun; irun++) {
+      struct mbgrid_median_run_struct *run = &median->runs[irun];
+      while (mbgrid_median_run_next(run, nread_max, error) && run->buffer[run->ibuffer].kgrid == kgrid) {
+        if (run->buffer[run->ibuffer].epoch == epoch[kgrid])
+          values.push_back(run->buffer[run->ibuffer].value);
+        run->ibuffer++;
+      }
+      if (*error != MB_ERROR_NO_ERROR) {
+        status = MB_FAILURE;
+        break;
+      }
+    }
+    if (status != MB_SUCCESS)
+      break;
+
+    cnt[kgrid] = values.size();
+    if (cnt[kgrid] > 0) {
+      const size_t rank = std::min((size_t)(0.01 * percentile * cnt[kgrid]), values.size() - 1);
+      std::nth_element(values.begin(), values.begin() + rank, values.end());
+      grid[kgrid] = values[rank];
+      sigma[kgrid] = 0.0;
+      for (const double value : values)
+        sigma[kgrid] += (value - grid[kgrid]) * (value - grid[kgrid]);
+      if (cnt[kgrid] > 1)
+        sigma[kgrid] = sqrt(sigma[kgrid] / (cnt[kgrid] - 1));
+      else
+        sigma[kgrid] = 0.0;
+      (*nbinset)++;
+    }
+    else
+      grid[kgrid] = clipvalue;
+  }
+
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(outfp, "dbg2  Return values:\n");
+    fprintf(outfp, "dbg2       nrun:       %zu\n", nrun);
+    fprintf(outfp, "dbg2       nbinset:    %d\n", *nbinset);
+    fprintf(outfp, "dbg2       error:      %d\n", *error);
+    fprintf(outfp, "dbg2  Return status:\n");
+    fprintf(outfp, "dbg2       status:     %d\n", status);
+  }
+
+  return (status);
+}
+
+/*--------------------------------------------------------------------*/
+/* close any run files and release the record buffers */
+int mbgrid_median_free(int verbose, struct mbgrid_median_struct *median, int *error) {
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  Function <%s> called\n", __func__);
+    fprintf(outfp, "dbg2  Input arguments:\n");
+    fprintf(outfp, "dbg2       verbose:    %d\n", verbose);
+    fprintf(outfp, "dbg2       median:     %p\n", (void *)median);
+  }
+
+  for (struct mbgrid_median_run_struct &run : median->runs) {
+    if (run.fp != nullptr)
+      fclose(run.fp);
+    if (run.buffer != nullptr && (run.buffer < median->records || run.buffer >= median->records + median->nrecord_alloc))
+      mb_freed(verbose, __FILE__, __LINE__, (void **)&run.buffer, error);
+  }
+  median->runs.clear();
+  const int status = mb_freed(verbose, __FILE__, __LINE__, (void **)&median->records, error);
+  median->nrecord = 0;
+  median->nrecord_alloc = 0;
+
+  if (verbose >= 2) {
+    fprintf(outfp, "\ndbg2  MBIO function <%s> completed\n", __func__);
+    fprintf(outfp, "dbg2  Return values:\n");
+    fprintf(outfp, "dbg2       error:      %d\n", *error);
+    fprintf(outfp, "dbg2  Return status:\n");
+    fprintf(outfp, "dbg2       status:     %d\n", status);
+  }
+
+  return (status);
+}
+
+/*--------------------------------------------------------------------*/
+/*
+ * Parallel gridding: with --threads=n the swath files in the datalist are
+ * read concurrently by n worker threads. Each thread accumulates into its
+ * own grid tiles, allocated only where its files have data, and once all
+ * files have been read the tiles are reduced into the full working grid
+ * (summed for the weighted means, min/maxed for the filters). This is
+ * supported for the Gaussian weighted mean, footprint weighted mean,
+ * minimum filter and maximum filter algorithms without the -U overlap
+ * time check, which depends on the order in which files are read.
+ */
+
+/* tile dimension in grid cells */
+constexpr int MBGRID_TILE_DIM = 128;
+constexpr int MBGRID_TILE_SIZE = MBGRID_TILE_DIM * MBGRID_TILE_DIM;
+
+struct mbgrid_tile_struct {
+  double norm[MBGRID_TILE_SIZE];
+  double grid[MBGRID_TILE_SIZE];
+  double sigma[MBGRID_TILE_SIZE];
+  int num[MBGRID_TILE_SIZE];
+  int cnt[MBGRID_TILE_SIZE];
+};
+
+/* swath file read from the datalist */
+struct mbgrid_file_struct {
+  mb_path path;
+  mb_path file;
   int format;
+  int pstatus;
+  double file_weight;
+  int ndatafile;
+  double dmin;
+  double dmax;
+  bool file_in_bounds;
+};
+
+/* parameters shared by all gridding threads */
+struct mbgrid_control_struct {
+  int verbose;
+  grid_data_t datatype;
+  grid_alg_t grid_mode;
   int pings;
   int lonflip;
   double bounds[4];
@@ -431,391 +769,306 @@ int main(int argc, char **argv) {
   int etime_i[7];
   double speedmin;
   double timegap;
-  int status = mb_defaults(verbose, &format, &pings, &lonflip, bounds, btime_i, etime_i, &speedmin, &timegap);
+  bool use_projection;
+  mb_path projection_id;
+  double wbnd[4];
+  double dx;
+  double dy;
+  int gxdim;
+  int gydim;
+  int xtradim;
+  double factor;
+  double topofactor;
+  double scale;
+  double mtodeglon;
+  double mtodeglat;
+
+  /* time overlap check (-U), which depends on the order the data are
+     read and so is only done with a single thread */
+  bool check_time;
+  bool first_in_stays;
+  double timediff;
+  double *firsttime;
+
+  /* files to be gridded, handed out in datalist order */
+  int nfile;
+  struct mbgrid_file_struct *files;
+  std::atomic<int> next_file;
+  std::mutex output_mutex;
+};
+
+/* thread local accumulation */
+struct mbgrid_thread_struct {
+  int ntilex;
+  int ntiley;
+  struct mbgrid_tile_struct **tiles;
+  void *pjptr;
+  int ndata;
+};
 
-  grid_data_t datatype = MBGRID_DATA_BATHYMETRY;
-  double border = 0.0;
-  bool setborder = false;
-  char gridkindstring[MB_PATH_MAXLINE] = "";
-  int clip = 0;
-  int xdim = 101;
-  int ydim = 101;
-  char fileroot[MB_PATH_MAXLINE] = "grid";
-  char projection_id[MB_PATH_MAXLINE] = "Geographic";
-  double gbnd[4] = {0.0, 0.0, 0.0, 0.0};
-  bool gbndset = false;
-  double scale = 1.0;
-  double extend = 0.0;
-  double shift_x = 0.0;
-  double shift_y = 0.0;
-  bool shift = false;
-  bool first_in_stays = true;
-  bool check_time = false;
-  double timediff = 300.0;
-#ifdef USESURFACE
-  double tension = 0.35;
-#else
-  double tension = 0.0;
-#endif
+/*--------------------------------------------------------------------*/
+/* get the thread local tile containing grid cell (ix, iy), allocating it
+   if necessary, and the index of the cell within the tile */
+inline struct mbgrid_tile_struct *mbgrid_tile(struct mbgrid_thread_struct *thread, int ix, int iy, int *k) {
+  const int itile = (ix / MBGRID_TILE_DIM) * thread->ntiley + iy / MBGRID_TILE_DIM;
+  if (thread->tiles[itile] == nullptr)
+    thread->tiles[itile] = new mbgrid_tile_struct();
+  *k = (ix % MBGRID_TILE_DIM) * MBGRID_TILE_DIM + iy % MBGRID_TILE_DIM;
+  return thread->tiles[itile];
+}
 
-  double boundsfactor = 0.0;
-  bool bathy_in_feet = false;
-  bool more = false;
-  bool use_NaN = false;
-  int grdrasterid = 0;
-  char projection_pars[MB_PATH_MAXLINE] = "";
-  bool projection_pars_f = false;
-  char filelist[MB_PATH_MAXLINE] = "datalist.mb-1";
-  char backgroundfile[MB_PATH_MAXLINE] = "";
-  grid_type_t gridkind = MBGRID_GMTGRD;
-  double minormax_weighted_mean_threshold = 1.0;
-  grid_alg_t grid_mode = MBGRID_WEIGHTED_MEAN;
-  bool set_spacing = false;
-  char units[MB_PATH_MAXLINE] = "";
-  double dx_set = 0.0;
-  double dy_set = 0.0;
-  bool spacing_priority = false;
-  bool set_dimensions = false;
-  grid_interp_t clipmode = MBGRID_INTERP_NONE;
+/*--------------------------------------------------------------------*/
+/* add a value with the Gaussian weighted mean algorithm - values within
+   xtradim bins outside the grid are used if edge is nonzero */
+bool mbgrid_thread_weighted_mean(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread,
+                                 double file_weight, double x, double y, double value, int edge) {
+  const int ix = (x - control->wbnd[0] + 0.5 * control->dx) / control->dx;
+  const int iy = (y - control->wbnd[2] + 0.5 * control->dy) / control->dy;
+  if (ix < -edge || ix >= control->gxdim + edge || iy < -edge || iy >= control->gydim + edge)
+    return (false);
+  const int ix1 = std::max(ix - control->xtradim, 0);
+  const int ix2 = std::min(ix + control->xtradim, control->gxdim - 1);
+  const int iy1 = std::max(iy - control->xtradim, 0);
+  const int iy2 = std::min(iy + control->xtradim, control->gydim - 1);
+  for (int ii = ix1; ii <= ix2; ii++)
+    for (int jj = iy1; jj <= iy2; jj++) {
+      int k;
+      struct mbgrid_tile_struct *tile = mbgrid_tile(thread, ii, jj, &k);
+      const double xx = control->wbnd[0] + ii * control->dx - x;
+      const double yy = control->wbnd[2] + jj * control->dy - y;
+      const double weight = file_weight * exp(-(xx * xx + yy * yy) * control->factor);
+      tile->norm[k] += weight;
+      tile->grid[k] += weight * value;
+      tile->sigma[k] += weight * value * value;
+      tile->num[k]++;
+      if (ii == ix && jj == iy)
+        tile->cnt[k]++;
+    }
+  thread->ndata++;
+  return (true);
+}
 
-  {
-    bool errflg = false;
-    int c;
-    bool help = false;
-    while ((c = getopt(argc, argv, "A:a:B:b:C:c:D:d:E:e:F:f:G:g:HhI:i:J:j:K:k:L:l:MmNnO:o:P:p:QqR:r:S:s:T:t:U:u:VvW:w:X:x:Y:y:")) !=
-           -1)
-    {
-      switch (c) {
-      case 'A':
-      case 'a':
-      {
-        int tmp;
-        sscanf(optarg, "%d", &tmp);
-        datatype = (grid_data_t)tmp;
-        break;
-      }
-      case 'B':
-      case 'b':
-        sscanf(optarg, "%lf", &border);
-        setborder = true;
-        break;
-      case 'C':
-      case 'c':
-      {
-        const int n = sscanf(optarg, "%d/%d", &clip, (int *)&clipmode);
-        if (n < 1)
-          clipmode = MBGRID_INTERP_NONE;
-        else if (n == 1 && clip > 0)
-          clipmode = MBGRID_INTERP_GAP;
-        else if (n == 1)
-          clipmode = MBGRID_INTERP_NONE;
-        else if (clip > 0 && clipmode < 0)
-          clipmode = MBGRID_INTERP_GAP;
-        else if (clipmode >= 3)
-          clipmode = MBGRID_INTERP_ALL;
-        break;
+/*--------------------------------------------------------------------*/
+/* add a value with the minimum or maximum filter algorithm */
+bool mbgrid_thread_minmax(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread,
+                          double x, double y, double value) {
+  const int ix = (x - control->wbnd[0] + 0.5 * control->dx) / control->dx;
+  const int iy = (y - control->wbnd[2] + 0.5 * control->dy) / control->dy;
+  if (ix < 0 || ix >= control->gxdim || iy < 0 || iy >= control->gydim)
+    return (false);
+  int k;
+  struct mbgrid_tile_struct *tile = mbgrid_tile(thread, ix, iy, &k);
+  if (tile->num[k] <= 0
+      || (control->grid_mode == MBGRID_MINIMUM_FILTER && tile->grid[k] > value)
+      || (control->grid_mode == MBGRID_MAXIMUM_FILTER && tile->grid[k] < value)) {
+    tile->norm[k] = 1.0;
+    tile->grid[k] = value;
+    tile->sigma[k] = value * value;
+    tile->num[k] = 1;
+    tile->cnt[k] = 1;
+  }
+  thread->ndata++;
+  return (true);
+}
+
+/*--------------------------------------------------------------------*/
+/* add a sounding with the footprint weighted mean algorithm */
+bool mbgrid_thread_footprint(int verbose, struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread,
+                             struct mb_io_struct *mb_io_ptr, int topo_type, double file_weight,
+                             double navlon, double navlat, double altitude, double sonardepth,
+                             double bathlon, double bathlat, double bath, int *error) {
+  const double dx = control->dx;
+  const double dy = control->dy;
+  const int ix = (bathlon - control->wbnd[0] + 0.5 * dx) / dx;
+  const int iy = (bathlat - control->wbnd[2] + 0.5 * dy) / dy;
+  if (ix < 0 || ix >= control->gxdim || iy < 0 || iy >= control->gydim)
+    return (false);
+  const double sbath = control->topofactor * bath;
+
+  /* calculate footprint of multibeam soundings */
+  double foot_dx, foot_dy;
+  if (control->use_projection) {
+    foot_dx = (bathlon - navlon);
+    foot_dy = (bathlat - navlat);
+  }
+  else {
+    foot_dx = (bathlon - navlon) / control->mtodeglon;
+    foot_dy = (bathlat - navlat) / control->mtodeglat;
+  }
+  const double foot_lateral = sqrt(foot_dx * foot_dx + foot_dy * foot_dy);
+  double foot_dxn = 1.0;
+  double foot_dyn = 0.0;
+  if (foot_lateral > 0.0) {
+    foot_dxn = foot_dx / foot_lateral;
+    foot_dyn = foot_dy / foot_lateral;
+  }
+  const double foot_range = sqrt(foot_lateral * foot_lateral + altitude * altitude);
+
+  /* deal with point data without footprint */
+  if (topo_type != MB_TOPOGRAPHY_TYPE_MULTIBEAM || foot_range <= 0.0) {
+    int k;
+    struct mbgrid_tile_struct *tile = mbgrid_tile(thread, ix, iy, &k);
+    tile->norm[k] += file_weight;
+    tile->grid[k] += file_weight * sbath;
+    tile->sigma[k] += file_weight * sbath * sbath;
+    tile->num[k]++;
+    tile->cnt[k]++;
+    thread->ndata++;
+    return (true);
+  }
+
+  const double foot_theta = RTD * atan2(foot_lateral, (bath - sonardepth));
+  double foot_dtheta = 0.5 * control->scale * mb_io_ptr->beamwidth_xtrack;
+  double foot_dphi = 0.5 * control->scale * mb_io_ptr->beamwidth_ltrack;
+  if (foot_dtheta <= 0.0)
+    foot_dtheta = 1.0;
+  if (foot_dphi <= 0.0)
+    foot_dphi = 1.0;
+  const double foot_hwidth = (bath - sonardepth) * tan(DTR * (foot_theta + foot_dtheta)) - foot_lateral;
+  const double foot_hlength = foot_range * tan(DTR * foot_dphi);
+
+  /* get range of bins around footprint to examine */
+  int foot_wix, foot_wiy, foot_lix, foot_liy;
+  if (control->use_projection) {
+    foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) / dx);
+    foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) / dx);
+    foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) / dy);
+    foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) / dy);
+  }
+  else {
+    foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) * control->mtodeglon / dx);
+    foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) * control->mtodeglon / dx);
+    foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) * control->mtodeglat / dy);
+    foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) * control->mtodeglat / dy);
+  }
+  const int foot_dix = 2 * std::max(foot_wix, foot_lix);
+  const int foot_diy = 2 * std::max(foot_wiy, foot_liy);
+  const int ix1 = std::max(ix - foot_dix, 0);
+  const int ix2 = std::min(ix + foot_dix, control->gxdim - 1);
+  const int iy1 = std::max(iy - foot_diy, 0);
+  const int iy2 = std::min(iy + foot_diy, control->gydim - 1);
+
+  /* loop over neighborhood of bins */
+  for (int ii = ix1; ii <= ix2; ii++)
+    for (int jj = iy1; jj <= iy2; jj++) {
+      /* get center and corners of bin in meters from sounding center */
+      const double xx = (control->wbnd[0] + ii * dx + 0.5 * dx - bathlon);
+      const double yy = (control->wbnd[2] + jj * dy + 0.5 * dy - bathlat);
+      double xx0, yy0, bdx, bdy;
+      if (control->use_projection) {
+        xx0 = xx;
+        yy0 = yy;
+        bdx = 0.5 * dx;
+        bdy = 0.5 * dy;
       }
-      case 'D':
-      case 'd':
-      {
-        const int n = sscanf(optarg, "%d/%d", &xdim, &ydim);
-        if (n == 2)
-          set_dimensions = true;
-        break;
+      else {
+        xx0 = xx / control->mtodeglon;
+        yy0 = yy / control->mtodeglat;
+        bdx = 0.5 * dx / control->mtodeglon;
+        bdy = 0.5 * dy / control->mtodeglat;
       }
-      case 'E':
-      case 'e':
-      {
-        if (optarg[strlen(optarg) - 1] == '!') {
-          spacing_priority = true;
-          optarg[strlen(optarg) - 1] = '\0';
+      const double xx1 = xx0 - bdx;
+      const double xx2 = xx0 + bdx;
+      const double yy1 = yy0 - bdy;
+      const double yy2 = yy0 + bdy;
+
+      /* rotate center and corners of bin to footprint coordinates */
+      double prx[5], pry[5];
+      prx[0] = xx0 * foot_dxn + yy0 * foot_dyn;
+      pry[0] = -xx0 * foot_dyn + yy0 * foot_dxn;
+      prx[1] = xx1 * foot_dxn + yy1 * foot_dyn;
+      pry[1] = -xx1 * foot_dyn + yy1 * foot_dxn;
+      prx[2] = xx2 * foot_dxn + yy1 * foot_dyn;
+      pry[2] = -xx2 * foot_dyn + yy1 * foot_dxn;
+      prx[3] = xx1 * foot_dxn + yy2 * foot_dyn;
+      pry[3] = -xx1 * foot_dyn + yy2 * foot_dxn;
+      prx[4] = xx2 * foot_dxn + yy2 * foot_dyn;
+      pry[4] = -xx2 * foot_dyn + yy2 * foot_dxn;
+
+      /* get weight integrated over bin */
+      double weight;
+      grid_use_t use_weight;
+      mbgrid_weight(verbose, foot_hwidth, foot_hlength, prx[0], pry[0], bdx, bdy, &prx[1], &pry[1], &weight,
+                    &use_weight, error);
+
+      if (use_weight != MBGRID_USE_NO && weight > 0.000001) {
+        int k;
+        struct mbgrid_tile_struct *tile = mbgrid_tile(thread, ii, jj, &k);
+        weight *= file_weight;
+        tile->norm[k] += weight;
+        tile->grid[k] += weight * sbath;
+        tile->sigma[k] += weight * sbath * sbath;
+        if (use_weight == MBGRID_USE_YES) {
+          tile->num[k]++;
+          if (ii == ix && jj == iy)
+            tile->cnt[k]++;
         }
-        const int n = sscanf(optarg, "%lf/%lf/%1023s", &dx_set, &dy_set, units);
-        if (n > 1)
-          set_spacing = true;
-        if (n < 3)
-          strcpy(units, "meters");
-        break;
       }
-      case 'F':
-      case 'f':
-      {
-        int tmp;
-        double dvalue;
-        const int n = sscanf(optarg, "%d/%lf", &tmp, &dvalue);
-        grid_mode = (grid_alg_t)tmp;
-        if (n == 2) {
-          if (grid_mode == MBGRID_MINIMUM_FILTER) {
-            minormax_weighted_mean_threshold = dvalue;
-            grid_mode = MBGRID_MINIMUM_WEIGHTED_MEAN;
-          } else if (grid_mode == MBGRID_MAXIMUM_FILTER) {
-            minormax_weighted_mean_threshold = dvalue;
-            grid_mode = MBGRID_MAXIMUM_WEIGHTED_MEAN;
-          } else {
-            minormax_weighted_mean_threshold = dvalue;
-          }
-        }
-        break;
-      }
-      case 'G':
-      case 'g':
-        if (optarg[0] == '=') {
-          gridkind = MBGRID_GMTGRD;
-          strcpy(gridkindstring, optarg);
-        }
-        else {
-          int tmp;
-          int nscan = sscanf(optarg, "%d", &tmp);
-          // Range check
-          if (nscan == 1 && tmp >= 1 && tmp <= 4) {
-            gridkind = (grid_type_t)tmp;
-            if (gridkind == MBGRID_CDFGRD) {
-              gridkind = MBGRID_GMTGRD;
-              gridkindstring[0] = '\0';
-            }
-          } else if (optarg[0] == 'n' || optarg[0] == 'c' || optarg[0] == 'b'
-                    || optarg[0] == 'r' || optarg[0] == 's' || optarg[0] == 'a'
-                    || optarg[0] == 'e' || optarg[0] == 'g'){
-            snprintf(gridkindstring, sizeof(gridkindstring), "=%s", optarg);
-            gridkind = MBGRID_GMTGRD;
-          } else {
-            fprintf(stdout, "Invalid gridkind option: -G%s\n\n", optarg);
-            errflg = true;
-          }
-        }
-        break;
-      case 'H':
-      case 'h':
-        help = true;
-        break;
-      case 'I':
-      case 'i':
-        sscanf(optarg, "%1023s", filelist);
-        break;
-      case 'J':
-      case 'j':
-        sscanf(optarg, "%1023s", projection_pars);
-        projection_pars_f = true;
-        break;
-      case 'K':
-      case 'k':
-        sscanf(optarg, "%1023s", backgroundfile);
-        if ((grdrasterid = (int)strtol(backgroundfile, NULL, 10)) <= 0)
-          grdrasterid = -1;
-        break;
-      case 'L':
-      case 'l':
-        sscanf(optarg, "%d", &lonflip);
-        break;
-      case 'M':
-      case 'm':
-        more = true;
-        break;
-      case 'N':
-      case 'n':
-        use_NaN = true;
-        break;
-      case 'O':
-      case 'o':
-        sscanf(optarg, "%1023s", fileroot);
-        break;
-      case 'P':
-      case 'p':
-        sscanf(optarg, "%d", &pings);
-        break;
-      case 'Q':
-      case 'q':
-        bathy_in_feet = true;
-        break;
-      case 'R':
-      case 'r':
-        if (strchr(optarg, '/') == nullptr) {
-          sscanf(optarg, "%lf", &boundsfactor);
-          if (boundsfactor <= 1.0)
-            boundsfactor = 0.0;
-        }
-        else {
-          mb_get_bounds(optarg, gbnd);
-          gbndset = true;
-        }
-        break;
-      case 'S':
-      case 's':
-        sscanf(optarg, "%lf", &speedmin);
-        break;
-      case 'T':
-      case 't':
-        sscanf(optarg, "%lf", &tension);
-        break;
-      case 'U':
-      case 'u':
-        sscanf(optarg, "%lf", &timediff);
-        timediff = 60 * timediff;
-        check_time = true;
-        if (timediff < 0.0) {
-          timediff = fabs(timediff);
-          first_in_stays = false;
-        }
-        break;
-      case 'V':
-      case 'v':
-        verbose++;
-        if (verbose >= 2)
-          outfp = stderr;
-        break;
-      case 'W':
-      case 'w':
-        sscanf(optarg, "%lf", &scale);
-        break;
-      case 'X':
-      case 'x':
-        sscanf(optarg, "%lf", &extend);
-        break;
-      case 'Y':
-      case 'y':
-        if (int n = sscanf(optarg, "%lf/%lf", &shift_x, &shift_y) == 2) {
-          shift = true;
-        }
-        break;
-      case '?':
-        errflg = true;
-      }
-    }
-
-    if (errflg) {
-      fprintf(outfp, "usage: %s\n", usage_message);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      exit(MB_ERROR_BAD_USAGE);
-    }
-
-    if (verbose == 1 || help) {
-      fprintf(outfp, "\nProgram %s\n", program_name);
-      fprintf(outfp, "MB-system Version %s\n", MB_VERSION);
     }
+  thread->ndata++;
+  return (true);
+}
 
-    if (verbose >= 2) {
-      fprintf(outfp, "\ndbg2  Program <%s>\n", program_name);
-      fprintf(outfp, "dbg2  MB-system Version %s\n", MB_VERSION);
-      fprintf(outfp, "dbg2  Control Parameters:\n");
-      fprintf(outfp, "dbg2       verbose:              %d\n", verbose);
-      fprintf(outfp, "dbg2       help:                 %d\n", help);
-      fprintf(outfp, "dbg2       pings:                %d\n", pings);
-      fprintf(outfp, "dbg2       lonflip:              %d\n", lonflip);
-      fprintf(outfp, "dbg2       btime_i[0]:           %d\n", btime_i[0]);
-      fprintf(outfp, "dbg2       btime_i[1]:           %d\n", btime_i[1]);
-      fprintf(outfp, "dbg2       btime_i[2]:           %d\n", btime_i[2]);
-      fprintf(outfp, "dbg2       btime_i[3]:           %d\n", btime_i[3]);
-      fprintf(outfp, "dbg2       btime_i[4]:           %d\n", btime_i[4]);
-      fprintf(outfp, "dbg2       btime_i[5]:           %d\n", btime_i[5]);
-      fprintf(outfp, "dbg2       btime_i[6]:           %d\n", btime_i[6]);
-      fprintf(outfp, "dbg2       etime_i[0]:           %d\n", etime_i[0]);
-      fprintf(outfp, "dbg2       etime_i[1]:           %d\n", etime_i[1]);
-      fprintf(outfp, "dbg2       etime_i[2]:           %d\n", etime_i[2]);
-      fprintf(outfp, "dbg2       etime_i[3]:           %d\n", etime_i[3]);
-      fprintf(outfp, "dbg2       etime_i[4]:           %d\n", etime_i[4]);
-      fprintf(outfp, "dbg2       etime_i[5]:           %d\n", etime_i[5]);
-      fprintf(outfp, "dbg2       etime_i[6]:           %d\n", etime_i[6]);
-      fprintf(outfp, "dbg2       speedmin:             %f\n", speedmin);
-      fprintf(outfp, "dbg2       timegap:              %f\n", timegap);
-      fprintf(outfp, "dbg2       file list:            %s\n", filelist);
-      fprintf(outfp, "dbg2       output file root:     %s\n", fileroot);
-      fprintf(outfp, "dbg2       grid x dimension:     %d\n", xdim);
-      fprintf(outfp, "dbg2       grid y dimension:     %d\n", ydim);
-      fprintf(outfp, "dbg2       grid bounds[0]:       %f\n", gbnd[0]);
-      fprintf(outfp, "dbg2       grid bounds[1]:       %f\n", gbnd[1]);
-      fprintf(outfp, "dbg2       grid bounds[2]:       %f\n", gbnd[2]);
-      fprintf(outfp, "dbg2       grid bounds[3]:       %f\n", gbnd[3]);
-      fprintf(outfp, "dbg2       boundsfactor:         %f\n", boundsfactor);
-      fprintf(outfp, "dbg2       clipmode:             %d\n", clipmode);
-      fprintf(outfp, "dbg2       clip:                 %d\n", clip);
-      fprintf(outfp, "dbg2       tension:              %f\n", tension);
-      fprintf(outfp, "dbg2       grdraster background: %d\n", grdrasterid);
-      fprintf(outfp, "dbg2       backgroundfile:       %s\n", backgroundfile);
-      fprintf(outfp, "dbg2       more:                 %d\n", more);
-      fprintf(outfp, "dbg2       use_NaN:              %d\n", use_NaN);
-      fprintf(outfp, "dbg2       grid_mode:            %d\n", grid_mode);
-      fprintf(outfp, "dbg2       data type:            %d\n", datatype);
-      fprintf(outfp, "dbg2       grid format:          %d\n", gridkind);
-      if (gridkind == MBGRID_GMTGRD)
-        fprintf(outfp, "dbg2       gmt grid format id:   %s\n", gridkindstring);
-      fprintf(outfp, "dbg2       scale:                %f\n", scale);
-      fprintf(outfp, "dbg2       timediff:             %f\n", timediff);
-      fprintf(outfp, "dbg2       setborder:            %d\n", setborder);
-      fprintf(outfp, "dbg2       border:               %f\n", border);
-      fprintf(outfp, "dbg2       extend:               %f\n", extend);
-      fprintf(outfp, "dbg2       shift:                %d\n", shift);
-      fprintf(outfp, "dbg2       shift_x:              %f\n", shift_x);
-      fprintf(outfp, "dbg2       shift_y:              %f\n", shift_y);
-      fprintf(outfp, "dbg2       bathy_in_feet:        %d\n", bathy_in_feet);
-      fprintf(outfp, "dbg2       projection_pars:      %s\n", projection_pars);
-      fprintf(outfp, "dbg2       proj flag 1:          %d\n", projection_pars_f);
-      fprintf(outfp, "dbg2       projection_id:        %s\n", projection_id);
-      // fprintf(outfp, "dbg2       utm_zone:             %d\n", utm_zone);
-      fprintf(outfp, "dbg2       minormax_weighted_mean_threshold: %f\n", minormax_weighted_mean_threshold);
-
-    }
+/*--------------------------------------------------------------------*/
+/* check the time overlap of a value read at time_d from a swath file - if
+   the value is newer than the data already in its grid cell by more than
+   timediff either the value is rejected or the cell is cleared */
+bool mbgrid_thread_time_ok(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread,
+                           struct mbgrid_file_struct *file, double time_d, double x, double y) {
+  const int ix = (x - control->wbnd[0] + 0.5 * control->dx) / control->dx;
+  const int iy = (y - control->wbnd[2] + 0.5 * control->dy) / control->dy;
+  if (ix < 0 || ix >= control->gxdim || iy < 0 || iy >= control->gydim)
+    return (true);
+  double *firsttime = &control->firsttime[ix * control->gydim + iy];
+  if (*firsttime <= 0.0) {
+    *firsttime = time_d;
+    return (true);
+  }
+  if (fabs(time_d - *firsttime) <= control->timediff)
+    return (true);
+  if (control->first_in_stays)
+    return (false);
+  int k;
+  struct mbgrid_tile_struct *tile = mbgrid_tile(thread, ix, iy, &k);
+  *firsttime = time_d;
+  thread->ndata -= tile->cnt[k];
+  file->ndatafile -= tile->cnt[k];
+  tile->norm[k] = 0.0;
+  tile->grid[k] = 0.0;
+  tile->sigma[k] = 0.0;
+  tile->num[k] = 0;
+  tile->cnt[k] = 0;
+  return (true);
+}
 
-    if (help) {
-      fprintf(outfp, "\n%s\n", help_message);
-      fprintf(outfp, "\nusage: %s\n", usage_message);
-      exit(MB_ERROR_NO_ERROR);
-    }
+/*--------------------------------------------------------------------*/
+/* note a value gridded from the current file */
+inline void mbgrid_file_minmax(struct mbgrid_file_struct *file, double value) {
+  if (file->ndatafile == 0) {
+    file->dmin = value;
+    file->dmax = value;
+  }
+  else {
+    file->dmin = std::min(value, file->dmin);
+    file->dmax = std::max(value, file->dmax);
   }
+  file->ndatafile++;
+}
 
+/*--------------------------------------------------------------------*/
+/* read a swath file into the thread local tiles */
+void mbgrid_thread_swath(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread,
+                         struct mbgrid_file_struct *file) {
+  const int verbose = control->verbose;
   int error = MB_ERROR_NO_ERROR;
-  int memclear_error = MB_ERROR_NO_ERROR;
-
-  /* if bounds not set get bounds of input data */
-  if (!gbndset || (!set_spacing && !set_dimensions)) {
-    struct mb_info_struct mb_info;
-    int formatread = -1;
-    status = mb_get_info_datalist(verbose, filelist, &formatread, &mb_info, lonflip, &error);
-
-    if (!gbndset) {
-      gbnd[0] = mb_info.lon_min;
-      gbnd[1] = mb_info.lon_max;
-      gbnd[2] = mb_info.lat_min;
-      gbnd[3] = mb_info.lat_max;
-      // gbndset = true;
-    }
-
-    if (!set_spacing && !set_dimensions) {
-      dx_set = 0.02 * mb_info.altitude_max;
-      dy_set = 0.02 * mb_info.altitude_max;
-      set_spacing = true;
-      strcpy(units, "meters");
-    }
-  }
 
+  /* mbio read values */
+  void *mbio_ptr = nullptr;
   double btime_d;
   double etime_d;
   int beams_bath;
   int beams_amp;
   int pixels_ss;
-  char file[MB_PATH_MAXLINE] = "";
-  void *mbio_ptr = nullptr;
-  struct mb_io_struct *mb_io_ptr = nullptr;
-  int topo_type;
-
-  /* mbgrid control variables */
-  void *datalist;
-  double file_weight;
-  double dx = 0.0;
-  double dy = 0.0;
-  double clipvalue = NO_DATA_FLAG;
-  float outclipvalue = NO_DATA_FLAG;
-  int rformat;
-  int pstatus;
-  char path[MB_PATH_MAXLINE] = "";
-  char ppath[MB_PATH_MAXLINE] = "";
-  char dpath[MB_PATH_MAXLINE] = "";
-  char rfile[MB_PATH_MAXLINE] = "";
-  char ofile[2*MB_PATH_MAXLINE+100] = "";
-  char dfile[MB_PATH_MAXLINE] = "";
-  char plot_cmd[(8*1024)] = "";
-  int plot_status;
-
-  /* mbio read values */
   int rpings;
   int kind;
   int time_i[7];
@@ -837,1726 +1090,1808 @@ int main(int argc, char **argv) {
   double *sslat = nullptr;
   char comment[MB_COMMENT_MAXLINE];
 
-  /* lon,lat,value triples variables */
-  double tlon;
-  double tlat;
-  double tvalue;
+  /* check for mbinfo file - get file bounds if possible */
+  int rformat = file->format;
+  if (mb_check_info(verbose, file->file, control->lonflip, control->bounds, &file->file_in_bounds, &error)
+      == MB_FAILURE) {
+    file->file_in_bounds = true;
+    error = MB_ERROR_NO_ERROR;
+  }
+  if (!file->file_in_bounds)
+    return;
+
+  /* check for "fast bathymetry" or "fbt" file */
+  mb_path rfile;
+  strcpy(rfile, file->file);
+  if (control->datatype == MBGRID_DATA_TOPOGRAPHY || control->datatype == MBGRID_DATA_BATHYMETRY) {
+    mb_get_fbt(verbose, rfile, &rformat, &error);
+  }
 
-  /* grid variables */
-  double wbnd[4], obnd[4];
-  double xlon, ylat, xx, yy;
-  double factor, weight, topofactor;
-  int offx, offy, xtradim;
-  double *grid = nullptr;
-  double *norm = nullptr;
-  double *sigma = nullptr;
-  double *firsttime = nullptr;
-  double *gridsmall = nullptr;
-  double *minormax = nullptr;
-#ifdef USESURFACE
-  float *bxdata = nullptr;
-  float *bydata = nullptr;
-  float *bzdata = nullptr;
-  float *sxdata = nullptr;
-  float *sydata = nullptr;
-  float *szdata = nullptr;
-#else
-  float *bdata = nullptr;
-  float *sdata = nullptr;
-  float *work1 = nullptr;
-  int *work2 = nullptr;
-  bool *work3 = nullptr;
-#endif
-  double bdata_origin_x, bdata_origin_y;
-  float *output = nullptr;
-  float *sgrid = nullptr;
-  int *cnt = nullptr;
-  int *num = nullptr;
-  double **data;
-  double *value = nullptr;
-  int ndata, ndatafile, nbackground;
-  double zmin, zmax, zclip;
-  int nmax;
-  double smin, smax;
-  int nbinset, nbinzero, nbinspline, nbinbackground;
+  /* call mb_read_init() */
+  if (mb_read_init(verbose, rfile, rformat, control->pings, control->lonflip, control->bounds, control->btime_i,
+                   control->etime_i, control->speedmin, control->timegap, &mbio_ptr, &btime_d, &etime_d,
+                   &beams_bath, &beams_amp, &pixels_ss, &error) != MB_SUCCESS) {
+    char *message = nullptr;
+    mb_error(verbose, error, &message);
+    control->output_mutex.lock();
+    fprintf(outfp, "\nMBIO Error returned from function <mb_read_init>:\n%s\n", message);
+    fprintf(outfp, "\nMultibeam File <%s> not initialized for reading\n", rfile);
+    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+    exit(error);
+  }
+  struct mb_io_struct *mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+  /* get topography type */
+  int topo_type = MB_TOPOGRAPHY_TYPE_UNKNOWN;
+  if (control->grid_mode == MBGRID_WEIGHTED_FOOTPRINT)
+    mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
+
+  /* allocate memory for reading data arrays */
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(char), (void **)&beamflag, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bath, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_AMPLITUDE, sizeof(double), (void **)&amp, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bathlon, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bathlat, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&ss, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&sslon, &error);
+  if (error == MB_ERROR_NO_ERROR)
+    mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&sslat, &error);
 
-  /* projected grid parameters */
-  void *pjptr;
-  double deglontokm, deglattokm;
-  double mtodeglon, mtodeglat;
+  /* if error initializing memory then quit */
+  if (error != MB_ERROR_NO_ERROR) {
+    char *message = nullptr;
+    mb_error(verbose, error, &message);
+    control->output_mutex.lock();
+    fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
+    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+    exit(error);
+  }
 
-  /* output char strings */
-  char xlabel[MB_PATH_MAXLINE+20] = "";
-  char ylabel[MB_PATH_MAXLINE+20] = "";
-  char zlabel[MB_PATH_MAXLINE+20] = "";
-  char title[MB_PATH_MAXLINE] = "";
-  char nlabel[MB_PATH_MAXLINE] = "";
-  char sdlabel[MB_PATH_MAXLINE] = "";
+  /* loop over reading */
+  while (error <= MB_ERROR_NO_ERROR) {
+    mb_read(verbose, mbio_ptr, &kind, &rpings, time_i, &time_d, &navlon, &navlat, &speed, &heading, &distance,
+            &altitude, &sonardepth, &beams_bath, &beams_amp, &pixels_ss, beamflag, bath, amp, bathlon, bathlat, ss,
+            sslon, sslat, comment, &error);
+
+    /* time gaps are not a problem here */
+    if (error == MB_ERROR_TIME_GAP)
+      error = MB_ERROR_NO_ERROR;
+    if (error != MB_ERROR_NO_ERROR)
+      continue;
+
+    if (control->datatype == MBGRID_DATA_BATHYMETRY || control->datatype == MBGRID_DATA_TOPOGRAPHY) {
+      /* if needed try again to get topography type */
+      if (control->grid_mode == MBGRID_WEIGHTED_FOOTPRINT && topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN) {
+        mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
+        if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN && mb_io_ptr->beamwidth_xtrack > 0.0
+            && mb_io_ptr->beamwidth_ltrack > 0.0) {
+          topo_type = MB_TOPOGRAPHY_TYPE_MULTIBEAM;
+        }
+      }
 
-  /* other variables */
-  FILE *dfp = nullptr;
-  FILE *rfp = nullptr;
-  int kgrid, kout, kint, ib, ix, iy;
-  int ix1, ix2, iy1, iy2;
+      /* reproject beam positions if necessary */
+      if (control->use_projection) {
+        mb_proj_forward(verbose, thread->pjptr, navlon, navlat, &navlon, &navlat, &error);
+        for (int ib = 0; ib < beams_bath; ib++)
+          if (mb_beam_ok(beamflag[ib]))
+            mb_proj_forward(verbose, thread->pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib], &error);
+      }
 
-  double foot_dx, foot_dy, foot_dxn, foot_dyn;
-  double foot_lateral, beam_altitude, foot_range, foot_theta;
-  double foot_dtheta, foot_dphi;
-  double foot_hwidth, foot_hlength;
-  int foot_wix, foot_wiy, foot_lix, foot_liy, foot_dix, foot_diy;
-  double sbath;
-  double xx0, yy0, bdx, bdy, xx1, xx2, yy1, yy2;
-  double prx[5], pry[5];
-  grid_use_t use_weight;
+      /* deal with data */
+      for (int ib = 0; ib < beams_bath; ib++)
+        if (mb_beam_ok(beamflag[ib])) {
+          if (control->check_time && !mbgrid_thread_time_ok(control, thread, file, time_d, bathlon[ib], bathlat[ib]))
+            continue;
+          bool used;
+          if (control->grid_mode == MBGRID_WEIGHTED_MEAN)
+            used = mbgrid_thread_weighted_mean(control, thread, file->file_weight, bathlon[ib], bathlat[ib],
+                                               control->topofactor * bath[ib], 0);
+          else if (control->grid_mode == MBGRID_WEIGHTED_FOOTPRINT)
+            used = mbgrid_thread_footprint(verbose, control, thread, mb_io_ptr, topo_type, file->file_weight,
+                                           navlon, navlat, altitude, sonardepth, bathlon[ib], bathlat[ib],
+                                           bath[ib], &error);
+          else
+            used = mbgrid_thread_minmax(control, thread, bathlon[ib], bathlat[ib], control->topofactor * bath[ib]);
+          if (used)
+            mbgrid_file_minmax(file, control->topofactor * bath[ib]);
+        }
+    }
+    else if (control->datatype == MBGRID_DATA_AMPLITUDE) {
+      /* reproject beam positions if necessary */
+      if (control->use_projection) {
+        for (int ib = 0; ib < beams_amp; ib++)
+          if (mb_beam_ok(beamflag[ib]))
+            mb_proj_forward(verbose, thread->pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib], &error);
+      }
 
-  int gxdim = 0;
-  int gydim = 0;
+      /* deal with data */
+      for (int ib = 0; ib < beams_amp; ib++)
+        if (mb_beam_ok(beamflag[ib])) {
+          if (control->check_time && !mbgrid_thread_time_ok(control, thread, file, time_d, bathlon[ib], bathlat[ib]))
+            continue;
+          bool used;
+          if (control->grid_mode == MBGRID_WEIGHTED_MEAN)
+            used = mbgrid_thread_weighted_mean(control, thread, file->file_weight, bathlon[ib], bathlat[ib],
+                                               amp[ib], 0);
+          else
+            used = mbgrid_thread_minmax(control, thread, bathlon[ib], bathlat[ib], amp[ib]);
+          if (used)
+            mbgrid_file_minmax(file, amp[ib]);
+        }
+    }
+    else if (control->datatype == MBGRID_DATA_SIDESCAN) {
+      /* reproject pixel positions if necessary */
+      if (control->use_projection) {
+        for (int ib = 0; ib < pixels_ss; ib++)
+          if (ss[ib] > MB_SIDESCAN_NULL)
+            mb_proj_forward(verbose, thread->pjptr, sslon[ib], sslat[ib], &sslon[ib], &sslat[ib], &error);
+      }
 
-  /* if requested expand the grid bounds */
-  if (boundsfactor > 1.0) {
-    xx1 = 0.5 * (boundsfactor - 1.0) * (gbnd[1] - gbnd[0]);
-    yy1 = 0.5 * (boundsfactor - 1.0) * (gbnd[3] - gbnd[2]);
-    gbnd[0] -= xx1;
-    gbnd[1] += xx1;
-    gbnd[2] -= yy1;
-    gbnd[3] += yy1;
+      /* deal with data */
+      for (int ib = 0; ib < pixels_ss; ib++)
+        if (ss[ib] > MB_SIDESCAN_NULL) {
+          if (control->check_time && !mbgrid_thread_time_ok(control, thread, file, time_d, sslon[ib], sslat[ib]))
+            continue;
+          bool used;
+          if (control->grid_mode == MBGRID_WEIGHTED_MEAN)
+            used = mbgrid_thread_weighted_mean(control, thread, file->file_weight, sslon[ib], sslat[ib], ss[ib], 0);
+          else
+            used = mbgrid_thread_minmax(control, thread, sslon[ib], sslat[ib], ss[ib]);
+          if (used)
+            mbgrid_file_minmax(file, ss[ib]);
+        }
+    }
   }
+  mb_close(verbose, &mbio_ptr, &error);
+}
 
-  /* if bounds not specified then quit */
-  if (gbnd[0] >= gbnd[1] || gbnd[2] >= gbnd[3]) {
-    fprintf(outfp, "\nGrid bounds not properly specified:\n\t%f %f %f %f\n", gbnd[0], gbnd[1], gbnd[2], gbnd[3]);
+/*--------------------------------------------------------------------*/
+/* read a lon,lat,value triples file into the thread local tiles */
+void mbgrid_thread_triples(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread,
+                           struct mbgrid_file_struct *file) {
+  const int verbose = control->verbose;
+  int error = MB_ERROR_NO_ERROR;
+
+  /* open data file */
+  FILE *rfp = fopen(file->path, "r");
+  if (rfp == nullptr) {
+    error = MB_ERROR_OPEN_FAIL;
+    control->output_mutex.lock();
+    fprintf(outfp, "\nUnable to open lon,lat,value triples data file1: %s\n", file->path);
     fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-    exit(MB_ERROR_BAD_PARAMETER);
+    exit(error);
   }
 
-  /* footprint option only for bathymetry */
-  if ((grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE || grid_mode == MBGRID_WEIGHTED_FOOTPRINT) &&
-      (datatype != MBGRID_DATA_TOPOGRAPHY && datatype != MBGRID_DATA_BATHYMETRY)) {
-    grid_mode = MBGRID_WEIGHTED_MEAN;
-  }
+  /* loop over reading */
+  double tlon;
+  double tlat;
+  double tvalue;
+  while (fscanf(rfp, "%lf %lf %lf", &tlon, &tlat, &tvalue) != EOF) {
+    /* reproject data positions if necessary */
+    if (control->use_projection)
+      mb_proj_forward(verbose, thread->pjptr, tlon, tlat, &tlon, &tlat, &error);
+
+    /* with the time overlap check triples do not overwrite swath data */
+    if (control->check_time) {
+      const int ix = (tlon - control->wbnd[0] + 0.5 * control->dx) / control->dx;
+      const int iy = (tlat - control->wbnd[2] + 0.5 * control->dy) / control->dy;
+      if (ix >= 0 && ix < control->gxdim && iy >= 0 && iy < control->gydim
+          && control->firsttime[ix * control->gydim + iy] > 0.0)
+        continue;
+    }
 
-  /* more option not available with minimum
-      or maximum filter algorithms */
-  if (more && (grid_mode == MBGRID_MINIMUM_FILTER || grid_mode == MBGRID_MAXIMUM_FILTER))
-    more = false;
+    bool used;
+    if (control->grid_mode == MBGRID_WEIGHTED_MEAN)
+      used = mbgrid_thread_weighted_mean(control, thread, file->file_weight, tlon, tlat,
+                                         control->topofactor * tvalue, control->xtradim);
+    else
+      used = mbgrid_thread_minmax(control, thread, tlon, tlat, control->topofactor * tvalue);
+    if (used)
+      mbgrid_file_minmax(file, control->topofactor * tvalue);
+  }
+  fclose(rfp);
+}
 
-  /* NaN cannot be used for ASCII grids */
-  if (use_NaN && (gridkind == MBGRID_ASCII || gridkind == MBGRID_ARCASCII))
-    use_NaN = false;
+/*--------------------------------------------------------------------*/
+/* gridding thread - reads files handed out from the shared file list
+   until none remain */
+void mbgrid_thread(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *thread) {
+  for (int ifile = control->next_file++; ifile < control->nfile; ifile = control->next_file++) {
+    struct mbgrid_file_struct *file = &control->files[ifile];
+    if (file->format > 0)
+      mbgrid_thread_swath(control, thread, file);
+    else
+      mbgrid_thread_triples(control, thread, file);
+
+    control->output_mutex.lock();
+    if (control->verbose >= 2)
+      fprintf(outfp, "\n");
+    if (control->verbose > 0)
+      fprintf(outfp, "%d data points processed in %s (minmax: %f %f)\n", file->ndatafile, file->file, file->dmin,
+              file->dmax);
+    else if (file->format > 0 ? file->file_in_bounds : file->ndatafile > 0)
+      fprintf(outfp, "%d data points processed in %s\n", file->ndatafile, file->file);
+    control->output_mutex.unlock();
+  }
+}
 
-  /* define NaN in case it's needed */
-  if (use_NaN) {
-    outclipvalue = std::numeric_limits<float>::quiet_NaN();
+/*--------------------------------------------------------------------*/
+/* reduce the thread local tiles with index itile = ithread, ithread + nthread, ...
+   into the working grid arrays */
+void mbgrid_reduce_tiles(struct mbgrid_control_struct *control, struct mbgrid_thread_struct *threads, int nthread,
+                         int ithread, double *grid, double *norm, double *sigma, int *num, int *cnt) {
+  const bool minmax = control->grid_mode == MBGRID_MINIMUM_FILTER || control->grid_mode == MBGRID_MAXIMUM_FILTER;
+  const int ntile = threads[0].ntilex * threads[0].ntiley;
+  for (int itile = ithread; itile < ntile; itile += nthread) {
+    const int ix0 = (itile / threads[0].ntiley) * MBGRID_TILE_DIM;
+    const int iy0 = (itile % threads[0].ntiley) * MBGRID_TILE_DIM;
+    const int nx = std::min(MBGRID_TILE_DIM, control->gxdim - ix0);
+    const int ny = std::min(MBGRID_TILE_DIM, control->gydim - iy0);
+
+    /* combine the tiles in thread order so the result does not depend on timing */
+    for (int jthread = 0; jthread < nthread; jthread++) {
+      struct mbgrid_tile_struct *tile = threads[jthread].tiles[itile];
+      if (tile == nullptr)
+        continue;
+      for (int i = 0; i < nx; i++)
+        for (int j = 0; j < ny; j++) {
+          const int k = i * MBGRID_TILE_DIM + j;
+          const int kgrid = (ix0 + i) * control->gydim + iy0 + j;
+          if (!minmax) {
+            norm[kgrid] += tile->norm[k];
+            grid[kgrid] += tile->grid[k];
+            sigma[kgrid] += tile->sigma[k];
+            num[kgrid] += tile->num[k];
+            cnt[kgrid] += tile->cnt[k];
+          }
+          else if (tile->num[k] > 0
+                   && (num[kgrid] <= 0
+                       || (control->grid_mode == MBGRID_MINIMUM_FILTER && grid[kgrid] > tile->grid[k])
+                       || (control->grid_mode == MBGRID_MAXIMUM_FILTER && grid[kgrid] < tile->grid[k]))) {
+            norm[kgrid] = tile->norm[k];
+            grid[kgrid] = tile->grid[k];
+            sigma[kgrid] = tile->sigma[k];
+            num[kgrid] = tile->num[k];
+            cnt[kgrid] = tile->cnt[k];
+          }
+        }
+      delete tile;
+      threads[jthread].tiles[itile] = nullptr;
+    }
   }
+}
 
-  bool use_projection = false;
+/*--------------------------------------------------------------------*/
+/* read all swath files in the datalist with n_threads gridding threads and
+   accumulate the results into the working grid arrays, which must have been
+   initialized to zero - returns the number of data gridded */
+int mbgrid_read_threaded(struct mbgrid_control_struct *control, void *datalist, unsigned int n_threads, FILE *dfp,
+                         double *grid, double *norm, double *sigma, int *num, int *cnt, int *error) {
+  const int verbose = control->verbose;
+
+  /* read the datalist */
+  int nfile_alloc = 0;
+  control->nfile = 0;
+  control->files = nullptr;
+  int pstatus;
+  int format;
+  double file_weight;
+  mb_path path;
+  mb_path ppath;
+  mb_path dpath;
+  while (mb_datalist_read2(verbose, datalist, &pstatus, path, ppath, dpath, &format, &file_weight, error) == MB_SUCCESS) {
+    if ((format > 0 || (format == 0 && control->grid_mode != MBGRID_WEIGHTED_FOOTPRINT)) && path[0] != '#') {
+      if (control->nfile >= nfile_alloc) {
+        nfile_alloc += 100;
+        control->files = (struct mbgrid_file_struct *)realloc(control->files, nfile_alloc * sizeof(struct mbgrid_file_struct));
+      }
+      struct mbgrid_file_struct *file = &control->files[control->nfile];
+      strcpy(file->path, path);
+      strcpy(file->file, pstatus == MB_PROCESSED_USE ? ppath : path);
+      file->format = format;
+      file->pstatus = pstatus;
+      file->file_weight = file_weight;
+      file->ndatafile = 0;
+      file->dmin = 0.0;
+      file->dmax = 0.0;
+      file->file_in_bounds = true;
+      control->nfile++;
+    }
+  }
+  *error = MB_ERROR_NO_ERROR;
+  control->next_file = 0;
+
+  /* start the gridding threads */
+  n_threads = std::max(1U, std::min(n_threads, (unsigned int)std::max(control->nfile, 1)));
+  struct mbgrid_thread_struct threads[MB_THREAD_MAX];
+  std::thread gridThreads[MB_THREAD_MAX];
+  const int ntilex = (control->gxdim + MBGRID_TILE_DIM - 1) / MBGRID_TILE_DIM;
+  const int ntiley = (control->gydim + MBGRID_TILE_DIM - 1) / MBGRID_TILE_DIM;
+  for (unsigned int ithread = 0; ithread < n_threads; ithread++) {
+    threads[ithread].ntilex = ntilex;
+    threads[ithread].ntiley = ntiley;
+    threads[ithread].tiles = new mbgrid_tile_struct *[ntilex * ntiley]();
+    threads[ithread].pjptr = nullptr;
+    threads[ithread].ndata = 0;
+    if (control->use_projection)
+      mb_proj_init(verbose, control->projection_id, &threads[ithread].pjptr, error);
+  }
+  for (unsigned int ithread = 0; ithread < n_threads; ithread++)
+    gridThreads[ithread] = std::thread(mbgrid_thread, control, &threads[ithread]);
+  for (unsigned int ithread = 0; ithread < n_threads; ithread++)
+    gridThreads[ithread].join();
+
+  /* reduce the thread local tiles into the working grid, with the threads
+     each handling a disjoint set of tiles */
+  for (unsigned int ithread = 0; ithread < n_threads; ithread++)
+    gridThreads[ithread] = std::thread(mbgrid_reduce_tiles, control, threads, (int)n_threads, (int)ithread, grid,
+                                       norm, sigma, num, cnt);
+  int ndata = 0;
+  for (unsigned int ithread = 0; ithread < n_threads; ithread++) {
+    gridThreads[ithread].join();
+    ndata += threads[ithread].ndata;
+    delete[] threads[ithread].tiles;
+    if (threads[ithread].pjptr != nullptr)
+      mb_proj_free(verbose, &threads[ithread].pjptr, error);
+  }
 
-  /* deal with projected gridding */
-  if (projection_pars_f) {
-    /* check for UTM with undefined zone */
-    if (strcmp(projection_pars, "UTM") == 0 || strcmp(projection_pars, "U") == 0 || strcmp(projection_pars, "utm") == 0 ||
-        strcmp(projection_pars, "u") == 0) {
-      double reference_lon = 0.5 * (gbnd[0] + gbnd[1]);
-      if (reference_lon < 180.0)
-        reference_lon += 360.0;
-      if (reference_lon >= 180.0)
-        reference_lon -= 360.0;
-      const int utm_zone = (int)(((reference_lon + 183.0) / 6.0) + 0.5);
-      double reference_lat = 0.5 * (gbnd[2] + gbnd[3]);
-      if (reference_lat >= 0.0)
-        snprintf(projection_id, sizeof(projection_id), "UTM%2.2dN", utm_zone);
+  /* add files that contributed data to the output datalist in datalist order */
+  for (int ifile = 0; ifile < control->nfile; ifile++) {
+    struct mbgrid_file_struct *file = &control->files[ifile];
+    if (file->ndatafile > 0 && dfp != nullptr) {
+      if (file->pstatus == MB_PROCESSED_USE)
+        fprintf(dfp, "P:");
       else
-        snprintf(projection_id, sizeof(projection_id), "UTM%2.2dS", utm_zone);
+        fprintf(dfp, "R:");
+      fprintf(dfp, "%s %d %f\n", file->path, file->format, file->file_weight);
+      fflush(dfp);
     }
-    else
-      strcpy(projection_id, projection_pars);
-
-    /* set projection flag */
-    use_projection = true;
-    const int proj_status = mb_proj_init(verbose, projection_id, &(pjptr), &error);
+  }
+  free(control->files);
+  control->files = nullptr;
+  control->nfile = 0;
 
-    /* if projection not successfully initialized then quit */
-    if (proj_status != MB_SUCCESS) {
-      fprintf(outfp, "\nOutput projection %s not found in database\n", projection_id);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_BAD_PARAMETER);
-    }
+  *error = MB_ERROR_NO_ERROR;
+  return (ndata);
+}
 
-    /* translate lon lat bounds from UTM if required */
-    if (gbnd[0] < -360.0 || gbnd[0] > 360.0 || gbnd[1] < -360.0 || gbnd[1] > 360.0 || gbnd[2] < -90.0 || gbnd[2] > 90.0 ||
-        gbnd[3] < -90.0 || gbnd[3] > 90.0) {
-      /* first point */
-      xx = gbnd[0];
-      yy = gbnd[2];
-      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-      mb_apply_lonflip(verbose, lonflip, &xlon);
-      obnd[0] = xlon;
-      obnd[1] = xlon;
-      obnd[2] = ylat;
-      obnd[3] = ylat;
+/*--------------------------------------------------------------------*/
 
-      /* second point */
-      xx = gbnd[1];
-      yy = gbnd[2];
-      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-      mb_apply_lonflip(verbose, lonflip, &xlon);
-      obnd[0] = std::min(obnd[0], xlon);
-      obnd[1] = std::max(obnd[1], xlon);
-      obnd[2] = std::min(obnd[2], ylat);
-      obnd[3] = std::max(obnd[3], ylat);
+int main(int argc, char **argv) {
+  int verbose = 0;
+  int format;
+  int pings;
+  int lonflip;
+  double bounds[4];
+  int btime_i[7];
+  int etime_i[7];
+  double speedmin;
+  double timegap;
+  int status = mb_defaults(verbose, &format, &pings, &lonflip, bounds, btime_i, etime_i, &speedmin, &timegap);
 
-      /* third point */
-      xx = gbnd[0];
-      yy = gbnd[3];
-      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-      mb_apply_lonflip(verbose, lonflip, &xlon);
-      obnd[0] = std::min(obnd[0], xlon);
-      obnd[1] = std::max(obnd[1], xlon);
-      obnd[2] = std::min(obnd[2], ylat);
-      obnd[3] = std::max(obnd[3], ylat);
+  grid_data_t datatype = MBGRID_DATA_BATHYMETRY;
+  double border = 0.0;
+  bool setborder = false;
+  char gridkindstring[MB_PATH_MAXLINE] = "";
+  int clip = 0;
+  int xdim = 101;
+  int ydim = 101;
+  char fileroot[MB_PATH_MAXLINE] = "grid";
+  char projection_id[MB_PATH_MAXLINE] = "Geographic";
+  double gbnd[4] = {0.0, 0.0, 0.0, 0.0};
+  bool gbndset = false;
+  double scale = 1.0;
+  double extend = 0.0;
+  double shift_x = 0.0;
+  double shift_y = 0.0;
+  bool shift = false;
+  bool first_in_stays = true;
+  bool check_time = false;
+  double timediff = 300.0;
+#ifdef USESURFACE
+  double tension = 0.35;
+#else
+  double tension = 0.0;
+#endif
 
-      /* fourth point */
-      xx = gbnd[1];
-      yy = gbnd[3];
-      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-      mb_apply_lonflip(verbose, lonflip, &xlon);
-      obnd[0] = std::min(obnd[0], xlon);
-      obnd[1] = std::max(obnd[1], xlon);
-      obnd[2] = std::min(obnd[2], ylat);
-      obnd[3] = std::max(obnd[3], ylat);
-    }
-
-    /* else translate bounds to UTM */
-    else {
-      /* copy gbnd to obnd */
-      obnd[0] = gbnd[0];
-      obnd[1] = gbnd[1];
-      obnd[2] = gbnd[2];
-      obnd[3] = gbnd[3];
-
-      /* first point */
-      xlon = obnd[0];
-      ylat = obnd[2];
-      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
-      gbnd[0] = xx;
-      gbnd[1] = xx;
-      gbnd[2] = yy;
-      gbnd[3] = yy;
-
-      /* second point */
-      xlon = obnd[1];
-      ylat = obnd[2];
-      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
-      gbnd[0] = std::min(gbnd[0], xx);
-      gbnd[1] = std::max(gbnd[1], xx);
-      gbnd[2] = std::min(gbnd[2], yy);
-      gbnd[3] = std::max(gbnd[3], yy);
-
-      /* third point */
-      xlon = obnd[0];
-      ylat = obnd[3];
-      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
-      gbnd[0] = std::min(gbnd[0], xx);
-      gbnd[1] = std::max(gbnd[1], xx);
-      gbnd[2] = std::min(gbnd[2], yy);
-      gbnd[3] = std::max(gbnd[3], yy);
-
-      /* fourth point */
-      xlon = obnd[1];
-      ylat = obnd[3];
-      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
-      gbnd[0] = std::min(gbnd[0], xx);
-      gbnd[1] = std::max(gbnd[1], xx);
-      gbnd[2] = std::min(gbnd[2], yy);
-      gbnd[3] = std::max(gbnd[3], yy);
-    }
-
-    /* get local scaling of lon lat */
-    mb_coor_scale(verbose, 0.5 * (obnd[2] + obnd[3]), &mtodeglon, &mtodeglat);
-    deglontokm = 0.001 / mtodeglon;
-    deglattokm = 0.001 / mtodeglat;
-
-    /* calculate grid properties */
-    if (set_spacing) {
-      xdim = lrint((gbnd[1] - gbnd[0]) / dx_set + 1);
-      if (dy_set <= 0.0)
-        dy_set = dx_set;
-      ydim = lrint((gbnd[3] - gbnd[2]) / dy_set + 1);
-      if (spacing_priority) {
-        gbnd[1] = gbnd[0] + dx_set * (xdim - 1);
-        gbnd[3] = gbnd[2] + dy_set * (ydim - 1);
-      }
-      if (units[0] == 'M' || units[0] == 'm')
-        strcpy(units, "meters");
-      else if (units[0] == 'K' || units[0] == 'k')
-        strcpy(units, "km");
-      else if (units[0] == 'F' || units[0] == 'f')
-        strcpy(units, "feet");
-      else if (strncmp(units, "arcmin", 6) == 0) {
-        dx_set = dx_set / 60.0;
-        dy_set = dy_set / 60.0;
-        strcpy(units, "degrees");
-      }
-      else if (strncmp(units, "arcsec", 6) == 0) {
-        dx_set = dx_set / 3600.0;
-        dy_set = dy_set / 3600.0;
-        strcpy(units, "degrees");
-      }
-      else
-        strcpy(units, "unknown");
-    }
-  }
-
-  /* deal with no projection */
-  else {
-    /* get local scaling of lon lat */
-    mb_coor_scale(verbose, 0.5 * (gbnd[2] + gbnd[3]), &mtodeglon, &mtodeglat);
-    deglontokm = 0.001 / mtodeglon;
-    deglattokm = 0.001 / mtodeglat;
+  double boundsfactor = 0.0;
+  bool bathy_in_feet = false;
+  bool more = false;
+  bool use_NaN = false;
+  int grdrasterid = 0;
+  char projection_pars[MB_PATH_MAXLINE] = "";
+  bool projection_pars_f = false;
+  char filelist[MB_PATH_MAXLINE] = "datalist.mb-1";
+  char backgroundfile[MB_PATH_MAXLINE] = "";
+  grid_type_t gridkind = MBGRID_GMTGRD;
+  double minormax_weighted_mean_threshold = 1.0;
+  grid_alg_t grid_mode = MBGRID_WEIGHTED_MEAN;
+  bool set_spacing = false;
+  char units[MB_PATH_MAXLINE] = "";
+  double dx_set = 0.0;
+  double dy_set = 0.0;
+  bool spacing_priority = false;
+  bool set_dimensions = false;
+  grid_interp_t clipmode = MBGRID_INTERP_NONE;
+  unsigned int n_threads = 1;
+  double median_percentile = 50.0;
+  int median_memory = MBGRID_MEDIAN_MEMORY_DEFAULT;
 
-    /* calculate grid properties */
-    if (set_spacing && (units[0] == 'M' || units[0] == 'm')) {
-      xdim = lrint((gbnd[1] - gbnd[0]) / (mtodeglon * dx_set) + 1);
-      if (dy_set <= 0.0)
-        dy_set = mtodeglon * dx_set / mtodeglat;
-      ydim = lrint((gbnd[3] - gbnd[2]) / (mtodeglat * dy_set) + 1);
-      if (spacing_priority) {
-        gbnd[1] = gbnd[0] + mtodeglon * dx_set * (xdim - 1);
-        gbnd[3] = gbnd[2] + mtodeglat * dy_set * (ydim - 1);
-      }
-      strcpy(units, "meters");
-    }
-    else if (set_spacing && (units[0] == 'K' || units[0] == 'k')) {
-      xdim = lrint((gbnd[1] - gbnd[0]) * deglontokm / dx_set + 1);
-      if (dy_set <= 0.0)
-        dy_set = deglattokm * dx_set / deglontokm;
-      ydim = lrint((gbnd[3] - gbnd[2]) * deglattokm / dy_set + 1);
-      if (spacing_priority) {
-        gbnd[1] = gbnd[0] + dx_set * (xdim - 1) / deglontokm;
-        gbnd[3] = gbnd[2] + dy_set * (ydim - 1) / deglattokm;
+  {
+    const struct option options[] = {{"threads", required_argument, nullptr, 0},
+                                     {"median-memory", required_argument, nullptr, 0},
+                                     {nullptr, 0, nullptr, 0}};
+    bool errflg = false;
+    int c;
+    bool help = false;
+    int option_index;
+    while ((c = getopt_long(argc, argv, "A:a:B:b:C:c:D:d:E:e:F:f:G:g:HhI:i:J:j:K:k:L:l:MmNnO:o:P:p:QqR:r:S:s:T:t:U:u:VvW:w:X:x:Y:y:",
+                            options, &option_index)) != -1)
+    {
+      switch (c) {
+      /* long options */
+      case 0:
+        if (strcmp("threads", options[option_index].name) == 0) {
+          int tmp;
+          if (sscanf(optarg, "%d", &tmp) == 1 && tmp > 0)
+            n_threads = tmp;
+          n_threads = std::min(n_threads, std::min(std::max(std::thread::hardware_concurrency(), 1U),
+                                                   (unsigned int)MB_THREAD_MAX));
+        }
+        else if (strcmp("median-memory", options[option_index].name) == 0) {
+          int tmp;
+          if (sscanf(optarg, "%d", &tmp) == 1 && tmp > 0)
+            median_memory = tmp;
+        }
+        break;
+      case 'A':
+      case 'a':
+      {
+        int tmp;
+        sscanf(optarg, "%d", &tmp);
+        datatype = (grid_data_t)tmp;
+        break;
       }
-      strcpy(units, "km");
-    }
-    else if (set_spacing && (units[0] == 'F' || units[0] == 'f')) {
-      xdim = lrint((gbnd[1] - gbnd[0]) / (mtodeglon * 0.3048 * dx_set) + 1);
-      if (dy_set <= 0.0)
-        dy_set = mtodeglon * dx_set / mtodeglat;
-      ydim = lrint((gbnd[3] - gbnd[2]) / (mtodeglat * 0.3048 * dy_set) + 1);
-      if (spacing_priority) {
-        gbnd[1] = gbnd[0] + mtodeglon * 0.3048 * dx_set * (xdim - 1);
-        gbnd[3] = gbnd[2] + mtodeglat * 0.3048 * dy_set * (ydim - 1);
+      case 'B':
+      case 'b':
+        sscanf(optarg, "%lf", &border);
+        setborder = true;
+        break;
+      case 'C':
+      case 'c':
+      {
+        const int n = sscanf(optarg, "%d/%d", &clip, (int *)&clipmode);
+        if (n < 1)
+          clipmode = MBGRID_INTERP_NONE;
+        else if (n == 1 && clip > 0)
+          clipmode = MBGRID_INTERP_GAP;
+        else if (n == 1)
+          clipmode = MBGRID_INTERP_NONE;
+        else if (clip > 0 && clipmode < 0)
+          clipmode = MBGRID_INTERP_GAP;
+        else if (clipmode >= 3)
+          clipmode = MBGRID_INTERP_ALL;
+        break;
       }
-      strcpy(units, "feet");
-    }
-    else if (set_spacing) {
-      if (strncmp(units, "arcmin", 6) == 0) {
-        dx_set = dx_set / 60.0;
-        dy_set = dy_set / 60.0;
-        strcpy(units, "degrees");
+      case 'D':
+      case 'd':
+      {
+        const int n = sscanf(optarg, "%d/%d", &xdim, &ydim);
+        if (n == 2)
+          set_dimensions = true;
+        break;
       }
-      else if (strncmp(units, "arcsec", 6) == 0) {
-        dx_set = dx_set / 3600.0;
-        dy_set = dy_set / 3600.0;
-        strcpy(units, "degrees");
+      case 'E':
+      case 'e':
+      {
+        if (optarg[strlen(optarg) - 1] == '!') {
+          spacing_priority = true;
+          optarg[strlen(optarg) - 1] = '\0';
+        }
+        const int n = sscanf(optarg, "%lf/%lf/%1023s", &dx_set, &dy_set, units);
+        if (n > 1)
+          set_spacing = true;
+        if (n < 3)
+          strcpy(units, "meters");
+        break;
       }
-      else
-        strcpy(units, "degrees");
-      xdim = lrint((gbnd[1] - gbnd[0]) / dx_set + 1);
-      if (dy_set <= 0.0)
-        dy_set = dx_set;
-      ydim = lrint((gbnd[3] - gbnd[2]) / dy_set + 1);
-      if (spacing_priority) {
-        gbnd[1] = gbnd[0] + dx_set * (xdim - 1);
-        gbnd[3] = gbnd[2] + dy_set * (ydim - 1);
+      case 'F':
+      case 'f':
+      {
+        int tmp;
+        double dvalue;
+        const int n = sscanf(optarg, "%d/%lf", &tmp, &dvalue);
+        grid_mode = (grid_alg_t)tmp;
+        if (n == 2) {
+          if (grid_mode == MBGRID_MINIMUM_FILTER) {
+            minormax_weighted_mean_threshold = dvalue;
+            grid_mode = MBGRID_MINIMUM_WEIGHTED_MEAN;
+          } else if (grid_mode == MBGRID_MAXIMUM_FILTER) {
+            minormax_weighted_mean_threshold = dvalue;
+            grid_mode = MBGRID_MAXIMUM_WEIGHTED_MEAN;
+          } else if (grid_mode == MBGRID_MEDIAN_FILTER) {
+            median_percentile = std::min(std::max(dvalue, 0.0), 100.0);
+          } else {
+            minormax_weighted_mean_threshold = dvalue;
+          }
+        }
+        break;
       }
-    }
-  }
-
-  /* calculate other grid properties */
-  dx = (gbnd[1] - gbnd[0]) / (xdim - 1);
-  dy = (gbnd[3] - gbnd[2]) / (ydim - 1);
-  factor = 4.0 / (scale * scale * dx * dy);
-  offx = 0;
-  offy = 0;
-  if (extend > 0.0) {
-    offx = (int)(extend * xdim);
-    offy = (int)(extend * ydim);
-  }
-  xtradim = scale + 2;
-  gxdim = xdim + 2 * offx;
-  gydim = ydim + 2 * offy;
-  wbnd[0] = gbnd[0] - offx * dx;
-  wbnd[1] = gbnd[1] + offx * dx;
-  wbnd[2] = gbnd[2] - offy * dy;
-  wbnd[3] = gbnd[3] + offy * dy;
-  if (datatype == MBGRID_DATA_TOPOGRAPHY)
-    topofactor = -1.0;
-  else
-    topofactor = 1.0;
-  if (bathy_in_feet && (datatype == MBGRID_DATA_TOPOGRAPHY || datatype == MBGRID_DATA_BATHYMETRY))
-    topofactor = topofactor / 0.3048;
+      case 'G':
+      case 'g':
+        if (optarg[0] == '=') {
+          gridkind = MBGRID_GMTGRD;
+          strcpy(gridkindstring, optarg);
+        }
+        else {
+          int tmp;
+          int nscan = sscanf(optarg, "%d", &tmp);
+          // Range check
+          if (nscan == 1 && tmp >= 1 && tmp <= 4) {
+            gridkind = (grid_type_t)tmp;
+            if (gridkind == MBGRID_CDFGRD) {
+              gridkind = MBGRID_GMTGRD;
+              gridkindstring[0] = '\0';
+            }
+          } else if (optarg[0] == 'n' || optarg[0] == 'c' || optarg[0] == 'b'
+                    || optarg[0] == 'r' || optarg[0] == 's' || optarg[0] == 'a'
+                    || optarg[0] == 'e' || optarg[0] == 'g'){
+            snprintf(gridkindstring, sizeof(gridkindstring), "=%s", optarg);
+            gridkind = MBGRID_GMTGRD;
+          } else {
+            fprintf(stdout, "Invalid gridkind option: -G%s\n\n", optarg);
+            errflg = true;
+          }
+        }
+        break;
+      case 'H':
+      case 'h':
+        help = true;
+        break;
+      case 'I':
+      case 'i':
+        sscanf(optarg, "%1023s", filelist);
+        break;
+      case 'J':
+      case 'j':
+        sscanf(optarg, "%1023s", projection_pars);
+        projection_pars_f = true;
+        break;
+      case 'K':
+      case 'k':
+        sscanf(optarg, "%1023s", backgroundfile);
+        if ((grdrasterid = (int)strtol(backgroundfile, NULL, 10)) <= 0)
+          grdrasterid = -1;
+        break;
+      case 'L':
+      case 'l':
+        sscanf(optarg, "%d", &lonflip);
+        break;
+      case 'M':
+      case 'm':
+        more = true;
+        break;
+      case 'N':
+      case 'n':
+        use_NaN = true;
+        break;
+      case 'O':
+      case 'o':
+        sscanf(optarg, "%1023s", fileroot);
+        break;
+      case 'P':
+      case 'p':
+        sscanf(optarg, "%d", &pings);
+        break;
+      case 'Q':
+      case 'q':
+        bathy_in_feet = true;
+        break;
+      case 'R':
+      case 'r':
+        if (strchr(optarg, '/') == nullptr) {
+          sscanf(optarg, "%lf", &boundsfactor);
+          if (boundsfactor <= 1.0)
+            boundsfactor = 0.0;
+        }
+        else {
+          mb_get_bounds(optarg, gbnd);
+          gbndset = true;
+        }
+        break;
+      case 'S':
+      case 's':
+        sscanf(optarg, "%lf", &speedmin);
+        break;
+      case 'T':
+      case 't':
+        sscanf(optarg, "%lf", &tension);
+        break;
+      case 'U':
+      case 'u':
+        sscanf(optarg, "%lf", &timediff);
+        timediff = 60 * timediff;
+        check_time = true;
+        if (timediff < 0.0) {
+          timediff = fabs(timediff);
+          first_in_stays = false;
+        }
+        break;
+      case 'V':
+      case 'v':
+        verbose++;
+        if (verbose >= 2)
+          outfp = stderr;
+        break;
+      case 'W':
+      case 'w':
+        sscanf(optarg, "%lf", &scale);
+        break;
+      case 'X':
+      case 'x':
+        sscanf(optarg, "%lf", &extend);
+        break;
+      case 'Y':
+      case 'y':
+        if (int n = sscanf(optarg, "%lf/%lf", &shift_x, &shift_y) == 2) {
+          shift = true;
+        }
+        break;
+      case '?':
+        errflg = true;
+      }
+    }
 
-  /* check that dx == dy for Arc ascii grid output */
-  if (gridkind == MBGRID_ARCASCII && fabs(dx - dy) > MBGRID_TINY) {
-    fprintf(outfp, "\nArc Ascii grid output (-G4) requires square cells, but grid intervals dx:%f dy:%f differ...\n", dx, dy);
-    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-    exit(MB_ERROR_BAD_PARAMETER);
+    if (errflg) {
+      fprintf(outfp, "usage: %s\n", usage_message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      exit(MB_ERROR_BAD_USAGE);
+    }
+
+    if (verbose == 1 || help) {
+      fprintf(outfp, "\nProgram %s\n", program_name);
+      fprintf(outfp, "MB-system Version %s\n", MB_VERSION);
+    }
+
+    if (verbose >= 2) {
+      fprintf(outfp, "\ndbg2  Program <%s>\n", program_name);
+      fprintf(outfp, "dbg2  MB-system Version %s\n", MB_VERSION);
+      fprintf(outfp, "dbg2  Control Parameters:\n");
+      fprintf(outfp, "dbg2       verbose:              %d\n", verbose);
+      fprintf(outfp, "dbg2       help:                 %d\n", help);
+      fprintf(outfp, "dbg2       pings:                %d\n", pings);
+      fprintf(outfp, "dbg2       lonflip:              %d\n", lonflip);
+      fprintf(outfp, "dbg2       btime_i[0]:           %d\n", btime_i[0]);
+      fprintf(outfp, "dbg2       btime_i[1]:           %d\n", btime_i[1]);
+      fprintf(outfp, "dbg2       btime_i[2]:           %d\n", btime_i[2]);
+      fprintf(outfp, "dbg2       btime_i[3]:           %d\n", btime_i[3]);
+      fprintf(outfp, "dbg2       btime_i[4]:           %d\n", btime_i[4]);
+      fprintf(outfp, "dbg2       btime_i[5]:           %d\n", btime_i[5]);
+      fprintf(outfp, "dbg2       btime_i[6]:           %d\n", btime_i[6]);
+      fprintf(outfp, "dbg2       etime_i[0]:           %d\n", etime_i[0]);
+      fprintf(outfp, "dbg2       etime_i[1]:           %d\n", etime_i[1]);
+      fprintf(outfp, "dbg2       etime_i[2]:           %d\n", etime_i[2]);
+      fprintf(outfp, "dbg2       etime_i[3]:           %d\n", etime_i[3]);
+      fprintf(outfp, "dbg2       etime_i[4]:           %d\n", etime_i[4]);
+      fprintf(outfp, "dbg2       etime_i[5]:           %d\n", etime_i[5]);
+      fprintf(outfp, "dbg2       etime_i[6]:           %d\n", etime_i[6]);
+      fprintf(outfp, "dbg2       speedmin:             %f\n", speedmin);
+      fprintf(outfp, "dbg2       timegap:              %f\n", timegap);
+      fprintf(outfp, "dbg2       file list:            %s\n", filelist);
+      fprintf(outfp, "dbg2       output file root:     %s\n", fileroot);
+      fprintf(outfp, "dbg2       grid x dimension:     %d\n", xdim);
+      fprintf(outfp, "dbg2       grid y dimension:     %d\n", ydim);
+      fprintf(outfp, "dbg2       grid bounds[0]:       %f\n", gbnd[0]);
+      fprintf(outfp, "dbg2       grid bounds[1]:       %f\n", gbnd[1]);
+      fprintf(outfp, "dbg2       grid bounds[2]:       %f\n", gbnd[2]);
+      fprintf(outfp, "dbg2       grid bounds[3]:       %f\n", gbnd[3]);
+      fprintf(outfp, "dbg2       boundsfactor:         %f\n", boundsfactor);
+      fprintf(outfp, "dbg2       clipmode:             %d\n", clipmode);
+      fprintf(outfp, "dbg2       clip:                 %d\n", clip);
+      fprintf(outfp, "dbg2       tension:              %f\n", tension);
+      fprintf(outfp, "dbg2       grdraster background: %d\n", grdrasterid);
+      fprintf(outfp, "dbg2       backgroundfile:       %s\n", backgroundfile);
+      fprintf(outfp, "dbg2       more:                 %d\n", more);
+      fprintf(outfp, "dbg2       use_NaN:              %d\n", use_NaN);
+      fprintf(outfp, "dbg2       grid_mode:            %d\n", grid_mode);
+      fprintf(outfp, "dbg2       data type:            %d\n", datatype);
+      fprintf(outfp, "dbg2       grid format:          %d\n", gridkind);
+      if (gridkind == MBGRID_GMTGRD)
+        fprintf(outfp, "dbg2       gmt grid format id:   %s\n", gridkindstring);
+      fprintf(outfp, "dbg2       scale:                %f\n", scale);
+      fprintf(outfp, "dbg2       timediff:             %f\n", timediff);
+      fprintf(outfp, "dbg2       setborder:            %d\n", setborder);
+      fprintf(outfp, "dbg2       border:               %f\n", border);
+      fprintf(outfp, "dbg2       extend:               %f\n", extend);
+      fprintf(outfp, "dbg2       shift:                %d\n", shift);
+      fprintf(outfp, "dbg2       shift_x:              %f\n", shift_x);
+      fprintf(outfp, "dbg2       shift_y:              %f\n", shift_y);
+      fprintf(outfp, "dbg2       bathy_in_feet:        %d\n", bathy_in_feet);
+      fprintf(outfp, "dbg2       projection_pars:      %s\n", projection_pars);
+      fprintf(outfp, "dbg2       proj flag 1:          %d\n", projection_pars_f);
+      fprintf(outfp, "dbg2       projection_id:        %s\n", projection_id);
+      // fprintf(outfp, "dbg2       utm_zone:             %d\n", utm_zone);
+      fprintf(outfp, "dbg2       minormax_weighted_mean_threshold: %f\n", minormax_weighted_mean_threshold);
+      fprintf(outfp, "dbg2       n_threads:            %u\n", n_threads);
+      fprintf(outfp, "dbg2       median_percentile:    %f\n", median_percentile);
+      fprintf(outfp, "dbg2       median_memory:        %d\n", median_memory);
+
+    }
+
+    if (help) {
+      fprintf(outfp, "\n%s\n", help_message);
+      fprintf(outfp, "\nusage: %s\n", usage_message);
+      exit(MB_ERROR_NO_ERROR);
+    }
   }
 
-  /* get data input bounds in lon lat */
-  if (!use_projection) {
-    bounds[0] = wbnd[0];
-    bounds[1] = wbnd[1];
-    bounds[2] = wbnd[2];
-    bounds[3] = wbnd[3];
+  int error = MB_ERROR_NO_ERROR;
+  int memclear_error = MB_ERROR_NO_ERROR;
+
+  /* parallel gridding is supported for the weighted mean, footprint and
+     min/max filter algorithms, but not with the time overlap check, which
+     those algorithms do with a single gridding thread - the surface spline
+     interpolation uses all threads regardless */
+#ifdef USESURFACE
+  const unsigned int n_threads_spline = n_threads;
+#endif
+  if (n_threads > 1
+      && (check_time
+          || (grid_mode != MBGRID_WEIGHTED_MEAN && grid_mode != MBGRID_WEIGHTED_FOOTPRINT
+              && grid_mode != MBGRID_MINIMUM_FILTER && grid_mode != MBGRID_MAXIMUM_FILTER))) {
+    fprintf(outfp, "\nParallel gridding not supported with this gridding algorithm or with -U, using one thread\n");
+    n_threads = 1;
   }
-  /* get min max of lon lat for data input from projected bounds */
-  else {
-    /* do first point */
-    xx = wbnd[0] - 0.05 * (wbnd[1] - wbnd[0]);
-    yy = wbnd[2] - 0.05 * (wbnd[3] - wbnd[2]);
-    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-    mb_apply_lonflip(verbose, lonflip, &xlon);
-    bounds[0] = xlon;
-    bounds[1] = xlon;
-    bounds[2] = ylat;
-    bounds[3] = ylat;
 
-    /* do second point */
-    xx = wbnd[1] + 0.05 * (wbnd[1] - wbnd[0]);
-    yy = wbnd[2] - 0.05 * (wbnd[3] - wbnd[2]);
-    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-    mb_apply_lonflip(verbose, lonflip, &xlon);
-    bounds[0] = std::min(bounds[0], xlon);
-    bounds[1] = std::max(bounds[1], xlon);
-    bounds[2] = std::min(bounds[2], ylat);
-    bounds[3] = std::max(bounds[3], ylat);
+  /* if bounds not set get bounds of input data */
+  if (!gbndset || (!set_spacing && !set_dimensions)) {
+    struct mb_info_struct mb_info;
+    int formatread = -1;
+    status = mb_get_info_datalist(verbose, filelist, &formatread, &mb_info, lonflip, &error);
 
-    /* do third point */
-    xx = wbnd[0] - 0.05 * (wbnd[1] - wbnd[0]);
-    yy = wbnd[3] + 0.05 * (wbnd[3] - wbnd[2]);
-    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-    mb_apply_lonflip(verbose, lonflip, &xlon);
-    bounds[0] = std::min(bounds[0], xlon);
-    bounds[1] = std::max(bounds[1], xlon);
-    bounds[2] = std::min(bounds[2], ylat);
-    bounds[3] = std::max(bounds[3], ylat);
+    if (!gbndset) {
+      gbnd[0] = mb_info.lon_min;
+      gbnd[1] = mb_info.lon_max;
+      gbnd[2] = mb_info.lat_min;
+      gbnd[3] = mb_info.lat_max;
+      // gbndset = true;
+    }
 
-    /* do fourth point */
-    xx = wbnd[1] + 0.05 * (wbnd[1] - wbnd[0]);
-    yy = wbnd[3] + 0.05 * (wbnd[3] - wbnd[2]);
-    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
-    mb_apply_lonflip(verbose, lonflip, &xlon);
-    bounds[0] = std::min(bounds[0], xlon);
-    bounds[1] = std::max(bounds[1], xlon);
-    bounds[2] = std::min(bounds[2], ylat);
-    bounds[3] = std::max(bounds[3], ylat);
+    if (!set_spacing && !set_dimensions) {
+      dx_set = 0.02 * mb_info.altitude_max;
+      dy_set = 0.02 * mb_info.altitude_max;
+      set_spacing = true;
+      strcpy(units, "meters");
+    }
   }
 
-  /* extend the bounds slightly to be sure no data gets missed */
-  xx = std::min(0.05 * (bounds[1] - bounds[0]), 0.1);
-  yy = std::min(0.05 * (bounds[3] - bounds[2]), 0.1);
-  bounds[0] = bounds[0] - xx;
-  bounds[1] = bounds[1] + xx;
-  bounds[2] = bounds[2] - yy;
-  bounds[3] = bounds[3] + yy;
+  double btime_d;
+  double etime_d;
+  int beams_bath;
+  int beams_amp;
+  int pixels_ss;
+  char file[MB_PATH_MAXLINE] = "";
+  void *mbio_ptr = nullptr;
+  struct mb_io_struct *mb_io_ptr = nullptr;
+  int topo_type;
 
-  /* figure out lonflip for data bounds */
-  if (bounds[0] < -180.0)
-    lonflip = -1;
-  else if (bounds[1] > 180.0)
-    lonflip = 1;
-  else if (lonflip == -1 && bounds[1] > 0.0)
-    lonflip = 0;
-  else if (lonflip == 1 && bounds[0] < 0.0)
-    lonflip = 0;
+  /* mbgrid control variables */
+  void *datalist;
+  double file_weight;
+  double dx = 0.0;
+  double dy = 0.0;
+  double clipvalue = NO_DATA_FLAG;
+  float outclipvalue = NO_DATA_FLAG;
+  int rformat;
+  int pstatus;
+  char path[MB_PATH_MAXLINE] = "";
+  char ppath[MB_PATH_MAXLINE] = "";
+  char dpath[MB_PATH_MAXLINE] = "";
+  char rfile[MB_PATH_MAXLINE] = "";
+  char ofile[2*MB_PATH_MAXLINE+100] = "";
+  char dfile[MB_PATH_MAXLINE] = "";
+  char plot_cmd[(8*1024)] = "";
+  int plot_status;
 
-  /* check interpolation parameters */
-  if ((clipmode == MBGRID_INTERP_GAP || clipmode == MBGRID_INTERP_NEAR) && clip > xdim && clip > ydim)
-    clipmode = MBGRID_INTERP_ALL;
-  if (clipmode == MBGRID_INTERP_ALL)
-    clip = std::max(xdim, ydim);
+  /* mbio read values */
+  int rpings;
+  int kind;
+  int time_i[7];
+  double time_d;
+  double navlon;
+  double navlat;
+  double speed;
+  double heading;
+  double distance;
+  double altitude;
+  double sonardepth;
+  char *beamflag = nullptr;
+  double *bath = nullptr;
+  double *bathlon = nullptr;
+  double *bathlat = nullptr;
+  double *amp = nullptr;
+  double *ss = nullptr;
+  double *sslon = nullptr;
+  double *sslat = nullptr;
+  char comment[MB_COMMENT_MAXLINE];
 
-  /* set origin used to reduce data value size before conversion from
-   * double to float when calling the interpolation routines */
-  bdata_origin_x = 0.5 * (wbnd[0] + wbnd[1]);
-  bdata_origin_y = 0.5 * (wbnd[2] + wbnd[3]);
+  /* lon,lat,value triples variables */
+  double tlon;
+  double tlat;
+  double tvalue;
 
-  /* set plot label strings */
-  if (use_projection) {
-    snprintf(xlabel, sizeof(xlabel), "Easting (%s)", units);
-    snprintf(ylabel, sizeof(ylabel), "Northing (%s)", units);
-  }
-  else {
-    strcpy(xlabel, "Longitude");
-    strcpy(ylabel, "Latitude");
-  }
-  if (datatype == MBGRID_DATA_BATHYMETRY) {
-    if (bathy_in_feet)
-      strcpy(zlabel, "Depth (ft)");
-    else
-      strcpy(zlabel, "Depth (m)");
-    strcpy(nlabel, "Number of Depth Data Points");
-    if (bathy_in_feet)
-      strcpy(sdlabel, "Depth Standard Deviation (ft)");
-    else
-      strcpy(sdlabel, "Depth Standard Deviation (m)");
-    strcpy(title, "Bathymetry Grid");
+  /* grid variables */
+  double wbnd[4], obnd[4];
+  double xlon, ylat, xx, yy;
+  double factor, weight, topofactor;
+  int offx, offy, xtradim;
+  double *grid = nullptr;
+  double *norm = nullptr;
+  double *sigma = nullptr;
+  double *firsttime = nullptr;
+  double *gridsmall = nullptr;
+  double *minormax = nullptr;
+#ifdef USESURFACE
+  float *bxdata = nullptr;
+  float *bydata = nullptr;
+  float *bzdata = nullptr;
+  float *sxdata = nullptr;
+  float *sydata = nullptr;
+  float *szdata = nullptr;
+#else
+  float *bdata = nullptr;
+  float *sdata = nullptr;
+  float *work1 = nullptr;
+  int *work2 = nullptr;
+  bool *work3 = nullptr;
+#endif
+  double bdata_origin_x, bdata_origin_y;
+  float *output = nullptr;
+  float *sgrid = nullptr;
+  int *cnt = nullptr;
+  int *num = nullptr;
+  int ndata, ndatafile, nbackground;
+  double zmin, zmax, zclip;
+  int nmax;
+  double smin, smax;
+  int nbinset, nbinzero, nbinspline, nbinbackground;
+
+  /* projected grid parameters */
+  void *pjptr;
+  double deglontokm, deglattokm;
+  double mtodeglon, mtodeglat;
+
+  /* output char strings */
+  char xlabel[MB_PATH_MAXLINE+20] = "";
+  char ylabel[MB_PATH_MAXLINE+20] = "";
+  char zlabel[MB_PATH_MAXLINE+20] = "";
+  char title[MB_PATH_MAXLINE] = "";
+  char nlabel[MB_PATH_MAXLINE] = "";
+  char sdlabel[MB_PATH_MAXLINE] = "";
+
+  /* other variables */
+  FILE *dfp = nullptr;
+  FILE *rfp = nullptr;
+  int kgrid, kout, kint, ib, ix, iy;
+  int ix1, ix2, iy1, iy2;
+
+  double foot_dx, foot_dy, foot_dxn, foot_dyn;
+  double foot_lateral, beam_altitude, foot_range, foot_theta;
+  double foot_dtheta, foot_dphi;
+  double foot_hwidth, foot_hlength;
+  int foot_wix, foot_wiy, foot_lix, foot_liy, foot_dix, foot_diy;
+  double sbath;
+  double xx0, yy0, bdx, bdy, xx1, xx2, yy1, yy2;
+  double prx[5], pry[5];
+  grid_use_t use_weight;
+
+  int gxdim = 0;
+  int gydim = 0;
+
+  /* if requested expand the grid bounds */
+  if (boundsfactor > 1.0) {
+    xx1 = 0.5 * (boundsfactor - 1.0) * (gbnd[1] - gbnd[0]);
+    yy1 = 0.5 * (boundsfactor - 1.0) * (gbnd[3] - gbnd[2]);
+    gbnd[0] -= xx1;
+    gbnd[1] += xx1;
+    gbnd[2] -= yy1;
+    gbnd[3] += yy1;
   }
-  else if (datatype == MBGRID_DATA_TOPOGRAPHY) {
-    if (bathy_in_feet)
-      strcpy(zlabel, "Topography (ft)");
-    else
-      strcpy(zlabel, "Topography (m)");
-    strcpy(nlabel, "Number of Topography Data Points");
-    if (bathy_in_feet)
-      strcpy(sdlabel, "Topography Standard Deviation (ft)");
-    else
-      strcpy(sdlabel, "Topography Standard Deviation (m)");
-    strcpy(title, "Topography Grid");
+
+  /* if bounds not specified then quit */
+  if (gbnd[0] >= gbnd[1] || gbnd[2] >= gbnd[3]) {
+    fprintf(outfp, "\nGrid bounds not properly specified:\n\t%f %f %f %f\n", gbnd[0], gbnd[1], gbnd[2], gbnd[3]);
+    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+    exit(MB_ERROR_BAD_PARAMETER);
   }
-  else if (datatype == MBGRID_DATA_AMPLITUDE) {
-    strcpy(zlabel, "Amplitude");
-    strcpy(nlabel, "Number of Amplitude Data Points");
-    strcpy(sdlabel, "Amplitude Standard Deviation (m)");
-    strcpy(title, "Amplitude Grid");
+
+  /* footprint option only for bathymetry */
+  if ((grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE || grid_mode == MBGRID_WEIGHTED_FOOTPRINT) &&
+      (datatype != MBGRID_DATA_TOPOGRAPHY && datatype != MBGRID_DATA_BATHYMETRY)) {
+    grid_mode = MBGRID_WEIGHTED_MEAN;
   }
-  else if (datatype == MBGRID_DATA_SIDESCAN) {
-    strcpy(zlabel, "Sidescan");
-    strcpy(nlabel, "Number of Sidescan Data Points");
-    strcpy(sdlabel, "Sidescan Standard Deviation (m)");
-    strcpy(title, "Sidescan Grid");
+
+  /* more option not available with minimum
+      or maximum filter algorithms */
+  if (more && (grid_mode == MBGRID_MINIMUM_FILTER || grid_mode == MBGRID_MAXIMUM_FILTER))
+    more = false;
+
+  /* NaN cannot be used for ASCII grids */
+  if (use_NaN && (gridkind == MBGRID_ASCII || gridkind == MBGRID_ARCASCII))
+    use_NaN = false;
+
+  /* define NaN in case it's needed */
+  if (use_NaN) {
+    outclipvalue = std::numeric_limits<float>::quiet_NaN();
   }
 
-  /* output info */
-  if (verbose >= 0) {
-    fprintf(outfp, "\nMBGRID Parameters:\n");
-    fprintf(outfp, "List of input files: %s\n", filelist);
-    fprintf(outfp, "Output fileroot:     %s\n", fileroot);
-    fprintf(outfp, "Input Data Type:     ");
-    if (datatype == MBGRID_DATA_BATHYMETRY) {
-      fprintf(outfp, "Bathymetry\n");
-      if (bathy_in_feet)
-        fprintf(outfp, "Bathymetry gridded in feet\n");
-    }
-    else if (datatype == MBGRID_DATA_TOPOGRAPHY) {
-      fprintf(outfp, "Topography\n");
-      if (bathy_in_feet)
-        fprintf(outfp, "Topography gridded in feet\n");
+  bool use_projection = false;
+
+  /* deal with projected gridding */
+  if (projection_pars_f) {
+    /* check for UTM with undefined zone */
+    if (strcmp(projection_pars, "UTM") == 0 || strcmp(projection_pars, "U") == 0 || strcmp(projection_pars, "utm") == 0 ||
+        strcmp(projection_pars, "u") == 0) {
+      double reference_lon = 0.5 * (gbnd[0] + gbnd[1]);
+      if (reference_lon < 180.0)
+        reference_lon += 360.0;
+      if (reference_lon >= 180.0)
+        reference_lon -= 360.0;
+      const int utm_zone = (int)(((reference_lon + 183.0) / 6.0) + 0.5);
+      double reference_lat = 0.5 * (gbnd[2] + gbnd[3]);
+      if (reference_lat >= 0.0)
+        snprintf(projection_id, sizeof(projection_id), "UTM%2.2dN", utm_zone);
+      else
+        snprintf(projection_id, sizeof(projection_id), "UTM%2.2dS", utm_zone);
     }
-    else if (datatype == MBGRID_DATA_AMPLITUDE)
-      fprintf(outfp, "Amplitude\n");
-    else if (datatype == MBGRID_DATA_SIDESCAN)
-      fprintf(outfp, "Sidescan\n");
-    else
-      fprintf(outfp, "Unknown?\n");
-    fprintf(outfp, "Gridding algorithm:  ");
-    if (grid_mode == MBGRID_MEDIAN_FILTER)
-      fprintf(outfp, "Median Filter\n");
-    else if (grid_mode == MBGRID_MINIMUM_FILTER)
-      fprintf(outfp, "Minimum Filter\n");
-    else if (grid_mode == MBGRID_MAXIMUM_FILTER)
-      fprintf(outfp, "Maximum Filter\n");
-    else if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE)
-      fprintf(outfp, "Footprint-Slope Weighted Mean\n");
-    else if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT)
-      fprintf(outfp, "Footprint Weighted Mean\n");
-    else if (grid_mode == MBGRID_MINIMUM_WEIGHTED_MEAN)
-      fprintf(outfp, "Minimum Gaussian Weighted Mean\n");
-    else if (grid_mode == MBGRID_MAXIMUM_WEIGHTED_MEAN)
-      fprintf(outfp, "Maximum Gaussian Weighted Mean\n");
     else
-      fprintf(outfp, "Gaussian Weighted Mean\n");
-    fprintf(outfp, "Grid projection: %s\n", projection_id);
-    if (use_projection) {
-      fprintf(outfp, "Projection ID: %s\n", projection_id);
+      strcpy(projection_id, projection_pars);
+
+    /* set projection flag */
+    use_projection = true;
+    const int proj_status = mb_proj_init(verbose, projection_id, &(pjptr), &error);
+
+    /* if projection not successfully initialized then quit */
+    if (proj_status != MB_SUCCESS) {
+      fprintf(outfp, "\nOutput projection %s not found in database\n", projection_id);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_BAD_PARAMETER);
     }
-    fprintf(outfp, "Grid dimensions: %d %d\n", xdim, ydim);
-    fprintf(outfp, "Grid bounds:\n");
-    if (use_projection) {
-      fprintf(outfp, "  Eastings:  %9.4f %9.4f\n", gbnd[0], gbnd[1]);
-      fprintf(outfp, "  Northings: %9.4f %9.4f\n", gbnd[2], gbnd[3]);
-      fprintf(outfp, "  Longitude: %9.4f %9.4f\n", obnd[0], obnd[1]);
-      fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", obnd[2], obnd[3]);
+
+    /* translate lon lat bounds from UTM if required */
+    if (gbnd[0] < -360.0 || gbnd[0] > 360.0 || gbnd[1] < -360.0 || gbnd[1] > 360.0 || gbnd[2] < -90.0 || gbnd[2] > 90.0 ||
+        gbnd[3] < -90.0 || gbnd[3] > 90.0) {
+      /* first point */
+      xx = gbnd[0];
+      yy = gbnd[2];
+      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+      mb_apply_lonflip(verbose, lonflip, &xlon);
+      obnd[0] = xlon;
+      obnd[1] = xlon;
+      obnd[2] = ylat;
+      obnd[3] = ylat;
+
+      /* second point */
+      xx = gbnd[1];
+      yy = gbnd[2];
+      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+      mb_apply_lonflip(verbose, lonflip, &xlon);
+      obnd[0] = std::min(obnd[0], xlon);
+      obnd[1] = std::max(obnd[1], xlon);
+      obnd[2] = std::min(obnd[2], ylat);
+      obnd[3] = std::max(obnd[3], ylat);
+
+      /* third point */
+      xx = gbnd[0];
+      yy = gbnd[3];
+      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+      mb_apply_lonflip(verbose, lonflip, &xlon);
+      obnd[0] = std::min(obnd[0], xlon);
+      obnd[1] = std::max(obnd[1], xlon);
+      obnd[2] = std::min(obnd[2], ylat);
+      obnd[3] = std::max(obnd[3], ylat);
+
+      /* fourth point */
+      xx = gbnd[1];
+      yy = gbnd[3];
+      mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+      mb_apply_lonflip(verbose, lonflip, &xlon);
+      obnd[0] = std::min(obnd[0], xlon);
+      obnd[1] = std::max(obnd[1], xlon);
+      obnd[2] = std::min(obnd[2], ylat);
+      obnd[3] = std::max(obnd[3], ylat);
     }
+
+    /* else translate bounds to UTM */
     else {
-      fprintf(outfp, "  Longitude: %9.4f %9.4f\n", gbnd[0], gbnd[1]);
-      fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", gbnd[2], gbnd[3]);
+      /* copy gbnd to obnd */
+      obnd[0] = gbnd[0];
+      obnd[1] = gbnd[1];
+      obnd[2] = gbnd[2];
+      obnd[3] = gbnd[3];
+
+      /* first point */
+      xlon = obnd[0];
+      ylat = obnd[2];
+      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
+      gbnd[0] = xx;
+      gbnd[1] = xx;
+      gbnd[2] = yy;
+      gbnd[3] = yy;
+
+      /* second point */
+      xlon = obnd[1];
+      ylat = obnd[2];
+      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
+      gbnd[0] = std::min(gbnd[0], xx);
+      gbnd[1] = std::max(gbnd[1], xx);
+      gbnd[2] = std::min(gbnd[2], yy);
+      gbnd[3] = std::max(gbnd[3], yy);
+
+      /* third point */
+      xlon = obnd[0];
+      ylat = obnd[3];
+      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
+      gbnd[0] = std::min(gbnd[0], xx);
+      gbnd[1] = std::max(gbnd[1], xx);
+      gbnd[2] = std::min(gbnd[2], yy);
+      gbnd[3] = std::max(gbnd[3], yy);
+
+      /* fourth point */
+      xlon = obnd[1];
+      ylat = obnd[3];
+      mb_proj_forward(verbose, pjptr, xlon, ylat, &xx, &yy, &error);
+      gbnd[0] = std::min(gbnd[0], xx);
+      gbnd[1] = std::max(gbnd[1], xx);
+      gbnd[2] = std::min(gbnd[2], yy);
+      gbnd[3] = std::max(gbnd[3], yy);
     }
-    if (boundsfactor > 1.0)
-      fprintf(outfp, "  Grid bounds correspond to %f times actual data coverage\n", boundsfactor);
-    fprintf(outfp, "Working grid dimensions: %d %d\n", gxdim, gydim);
-    if (use_projection) {
-      fprintf(outfp, "Working Grid bounds:\n");
-      fprintf(outfp, "  Eastings:  %9.4f %9.4f\n", wbnd[0], wbnd[1]);
-      fprintf(outfp, "  Northings: %9.4f %9.4f\n", wbnd[2], wbnd[3]);
-      fprintf(outfp, "Easting interval:  %f %s\n", dx, units);
-      fprintf(outfp, "Northing interval: %f %s\n", dy, units);
-      if (set_spacing) {
-        fprintf(outfp, "Specified Easting interval:  %f %s\n", dx_set, units);
-        fprintf(outfp, "Specified Northing interval: %f %s\n", dy_set, units);
+
+    /* get local scaling of lon lat */
+    mb_coor_scale(verbose, 0.5 * (obnd[2] + obnd[3]), &mtodeglon, &mtodeglat);
+    deglontokm = 0.001 / mtodeglon;
+    deglattokm = 0.001 / mtodeglat;
+
+    /* calculate grid properties */
+    if (set_spacing) {
+      xdim = lrint((gbnd[1] - gbnd[0]) / dx_set + 1);
+      if (dy_set <= 0.0)
+        dy_set = dx_set;
+      ydim = lrint((gbnd[3] - gbnd[2]) / dy_set + 1);
+      if (spacing_priority) {
+        gbnd[1] = gbnd[0] + dx_set * (xdim - 1);
+        gbnd[3] = gbnd[2] + dy_set * (ydim - 1);
       }
-    }
-    else {
-      fprintf(outfp, "Working Grid bounds:\n");
-      fprintf(outfp, "  Longitude: %9.4f %9.4f\n", wbnd[0], wbnd[1]);
-      fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", wbnd[2], wbnd[3]);
-      fprintf(outfp, "Longitude interval: %f degrees or %f m\n", dx, 1000 * dx * deglontokm);
-      fprintf(outfp, "Latitude interval:  %f degrees or %f m\n", dy, 1000 * dy * deglattokm);
-      if (set_spacing) {
-        fprintf(outfp, "Specified Longitude interval: %f %s\n", dx_set, units);
-        fprintf(outfp, "Specified Latitude interval:  %f %s\n", dy_set, units);
+      if (units[0] == 'M' || units[0] == 'm')
+        strcpy(units, "meters");
+      else if (units[0] == 'K' || units[0] == 'k')
+        strcpy(units, "km");
+      else if (units[0] == 'F' || units[0] == 'f')
+        strcpy(units, "feet");
+      else if (strncmp(units, "arcmin", 6) == 0) {
+        dx_set = dx_set / 60.0;
+        dy_set = dy_set / 60.0;
+        strcpy(units, "degrees");
+      }
+      else if (strncmp(units, "arcsec", 6) == 0) {
+        dx_set = dx_set / 3600.0;
+        dy_set = dy_set / 3600.0;
+        strcpy(units, "degrees");
       }
+      else
+        strcpy(units, "unknown");
     }
-    if (shift && use_projection) {
-      fprintf(outfp, "Grid shift (applied to the bounds of output grids):\n");
-      fprintf(outfp, "  East shift:   %9.4f m\n", shift_x);
-      fprintf(outfp, "  North shift:  %9.4f m\n", shift_y);
+  }
+
+  /* deal with no projection */
+  else {
+    /* get local scaling of lon lat */
+    mb_coor_scale(verbose, 0.5 * (gbnd[2] + gbnd[3]), &mtodeglon, &mtodeglat);
+    deglontokm = 0.001 / mtodeglon;
+    deglattokm = 0.001 / mtodeglat;
+
+    /* calculate grid properties */
+    if (set_spacing && (units[0] == 'M' || units[0] == 'm')) {
+      xdim = lrint((gbnd[1] - gbnd[0]) / (mtodeglon * dx_set) + 1);
+      if (dy_set <= 0.0)
+        dy_set = mtodeglon * dx_set / mtodeglat;
+      ydim = lrint((gbnd[3] - gbnd[2]) / (mtodeglat * dy_set) + 1);
+      if (spacing_priority) {
+        gbnd[1] = gbnd[0] + mtodeglon * dx_set * (xdim - 1);
+        gbnd[3] = gbnd[2] + mtodeglat * dy_set * (ydim - 1);
+      }
+      strcpy(units, "meters");
     }
-    else if (shift) {
-      fprintf(outfp, "Grid shift (applied to the bounds of output grids):\n");
-      fprintf(outfp, "  Longitude interval: %f degrees or %f m\n", shift_x * mtodeglon, shift_x);
-      fprintf(outfp, "  Latitude interval:  %f degrees or %f m\n", shift_y * mtodeglat, shift_y);
+    else if (set_spacing && (units[0] == 'K' || units[0] == 'k')) {
+      xdim = lrint((gbnd[1] - gbnd[0]) * deglontokm / dx_set + 1);
+      if (dy_set <= 0.0)
+        dy_set = deglattokm * dx_set / deglontokm;
+      ydim = lrint((gbnd[3] - gbnd[2]) * deglattokm / dy_set + 1);
+      if (spacing_priority) {
+        gbnd[1] = gbnd[0] + dx_set * (xdim - 1) / deglontokm;
+        gbnd[3] = gbnd[2] + dy_set * (ydim - 1) / deglattokm;
+      }
+      strcpy(units, "km");
     }
-    fprintf(outfp, "Input data bounds:\n");
-    fprintf(outfp, "  Longitude: %9.4f %9.4f\n", bounds[0], bounds[1]);
-    fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", bounds[2], bounds[3]);
-    if (grid_mode == MBGRID_WEIGHTED_MEAN)
-      fprintf(outfp, "Gaussian filter 1/e length: %f grid intervals\n", scale);
-    if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE || grid_mode == MBGRID_WEIGHTED_FOOTPRINT)
-      fprintf(outfp, "Footprint 1/e distance: %f times footprint\n", scale);
-    if (grid_mode == MBGRID_MINIMUM_WEIGHTED_MEAN)
-      fprintf(outfp, "Minimum filter threshold for Minimum Weighted Mean: %f\n", minormax_weighted_mean_threshold);
-    if (check_time && !first_in_stays)
-      fprintf(outfp, "Swath overlap handling:       Last data used\n");
-    if (check_time && first_in_stays)
-      fprintf(outfp, "Swath overlap handling:       First data used\n");
-    if (check_time)
-      fprintf(outfp, "Swath overlap time threshold: %f minutes\n", timediff / 60.);
-    if (clipmode == MBGRID_INTERP_NONE)
-      fprintf(outfp, "Spline interpolation not applied\n");
-    else if (clipmode == MBGRID_INTERP_GAP) {
-      fprintf(outfp, "Spline interpolation applied to fill data gaps\n");
-      fprintf(outfp, "Spline interpolation clipping dimension: %d\n", clip);
-      fprintf(outfp, "Spline tension (range 0.0 to infinity): %f\n", tension);
-    }
-    else if (clipmode == MBGRID_INTERP_NEAR) {
-      fprintf(outfp, "Spline interpolation applied near data\n");
-      fprintf(outfp, "Spline interpolation clipping dimension: %d\n", clip);
-      fprintf(outfp, "Spline tension (range 0.0 to infinity): %f\n", tension);
-    }
-    else if (clipmode == MBGRID_INTERP_ALL) {
-      fprintf(outfp, "Spline interpolation applied to fill entire grid\n");
-      fprintf(outfp, "Spline tension (range 0.0 to infinity): %f\n", tension);
+    else if (set_spacing && (units[0] == 'F' || units[0] == 'f')) {
+      xdim = lrint((gbnd[1] - gbnd[0]) / (mtodeglon * 0.3048 * dx_set) + 1);
+      if (dy_set <= 0.0)
+        dy_set = mtodeglon * dx_set / mtodeglat;
+      ydim = lrint((gbnd[3] - gbnd[2]) / (mtodeglat * 0.3048 * dy_set) + 1);
+      if (spacing_priority) {
+        gbnd[1] = gbnd[0] + mtodeglon * 0.3048 * dx_set * (xdim - 1);
+        gbnd[3] = gbnd[2] + mtodeglat * 0.3048 * dy_set * (ydim - 1);
+      }
+      strcpy(units, "feet");
     }
-    if (grdrasterid == 0)
-      fprintf(outfp, "Background not applied\n");
-    else if (grdrasterid < 0)
-      fprintf(outfp, "Background obtained using grd2xyz from GMT grid file: %s\n", backgroundfile);
-    else
-      fprintf(outfp, "Background obtained using grdraster from dataset: %d\n", grdrasterid);
-    if (gridkind == MBGRID_ASCII)
-      fprintf(outfp, "Grid format %d:  ascii table\n", gridkind);
-    else if (gridkind == MBGRID_CDFGRD)
-      fprintf(outfp, "Grid format %d:  GMT version 2 grd (netCDF)\n", gridkind);
-    else if (gridkind == MBGRID_OLDGRD)
-      fprintf(outfp, "Grid format %d:  GMT version 1 grd (binary)\n", gridkind);
-    else if (gridkind == MBGRID_ARCASCII)
-      fprintf(outfp, "Grid format %d:  Arc/Info ascii table\n", gridkind);
-    else if (gridkind == MBGRID_GMTGRD) {
-      fprintf(outfp, "Grid format %d:  GMT grid\n", gridkind);
-      if (strlen(gridkindstring) > 0)
-        fprintf(outfp, "GMT Grid ID:     %s\n", gridkindstring);
+    else if (set_spacing) {
+      if (strncmp(units, "arcmin", 6) == 0) {
+        dx_set = dx_set / 60.0;
+        dy_set = dy_set / 60.0;
+        strcpy(units, "degrees");
+      }
+      else if (strncmp(units, "arcsec", 6) == 0) {
+        dx_set = dx_set / 3600.0;
+        dy_set = dy_set / 3600.0;
+        strcpy(units, "degrees");
+      }
+      else
+        strcpy(units, "degrees");
+      xdim = lrint((gbnd[1] - gbnd[0]) / dx_set + 1);
+      if (dy_set <= 0.0)
+        dy_set = dx_set;
+      ydim = lrint((gbnd[3] - gbnd[2]) / dy_set + 1);
+      if (spacing_priority) {
+        gbnd[1] = gbnd[0] + dx_set * (xdim - 1);
+        gbnd[3] = gbnd[2] + dy_set * (ydim - 1);
+      }
     }
-    if (use_NaN)
-      fprintf(outfp, "NaN values used to flag regions with no data\n");
-    else
-      fprintf(outfp, "Real value of %f used to flag regions with no data\n", outclipvalue);
-    if (more)
-      fprintf(outfp, "Data density and sigma grids also created\n");
-    fprintf(outfp, "MBIO parameters:\n");
-    fprintf(outfp, "  Ping averaging:       %d\n", pings);
-    fprintf(outfp, "  Longitude flipping:   %d\n", lonflip);
-    fprintf(outfp, "  Speed minimum:      %4.1f km/hr\n", speedmin);
   }
-  if (verbose > 0)
-    fprintf(outfp, "\n");
 
-  /* if grdrasterid set extract background data
-      and interpolate it later onto internal grid */
-  if (grdrasterid != 0) {
-    if (grdrasterid > 0)
-      fprintf(outfp, "\nExtracting background from grdraster dataset %d...\n", grdrasterid);
-    else
-      fprintf(outfp, "\nExtracting background from grid file %s...\n", backgroundfile);
+  /* calculate other grid properties */
+  dx = (gbnd[1] - gbnd[0]) / (xdim - 1);
+  dy = (gbnd[3] - gbnd[2]) / (ydim - 1);
+  factor = 4.0 / (scale * scale * dx * dy);
+  offx = 0;
+  offy = 0;
+  if (extend > 0.0) {
+    offx = (int)(extend * xdim);
+    offy = (int)(extend * ydim);
+  }
+  xtradim = scale + 2;
+  gxdim = xdim + 2 * offx;
+  gydim = ydim + 2 * offy;
+  wbnd[0] = gbnd[0] - offx * dx;
+  wbnd[1] = gbnd[1] + offx * dx;
+  wbnd[2] = gbnd[2] - offy * dy;
+  wbnd[3] = gbnd[3] + offy * dy;
+  if (datatype == MBGRID_DATA_TOPOGRAPHY)
+    topofactor = -1.0;
+  else
+    topofactor = 1.0;
+  if (bathy_in_feet && (datatype == MBGRID_DATA_TOPOGRAPHY || datatype == MBGRID_DATA_BATHYMETRY))
+    topofactor = topofactor / 0.3048;
 
-    /* guess about twice the data actually expected */
-    int nbackground_alloc = 2 * gxdim * gydim;
+  /* check that dx == dy for Arc ascii grid output */
+  if (gridkind == MBGRID_ARCASCII && fabs(dx - dy) > MBGRID_TINY) {
+    fprintf(outfp, "\nArc Ascii grid output (-G4) requires square cells, but grid intervals dx:%f dy:%f differ...\n", dx, dy);
+    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+    exit(MB_ERROR_BAD_PARAMETER);
+  }
 
-/* allocate and initialize background data arrays */
-#ifdef USESURFACE
-    status = mb_mallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bxdata, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bydata, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bzdata, &error);
-    if (error != MB_ERROR_NO_ERROR) {
-      char *message = nullptr;
-      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-      fprintf(outfp, "\nMBIO Error allocating background data array:\n%s\n", message);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_MEMORY_FAIL);
-    }
-    memset((char *)bxdata, 0, nbackground_alloc * sizeof(float));
-    memset((char *)bydata, 0, nbackground_alloc * sizeof(float));
-    memset((char *)bzdata, 0, nbackground_alloc * sizeof(float));
-#else
-    status = mb_mallocd(verbose, __FILE__, __LINE__, 3 * nbackground_alloc * sizeof(float), (void **)&bdata, &error);
-    if (error != MB_ERROR_NO_ERROR) {
-      char *message = nullptr;
-      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-      fprintf(outfp, "\nMBIO Error allocating background interpolation work arrays:\n%s\n", message);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_MEMORY_FAIL);
-    }
-    memset((char *)bdata, 0, 3 * nbackground_alloc * sizeof(float));
-#endif
+  /* get data input bounds in lon lat */
+  if (!use_projection) {
+    bounds[0] = wbnd[0];
+    bounds[1] = wbnd[1];
+    bounds[2] = wbnd[2];
+    bounds[3] = wbnd[3];
+  }
+  /* get min max of lon lat for data input from projected bounds */
+  else {
+    /* do first point */
+    xx = wbnd[0] - 0.05 * (wbnd[1] - wbnd[0]);
+    yy = wbnd[2] - 0.05 * (wbnd[3] - wbnd[2]);
+    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+    mb_apply_lonflip(verbose, lonflip, &xlon);
+    bounds[0] = xlon;
+    bounds[1] = xlon;
+    bounds[2] = ylat;
+    bounds[3] = ylat;
 
-    const int pid = getpid();
+    /* do second point */
+    xx = wbnd[1] + 0.05 * (wbnd[1] - wbnd[0]);
+    yy = wbnd[2] - 0.05 * (wbnd[3] - wbnd[2]);
+    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+    mb_apply_lonflip(verbose, lonflip, &xlon);
+    bounds[0] = std::min(bounds[0], xlon);
+    bounds[1] = std::max(bounds[1], xlon);
+    bounds[2] = std::min(bounds[2], ylat);
+    bounds[3] = std::max(bounds[3], ylat);
 
-    /* get initial grid using grdraster */
-    if (grdrasterid > 0) {
-      snprintf(backgroundfile, sizeof(backgroundfile), "tmpgrdraster%d.grd", pid);
-      snprintf(plot_cmd, sizeof(plot_cmd), "grdraster %d -R%f/%f/%f/%f -G%s", grdrasterid, bounds[0], bounds[1], bounds[2], bounds[3],
-              backgroundfile);
-      fprintf(stderr, "Executing: %s\n", plot_cmd);
-      const int fork_status = system(plot_cmd);
-      if (fork_status != 0) {
-        fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n", plot_cmd,
-                program_name);
-        mb_memory_clear(verbose, &memclear_error);
-        exit(MB_ERROR_BAD_PARAMETER);
-      }
-    }
+    /* do third point */
+    xx = wbnd[0] - 0.05 * (wbnd[1] - wbnd[0]);
+    yy = wbnd[3] + 0.05 * (wbnd[3] - wbnd[2]);
+    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+    mb_apply_lonflip(verbose, lonflip, &xlon);
+    bounds[0] = std::min(bounds[0], xlon);
+    bounds[1] = std::max(bounds[1], xlon);
+    bounds[2] = std::min(bounds[2], ylat);
+    bounds[3] = std::max(bounds[3], ylat);
 
-    /* if needed translate grid to normal registration */
-    snprintf(plot_cmd, sizeof(plot_cmd), "gmt grdinfo %s", backgroundfile);
-    char backgroundfileuse[MB_PATH_MAXLINE] = "";
-    strcpy(backgroundfileuse, backgroundfile);
-    if ((rfp = popen(plot_cmd, "r")) != nullptr) {
-      /* parse the grdinfo results */
-      char plot_stdout[MB_COMMENT_MAXLINE];
-      /* char *bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
-      /* bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
-      /* bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
-      /* bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
-      pclose(rfp);
-      if (strncmp(plot_stdout, "Pixel node registration used", 28) == 0) {
-        snprintf(backgroundfileuse, sizeof(backgroundfileuse), "tmpgrdsampleT%d.grd", pid);
-        snprintf(plot_cmd, sizeof(plot_cmd), "grdsample %s -G%s -T", backgroundfile, backgroundfileuse);
-        fprintf(stderr, "Executing: %s\n", plot_cmd);
-        const int fork_status = system(plot_cmd);
-        if (fork_status != 0) {
-          fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n",
-                  plot_cmd, program_name);
-          mb_memory_clear(verbose, &memclear_error);
-          exit(MB_ERROR_BAD_PARAMETER);
-        }
-      }
-    }
-    else {
-      fprintf(outfp, "\nBackground data not extracted as per -K option\n");
-      if (grdrasterid > 0) {
-        fprintf(outfp, "The program grdraster may not have been found\n");
-        fprintf(outfp, "or the specified background dataset %d may not exist.\n", grdrasterid);
-      }
-      else {
-        fprintf(outfp, "The specified background dataset %s may not exist.\n", backgroundfile);
-      }
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      error = MB_ERROR_BAD_PARAMETER;
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_BAD_PARAMETER);
-    }
+    /* do fourth point */
+    xx = wbnd[1] + 0.05 * (wbnd[1] - wbnd[0]);
+    yy = wbnd[3] + 0.05 * (wbnd[3] - wbnd[2]);
+    mb_proj_inverse(verbose, pjptr, xx, yy, &xlon, &ylat, &error);
+    mb_apply_lonflip(verbose, lonflip, &xlon);
+    bounds[0] = std::min(bounds[0], xlon);
+    bounds[1] = std::max(bounds[1], xlon);
+    bounds[2] = std::min(bounds[2], ylat);
+    bounds[3] = std::max(bounds[3], ylat);
+  }
 
-    /* resample extracted grid to have similar resolution as working grid */
-    if (use_projection)
-      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grdsample %s -Gtmpgrdsample%d.grd -R%.12f/%.12f/%.12f/%.12f -I%.12f/%.12f", backgroundfileuse,
-              pid, bounds[0], bounds[1], bounds[2], bounds[3], dx * mtodeglon, dy * mtodeglat);
-    else
-      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grdsample %s -Gtmpgrdsample%d.grd -R%.12f/%.12f/%.12f/%.12f -I%.12f/%.12f", backgroundfileuse,
-              pid, bounds[0], bounds[1], bounds[2], bounds[3], dx, dy);
-    fprintf(stderr, "Executing: %s\n", plot_cmd);
-    int fork_status = system(plot_cmd);
-    if (fork_status != 0) {
-      fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n", plot_cmd,
-              program_name);
-      error = MB_ERROR_BAD_PARAMETER;
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_BAD_PARAMETER);
-    }
+  /* extend the bounds slightly to be sure no data gets missed */
+  xx = std::min(0.05 * (bounds[1] - bounds[0]), 0.1);
+  yy = std::min(0.05 * (bounds[3] - bounds[2]), 0.1);
+  bounds[0] = bounds[0] - xx;
+  bounds[1] = bounds[1] + xx;
+  bounds[2] = bounds[2] - yy;
+  bounds[3] = bounds[3] + yy;
 
-    /* extract points with preprocessing if that will help */
+  /* figure out lonflip for data bounds */
+  if (bounds[0] < -180.0)
+    lonflip = -1;
+  else if (bounds[1] > 180.0)
+    lonflip = 1;
+  else if (lonflip == -1 && bounds[1] > 0.0)
+    lonflip = 0;
+  else if (lonflip == 1 && bounds[0] < 0.0)
+    lonflip = 0;
+
+  /* check interpolation parameters */
+  if ((clipmode == MBGRID_INTERP_GAP || clipmode == MBGRID_INTERP_NEAR) && clip > xdim && clip > ydim)
+    clipmode = MBGRID_INTERP_ALL;
+  if (clipmode == MBGRID_INTERP_ALL)
+    clip = std::max(xdim, ydim);
+
+  /* set origin used to reduce data value size before conversion from
+   * double to float when calling the interpolation routines */
+  bdata_origin_x = 0.5 * (wbnd[0] + wbnd[1]);
+  bdata_origin_y = 0.5 * (wbnd[2] + wbnd[3]);
+
+  /* set plot label strings */
+  if (use_projection) {
+    snprintf(xlabel, sizeof(xlabel), "Easting (%s)", units);
+    snprintf(ylabel, sizeof(ylabel), "Northing (%s)", units);
+  }
+  else {
+    strcpy(xlabel, "Longitude");
+    strcpy(ylabel, "Latitude");
+  }
+  if (datatype == MBGRID_DATA_BATHYMETRY) {
+    if (bathy_in_feet)
+      strcpy(zlabel, "Depth (ft)");
+    else
+      strcpy(zlabel, "Depth (m)");
+    strcpy(nlabel, "Number of Depth Data Points");
+    if (bathy_in_feet)
+      strcpy(sdlabel, "Depth Standard Deviation (ft)");
+    else
+      strcpy(sdlabel, "Depth Standard Deviation (m)");
+    strcpy(title, "Bathymetry Grid");
+  }
+  else if (datatype == MBGRID_DATA_TOPOGRAPHY) {
+    if (bathy_in_feet)
+      strcpy(zlabel, "Topography (ft)");
+    else
+      strcpy(zlabel, "Topography (m)");
+    strcpy(nlabel, "Number of Topography Data Points");
+    if (bathy_in_feet)
+      strcpy(sdlabel, "Topography Standard Deviation (ft)");
+    else
+      strcpy(sdlabel, "Topography Standard Deviation (m)");
+    strcpy(title, "Topography Grid");
+  }
+  else if (datatype == MBGRID_DATA_AMPLITUDE) {
+    strcpy(zlabel, "Amplitude");
+    strcpy(nlabel, "Number of Amplitude Data Points");
+    strcpy(sdlabel, "Amplitude Standard Deviation (m)");
+    strcpy(title, "Amplitude Grid");
+  }
+  else if (datatype == MBGRID_DATA_SIDESCAN) {
+    strcpy(zlabel, "Sidescan");
+    strcpy(nlabel, "Number of Sidescan Data Points");
+    strcpy(sdlabel, "Sidescan Standard Deviation (m)");
+    strcpy(title, "Sidescan Grid");
+  }
+
+  /* output info */
+  if (verbose >= 0) {
+    fprintf(outfp, "\nMBGRID Parameters:\n");
+    fprintf(outfp, "List of input files: %s\n", filelist);
+    fprintf(outfp, "Output fileroot:     %s\n", fileroot);
+    fprintf(outfp, "Input Data Type:     ");
+    if (datatype == MBGRID_DATA_BATHYMETRY) {
+      fprintf(outfp, "Bathymetry\n");
+      if (bathy_in_feet)
+        fprintf(outfp, "Bathymetry gridded in feet\n");
+    }
+    else if (datatype == MBGRID_DATA_TOPOGRAPHY) {
+      fprintf(outfp, "Topography\n");
+      if (bathy_in_feet)
+        fprintf(outfp, "Topography gridded in feet\n");
+    }
+    else if (datatype == MBGRID_DATA_AMPLITUDE)
+      fprintf(outfp, "Amplitude\n");
+    else if (datatype == MBGRID_DATA_SIDESCAN)
+      fprintf(outfp, "Sidescan\n");
+    else
+      fprintf(outfp, "Unknown?\n");
+    fprintf(outfp, "Gridding algorithm:  ");
+    if (grid_mode == MBGRID_MEDIAN_FILTER && median_percentile != 50.0)
+      fprintf(outfp, "Percentile Filter (%.2f%%)\n", median_percentile);
+    else if (grid_mode == MBGRID_MEDIAN_FILTER)
+      fprintf(outfp, "Median Filter\n");
+    else if (grid_mode == MBGRID_MINIMUM_FILTER)
+      fprintf(outfp, "Minimum Filter\n");
+    else if (grid_mode == MBGRID_MAXIMUM_FILTER)
+      fprintf(outfp, "Maximum Filter\n");
+    else if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE)
+      fprintf(outfp, "Footprint-Slope Weighted Mean\n");
+    else if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT)
+      fprintf(outfp, "Footprint Weighted Mean\n");
+    else if (grid_mode == MBGRID_MINIMUM_WEIGHTED_MEAN)
+      fprintf(outfp, "Minimum Gaussian Weighted Mean\n");
+    else if (grid_mode == MBGRID_MAXIMUM_WEIGHTED_MEAN)
+      fprintf(outfp, "Maximum Gaussian Weighted Mean\n");
+    else
+      fprintf(outfp, "Gaussian Weighted Mean\n");
+    if (n_threads > 1)
+      fprintf(outfp, "Gridding threads: %u\n", n_threads);
+    fprintf(outfp, "Grid projection: %s\n", projection_id);
     if (use_projection) {
-      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grd2xyz tmpgrdsample%d.grd -s -bo | gmt blockmean -bi -bo -C -R%f/%f/%f/%f -I%.12f/%.12f", pid,
-              bounds[0], bounds[1], bounds[2], bounds[3], dx * mtodeglon, dy * mtodeglat);
+      fprintf(outfp, "Projection ID: %s\n", projection_id);
+    }
+    fprintf(outfp, "Grid dimensions: %d %d\n", xdim, ydim);
+    fprintf(outfp, "Grid bounds:\n");
+    if (use_projection) {
+      fprintf(outfp, "  Eastings:  %9.4f %9.4f\n", gbnd[0], gbnd[1]);
+      fprintf(outfp, "  Northings: %9.4f %9.4f\n", gbnd[2], gbnd[3]);
+      fprintf(outfp, "  Longitude: %9.4f %9.4f\n", obnd[0], obnd[1]);
+      fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", obnd[2], obnd[3]);
     }
     else {
-      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grd2xyz tmpgrdsample%d.grd -s -bo | gmt blockmean -bi -bo -C -R%f/%f/%f/%f -I%.12f/%.12f", pid,
-              bounds[0], bounds[1], bounds[2], bounds[3], dx, dy);
+      fprintf(outfp, "  Longitude: %9.4f %9.4f\n", gbnd[0], gbnd[1]);
+      fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", gbnd[2], gbnd[3]);
     }
-    fprintf(stderr, "Executing: %s\n", plot_cmd);
-    if ((rfp = popen(plot_cmd, "r")) != nullptr) {
-      /* loop over reading */
-      nbackground = 0;
-      while (fread(&tlon, sizeof(double), 1, rfp) == 1) {
-        /* size_t freadsize = */ fread(&tlat, sizeof(double), 1, rfp);
-        /* freadsize = */ fread(&tvalue, sizeof(double), 1, rfp);
-        if (lonflip == -1 && tlon > 0.0)
-          tlon -= 360.0;
-        else if (lonflip == 0 && tlon < -180.0)
-          tlon += 360.0;
-        else if (lonflip == 0 && tlon > 180.0)
-          tlon -= 360.0;
-        else if (lonflip == 1 && tlon < 0.0)
-          tlon += 360.0;
-        if (use_projection)
-          mb_proj_forward(verbose, pjptr, tlon, tlat, &tlon, &tlat, &error);
-#ifdef USESURFACE
-        if (nbackground >= nbackground_alloc) {
-          nbackground_alloc += 10000;
-          status =
-              mb_reallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bxdata, &error);
-          if (status == MB_SUCCESS)
-            status =
-                mb_reallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bydata, &error);
-          if (status == MB_SUCCESS)
-            status =
-                mb_reallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bzdata, &error);
-          if (error != MB_ERROR_NO_ERROR) {
-            char *message = nullptr;
-            mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-            fprintf(outfp, "\nMBIO Error reallocating background data array:\n%s\n", message);
-            fprintf(outfp, "\nProgram <%s> Terminated at line %d in source file %s\n", program_name, __LINE__,
-                    __FILE__);
-            mb_memory_clear(verbose, &memclear_error);
-            exit(MB_ERROR_MEMORY_FAIL);
-          }
-        }
-        bxdata[nbackground] = (float)(tlon - bdata_origin_x);
-        bydata[nbackground] = (float)(tlat - bdata_origin_y);
-        bzdata[nbackground] = (float)tvalue;
-#else
-        if (nbackground >= nbackground_alloc) {
-          nbackground_alloc += 10000;
-          status =
-              mb_reallocd(verbose, __FILE__, __LINE__, 3 * nbackground_alloc * sizeof(float), (void **)&bdata, &error);
-          if (error != MB_ERROR_NO_ERROR) {
-            char *message = nullptr;
-            mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-            fprintf(outfp, "\nMBIO Error allocating background interpolation work arrays:\n%s\n", message);
-            fprintf(outfp, "\nProgram <%s> Terminated at line %d in source file %s\n", program_name, __LINE__,
-                    __FILE__);
-            mb_memory_clear(verbose, &memclear_error);
-            exit(MB_ERROR_MEMORY_FAIL);
-          }
-        }
-        bdata[nbackground * 3] = (float)(tlon - bdata_origin_x);
-        bdata[nbackground * 3 + 1] = (float)(tlat - bdata_origin_y);
-        bdata[nbackground * 3 + 2] = (float)tvalue;
-#endif
-        nbackground++;
+    if (boundsfactor > 1.0)
+      fprintf(outfp, "  Grid bounds correspond to %f times actual data coverage\n", boundsfactor);
+    fprintf(outfp, "Working grid dimensions: %d %d\n", gxdim, gydim);
+    if (use_projection) {
+      fprintf(outfp, "Working Grid bounds:\n");
+      fprintf(outfp, "  Eastings:  %9.4f %9.4f\n", wbnd[0], wbnd[1]);
+      fprintf(outfp, "  Northings: %9.4f %9.4f\n", wbnd[2], wbnd[3]);
+      fprintf(outfp, "Easting interval:  %f %s\n", dx, units);
+      fprintf(outfp, "Northing interval: %f %s\n", dy, units);
+      if (set_spacing) {
+        fprintf(outfp, "Specified Easting interval:  %f %s\n", dx_set, units);
+        fprintf(outfp, "Specified Northing interval: %f %s\n", dy_set, units);
       }
-      pclose(rfp);
     }
     else {
-      fprintf(outfp, "\nBackground data not extracted as per -K option\n");
-      fprintf(outfp, "The program grdraster may not have been found\n");
-      fprintf(outfp, "or the specified background dataset %d may not exist.\n", grdrasterid);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      error = MB_ERROR_BAD_PARAMETER;
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_BAD_PARAMETER);
+      fprintf(outfp, "Working Grid bounds:\n");
+      fprintf(outfp, "  Longitude: %9.4f %9.4f\n", wbnd[0], wbnd[1]);
+      fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", wbnd[2], wbnd[3]);
+      fprintf(outfp, "Longitude interval: %f degrees or %f m\n", dx, 1000 * dx * deglontokm);
+      fprintf(outfp, "Latitude interval:  %f degrees or %f m\n", dy, 1000 * dy * deglattokm);
+      if (set_spacing) {
+        fprintf(outfp, "Specified Longitude interval: %f %s\n", dx_set, units);
+        fprintf(outfp, "Specified Latitude interval:  %f %s\n", dy_set, units);
+      }
     }
-
-    /* delete any temporary files */
-    snprintf(plot_cmd, sizeof(plot_cmd), "rm tmpgrd*%d.grd", pid);
-    fprintf(stderr, "Executing: %s\n", plot_cmd);
-    fork_status = system(plot_cmd);
-    if (fork_status != 0) {
-      fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n", plot_cmd,
-              program_name);
-      error = MB_ERROR_BAD_PARAMETER;
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_BAD_PARAMETER);
+    if (shift && use_projection) {
+      fprintf(outfp, "Grid shift (applied to the bounds of output grids):\n");
+      fprintf(outfp, "  East shift:   %9.4f m\n", shift_x);
+      fprintf(outfp, "  North shift:  %9.4f m\n", shift_y);
     }
-  }
-
-  /* allocate memory for grid arrays */
-  status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&grid, &error);
-  if (status == MB_SUCCESS)
-    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&sigma, &error);
-  if (status == MB_SUCCESS)
-    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&firsttime, &error);
-  if (status == MB_SUCCESS)
-    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(int), (void **)&cnt, &error);
-  if (status == MB_SUCCESS)
-    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(int), (void **)&num, &error);
-  if (status == MB_SUCCESS)
-    status = mb_mallocd(verbose, __FILE__, __LINE__, xdim * ydim * sizeof(float), (void **)&output, &error);
-
-  /* if error initializing memory then quit */
-  if (error != MB_ERROR_NO_ERROR) {
-    char *message = nullptr;
-    mb_error(verbose, error, &message);
-    fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-    mb_memory_clear(verbose, &memclear_error);
-    exit(error);
-  }
-
-  /* open datalist file for list of all files that contribute to the grid */
-  strcpy(dfile, fileroot);
-  strcat(dfile, ".mb-1");
-  if ((dfp = fopen(dfile, "w")) == nullptr) {
-    error = MB_ERROR_OPEN_FAIL;
-    fprintf(outfp, "\nUnable to open datalist file: %s\n", dfile);
-  }
-
-/* -------------------------------------------------------------------------- */
-  bool file_in_bounds = false;
-  bool time_ok;  // TODO(schwehr): Probably can localize many variables.
-  bool region_ok;
-  bool footprint_ok;
-
-  /***** do weighted footprint slope gridding *****/
-  if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE) {
-    /* set up parameters for first cut low resolution slope grid */
-    // sbnd[4]; for (int i = 0; i < 4; i++) sbnd[i] = wbnd[i];
-    const double sdx = 2.0 * dx;
-    const double sdy = 2.0 * dy;
-    int sxdim = gxdim / 2;
-    int sydim = gydim / 2;
-    int sclip = std::max(gxdim, gydim);
-
-    /* allocate memory for additional arrays */
-    /* status &= */ mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&norm, &error);
-    /* status &= */ mb_mallocd(verbose, __FILE__, __LINE__, sxdim * sydim * sizeof(double), (void **)&gridsmall, &error);
-
-    /* if error initializing memory then quit */
-    if (error != MB_ERROR_NO_ERROR) {
-      char *message = nullptr;
-      mb_error(verbose, error, &message);
-      fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(error);
+    else if (shift) {
+      fprintf(outfp, "Grid shift (applied to the bounds of output grids):\n");
+      fprintf(outfp, "  Longitude interval: %f degrees or %f m\n", shift_x * mtodeglon, shift_x);
+      fprintf(outfp, "  Latitude interval:  %f degrees or %f m\n", shift_y * mtodeglat, shift_y);
     }
-
-    /* do first pass using simple mean to get low-resolution quick bathymetry to provide bottom slope
-        estimates for footprint gridding */
-
-    /* initialize arrays */
-    for (int i = 0; i < sxdim; i++)
-      for (int j = 0; j < sydim; j++) {
-        kgrid = i * sydim + j;
-        gridsmall[kgrid] = 0.0;
-        cnt[kgrid] = 0;
-      }
-
-    /* read in data */
-    fprintf(outfp, "\nDoing first pass to generate low resolution slope grid...\n");
-    ndata = 0;
-    const int look_processed = MB_DATALIST_LOOK_UNSET;
-    if (mb_datalist_open(verbose, &datalist, filelist, look_processed, &error) != MB_SUCCESS) {
-      error = MB_ERROR_OPEN_FAIL;
-      fprintf(outfp, "\nUnable to open data list file: %s\n", filelist);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(MB_ERROR_OPEN_FAIL);
+    fprintf(outfp, "Input data bounds:\n");
+    fprintf(outfp, "  Longitude: %9.4f %9.4f\n", bounds[0], bounds[1]);
+    fprintf(outfp, "  Latitude:  %9.4f %9.4f\n", bounds[2], bounds[3]);
+    if (grid_mode == MBGRID_WEIGHTED_MEAN)
+      fprintf(outfp, "Gaussian filter 1/e length: %f grid intervals\n", scale);
+    if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE || grid_mode == MBGRID_WEIGHTED_FOOTPRINT)
+      fprintf(outfp, "Footprint 1/e distance: %f times footprint\n", scale);
+    if (grid_mode == MBGRID_MINIMUM_WEIGHTED_MEAN)
+      fprintf(outfp, "Minimum filter threshold for Minimum Weighted Mean: %f\n", minormax_weighted_mean_threshold);
+    if (check_time && !first_in_stays)
+      fprintf(outfp, "Swath overlap handling:       Last data used\n");
+    if (check_time && first_in_stays)
+      fprintf(outfp, "Swath overlap handling:       First data used\n");
+    if (check_time)
+      fprintf(outfp, "Swath overlap time threshold: %f minutes\n", timediff / 60.);
+    if (clipmode == MBGRID_INTERP_NONE)
+      fprintf(outfp, "Spline interpolation not applied\n");
+    else if (clipmode == MBGRID_INTERP_GAP) {
+      fprintf(outfp, "Spline interpolation applied to fill data gaps\n");
+      fprintf(outfp, "Spline interpolation clipping dimension: %d\n", clip);
+      fprintf(outfp, "Spline tension (range 0.0 to infinity): %f\n", tension);
     }
-    while (mb_datalist_read2(verbose, datalist, &pstatus, path, ppath, dpath, &format, &file_weight, &error) ==
-           MB_SUCCESS) {
-      ndatafile = 0;
-
-      /* if format > 0 then input is swath sonar file */
-      if (format > 0 && path[0] != '#') {
-        /* apply pstatus */
-        if (pstatus == MB_PROCESSED_USE)
-          strcpy(file, ppath);
-        else
-          strcpy(file, path);
-
-        /* check for mbinfo file - get file bounds if possible */
-        rformat = format;
-        strcpy(rfile, file);
-        status = mb_check_info(verbose, rfile, lonflip, bounds, &file_in_bounds, &error);
-        if (status == MB_FAILURE) {
-          file_in_bounds = true;
-          status = MB_SUCCESS;
-          error = MB_ERROR_NO_ERROR;
-        }
-
-        /* initialize the swath sonar file */
-        bool first = true;
-        double dmin = 0.0;
-        double dmax = 0.0;
-        if (file_in_bounds) {
-          /* check for "fast bathymetry" or "fbt" file */
-          if (datatype == MBGRID_DATA_TOPOGRAPHY || datatype == MBGRID_DATA_BATHYMETRY) {
-            mb_get_fbt(verbose, rfile, &rformat, &error);
-          }
-
-          /* call mb_read_init() */
-          if (mb_read_init(verbose, rfile, rformat, pings, lonflip, bounds, btime_i, etime_i, speedmin,
-                                     timegap, &mbio_ptr, &btime_d, &etime_d, &beams_bath, &beams_amp, &pixels_ss,
-                                     &error) != MB_SUCCESS) {
-            char *message = nullptr;
-            mb_error(verbose, error, &message);
-            fprintf(outfp, "\nMBIO Error returned from function <mb_read_init>:\n%s\n", message);
-            fprintf(outfp, "\nMultibeam File <%s> not initialized for reading\n", rfile);
-            fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-            mb_memory_clear(verbose, &memclear_error);
-            exit(error);
-          }
-
-          /* get mb_io_ptr */
-          mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
-
-          /* get topography type */
-          status = mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
-
-          /* allocate memory for reading data arrays */
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(char), (void **)&beamflag,
-                                       &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bath, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_AMPLITUDE, sizeof(double), (void **)&amp, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bathlon,
-                                       &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bathlat,
-                                       &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&ss, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&sslon, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&sslat, &error);
-
-          /* if error initializing memory then quit */
-          if (error != MB_ERROR_NO_ERROR) {
-            char *message = nullptr;
-            mb_error(verbose, error, &message);
-            fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-            fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-            mb_memory_clear(verbose, &memclear_error);
-            exit(error);
-          }
-
-          /* loop over reading */
-          while (error <= MB_ERROR_NO_ERROR) {
-            status = mb_read(verbose, mbio_ptr, &kind, &rpings, time_i, &time_d, &navlon, &navlat, &speed, &heading,
-                             &distance, &altitude, &sonardepth, &beams_bath, &beams_amp, &pixels_ss, beamflag, bath,
-                             amp, bathlon, bathlat, ss, sslon, sslat, comment, &error);
-
-            /* time gaps are not a problem here */
-            if (error == MB_ERROR_TIME_GAP) {
-              error = MB_ERROR_NO_ERROR;
-              status = MB_SUCCESS;
-            }
-
-            if (verbose >= 2) {
-              fprintf(outfp, "\ndbg2  Ping read in program <%s>\n", program_name);
-              fprintf(outfp, "dbg2       kind:           %d\n", kind);
-              fprintf(outfp, "dbg2       beams_bath:     %d\n", beams_bath);
-              fprintf(outfp, "dbg2       beams_amp:      %d\n", beams_amp);
-              fprintf(outfp, "dbg2       pixels_ss:      %d\n", pixels_ss);
-              fprintf(outfp, "dbg2       error:          %d\n", error);
-              fprintf(outfp, "dbg2       status:         %d\n", status);
-            }
-
-            if ((datatype == MBGRID_DATA_BATHYMETRY || datatype == MBGRID_DATA_TOPOGRAPHY) &&
-                error == MB_ERROR_NO_ERROR) {
-
-              /* reproject beam positions if necessary */
-              if (use_projection) {
-                mb_proj_forward(verbose, pjptr, navlon, navlat, &navlon, &navlat, &error);
-                for (ib = 0; ib < beams_bath; ib++)
-                  if (mb_beam_ok(beamflag[ib]))
-                    mb_proj_forward(verbose, pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib],
-                                    &error);
-              }
-
-              /* deal with data */
-              for (ib = 0; ib < beams_bath; ib++)
-                if (mb_beam_ok(beamflag[ib])) {
-                  /* get position in grid */
-                  ix = (bathlon[ib] - wbnd[0] + dx) / sdx;
-                  iy = (bathlat[ib] - wbnd[2] + dy) / sdy;
-
-                  /* process if in region of interest */
-                  if (ix >= 0 && ix < sxdim
-                      && iy >= 0 && iy < sydim) {
-                    kgrid = ix * sydim + iy;
-                    gridsmall[kgrid] += topofactor * bath[ib];
-                    cnt[kgrid]++;
-                    ndata++;
-                    ndatafile++;
-                    if (first) {
-                      first = false;
-                      dmin = topofactor * bath[ib];
-                      dmax = topofactor * bath[ib];
-                    } else {
-                      dmin = std::min(topofactor * bath[ib], dmin);
-                      dmax = std::max(topofactor * bath[ib], dmax);
-                    }
-                  }
-                }
-            }
-          }
-          mb_close(verbose, &mbio_ptr, &error);
-          status = MB_SUCCESS;
-          error = MB_ERROR_NO_ERROR;
-        }
-        if (verbose >= 2)
-          fprintf(outfp, "\n");
-        if (verbose > 0)
-          fprintf(outfp, "%d data points processed in %s (minmax: %f %f)\n", ndatafile, rfile, dmin, dmax);
-        else if (file_in_bounds)
-          fprintf(outfp, "%d data points processed in %s\n", ndatafile, rfile);
-
-        /* add to datalist if data actually contributed */
-        if (ndatafile > 0 && dfp != nullptr) {
-          if (pstatus == MB_PROCESSED_USE)
-            fprintf(dfp, "P:");
-          else
-            fprintf(dfp, "R:");
-          fprintf(dfp, "%s %d %f\n", path, format, file_weight);
-          fflush(dfp);
-        }
-      } /* end if (format > 0) */
-    }
-    if (datalist != nullptr)
-      mb_datalist_close(verbose, &datalist, &error);
-    if (verbose > 0)
-      fprintf(outfp, "\n%d total data points processed\n", ndata);
-
-    /* close datalist if necessary */
-    if (dfp != nullptr) {
-      fclose(dfp);
-      dfp = nullptr;
-    }
-
-    /* now loop over all points in the low resolution grid */
-    if (verbose >= 1)
-      fprintf(outfp, "\nMaking low resolution slope grid...\n");
-    ndata = 8;
-    for (int i = 0; i < sxdim; i++)
-      for (int j = 0; j < sydim; j++) {
-        kgrid = i * sydim + j;
-        if (cnt[kgrid] > 0) {
-          gridsmall[kgrid] = gridsmall[kgrid] / ((double)cnt[kgrid]);
-          ndata++;
-        }
-      }
-
-/* now fill in the low resolution grid with interpolation */
-#ifdef USESURFACE
-    /* allocate and initialize sgrid */
-    status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&sxdata, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&sydata, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&szdata, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, sxdim * sydim * sizeof(float), (void **)&sgrid, &error);
-    if (error != MB_ERROR_NO_ERROR) {
-      char *message = nullptr;
-      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-      fprintf(outfp, "\nMBIO Error allocating interpolation work arrays:\n%s\n", message);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(error);
+    else if (clipmode == MBGRID_INTERP_NEAR) {
+      fprintf(outfp, "Spline interpolation applied near data\n");
+      fprintf(outfp, "Spline interpolation clipping dimension: %d\n", clip);
+      fprintf(outfp, "Spline tension (range 0.0 to infinity): %f\n", tension);
     }
-    memset((char *)sgrid, 0, sxdim * sydim * sizeof(float));
-    memset((char *)sxdata, 0, ndata * sizeof(float));
-    memset((char *)sydata, 0, ndata * sizeof(float));
-    memset((char *)szdata, 0, ndata * sizeof(float));
-
-    /* get points from grid */
-    /* simultaneously find the depth values nearest to the grid corners and edge midpoints */
-    ndata = 0;
-    for (int i = 0; i < sxdim; i++)
-      for (int j = 0; j < sydim; j++) {
-        kgrid = i * sydim + j;
-        if (cnt[kgrid] > 0) {
-          sxdata[ndata] = (float)(wbnd[0] + sdx * i - bdata_origin_x);
-          sydata[ndata] = (float)(wbnd[2] + sdy * j - bdata_origin_y);
-          szdata[ndata] = (float)gridsmall[kgrid];
-          ndata++;
-        }
-      }
-
-    /* do the interpolation */
-    fprintf(outfp, "\nDoing Surface spline interpolation with %d data points...\n", ndata);
-    mb_surface(verbose, ndata, sxdata, sydata, szdata, (wbnd[0] - bdata_origin_x), (wbnd[1] - bdata_origin_x),
-               (wbnd[2] - bdata_origin_y), (wbnd[3] - bdata_origin_y), sdx, sdy, tension, sgrid);
-#else
-    /* allocate and initialize sgrid */
-    status = mb_mallocd(verbose, __FILE__, __LINE__, 3 * ndata * sizeof(float), (void **)&sdata, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, sxdim * sydim * sizeof(float), (void **)&sgrid, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&work1, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(int), (void **)&work2, &error);
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, (sxdim + sydim) * sizeof(bool), (void **)&work3, &error);
-    if (error != MB_ERROR_NO_ERROR) {
-      char *message = nullptr;
-      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-      fprintf(outfp, "\nMBIO Error allocating interpolation work arrays:\n%s\n", message);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(error);
+    else if (clipmode == MBGRID_INTERP_ALL) {
+      fprintf(outfp, "Spline interpolation applied to fill entire grid\n");
+      fprintf(outfp, "Spline tension (range 0.0 to infinity): %f\n", tension);
     }
-    memset((char *)sgrid, 0, sxdim * sydim * sizeof(float));
-    memset((char *)sdata, 0, 3 * ndata * sizeof(float));
-    memset((char *)work1, 0, ndata * sizeof(float));
-    memset((char *)work2, 0, ndata * sizeof(int));
-    memset((char *)work3, 0, (sxdim + sydim) * sizeof(bool));
-
-    /* get points from grid */
-    /* simultaneously find the depth values nearest to the grid corners and edge midpoints */
-    ndata = 0;
-    for (int i = 0; i < sxdim; i++)
-      for (int j = 0; j < sydim; j++) {
-        kgrid = i * sydim + j;
-        if (cnt[kgrid] > 0) {
-          sdata[ndata++] = (float)(wbnd[0] + sdx * i - bdata_origin_x);
-          sdata[ndata++] = (float)(wbnd[2] + sdy * j - bdata_origin_y);
-          sdata[ndata++] = (float)gridsmall[kgrid];
-        }
-      }
-    ndata = ndata / 3;
-
-    /* do the interpolation */
-    float cay = (float)tension;
-    float xmin = (float)(wbnd[0] - 0.5 * sdx - bdata_origin_x);
-    float ymin = (float)(wbnd[2] - 0.5 * sdy - bdata_origin_y);
-    float ddx = (float)sdx;
-    float ddy = (float)sdy;
-    fprintf(outfp, "\nDoing Zgrid spline interpolation with %d data points...\n", ndata);
-    mb_zgrid2(sgrid, &sxdim, &sydim, &xmin, &ymin, &ddx, &ddy, sdata, &ndata, work1, work2, work3, &cay, &sclip);
-#endif
-
-    // float zflag = 5.0e34f;
-    for (int i = 0; i < sxdim; i++)
-      for (int j = 0; j < sydim; j++) {
-        kgrid = i * sydim + j;
-#ifdef USESURFACE
-        kint = i + (sydim - j - 1) * sxdim;
-#else
-        kint = i + j * sxdim;
-#endif
-        if (cnt[kgrid] == 0) {
-          gridsmall[kgrid] = sgrid[kint];
-        }
-      }
-
-/* deallocate the interpolation arrays */
-#ifdef USESURFACE
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&sxdata, &error);
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&sydata, &error);
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&szdata, &error);
-#else
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&sdata, &error);
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&work1, &error);
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&work2, &error);
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&work3, &error);
-#endif
-    mb_freed(verbose, __FILE__, __LINE__, (void **)&sgrid, &error);
-
-    /* do second pass footprint gridding using slope estimates from first pass interpolated grid */
-
-    /* initialize arrays */
-    for (int i = 0; i < gxdim; i++)
-      for (int j = 0; j < gydim; j++) {
-        kgrid = i * gydim + j;
-        grid[kgrid] = 0.0;
-        norm[kgrid] = 0.0;
-        sigma[kgrid] = 0.0;
-        firsttime[kgrid] = 0.0;
-        num[kgrid] = 0;
-        cnt[kgrid] = 0;
-      }
-
-    /* read in data */
-    fprintf(outfp, "\nDoing second pass to generate final grid...\n");
-    ndata = 0;
-    if (mb_datalist_open(verbose, &datalist, dfile, look_processed, &error) != MB_SUCCESS) {
-      error = MB_ERROR_OPEN_FAIL;
-      fprintf(outfp, "\nUnable to open data list file: %s\n", filelist);
-      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-      mb_memory_clear(verbose, &memclear_error);
-      exit(error);
+    if (grdrasterid == 0)
+      fprintf(outfp, "Background not applied\n");
+    else if (grdrasterid < 0)
+      fprintf(outfp, "Background obtained using grd2xyz from GMT grid file: %s\n", backgroundfile);
+    else
+      fprintf(outfp, "Background obtained using grdraster from dataset: %d\n", grdrasterid);
+    if (gridkind == MBGRID_ASCII)
+      fprintf(outfp, "Grid format %d:  ascii table\n", gridkind);
+    else if (gridkind == MBGRID_CDFGRD)
+      fprintf(outfp, "Grid format %d:  GMT version 2 grd (netCDF)\n", gridkind);
+    else if (gridkind == MBGRID_OLDGRD)
+      fprintf(outfp, "Grid format %d:  GMT version 1 grd (binary)\n", gridkind);
+    else if (gridkind == MBGRID_ARCASCII)
+      fprintf(outfp, "Grid format %d:  Arc/Info ascii table\n", gridkind);
+    else if (gridkind == MBGRID_GMTGRD) {
+      fprintf(outfp, "Grid format %d:  GMT grid\n", gridkind);
+      if (strlen(gridkindstring) > 0)
+        fprintf(outfp, "GMT Grid ID:     %s\n", gridkindstring);
     }
-    while (mb_datalist_read2(verbose, datalist, &pstatus, path, ppath, dpath, &format, &file_weight, &error) ==
-           MB_SUCCESS) {
-      ndatafile = 0;
-
-      /* if format > 0 then input is swath sonar file */
-      if (format > 0 && path[0] != '#') {
-        /* apply pstatus */
-        if (pstatus == MB_PROCESSED_USE)
-          strcpy(file, ppath);
-        else
-          strcpy(file, path);
-
-        /* check for mbinfo file - get file bounds if possible */
-        rformat = format;
-        strcpy(rfile, file);
-        status = mb_check_info(verbose, rfile, lonflip, bounds, &file_in_bounds, &error);
-        if (status == MB_FAILURE) {
-          file_in_bounds = true;
-          status = MB_SUCCESS;
-          error = MB_ERROR_NO_ERROR;
-        }
-
-        /* initialize the swath sonar file */
-        bool first = true;
-        double dmin = 0.0;
-        double dmax = 0.0;
-        if (file_in_bounds) {
-          /* check for "fast bathymetry" or "fbt" file */
-          if (datatype == MBGRID_DATA_TOPOGRAPHY || datatype == MBGRID_DATA_BATHYMETRY) {
-            mb_get_fbt(verbose, rfile, &rformat, &error);
-          }
-
-          /* call mb_read_init() */
-          if (mb_read_init(verbose, rfile, rformat, pings, lonflip, bounds, btime_i, etime_i, speedmin,
-                                     timegap, &mbio_ptr, &btime_d, &etime_d, &beams_bath, &beams_amp, &pixels_ss,
-                                     &error) != MB_SUCCESS) {
-            char *message = nullptr;
-            mb_error(verbose, error, &message);
-            fprintf(outfp, "\nMBIO Error returned from function <mb_read_init>:\n%s\n", message);
-            fprintf(outfp, "\nMultibeam File <%s> not initialized for reading\n", rfile);
-            fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-            mb_memory_clear(verbose, &memclear_error);
-            exit(error);
-          }
-
-          /* get mb_io_ptr */
-          mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
-
-          /* get topography type */
-          status = mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
-
-          /* allocate memory for reading data arrays */
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(char), (void **)&beamflag,
-                                       &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bath, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_AMPLITUDE, sizeof(double), (void **)&amp, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bathlon,
-                                       &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(double), (void **)&bathlat,
-                                       &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&ss, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&sslon, &error);
-          if (error == MB_ERROR_NO_ERROR)
-            status =
-                mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_SIDESCAN, sizeof(double), (void **)&sslat, &error);
-
-          /* if error initializing memory then quit */
-          if (error != MB_ERROR_NO_ERROR) {
-            char *message = nullptr;
-            mb_error(verbose, error, &message);
-            fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-            fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-            mb_memory_clear(verbose, &memclear_error);
-            exit(error);
-          }
-
-          /* loop over reading */
-          while (error <= MB_ERROR_NO_ERROR) {
-            status = mb_read(verbose, mbio_ptr, &kind, &rpings, time_i, &time_d, &navlon, &navlat, &speed, &heading,
-                             &distance, &altitude, &sonardepth, &beams_bath, &beams_amp, &pixels_ss, beamflag, bath,
-                             amp, bathlon, bathlat, ss, sslon, sslat, comment, &error);
-
-            /* time gaps are not a problem here */
-            if (error == MB_ERROR_TIME_GAP) {
-              error = MB_ERROR_NO_ERROR;
-              status = MB_SUCCESS;
-            }
-
-            if (verbose >= 2) {
-              fprintf(outfp, "\ndbg2  Ping read in program <%s>\n", program_name);
-              fprintf(outfp, "dbg2       kind:           %d\n", kind);
-              fprintf(outfp, "dbg2       beams_bath:     %d\n", beams_bath);
-              fprintf(outfp, "dbg2       beams_amp:      %d\n", beams_amp);
-              fprintf(outfp, "dbg2       pixels_ss:      %d\n", pixels_ss);
-              fprintf(outfp, "dbg2       error:          %d\n", error);
-              fprintf(outfp, "dbg2       status:         %d\n", status);
-            }
-
-            if ((datatype == MBGRID_DATA_BATHYMETRY || datatype == MBGRID_DATA_TOPOGRAPHY) &&
-                error == MB_ERROR_NO_ERROR) {
-
-                            /* if needed try again to get topography type */
-                            if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN) {
-                                status = mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
-                                if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN
-                                    && mb_io_ptr->beamwidth_xtrack > 0.0 && mb_io_ptr->beamwidth_ltrack > 0.0) {
-                                    topo_type = MB_TOPOGRAPHY_TYPE_MULTIBEAM;
-                                }
-                            }
-
-              /* reproject beam positions if necessary */
-              if (use_projection) {
-                mb_proj_forward(verbose, pjptr, navlon, navlat, &navlon, &navlat, &error);
-                for (ib = 0; ib < beams_bath; ib++)
-                  if (mb_beam_ok(beamflag[ib]))
-                    mb_proj_forward(verbose, pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib],
-                                    &error);
-              }
-
-              /* deal with data */
-              for (ib = 0; ib < beams_bath; ib++)
-                if (mb_beam_ok(beamflag[ib])) {
-                  /* get position in grid */
-                  ix = (bathlon[ib] - wbnd[0] + 0.5 * dx) / dx;
-                  iy = (bathlat[ib] - wbnd[2] + 0.5 * dy) / dy;
-
-                  /* deal with point data without footprint */
-                  if (topo_type != MB_TOPOGRAPHY_TYPE_MULTIBEAM) {
-                    if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                      kgrid = ix * gydim + iy;
-                      norm[kgrid] = norm[kgrid] + file_weight;
-                      grid[kgrid] = grid[kgrid] + file_weight * topofactor * bath[ib];
-                      sigma[kgrid] =
-                          sigma[kgrid] + file_weight * topofactor * topofactor * bath[ib] * bath[ib];
-                      num[kgrid]++;
-                      cnt[kgrid]++;
-                      ndata++;
-                      ndatafile++;
-                      if (first) {
-                        first = false;
-                        dmin = topofactor * bath[ib];
-                        dmax = topofactor * bath[ib];
-                      } else {
-                        dmin = std::min(topofactor * bath[ib], dmin);
-                        dmax = std::max(topofactor * bath[ib], dmax);
-                      }
-                    }
-                  }
-
-                  /* else deal with multibeam data that have beam footprints */
-                  else {
-                    /* get slope from low resolution grid */
-                    int isx = (bathlon[ib] - wbnd[0] + 0.5 * sdx) / sdx;
-                    int isy = (bathlat[ib] - wbnd[2] + 0.5 * sdy) / sdy;
-                    isx = std::min(std::max(isx, 0), sxdim - 1);
-                    isy = std::min(std::max(isy, 0), sydim - 1);
-                    double dzdx;
-                    double dzdy;
-                    if (isx == 0) {
-                      const int k1 = isx * sydim + isy;
-                      const int k2 = (isx + 1) * sydim + isy;
-                      dzdx = (gridsmall[k2] - gridsmall[k1]) / sdx;
-                    } else if (isx == sxdim - 1) {
-                      const int k1 = (isx - 1) * sydim + isy;
-                      const int k2 = isx * sydim + isy;
-                      dzdx = (gridsmall[k2] - gridsmall[k1]) / sdx;
-                    } else {
-                      const int k1 = (isx - 1) * sydim + isy;
-                      const int k2 = (isx + 1) * sydim + isy;
-                      dzdx = (gridsmall[k2] - gridsmall[k1]) / (2.0 * sdx);
-                    }
-                    if (isy == 0) {
-                      const int k1 = isx * sydim + isy;
-                      const int k2 = isx * sydim + (isy + 1);
-                      dzdy = (gridsmall[k2] - gridsmall[k1]) / sdy;
-                    } else if (isy == sydim - 1) {
-                      const int k1 = isx * sydim + (isy - 1);
-                      const int k2 = isx * sydim + isy;
-                      dzdy = (gridsmall[k2] - gridsmall[k1]) / sdy;
-                    } else {
-                      const int k1 = isx * sydim + (isy - 1);
-                      const int k2 = isx * sydim + (isy + 1);
-                      dzdy = (gridsmall[k2] - gridsmall[k1]) / (2.0 * sdy);
-                    }
-
-                    /* check if in region of interest */
-                    if (ix >= 0 && ix < gxdim
-                      && iy >= 0 && iy < gydim) {
-                      region_ok = true;
-                    } else {
-                      region_ok = false;
-                    }
-
-                    /* check if within allowed time */
-                    time_ok = true;
-                    if (region_ok && check_time) {
-                      /* if in region of interest
-                         check if time is ok */
-                      kgrid = ix * gydim + iy;
-                      if (firsttime[kgrid] <= 0.0) {
-                        firsttime[kgrid] = time_d;
-                        time_ok = true;
-                      } else if (fabs(time_d - firsttime[kgrid]) > timediff) {
-                        if (first_in_stays)
-                          time_ok = false;
-                        else {
-                          time_ok = true;
-                          firsttime[kgrid] = time_d;
-                          ndata = ndata - cnt[kgrid];
-                          ndatafile = ndatafile - cnt[kgrid];
-                          norm[kgrid] = 0.0;
-                          grid[kgrid] = 0.0;
-                          sigma[kgrid] = 0.0;
-                          num[kgrid] = 0;
-                          cnt[kgrid] = 0;
-                        }
-                      }
-                    }
-
-                    /* calculate footprint if in region of interest */
-                    if (region_ok && time_ok) {
-                      /* calculate footprint  */
-                      if (use_projection) {
-                        foot_dx = (bathlon[ib] - navlon);
-                        foot_dy = (bathlat[ib] - navlat);
-                      }
-                      else {
-                        foot_dx = (bathlon[ib] - navlon) / mtodeglon;
-                        foot_dy = (bathlat[ib] - navlat) / mtodeglat;
-                      }
-                      foot_lateral = sqrt(foot_dx * foot_dx + foot_dy * foot_dy);
-                      if (foot_lateral > 0.0) {
-                        foot_dxn = foot_dx / foot_lateral;
-                        foot_dyn = foot_dy / foot_lateral;
-                      }
-                      else {
-                        foot_dxn = 1.0;
-                        foot_dyn = 0.0;
-                      }
-                      beam_altitude = bath[ib] - sonardepth;
-                      foot_range = sqrt(foot_lateral * foot_lateral + beam_altitude * beam_altitude);
-                      foot_theta = RTD * atan2(foot_lateral, beam_altitude);
-                      if (foot_range > 0.0 && foot_theta < FOOT_THETA_MAX) {
-                        footprint_ok = true;
-                        foot_dtheta = 0.5 * scale * mb_io_ptr->beamwidth_xtrack;
-                        foot_dphi = 0.5 * scale * mb_io_ptr->beamwidth_ltrack;
-                        if (foot_dtheta <= 0.0)
-                          foot_dtheta = 1.0;
-                        if (foot_dphi <= 0.0)
-                          foot_dphi = 1.0;
-                        foot_hwidth = (bath[ib] - sonardepth) * tan(DTR * (foot_theta + foot_dtheta)) -
-                                      foot_lateral;
-                        foot_hlength = foot_range * tan(DTR * foot_dphi);
-                      } else {
-                        footprint_ok = false;
-                      }
-                    }
-
-                    if (time_ok && region_ok && footprint_ok) {
-                      /* get range of bins around footprint to examine */
-                      if (use_projection) {
-                        foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) / dx);
-                        foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) / dx);
-                        foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) / dy);
-                        foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) / dy);
-                      }
-                      else {
-                        foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) * mtodeglon / dx);
-                        foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) * mtodeglon / dx);
-                        foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) * mtodeglat / dy);
-                        foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) * mtodeglat / dy);
-                      }
-                      foot_dix = 2 * std::max(foot_wix, foot_lix);
-                      foot_diy = 2 * std::max(foot_wiy, foot_liy);
-                      ix1 = std::max(ix - foot_dix, 0);
-                      ix2 = std::min(ix + foot_dix, gxdim - 1);
-                      iy1 = std::max(iy - foot_diy, 0);
-                      iy2 = std::min(iy + foot_diy, gydim - 1);
-
-                      /* loop over neighborhood of bins */
-                      for (int ii = ix1; ii <= ix2; ii++)
-                        for (int jj = iy1; jj <= iy2; jj++) {
-                          /* find center of bin in lon lat degrees from sounding center */
-                          kgrid = ii * gydim + jj;
-                          xx = (wbnd[0] + ii * dx + 0.5 * dx - bathlon[ib]);
-                          yy = (wbnd[2] + jj * dy + 0.5 * dy - bathlat[ib]);
+    if (use_NaN)
+      fprintf(outfp, "NaN values used to flag regions with no data\n");
+    else
+      fprintf(outfp, "Real value of %f used to flag regions with no data\n", outclipvalue);
+    if (more)
+      fprintf(outfp, "Data density and sigma grids also created\n");
+    fprintf(outfp, "MBIO parameters:\n");
+    fprintf(outfp, "  Ping averaging:       %d\n", pings);
+    fprintf(outfp, "  Longitude flipping:   %d\n", lonflip);
+    fprintf(outfp, "  Speed minimum:      %4.1f km/hr\n", speedmin);
+  }
+  if (verbose > 0)
+    fprintf(outfp, "\n");
 
-                          /* get depth or topo value at this point using slope estimate */
-                          sbath = topofactor * bath[ib] + dzdx * xx + dzdy * yy;
+  /* if grdrasterid set extract background data
+      and interpolate it later onto internal grid */
+  if (grdrasterid != 0) {
+    if (grdrasterid > 0)
+      fprintf(outfp, "\nExtracting background from grdraster dataset %d...\n", grdrasterid);
+    else
+      fprintf(outfp, "\nExtracting background from grid file %s...\n", backgroundfile);
 
-                          /* get center and corners of bin in meters from sounding center */
-                          if (use_projection) {
-                            xx0 = xx;
-                            yy0 = yy;
-                            bdx = 0.5 * dx;
-                            bdy = 0.5 * dy;
-                          }
-                          else {
-                            xx0 = xx / mtodeglon;
-                            yy0 = yy / mtodeglat;
-                            bdx = 0.5 * dx / mtodeglon;
-                            bdy = 0.5 * dy / mtodeglat;
-                          }
-                          xx1 = xx0 - bdx;
-                          xx2 = xx0 + bdx;
-                          yy1 = yy0 - bdy;
-                          yy2 = yy0 + bdy;
+    /* guess about twice the data actually expected */
+    int nbackground_alloc = 2 * gxdim * gydim;
 
-                          /* rotate center and corners of bin to footprint coordinates */
-                          prx[0] = xx0 * foot_dxn + yy0 * foot_dyn;
-                          pry[0] = -xx0 * foot_dyn + yy0 * foot_dxn;
-                          prx[1] = xx1 * foot_dxn + yy1 * foot_dyn;
-                          pry[1] = -xx1 * foot_dyn + yy1 * foot_dxn;
-                          prx[2] = xx2 * foot_dxn + yy1 * foot_dyn;
-                          pry[2] = -xx2 * foot_dyn + yy1 * foot_dxn;
-                          prx[3] = xx1 * foot_dxn + yy2 * foot_dyn;
-                          pry[3] = -xx1 * foot_dyn + yy2 * foot_dxn;
-                          prx[4] = xx2 * foot_dxn + yy2 * foot_dyn;
-                          pry[4] = -xx2 * foot_dyn + yy2 * foot_dxn;
+/* allocate and initialize background data arrays */
+#ifdef USESURFACE
+    status = mb_mallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bxdata, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bydata, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bzdata, &error);
+    if (error != MB_ERROR_NO_ERROR) {
+      char *message = nullptr;
+      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
+      fprintf(outfp, "\nMBIO Error allocating background data array:\n%s\n", message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_MEMORY_FAIL);
+    }
+    memset((char *)bxdata, 0, nbackground_alloc * sizeof(float));
+    memset((char *)bydata, 0, nbackground_alloc * sizeof(float));
+    memset((char *)bzdata, 0, nbackground_alloc * sizeof(float));
+#else
+    status = mb_mallocd(verbose, __FILE__, __LINE__, 3 * nbackground_alloc * sizeof(float), (void **)&bdata, &error);
+    if (error != MB_ERROR_NO_ERROR) {
+      char *message = nullptr;
+      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
+      fprintf(outfp, "\nMBIO Error allocating background interpolation work arrays:\n%s\n", message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_MEMORY_FAIL);
+    }
+    memset((char *)bdata, 0, 3 * nbackground_alloc * sizeof(float));
+#endif
 
-                          /* get weight integrated over bin */
-                          mbgrid_weight(verbose, foot_hwidth, foot_hlength, prx[0], pry[0], bdx,
-                                        bdy, &prx[1], &pry[1], &weight, &use_weight, &error);
+    const int pid = getpid();
 
-                          if (use_weight != MBGRID_USE_NO && weight > 0.000001) {
-                            weight *= file_weight;
-                            norm[kgrid] = norm[kgrid] + weight;
-                            grid[kgrid] = grid[kgrid] + weight * sbath;
-                            sigma[kgrid] = sigma[kgrid] + weight * sbath * sbath;
-                            if (use_weight == MBGRID_USE_YES) {
-                              num[kgrid]++;
-                              if (ii == ix && jj == iy)
-                                cnt[kgrid]++;
-                            }
-                          }
-                        }
-                      ndata++;
-                      ndatafile++;
-                      if (first) {
-                        first = false;
-                        dmin = topofactor * bath[ib];
-                        dmax = topofactor * bath[ib];
-                      } else {
-                        dmin = std::min(topofactor * bath[ib], dmin);
-                        dmax = std::max(topofactor * bath[ib], dmax);
-                      }
-                    }
+    /* get initial grid using grdraster */
+    if (grdrasterid > 0) {
+      snprintf(backgroundfile, sizeof(backgroundfile), "tmpgrdraster%d.grd", pid);
+      snprintf(plot_cmd, sizeof(plot_cmd), "grdraster %d -R%f/%f/%f/%f -G%s", grdrasterid, bounds[0], bounds[1], bounds[2], bounds[3],
+              backgroundfile);
+      fprintf(stderr, "Executing: %s\n", plot_cmd);
+      const int fork_status = system(plot_cmd);
+      if (fork_status != 0) {
+        fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n", plot_cmd,
+                program_name);
+        mb_memory_clear(verbose, &memclear_error);
+        exit(MB_ERROR_BAD_PARAMETER);
+      }
+    }
 
-                      /* else for xyz data without footprint */
-                    else if (time_ok && region_ok) {
-                      kgrid = ix * gydim + iy;
-                      norm[kgrid] = norm[kgrid] + file_weight;
-                      grid[kgrid] = grid[kgrid] + file_weight * topofactor * bath[ib];
-                      sigma[kgrid] =
-                          sigma[kgrid] + file_weight * topofactor * topofactor * bath[ib] * bath[ib];
-                      num[kgrid]++;
-                      cnt[kgrid]++;
-                      ndata++;
-                      ndatafile++;
-                      if (first) {
-                        first = false;
-                        dmin = topofactor * bath[ib];
-                        dmax = topofactor * bath[ib];
-                      } else {
-                        dmin = std::min(topofactor * bath[ib], dmin);
-                        dmax = std::max(topofactor * bath[ib], dmax);
-                      }
-                    }
-                  }
-                }
-              }
-            }
-          mb_close(verbose, &mbio_ptr, &error);
-          status = MB_SUCCESS;
-          error = MB_ERROR_NO_ERROR;
+    /* if needed translate grid to normal registration */
+    snprintf(plot_cmd, sizeof(plot_cmd), "gmt grdinfo %s", backgroundfile);
+    char backgroundfileuse[MB_PATH_MAXLINE] = "";
+    strcpy(backgroundfileuse, backgroundfile);
+    if ((rfp = popen(plot_cmd, "r")) != nullptr) {
+      /* parse the grdinfo results */
+      char plot_stdout[MB_COMMENT_MAXLINE];
+      /* char *bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
+      /* bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
+      /* bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
+      /* bufptr = */ fgets(plot_stdout, MB_COMMENT_MAXLINE, rfp);
+      pclose(rfp);
+      if (strncmp(plot_stdout, "Pixel node registration used", 28) == 0) {
+        snprintf(backgroundfileuse, sizeof(backgroundfileuse), "tmpgrdsampleT%d.grd", pid);
+        snprintf(plot_cmd, sizeof(plot_cmd), "grdsample %s -G%s -T", backgroundfile, backgroundfileuse);
+        fprintf(stderr, "Executing: %s\n", plot_cmd);
+        const int fork_status = system(plot_cmd);
+        if (fork_status != 0) {
+          fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n",
+                  plot_cmd, program_name);
+          mb_memory_clear(verbose, &memclear_error);
+          exit(MB_ERROR_BAD_PARAMETER);
         }
-        if (verbose >= 2)
-          fprintf(outfp, "\n");
-        if (verbose > 0)
-          fprintf(outfp, "%d data points processed in %s (minmax: %f %f)\n", ndatafile, rfile, dmin, dmax);
-        else if (file_in_bounds)
-          fprintf(outfp, "%d data points processed in %s\n", ndatafile, rfile);
-      } /* end if (format > 0) */
+      }
+    }
+    else {
+      fprintf(outfp, "\nBackground data not extracted as per -K option\n");
+      if (grdrasterid > 0) {
+        fprintf(outfp, "The program grdraster may not have been found\n");
+        fprintf(outfp, "or the specified background dataset %d may not exist.\n", grdrasterid);
+      }
+      else {
+        fprintf(outfp, "The specified background dataset %s may not exist.\n", backgroundfile);
+      }
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      error = MB_ERROR_BAD_PARAMETER;
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_BAD_PARAMETER);
     }
-    if (datalist != nullptr)
-      mb_datalist_close(verbose, &datalist, &error);
-    if (verbose > 0)
-      fprintf(outfp, "\n%d total data points processed\n", ndata);
 
-    /* now loop over all points in the output grid */
-    if (verbose >= 1)
-      fprintf(outfp, "\nMaking raw grid...\n");
-    nbinset = 0;
-    nbinzero = 0;
-    nbinspline = 0;
-    nbinbackground = 0;
-    for (int i = 0; i < gxdim; i++)
-      for (int j = 0; j < gydim; j++) {
-        kgrid = i * gydim + j;
-        if (num[kgrid] > 0) {
-          grid[kgrid] = grid[kgrid] / norm[kgrid];
-          factor = sigma[kgrid] / norm[kgrid] - grid[kgrid] * grid[kgrid];
-          sigma[kgrid] = sqrt(fabs(factor));
-          nbinset++;
+    /* resample extracted grid to have similar resolution as working grid */
+    if (use_projection)
+      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grdsample %s -Gtmpgrdsample%d.grd -R%.12f/%.12f/%.12f/%.12f -I%.12f/%.12f", backgroundfileuse,
+              pid, bounds[0], bounds[1], bounds[2], bounds[3], dx * mtodeglon, dy * mtodeglat);
+    else
+      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grdsample %s -Gtmpgrdsample%d.grd -R%.12f/%.12f/%.12f/%.12f -I%.12f/%.12f", backgroundfileuse,
+              pid, bounds[0], bounds[1], bounds[2], bounds[3], dx, dy);
+    fprintf(stderr, "Executing: %s\n", plot_cmd);
+    int fork_status = system(plot_cmd);
+    if (fork_status != 0) {
+      fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n", plot_cmd,
+              program_name);
+      error = MB_ERROR_BAD_PARAMETER;
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_BAD_PARAMETER);
+    }
+
+    /* extract points with preprocessing if that will help */
+    if (use_projection) {
+      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grd2xyz tmpgrdsample%d.grd -s -bo | gmt blockmean -bi -bo -C -R%f/%f/%f/%f -I%.12f/%.12f", pid,
+              bounds[0], bounds[1], bounds[2], bounds[3], dx * mtodeglon, dy * mtodeglat);
+    }
+    else {
+      snprintf(plot_cmd, sizeof(plot_cmd), "gmt grd2xyz tmpgrdsample%d.grd -s -bo | gmt blockmean -bi -bo -C -R%f/%f/%f/%f -I%.12f/%.12f", pid,
+              bounds[0], bounds[1], bounds[2], bounds[3], dx, dy);
+    }
+    fprintf(stderr, "Executing: %s\n", plot_cmd);
+    if ((rfp = popen(plot_cmd, "r")) != nullptr) {
+      /* loop over reading */
+      nbackground = 0;
+      while (fread(&tlon, sizeof(double), 1, rfp) == 1) {
+        /* size_t freadsize = */ fread(&tlat, sizeof(double), 1, rfp);
+        /* freadsize = */ fread(&tvalue, sizeof(double), 1, rfp);
+        if (lonflip == -1 && tlon > 0.0)
+          tlon -= 360.0;
+        else if (lonflip == 0 && tlon < -180.0)
+          tlon += 360.0;
+        else if (lonflip == 0 && tlon > 180.0)
+          tlon -= 360.0;
+        else if (lonflip == 1 && tlon < 0.0)
+          tlon += 360.0;
+        if (use_projection)
+          mb_proj_forward(verbose, pjptr, tlon, tlat, &tlon, &tlat, &error);
+#ifdef USESURFACE
+        if (nbackground >= nbackground_alloc) {
+          nbackground_alloc += 10000;
+          status =
+              mb_reallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bxdata, &error);
+          if (status == MB_SUCCESS)
+            status =
+                mb_reallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bydata, &error);
+          if (status == MB_SUCCESS)
+            status =
+                mb_reallocd(verbose, __FILE__, __LINE__, nbackground_alloc * sizeof(float), (void **)&bzdata, &error);
+          if (error != MB_ERROR_NO_ERROR) {
+            char *message = nullptr;
+            mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
+            fprintf(outfp, "\nMBIO Error reallocating background data array:\n%s\n", message);
+            fprintf(outfp, "\nProgram <%s> Terminated at line %d in source file %s\n", program_name, __LINE__,
+                    __FILE__);
+            mb_memory_clear(verbose, &memclear_error);
+            exit(MB_ERROR_MEMORY_FAIL);
+          }
         }
-        else {
-          grid[kgrid] = clipvalue;
-          sigma[kgrid] = 0.0;
+        bxdata[nbackground] = (float)(tlon - bdata_origin_x);
+        bydata[nbackground] = (float)(tlat - bdata_origin_y);
+        bzdata[nbackground] = (float)tvalue;
+#else
+        if (nbackground >= nbackground_alloc) {
+          nbackground_alloc += 10000;
+          status =
+              mb_reallocd(verbose, __FILE__, __LINE__, 3 * nbackground_alloc * sizeof(float), (void **)&bdata, &error);
+          if (error != MB_ERROR_NO_ERROR) {
+            char *message = nullptr;
+            mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
+            fprintf(outfp, "\nMBIO Error allocating background interpolation work arrays:\n%s\n", message);
+            fprintf(outfp, "\nProgram <%s> Terminated at line %d in source file %s\n", program_name, __LINE__,
+                    __FILE__);
+            mb_memory_clear(verbose, &memclear_error);
+            exit(MB_ERROR_MEMORY_FAIL);
+          }
         }
+        bdata[nbackground * 3] = (float)(tlon - bdata_origin_x);
+        bdata[nbackground * 3 + 1] = (float)(tlat - bdata_origin_y);
+        bdata[nbackground * 3 + 2] = (float)tvalue;
+#endif
+        nbackground++;
       }
+      pclose(rfp);
+    }
+    else {
+      fprintf(outfp, "\nBackground data not extracted as per -K option\n");
+      fprintf(outfp, "The program grdraster may not have been found\n");
+      fprintf(outfp, "or the specified background dataset %d may not exist.\n", grdrasterid);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      error = MB_ERROR_BAD_PARAMETER;
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_BAD_PARAMETER);
+    }
 
-    /***** end of weighted footprint slope gridding *****/
+    /* delete any temporary files */
+    snprintf(plot_cmd, sizeof(plot_cmd), "rm tmpgrd*%d.grd", pid);
+    fprintf(stderr, "Executing: %s\n", plot_cmd);
+    fork_status = system(plot_cmd);
+    if (fork_status != 0) {
+      fprintf(outfp, "\nExecution of command:\n\t%s\nby system() call failed....\nProgram <%s> Terminated\n", plot_cmd,
+              program_name);
+      error = MB_ERROR_BAD_PARAMETER;
+      mb_memory_clear(verbose, &memclear_error);
+      exit(MB_ERROR_BAD_PARAMETER);
+    }
+  }
+
+  /* allocate memory for grid arrays */
+  status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&grid, &error);
+  if (status == MB_SUCCESS)
+    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&sigma, &error);
+  if (status == MB_SUCCESS)
+    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&firsttime, &error);
+  if (status == MB_SUCCESS)
+    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(int), (void **)&cnt, &error);
+  if (status == MB_SUCCESS)
+    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(int), (void **)&num, &error);
+  if (status == MB_SUCCESS)
+    status = mb_mallocd(verbose, __FILE__, __LINE__, xdim * ydim * sizeof(float), (void **)&output, &error);
+
+  /* if error initializing memory then quit */
+  if (error != MB_ERROR_NO_ERROR) {
+    char *message = nullptr;
+    mb_error(verbose, error, &message);
+    fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
+    fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+    mb_memory_clear(verbose, &memclear_error);
+    exit(error);
+  }
+
+  /* open datalist file for list of all files that contribute to the grid */
+  strcpy(dfile, fileroot);
+  strcat(dfile, ".mb-1");
+  if ((dfp = fopen(dfile, "w")) == nullptr) {
+    error = MB_ERROR_OPEN_FAIL;
+    fprintf(outfp, "\nUnable to open datalist file: %s\n", dfile);
+  }
+
+  /* set parameters shared by the gridding threads */
+  struct mbgrid_control_struct control;
+  control.verbose = verbose;
+  control.datatype = datatype;
+  control.grid_mode = grid_mode;
+  control.pings = pings;
+  control.lonflip = lonflip;
+  for (int i = 0; i < 4; i++) {
+    control.bounds[i] = bounds[i];
+    control.wbnd[i] = wbnd[i];
+  }
+  for (int i = 0; i < 7; i++) {
+    control.btime_i[i] = btime_i[i];
+    control.etime_i[i] = etime_i[i];
   }
+  control.speedmin = speedmin;
+  control.timegap = timegap;
+  control.use_projection = use_projection;
+  strcpy(control.projection_id, projection_id);
+  control.dx = dx;
+  control.dy = dy;
+  control.gxdim = gxdim;
+  control.gydim = gydim;
+  control.xtradim = xtradim;
+  control.factor = factor;
+  control.topofactor = topofactor;
+  control.scale = scale;
+  control.mtodeglon = mtodeglon;
+  control.mtodeglat = mtodeglat;
+  control.check_time = check_time;
+  control.first_in_stays = first_in_stays;
+  control.timediff = timediff;
+  control.firsttime = firsttime;
+  control.nfile = 0;
+  control.files = nullptr;
 
 /* -------------------------------------------------------------------------- */
-  /***** do weighted footprint gridding *****/
-  else if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT) {
+  bool file_in_bounds = false;
+  bool time_ok;  // TODO(schwehr): Probably can localize many variables.
+  bool region_ok;
+  bool footprint_ok;
+
+  /***** do weighted footprint slope gridding *****/
+  if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT_SLOPE) {
+    /* set up parameters for first cut low resolution slope grid */
+    // sbnd[4]; for (int i = 0; i < 4; i++) sbnd[i] = wbnd[i];
+    const double sdx = 2.0 * dx;
+    const double sdy = 2.0 * dy;
+    int sxdim = gxdim / 2;
+    int sydim = gydim / 2;
+    int sclip = std::max(gxdim, gydim);
 
     /* allocate memory for additional arrays */
-    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&norm, &error);
+    /* status &= */ mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&norm, &error);
+    /* status &= */ mb_mallocd(verbose, __FILE__, __LINE__, sxdim * sydim * sizeof(double), (void **)&gridsmall, &error);
+
+    /* if error initializing memory then quit */
+    if (error != MB_ERROR_NO_ERROR) {
+      char *message = nullptr;
+      mb_error(verbose, error, &message);
+      fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(error);
+    }
+
+    /* do first pass using simple mean to get low-resolution quick bathymetry to provide bottom slope
+        estimates for footprint gridding */
 
     /* initialize arrays */
-    for (int i = 0; i < gxdim; i++)
-      for (int j = 0; j < gydim; j++) {
-        kgrid = i * gydim + j;
-        grid[kgrid] = 0.0;
-        norm[kgrid] = 0.0;
-        sigma[kgrid] = 0.0;
-        firsttime[kgrid] = 0.0;
-        num[kgrid] = 0;
+    for (int i = 0; i < sxdim; i++)
+      for (int j = 0; j < sydim; j++) {
+        kgrid = i * sydim + j;
+        gridsmall[kgrid] = 0.0;
         cnt[kgrid] = 0;
       }
 
     /* read in data */
-    fprintf(outfp, "\nDoing single pass to generate grid...\n");
+    fprintf(outfp, "\nDoing first pass to generate low resolution slope grid...\n");
     ndata = 0;
     const int look_processed = MB_DATALIST_LOOK_UNSET;
     if (mb_datalist_open(verbose, &datalist, filelist, look_processed, &error) != MB_SUCCESS) {
@@ -2564,7 +2899,7 @@ int main(int argc, char **argv) {
       fprintf(outfp, "\nUnable to open data list file: %s\n", filelist);
       fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
       mb_memory_clear(verbose, &memclear_error);
-      exit(error);
+      exit(MB_ERROR_OPEN_FAIL);
     }
     while (mb_datalist_read2(verbose, datalist, &pstatus, path, ppath, dpath, &format, &file_weight, &error) ==
            MB_SUCCESS) {
@@ -2677,240 +3012,37 @@ int main(int argc, char **argv) {
             if ((datatype == MBGRID_DATA_BATHYMETRY || datatype == MBGRID_DATA_TOPOGRAPHY) &&
                 error == MB_ERROR_NO_ERROR) {
 
-                            /* if needed try again to get topography type */
-                            if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN) {
-                                status = mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
-                                if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN
-                                    && mb_io_ptr->beamwidth_xtrack > 0.0 && mb_io_ptr->beamwidth_ltrack > 0.0) {
-                                    topo_type = MB_TOPOGRAPHY_TYPE_MULTIBEAM;
-                                }
-                            }
-
               /* reproject beam positions if necessary */
               if (use_projection) {
                 mb_proj_forward(verbose, pjptr, navlon, navlat, &navlon, &navlat, &error);
                 for (ib = 0; ib < beams_bath; ib++)
-                  if (mb_beam_ok(beamflag[ib]))
-                    mb_proj_forward(verbose, pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib],
-                                    &error);
-              }
-
-              /* deal with data */
-              for (ib = 0; ib < beams_bath; ib++)
-                if (mb_beam_ok(beamflag[ib])) {
-                  /* get position in grid */
-                  ix = (bathlon[ib] - wbnd[0] + 0.5 * dx) / dx;
-                  iy = (bathlat[ib] - wbnd[2] + 0.5 * dy) / dy;
-
-                  /* check if within allowed time */
-                  if (check_time) {
-                    /* if in region of interest
-                       check if time is ok */
-                    if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                      kgrid = ix * gydim + iy;
-                      if (firsttime[kgrid] <= 0.0) {
-                        firsttime[kgrid] = time_d;
-                        time_ok = true;
-                      }
-                      else if (fabs(time_d - firsttime[kgrid]) > timediff) {
-                        if (first_in_stays)
-                          time_ok = false;
-                        else {
-                          time_ok = true;
-                          firsttime[kgrid] = time_d;
-                          ndata = ndata - cnt[kgrid];
-                          ndatafile = ndatafile - cnt[kgrid];
-                          norm[kgrid] = 0.0;
-                          grid[kgrid] = 0.0;
-                          sigma[kgrid] = 0.0;
-                          num[kgrid] = 0;
-                          cnt[kgrid] = 0;
-                        }
-                      }
-                      else
-                        time_ok = true;
-                    }
-                    else
-                      time_ok = true;
-                  }
-                  else
-                    time_ok = true;
-
-                  /* process if in region of interest */
-                  if (ix >= 0 && ix < gxdim
-                      && iy >= 0 && iy < gydim && time_ok) {
-                    /* deal with point data without footprint */
-                    if (topo_type != MB_TOPOGRAPHY_TYPE_MULTIBEAM) {
-                      kgrid = ix * gydim + iy;
-                      norm[kgrid] = norm[kgrid] + file_weight;
-                      grid[kgrid] = grid[kgrid] + file_weight * topofactor * bath[ib];
-                      sigma[kgrid] =
-                          sigma[kgrid] + file_weight * topofactor * topofactor * bath[ib] * bath[ib];
-                      num[kgrid]++;
-                      cnt[kgrid]++;
-                      ndata++;
-                      ndatafile++;
-                      if (first) {
-                        first = false;
-                        dmin = topofactor * bath[ib];
-                        dmax = topofactor * bath[ib];
-                      } else {
-                        dmin = std::min(topofactor * bath[ib], dmin);
-                        dmax = std::max(topofactor * bath[ib], dmax);
-                      }
-                    }
-
-                    /* else deal with multibeam data that have beam footprints */
-                    else {
-                      /* calculate footprint - this is a kluge assuming
-                         sonar at surface - also assumes lon lat grid
-                         - to be generalized in later version
-                         DWC 11/16/99 */
-                      /* calculate footprint - now uses sonar altitude
-                         - still assumes lon lat grid
-                         - to be generalized in later version
-                         DWC 1/29/2001 */
-                      /* now handles projected grids
-                         DWC 3/5/2003 */
-                      if (use_projection) {
-                        foot_dx = (bathlon[ib] - navlon);
-                        foot_dy = (bathlat[ib] - navlat);
-                      }
-                      else {
-                        foot_dx = (bathlon[ib] - navlon) / mtodeglon;
-                        foot_dy = (bathlat[ib] - navlat) / mtodeglat;
-                      }
-                      foot_lateral = sqrt(foot_dx * foot_dx + foot_dy * foot_dy);
-                      if (foot_lateral > 0.0) {
-                        foot_dxn = foot_dx / foot_lateral;
-                        foot_dyn = foot_dy / foot_lateral;
-                      }
-                      else {
-                        foot_dxn = 1.0;
-                        foot_dyn = 0.0;
-                      }
-                      foot_range = sqrt(foot_lateral * foot_lateral + altitude * altitude);
-                      if (foot_range > 0.0) {
-                        foot_theta = RTD * atan2(foot_lateral, (bath[ib] - sonardepth));
-                        foot_dtheta = 0.5 * scale * mb_io_ptr->beamwidth_xtrack;
-                        foot_dphi = 0.5 * scale * mb_io_ptr->beamwidth_ltrack;
-                        if (foot_dtheta <= 0.0)
-                          foot_dtheta = 1.0;
-                        if (foot_dphi <= 0.0)
-                          foot_dphi = 1.0;
-                        foot_hwidth = (bath[ib] - sonardepth) * tan(DTR * (foot_theta + foot_dtheta)) -
-                                      foot_lateral;
-                        foot_hlength = foot_range * tan(DTR * foot_dphi);
-
-                        /* get range of bins around footprint to examine */
-                        if (use_projection) {
-                          foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) / dx);
-                          foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) / dx);
-                          foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) / dy);
-                          foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) / dy);
-                        }
-                        else {
-                          foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) * mtodeglon / dx);
-                          foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) * mtodeglon / dx);
-                          foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) * mtodeglat / dy);
-                          foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) * mtodeglat / dy);
-                        }
-                        foot_dix = 2 * std::max(foot_wix, foot_lix);
-                        foot_diy = 2 * std::max(foot_wiy, foot_liy);
-                        ix1 = std::max(ix - foot_dix, 0);
-                        ix2 = std::min(ix + foot_dix, gxdim - 1);
-                        iy1 = std::max(iy - foot_diy, 0);
-                        iy2 = std::min(iy + foot_diy, gydim - 1);
-
-                        /* loop over neighborhood of bins */
-                        for (int ii = ix1; ii <= ix2; ii++)
-                          for (int jj = iy1; jj <= iy2; jj++) {
-                            /* find center of bin in lon lat degrees from sounding center */
-                            kgrid = ii * gydim + jj;
-                            xx = (wbnd[0] + ii * dx + 0.5 * dx - bathlon[ib]);
-                            yy = (wbnd[2] + jj * dy + 0.5 * dy - bathlat[ib]);
-
-                            /* get depth or topo value at this point */
-                            sbath = topofactor * bath[ib];
-
-                            /* get center and corners of bin in meters from sounding center */
-                            if (use_projection) {
-                              xx0 = xx;
-                              yy0 = yy;
-                              bdx = 0.5 * dx;
-                              bdy = 0.5 * dy;
-                            }
-                            else {
-                              xx0 = xx / mtodeglon;
-                              yy0 = yy / mtodeglat;
-                              bdx = 0.5 * dx / mtodeglon;
-                              bdy = 0.5 * dy / mtodeglat;
-                            }
-                            xx1 = xx0 - bdx;
-                            xx2 = xx0 + bdx;
-                            yy1 = yy0 - bdy;
-                            yy2 = yy0 + bdy;
-
-                            /* rotate center and corners of bin to footprint coordinates */
-                            prx[0] = xx0 * foot_dxn + yy0 * foot_dyn;
-                            pry[0] = -xx0 * foot_dyn + yy0 * foot_dxn;
-                            prx[1] = xx1 * foot_dxn + yy1 * foot_dyn;
-                            pry[1] = -xx1 * foot_dyn + yy1 * foot_dxn;
-                            prx[2] = xx2 * foot_dxn + yy1 * foot_dyn;
-                            pry[2] = -xx2 * foot_dyn + yy1 * foot_dxn;
-                            prx[3] = xx1 * foot_dxn + yy2 * foot_dyn;
-                            pry[3] = -xx1 * foot_dyn + yy2 * foot_dxn;
-                            prx[4] = xx2 * foot_dxn + yy2 * foot_dyn;
-                            pry[4] = -xx2 * foot_dyn + yy2 * foot_dxn;
-
-                            /* get weight integrated over bin */
-                            mbgrid_weight(verbose, foot_hwidth, foot_hlength, prx[0], pry[0], bdx,
-                                          bdy, &prx[1], &pry[1], &weight, &use_weight, &error);
-
-                            if (use_weight != MBGRID_USE_NO && weight > 0.000001) {
-                              weight *= file_weight;
-                              norm[kgrid] = norm[kgrid] + weight;
-                              grid[kgrid] = grid[kgrid] + weight * sbath;
-                              sigma[kgrid] = sigma[kgrid] + weight * sbath * sbath;
-                              if (use_weight == MBGRID_USE_YES) {
-                                num[kgrid]++;
-                                if (ii == ix && jj == iy)
-                                  cnt[kgrid]++;
-                              }
-                            }
-                          }
-                        ndata++;
-                        ndatafile++;
-                        if (first) {
-                          first = false;
-                          dmin = topofactor * bath[ib];
-                          dmax = topofactor * bath[ib];
-                        } else {
-                          dmin = std::min(topofactor * bath[ib], dmin);
-                          dmax = std::max(topofactor * bath[ib], dmax);
-                        }
-                      }
+                  if (mb_beam_ok(beamflag[ib]))
+                    mb_proj_forward(verbose, pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib],
+                                    &error);
+              }
 
-                      /* else for xyz data without footprint */
-                      else if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                        kgrid = ix * gydim + iy;
-                        norm[kgrid] = norm[kgrid] + file_weight;
-                        grid[kgrid] = grid[kgrid] + file_weight * topofactor * bath[ib];
-                        sigma[kgrid] =
-                            sigma[kgrid] + file_weight * topofactor * topofactor * bath[ib] * bath[ib];
-                        num[kgrid]++;
-                        cnt[kgrid]++;
-                        ndata++;
-                        ndatafile++;
-                        if (first) {
-                          first = false;
-                          dmin = topofactor * bath[ib];
-                          dmax = topofactor * bath[ib];
-                        } else {
-                          dmin = std::min(topofactor * bath[ib], dmin);
-                          dmax = std::max(topofactor * bath[ib], dmax);
-                        }
-                      }
+              /* deal with data */
+              for (ib = 0; ib < beams_bath; ib++)
+                if (mb_beam_ok(beamflag[ib])) {
+                  /* get position in grid */
+                  ix = (bathlon[ib] - wbnd[0] + dx) / sdx;
+                  iy = (bathlat[ib] - wbnd[2] + dy) / sdy;
+
+                  /* process if in region of interest */
+                  if (ix >= 0 && ix < sxdim
+                      && iy >= 0 && iy < sydim) {
+                    kgrid = ix * sydim + iy;
+                    gridsmall[kgrid] += topofactor * bath[ib];
+                    cnt[kgrid]++;
+                    ndata++;
+                    ndatafile++;
+                    if (first) {
+                      first = false;
+                      dmin = topofactor * bath[ib];
+                      dmax = topofactor * bath[ib];
+                    } else {
+                      dmin = std::min(topofactor * bath[ib], dmin);
+                      dmax = std::max(topofactor * bath[ib], dmax);
                     }
                   }
                 }
@@ -2949,63 +3081,158 @@ int main(int argc, char **argv) {
       dfp = nullptr;
     }
 
-    /* now loop over all points in the output grid */
+    /* now loop over all points in the low resolution grid */
     if (verbose >= 1)
-      fprintf(outfp, "\nMaking raw grid...\n");
-    nbinset = 0;
-    nbinzero = 0;
-    nbinspline = 0;
-    nbinbackground = 0;
-    for (int i = 0; i < gxdim; i++)
-      for (int j = 0; j < gydim; j++) {
-        kgrid = i * gydim + j;
-        if (num[kgrid] > 0) {
-          grid[kgrid] = grid[kgrid] / norm[kgrid];
-          factor = sigma[kgrid] / norm[kgrid] - grid[kgrid] * grid[kgrid];
-          sigma[kgrid] = sqrt(fabs(factor));
-          nbinset++;
-        }
-        else {
-          grid[kgrid] = clipvalue;
-          sigma[kgrid] = 0.0;
+      fprintf(outfp, "\nMaking low resolution slope grid...\n");
+    ndata = 8;
+    for (int i = 0; i < sxdim; i++)
+      for (int j = 0; j < sydim; j++) {
+        kgrid = i * sydim + j;
+        if (cnt[kgrid] > 0) {
+          gridsmall[kgrid] = gridsmall[kgrid] / ((double)cnt[kgrid]);
+          ndata++;
         }
       }
 
-    /***** end of weighted footprint gridding *****/
-  }
-/* -------------------------------------------------------------------------- */
-  /***** else do median filtering gridding *****/
-  else if (grid_mode == MBGRID_MEDIAN_FILTER) {
+/* now fill in the low resolution grid with interpolation */
+#ifdef USESURFACE
+    /* allocate and initialize sgrid */
+    status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&sxdata, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&sydata, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&szdata, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, sxdim * sydim * sizeof(float), (void **)&sgrid, &error);
+    if (error != MB_ERROR_NO_ERROR) {
+      char *message = nullptr;
+      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
+      fprintf(outfp, "\nMBIO Error allocating interpolation work arrays:\n%s\n", message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(error);
+    }
+    memset((char *)sgrid, 0, sxdim * sydim * sizeof(float));
+    memset((char *)sxdata, 0, ndata * sizeof(float));
+    memset((char *)sydata, 0, ndata * sizeof(float));
+    memset((char *)szdata, 0, ndata * sizeof(float));
 
-    /* allocate memory for additional arrays */
-    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double *), (void **)&data, &error);
+    /* get points from grid */
+    /* simultaneously find the depth values nearest to the grid corners and edge midpoints */
+    ndata = 0;
+    for (int i = 0; i < sxdim; i++)
+      for (int j = 0; j < sydim; j++) {
+        kgrid = i * sydim + j;
+        if (cnt[kgrid] > 0) {
+          sxdata[ndata] = (float)(wbnd[0] + sdx * i - bdata_origin_x);
+          sydata[ndata] = (float)(wbnd[2] + sdy * j - bdata_origin_y);
+          szdata[ndata] = (float)gridsmall[kgrid];
+          ndata++;
+        }
+      }
 
-    /* if error initializing memory then quit */
+    /* do the interpolation */
+    fprintf(outfp, "\nDoing Surface spline interpolation with %d data points...\n", ndata);
+    if (n_threads_spline > 1)
+      mb_surface_tiled(verbose, ndata, sxdata, sydata, szdata, (wbnd[0] - bdata_origin_x), (wbnd[1] - bdata_origin_x),
+                       (wbnd[2] - bdata_origin_y), (wbnd[3] - bdata_origin_y), sdx, sdy, tension, 0, 0, n_threads_spline, sgrid);
+    else
+      mb_surface(verbose, ndata, sxdata, sydata, szdata, (wbnd[0] - bdata_origin_x), (wbnd[1] - bdata_origin_x),
+                 (wbnd[2] - bdata_origin_y), (wbnd[3] - bdata_origin_y), sdx, sdy, tension, sgrid);
+#else
+    /* allocate and initialize sgrid */
+    status = mb_mallocd(verbose, __FILE__, __LINE__, 3 * ndata * sizeof(float), (void **)&sdata, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, sxdim * sydim * sizeof(float), (void **)&sgrid, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(float), (void **)&work1, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, ndata * sizeof(int), (void **)&work2, &error);
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, (sxdim + sydim) * sizeof(bool), (void **)&work3, &error);
     if (error != MB_ERROR_NO_ERROR) {
       char *message = nullptr;
-      mb_error(verbose, error, &message);
-      fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
+      mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
+      fprintf(outfp, "\nMBIO Error allocating interpolation work arrays:\n%s\n", message);
       fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
       mb_memory_clear(verbose, &memclear_error);
       exit(error);
     }
+    memset((char *)sgrid, 0, sxdim * sydim * sizeof(float));
+    memset((char *)sdata, 0, 3 * ndata * sizeof(float));
+    memset((char *)work1, 0, ndata * sizeof(float));
+    memset((char *)work2, 0, ndata * sizeof(int));
+    memset((char *)work3, 0, (sxdim + sydim) * sizeof(bool));
+
+    /* get points from grid */
+    /* simultaneously find the depth values nearest to the grid corners and edge midpoints */
+    ndata = 0;
+    for (int i = 0; i < sxdim; i++)
+      for (int j = 0; j < sydim; j++) {
+        kgrid = i * sydim + j;
+        if (cnt[kgrid] > 0) {
+          sdata[ndata++] = (float)(wbnd[0] + sdx * i - bdata_origin_x);
+          sdata[ndata++] = (float)(wbnd[2] + sdy * j - bdata_origin_y);
+          sdata[ndata++] = (float)gridsmall[kgrid];
+        }
+      }
+    ndata = ndata / 3;
+
+    /* do the interpolation */
+    float cay = (float)tension;
+    float xmin = (float)(wbnd[0] - 0.5 * sdx - bdata_origin_x);
+    float ymin = (float)(wbnd[2] - 0.5 * sdy - bdata_origin_y);
+    float ddx = (float)sdx;
+    float ddy = (float)sdy;
+    fprintf(outfp, "\nDoing Zgrid spline interpolation with %d data points...\n", ndata);
+    mb_zgrid2(sgrid, &sxdim, &sydim, &xmin, &ymin, &ddx, &ddy, sdata, &ndata, work1, work2, work3, &cay, &sclip);
+#endif
+
+    // float zflag = 5.0e34f;
+    for (int i = 0; i < sxdim; i++)
+      for (int j = 0; j < sydim; j++) {
+        kgrid = i * sydim + j;
+#ifdef USESURFACE
+        kint = i + (sydim - j - 1) * sxdim;
+#else
+        kint = i + j * sxdim;
+#endif
+        if (cnt[kgrid] == 0) {
+          gridsmall[kgrid] = sgrid[kint];
+        }
+      }
+
+/* deallocate the interpolation arrays */
+#ifdef USESURFACE
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&sxdata, &error);
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&sydata, &error);
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&szdata, &error);
+#else
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&sdata, &error);
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&work1, &error);
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&work2, &error);
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&work3, &error);
+#endif
+    mb_freed(verbose, __FILE__, __LINE__, (void **)&sgrid, &error);
+
+    /* do second pass footprint gridding using slope estimates from first pass interpolated grid */
 
     /* initialize arrays */
     for (int i = 0; i < gxdim; i++)
       for (int j = 0; j < gydim; j++) {
         kgrid = i * gydim + j;
         grid[kgrid] = 0.0;
+        norm[kgrid] = 0.0;
         sigma[kgrid] = 0.0;
         firsttime[kgrid] = 0.0;
-        cnt[kgrid] = 0;
         num[kgrid] = 0;
-        data[kgrid] = nullptr;
+        cnt[kgrid] = 0;
       }
 
     /* read in data */
+    fprintf(outfp, "\nDoing second pass to generate final grid...\n");
     ndata = 0;
-    const int look_processed = MB_DATALIST_LOOK_UNSET;
-    if (mb_datalist_open(verbose, &datalist, filelist, look_processed, &error) != MB_SUCCESS) {
+    if (mb_datalist_open(verbose, &datalist, dfile, look_processed, &error) != MB_SUCCESS) {
       error = MB_ERROR_OPEN_FAIL;
       fprintf(outfp, "\nUnable to open data list file: %s\n", filelist);
       fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
@@ -3027,7 +3254,7 @@ int main(int argc, char **argv) {
         /* check for mbinfo file - get file bounds if possible */
         rformat = format;
         strcpy(rfile, file);
-        status = mb_check_info(verbose, file, lonflip, bounds, &file_in_bounds, &error);
+        status = mb_check_info(verbose, rfile, lonflip, bounds, &file_in_bounds, &error);
         if (status == MB_FAILURE) {
           file_in_bounds = true;
           status = MB_SUCCESS;
@@ -3057,6 +3284,12 @@ int main(int argc, char **argv) {
             exit(error);
           }
 
+          /* get mb_io_ptr */
+          mb_io_ptr = (struct mb_io_struct *)mbio_ptr;
+
+          /* get topography type */
+          status = mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
+
           /* allocate memory for reading data arrays */
           if (error == MB_ERROR_NO_ERROR)
             status = mb_register_array(verbose, mbio_ptr, MB_MEM_TYPE_BATHYMETRY, sizeof(char), (void **)&beamflag,
@@ -3114,90 +3347,22 @@ int main(int argc, char **argv) {
               fprintf(outfp, "dbg2       status:         %d\n", status);
             }
 
-            if ((datatype == MBGRID_DATA_BATHYMETRY || datatype == MBGRID_DATA_TOPOGRAPHY) &&
-                error == MB_ERROR_NO_ERROR) {
-
-              /* reproject beam positions if necessary */
-              if (use_projection) {
-                for (ib = 0; ib < beams_bath; ib++)
-                  if (mb_beam_ok(beamflag[ib]))
-                    mb_proj_forward(verbose, pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib],
-                                    &error);
-              }
-
-              /* deal with data */
-              for (ib = 0; ib < beams_bath; ib++)
-                if (mb_beam_ok(beamflag[ib])) {
-                  ix = (bathlon[ib] - wbnd[0] + 0.5 * dx) / dx;
-                  iy = (bathlat[ib] - wbnd[2] + 0.5 * dy) / dy;
-                  if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                    /* check if within allowed time */
-                    kgrid = ix * gydim + iy;
-                    if (check_time)
-                      time_ok = true;
-                    else {
-                      if (firsttime[kgrid] <= 0.0) {
-                        firsttime[kgrid] = time_d;
-                        time_ok = true;
-                      }
-                      else if (fabs(time_d - firsttime[kgrid]) > timediff) {
-                        if (first_in_stays)
-                          time_ok = false;
-                        else {
-                          time_ok = true;
-                          firsttime[kgrid] = time_d;
-                          ndata = ndata - cnt[kgrid];
-                          ndatafile = ndatafile - cnt[kgrid];
-                          cnt[kgrid] = 0;
-                        }
-                      }
-                      else
-                        time_ok = true;
-                    }
-
-                    /* make sure there is space for the data */
-                    if (time_ok && cnt[kgrid] >= num[kgrid]) {
-                      num[kgrid] += REALLOC_STEP_SIZE;
-                      if ((data[kgrid] = (double *)realloc(data[kgrid], num[kgrid] * sizeof(double))) ==
-                          nullptr) {
-                        error = MB_ERROR_MEMORY_FAIL;
-                        char *message = nullptr;
-                        mb_error(verbose, error, &message);
-                        fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-                        fprintf(outfp, "The weighted mean algorithm uses much less\n");
-                        fprintf(outfp, "memory than the median filter algorithm.\n");
-                        fprintf(outfp, "You could also try using ping averaging to\n");
-                        fprintf(outfp, "reduce the number of data points to be gridded.\n");
-                        fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-                        mb_memory_clear(verbose, &memclear_error);
-                        exit(error);
-                      }
-                    }
-
-                    /* process it */
-                    if (time_ok) {
-                      value = data[kgrid];
-                      value[cnt[kgrid]] = topofactor * bath[ib];
-                      cnt[kgrid]++;
-                      ndata++;
-                      ndatafile++;
-                      if (first) {
-                        first = false;
-                        dmin = topofactor * bath[ib];
-                        dmax = topofactor * bath[ib];
-                      } else {
-                        dmin = std::min(topofactor * bath[ib], dmin);
-                        dmax = std::max(topofactor * bath[ib], dmax);
-                      }
-                    }
-                  }
-                }
-            }
-            else if (datatype == MBGRID_DATA_AMPLITUDE && error == MB_ERROR_NO_ERROR) {
+            if ((datatype == MBGRID_DATA_BATHYMETRY || datatype == MBGRID_DATA_TOPOGRAPHY) &&
+                error == MB_ERROR_NO_ERROR) {
+
+                            /* if needed try again to get topography type */
+                            if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN) {
+                                status = mb_sonartype(verbose, mbio_ptr, mb_io_ptr->store_data, &topo_type, &error);
+                                if (topo_type == MB_TOPOGRAPHY_TYPE_UNKNOWN
+                                    && mb_io_ptr->beamwidth_xtrack > 0.0 && mb_io_ptr->beamwidth_ltrack > 0.0) {
+                                    topo_type = MB_TOPOGRAPHY_TYPE_MULTIBEAM;
+                                }
+                            }
 
               /* reproject beam positions if necessary */
               if (use_projection) {
-                for (ib = 0; ib < beams_amp; ib++)
+                mb_proj_forward(verbose, pjptr, navlon, navlat, &navlon, &navlat, &error);
+                for (ib = 0; ib < beams_bath; ib++)
                   if (mb_beam_ok(beamflag[ib]))
                     mb_proj_forward(verbose, pjptr, bathlon[ib], bathlat[ib], &bathlon[ib], &bathlat[ib],
                                     &error);
@@ -3206,96 +3371,87 @@ int main(int argc, char **argv) {
               /* deal with data */
               for (ib = 0; ib < beams_bath; ib++)
                 if (mb_beam_ok(beamflag[ib])) {
+                  /* get position in grid */
                   ix = (bathlon[ib] - wbnd[0] + 0.5 * dx) / dx;
                   iy = (bathlat[ib] - wbnd[2] + 0.5 * dy) / dy;
-                  if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                    /* check if within allowed time */
-                    kgrid = ix * gydim + iy;
-                    if (!check_time)
-                      time_ok = true;
-                    else {
-                      if (firsttime[kgrid] <= 0.0) {
-                        firsttime[kgrid] = time_d;
-                        time_ok = true;
-                      }
-                      else if (fabs(time_d - firsttime[kgrid]) > timediff) {
-                        if (first_in_stays)
-                          time_ok = false;
-                        else {
-                          time_ok = true;
-                          firsttime[kgrid] = time_d;
-                          ndata = ndata - cnt[kgrid];
-                          ndatafile = ndatafile - cnt[kgrid];
-                          cnt[kgrid] = 0;
-                        }
-                      }
-                      else
-                        time_ok = true;
-                    }
-
-                    /* make sure there is space for the data */
-                    if (time_ok && cnt[kgrid] >= num[kgrid]) {
-                      num[kgrid] += REALLOC_STEP_SIZE;
-                      if ((data[kgrid] = (double *)realloc(data[kgrid], num[kgrid] * sizeof(double))) ==
-                          nullptr) {
-                        error = MB_ERROR_MEMORY_FAIL;
-                        char *message = nullptr;
-                        mb_error(verbose, error, &message);
-                        fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-                        fprintf(outfp, "The weighted mean algorithm uses much less\n");
-                        fprintf(outfp, "memory than the median filter algorithm.\n");
-                        fprintf(outfp, "You could also try using ping averaging to\n");
-                        fprintf(outfp, "reduce the number of data points to be gridded.\n");
-                        fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-                        mb_memory_clear(verbose, &memclear_error);
-                        exit(error);
-                      }
-                    }
 
-                    /* process it */
-                    if (time_ok) {
-                      value = data[kgrid];
-                      value[cnt[kgrid]] = amp[ib];
+                  /* deal with point data without footprint */
+                  if (topo_type != MB_TOPOGRAPHY_TYPE_MULTIBEAM) {
+                    if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
+                      kgrid = ix * gydim + iy;
+                      norm[kgrid] = norm[kgrid] + file_weight;
+                      grid[kgrid] = grid[kgrid] + file_weight * topofactor * bath[ib];
+                      sigma[kgrid] =
+                          sigma[kgrid] + file_weight * topofactor * topofactor * bath[ib] * bath[ib];
+                      num[kgrid]++;
                       cnt[kgrid]++;
                       ndata++;
                       ndatafile++;
                       if (first) {
                         first = false;
-                        dmin = amp[ib];
-                        dmax = amp[ib];
+                        dmin = topofactor * bath[ib];
+                        dmax = topofactor * bath[ib];
                       } else {
-                        dmin = std::min(amp[ib], dmin);
-                        dmax = std::max(amp[ib], dmax);
+                        dmin = std::min(topofactor * bath[ib], dmin);
+                        dmax = std::max(topofactor * bath[ib], dmax);
                       }
                     }
                   }
-                }
-            }
-            else if (datatype == MBGRID_DATA_SIDESCAN && error == MB_ERROR_NO_ERROR) {
 
-              /* reproject pixel positions if necessary */
-              if (use_projection) {
-                for (ib = 0; ib < pixels_ss; ib++)
-                  if (ss[ib] > MB_SIDESCAN_NULL)
-                    mb_proj_forward(verbose, pjptr, sslon[ib], sslat[ib], &sslon[ib], &sslat[ib], &error);
-              }
+                  /* else deal with multibeam data that have beam footprints */
+                  else {
+                    /* get slope from low resolution grid */
+                    int isx = (bathlon[ib] - wbnd[0] + 0.5 * sdx) / sdx;
+                    int isy = (bathlat[ib] - wbnd[2] + 0.5 * sdy) / sdy;
+                    isx = std::min(std::max(isx, 0), sxdim - 1);
+                    isy = std::min(std::max(isy, 0), sydim - 1);
+                    double dzdx;
+                    double dzdy;
+                    if (isx == 0) {
+                      const int k1 = isx * sydim + isy;
+                      const int k2 = (isx + 1) * sydim + isy;
+                      dzdx = (gridsmall[k2] - gridsmall[k1]) / sdx;
+                    } else if (isx == sxdim - 1) {
+                      const int k1 = (isx - 1) * sydim + isy;
+                      const int k2 = isx * sydim + isy;
+                      dzdx = (gridsmall[k2] - gridsmall[k1]) / sdx;
+                    } else {
+                      const int k1 = (isx - 1) * sydim + isy;
+                      const int k2 = (isx + 1) * sydim + isy;
+                      dzdx = (gridsmall[k2] - gridsmall[k1]) / (2.0 * sdx);
+                    }
+                    if (isy == 0) {
+                      const int k1 = isx * sydim + isy;
+                      const int k2 = isx * sydim + (isy + 1);
+                      dzdy = (gridsmall[k2] - gridsmall[k1]) / sdy;
+                    } else if (isy == sydim - 1) {
+                      const int k1 = isx * sydim + (isy - 1);
+                      const int k2 = isx * sydim + isy;
+                      dzdy = (gridsmall[k2] - gridsmall[k1]) / sdy;
+                    } else {
+                      const int k1 = isx * sydim + (isy - 1);
+                      const int k2 = isx * sydim + (isy + 1);
+                      dzdy = (gridsmall[k2] - gridsmall[k1]) / (2.0 * sdy);
+                    }
+
+                    /* check if in region of interest */
+                    if (ix >= 0 && ix < gxdim
+                      && iy >= 0 && iy < gydim) {
+                      region_ok = true;
+                    } else {
+                      region_ok = false;
+                    }
 
-              /* deal with data */
-              for (ib = 0; ib < pixels_ss; ib++)
-                if (ss[ib] > MB_SIDESCAN_NULL) {
-                  ix = (sslon[ib] - wbnd[0] + 0.5 * dx) / dx;
-                  iy = (sslat[ib] - wbnd[2] + 0.5 * dy) / dy;
-                  if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
                     /* check if within allowed time */
-                    kgrid = ix * gydim + iy;
-                    if (!check_time)
-                      time_ok = true;
-                    else {
+                    time_ok = true;
+                    if (region_ok && check_time) {
+                      /* if in region of interest
+                         check if time is ok */
+                      kgrid = ix * gydim + iy;
                       if (firsttime[kgrid] <= 0.0) {
                         firsttime[kgrid] = time_d;
                         time_ok = true;
-                      }
-                      else if (fabs(time_d - firsttime[kgrid]) > timediff) {
+                      } else if (fabs(time_d - firsttime[kgrid]) > timediff) {
                         if (first_in_stays)
                           time_ok = false;
                         else {
@@ -3303,52 +3459,168 @@ int main(int argc, char **argv) {
                           firsttime[kgrid] = time_d;
                           ndata = ndata - cnt[kgrid];
                           ndatafile = ndatafile - cnt[kgrid];
+                          norm[kgrid] = 0.0;
+                          grid[kgrid] = 0.0;
+                          sigma[kgrid] = 0.0;
+                          num[kgrid] = 0;
                           cnt[kgrid] = 0;
                         }
                       }
-                      else
-                        time_ok = true;
                     }
 
-                    /* make sure there is space for the data */
-                    if (time_ok && cnt[kgrid] >= num[kgrid]) {
-                      num[kgrid] += REALLOC_STEP_SIZE;
-                      if ((data[kgrid] = (double *)realloc(data[kgrid], num[kgrid] * sizeof(double))) ==
-                          nullptr) {
-                        error = MB_ERROR_MEMORY_FAIL;
-                        char *message = nullptr;
-                        mb_error(verbose, error, &message);
-                        fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-                        fprintf(outfp, "The weighted mean algorithm uses much less\n");
-                        fprintf(outfp, "memory than the median filter algorithm.\n");
-                        fprintf(outfp, "You could also try using ping averaging to\n");
-                        fprintf(outfp, "reduce the number of data points to be gridded.\n");
-                        fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-                        mb_memory_clear(verbose, &memclear_error);
-                        exit(error);
+                    /* calculate footprint if in region of interest */
+                    if (region_ok && time_ok) {
+                      /* calculate footprint  */
+                      if (use_projection) {
+                        foot_dx = (bathlon[ib] - navlon);
+                        foot_dy = (bathlat[ib] - navlat);
+                      }
+                      else {
+                        foot_dx = (bathlon[ib] - navlon) / mtodeglon;
+                        foot_dy = (bathlat[ib] - navlat) / mtodeglat;
+                      }
+                      foot_lateral = sqrt(foot_dx * foot_dx + foot_dy * foot_dy);
+                      if (foot_lateral > 0.0) {
+                        foot_dxn = foot_dx / foot_lateral;
+                        foot_dyn = foot_dy / foot_lateral;
+                      }
+                      else {
+                        foot_dxn = 1.0;
+                        foot_dyn = 0.0;
+                      }
+                      beam_altitude = bath[ib] - sonardepth;
+                      foot_range = sqrt(foot_lateral * foot_lateral + beam_altitude * beam_altitude);
+                      foot_theta = RTD * atan2(foot_lateral, beam_altitude);
+                      if (foot_range > 0.0 && foot_theta < FOOT_THETA_MAX) {
+                        footprint_ok = true;
+                        foot_dtheta = 0.5 * scale * mb_io_ptr->beamwidth_xtrack;
+                        foot_dphi = 0.5 * scale * mb_io_ptr->beamwidth_ltrack;
+                        if (foot_dtheta <= 0.0)
+                          foot_dtheta = 1.0;
+                        if (foot_dphi <= 0.0)
+                          foot_dphi = 1.0;
+                        foot_hwidth = (bath[ib] - sonardepth) * tan(DTR * (foot_theta + foot_dtheta)) -
+                                      foot_lateral;
+                        foot_hlength = foot_range * tan(DTR * foot_dphi);
+                      } else {
+                        footprint_ok = false;
+                      }
+                    }
+
+                    if (time_ok && region_ok && footprint_ok) {
+                      /* get range of bins around footprint to examine */
+                      if (use_projection) {
+                        foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) / dx);
+                        foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) / dx);
+                        foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) / dy);
+                        foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) / dy);
+                      }
+                      else {
+                        foot_wix = fabs(foot_hwidth * cos(DTR * foot_theta) * mtodeglon / dx);
+                        foot_wiy = fabs(foot_hwidth * sin(DTR * foot_theta) * mtodeglon / dx);
+                        foot_lix = fabs(foot_hlength * sin(DTR * foot_theta) * mtodeglat / dy);
+                        foot_liy = fabs(foot_hlength * cos(DTR * foot_theta) * mtodeglat / dy);
+                      }
+                      foot_dix = 2 * std::max(foot_wix, foot_lix);
+                      foot_diy = 2 * std::max(foot_wiy, foot_liy);
+                      ix1 = std::max(ix - foot_dix, 0);
+                      ix2 = std::min(ix + foot_dix, gxdim - 1);
+                      iy1 = std::max(iy - foot_diy, 0);
+                      iy2 = std::min(iy + foot_diy, gydim - 1);
+
+                      /* loop over neighborhood of bins */
+                      for (int ii = ix1; ii <= ix2; ii++)
+                        for (int jj = iy1; jj <= iy2; jj++) {
+                          /* find center of bin in lon lat degrees from sounding center */
+                          kgrid = ii * gydim + jj;
+                          xx = (wbnd[0] + ii * dx + 0.5 * dx - bathlon[ib]);
+                          yy = (wbnd[2] + jj * dy + 0.5 * dy - bathlat[ib]);
+
+                          /* get depth or topo value at this point using slope estimate */
+                          sbath = topofactor * bath[ib] + dzdx * xx + dzdy * yy;
+
+                          /* get center and corners of bin in meters from sounding center */
+                          if (use_projection) {
+                            xx0 = xx;
+                            yy0 = yy;
+                            bdx = 0.5 * dx;
+                            bdy = 0.5 * dy;
+                          }
+                          else {
+                            xx0 = xx / mtodeglon;
+                            yy0 = yy / mtodeglat;
+                            bdx = 0.5 * dx / mtodeglon;
+                            bdy = 0.5 * dy / mtodeglat;
+                          }
+                          xx1 = xx0 - bdx;
+                          xx2 = xx0 + bdx;
+                          yy1 = yy0 - bdy;
+                          yy2 = yy0 + bdy;
+
+                          /* rotate center and corners of bin to footprint coordinates */
+                          prx[0] = xx0 * foot_dxn + yy0 * foot_dyn;
+                          pry[0] = -xx0 * foot_dyn + yy0 * foot_dxn;
+                          prx[1] = xx1 * foot_dxn + yy1 * foot_dyn;
+                          pry[1] = -xx1 * foot_dyn + yy1 * foot_dxn;
+                          prx[2] = xx2 * foot_dxn + yy1 * foot_dyn;
+                          pry[2] = -xx2 * foot_dyn + yy1 * foot_dxn;
+                          prx[3] = xx1 * foot_dxn + yy2 * foot_dyn;
+                          pry[3] = -xx1 * foot_dyn + yy2 * foot_dxn;
+                          prx[4] = xx2 * foot_dxn + yy2 * foot_dyn;
+                          pry[4] = -xx2 * foot_dyn + yy2 * foot_dxn;
+
+                          /* get weight integrated over bin */
+                          mbgrid_weight(verbose, foot_hwidth, foot_hlength, prx[0], pry[0], bdx,
+                                        bdy, &prx[1], &pry[1], &weight, &use_weight, &error);
+
+                          if (use_weight != MBGRID_USE_NO && weight > 0.000001) {
+                            weight *= file_weight;
+                            norm[kgrid] = norm[kgrid] + weight;
+                            grid[kgrid] = grid[kgrid] + weight * sbath;
+                            sigma[kgrid] = sigma[kgrid] + weight * sbath * sbath;
+                            if (use_weight == MBGRID_USE_YES) {
+                              num[kgrid]++;
+                              if (ii == ix && jj == iy)
+                                cnt[kgrid]++;
+                            }
+                          }
+                        }
+                      ndata++;
+                      ndatafile++;
+                      if (first) {
+                        first = false;
+                        dmin = topofactor * bath[ib];
+                        dmax = topofactor * bath[ib];
+                      } else {
+                        dmin = std::min(topofactor * bath[ib], dmin);
+                        dmax = std::max(topofactor * bath[ib], dmax);
                       }
                     }
 
-                    /* process it */
-                    if (time_ok) {
-                      value = data[kgrid];
-                      value[cnt[kgrid]] = ss[ib];
+                      /* else for xyz data without footprint */
+                    else if (time_ok && region_ok) {
+                      kgrid = ix * gydim + iy;
+                      norm[kgrid] = norm[kgrid] + file_weight;
+                      grid[kgrid] = grid[kgrid] + file_weight * topofactor * bath[ib];
+                      sigma[kgrid] =
+                          sigma[kgrid] + file_weight * topofactor * topofactor * bath[ib] * bath[ib];
+                      num[kgrid]++;
                       cnt[kgrid]++;
                       ndata++;
                       ndatafile++;
                       if (first) {
                         first = false;
-                        dmin = ss[ib];
-                        dmax = ss[ib];
+                        dmin = topofactor * bath[ib];
+                        dmax = topofactor * bath[ib];
                       } else {
-                        dmin = std::min(ss[ib], dmin);
-                        dmax = std::max(ss[ib], dmax);
+                        dmin = std::min(topofactor * bath[ib], dmin);
+                        dmax = std::max(topofactor * bath[ib], dmax);
                       }
                     }
                   }
                 }
+              }
             }
-          }
           mb_close(verbose, &mbio_ptr, &error);
           status = MB_SUCCESS;
           error = MB_ERROR_NO_ERROR;
@@ -3359,111 +3631,69 @@ int main(int argc, char **argv) {
           fprintf(outfp, "%d data points processed in %s (minmax: %f %f)\n", ndatafile, rfile, dmin, dmax);
         else if (file_in_bounds)
           fprintf(outfp, "%d data points processed in %s\n", ndatafile, rfile);
-
-        /* add to datalist if data actually contributed */
-        if (ndatafile > 0 && dfp != nullptr) {
-          if (pstatus == MB_PROCESSED_USE)
-            fprintf(dfp, "P:");
-          else
-            fprintf(dfp, "R:");
-          fprintf(dfp, "%s %d %f\n", path, format, file_weight);
-          fflush(dfp);
-        }
       } /* end if (format > 0) */
+    }
+    if (datalist != nullptr)
+      mb_datalist_close(verbose, &datalist, &error);
+    if (verbose > 0)
+      fprintf(outfp, "\n%d total data points processed\n", ndata);
 
-      /* if format == 0 then input is lon,lat,values triples file */
-      else if (format == 0 && path[0] != '#') {
-
-        /* open data file */
-        if ((rfp = fopen(path, "r")) == nullptr) {
-          error = MB_ERROR_OPEN_FAIL;
-          fprintf(outfp, "\nUnable to open lon,lat,value triples data path: %s\n", path);
-          fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-          mb_memory_clear(verbose, &memclear_error);
-          exit(error);
+    /* now loop over all points in the output grid */
+    if (verbose >= 1)
+      fprintf(outfp, "\nMaking raw grid...\n");
+    nbinset = 0;
+    nbinzero = 0;
+    nbinspline = 0;
+    nbinbackground = 0;
+    for (int i = 0; i < gxdim; i++)
+      for (int j = 0; j < gydim; j++) {
+        kgrid = i * gydim + j;
+        if (num[kgrid] > 0) {
+          grid[kgrid] = grid[kgrid] / norm[kgrid];
+          factor = sigma[kgrid] / norm[kgrid] - grid[kgrid] * grid[kgrid];
+          sigma[kgrid] = sqrt(fabs(factor));
+          nbinset++;
+        }
+        else {
+          grid[kgrid] = clipvalue;
+          sigma[kgrid] = 0.0;
         }
+      }
 
-        /* loop over reading */
-        bool first = true;
-        double dmin = 0.0;
-        double dmax = 0.0;
-        while (fscanf(rfp, "%lf %lf %lf", &tlon, &tlat, &tvalue) != EOF) {
-          /* reproject data positions if necessary */
-          if (use_projection)
-            mb_proj_forward(verbose, pjptr, tlon, tlat, &tlon, &tlat, &error);
+    /***** end of weighted footprint slope gridding *****/
+  }
 
-          /* get position in grid */
-          ix = (tlon - wbnd[0] + 0.5 * dx) / dx;
-          iy = (tlat - wbnd[2] + 0.5 * dy) / dy;
-          if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-            /* check if overwriting */
-            kgrid = ix * gydim + iy;
-            if (!check_time)
-              time_ok = true;
-            else {
-              if (firsttime[kgrid] > 0.0)
-                time_ok = false;
-              else
-                time_ok = true;
-            }
+/* -------------------------------------------------------------------------- */
+  /***** do weighted footprint gridding *****/
+  else if (grid_mode == MBGRID_WEIGHTED_FOOTPRINT) {
 
-            /* make sure there is space for the data */
-            if (time_ok && cnt[kgrid] >= num[kgrid]) {
-              num[kgrid] += REALLOC_STEP_SIZE;
-              if ((data[kgrid] = (double *)realloc(data[kgrid], num[kgrid] * sizeof(double))) == nullptr) {
-                error = MB_ERROR_MEMORY_FAIL;
-                char *message = nullptr;
-                mb_error(verbose, error, &message);
-                fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
-                fprintf(outfp, "The weighted mean algorithm uses much less\n");
-                fprintf(outfp, "memory than the median filter algorithm.\n");
-                fprintf(outfp, "You could also try using ping averaging to\n");
-                fprintf(outfp, "reduce the number of data points to be gridded.\n");
-                fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-                mb_memory_clear(verbose, &memclear_error);
-                exit(error);
-              }
-            }
+    /* allocate memory for additional arrays */
+    status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&norm, &error);
 
-            /* process it */
-            if (time_ok) {
-              value = data[kgrid];
-              value[cnt[kgrid]] = topofactor * tvalue;
-              cnt[kgrid]++;
-              ndata++;
-              ndatafile++;
-              if (first) {
-                first = false;
-                dmin = topofactor * tvalue;
-                dmax = topofactor * tvalue;
-              } else {
-                dmin = std::min(topofactor * tvalue, dmin);
-                dmax = std::max(topofactor * tvalue, dmax);
-              }
-            }
-          }
-        }
-        fclose(rfp);
-        status = MB_SUCCESS;
-        error = MB_ERROR_NO_ERROR;
-        if (verbose >= 2)
-          fprintf(outfp, "\n");
-        if (verbose > 0)
-          fprintf(outfp, "%d data points processed in %s (minmax: %f %f)\n", ndatafile, file, dmin, dmax);
-        else if (ndatafile > 0)
-          fprintf(outfp, "%d data points processed in %s\n", ndatafile, file);
+    /* initialize arrays */
+    for (int i = 0; i < gxdim; i++)
+      for (int j = 0; j < gydim; j++) {
+        kgrid = i * gydim + j;
+        grid[kgrid] = 0.0;
+        norm[kgrid] = 0.0;
+        sigma[kgrid] = 0.0;
+        firsttime[kgrid] = 0.0;
+        num[kgrid] = 0;
+        cnt[kgrid] = 0;
+      }
 
-        /* add to datalist if data actually contributed */
-        if (ndatafile > 0 && dfp != nullptr) {
-          if (pstatus == MB_PROCESSED_USE)
-            fprintf(dfp, "P:");
-          else
-            fprintf(dfp, "R:");
-          fprintf(dfp, "%s %d %f\n", path, format, file_weight);
-          fflush(dfp);
-        }
-      } /* end if (format == 0) */
+    /* read in data */
+    fprintf(outfp, "\nDoing single pass to generate grid...\n");
+    ndata = 0;
+    const int look_processed = MB_DATALIST_LOOK_UNSET;
+    if (mb_datalist_open(verbose, &datalist, filelist, look_processed, &error) != MB_SUCCESS) {
+      error = MB_ERROR_OPEN_FAIL;
+      fprintf(outfp, "\nUnable to open data list file: %s\n", filelist);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(error);
     }
+    ndata = mbgrid_read_threaded(&control, datalist, n_threads, dfp, grid, norm, sigma, num, cnt, &error);
     if (datalist != nullptr)
       mb_datalist_close(verbose, &datalist, &error);
     if (verbose > 0)
@@ -3485,43 +3715,27 @@ int main(int argc, char **argv) {
     for (int i = 0; i < gxdim; i++)
       for (int j = 0; j < gydim; j++) {
         kgrid = i * gydim + j;
-        if (cnt[kgrid] > 0) {
-          value = data[kgrid];
-          qsort((char *)value, cnt[kgrid], sizeof(double), mb_double_compare);
-          grid[kgrid] = value[cnt[kgrid] / 2];
-          sigma[kgrid] = 0.0;
-          for (int k = 0; k < cnt[kgrid]; k++)
-            sigma[kgrid] += (value[k] - grid[kgrid]) * (value[k] - grid[kgrid]);
-          if (cnt[kgrid] > 1)
-            sigma[kgrid] = sqrt(sigma[kgrid] / (cnt[kgrid] - 1));
-          else
-            sigma[kgrid] = 0.0;
+        if (num[kgrid] > 0) {
+          grid[kgrid] = grid[kgrid] / norm[kgrid];
+          factor = sigma[kgrid] / norm[kgrid] - grid[kgrid] * grid[kgrid];
+          sigma[kgrid] = sqrt(fabs(factor));
           nbinset++;
         }
-        else
+        else {
           grid[kgrid] = clipvalue;
+          sigma[kgrid] = 0.0;
+        }
       }
 
-    /* now deallocate space for the data */
-    for (int i = 0; i < gxdim; i++)
-      for (int j = 0; j < gydim; j++) {
-        kgrid = i * gydim + j;
-        if (cnt[kgrid] > 0)
-          free(data[kgrid]);
-      }
-
-    /***** end of median filter gridding *****/
+    /***** end of weighted footprint gridding *****/
   }
 /* -------------------------------------------------------------------------- */
+  /***** else do median filtering gridding *****/
+  else if (grid_mode == MBGRID_MEDIAN_FILTER) {
 
-  /***** do weighted mean or min/max gridding *****/
-  else if (grid_mode == MBGRID_WEIGHTED_MEAN
-            || grid_mode == MBGRID_MINIMUM_FILTER
-            || grid_mode == MBGRID_MAXIMUM_FILTER) {
-
-    /* allocate memory for additional arrays */
-    if (status == MB_SUCCESS)
-      status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&norm, &error);
+    /* allocate memory for buffering soundings */
+    struct mbgrid_median_struct median;
+    status = mbgrid_median_init(verbose, (size_t)median_memory * 1024 * 1024, &median, &error);
 
     /* if error initializing memory then quit */
     if (error != MB_ERROR_NO_ERROR) {
@@ -3538,11 +3752,10 @@ int main(int argc, char **argv) {
       for (int j = 0; j < gydim; j++) {
         kgrid = i * gydim + j;
         grid[kgrid] = 0.0;
-        norm[kgrid] = 0.0;
         sigma[kgrid] = 0.0;
         firsttime[kgrid] = 0.0;
-        num[kgrid] = 0;
         cnt[kgrid] = 0;
+        num[kgrid] = 0;
       }
 
     /* read in data */
@@ -3570,7 +3783,7 @@ int main(int argc, char **argv) {
         /* check for mbinfo file - get file bounds if possible */
         rformat = format;
         strcpy(rfile, file);
-        status = mb_check_info(verbose, rfile, lonflip, bounds, &file_in_bounds, &error);
+        status = mb_check_info(verbose, file, lonflip, bounds, &file_in_bounds, &error);
         if (status == MB_FAILURE) {
           file_in_bounds = true;
           status = MB_SUCCESS;
@@ -3671,19 +3884,14 @@ int main(int argc, char **argv) {
               /* deal with data */
               for (ib = 0; ib < beams_bath; ib++)
                 if (mb_beam_ok(beamflag[ib])) {
-                  /* get position in grid */
                   ix = (bathlon[ib] - wbnd[0] + 0.5 * dx) / dx;
                   iy = (bathlat[ib] - wbnd[2] + 0.5 * dy) / dy;
-                  /* if (ib==beams_bath/2)fprintf(outfp, "ib:%d ix:%d iy:%d   bath: lon:%.10f lat:%.10f bath:%f
-                  dx:%.10f dy:%.10f  origin: lon:%.10f lat:%.10f\n", ib, ix, iy, bathlon[ib], bathlat[ib],
-                  bath[ib], dx, dy, wbnd[0], wbnd[1]); */
-
-                  /* check if within allowed time */
-                  if (check_time) {
-                    /* if in region of interest
-                       check if time is ok */
-                    if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                      kgrid = ix * gydim + iy;
+                  if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
+                    /* check if within allowed time */
+                    kgrid = ix * gydim + iy;
+                    if (check_time)
+                      time_ok = true;
+                    else {
                       if (firsttime[kgrid] <= 0.0) {
                         firsttime[kgrid] = time_d;
                         time_ok = true;
@@ -3696,77 +3904,37 @@ int main(int argc, char **argv) {
                           firsttime[kgrid] = time_d;
                           ndata = ndata - cnt[kgrid];
                           ndatafile = ndatafile - cnt[kgrid];
-                          norm[kgrid] = 0.0;
-                          grid[kgrid] = 0.0;
-                          sigma[kgrid] = 0.0;
-                          num[kgrid] = 0;
                           cnt[kgrid] = 0;
+                          num[kgrid]++;
                         }
                       }
                       else
                         time_ok = true;
                     }
-                    else
-                      time_ok = true;
-                  }
-                  else
-                    time_ok = true;
 
-                  /* process if in region of interest */
-                  if (grid_mode == MBGRID_WEIGHTED_MEAN
-                      && ix >= 0 && ix < gxdim
-                      && iy >= 0 && iy < gydim && time_ok) {
-                    ix1 = std::max(ix - xtradim, 0);
-                    ix2 = std::min(ix + xtradim, gxdim - 1);
-                    iy1 = std::max(iy - xtradim, 0);
-                    iy2 = std::min(iy + xtradim, gydim - 1);
-                    for (int ii = ix1; ii <= ix2; ii++)
-                      for (int jj = iy1; jj <= iy2; jj++) {
-                        kgrid = ii * gydim + jj;
-                        xx = wbnd[0] + ii * dx - bathlon[ib];
-                        yy = wbnd[2] + jj * dy - bathlat[ib];
-                        weight = file_weight * exp(-(xx * xx + yy * yy) * factor);
-                        norm[kgrid] = norm[kgrid] + weight;
-                        grid[kgrid] = grid[kgrid] + weight * topofactor * bath[ib];
-                        sigma[kgrid] =
-                            sigma[kgrid] + weight * topofactor * topofactor * bath[ib] * bath[ib];
-                        num[kgrid]++;
-                        if (ii == ix && jj == iy)
-                          cnt[kgrid]++;
+
+                    /* process it */
+                    if (time_ok) {
+                      if (mbgrid_median_add(verbose, &median, kgrid, num[kgrid], topofactor * bath[ib],
+                                            &error) != MB_SUCCESS) {
+                        char *message = nullptr;
+                        mb_error(verbose, error, &message);
+                        fprintf(outfp, "\nMBIO Error writing median filter data to temporary file:\n%s\n", message);
+                        fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+                        mb_memory_clear(verbose, &memclear_error);
+                        exit(error);
+                      }
+                      cnt[kgrid]++;
+                      ndata++;
+                      ndatafile++;
+                      if (first) {
+                        first = false;
+                        dmin = topofactor * bath[ib];
+                        dmax = topofactor * bath[ib];
+                      } else {
+                        dmin = std::min(topofactor * bath[ib], dmin);
+                        dmax = std::max(topofactor * bath[ib], dmax);
                       }
-                    ndata++;
-                    ndatafile++;
-                    if (first) {
-                      first = false;
-                      dmin = topofactor * bath[ib];
-                      dmax = topofactor * bath[ib];
-                    } else {
-                      dmin = std::min(topofactor * bath[ib], dmin);
-                      dmax = std::max(topofactor * bath[ib], dmax);
-                    }
-                  }
-                  else if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim && time_ok) {
-                    kgrid = ix * gydim + iy;
-                    if ((num[kgrid] > 0 && grid_mode == MBGRID_MINIMUM_FILTER &&
-                         grid[kgrid] > topofactor * bath[ib]) ||
-                        (num[kgrid] > 0 && grid_mode == MBGRID_MAXIMUM_FILTER &&
-                         grid[kgrid] < topofactor * bath[ib]) ||
-                        num[kgrid] <= 0) {
-                      norm[kgrid] = 1.0;
-                      grid[kgrid] = topofactor * bath[ib];
-                      sigma[kgrid] = topofactor * topofactor * bath[ib] * bath[ib];
-                      num[kgrid] = 1;
-                      cnt[kgrid] = 1;
-                    }
-                    ndata++;
-                    ndatafile++;
-                    if (first) {
-                      first = false;
-                      dmin = topofactor * bath[ib];
-                      dmax = topofactor * bath[ib];
-                    } else {
-                      dmin = std::min(topofactor * bath[ib], dmin);
-                      dmax = std::max(topofactor * bath[ib], dmax);
                     }
                   }
                 }
@@ -3782,18 +3950,16 @@ int main(int argc, char **argv) {
               }
 
               /* deal with data */
-              for (ib = 0; ib < beams_amp; ib++)
+              for (ib = 0; ib < beams_bath; ib++)
                 if (mb_beam_ok(beamflag[ib])) {
-                  /* get position in grid */
                   ix = (bathlon[ib] - wbnd[0] + 0.5 * dx) / dx;
                   iy = (bathlat[ib] - wbnd[2] + 0.5 * dy) / dy;
-
-                  /* check if within allowed time */
-                  if (check_time) {
-                    /* if in region of interest
-                       check if time is ok */
-                    if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                      kgrid = ix * gydim + iy;
+                  if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
+                    /* check if within allowed time */
+                    kgrid = ix * gydim + iy;
+                    if (!check_time)
+                      time_ok = true;
+                    else {
                       if (firsttime[kgrid] <= 0.0) {
                         firsttime[kgrid] = time_d;
                         time_ok = true;
@@ -3806,74 +3972,36 @@ int main(int argc, char **argv) {
                           firsttime[kgrid] = time_d;
                           ndata = ndata - cnt[kgrid];
                           ndatafile = ndatafile - cnt[kgrid];
-                          norm[kgrid] = 0.0;
-                          grid[kgrid] = 0.0;
-                          sigma[kgrid] = 0.0;
-                          num[kgrid] = 0;
                           cnt[kgrid] = 0;
+                          num[kgrid]++;
                         }
                       }
                       else
                         time_ok = true;
                     }
-                    else
-                      time_ok = true;
-                  }
-                  else
-                    time_ok = true;
 
-                  /* process if in region of interest */
-                  if (grid_mode == MBGRID_WEIGHTED_MEAN
-                      && ix >= 0 && ix < gxdim
-                      && iy >= 0 && iy < gydim && time_ok) {
-                    ix1 = std::max(ix - xtradim, 0);
-                    ix2 = std::min(ix + xtradim, gxdim - 1);
-                    iy1 = std::max(iy - xtradim, 0);
-                    iy2 = std::min(iy + xtradim, gydim - 1);
-                    for (int ii = ix1; ii <= ix2; ii++)
-                      for (int jj = iy1; jj <= iy2; jj++) {
-                        kgrid = ii * gydim + jj;
-                        xx = wbnd[0] + ii * dx - bathlon[ib];
-                        yy = wbnd[2] + jj * dy - bathlat[ib];
-                        weight = file_weight * exp(-(xx * xx + yy * yy) * factor);
-                        norm[kgrid] = norm[kgrid] + weight;
-                        grid[kgrid] = grid[kgrid] + weight * amp[ib];
-                        sigma[kgrid] = sigma[kgrid] + weight * amp[ib] * amp[ib];
-                        num[kgrid]++;
-                        if (ii == ix && jj == iy)
-                          cnt[kgrid]++;
+
+                    /* process it */
+                    if (time_ok) {
+                      if (mbgrid_median_add(verbose, &median, kgrid, num[kgrid], amp[ib], &error) != MB_SUCCESS) {
+                        char *message = nullptr;
+                        mb_error(verbose, error, &message);
+                        fprintf(outfp, "\nMBIO Error writing median filter data to temporary file:\n%s\n", message);
+                        fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+                        mb_memory_clear(verbose, &memclear_error);
+                        exit(error);
+                      }
+                      cnt[kgrid]++;
+                      ndata++;
+                      ndatafile++;
+                      if (first) {
+                        first = false;
+                        dmin = amp[ib];
+                        dmax = amp[ib];
+                      } else {
+                        dmin = std::min(amp[ib], dmin);
+                        dmax = std::max(amp[ib], dmax);
                       }
-                    ndata++;
-                    ndatafile++;
-                    if (first) {
-                      first = false;
-                      dmin = topofactor * bath[ib];
-                      dmax = topofactor * bath[ib];
-                    } else {
-                      dmin = std::min(topofactor * bath[ib], dmin);
-                      dmax = std::max(topofactor * bath[ib], dmax);
-                    }
-                  }
-                  else if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim && time_ok) {
-                    kgrid = ix * gydim + iy;
-                    if ((num[kgrid] > 0 && grid_mode == MBGRID_MINIMUM_FILTER && grid[kgrid] > amp[ib]) ||
-                        (num[kgrid] > 0 && grid_mode == MBGRID_MAXIMUM_FILTER && grid[kgrid] < amp[ib]) ||
-                        num[kgrid] <= 0) {
-                      norm[kgrid] = 1.0;
-                      grid[kgrid] = amp[ib];
-                      sigma[kgrid] = amp[ib] * amp[ib];
-                      num[kgrid] = 1;
-                      cnt[kgrid] = 1;
-                    }
-                    ndata++;
-                    ndatafile++;
-                    if (first) {
-                      first = false;
-                      dmin = amp[ib];
-                      dmax = amp[ib];
-                    } else {
-                      dmin = std::min(amp[ib], dmin);
-                      dmax = std::max(amp[ib], dmax);
                     }
                   }
                 }
@@ -3890,16 +4018,14 @@ int main(int argc, char **argv) {
               /* deal with data */
               for (ib = 0; ib < pixels_ss; ib++)
                 if (ss[ib] > MB_SIDESCAN_NULL) {
-                  /* get position in grid */
                   ix = (sslon[ib] - wbnd[0] + 0.5 * dx) / dx;
                   iy = (sslat[ib] - wbnd[2] + 0.5 * dy) / dy;
-
-                  /* check if within allowed time */
-                  if (check_time) {
-                    /* if in region of interest
-                       check if time is ok */
-                    if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-                      kgrid = ix * gydim + iy;
+                  if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
+                    /* check if within allowed time */
+                    kgrid = ix * gydim + iy;
+                    if (!check_time)
+                      time_ok = true;
+                    else {
                       if (firsttime[kgrid] <= 0.0) {
                         firsttime[kgrid] = time_d;
                         time_ok = true;
@@ -3912,59 +4038,37 @@ int main(int argc, char **argv) {
                           firsttime[kgrid] = time_d;
                           ndata = ndata - cnt[kgrid];
                           ndatafile = ndatafile - cnt[kgrid];
-                          norm[kgrid] = 0.0;
-                          grid[kgrid] = 0.0;
-                          sigma[kgrid] = 0.0;
-                          num[kgrid] = 0;
                           cnt[kgrid] = 0;
+                          num[kgrid]++;
                         }
                       }
                       else
                         time_ok = true;
                     }
-                    else
-                      time_ok = true;
-                  }
-                  else
-                    time_ok = true;
 
-                  /* process if in region of interest */
-                  if (grid_mode == MBGRID_WEIGHTED_MEAN
-                      && ix >= 0 && ix < gxdim
-                      && iy >= 0 && iy < gydim && time_ok) {
-                    ix1 = std::max(ix - xtradim, 0);
-                    ix2 = std::min(ix + xtradim, gxdim - 1);
-                    iy1 = std::max(iy - xtradim, 0);
-                    iy2 = std::min(iy + xtradim, gydim - 1);
-                    for (int ii = ix1; ii <= ix2; ii++)
-                      for (int jj = iy1; jj <= iy2; jj++) {
-                        kgrid = ii * gydim + jj;
-                        xx = wbnd[0] + ii * dx - sslon[ib];
-                        yy = wbnd[2] + jj * dy - sslat[ib];
-                        weight = file_weight * exp(-(xx * xx + yy * yy) * factor);
-                        norm[kgrid] = norm[kgrid] + weight;
-                        grid[kgrid] = grid[kgrid] + weight * ss[ib];
-                        sigma[kgrid] = sigma[kgrid] + weight * ss[ib] * ss[ib];
-                        num[kgrid]++;
-                        if (ii == ix && jj == iy)
-                          cnt[kgrid]++;
+
+                    /* process it */
+                    if (time_ok) {
+                      if (mbgrid_median_add(verbose, &median, kgrid, num[kgrid], ss[ib], &error) != MB_SUCCESS) {
+                        char *message = nullptr;
+                        mb_error(verbose, error, &message);
+                        fprintf(outfp, "\nMBIO Error writing median filter data to temporary file:\n%s\n", message);
+                        fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+                        mb_memory_clear(verbose, &memclear_error);
+                        exit(error);
+                      }
+                      cnt[kgrid]++;
+                      ndata++;
+                      ndatafile++;
+                      if (first) {
+                        first = false;
+                        dmin = ss[ib];
+                        dmax = ss[ib];
+                      } else {
+                        dmin = std::min(ss[ib], dmin);
+                        dmax = std::max(ss[ib], dmax);
                       }
-                    ndata++;
-                    ndatafile++;
-                  }
-                  else if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim && time_ok) {
-                    kgrid = ix * gydim + iy;
-                    if ((num[kgrid] > 0 && grid_mode == MBGRID_MINIMUM_FILTER && grid[kgrid] > ss[ib]) ||
-                        (num[kgrid] > 0 && grid_mode == MBGRID_MAXIMUM_FILTER && grid[kgrid] < ss[ib]) ||
-                        num[kgrid] <= 0) {
-                      norm[kgrid] = 1.0;
-                      grid[kgrid] = ss[ib];
-                      sigma[kgrid] = ss[ib] * ss[ib];
-                      num[kgrid] = 1;
-                      cnt[kgrid] = 1;
                     }
-                    ndata++;
-                    ndatafile++;
                   }
                 }
             }
@@ -3993,10 +4097,11 @@ int main(int argc, char **argv) {
 
       /* if format == 0 then input is lon,lat,values triples file */
       else if (format == 0 && path[0] != '#') {
+
         /* open data file */
         if ((rfp = fopen(path, "r")) == nullptr) {
           error = MB_ERROR_OPEN_FAIL;
-          fprintf(outfp, "\nUnable to open lon,lat,value triples data file1: %s\n", path);
+          fprintf(outfp, "\nUnable to open lon,lat,value triples data path: %s\n", path);
           fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
           mb_memory_clear(verbose, &memclear_error);
           exit(error);
@@ -4014,60 +4119,41 @@ int main(int argc, char **argv) {
           /* get position in grid */
           ix = (tlon - wbnd[0] + 0.5 * dx) / dx;
           iy = (tlat - wbnd[2] + 0.5 * dy) / dy;
-
-          /* check if overwriting */
-          if (check_time) {
-            /* if in region of interest
-               check if overwriting */
-            if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
-              kgrid = ix * gydim + iy;
+          if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim) {
+            /* check if overwriting */
+            kgrid = ix * gydim + iy;
+            if (!check_time)
+              time_ok = true;
+            else {
               if (firsttime[kgrid] > 0.0)
                 time_ok = false;
               else
                 time_ok = true;
             }
-            else
-              time_ok = true;
-          }
-          else
-            time_ok = true;
-
-          /* process the data */
-          if (grid_mode == MBGRID_WEIGHTED_MEAN && ix >= -xtradim && ix < gxdim + xtradim && iy >= -xtradim &&
-              iy < gydim + xtradim && time_ok) {
-            ix1 = std::max(ix - xtradim, 0);
-            ix2 = std::min(ix + xtradim, gxdim - 1);
-            iy1 = std::max(iy - xtradim, 0);
-            iy2 = std::min(iy + xtradim, gydim - 1);
-            for (int ii = ix1; ii <= ix2; ii++)
-              for (int jj = iy1; jj <= iy2; jj++) {
-                kgrid = ii * gydim + jj;
-                xx = wbnd[0] + ii * dx - tlon;
-                yy = wbnd[2] + jj * dy - tlat;
-                weight = file_weight * exp(-(xx * xx + yy * yy) * factor);
-                norm[kgrid] = norm[kgrid] + weight;
-                grid[kgrid] = grid[kgrid] + weight * topofactor * tvalue;
-                sigma[kgrid] = sigma[kgrid] + weight * topofactor * topofactor * tvalue * tvalue;
-                num[kgrid]++;
-                if (ii == ix && jj == iy)
-                  cnt[kgrid]++;
+
+
+            /* process it */
+            if (time_ok) {
+              if (mbgrid_median_add(verbose, &median, kgrid, num[kgrid], topofactor * tvalue, &error) != MB_SUCCESS) {
+                char *message = nullptr;
+                mb_error(verbose, error, &message);
+                fprintf(outfp, "\nMBIO Error writing median filter data to temporary file:\n%s\n", message);
+                fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+                mb_memory_clear(verbose, &memclear_error);
+                exit(error);
+              }
+              cnt[kgrid]++;
+              ndata++;
+              ndatafile++;
+              if (first) {
+                first = false;
+                dmin = topofactor * tvalue;
+                dmax = topofactor * tvalue;
+              } else {
+                dmin = std::min(topofactor * tvalue, dmin);
+                dmax = std::max(topofactor * tvalue, dmax);
               }
-            ndata++;
-            ndatafile++;
-          }
-          else if (ix >= 0 && ix < gxdim && iy >= 0 && iy < gydim && time_ok) {
-            kgrid = ix * gydim + iy;
-            if ((num[kgrid] > 0 && grid_mode == MBGRID_MINIMUM_FILTER && grid[kgrid] > topofactor * tvalue) ||
-                (num[kgrid] > 0 && grid_mode == MBGRID_MAXIMUM_FILTER && grid[kgrid] < topofactor * tvalue) ||
-                num[kgrid] <= 0) {
-              norm[kgrid] = 1.0;
-              grid[kgrid] = topofactor * tvalue;
-              sigma[kgrid] = topofactor * topofactor * tvalue * tvalue;
-              num[kgrid] = 1;
-              cnt[kgrid] = 1;
             }
-            ndata++;
-            ndatafile++;
           }
         }
         fclose(rfp);
@@ -4102,6 +4188,83 @@ int main(int argc, char **argv) {
       dfp = nullptr;
     }
 
+    /* now loop over all points in the output grid */
+    if (verbose >= 1)
+      fprintf(outfp, "\nMaking raw grid...\n");
+    nbinzero = 0;
+    nbinspline = 0;
+    nbinbackground = 0;
+    status = mbgrid_median_grid(verbose, &median, median_percentile, gxdim, gydim, num, clipvalue, grid, sigma, cnt,
+                                &nbinset, &error);
+    if (status != MB_SUCCESS) {
+      char *message = nullptr;
+      mb_error(verbose, error, &message);
+      fprintf(outfp, "\nMBIO Error reading median filter data:\n%s\n", message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(error);
+    }
+
+    /* now deallocate space for the data */
+    mbgrid_median_free(verbose, &median, &error);
+
+    /***** end of median filter gridding *****/
+  }
+/* -------------------------------------------------------------------------- */
+
+  /***** do weighted mean or min/max gridding *****/
+  else if (grid_mode == MBGRID_WEIGHTED_MEAN
+            || grid_mode == MBGRID_MINIMUM_FILTER
+            || grid_mode == MBGRID_MAXIMUM_FILTER) {
+
+    /* allocate memory for additional arrays */
+    if (status == MB_SUCCESS)
+      status = mb_mallocd(verbose, __FILE__, __LINE__, gxdim * gydim * sizeof(double), (void **)&norm, &error);
+
+    /* if error initializing memory then quit */
+    if (error != MB_ERROR_NO_ERROR) {
+      char *message = nullptr;
+      mb_error(verbose, error, &message);
+      fprintf(outfp, "\nMBIO Error allocating data arrays:\n%s\n", message);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(error);
+    }
+
+    /* initialize arrays */
+    for (int i = 0; i < gxdim; i++)
+      for (int j = 0; j < gydim; j++) {
+        kgrid = i * gydim + j;
+        grid[kgrid] = 0.0;
+        norm[kgrid] = 0.0;
+        sigma[kgrid] = 0.0;
+        firsttime[kgrid] = 0.0;
+        num[kgrid] = 0;
+        cnt[kgrid] = 0;
+      }
+
+    /* read in data */
+    ndata = 0;
+    const int look_processed = MB_DATALIST_LOOK_UNSET;
+    if (mb_datalist_open(verbose, &datalist, filelist, look_processed, &error) != MB_SUCCESS) {
+      error = MB_ERROR_OPEN_FAIL;
+      fprintf(outfp, "\nUnable to open data list file: %s\n", filelist);
+      fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
+      mb_memory_clear(verbose, &memclear_error);
+      exit(error);
+    }
+    ndata = mbgrid_read_threaded(&control, datalist, n_threads, dfp, grid, norm, sigma, num, cnt, &error);
+    if (datalist != nullptr)
+      mb_datalist_close(verbose, &datalist, &error);
+    if (verbose > 0)
+      fprintf(outfp, "\n%d total data points processed\n", ndata);
+
+    /* close datalist if necessary */
+    if (dfp != nullptr) {
+      fclose(dfp);
+      dfp = nullptr;
+    }
+
     /* now loop over all points in the output grid */
     if (verbose >= 1)
       fprintf(outfp, "\nMaking raw grid...\n");
@@ -5088,8 +5251,13 @@ int main(int argc, char **argv) {
 
     /* do the interpolation */
     fprintf(outfp, "\nDoing Surface spline interpolation with %d data points...\n", ndata);
-    mb_surface(verbose, ndata, sxdata, sydata, szdata, (float)(gbnd[0] - bdata_origin_x), (float)(gbnd[1] - bdata_origin_x),
-               (float)(gbnd[2] - bdata_origin_y), (float)(gbnd[3] - bdata_origin_y), dx, dy, tension, sgrid);
+    if (n_threads_spline > 1)
+      mb_surface_tiled(verbose, ndata, sxdata, sydata, szdata, (float)(gbnd[0] - bdata_origin_x),
+                       (float)(gbnd[1] - bdata_origin_x), (float)(gbnd[2] - bdata_origin_y), (float)(gbnd[3] - bdata_origin_y),
+                       dx, dy, tension, 0, 0, n_threads_spline, sgrid);
+    else
+      mb_surface(verbose, ndata, sxdata, sydata, szdata, (float)(gbnd[0] - bdata_origin_x), (float)(gbnd[1] - bdata_origin_x),
+                 (float)(gbnd[2] - bdata_origin_y), (float)(gbnd[3] - bdata_origin_y), dx, dy, tension, sgrid);
 #else
     /* allocate and initialize sgrid */
     status = mb_mallocd(verbose, __FILE__, __LINE__, 3 * ndata * sizeof(float), (void **)&sdata, &error);
@@ -5443,9 +5611,14 @@ int main(int argc, char **argv) {
     /* do the interpolation */
     fprintf(outfp, "\nDoing spline interpolation with %d background points...\n", nbackground);
 #ifdef USESURFACE
-    mb_surface(verbose, nbackground, bxdata, bydata, bzdata, (float)(wbnd[0] - bdata_origin_x),
-               (float)(wbnd[1] - bdata_origin_x), (float)(wbnd[2] - bdata_origin_y), (float)(wbnd[3] - bdata_origin_y), dx,
-               dy, tension, sgrid);
+    if (n_threads_spline > 1)
+      mb_surface_tiled(verbose, nbackground, bxdata, bydata, bzdata, (float)(wbnd[0] - bdata_origin_x),
+                       (float)(wbnd[1] - bdata_origin_x), (float)(wbnd[2] - bdata_origin_y), (float)(wbnd[3] - bdata_origin_y),
+                       dx, dy, tension, 0, 0, n_threads_spline, sgrid);
+    else
+      mb_surface(verbose, nbackground, bxdata, bydata, bzdata, (float)(wbnd[0] - bdata_origin_x),
+                 (float)(wbnd[1] - bdata_origin_x), (float)(wbnd[2] - bdata_origin_y), (float)(wbnd[3] - bdata_origin_y), dx,
+                 dy, tension, sgrid);
 #else
     float cay = (float)tension;
     float xmin = (float)(wbnd[0] - 0.5 * dx - bdata_origin_x);
@@ -37,15 +37,18 @@
 
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <getopt.h>
+#include <mutex>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include "mb_aux.h"
 #include "mb_define.h"
@@ -109,6 +112,86 @@ struct mbprocess_grid_struct {
   float *data;
 };
 
+/* ping slots queued in the processing pipeline for each ping thread */
+constexpr int MBPROCESS_PIPELINE_DEPTH = 8;
+
+/* maximum number of consecutive pings taken by a ping thread at once */
+constexpr int MBPROCESS_PIPELINE_BATCH = 4;
+
+/* states of a ping slot in the processing pipeline */
+constexpr int MBPROCESS_PING_FREE = 0;
+constexpr int MBPROCESS_PING_READ = 1;
+constexpr int MBPROCESS_PING_RECALCULATED = 2;
+constexpr int MBPROCESS_PING_EDITED = 3;
+
+/* define structure holding one data record between the processing stages */
+struct mbprocess_ping_struct {
+  int state = MBPROCESS_PING_FREE;
+  bool skip = false;
+  int status;
+  int error;
+  void *store_ptr;
+  int kind;
+  int time_i[7];
+  double time_d;
+  double navlon;
+  double navlat;
+  double speed;
+  double heading;
+  double altitude;
+  double sonardepth;
+  double draft;
+  double roll;
+  double pitch;
+  double heave;
+  double draft_org;
+  double roll_org;
+  double pitch_org;
+  double lever_heave;
+  double ssv;
+  double beamwidth_xtrack;
+  double beamwidth_ltrack;
+  int idata;
+  int pingmultiplicity;
+  int sensorhead;
+  int sensortype;
+  int nbath;
+  int namp;
+  int nss;
+  int nbeams;
+  char *beamflag;
+  char *beamflagorg;
+  double *bath;
+  double *amp;
+  double *bathacrosstrack;
+  double *bathalongtrack;
+  double *ss;
+  double *ssacrosstrack;
+  double *ssalongtrack;
+  double *ttimes;
+  double *angles;
+  double *angles_forward;
+  double *angles_null;
+  double *bheave;
+  double *alongtrack_offset;
+  char comment[MB_COMMENT_MAXLINE];
+
+  /* copies of the data store and arrays used while the record is queued */
+  void *store_copy = nullptr;
+  std::vector<char> flag_copy;
+  std::vector<double> value_copy;
+};
+
+/* define raytracing and seafloor slope workspace of a ping thread */
+struct mbprocess_work_struct {
+  void *rt_svp = nullptr;
+  std::vector<double> depths;
+  std::vector<double> depthsmooth;
+  std::vector<double> depthacrosstrack;
+  std::vector<double> slopes;
+  std::vector<double> slopeacrosstrack;
+};
+
 constexpr char program_name[] = "mbprocess";
 constexpr char help_message[] =
     "mbprocess is a tool for processing swath sonar bathymetry data.\n"
@@ -433,7 +516,7 @@ int mbprocess_save_edit(int verbose, FILE *esffp, double time_d, int beam, int a
 }
 /*--------------------------------------------------------------------*/
 void process_file(int verbose, int thread_id, struct mb_process_struct *process,
-                  struct mbprocess_grid_struct *grid, int *status, int *error)
+                  struct mbprocess_grid_struct *grid, int ping_threads, int *status, int *error)
 {
 
   /* MBIO read and write control parameters */
@@ -582,15 +665,11 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
   char resf_file[MB_PATH_MAXLINE+10];
   FILE *resf_fp = nullptr;
   mb_path resf_header;
-  int action;
 
-  double draft_org, depth_offset_use, depth_offset_change, depth_offset_org, static_shift;
+  double draft_org;
   double roll_org, pitch_org, heave_org, heading_org;
-  double ttime, range;
-  double xx, zz, rr, vsum, vavg;
+  double zz, rr;
   double alpha, beta;
-  double alphar, betar;
-  int ray_stat;
   double *ttimes = nullptr;
   double *angles = nullptr;
   double *angles_forward = nullptr;
@@ -606,9 +685,6 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
   /* sidescan correction */
   double altitude_default = 1000.0;
   int nsmooth = 5;
-  double reference_amp;
-  double reference_amp_port;
-  double reference_amp_stbd;
   int itable;
   int nsscorrtable = 0;
   int nsscorrangle = 0;
@@ -625,13 +701,6 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
   int nslopes;
   double *slopes = nullptr;
   double *slopeacrosstrack = nullptr;
-  double r[3];
-  double v1[3], v2[3], v[3], vv;
-  double slope;
-  double bathy;
-  double altitude_use;
-  double angle;
-  double correction;
 
   int pings;
   int format;
@@ -648,7 +717,7 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
   double factor;
   int pingmultiplicity;
   int nbeams;
-  int istart, iend, icut;
+  int icut;
   int ioff;
   int mm;
 
@@ -832,6 +901,8 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
     fprintf(stderr, "  Travel time mode:              %d\n", process->mbp_tt_mode);
     fprintf(stderr, "  Travel time multiplier:        %f\n", process->mbp_tt_mult);
     fprintf(stderr, "  Raytrace angle mode:           %d\n", process->mbp_angle_mode);
+    if (process->mbp_rt_table > 0.0)
+      fprintf(stderr, "  Raytrace table tolerance:      %f m\n", process->mbp_rt_table);
 
     fprintf(stderr, "\nStatic Beam Bathymetry Corrections:\n");
     if (process->mbp_static_mode == MBP_STATIC_BEAM_ON) {
@@ -3950,8 +4021,16 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
   }
 
   /* set up the raytracing */
-  if (process->mbp_svp_mode != MBP_SVP_OFF)
+  if (process->mbp_svp_mode != MBP_SVP_OFF) {
     *status = mb_rt_init(verbose, nsvp, depth, velocity, &rt_svp, error);
+    if (*status == MB_SUCCESS && process->mbp_rt_table > 0.0
+        && mb_rt_table_init(verbose, rt_svp, process->mbp_rt_table, error) != MB_SUCCESS) {
+      fprintf(stderr, "\nUnable to use raytracing tables with SVP file <%s>\n", process->mbp_svpfile);
+      fprintf(stderr, "Processing file <%s> with exact raytracing\n", process->mbp_ifile);
+      *status = MB_SUCCESS;
+      *error = MB_ERROR_NO_ERROR;
+    }
+  }
 
   /* set up the sidescan recalculation */
   if (process->mbp_ssrecalc_mode == MBP_SSRECALC_ON) {
@@ -3982,1450 +4061,1932 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
   int itidetime = 0;
 
   /*--------------------------------------------
-    loop over reading input
+    processing stages applied to each record once it has been read:
+    the bathymetry is recalculated, then the edits and corrections
+    are applied and the record is written - with more than one ping
+    thread the recalculation runs in a pool of worker threads and the
+    output is written by a separate thread in the input record order
     --------------------------------------------*/
 
-  /* read and write */
-  while (*error <= MB_ERROR_NO_ERROR) {
-    /* read some data */
-    *error = MB_ERROR_NO_ERROR;
-    *status = MB_SUCCESS;
-    *status = mb_get_all(verbose, imbio_ptr, &store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed, &heading,
-                        &distance, &altitude, &sonardepth, &nbath, &namp, &nss, beamflag, bath, amp, bathacrosstrack,
-                        bathalongtrack, ss, ssacrosstrack, ssalongtrack, comment, error);
+  /* recalculate the bathymetry of a survey record - only the ping and
+     the thread's workspace are modified so that records may be handled
+     concurrently */
+  auto recalculate_ping = [&](struct mbprocess_ping_struct *ping, struct mbprocess_work_struct *work) {
+    int *status = &ping->status;
+    int *error = &ping->error;
+    const int kind = ping->kind;
+    const int *time_i = ping->time_i;
+    const int idata = ping->idata;
+    const int nbath = ping->nbath;
+    const int nbeams = ping->nbeams;
+    const double altitude = ping->altitude;
+    const double sonardepth = ping->sonardepth;
+    const double draft = ping->draft;
+    const double draft_org = ping->draft_org;
+    const double roll = ping->roll;
+    const double roll_org = ping->roll_org;
+    const double pitch = ping->pitch;
+    const double pitch_org = ping->pitch_org;
+    const double lever_heave = ping->lever_heave;
+    const double ssv = ping->ssv;
+    char *beamflag = ping->beamflag;
+    double *bath = ping->bath;
+    double *bathacrosstrack = ping->bathacrosstrack;
+    double *bathalongtrack = ping->bathalongtrack;
+    double *ttimes = ping->ttimes;
+    double *angles = ping->angles;
+    double *angles_forward = ping->angles_forward;
+    double *angles_null = ping->angles_null;
+    double *bheave = ping->bheave;
+    double *alongtrack_offset = ping->alongtrack_offset;
+    void *rt_svp = work->rt_svp;
+    if ((int)work->depths.size() < nbath + 1) {
+      work->depths.resize(nbath + 1);
+      work->depthsmooth.resize(nbath + 1);
+      work->depthacrosstrack.resize(nbath + 1);
+      work->slopes.resize(nbath + 1);
+      work->slopeacrosstrack.resize(nbath + 1);
+    }
+    double *depths = work->depths.data();
+    double *depthsmooth = work->depthsmooth.data();
+    double *depthacrosstrack = work->depthacrosstrack.data();
+    double *slopes = work->slopes.data();
+    double *slopeacrosstrack = work->slopeacrosstrack.data();
+    int ndepths;
+    int nslopes;
+    double depth_offset_use, depth_offset_change, depth_offset_org, static_shift;
+    double ttime, range;
+    double xx, zz;
+    double vsum;
+    double vavg = 0.0;
+    double alpha, beta;
+    double alphar, betar;
+    int ray_stat;
+    double slope;
+    double bathy;
+    double altitude_use;
+    double angle;
+    double correction;
 
-    /* time gaps do not matter to mbprocess */
-    if (*error == MB_ERROR_TIME_GAP) {
-      *status = MB_SUCCESS;
-      *error = MB_ERROR_NO_ERROR;
-    }
-
-    /* out of bounds do not matter to mbprocess */
-    if (*error == MB_ERROR_OUT_BOUNDS) {
-      *status = MB_SUCCESS;
-      *error = MB_ERROR_NO_ERROR;
-    }
+    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
 
-    /* non-survey data do not matter to mbprocess */
-    if (*error == MB_ERROR_OTHER) {
-      *status = MB_SUCCESS;
-      *error = MB_ERROR_NO_ERROR;
-    }
+      /* if svp specified recalculate bathymetry
+          by raytracing  */
+      if (process->mbp_bathrecalc_mode == MBP_BATHRECALC_RAYTRACE) {
+        /* loop over the beams */
+        for (int i = 0; i < nbeams; i++) {
+          if (ttimes[i] > 0.0) {
+            /* if needed, translate angles from takeoff
+                angle coordinates to roll-pitch
+                coordinates, apply roll and pitch
+                corrections, and translate back */
+            if (process->mbp_rollbias_mode != MBP_ROLLBIAS_OFF ||
+                process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON || process->mbp_nav_attitude == MBP_NAV_ON ||
+                process->mbp_attitude_mode == MBP_ATTITUDE_ON || process->mbp_kluge003) {
+              mb_takeoff_to_rollpitch(verbose, angles[i], angles_forward[i], &alpha, &beta, error);
+              /* apply kluge_003 - enables correction of beam angles in
+                   SeaBeam 2112 data
+                   - a data sample from the SeaBeam 2112 on
+                         the USCG Icebreaker Healy (collected on
+                         23 July 2003) was found to have an error
+                         in which the beam angles had 0.25 times
+                         the roll added
+                   - this correction subtracts 0.25 * roll
+                         from the beam angles before the bathymetry
+                         is recalculated by raytracing through a
+                         water sound velocity profile
+                   - the mbprocess parameter files must be
+                         set to enable bathymetry recalculation
+                         by raytracing in order to apply this
+                         correction */
+              if (process->mbp_kluge003)
+                beta -= 0.25 * roll;
+              if (process->mbp_nav_attitude == MBP_NAV_ON || process->mbp_attitude_mode == MBP_ATTITUDE_ON) {
+                beta += roll - roll_org;
+                alpha += pitch - pitch_org;
+              }
+              if (process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON)
+                alpha += process->mbp_pitchbias;
+              if (process->mbp_rollbias_mode == MBP_ROLLBIAS_SINGLE)
+                beta += process->mbp_rollbias;
+              else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE && angles[i] >= 0.0)
+                beta += process->mbp_rollbias_stbd;
+              else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE)
+                beta += process->mbp_rollbias_port;
+              mb_rollpitch_to_takeoff(verbose, alpha, beta, &angles[i], &angles_forward[i], error);
+            }
 
-    /* compare and save survey data timestamps */
-    if (process->mbp_kluge004 && error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      if (time_d <= time_d_lastping) {
-        *error = MB_ERROR_UNINTELLIGIBLE;
-        *status = MB_FAILURE;
-      }
-    }
+            /* add heave and draft */
+            depth_offset_use = bheave[i] + draft + lever_heave;
 
-    /* save the original beamflag states */
-    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      for (int i = 0; i < nbath; i++) {
-        beamflagorg[i] = beamflag[i];
-      }
-    }
+            /* check depth_offset - use static shift if depth_offset negative */
+            if (depth_offset_use >= depth[0]) {
+              static_shift = 0.0;
+            }
+            else {
+              static_shift = depth_offset_use - depth[0];
 
-    /* detect multiple pings with the same time stamps */
-    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      int sensorhead_error = MB_ERROR_NO_ERROR;
-      const int sensorhead_status = mb_sensorhead(verbose, imbio_ptr, store_ptr, &sensorhead, &sensorhead_error);
-      mb_sonartype(verbose, imbio_ptr, store_ptr, &sensortype, &sensorhead_error);
-      if (sensorhead_status == MB_SUCCESS) {
-        pingmultiplicity = sensorhead;
-      }
-      else if (fabs(time_d - time_d_lastping) < MB_ESF_MAXTIMEDIFF) {
-        pingmultiplicity++;
-      }
-      else {
-        pingmultiplicity = 0;
-      }
-      time_d_lastping = time_d;
-    }
+              if (verbose > 0) {
+                fprintf(stderr, "\nWarning: Sonar depth is shallower than the top\n");
+                fprintf(stderr, "of the SVP - transducers above water?!\n");
+                fprintf(stderr, "Raytracing performed from top of SVP followed by static shift.\n");
+                fprintf(stderr, "Sonar depth is sum of heave + draft (or transducer depth).\n");
+                fprintf(stderr, "Draft from data:       %f\n", draft);
+                fprintf(stderr, "Heave from data:       %f\n", bheave[i]);
+                fprintf(stderr, "Heave from lever calc: %f\n", lever_heave);
+                fprintf(stderr, "User specified draft:  %f\n", process->mbp_draft);
+                fprintf(stderr, "Depth offset used:     %f\n", depth_offset_use);
+                fprintf(stderr, "Data Record: %d\n", idata);
+                fprintf(stderr, "Ping time:  %4d %2d %2d %2d:%2d:%2d.%6d\n", time_i[0], time_i[1],
+                        time_i[2], time_i[3], time_i[4], time_i[5], time_i[6]);
+              }
+            }
 
-    /* increment counter */
-    if (*error <= MB_ERROR_NO_ERROR && kind == MB_DATA_DATA)
-      idata++;
-    else if (*error <= MB_ERROR_NO_ERROR && kind == nav_source)
-      inav++;
-    else if (*error <= MB_ERROR_NO_ERROR && kind == MB_DATA_COMMENT)
-      icomment++;
-    else if (*error <= MB_ERROR_NO_ERROR)
-      iother++;
+            /* raytrace */
+            *status = mb_rt(verbose, rt_svp, (depth_offset_use - static_shift), angles[i], 0.5 * ttimes[i],
+                           process->mbp_angle_mode, ssv, angles_null[i], 0, nullptr, nullptr, nullptr, nullptr, &xx, &zz, &ttime,
+                           &ray_stat, error);
 
-    /* output error messages */
-    if (verbose >= 1 && *error == MB_ERROR_COMMENT) {
-      if (icomment == 1)
-        fprintf(stderr, "\nComments in Input:\n");
-      fprintf(stderr, "%s\n", comment);
-    }
-    else if (verbose >= 1 && *error < MB_ERROR_NO_ERROR && *error > MB_ERROR_OTHER) {
-      char *message = nullptr;
-      mb_error(verbose, *error, &message);
-      fprintf(stderr, "\nNonfatal MBIO Error:\n%s\n", message);
-      fprintf(stderr, "Input Record: %d\n", idata);
-      fprintf(stderr, "Time: %d %d %d %d %d %d\n", time_i[0], time_i[1], time_i[2], time_i[3], time_i[4],
-              time_i[5]);
-    }
-    else if (verbose >= 1 && *error < MB_ERROR_NO_ERROR) {
-      char *message = nullptr;
-      mb_error(verbose, *error, &message);
-      fprintf(stderr, "\nNonfatal MBIO Error:\n%s\n", message);
-      fprintf(stderr, "Input Record: %d\n", idata);
-    }
-    else if (verbose >= 1 && *error != MB_ERROR_NO_ERROR && *error != MB_ERROR_EOF) {
-      char *message = nullptr;
-      mb_error(verbose, *error, &message);
-      fprintf(stderr, "\nFatal MBIO Error:\n%s\n", message);
-      fprintf(stderr, "Last Good Time: %d %d %d %d %d %d\n", time_i[0], time_i[1], time_i[2], time_i[3], time_i[4],
-              time_i[5]);
-    }
+            /* apply static shift if any */
+            zz += static_shift;
 
-    /*--------------------------------------------
-      handle kluges 1 and 7
-      --------------------------------------------*/
+            /* get alongtrack and acrosstrack distances and depth */
+            bathacrosstrack[i] = xx * cos(DTR * angles_forward[i]);
+            bathalongtrack[i] = xx * sin(DTR * angles_forward[i]) + alongtrack_offset[i];
+            bath[i] = zz;
 
-    /* apply kluge001 - enables correction of travel times in
-                Hydrosweep DS2 data from the R/V Maurice
-                Ewing in 2001 and 2002. */
-    if (process->mbp_kluge001 && kind == MB_DATA_DATA && (format == 182 || format == 183))
-      *status = mbsys_atlas_ttcorr(verbose, imbio_ptr, store_ptr, error);
+            if (verbose >= 5) {
+              fprintf(stderr, "dbg5       %3d %3d %6.3f %6.3f %6.3f %8.2f %8.2f %8.2f\n", idata, i,
+                      0.5 * ttimes[i], angles[i], angles_forward[i], bathacrosstrack[i], bathalongtrack[i],
+                      bath[i]);
+            }
+            if (verbose >= 5) {
+              fprintf(stderr, "\ndbg5  Depth value calculated in program <%s>:\n", program_name);
+              fprintf(stderr, "dbg5       kind:  %d\n", kind);
+              fprintf(stderr, "dbg5       beam:  %d\n", i);
+              fprintf(stderr, "dbg5       tt:     %f\n", ttimes[i]);
+              fprintf(stderr, "dbg5       xx:     %f\n", xx);
+              fprintf(stderr, "dbg5       zz:     %f\n", zz);
+              fprintf(stderr, "dbg5       xtrack: %f\n", bathacrosstrack[i]);
+              fprintf(stderr, "dbg5       ltrack: %f\n", bathalongtrack[i]);
+              fprintf(stderr, "dbg5       depth:  %f\n", bath[i]);
+            }
+          }
 
-    /* apply kluge007 - zero alongtrack distances > half the altitude */
-    if (process->mbp_kluge007 && kind == MB_DATA_DATA) {
-      for (int i = 0; i < nbath; i++) {
-        if (fabs(bathalongtrack[i]) > 0.5 * altitude)
-          bathalongtrack[i] = 0.0;
-      }
-      for (int i = 0; i < nss; i++) {
-        if (fabs(ssalongtrack[i]) > 0.5 * altitude)
-          ssalongtrack[i] = 0.0;
+          /* else if no travel time no data */
+          else
+            beamflag[i] = MB_FLAG_NULL;
+        }
       }
-    }
 
-    /*--------------------------------------------
-      handle navigation merging
-      --------------------------------------------*/
+      /* recalculate bathymetry by rigid rotations  */
+      else if (process->mbp_bathrecalc_mode == MBP_BATHRECALC_ROTATE) {
+        /* loop over the beams */
+        for (int i = 0; i < nbath; i++) {
+          if (beamflag[i] != MB_FLAG_NULL) {
+            /* output some debug messages */
+            if (verbose >= 5) {
+              fprintf(stderr, "\ndbg5  Depth value to be calculated in program <%s>:\n", program_name);
+              fprintf(stderr, "dbg5       kind:  %d\n", kind);
+              fprintf(stderr, "dbg5       beam:  %d\n", i);
+              fprintf(stderr, "dbg5       xtrack: %f\n", bathacrosstrack[i]);
+              fprintf(stderr, "dbg5       ltrack: %f\n", bathalongtrack[i]);
+              fprintf(stderr, "dbg5       depth:  %f\n", bath[i]);
+            }
 
-    /* extract the navigation if available and set scaling that may be needed many times */
-    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source)) {
-      *status = mb_extract_nav(verbose, imbio_ptr, store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed,
-                              &heading_org, &draft_org, &roll_org, &pitch_org, &heave_org, error);
-      heading = heading_org;
-      draft = draft_org;
-      roll = roll_org;
-      pitch = pitch_org;
-      heave = heave_org;
+            /* add heave and draft */
+            depth_offset_use = bheave[i] + draft + lever_heave;
+            depth_offset_org = bheave[i] + draft_org;
 
-      mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
-      headingx = sin(heading * DTR);
-      headingy = cos(heading * DTR);
+            /* strip off heave + draft */
+            bath[i] -= depth_offset_org;
 
-      /* apply kluge002 - enables correction of draft values in Simrad data
-                 - some Simrad multibeam data has had an
-                   error in which the heave has bee added
-                   to the sonar depth (draft for hull
-                   mounted sonars)
-                 - this correction subtracts the heave
-                   value from the sonar depth */
-      if (process->mbp_kluge002 && kind == MB_DATA_DATA)
-        draft -= heave;
-    }
+            /* get range and angles in
+                roll-pitch frame */
+            range = sqrt(bath[i] * bath[i] + bathacrosstrack[i] * bathacrosstrack[i] +
+                         bathalongtrack[i] * bathalongtrack[i]);
+            if (fabs(range) < 0.001) {
+              alphar = 0.0;
+              betar = 0.5 * M_PI;
+            }
+            else {
+              alphar = asin(std::max(-1.0, std::min(1.0, (bathalongtrack[i] / range))));
+              betar = acos(std::max(-1.0, std::min(1.0, (bathacrosstrack[i] / range / cos(alphar)))));
+            }
+            if (bath[i] < 0.0)
+              betar = 2.0 * M_PI - betar;
 
-    /* apply kluge005 - replaces survey record timestamps with
-            timestamps of corresponding merged navigation
-            records
-            - this feature allows users to fix
-                  timestamp errors using MBnavedit and
-                  then insert the corrected timestamps
-                  into processed data */
-    if (process->mbp_kluge005 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA && nnav > 0) {
-      time_d = ntime[idata - 1];
-      mb_get_date(verbose, time_d, time_i);
-    }
+            /* apply roll pitch corrections */
+            if (process->mbp_nav_attitude == MBP_NAV_ON || process->mbp_attitude_mode == MBP_ATTITUDE_ON) {
+              betar += DTR * (roll - roll_org);
+              alphar += DTR * (pitch - pitch_org);
+            }
+            if (process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON)
+              alphar += DTR * process->mbp_pitchbias;
+            if (process->mbp_rollbias_mode == MBP_ROLLBIAS_SINGLE)
+              betar += DTR * process->mbp_rollbias;
+            else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE && betar <= M_PI * 0.5)
+              betar += DTR * process->mbp_rollbias_stbd;
+            else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE)
+              betar += DTR * process->mbp_rollbias_port;
 
-    /* interpolate the navigation if desired */
-    if (*error == MB_ERROR_NO_ERROR && process->mbp_nav_mode == MBP_NAV_ON &&
-        (kind == MB_DATA_DATA || kind == nav_source)) {
-      /* interpolate navigation */
-      if (process->mbp_nav_algorithm == MBP_NAV_SPLINE && time_d >= ntime[0] && time_d <= ntime[nnav - 1]) {
-        mb_spline_interp(verbose, ntime - 1, nlon - 1, nlonspl - 1, nnav, time_d, &navlon, &inavtime, error);
-        mb_spline_interp(verbose, ntime - 1, nlat - 1, nlatspl - 1, nnav, time_d, &navlat, &inavtime, error);
-      }
-      else {
-        mb_linear_interp_longitude(verbose, ntime - 1, nlon - 1, nnav, time_d, &navlon, &inavtime, error);
-        mb_linear_interp_latitude(verbose, ntime - 1, nlat - 1, nnav, time_d, &navlat, &inavtime, error);
-      }
+            /* recalculate bathymetry */
+            bath[i] = range * cos(alphar) * sin(betar);
+            bathalongtrack[i] = range * sin(alphar);
+            bathacrosstrack[i] = range * cos(alphar) * cos(betar);
 
-      /* interpolate heading */
-      if (process->mbp_nav_heading == MBP_NAV_ON) {
-        mb_linear_interp_heading(verbose, ntime - 1, nheading - 1, nnav, time_d, &heading, &inavtime, error);
-        if (heading < 0.0)
-          heading += 360.0;
-        else if (heading > 360.0)
-          heading -= 360.0;
+            /* add heave and draft back in */
+            bath[i] += depth_offset_use;
+
+            /* output some debug values */
+            if (verbose >= 5)
+              fprintf(stderr, "dbg5       %3d beam:%3d bath:%8.2f %8.2f %8.2f\n", idata, i,
+                      bathacrosstrack[i], bathalongtrack[i], bath[i]);
+          }
+        }
       }
 
-      /* interpolate speed */
-      if (process->mbp_nav_speed == MBP_NAV_ON) {
-        mb_linear_interp(verbose, ntime - 1, nspeed - 1, nnav, time_d, &speed, &inavtime, error);
+      /* recalculate bathymetry by changes to transducer depth  */
+      else if (process->mbp_bathrecalc_mode == MBP_BATHRECALC_OFFSET || process->mbp_tide_mode == MBP_TIDE_ON ||
+               process->mbp_lever_mode == MBP_LEVER_ON || process->mbp_navadj_mode == MBP_NAVADJ_LLZ) {
+        /* get draft change */
+        depth_offset_change = draft - draft_org + lever_heave;
+
+        /* loop over the beams */
+        for (int i = 0; i < nbath; i++) {
+          if (beamflag[i] != MB_FLAG_NULL) {
+            /* apply transducer depth change to depths */
+            bath[i] += depth_offset_change;
+
+            if (verbose >= 5) {
+              fprintf(stderr, "dbg5       %3d %3d %8.2f %8.2f %8.2f\n", idata, i, bathacrosstrack[i],
+                      bathalongtrack[i], bath[i]);
+              fprintf(stderr, "\ndbg5  Depth value calculated in program <%s>:\n", program_name);
+              fprintf(stderr, "dbg5       kind:  %d\n", kind);
+              fprintf(stderr, "dbg5       beam:  %d\n", i);
+              fprintf(stderr, "dbg5       xtrack: %f\n", bathacrosstrack[i]);
+              fprintf(stderr, "dbg5       ltrack: %f\n", bathalongtrack[i]);
+              fprintf(stderr, "dbg5       depth:  %f\n", bath[i]);
+            }
+          }
+        }
       }
 
-      /* interpolate draft */
-      if (process->mbp_nav_draft == MBP_NAV_ON) {
-        mb_linear_interp(verbose, ntime - 1, ndraft - 1, nnav, time_d, &draft, &inavtime, error);
+      /*--------------------------------------------
+        change water sound reference if needed
+        --------------------------------------------*/
+
+      /* change bathymetry water sound reference if required */
+      if (process->mbp_svp_mode == MBP_SVP_SOUNDSPEEDREF ||
+          (process->mbp_svp_mode == MBP_SVP_ON && !process->mbp_corrected)) {
+        for (int i = 0; i < nbath; i++) {
+          if (beamflag[i] != MB_FLAG_NULL) {
+            /* calculate average water sound speed
+            for current depth value */
+            depth_offset_use = bheave[i] + draft + lever_heave;
+            zz = bath[i] - depth_offset_use;
+            int k = -1;
+            for (int j = 0; j < nsvp - 1; j++) {
+              if ((depth[j] < zz) && (depth[j + 1] >= zz))
+                k = j;
+            }
+            if (k > 0)
+              vsum = velocity_sum[k - 1];
+            else
+              vsum = 0.0;
+            if (k >= 0) {
+              vsum += 0.5 *
+                      (2 * velocity[k] +
+                       (zz - depth[k]) * (velocity[k + 1] - velocity[k]) / (depth[k + 1] - depth[k])) *
+                      (zz - depth[k]);
+              vavg = vsum / zz;
+            }
+            if (vavg <= 0.0)
+              vavg = 1500.0;
+
+            /* if uncorrected value desired */
+            if (!process->mbp_corrected)
+              bath[i] = zz * 1500.0 / vavg + depth_offset_use;
+            else
+              bath[i] = zz * vavg / 1500.0 + depth_offset_use;
+          }
+        }
       }
 
-      /* interpolate attitude */
-      if (process->mbp_nav_attitude == MBP_NAV_ON) {
-        mb_linear_interp(verbose, ntime - 1, nroll - 1, nnav, time_d, &roll, &inavtime, error);
-        mb_linear_interp(verbose, ntime - 1, npitch - 1, nnav, time_d, &pitch, &inavtime, error);
-        mb_linear_interp(verbose, ntime - 1, nheave - 1, nnav, time_d, &heave, &inavtime, error);
+      /*--------------------------------------------
+        apply per-beam static offsets
+        --------------------------------------------*/
+
+      /* apply static corrections */
+      if (process->mbp_static_mode == MBP_STATIC_BEAM_ON && nstatic > 0 && nstatic <= nbath) {
+        for (int i = 0; i < nstatic; i++) {
+          if (staticbeam[i] >= 0 && staticbeam[i] < nbath) {
+            if (beamflag[staticbeam[i]] != MB_FLAG_NULL)
+              bath[staticbeam[i]] -= staticoffset[i];
+          }
+        }
       }
-    }
 
-    /*--------------------------------------------
-      handle attitude merging
-      --------------------------------------------*/
+      /*--------------------------------------------
+        apply per-angle static offsets
+        --------------------------------------------*/
 
-    /* interpolate the attitude if desired */
-    if (*error == MB_ERROR_NO_ERROR && process->mbp_attitude_mode == MBP_ATTITUDE_ON &&
-        (kind == MB_DATA_DATA || kind == nav_source)) {
-      /* interpolate adjusted navigation */
-      mb_linear_interp(verbose, attitudetime - 1, attituderoll - 1,
-                        nattitude, time_d, &roll, &iattitudetime, error);
-      mb_linear_interp(verbose, attitudetime - 1, attitudepitch - 1,
-                        nattitude, time_d, &pitch, &iattitudetime, error);
-      mb_linear_interp(verbose, attitudetime - 1, attitudeheave - 1,
-                        nattitude, time_d, &heave, &iattitudetime, error);
+      /* apply static corrections */
+      if (process->mbp_static_mode == MBP_STATIC_ANGLE_ON && nstatic > 0) {
+        int istatic = 0;
+        mb_pr_set_bathyslope(verbose, nsmooth, nbath, beamflag, bath, bathacrosstrack, &ndepths, depths,
+                             depthacrosstrack, &nslopes, slopes, slopeacrosstrack, depthsmooth, error);
+        for (int i = 0; i < nbath; i++) {
+          if (mb_beam_ok(beamflag[i])) {
+            bathy = 0.0;
+            if (ndepths > 1) {
+              *status = mb_pr_get_bathyslope(verbose, ndepths, depths, depthacrosstrack, nslopes, slopes,
+                                            slopeacrosstrack, bathacrosstrack[i], &bathy, &slope, error);
+              if (bathy <= 0.0) {
+                if (altitude > 0.0)
+                  bathy = altitude + sonardepth;
+                else
+                  bathy = altitude_default + sonardepth;
+                slope = 0.0;
+              }
+              if (bathy > 0.0) {
+                altitude_use = bathy - sonardepth;
+                angle = RTD * atan(bathacrosstrack[i] / altitude_use);
+
+                /* Get offset from SBO file */
+                *status = mb_linear_interp(verbose, staticangle - 1, staticoffset - 1, nstatic, angle,
+                                          &correction, &istatic, error);
+                bath[i] -= correction;
+              }
+            }
+          }
+        }
+      }
+
+      /* output some debug messages */
+      if (verbose >= 5) {
+        fprintf(stderr, "\ndbg5  Depth values calculated in program <%s>:\n", program_name);
+        fprintf(stderr, "dbg5       kind:  %d\n", kind);
+        fprintf(stderr, "dbg5      beam    ttime      depth        xtrack    ltrack      flag\n");
+        for (int i = 0; i < nbath; i++)
+          fprintf(stderr, "dbg5       %2d   %f   %f   %f   %f   %d\n", i, ttimes[i], bath[i],
+                  bathacrosstrack[i], bathalongtrack[i], beamflag[i]);
+      }
     }
+  };
+
+  /* apply the beam edits, data cutting, sidescan recalculation and
+     amplitude and sidescan corrections to a record, insert the results
+     into the data store, and save the reverse edits - records must be
+     passed to this stage in the input order because the edit save
+     file is matched ping by ping */
+  auto edit_ping = [&](struct mbprocess_ping_struct *ping) {
+    int *status = &ping->status;
+    int *error = &ping->error;
+    void *store_ptr = ping->store_ptr;
+    int &kind = ping->kind;
+    int *time_i = ping->time_i;
+    double &time_d = ping->time_d;
+    double &navlon = ping->navlon;
+    double &navlat = ping->navlat;
+    double &speed = ping->speed;
+    double &heading = ping->heading;
+    const double altitude = ping->altitude;
+    const double sonardepth = ping->sonardepth;
+    const double draft = ping->draft;
+    const double roll = ping->roll;
+    const double pitch = ping->pitch;
+    const double heave = ping->heave;
+    const int pingmultiplicity = ping->pingmultiplicity;
+    int &nbath = ping->nbath;
+    int &namp = ping->namp;
+    int &nss = ping->nss;
+    char *beamflag = ping->beamflag;
+    const char *beamflagorg = ping->beamflagorg;
+    double *bath = ping->bath;
+    double *amp = ping->amp;
+    double *bathacrosstrack = ping->bathacrosstrack;
+    double *bathalongtrack = ping->bathalongtrack;
+    double *ss = ping->ss;
+    double *ssacrosstrack = ping->ssacrosstrack;
+    double *ssalongtrack = ping->ssalongtrack;
+    char *comment = ping->comment;
+    int istart, iend, icut;
+    int action;
+    double headingx, headingy;
+    double mtodeglon, mtodeglat;
+    double reference_amp;
+    double reference_amp_port;
+    double reference_amp_stbd;
+    double r[3];
+    double v1[3], v2[3], v[3], vv;
+    double rr;
+    double slope;
+    double bathy;
+    double altitude_use;
+    double angle;
+    double correction;
 
     /*--------------------------------------------
-      handle sonar depth merging
+      apply beam edits
       --------------------------------------------*/
 
-    /* interpolate the sonardepth if desired */
-    if (*error == MB_ERROR_NO_ERROR && process->mbp_sonardepth_mode == MBP_SONARDEPTH_ON &&
-        (kind == MB_DATA_DATA || kind == nav_source)) {
-      /* interpolate adjusted navigation */
-      mb_linear_interp(verbose, fsonardepthtime - 1, fsonardepth - 1, nsonardepth, time_d, &draft,
-                                 &isonardepthtime, error);
+    /* apply the saved edits */
+    if (process->mbp_edit_mode == MBP_EDIT_ON && esf.nedit > 0 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      /* apply edits for this ping */
+      *status = mb_esf_apply(verbose, &esf, time_d, pingmultiplicity, nbath, beamflag, error);
     }
 
     /*--------------------------------------------
-      handle position shifts
+      apply data cutting to bathymetry
       --------------------------------------------*/
 
-    /* apply position shifts if needed */
-    if (process->mbp_nav_shift == MBP_NAV_ON) {
-      navlon -= (headingy * mtodeglon * process->mbp_nav_offsetx + headingx * mtodeglon * process->mbp_nav_offsety -
-                 mtodeglon * process->mbp_nav_shiftx - process->mbp_nav_shiftlon);
-      navlat -= (-headingx * mtodeglat * process->mbp_nav_offsetx + headingy * mtodeglat * process->mbp_nav_offsety -
-                 mtodeglat * process->mbp_nav_shifty - process->mbp_nav_shiftlat);
-    }
-
-    /*--------------------------------------------
-      handle draft correction
-      --------------------------------------------*/
-    /* add user specified draft correction if desired */
-    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source)) {
-      if (process->mbp_draft_mode == MBP_DRAFT_OFFSET)
-        draft = draft + process->mbp_draft_offset;
-      else if (process->mbp_draft_mode == MBP_DRAFT_MULTIPLY)
-        draft = draft * process->mbp_draft_mult;
-      else if (process->mbp_draft_mode == MBP_DRAFT_MULTIPLYOFFSET)
-        draft = draft * process->mbp_draft_mult + process->mbp_draft_offset;
-      else if (process->mbp_draft_mode == MBP_DRAFT_SET)
-        draft = process->mbp_draft;
-    }
+    /* apply data cutting to bathymetry if specified */
+    if (process->mbp_cut_num > 0 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      for (icut = 0; icut < process->mbp_cut_num; icut++) {
+        /* flag data according to beam number range */
+        if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_BATH &&
+            process->mbp_cut_mode[icut] == MBP_CUT_MODE_NUMBER) {
+          istart = std::max((int)process->mbp_cut_min[icut], 0);
+          iend = std::min((int)process->mbp_cut_max[icut], nbath - 1);
+          for (int i = istart; i <= iend; i++) {
+            if (mb_beam_ok(beamflag[i]))
+              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
+          }
+        }
 
-    /*--------------------------------------------
-      handle adjusted navigation merging
-      --------------------------------------------*/
+        /* flag data according to beam
+            acrosstrack distance */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_BATH &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_DISTANCE) {
+          for (int i = 0; i < nbath; i++) {
+            if (mb_beam_ok(beamflag[i]) && bathacrosstrack[i] >= process->mbp_cut_min[icut] &&
+                bathacrosstrack[i] <= process->mbp_cut_max[icut])
+              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
+          }
+        }
 
-    /* interpolate the adjusted navigation if desired */
-    if (*error == MB_ERROR_NO_ERROR && process->mbp_navadj_mode >= MBP_NAVADJ_LL &&
-        (kind == MB_DATA_DATA || kind == nav_source)) {
-      /* interpolate adjusted navigation */
-      if (process->mbp_navadj_algorithm == MBP_NAV_SPLINE && time_d >= natime[0] && time_d <= natime[nanav - 1]) {
-        mb_spline_interp(verbose, natime - 1, nalon - 1, nalonspl - 1, nanav, time_d, &navlon, &inavadjtime, error);
-        mb_spline_interp(verbose, ntime - 1, nalat - 1, nalatspl - 1, nanav, time_d, &navlat, &inavadjtime, error);
-      }
-      else {
-        mb_linear_interp_longitude(verbose, natime - 1, nalon - 1, nanav, time_d, &navlon, &inavadjtime, error);
-        mb_linear_interp_latitude(verbose, natime - 1, nalat - 1, nanav, time_d, &navlat, &inavadjtime, error);
+        /* flag data according to speed */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_BATH &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED) {
+          if (speed < process->mbp_cut_min[icut] || speed > process->mbp_cut_max[icut]) {
+            for (int i = 0; i < nbath; i++) {
+              if (mb_beam_ok(beamflag[i]))
+                beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
+            }
+          }
+        }
       }
     }
 
     /*--------------------------------------------
-      apply z offset from navigation adjustment correction
+      insert data as altered so far (not done yet)
       --------------------------------------------*/
 
-    /* apply z offset from navigation adjustment correction */
-    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA && process->mbp_navadj_mode == MBP_NAVADJ_LLZ &&
-        nanav > 1) {
-      /* interpolate z offset */
-      if (process->mbp_navadj_algorithm == MBP_NAV_SPLINE && time_d >= natime[0] && time_d <= natime[nanav - 1]) {
-        mb_spline_interp(verbose, natime - 1, naz - 1, nazspl - 1, nanav, time_d, &zoffset, &inavadjtime, error);
-      }
-      else {
-        mb_linear_interp(verbose, natime - 1, naz - 1, nanav, time_d, &zoffset, &inavadjtime, error);
-      }
+    /* insert the altered navigation if available */
+    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source)) {
+      if (heading >= 360.0)
+        heading -= 360.0;
+      else if (heading < 0.0)
+        heading += 360.0;
+      *status = mb_insert_nav(verbose, imbio_ptr, store_ptr, time_i, time_d, navlon, navlat, speed, heading, draft,
+                             roll, pitch, heave, error);
+    }
 
-      /* apply z offset to draft / sonar depth */
-      draft += zoffset;
+    /* insert the altered bathymetry, recalculate the sidescan (if that is defined),
+        and extract the results if desired */
+    if (process->mbp_ssrecalc_mode == MBP_SSRECALC_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      *status = mb_insert(verbose, imbio_ptr, store_ptr, kind, time_i, time_d, navlon, navlat, speed, heading, nbath,
+                         namp, nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss, ssacrosstrack,
+                         ssalongtrack, comment, error);
+      *status = mb_makess(verbose, imbio_ptr, store_ptr, pixel_size_set, &pixel_size, swath_width_set,
+                                      &swath_width, pixel_int, error);
+      *status = mb_extract(verbose, imbio_ptr, store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed, &heading,
+                          &nbath, &namp, &nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss,
+                          ssacrosstrack, ssalongtrack, comment, error);
     }
 
     /*--------------------------------------------
-      apply tide correction
+      apply data cutting to amplitude and sidescan
       --------------------------------------------*/
 
-    /* apply tide corrections */
-    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA
-      && process->mbp_tide_mode == MBP_TIDE_ON && ntide > 0) {
-      /* interpolate tide */
-      mb_linear_interp(verbose, tidetime - 1, tide - 1, ntide, time_d, &tideval, &itidetime, error);
+    /* apply data cutting to sidescan and amplitude if specified */
+    if (process->mbp_cut_num > 0 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      for (icut = 0; icut < process->mbp_cut_num; icut++) {
 
-      /* apply tide to to draft / sonar depth */
-      draft -= tideval;
-    }
+        /* flag data according to beam number range */
+        if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_AMP && process->mbp_cut_mode[icut] == MBP_CUT_MODE_NUMBER) {
+          istart = std::max((int)process->mbp_cut_min[icut], 0);
+          iend = std::min((int)process->mbp_cut_max[icut], namp - 1);
+          for (int i = istart; i <= iend; i++) {
+            if (mb_beam_ok(beamflag[i]))
+              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
+          }
+        }
 
-    /*--------------------------------------------
-      handle lever arm correction
-      --------------------------------------------*/
+        /* flag data according to beam
+            acrosstrack distance */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_AMP &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_DISTANCE) {
+          for (int i = 0; i < namp; i++) {
+            if (mb_beam_ok(beamflag[i]) && bathacrosstrack[i] >= process->mbp_cut_min[icut] &&
+                bathacrosstrack[i] <= process->mbp_cut_max[icut])
+              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
+          }
+        }
 
-    /* do lever calculation to find heave implied by roll and pitch
-       for a sonar displaced from the vru - this will be added to the
-       bathymetry */
-    if (*error == MB_ERROR_NO_ERROR && process->mbp_lever_mode == MBP_LEVER_ON && kind == MB_DATA_DATA) {
-      alpha = pitch;
-      beta = roll;
-      if (process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON)
-        alpha += process->mbp_pitchbias;
-      if (process->mbp_rollbias_mode == MBP_ROLLBIAS_SINGLE)
-        beta += process->mbp_rollbias;
-      else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE)
-        beta += 0.5 * (process->mbp_rollbias_port + process->mbp_rollbias_stbd);
-      mb_lever(verbose, process->mbp_sonar_offsetx, process->mbp_sonar_offsety, process->mbp_sonar_offsetz,
-               (double)0.0, (double)0.0, (double)0.0, process->mbp_vru_offsetx, process->mbp_vru_offsety,
-               process->mbp_vru_offsetz, alpha, beta, &lever_x, &lever_y, &lever_heave, error);
-    }
+        /* flag data according to speed */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_AMP &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED) {
+          if (speed < process->mbp_cut_min[icut] || speed > process->mbp_cut_max[icut]) {
+            for (int i = 0; i < namp; i++) {
+              amp[i] = 0.0;
+            }
+          }
+        }
 
-    /*--------------------------------------------
-      handle speed and heading calculation
-      --------------------------------------------*/
+        /* flag data according to pixel number range */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_SS &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_NUMBER) {
+          istart = std::max((int)process->mbp_cut_min[icut], 0);
+          iend = std::min((int)process->mbp_cut_max[icut], nss - 1);
+          for (int i = istart; i <= iend; i++) {
+            ss[i] = MB_SIDESCAN_NULL;
+          }
+        }
 
-    /* make up heading and speed if required */
-    bool calculatespeedheading = false;
-    if (process->mbp_heading_mode == MBP_HEADING_CALC || process->mbp_heading_mode == MBP_HEADING_CALCOFFSET)
-      calculatespeedheading = true;
-    for (icut = 0; icut < process->mbp_cut_num; icut++) {
-      if (process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED)
-        calculatespeedheading = true;
-    }
-    if (*error == MB_ERROR_NO_ERROR
-        && (kind == MB_DATA_DATA || kind == nav_source)
-        && calculatespeedheading) {
-      if (process->mbp_nav_mode == MBP_NAV_ON && inavtime > 0) {
-        mb_coor_scale(verbose, nlat[inavtime - 1], &mtodeglon, &mtodeglat);
-        del_time = ntime[inavtime] - ntime[inavtime - 1];
-        dx = (nlon[inavtime] - nlon[inavtime - 1]) / mtodeglon;
-        dy = (nlat[inavtime] - nlat[inavtime - 1]) / mtodeglat;
-      }
-      else if (process->mbp_navadj_mode >= MBP_NAVADJ_LL && inavadjtime > 0) {
-        mb_coor_scale(verbose, nalat[inavadjtime - 1], &mtodeglon, &mtodeglat);
-        del_time = natime[inavadjtime] - natime[inavadjtime - 1];
-        dx = (nalon[inavadjtime] - nalon[inavadjtime - 1]) / mtodeglon;
-        dy = (nalat[inavadjtime] - nalat[inavadjtime - 1]) / mtodeglat;
-      }
-      else if ((kind == MB_DATA_DATA && idata > 1) || (kind == nav_source && inav > 1)) {
-        mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
-        del_time = time_d - time_d_old;
-        dx = (navlon - navlon_old) / mtodeglon;
-        dy = (navlat - navlat_old) / mtodeglat;
-      }
-      if ((process->mbp_nav_mode == MBP_NAV_ON) || (process->mbp_navadj_mode >= MBP_NAVADJ_LL) ||
-          ((kind == MB_DATA_DATA && idata > 1) || (kind == nav_source && inav > 1))) {
-        dist = sqrt(dx * dx + dy * dy);
-        if (del_time > 0.0) {
-          speedcalc = 3.6 * dist / del_time;
+        /* flag data according to pixel
+            acrosstrack distance */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_SS &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_DISTANCE) {
+          for (int i = 0; i < nss; i++) {
+            if (ssacrosstrack[i] >= process->mbp_cut_min[icut] &&
+                ssacrosstrack[i] <= process->mbp_cut_max[icut])
+              ss[i] = MB_SIDESCAN_NULL;
+          }
         }
-        else
-          speedcalc = speed_old;
-        if (dist > 0.0 && del_time > 0.0) {
-          headingcalc = RTD * atan2(dx / dist, dy / dist);
-          if (headingcalc < 0.0)
-            headingcalc += 360.0;
+
+        /* flag data according to speed */
+        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_SS &&
+                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED) {
+          if (speed < process->mbp_cut_min[icut] || speed > process->mbp_cut_max[icut]) {
+            for (int i = 0; i < nss; i++) {
+              ss[i] = MB_SIDESCAN_NULL;
+            }
+          }
         }
-        else
-          headingcalc = heading_old;
-      }
-      else {
-        speedcalc = speed;
-        headingcalc = heading;
-      }
-      if (process->mbp_heading_mode == MBP_HEADING_CALC || process->mbp_heading_mode == MBP_HEADING_CALCOFFSET) {
-        heading = headingcalc;
       }
-      else {
-        speed = speedcalc;
-      }
-      time_d_old = time_d;
-      navlon_old = navlon;
-      navlat_old = navlat;
-      heading_old = headingcalc;
-      speed_old = speedcalc;
-    }
-
-    /* adjust heading if required */
-    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source) &&
-        (process->mbp_heading_mode == MBP_HEADING_OFFSET || process->mbp_heading_mode == MBP_HEADING_CALCOFFSET)) {
-      heading += process->mbp_headingbias;
-      if (heading >= 360.0)
-        heading -= 360.0;
-      else if (heading < 0.0)
-        heading += 360.0;
     }
 
     /*--------------------------------------------
-      deal with bathymetry
+      apply grazing angle corrections to amplitude and sidescan
       --------------------------------------------*/
 
-    /* if survey data encountered,
-        get the bathymetry */
-    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-
-      /*--------------------------------------------
-        get travel time values
-        --------------------------------------------*/
-
-      /* extract travel times if they exist */
-      if (traveltime) {
-        *status = mb_ttimes(verbose, imbio_ptr, store_ptr, &kind, &nbeams, ttimes, angles, angles_forward,
-                           angles_null, bheave, alongtrack_offset, &draft_org, &ssv, error);
+    /* correct amplitude and sidescan using slopes from multibeam swath data */
+    if ((process->mbp_ampcorr_mode == MBP_AMPCORR_ON && (process->mbp_ampcorr_slope == MBP_AMPCORR_IGNORESLOPE ||
+                                                        process->mbp_ampcorr_slope == MBP_AMPCORR_USESLOPE)) ||
+        (process->mbp_sscorr_mode == MBP_SSCORR_ON &&
+         (process->mbp_sscorr_slope == MBP_SSCORR_IGNORESLOPE || process->mbp_sscorr_slope == MBP_SSCORR_USESLOPE))) {
+      /* get seafloor slopes if needed for amplitude or sidescan correction */
+      if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
+          ((process->mbp_ampcorr_mode == MBP_AMPCORR_ON && nampcorrtable > 0 && nampcorrangle > 0) ||
+           (process->mbp_sscorr_mode == MBP_SSCORR_ON && nsscorrtable > 0 && nsscorrangle > 0))) {
+        mb_pr_set_bathyslope(verbose, nsmooth, nbath, beamflag, bath, bathacrosstrack, &ndepths, depths,
+                             depthacrosstrack, &nslopes, slopes, slopeacrosstrack, depthsmooth, error);
       }
 
-      /* estimate travel times if they don't exist */
-      else {
-        draft_org = sonardepth - heave;
-        ssv = 1500.0;
-        nbeams = nbath;
-        for (int i = 0; i < nbath; i++) {
-          if (beamflag[i] != MB_FLAG_NULL) {
-            zz = bath[i] - sonardepth;
-            rr = sqrt(zz * zz + bathacrosstrack[i] * bathacrosstrack[i] +
-                      bathalongtrack[i] * bathalongtrack[i]);
-            ttimes[i] = rr / 750.0;
-            mb_xyz_to_takeoff(verbose, bathacrosstrack[i], bathalongtrack[i], (bath[i] - sonardepth),
-                              &angles[i], &angles_forward[i], error);
-          }
-          else {
-            angles[i] = 0.0;
-            angles_forward[i] = 0.0;
-          }
-          angles_null[i] = 0.0;
-          bheave[i] = 0.0;
-          alongtrack_offset[i] = 0.0;
-        }
-      }
+      /* correct the amplitude if desired */
+      if (process->mbp_ampcorr_mode == MBP_AMPCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
+          nampcorrtable > 0 && nampcorrangle > 0) {
+        /* calculate the correction table */
+        *status = get_corrtable(verbose, time_d, nampcorrtable, nampcorrangle, ampcorrtable, &ampcorrtableuse, error);
 
-      /*--------------------------------------------
-        handle adjustments to ssv, heave, and travel times
-        --------------------------------------------*/
+        /* set the reference amplitudes */
+        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
+                               (-process->mbp_ampcorr_angle), &reference_amp_port, error);
+        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
+                               process->mbp_ampcorr_angle, &reference_amp_stbd, error);
+        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
 
-      /* set surface sound speed to default if needed */
-      if (ssv <= 0.0)
-        ssv = ssv_start;
-      else
-        ssv_start = ssv;
+        /* get seafloor slopes */
+        for (int i = 0; i < namp; i++) {
+          if (mb_beam_ok(beamflag[i])) {
+            bathy = 0.0;
+            if (ndepths > 1) {
+              *status = mb_pr_get_bathyslope(verbose, ndepths, depths, depthacrosstrack, nslopes, slopes,
+                                            slopeacrosstrack, bathacrosstrack[i], &bathy, &slope, error);
+              if (*status != MB_SUCCESS) {
+                bathy = 0.0;
+                slope = 0.0;
+                *status = MB_SUCCESS;
+                *error = MB_ERROR_NO_ERROR;
+              }
+            }
+            if (bathy <= 0.0) {
+              if (altitude > 0.0)
+                bathy = altitude + sonardepth;
+              else
+                bathy = altitude_default + sonardepth;
+              slope = 0.0;
+            }
 
-      /* if heave adjustment specified do it */
-      if (process->mbp_heave_mode != MBP_HEAVE_OFF) {
-        if (process->mbp_heave_mode == MBP_HEAVE_MULTIPLY || process->mbp_heave_mode == MBP_HEAVE_MULTIPLYOFFSET) {
-          for (int i = 0; i < nbath; i++)
-            bheave[i] *= process->mbp_heave_mult;
-        }
-        if (process->mbp_heave_mode == MBP_HEAVE_OFFSET || process->mbp_heave_mode == MBP_HEAVE_MULTIPLYOFFSET) {
-          for (int i = 0; i < nbath; i++)
-            bheave[i] += process->mbp_heave;
+            if (bathy > 0.0) {
+              altitude_use = bathy - sonardepth;
+              angle = RTD * atan(bathacrosstrack[i] / altitude_use);
+              if (process->mbp_ampcorr_slope != MBP_AMPCORR_IGNORESLOPE)
+                angle += RTD * atan(slope);
+              *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle,
+                                     ampcorrtableuse.amplitude, angle, &correction, error);
+              if (process->mbp_ampcorr_type == MBP_AMPCORR_SUBTRACTION)
+                amp[i] = amp[i] - correction + reference_amp;
+              else
+                amp[i] = amp[i] / correction * reference_amp;
+            }
+          }
         }
       }
 
-      /* if tt adjustment specified do it */
-      if (process->mbp_tt_mode == MBP_TT_MULTIPLY) {
-        for (int i = 0; i < nbath; i++)
-          ttimes[i] *= process->mbp_tt_mult;
-      }
-
-      /* if ssv adjustment specified do it */
-      if (process->mbp_ssv_mode == MBP_SSV_SET) {
-        ssv = process->mbp_ssv;
-      }
-      else if (process->mbp_ssv_mode == MBP_SSV_OFFSET) {
-        ssv += process->mbp_ssv;
-      }
-
-      /*--------------------------------------------
-        recalculate the bathymetry
-        --------------------------------------------*/
+      /* correct the sidescan if desired */
+      if (process->mbp_sscorr_mode == MBP_SSCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
+          nsscorrtable > 0 && nsscorrangle > 0) {
+        /* calculate the correction table */
+        *status = get_corrtable(verbose, time_d, nsscorrtable, nsscorrangle, sscorrtable, &sscorrtableuse, error);
 
-      /* apply kluge006 - resets draft without changing bathymetry */
-      if (process->mbp_kluge006 && kind == MB_DATA_DATA) {
-        draft_org = draft;
-      }
+        /* set the reference amplitudes */
+        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
+                               (-process->mbp_sscorr_angle), &reference_amp_port, error);
+        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
+                               process->mbp_sscorr_angle, &reference_amp_stbd, error);
+        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
 
-      /* if svp specified recalculate bathymetry
-          by raytracing  */
-      if (process->mbp_bathrecalc_mode == MBP_BATHRECALC_RAYTRACE) {
-        /* loop over the beams */
-        for (int i = 0; i < nbeams; i++) {
-          if (ttimes[i] > 0.0) {
-            /* if needed, translate angles from takeoff
-                angle coordinates to roll-pitch
-                coordinates, apply roll and pitch
-                corrections, and translate back */
-            if (process->mbp_rollbias_mode != MBP_ROLLBIAS_OFF ||
-                process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON || process->mbp_nav_attitude == MBP_NAV_ON ||
-                process->mbp_attitude_mode == MBP_ATTITUDE_ON || process->mbp_kluge003) {
-              mb_takeoff_to_rollpitch(verbose, angles[i], angles_forward[i], &alpha, &beta, error);
-              /* apply kluge_003 - enables correction of beam angles in
-                   SeaBeam 2112 data
-                   - a data sample from the SeaBeam 2112 on
-                         the USCG Icebreaker Healy (collected on
-                         23 July 2003) was found to have an error
-                         in which the beam angles had 0.25 times
-                         the roll added
-                   - this correction subtracts 0.25 * roll
-                         from the beam angles before the bathymetry
-                         is recalculated by raytracing through a
-                         water sound velocity profile
-                   - the mbprocess parameter files must be
-                         set to enable bathymetry recalculation
-                         by raytracing in order to apply this
-                         correction */
-              if (process->mbp_kluge003)
-                beta -= 0.25 * roll;
-              if (process->mbp_nav_attitude == MBP_NAV_ON || process->mbp_attitude_mode == MBP_ATTITUDE_ON) {
-                beta += roll - roll_org;
-                alpha += pitch - pitch_org;
+        /* get seafloor slopes */
+        for (int i = 0; i < nss; i++) {
+          if (ss[i] > MB_SIDESCAN_NULL) {
+            bathy = 0.0;
+            if (ndepths > 1) {
+              *status = mb_pr_get_bathyslope(verbose, ndepths, depths, depthacrosstrack, nslopes, slopes,
+                                            slopeacrosstrack, ssacrosstrack[i], &bathy, &slope, error);
+              if (*status != MB_SUCCESS) {
+                bathy = 0.0;
+                slope = 0.0;
+                *status = MB_SUCCESS;
+                *error = MB_ERROR_NO_ERROR;
               }
-              if (process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON)
-                alpha += process->mbp_pitchbias;
-              if (process->mbp_rollbias_mode == MBP_ROLLBIAS_SINGLE)
-                beta += process->mbp_rollbias;
-              else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE && angles[i] >= 0.0)
-                beta += process->mbp_rollbias_stbd;
-              else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE)
-                beta += process->mbp_rollbias_port;
-              mb_rollpitch_to_takeoff(verbose, alpha, beta, &angles[i], &angles_forward[i], error);
             }
-
-            /* add heave and draft */
-            depth_offset_use = bheave[i] + draft + lever_heave;
-
-            /* check depth_offset - use static shift if depth_offset negative */
-            if (depth_offset_use >= depth[0]) {
-              static_shift = 0.0;
+            if (bathy <= 0.0) {
+              if (altitude > 0.0)
+                bathy = altitude + sonardepth;
+              else
+                bathy = altitude_default + sonardepth;
+              slope = 0.0;
             }
-            else {
-              static_shift = depth_offset_use - depth[0];
 
-              if (verbose > 0) {
-                fprintf(stderr, "\nWarning: Sonar depth is shallower than the top\n");
-                fprintf(stderr, "of the SVP - transducers above water?!\n");
-                fprintf(stderr, "Raytracing performed from top of SVP followed by static shift.\n");
-                fprintf(stderr, "Sonar depth is sum of heave + draft (or transducer depth).\n");
-                fprintf(stderr, "Draft from data:       %f\n", draft);
-                fprintf(stderr, "Heave from data:       %f\n", bheave[i]);
-                fprintf(stderr, "Heave from lever calc: %f\n", lever_heave);
-                fprintf(stderr, "User specified draft:  %f\n", process->mbp_draft);
-                fprintf(stderr, "Depth offset used:     %f\n", depth_offset_use);
-                fprintf(stderr, "Data Record: %d\n", odata);
-                fprintf(stderr, "Ping time:  %4d %2d %2d %2d:%2d:%2d.%6d\n", time_i[0], time_i[1],
-                        time_i[2], time_i[3], time_i[4], time_i[5], time_i[6]);
+            if (bathy > 0.0) {
+              altitude_use = bathy - sonardepth;
+              angle = RTD * atan(ssacrosstrack[i] / altitude_use);
+              if (process->mbp_sscorr_slope != MBP_SSCORR_IGNORESLOPE) {
+                angle += RTD * atan(slope);
+              }
+              *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle,
+                                     sscorrtableuse.amplitude, angle, &correction, error);
+              if (process->mbp_sscorr_type == MBP_SSCORR_SUBTRACTION) {
+                ss[i] = ss[i] - correction + reference_amp;
+              }
+              else {
+                ss[i] = ss[i] / correction * reference_amp;
               }
             }
+          }
+        }
+      }
+    }
+
+    /* correct amplitude and sidescan using slopes from topography grid */
+    else if ((process->mbp_ampcorr_mode == MBP_AMPCORR_ON &&
+              (process->mbp_ampcorr_slope == MBP_AMPCORR_USETOPO ||
+               process->mbp_ampcorr_slope == MBP_AMPCORR_USETOPOSLOPE)) ||
+             (process->mbp_sscorr_mode == MBP_SSCORR_ON && (process->mbp_sscorr_slope == MBP_SSCORR_USETOPO ||
+                                                           process->mbp_sscorr_slope == MBP_SSCORR_USETOPOSLOPE))) {
+      /* get distance scaling and heading vector */
+      mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
+      headingx = sin(heading * DTR);
+      headingy = cos(heading * DTR);
+
+      /* correct the amplitude if desired */
+      if (process->mbp_ampcorr_mode == MBP_AMPCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
+          nampcorrtable > 0 && nampcorrangle > 0) {
+        /* calculate the correction table */
+        *status = get_corrtable(verbose, time_d, nampcorrtable, nampcorrangle, ampcorrtable, &ampcorrtableuse, error);
+
+        /* set the reference amplitudes */
+        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
+                               (-process->mbp_ampcorr_angle), &reference_amp_port, error);
+        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
+                               process->mbp_ampcorr_angle, &reference_amp_stbd, error);
+        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
+
+        /* get seafloor slopes */
+        for (int i = 0; i < namp; i++) {
+          if (mb_beam_ok(beamflag[i])) {
+            /* get position in grid */
+            r[0] = headingy * bathacrosstrack[i] + headingx * bathalongtrack[i];
+            r[1] = -headingx * bathacrosstrack[i] + headingy * bathalongtrack[i];
+            const int ix = (navlon + r[0] * mtodeglon - grid->xmin + 0.5 * grid->dx) / grid->dx;
+            const int jy = (navlat + r[1] * mtodeglat - grid->ymin + 0.5 * grid->dy) / grid->dy;
+            const int kgrid = ix * grid->n_rows + jy;
+            const int kgrid00 = (ix - 1) * grid->n_rows + jy - 1;
+            const int kgrid01 = (ix - 1) * grid->n_rows + jy + 1;
+            const int kgrid10 = (ix + 1) * grid->n_rows + jy - 1;
+            const int kgrid11 = (ix + 1) * grid->n_rows + jy + 1;
+            if (ix > 0 && ix < grid->n_columns - 1 && jy > 0 && jy < grid->n_rows - 1 &&
+                grid->data[kgrid] > grid->nodatavalue && grid->data[kgrid00] > grid->nodatavalue &&
+                grid->data[kgrid01] > grid->nodatavalue && grid->data[kgrid10] > grid->nodatavalue &&
+                grid->data[kgrid11] > grid->nodatavalue) {
+              /* get look vector for data */
+              bathy = -grid->data[kgrid];
+              r[2] = grid->data[kgrid] + sonardepth;
+              rr = -sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+              r[0] /= rr;
+              r[1] /= rr;
+              r[2] /= rr;
+
+              /* get normal vector to grid surface */
+              if (process->mbp_ampcorr_slope == MBP_SSCORR_USETOPOSLOPE) {
+                v1[0] = 2.0 * grid->dx / mtodeglon;
+                v1[1] = 2.0 * grid->dy / mtodeglat;
+                v1[2] = grid->data[kgrid11] - grid->data[kgrid00];
+                v2[0] = -2.0 * grid->dx / mtodeglon;
+                v2[1] = 2.0 * grid->dy / mtodeglat;
+                v2[2] = grid->data[kgrid01] - grid->data[kgrid10];
+                v[0] = v1[1] * v2[2] - v2[1] * v1[2];
+                v[1] = v2[0] * v1[2] - v1[0] * v2[2];
+                v[2] = v1[0] * v2[1] - v2[0] * v1[1];
+                vv = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+                v[0] /= vv;
+                v[1] /= vv;
+                v[2] /= vv;
+              }
+              else {
+                v[0] = 0.0;
+                v[1] = 0.0;
+                v[2] = 1.0;
+              }
+
+              /* angle between look vector and surface normal
+                  is the acos(r dot v) */
+              angle = RTD * acos(r[0] * v[0] + r[1] * v[1] + r[2] * v[2]);
+              if (bathacrosstrack[i] < 0.0)
+                angle = -angle;
 
-            /* raytrace */
-            *status = mb_rt(verbose, rt_svp, (depth_offset_use - static_shift), angles[i], 0.5 * ttimes[i],
-                           process->mbp_angle_mode, ssv, angles_null[i], 0, nullptr, nullptr, nullptr, nullptr, &xx, &zz, &ttime,
-                           &ray_stat, error);
-
-            /* apply static shift if any */
-            zz += static_shift;
-
-            /* get alongtrack and acrosstrack distances and depth */
-            bathacrosstrack[i] = xx * cos(DTR * angles_forward[i]);
-            bathalongtrack[i] = xx * sin(DTR * angles_forward[i]) + alongtrack_offset[i];
-            bath[i] = zz;
-
-            if (verbose >= 5) {
-              fprintf(stderr, "dbg5       %3d %3d %6.3f %6.3f %6.3f %8.2f %8.2f %8.2f\n", idata, i,
-                      0.5 * ttimes[i], angles[i], angles_forward[i], bathacrosstrack[i], bathalongtrack[i],
-                      bath[i]);
             }
-            if (verbose >= 5) {
-              fprintf(stderr, "\ndbg5  Depth value calculated in program <%s>:\n", program_name);
-              fprintf(stderr, "dbg5       kind:  %d\n", kind);
-              fprintf(stderr, "dbg5       beam:  %d\n", i);
-              fprintf(stderr, "dbg5       tt:     %f\n", ttimes[i]);
-              fprintf(stderr, "dbg5       xx:     %f\n", xx);
-              fprintf(stderr, "dbg5       zz:     %f\n", zz);
-              fprintf(stderr, "dbg5       xtrack: %f\n", bathacrosstrack[i]);
-              fprintf(stderr, "dbg5       ltrack: %f\n", bathalongtrack[i]);
-              fprintf(stderr, "dbg5       depth:  %f\n", bath[i]);
+            else {
+              if (ix >= 0 && ix < grid->n_columns && jy >= 0 && jy < grid->n_rows && grid->data[kgrid] > grid->nodatavalue)
+                bathy = -grid->data[kgrid];
+              else
+                bathy = bath[i];
+              angle = RTD * atan(bathacrosstrack[i] / (bathy - sonardepth));
+              slope = 0.0;
             }
-          }
 
-          /* else if no travel time no data */
-          else
-            beamflag[i] = MB_FLAG_NULL;
+            /* apply correction */
+            *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle,
+                                   ampcorrtableuse.amplitude, angle, &correction, error);
+            if (process->mbp_ampcorr_type == MBP_AMPCORR_SUBTRACTION)
+              amp[i] = amp[i] - correction + reference_amp;
+            else
+              amp[i] = amp[i] / correction * reference_amp;
+          }
         }
       }
 
-      /* recalculate bathymetry by rigid rotations  */
-      else if (process->mbp_bathrecalc_mode == MBP_BATHRECALC_ROTATE) {
-        /* loop over the beams */
-        for (int i = 0; i < nbath; i++) {
-          if (beamflag[i] != MB_FLAG_NULL) {
-            /* output some debug messages */
-            if (verbose >= 5) {
-              fprintf(stderr, "\ndbg5  Depth value to be calculated in program <%s>:\n", program_name);
-              fprintf(stderr, "dbg5       kind:  %d\n", kind);
-              fprintf(stderr, "dbg5       beam:  %d\n", i);
-              fprintf(stderr, "dbg5       xtrack: %f\n", bathacrosstrack[i]);
-              fprintf(stderr, "dbg5       ltrack: %f\n", bathalongtrack[i]);
-              fprintf(stderr, "dbg5       depth:  %f\n", bath[i]);
-            }
+      /* correct the sidescan if desired */
+      if (process->mbp_sscorr_mode == MBP_SSCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
+          nsscorrtable > 0 && nsscorrangle > 0) {
+        /* calculate the correction table */
+        *status = get_corrtable(verbose, time_d, nsscorrtable, nsscorrangle, sscorrtable, &sscorrtableuse, error);
 
-            /* add heave and draft */
-            depth_offset_use = bheave[i] + draft + lever_heave;
-            depth_offset_org = bheave[i] + draft_org;
+        /* set the reference amplitudes */
+        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
+                               (-process->mbp_sscorr_angle), &reference_amp_port, error);
+        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
+                               process->mbp_sscorr_angle, &reference_amp_stbd, error);
+        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
 
-            /* strip off heave + draft */
-            bath[i] -= depth_offset_org;
+        /* get seafloor slopes */
+        for (int i = 0; i < nss; i++) {
+          if (ss[i] > MB_SIDESCAN_NULL) {
+            /* get position in grid */
+            r[0] = headingy * ssacrosstrack[i] + headingx * ssalongtrack[i];
+            r[1] = -headingx * ssacrosstrack[i] + headingy * ssalongtrack[i];
+            const int ix = (navlon + r[0] * mtodeglon - grid->xmin + 0.5 * grid->dx) / grid->dx;
+            const int jy = (navlat + r[1] * mtodeglat - grid->ymin + 0.5 * grid->dy) / grid->dy;
+            const int kgrid = ix * grid->n_rows + jy;
+            const int kgrid00 = (ix - 1) * grid->n_rows + jy - 1;
+            const int kgrid01 = (ix - 1) * grid->n_rows + jy + 1;
+            const int kgrid10 = (ix + 1) * grid->n_rows + jy - 1;
+            const int kgrid11 = (ix + 1) * grid->n_rows + jy + 1;
+            if (ix > 0 && ix < grid->n_columns - 1 && jy > 0 && jy < grid->n_rows - 1 &&
+                grid->data[kgrid] > grid->nodatavalue && grid->data[kgrid00] > grid->nodatavalue &&
+                grid->data[kgrid01] > grid->nodatavalue && grid->data[kgrid10] > grid->nodatavalue &&
+                grid->data[kgrid11] > grid->nodatavalue) {
+              /* get look vector for data */
+              bathy = -grid->data[kgrid];
+              r[2] = grid->data[kgrid] + sonardepth;
+              rr = -sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+              r[0] /= rr;
+              r[1] /= rr;
+              r[2] /= rr;
 
-            /* get range and angles in
-                roll-pitch frame */
-            range = sqrt(bath[i] * bath[i] + bathacrosstrack[i] * bathacrosstrack[i] +
-                         bathalongtrack[i] * bathalongtrack[i]);
-            if (fabs(range) < 0.001) {
-              alphar = 0.0;
-              betar = 0.5 * M_PI;
+              /* get normal vector to grid surface */
+              if (process->mbp_sscorr_slope == MBP_SSCORR_USETOPOSLOPE) {
+                v1[0] = 2.0 * grid->dx / mtodeglon;
+                v1[1] = 2.0 * grid->dy / mtodeglat;
+                v1[2] = grid->data[kgrid11] - grid->data[kgrid00];
+                v2[0] = -2.0 * grid->dx / mtodeglon;
+                v2[1] = 2.0 * grid->dy / mtodeglat;
+                v2[2] = grid->data[kgrid01] - grid->data[kgrid10];
+                v[0] = v1[1] * v2[2] - v2[1] * v1[2];
+                v[1] = v2[0] * v1[2] - v1[0] * v2[2];
+                v[2] = v1[0] * v2[1] - v2[0] * v1[1];
+                vv = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+                v[0] /= vv;
+                v[1] /= vv;
+                v[2] /= vv;
+              }
+              else {
+                v[0] = 0.0;
+                v[1] = 0.0;
+                v[2] = 1.0;
+              }
+
+              /* angle between look vector and surface normal
+                  is the acos(r dot v) */
+              angle = RTD * acos(r[0] * v[0] + r[1] * v[1] + r[2] * v[2]);
+              if (ssacrosstrack[i] < 0.0)
+                angle = -angle;
             }
             else {
-              alphar = asin(std::max(-1.0, std::min(1.0, (bathalongtrack[i] / range))));
-              betar = acos(std::max(-1.0, std::min(1.0, (bathacrosstrack[i] / range / cos(alphar)))));
+              if (ix >= 0 && ix < grid->n_columns && jy >= 0 && jy < grid->n_rows && grid->data[kgrid] > grid->nodatavalue)
+                bathy = -grid->data[kgrid];
+              else if (altitude > 0.0)
+                bathy = altitude + sonardepth;
+              else
+                bathy = altitude_default + sonardepth;
+              angle = RTD * atan(bathacrosstrack[i] / (bathy - sonardepth));
+              slope = 0.0;
             }
-            if (bath[i] < 0.0)
-              betar = 2.0 * M_PI - betar;
 
-            /* apply roll pitch corrections */
-            if (process->mbp_nav_attitude == MBP_NAV_ON || process->mbp_attitude_mode == MBP_ATTITUDE_ON) {
-              betar += DTR * (roll - roll_org);
-              alphar += DTR * (pitch - pitch_org);
+            /* apply correction */
+            *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle,
+                                   sscorrtableuse.amplitude, angle, &correction, error);
+            if (process->mbp_sscorr_type == MBP_SSCORR_SUBTRACTION) {
+              ss[i] = ss[i] - correction + reference_amp;
+            }
+            else {
+              ss[i] = ss[i] / correction * reference_amp;
             }
-            if (process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON)
-              alphar += DTR * process->mbp_pitchbias;
-            if (process->mbp_rollbias_mode == MBP_ROLLBIAS_SINGLE)
-              betar += DTR * process->mbp_rollbias;
-            else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE && betar <= M_PI * 0.5)
-              betar += DTR * process->mbp_rollbias_stbd;
-            else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE)
-              betar += DTR * process->mbp_rollbias_port;
-
-            /* recalculate bathymetry */
-            bath[i] = range * cos(alphar) * sin(betar);
-            bathalongtrack[i] = range * sin(alphar);
-            bathacrosstrack[i] = range * cos(alphar) * cos(betar);
-
-            /* add heave and draft back in */
-            bath[i] += depth_offset_use;
-
-            /* output some debug values */
-            if (verbose >= 5)
-              fprintf(stderr, "dbg5       %3d beam:%3d bath:%8.2f %8.2f %8.2f\n", idata, i,
-                      bathacrosstrack[i], bathalongtrack[i], bath[i]);
           }
         }
       }
+    }
 
-      /* recalculate bathymetry by changes to transducer depth  */
-      else if (process->mbp_bathrecalc_mode == MBP_BATHRECALC_OFFSET || process->mbp_tide_mode == MBP_TIDE_ON ||
-               process->mbp_lever_mode == MBP_LEVER_ON || process->mbp_navadj_mode == MBP_NAVADJ_LLZ) {
-        /* get draft change */
-        depth_offset_change = draft - draft_org + lever_heave;
+    /*--------------------------------------------
+      insert the altered data (now done)
+      --------------------------------------------*/
 
-        /* loop over the beams */
-        for (int i = 0; i < nbath; i++) {
-          if (beamflag[i] != MB_FLAG_NULL) {
-            /* apply transducer depth change to depths */
-            bath[i] += depth_offset_change;
+    /* insert the altered data if available */
+    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == MB_DATA_COMMENT)) {
+      *status = mb_insert(verbose, imbio_ptr, store_ptr, kind, time_i, time_d, navlon, navlat, speed, heading, nbath,
+                         namp, nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss, ssacrosstrack,
+                         ssalongtrack, comment, error);
+    }
 
-            if (verbose >= 5) {
-              fprintf(stderr, "dbg5       %3d %3d %8.2f %8.2f %8.2f\n", idata, i, bathacrosstrack[i],
-                      bathalongtrack[i], bath[i]);
-              fprintf(stderr, "\ndbg5  Depth value calculated in program <%s>:\n", program_name);
-              fprintf(stderr, "dbg5       kind:  %d\n", kind);
-              fprintf(stderr, "dbg5       beam:  %d\n", i);
-              fprintf(stderr, "dbg5       xtrack: %f\n", bathacrosstrack[i]);
-              fprintf(stderr, "dbg5       ltrack: %f\n", bathalongtrack[i]);
-              fprintf(stderr, "dbg5       depth:  %f\n", bath[i]);
-            }
+    /*--------------------------------------------
+      output any changed beamflags to the reverse
+      edit save file (saving the change required
+      to get back to the original flag state from
+      the processed flag state)
+      --------------------------------------------*/
+    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      for (int i = 0; i < nbath; i++) {
+        if (beamflag[i] != beamflagorg[i]) {
+          if (mb_beam_ok(beamflagorg[i])) {
+            action = MBP_EDIT_UNFLAG;
+          }
+          else if (mb_beam_check_flag_unusable(beamflagorg[i])) {
+            action = MBP_EDIT_ZERO;
+          }
+          else if (mb_beam_check_flag_manual(beamflagorg[i])) {
+            action = MBP_EDIT_FLAG;
+          }
+          else if (mb_beam_check_flag_filter(beamflagorg[i])) {
+            action = MBP_EDIT_FILTER;
+          }
+          else if (mb_beam_check_flag_sonar(beamflagorg[i])) {
+            action = MBP_EDIT_SONAR;
           }
+        *status = mbprocess_save_edit(verbose, resf_fp, time_d,
+                                                 i + pingmultiplicity * MB_ESF_MULTIPLICITY_FACTOR,
+                                                 action, error);
         }
       }
+    }
+  };
+
+  /* write a record to the output file, and to the fbt and fnv files,
+     and update the bounds used to generate the inf file */
+  auto write_ping = [&](struct mbprocess_ping_struct *ping) {
+    int *status = &ping->status;
+    int *error = &ping->error;
+    void *store_ptr = ping->store_ptr;
+    const int kind = ping->kind;
+    int *time_i = ping->time_i;
+    const double time_d = ping->time_d;
+    const double navlon = ping->navlon;
+    const double navlat = ping->navlat;
+    const double speed = ping->speed;
+    const double heading = ping->heading;
+    const double altitude = ping->altitude;
+    const double draft = ping->draft;
+    const double roll = ping->roll;
+    const double pitch = ping->pitch;
+    const double heave = ping->heave;
+    const int nbath = ping->nbath;
+    const int namp = ping->namp;
+    const int nss = ping->nss;
+    char *beamflag = ping->beamflag;
+    double *bath = ping->bath;
+    double *amp = ping->amp;
+    double *bathacrosstrack = ping->bathacrosstrack;
+    double *bathalongtrack = ping->bathalongtrack;
+    double *ss = ping->ss;
+    double *ssacrosstrack = ping->ssacrosstrack;
+    double *ssalongtrack = ping->ssalongtrack;
+    char *comment = ping->comment;
+    double headingx, headingy;
+    double mtodeglon, mtodeglat;
 
-      /*--------------------------------------------
-        change water sound reference if needed
-        --------------------------------------------*/
 
-      /* change bathymetry water sound reference if required */
-      if (process->mbp_svp_mode == MBP_SVP_SOUNDSPEEDREF ||
-          (process->mbp_svp_mode == MBP_SVP_ON && !process->mbp_corrected)) {
-        for (int i = 0; i < nbath; i++) {
-          if (beamflag[i] != MB_FLAG_NULL) {
-            /* calculate average water sound speed
-            for current depth value */
-            depth_offset_use = bheave[i] + draft + lever_heave;
-            zz = bath[i] - depth_offset_use;
-            int k = -1;
-            for (int j = 0; j < nsvp - 1; j++) {
-              if ((depth[j] < zz) && (depth[j + 1] >= zz))
-                k = j;
-            }
-            if (k > 0)
-              vsum = velocity_sum[k - 1];
-            else
-              vsum = 0.0;
-            if (k >= 0) {
-              vsum += 0.5 *
-                      (2 * velocity[k] +
-                       (zz - depth[k]) * (velocity[k + 1] - velocity[k]) / (depth[k + 1] - depth[k])) *
-                      (zz - depth[k]);
-              vavg = vsum / zz;
-            }
-            if (vavg <= 0.0)
-              vavg = 1500.0;
+    /*--------------------------------------------
+      write the processed data
+      --------------------------------------------*/
 
-            /* if uncorrected value desired */
-            if (!process->mbp_corrected)
-              bath[i] = zz * 1500.0 / vavg + depth_offset_use;
-            else
-              bath[i] = zz * vavg / 1500.0 + depth_offset_use;
-          }
-        }
+    /* write some data */
+    if (*error == MB_ERROR_NO_ERROR || (kind == MB_DATA_COMMENT && !process->mbp_strip_comments)) {
+      *status = mb_put_all(verbose, ombio_ptr, store_ptr, false, kind, time_i, time_d, navlon, navlat, speed,
+                          heading, nbath, namp, nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss,
+                          ssacrosstrack, ssalongtrack, comment, error);
+      if (*status == MB_SUCCESS) {
+        if (kind == MB_DATA_DATA)
+          odata++;
+        else if (kind == nav_source)
+          onav++;
+        else if (kind == MB_DATA_COMMENT)
+          ocomment++;
+        else
+          oother++;
+      }
+      else {
+        char *message = nullptr;
+        mb_error(verbose, *error, &message);
+        fprintf(stderr, "\nMBIO Error returned from function <mb_put>:\n%s\n", message);
+        fprintf(stderr, "\nMultibeam Data Not Written To File <%s>\n", process->mbp_ofile);
+        fprintf(stderr, "Output Record: %d\n", odata + 1);
+        fprintf(stderr, "Time: %4d %2d %2d %2d:%2d:%2d.%6d\n", time_i[0], time_i[1], time_i[2], time_i[3],
+                time_i[4], time_i[5], time_i[6]);
+        fprintf(stderr, "\nProgram <%s> Terminated\n", program_name);
+        exit(*error);
       }
 
-      /*--------------------------------------------
-        apply per-beam static offsets
-        --------------------------------------------*/
+      if (*status == MB_SUCCESS && kind == MB_DATA_DATA) {
 
-      /* apply static corrections */
-      if (process->mbp_static_mode == MBP_STATIC_BEAM_ON && nstatic > 0 && nstatic <= nbath) {
-        for (int i = 0; i < nstatic; i++) {
-          if (staticbeam[i] >= 0 && staticbeam[i] < nbath) {
-            if (beamflag[staticbeam[i]] != MB_FLAG_NULL)
-              bath[staticbeam[i]] -= staticoffset[i];
-          }
+        /* output fbt */
+        if (make_fbt) {
+          fstore->sensorhead = ping->sensorhead;
+          fstore->topo_type = ping->sensortype;
+          fstore->beam_xwidth = ping->beamwidth_xtrack;
+          fstore->beam_lwidth = ping->beamwidth_ltrack;
+          fstore->kind = kind;
+          mb_insert_nav(verbose, fmbio_ptr, fstore_ptr, time_i, time_d,
+                        navlon, navlat, speed, heading, draft,
+                        roll, pitch, heave, error);
+          mb_insert_altitude(verbose, fmbio_ptr, fstore_ptr, draft, altitude, error);
+          *status = mb_insert(verbose, fmbio_ptr, fstore_ptr, kind, time_i, time_d,
+                              navlon, navlat, speed, heading, nbath, namp, nss,
+                              beamflag, bath, amp, bathacrosstrack, bathalongtrack,
+                              ss, ssacrosstrack, ssalongtrack, comment, error);
+          *status = mb_put_all(verbose, fmbio_ptr, fstore_ptr, false,
+                              kind, time_i, time_d, navlon, navlat, speed,
+                              heading, nbath, 0, 0,
+                              beamflag, bath, nullptr, bathacrosstrack, bathalongtrack,
+                              nullptr, nullptr, nullptr, comment, error);
         }
-      }
 
-      /*--------------------------------------------
-        apply per-angle static offsets
-        --------------------------------------------*/
+        // get scaling for both fnv and inf calculations
+        mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
+        headingx = sin(heading * DTR);
+        headingy = cos(heading * DTR);
 
-      /* apply static corrections */
-      if (process->mbp_static_mode == MBP_STATIC_ANGLE_ON && nstatic > 0) {
-        int istatic = 0;
-        mb_pr_set_bathyslope(verbose, nsmooth, nbath, beamflag, bath, bathacrosstrack, &ndepths, depths,
-                             depthacrosstrack, &nslopes, slopes, slopeacrosstrack, depthsmooth, error);
-        for (int i = 0; i < nbath; i++) {
-          if (mb_beam_ok(beamflag[i])) {
-            bathy = 0.0;
-            if (ndepths > 1) {
-              *status = mb_pr_get_bathyslope(verbose, ndepths, depths, depthacrosstrack, nslopes, slopes,
-                                            slopeacrosstrack, bathacrosstrack[i], &bathy, &slope, error);
-              if (bathy <= 0.0) {
-                if (altitude > 0.0)
-                  bathy = altitude + sonardepth;
-                else
-                  bathy = altitude_default + sonardepth;
-                slope = 0.0;
-              }
-              if (bathy > 0.0) {
-                altitude_use = bathy - sonardepth;
-                angle = RTD * atan(bathacrosstrack[i] / altitude_use);
+        /* output fnv */
+        /* mblist output: tMXYHScRPr=X=Y+X+Y */
+        if (make_fnv) {
+          double seconds = time_i[5] + 1e-6 * time_i[6];
+          int beam_port, beam_vertical, beam_stbd;
+          int pixel_port, pixel_vertical, pixel_stbd;
+          *status = mb_swathbounds(verbose, true, nbath, 0,
+                              beamflag, bathacrosstrack, nullptr, nullptr,
+                              &beam_port, &beam_vertical, &beam_stbd,
+                              &pixel_port, &pixel_vertical, &pixel_stbd, error);
+          double portlon = navlon
+                            + headingy * mtodeglon * bathacrosstrack[beam_port]
+                            + headingx * mtodeglon * bathalongtrack[beam_port];
+          double portlat = navlat
+                            - headingx * mtodeglat * bathacrosstrack[beam_port]
+                            + headingy * mtodeglat * bathalongtrack[beam_port];
+          double stbdlon = navlon
+                            + headingy * mtodeglon * bathacrosstrack[beam_stbd]
+                            + headingx * mtodeglon * bathalongtrack[beam_stbd];
+          double stbdlat = navlat
+                            - headingx * mtodeglat * bathacrosstrack[beam_stbd]
+                            + headingy * mtodeglat * bathalongtrack[beam_stbd];
 
-                /* Get offset from SBO file */
-                *status = mb_linear_interp(verbose, staticangle - 1, staticoffset - 1, nstatic, angle,
-                                          &correction, &istatic, error);
-                bath[i] -= correction;
-              }
+          fprintf(nfp, "%.4d %.2d %.2d %.2d %.2d %09.6f\t%.6f\t"
+                        "%15.10f\t%15.10f\t%7.3f\t%6.3f\t%.4f\t%6.3f\t%6.3f\t%7.4f\t"
+                        "%15.10f\t%15.10f\t%15.10f\t%15.10f\n",
+                  time_i[0], time_i[1], time_i[2], time_i[3], time_i[4], seconds,
+                  time_d, navlon, navlat, heading, speed, draft, roll, pitch, heave,
+                  portlon, portlat, stbdlon, stbdlat);
+        }
+
+        /* get bounds for mbinfo call to generate the *.inf file
+            - use only data with good navigation and valid soundings or pixels */
+        if (fabs(navlon) >= 0.005 || fabs(navlat) >= 0.005) {
+          if (mask_bounds_init) {
+            mask_bounds[0] = std::min(mask_bounds[0], navlon);
+            mask_bounds[1] = std::max(mask_bounds[1], navlon);
+            mask_bounds[2] = std::min(mask_bounds[2], navlat);
+            mask_bounds[3] = std::max(mask_bounds[3], navlat);
+          } else {
+            mask_bounds[0] = navlon;
+            mask_bounds[1] = navlon;
+            mask_bounds[2] = navlat;
+            mask_bounds[3] = navlat;
+            mask_bounds_init = true;
+          }
+          for (int i=0; i<nbath; i++) {
+            if (mb_beam_ok(beamflag[i])) {
+              double bathlon = navlon
+                          + headingy * mtodeglon * bathacrosstrack[i]
+                          + headingx * mtodeglon * bathalongtrack[i];
+              double bathlat = navlat
+                          - headingx * mtodeglat * bathacrosstrack[i]
+                          + headingy * mtodeglat * bathalongtrack[i];
+
+              mask_bounds[0] = std::min(mask_bounds[0], bathlon);
+              mask_bounds[1] = std::max(mask_bounds[1], bathlon);
+              mask_bounds[2] = std::min(mask_bounds[2], bathlat);
+              mask_bounds[3] = std::max(mask_bounds[3], bathlat);
+            }
+          }
+          for (int i=0; i<nss; i++) {
+            if (ss[i] > MB_SIDESCAN_NULL) {
+              double sslon = navlon
+                          + headingy * mtodeglon * ssacrosstrack[i]
+                          + headingx * mtodeglon * ssalongtrack[i];
+              double sslat = navlat
+                          - headingx * mtodeglat * ssacrosstrack[i]
+                          + headingy * mtodeglat * ssalongtrack[i];
+              mask_bounds[0] = std::min(mask_bounds[0], sslon);
+              mask_bounds[1] = std::max(mask_bounds[1], sslon);
+              mask_bounds[2] = std::min(mask_bounds[2], sslat);
+              mask_bounds[3] = std::max(mask_bounds[3], sslat);
             }
           }
         }
-      }
 
-      /* output some debug messages */
-      if (verbose >= 5) {
-        fprintf(stderr, "\ndbg5  Depth values calculated in program <%s>:\n", program_name);
-        fprintf(stderr, "dbg5       kind:  %d\n", kind);
-        fprintf(stderr, "dbg5      beam    ttime      depth        xtrack    ltrack      flag\n");
-        for (int i = 0; i < nbath; i++)
-          fprintf(stderr, "dbg5       %2d   %f   %f   %f   %f   %d\n", i, ttimes[i], bath[i],
-                  bathacrosstrack[i], bathalongtrack[i], beamflag[i]);
       }
     }
+  };
+
+  /* save the values of the record just read in a ping slot - when the
+     record is queued in the pipeline the slot gets its own copy of the
+     data store and arrays, otherwise it refers to those used for reading */
+  auto save_ping = [&](struct mbprocess_ping_struct *ping, bool copy) {
+    ping->skip = false;
+    ping->status = *status;
+    ping->error = *error;
+    ping->kind = kind;
+    for (int i = 0; i < 7; i++)
+      ping->time_i[i] = time_i[i];
+    ping->time_d = time_d;
+    ping->navlon = navlon;
+    ping->navlat = navlat;
+    ping->speed = speed;
+    ping->heading = heading;
+    ping->altitude = altitude;
+    ping->sonardepth = sonardepth;
+    ping->draft = draft;
+    ping->roll = roll;
+    ping->pitch = pitch;
+    ping->heave = heave;
+    ping->draft_org = draft_org;
+    ping->roll_org = roll_org;
+    ping->pitch_org = pitch_org;
+    ping->lever_heave = lever_heave;
+    ping->ssv = ssv;
+    struct mb_io_struct *imb_io_ptr = (struct mb_io_struct *)imbio_ptr;
+    ping->beamwidth_xtrack = imb_io_ptr->beamwidth_xtrack;
+    ping->beamwidth_ltrack = imb_io_ptr->beamwidth_ltrack;
+    ping->idata = idata;
+    ping->pingmultiplicity = pingmultiplicity;
+    ping->sensorhead = sensorhead;
+    ping->sensortype = sensortype;
+    ping->nbath = nbath;
+    ping->namp = namp;
+    ping->nss = nss;
+    ping->nbeams = nbeams;
+    strncpy(ping->comment, comment, MB_COMMENT_MAXLINE);
+
+    if (!copy) {
+      ping->store_ptr = store_ptr;
+      ping->beamflag = beamflag;
+      ping->beamflagorg = beamflagorg;
+      ping->bath = bath;
+      ping->amp = amp;
+      ping->bathacrosstrack = bathacrosstrack;
+      ping->bathalongtrack = bathalongtrack;
+      ping->ss = ss;
+      ping->ssacrosstrack = ssacrosstrack;
+      ping->ssalongtrack = ssalongtrack;
+      ping->ttimes = ttimes;
+      ping->angles = angles;
+      ping->angles_forward = angles_forward;
+      ping->angles_null = angles_null;
+      ping->bheave = bheave;
+      ping->alongtrack_offset = alongtrack_offset;
+      return true;
+    }
+
+    int copy_error = MB_ERROR_NO_ERROR;
+    if (mb_copyrecord(verbose, imbio_ptr, store_ptr, ping->store_copy, &copy_error) != MB_SUCCESS)
+      return false;
+    ping->store_ptr = ping->store_copy;
+
+    /* the arrays are copied at their allocated sizes, as registered with mbio */
+    const size_t nbath_alloc = std::max(imb_io_ptr->beams_bath_max, 1);
+    const size_t namp_alloc = std::max(imb_io_ptr->beams_amp_max, 1);
+    const size_t nss_alloc = std::max(imb_io_ptr->pixels_ss_max, 1);
+    if (ping->flag_copy.size() < 2 * nbath_alloc)
+      ping->flag_copy.resize(2 * nbath_alloc);
+    if (ping->value_copy.size() < 9 * nbath_alloc + namp_alloc + 3 * nss_alloc)
+      ping->value_copy.resize(9 * nbath_alloc + namp_alloc + 3 * nss_alloc);
+    ping->beamflag = &ping->flag_copy[0];
+    ping->beamflagorg = &ping->flag_copy[nbath_alloc];
+    ping->bath = &ping->value_copy[0];
+    ping->bathacrosstrack = &ping->value_copy[nbath_alloc];
+    ping->bathalongtrack = &ping->value_copy[2 * nbath_alloc];
+    ping->ttimes = &ping->value_copy[3 * nbath_alloc];
+    ping->angles = &ping->value_copy[4 * nbath_alloc];
+    ping->angles_forward = &ping->value_copy[5 * nbath_alloc];
+    ping->angles_null = &ping->value_copy[6 * nbath_alloc];
+    ping->bheave = &ping->value_copy[7 * nbath_alloc];
+    ping->alongtrack_offset = &ping->value_copy[8 * nbath_alloc];
+    ping->amp = &ping->value_copy[9 * nbath_alloc];
+    ping->ss = &ping->value_copy[9 * nbath_alloc + namp_alloc];
+    ping->ssacrosstrack = &ping->value_copy[9 * nbath_alloc + namp_alloc + nss_alloc];
+    ping->ssalongtrack = &ping->value_copy[9 * nbath_alloc + namp_alloc + 2 * nss_alloc];
+    memcpy(ping->beamflag, beamflag, nbath_alloc * sizeof(char));
+    memcpy(ping->beamflagorg, beamflagorg, nbath_alloc * sizeof(char));
+    memcpy(ping->bath, bath, nbath_alloc * sizeof(double));
+    memcpy(ping->bathacrosstrack, bathacrosstrack, nbath_alloc * sizeof(double));
+    memcpy(ping->bathalongtrack, bathalongtrack, nbath_alloc * sizeof(double));
+    memcpy(ping->ttimes, ttimes, nbath_alloc * sizeof(double));
+    memcpy(ping->angles, angles, nbath_alloc * sizeof(double));
+    memcpy(ping->angles_forward, angles_forward, nbath_alloc * sizeof(double));
+    memcpy(ping->angles_null, angles_null, nbath_alloc * sizeof(double));
+    memcpy(ping->bheave, bheave, nbath_alloc * sizeof(double));
+    memcpy(ping->alongtrack_offset, alongtrack_offset, nbath_alloc * sizeof(double));
+    memcpy(ping->amp, amp, namp_alloc * sizeof(double));
+    memcpy(ping->ss, ss, nss_alloc * sizeof(double));
+    memcpy(ping->ssacrosstrack, ssacrosstrack, nss_alloc * sizeof(double));
+    memcpy(ping->ssalongtrack, ssalongtrack, nss_alloc * sizeof(double));
+    return true;
+  };
 
-    /*--------------------------------------------
-      apply beam edits
-      --------------------------------------------*/
+  /*--------------------------------------------
+    set up the processing pipeline
+    --------------------------------------------*/
 
-    /* apply the saved edits */
-    if (process->mbp_edit_mode == MBP_EDIT_ON && esf.nedit > 0 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      /* apply edits for this ping */
-      *status = mb_esf_apply(verbose, &esf, time_d, pingmultiplicity, nbath, beamflag, error);
+  /* with a single ping thread each record is processed in place as soon
+     as it is read; otherwise the records are queued in a ring of ping
+     slots tagged by their input order - this thread reads and edits the
+     records in order, the ping threads recalculate the bathymetry of the
+     queued records in batches, and a writer thread outputs the records
+     in order and frees their slots */
+  bool pipelined = ping_threads > 1;
+  const int nslot = pipelined ? MBPROCESS_PIPELINE_DEPTH * ping_threads : 1;
+  std::vector<struct mbprocess_ping_struct> ping_slots(nslot);
+  std::vector<struct mbprocess_work_struct> works(pipelined ? ping_threads : 1);
+  works[0].rt_svp = rt_svp;
+  for (int islot = 0; pipelined && islot < nslot; islot++) {
+    if (mb_alloc(verbose, imbio_ptr, &ping_slots[islot].store_copy, error) != MB_SUCCESS) {
+      fprintf(stderr, "\nUnable to allocate data storage for the processing pipeline\n");
+      fprintf(stderr, "Processing file <%s> with one ping thread\n", process->mbp_ifile);
+      pipelined = false;
+      *status = MB_SUCCESS;
+      *error = MB_ERROR_NO_ERROR;
     }
+  }
+  if (pipelined && process->mbp_svp_mode != MBP_SVP_OFF) {
+    for (size_t ithread = 1; ithread < works.size(); ithread++) {
+      *status = mb_rt_init(verbose, nsvp, depth, velocity, &works[ithread].rt_svp, error);
+      if (*status == MB_SUCCESS && process->mbp_rt_table > 0.0
+          && mb_rt_table_init(verbose, works[ithread].rt_svp, process->mbp_rt_table, error) != MB_SUCCESS) {
+        *status = MB_SUCCESS;
+        *error = MB_ERROR_NO_ERROR;
+      }
+    }
+  }
 
-    /*--------------------------------------------
-      apply data cutting to bathymetry
-      --------------------------------------------*/
-
-    /* apply data cutting to bathymetry if specified */
-    if (process->mbp_cut_num > 0 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      for (icut = 0; icut < process->mbp_cut_num; icut++) {
-        /* flag data according to beam number range */
-        if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_BATH &&
-            process->mbp_cut_mode[icut] == MBP_CUT_MODE_NUMBER) {
-          istart = std::max((int)process->mbp_cut_min[icut], 0);
-          iend = std::min((int)process->mbp_cut_max[icut], nbath - 1);
-          for (int i = istart; i <= iend; i++) {
-            if (mb_beam_ok(beamflag[i]))
-              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
-          }
+  std::mutex pipeline_mutex;
+  std::condition_variable pipeline_cv;
+  int nread = 0;
+  int nrecalculated = 0;
+  int nedited = 0;
+  int nwritten = 0;
+  int pipeline_status = MB_SUCCESS;
+  int pipeline_error = MB_ERROR_NO_ERROR;
+  bool reading_done = false;
+  bool editing_done = false;
+  bool pipeline_stop = false;
+
+  /* ping thread - recalculates the next queued records */
+  auto recalculate_pings = [&](struct mbprocess_work_struct *work) {
+    std::unique_lock<std::mutex> lock(pipeline_mutex);
+    while (nrecalculated < nread || !reading_done) {
+      if (nrecalculated == nread) {
+        pipeline_cv.wait(lock);
+        continue;
+      }
+      const int ifirst = nrecalculated;
+      const int nbatch = std::max(1, std::min(MBPROCESS_PIPELINE_BATCH, (nread - nrecalculated) / ping_threads));
+      nrecalculated += nbatch;
+      lock.unlock();
+      for (int iping = ifirst; iping < ifirst + nbatch; iping++)
+        recalculate_ping(&ping_slots[iping % nslot], work);
+      lock.lock();
+      for (int iping = ifirst; iping < ifirst + nbatch; iping++)
+        ping_slots[iping % nslot].state = MBPROCESS_PING_RECALCULATED;
+      pipeline_cv.notify_all();
+    }
+  };
+
+  /* writer thread - outputs the edited records in order; once a record
+     ends with a fatal error the following records are dropped, as they
+     would not have been read */
+  auto write_pings = [&]() {
+    std::unique_lock<std::mutex> lock(pipeline_mutex);
+    bool write_failed = false;
+    while (nwritten < nedited || !editing_done) {
+      if (nwritten == nedited) {
+        pipeline_cv.wait(lock);
+        continue;
+      }
+      struct mbprocess_ping_struct *ping = &ping_slots[nwritten % nslot];
+      const bool skip = ping->skip || write_failed;
+      lock.unlock();
+      if (!skip)
+        write_ping(ping);
+      lock.lock();
+      if (!skip && ping->error > MB_ERROR_NO_ERROR) {
+        write_failed = true;
+        if (!pipeline_stop) {
+          pipeline_stop = true;
+          pipeline_status = ping->status;
+          pipeline_error = ping->error;
         }
+      }
+      ping->state = MBPROCESS_PING_FREE;
+      nwritten++;
+      pipeline_cv.notify_all();
+    }
+  };
+
+  /* edit the recalculated records in order until the slot for record
+     iread is free, or until all records read have been edited if
+     iread is negative - returns false once reading should stop */
+  auto edit_pings = [&](int iread) {
+    std::unique_lock<std::mutex> lock(pipeline_mutex);
+    while (iread >= 0 ? ping_slots[iread % nslot].state != MBPROCESS_PING_FREE : nedited < nread) {
+      struct mbprocess_ping_struct *ping = &ping_slots[nedited % nslot];
+      if (nedited == nread || ping->state != MBPROCESS_PING_RECALCULATED) {
+        pipeline_cv.wait(lock);
+        continue;
+      }
+      const bool skip = pipeline_stop;
+      lock.unlock();
+      ping->skip = skip;
+      if (!skip)
+        edit_ping(ping);
+      lock.lock();
+      if (!skip && ping->error > MB_ERROR_NO_ERROR) {
+        pipeline_stop = true;
+        pipeline_status = ping->status;
+        pipeline_error = ping->error;
+      }
+      ping->state = MBPROCESS_PING_EDITED;
+      nedited++;
+      pipeline_cv.notify_all();
+    }
+    return !pipeline_stop;
+  };
+
+  std::vector<std::thread> pipeline_threads;
+  if (pipelined) {
+    for (int ithread = 0; ithread < ping_threads; ithread++)
+      pipeline_threads.emplace_back(recalculate_pings, &works[ithread]);
+    pipeline_threads.emplace_back(write_pings);
+  }
 
-        /* flag data according to beam
-            acrosstrack distance */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_BATH &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_DISTANCE) {
-          for (int i = 0; i < nbath; i++) {
-            if (mb_beam_ok(beamflag[i]) && bathacrosstrack[i] >= process->mbp_cut_min[icut] &&
-                bathacrosstrack[i] <= process->mbp_cut_max[icut])
-              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
-          }
-        }
+  /*--------------------------------------------
+    loop over reading input
+    --------------------------------------------*/
 
-        /* flag data according to speed */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_BATH &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED) {
-          if (speed < process->mbp_cut_min[icut] || speed > process->mbp_cut_max[icut]) {
-            for (int i = 0; i < nbath; i++) {
-              if (mb_beam_ok(beamflag[i]))
-                beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
-            }
-          }
-        }
-      }
-    }
+  /* read and write */
+  while (*error <= MB_ERROR_NO_ERROR) {
+    /* read some data */
+    *error = MB_ERROR_NO_ERROR;
+    *status = MB_SUCCESS;
+    *status = mb_get_all(verbose, imbio_ptr, &store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed, &heading,
+                        &distance, &altitude, &sonardepth, &nbath, &namp, &nss, beamflag, bath, amp, bathacrosstrack,
+                        bathalongtrack, ss, ssacrosstrack, ssalongtrack, comment, error);
 
-    /*--------------------------------------------
-      insert data as altered so far (not done yet)
-      --------------------------------------------*/
+    /* time gaps do not matter to mbprocess */
+    if (*error == MB_ERROR_TIME_GAP) {
+      *status = MB_SUCCESS;
+      *error = MB_ERROR_NO_ERROR;
+    }
 
-    /* insert the altered navigation if available */
-    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source)) {
-      if (heading >= 360.0)
-        heading -= 360.0;
-      else if (heading < 0.0)
-        heading += 360.0;
-      *status = mb_insert_nav(verbose, imbio_ptr, store_ptr, time_i, time_d, navlon, navlat, speed, heading, draft,
-                             roll, pitch, heave, error);
+    /* out of bounds do not matter to mbprocess */
+    if (*error == MB_ERROR_OUT_BOUNDS) {
+      *status = MB_SUCCESS;
+      *error = MB_ERROR_NO_ERROR;
     }
 
-    /* insert the altered bathymetry, recalculate the sidescan (if that is defined),
-        and extract the results if desired */
-    if (process->mbp_ssrecalc_mode == MBP_SSRECALC_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      *status = mb_insert(verbose, imbio_ptr, store_ptr, kind, time_i, time_d, navlon, navlat, speed, heading, nbath,
-                         namp, nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss, ssacrosstrack,
-                         ssalongtrack, comment, error);
-      *status = mb_makess(verbose, imbio_ptr, store_ptr, pixel_size_set, &pixel_size, swath_width_set,
-                                      &swath_width, pixel_int, error);
-      *status = mb_extract(verbose, imbio_ptr, store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed, &heading,
-                          &nbath, &namp, &nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss,
-                          ssacrosstrack, ssalongtrack, comment, error);
+    /* non-survey data do not matter to mbprocess */
+    if (*error == MB_ERROR_OTHER) {
+      *status = MB_SUCCESS;
+      *error = MB_ERROR_NO_ERROR;
     }
 
-    /*--------------------------------------------
-      apply data cutting to amplitude and sidescan
-      --------------------------------------------*/
+    /* compare and save survey data timestamps */
+    if (process->mbp_kluge004 && error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      if (time_d <= time_d_lastping) {
+        *error = MB_ERROR_UNINTELLIGIBLE;
+        *status = MB_FAILURE;
+      }
+    }
 
-    /* apply data cutting to sidescan and amplitude if specified */
-    if (process->mbp_cut_num > 0 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      for (icut = 0; icut < process->mbp_cut_num; icut++) {
+    /* save the original beamflag states */
+    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      for (int i = 0; i < nbath; i++) {
+        beamflagorg[i] = beamflag[i];
+      }
+    }
 
-        /* flag data according to beam number range */
-        if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_AMP && process->mbp_cut_mode[icut] == MBP_CUT_MODE_NUMBER) {
-          istart = std::max((int)process->mbp_cut_min[icut], 0);
-          iend = std::min((int)process->mbp_cut_max[icut], namp - 1);
-          for (int i = istart; i <= iend; i++) {
-            if (mb_beam_ok(beamflag[i]))
-              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
-          }
-        }
+    /* detect multiple pings with the same time stamps */
+    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
+      int sensorhead_error = MB_ERROR_NO_ERROR;
+      const int sensorhead_status = mb_sensorhead(verbose, imbio_ptr, store_ptr, &sensorhead, &sensorhead_error);
+      mb_sonartype(verbose, imbio_ptr, store_ptr, &sensortype, &sensorhead_error);
+      if (sensorhead_status == MB_SUCCESS) {
+        pingmultiplicity = sensorhead;
+      }
+      else if (fabs(time_d - time_d_lastping) < MB_ESF_MAXTIMEDIFF) {
+        pingmultiplicity++;
+      }
+      else {
+        pingmultiplicity = 0;
+      }
+      time_d_lastping = time_d;
+    }
 
-        /* flag data according to beam
-            acrosstrack distance */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_AMP &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_DISTANCE) {
-          for (int i = 0; i < namp; i++) {
-            if (mb_beam_ok(beamflag[i]) && bathacrosstrack[i] >= process->mbp_cut_min[icut] &&
-                bathacrosstrack[i] <= process->mbp_cut_max[icut])
-              beamflag[i] = MB_FLAG_FLAG + MB_FLAG_MANUAL;
-          }
-        }
+    /* increment counter */
+    if (*error <= MB_ERROR_NO_ERROR && kind == MB_DATA_DATA)
+      idata++;
+    else if (*error <= MB_ERROR_NO_ERROR && kind == nav_source)
+      inav++;
+    else if (*error <= MB_ERROR_NO_ERROR && kind == MB_DATA_COMMENT)
+      icomment++;
+    else if (*error <= MB_ERROR_NO_ERROR)
+      iother++;
 
-        /* flag data according to speed */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_AMP &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED) {
-          if (speed < process->mbp_cut_min[icut] || speed > process->mbp_cut_max[icut]) {
-            for (int i = 0; i < namp; i++) {
-              amp[i] = 0.0;
-            }
-          }
-        }
+    /* output error messages */
+    if (verbose >= 1 && *error == MB_ERROR_COMMENT) {
+      if (icomment == 1)
+        fprintf(stderr, "\nComments in Input:\n");
+      fprintf(stderr, "%s\n", comment);
+    }
+    else if (verbose >= 1 && *error < MB_ERROR_NO_ERROR && *error > MB_ERROR_OTHER) {
+      char *message = nullptr;
+      mb_error(verbose, *error, &message);
+      fprintf(stderr, "\nNonfatal MBIO Error:\n%s\n", message);
+      fprintf(stderr, "Input Record: %d\n", idata);
+      fprintf(stderr, "Time: %d %d %d %d %d %d\n", time_i[0], time_i[1], time_i[2], time_i[3], time_i[4],
+              time_i[5]);
+    }
+    else if (verbose >= 1 && *error < MB_ERROR_NO_ERROR) {
+      char *message = nullptr;
+      mb_error(verbose, *error, &message);
+      fprintf(stderr, "\nNonfatal MBIO Error:\n%s\n", message);
+      fprintf(stderr, "Input Record: %d\n", idata);
+    }
+    else if (verbose >= 1 && *error != MB_ERROR_NO_ERROR && *error != MB_ERROR_EOF) {
+      char *message = nullptr;
+      mb_error(verbose, *error, &message);
+      fprintf(stderr, "\nFatal MBIO Error:\n%s\n", message);
+      fprintf(stderr, "Last Good Time: %d %d %d %d %d %d\n", time_i[0], time_i[1], time_i[2], time_i[3], time_i[4],
+              time_i[5]);
+    }
 
-        /* flag data according to pixel number range */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_SS &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_NUMBER) {
-          istart = std::max((int)process->mbp_cut_min[icut], 0);
-          iend = std::min((int)process->mbp_cut_max[icut], nss - 1);
-          for (int i = istart; i <= iend; i++) {
-            ss[i] = MB_SIDESCAN_NULL;
-          }
-        }
+    /*--------------------------------------------
+      handle kluges 1 and 7
+      --------------------------------------------*/
 
-        /* flag data according to pixel
-            acrosstrack distance */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_SS &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_DISTANCE) {
-          for (int i = 0; i < nss; i++) {
-            if (ssacrosstrack[i] >= process->mbp_cut_min[icut] &&
-                ssacrosstrack[i] <= process->mbp_cut_max[icut])
-              ss[i] = MB_SIDESCAN_NULL;
-          }
-        }
+    /* apply kluge001 - enables correction of travel times in
+                Hydrosweep DS2 data from the R/V Maurice
+                Ewing in 2001 and 2002. */
+    if (process->mbp_kluge001 && kind == MB_DATA_DATA && (format == 182 || format == 183))
+      *status = mbsys_atlas_ttcorr(verbose, imbio_ptr, store_ptr, error);
 
-        /* flag data according to speed */
-        else if (process->mbp_cut_kind[icut] == MBP_CUT_DATA_SS &&
-                 process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED) {
-          if (speed < process->mbp_cut_min[icut] || speed > process->mbp_cut_max[icut]) {
-            for (int i = 0; i < nss; i++) {
-              ss[i] = MB_SIDESCAN_NULL;
-            }
-          }
-        }
+    /* apply kluge007 - zero alongtrack distances > half the altitude */
+    if (process->mbp_kluge007 && kind == MB_DATA_DATA) {
+      for (int i = 0; i < nbath; i++) {
+        if (fabs(bathalongtrack[i]) > 0.5 * altitude)
+          bathalongtrack[i] = 0.0;
+      }
+      for (int i = 0; i < nss; i++) {
+        if (fabs(ssalongtrack[i]) > 0.5 * altitude)
+          ssalongtrack[i] = 0.0;
       }
     }
 
     /*--------------------------------------------
-      apply grazing angle corrections to amplitude and sidescan
+      handle navigation merging
       --------------------------------------------*/
 
-    /* correct amplitude and sidescan using slopes from multibeam swath data */
-    if ((process->mbp_ampcorr_mode == MBP_AMPCORR_ON && (process->mbp_ampcorr_slope == MBP_AMPCORR_IGNORESLOPE ||
-                                                        process->mbp_ampcorr_slope == MBP_AMPCORR_USESLOPE)) ||
-        (process->mbp_sscorr_mode == MBP_SSCORR_ON &&
-         (process->mbp_sscorr_slope == MBP_SSCORR_IGNORESLOPE || process->mbp_sscorr_slope == MBP_SSCORR_USESLOPE))) {
-      /* get seafloor slopes if needed for amplitude or sidescan correction */
-      if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
-          ((process->mbp_ampcorr_mode == MBP_AMPCORR_ON && nampcorrtable > 0 && nampcorrangle > 0) ||
-           (process->mbp_sscorr_mode == MBP_SSCORR_ON && nsscorrtable > 0 && nsscorrangle > 0))) {
-        mb_pr_set_bathyslope(verbose, nsmooth, nbath, beamflag, bath, bathacrosstrack, &ndepths, depths,
-                             depthacrosstrack, &nslopes, slopes, slopeacrosstrack, depthsmooth, error);
-      }
+    /* extract the navigation if available and set scaling that may be needed many times */
+    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source)) {
+      *status = mb_extract_nav(verbose, imbio_ptr, store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed,
+                              &heading_org, &draft_org, &roll_org, &pitch_org, &heave_org, error);
+      heading = heading_org;
+      draft = draft_org;
+      roll = roll_org;
+      pitch = pitch_org;
+      heave = heave_org;
 
-      /* correct the amplitude if desired */
-      if (process->mbp_ampcorr_mode == MBP_AMPCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
-          nampcorrtable > 0 && nampcorrangle > 0) {
-        /* calculate the correction table */
-        *status = get_corrtable(verbose, time_d, nampcorrtable, nampcorrangle, ampcorrtable, &ampcorrtableuse, error);
+      mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
+      headingx = sin(heading * DTR);
+      headingy = cos(heading * DTR);
 
-        /* set the reference amplitudes */
-        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
-                               (-process->mbp_ampcorr_angle), &reference_amp_port, error);
-        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
-                               process->mbp_ampcorr_angle, &reference_amp_stbd, error);
-        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
+      /* apply kluge002 - enables correction of draft values in Simrad data
+                 - some Simrad multibeam data has had an
+                   error in which the heave has bee added
+                   to the sonar depth (draft for hull
+                   mounted sonars)
+                 - this correction subtracts the heave
+                   value from the sonar depth */
+      if (process->mbp_kluge002 && kind == MB_DATA_DATA)
+        draft -= heave;
+    }
 
-        /* get seafloor slopes */
-        for (int i = 0; i < namp; i++) {
-          if (mb_beam_ok(beamflag[i])) {
-            bathy = 0.0;
-            if (ndepths > 1) {
-              *status = mb_pr_get_bathyslope(verbose, ndepths, depths, depthacrosstrack, nslopes, slopes,
-                                            slopeacrosstrack, bathacrosstrack[i], &bathy, &slope, error);
-              if (*status != MB_SUCCESS) {
-                bathy = 0.0;
-                slope = 0.0;
-                *status = MB_SUCCESS;
-                *error = MB_ERROR_NO_ERROR;
-              }
-            }
-            if (bathy <= 0.0) {
-              if (altitude > 0.0)
-                bathy = altitude + sonardepth;
-              else
-                bathy = altitude_default + sonardepth;
-              slope = 0.0;
-            }
+    /* apply kluge005 - replaces survey record timestamps with
+            timestamps of corresponding merged navigation
+            records
+            - this feature allows users to fix
+                  timestamp errors using MBnavedit and
+                  then insert the corrected timestamps
+                  into processed data */
+    if (process->mbp_kluge005 && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA && nnav > 0) {
+      time_d = ntime[idata - 1];
+      mb_get_date(verbose, time_d, time_i);
+    }
 
-            if (bathy > 0.0) {
-              altitude_use = bathy - sonardepth;
-              angle = RTD * atan(bathacrosstrack[i] / altitude_use);
-              if (process->mbp_ampcorr_slope != MBP_AMPCORR_IGNORESLOPE)
-                angle += RTD * atan(slope);
-              *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle,
-                                     ampcorrtableuse.amplitude, angle, &correction, error);
-              if (process->mbp_ampcorr_type == MBP_AMPCORR_SUBTRACTION)
-                amp[i] = amp[i] - correction + reference_amp;
-              else
-                amp[i] = amp[i] / correction * reference_amp;
-            }
-          }
-        }
+    /* interpolate the navigation if desired */
+    if (*error == MB_ERROR_NO_ERROR && process->mbp_nav_mode == MBP_NAV_ON &&
+        (kind == MB_DATA_DATA || kind == nav_source)) {
+      /* interpolate navigation */
+      if (process->mbp_nav_algorithm == MBP_NAV_SPLINE && time_d >= ntime[0] && time_d <= ntime[nnav - 1]) {
+        mb_spline_interp(verbose, ntime - 1, nlon - 1, nlonspl - 1, nnav, time_d, &navlon, &inavtime, error);
+        mb_spline_interp(verbose, ntime - 1, nlat - 1, nlatspl - 1, nnav, time_d, &navlat, &inavtime, error);
+      }
+      else {
+        mb_linear_interp_longitude(verbose, ntime - 1, nlon - 1, nnav, time_d, &navlon, &inavtime, error);
+        mb_linear_interp_latitude(verbose, ntime - 1, nlat - 1, nnav, time_d, &navlat, &inavtime, error);
       }
 
-      /* correct the sidescan if desired */
-      if (process->mbp_sscorr_mode == MBP_SSCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
-          nsscorrtable > 0 && nsscorrangle > 0) {
-        /* calculate the correction table */
-        *status = get_corrtable(verbose, time_d, nsscorrtable, nsscorrangle, sscorrtable, &sscorrtableuse, error);
+      /* interpolate heading */
+      if (process->mbp_nav_heading == MBP_NAV_ON) {
+        mb_linear_interp_heading(verbose, ntime - 1, nheading - 1, nnav, time_d, &heading, &inavtime, error);
+        if (heading < 0.0)
+          heading += 360.0;
+        else if (heading > 360.0)
+          heading -= 360.0;
+      }
 
-        /* set the reference amplitudes */
-        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
-                               (-process->mbp_sscorr_angle), &reference_amp_port, error);
-        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
-                               process->mbp_sscorr_angle, &reference_amp_stbd, error);
-        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
+      /* interpolate speed */
+      if (process->mbp_nav_speed == MBP_NAV_ON) {
+        mb_linear_interp(verbose, ntime - 1, nspeed - 1, nnav, time_d, &speed, &inavtime, error);
+      }
 
-        /* get seafloor slopes */
-        for (int i = 0; i < nss; i++) {
-          if (ss[i] > MB_SIDESCAN_NULL) {
-            bathy = 0.0;
-            if (ndepths > 1) {
-              *status = mb_pr_get_bathyslope(verbose, ndepths, depths, depthacrosstrack, nslopes, slopes,
-                                            slopeacrosstrack, ssacrosstrack[i], &bathy, &slope, error);
-              if (*status != MB_SUCCESS) {
-                bathy = 0.0;
-                slope = 0.0;
-                *status = MB_SUCCESS;
-                *error = MB_ERROR_NO_ERROR;
-              }
-            }
-            if (bathy <= 0.0) {
-              if (altitude > 0.0)
-                bathy = altitude + sonardepth;
-              else
-                bathy = altitude_default + sonardepth;
-              slope = 0.0;
-            }
+      /* interpolate draft */
+      if (process->mbp_nav_draft == MBP_NAV_ON) {
+        mb_linear_interp(verbose, ntime - 1, ndraft - 1, nnav, time_d, &draft, &inavtime, error);
+      }
 
-            if (bathy > 0.0) {
-              altitude_use = bathy - sonardepth;
-              angle = RTD * atan(ssacrosstrack[i] / altitude_use);
-              if (process->mbp_sscorr_slope != MBP_SSCORR_IGNORESLOPE) {
-                angle += RTD * atan(slope);
-              }
-              *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle,
-                                     sscorrtableuse.amplitude, angle, &correction, error);
-              if (process->mbp_sscorr_type == MBP_SSCORR_SUBTRACTION) {
-                ss[i] = ss[i] - correction + reference_amp;
-              }
-              else {
-                ss[i] = ss[i] / correction * reference_amp;
-              }
-            }
-          }
-        }
+      /* interpolate attitude */
+      if (process->mbp_nav_attitude == MBP_NAV_ON) {
+        mb_linear_interp(verbose, ntime - 1, nroll - 1, nnav, time_d, &roll, &inavtime, error);
+        mb_linear_interp(verbose, ntime - 1, npitch - 1, nnav, time_d, &pitch, &inavtime, error);
+        mb_linear_interp(verbose, ntime - 1, nheave - 1, nnav, time_d, &heave, &inavtime, error);
       }
     }
 
-    /* correct amplitude and sidescan using slopes from topography grid */
-    else if ((process->mbp_ampcorr_mode == MBP_AMPCORR_ON &&
-              (process->mbp_ampcorr_slope == MBP_AMPCORR_USETOPO ||
-               process->mbp_ampcorr_slope == MBP_AMPCORR_USETOPOSLOPE)) ||
-             (process->mbp_sscorr_mode == MBP_SSCORR_ON && (process->mbp_sscorr_slope == MBP_SSCORR_USETOPO ||
-                                                           process->mbp_sscorr_slope == MBP_SSCORR_USETOPOSLOPE))) {
-      /* get distance scaling and heading vector */
-      mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
-      headingx = sin(heading * DTR);
-      headingy = cos(heading * DTR);
+    /*--------------------------------------------
+      handle attitude merging
+      --------------------------------------------*/
 
-      /* correct the amplitude if desired */
-      if (process->mbp_ampcorr_mode == MBP_AMPCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
-          nampcorrtable > 0 && nampcorrangle > 0) {
-        /* calculate the correction table */
-        *status = get_corrtable(verbose, time_d, nampcorrtable, nampcorrangle, ampcorrtable, &ampcorrtableuse, error);
+    /* interpolate the attitude if desired */
+    if (*error == MB_ERROR_NO_ERROR && process->mbp_attitude_mode == MBP_ATTITUDE_ON &&
+        (kind == MB_DATA_DATA || kind == nav_source)) {
+      /* interpolate adjusted navigation */
+      mb_linear_interp(verbose, attitudetime - 1, attituderoll - 1,
+                        nattitude, time_d, &roll, &iattitudetime, error);
+      mb_linear_interp(verbose, attitudetime - 1, attitudepitch - 1,
+                        nattitude, time_d, &pitch, &iattitudetime, error);
+      mb_linear_interp(verbose, attitudetime - 1, attitudeheave - 1,
+                        nattitude, time_d, &heave, &iattitudetime, error);
+    }
 
-        /* set the reference amplitudes */
-        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
-                               (-process->mbp_ampcorr_angle), &reference_amp_port, error);
-        *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle, ampcorrtableuse.amplitude,
-                               process->mbp_ampcorr_angle, &reference_amp_stbd, error);
-        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
+    /*--------------------------------------------
+      handle sonar depth merging
+      --------------------------------------------*/
 
-        /* get seafloor slopes */
-        for (int i = 0; i < namp; i++) {
-          if (mb_beam_ok(beamflag[i])) {
-            /* get position in grid */
-            r[0] = headingy * bathacrosstrack[i] + headingx * bathalongtrack[i];
-            r[1] = -headingx * bathacrosstrack[i] + headingy * bathalongtrack[i];
-            const int ix = (navlon + r[0] * mtodeglon - grid->xmin + 0.5 * grid->dx) / grid->dx;
-            const int jy = (navlat + r[1] * mtodeglat - grid->ymin + 0.5 * grid->dy) / grid->dy;
-            const int kgrid = ix * grid->n_rows + jy;
-            const int kgrid00 = (ix - 1) * grid->n_rows + jy - 1;
-            const int kgrid01 = (ix - 1) * grid->n_rows + jy + 1;
-            const int kgrid10 = (ix + 1) * grid->n_rows + jy - 1;
-            const int kgrid11 = (ix + 1) * grid->n_rows + jy + 1;
-            if (ix > 0 && ix < grid->n_columns - 1 && jy > 0 && jy < grid->n_rows - 1 &&
-                grid->data[kgrid] > grid->nodatavalue && grid->data[kgrid00] > grid->nodatavalue &&
-                grid->data[kgrid01] > grid->nodatavalue && grid->data[kgrid10] > grid->nodatavalue &&
-                grid->data[kgrid11] > grid->nodatavalue) {
-              /* get look vector for data */
-              bathy = -grid->data[kgrid];
-              r[2] = grid->data[kgrid] + sonardepth;
-              rr = -sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
-              r[0] /= rr;
-              r[1] /= rr;
-              r[2] /= rr;
+    /* interpolate the sonardepth if desired */
+    if (*error == MB_ERROR_NO_ERROR && process->mbp_sonardepth_mode == MBP_SONARDEPTH_ON &&
+        (kind == MB_DATA_DATA || kind == nav_source)) {
+      /* interpolate adjusted navigation */
+      mb_linear_interp(verbose, fsonardepthtime - 1, fsonardepth - 1, nsonardepth, time_d, &draft,
+                                 &isonardepthtime, error);
+    }
 
-              /* get normal vector to grid surface */
-              if (process->mbp_ampcorr_slope == MBP_SSCORR_USETOPOSLOPE) {
-                v1[0] = 2.0 * grid->dx / mtodeglon;
-                v1[1] = 2.0 * grid->dy / mtodeglat;
-                v1[2] = grid->data[kgrid11] - grid->data[kgrid00];
-                v2[0] = -2.0 * grid->dx / mtodeglon;
-                v2[1] = 2.0 * grid->dy / mtodeglat;
-                v2[2] = grid->data[kgrid01] - grid->data[kgrid10];
-                v[0] = v1[1] * v2[2] - v2[1] * v1[2];
-                v[1] = v2[0] * v1[2] - v1[0] * v2[2];
-                v[2] = v1[0] * v2[1] - v2[0] * v1[1];
-                vv = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
-                v[0] /= vv;
-                v[1] /= vv;
-                v[2] /= vv;
-              }
-              else {
-                v[0] = 0.0;
-                v[1] = 0.0;
-                v[2] = 1.0;
-              }
+    /*--------------------------------------------
+      handle position shifts
+      --------------------------------------------*/
 
-              /* angle between look vector and surface normal
-                  is the acos(r dot v) */
-              angle = RTD * acos(r[0] * v[0] + r[1] * v[1] + r[2] * v[2]);
-              if (bathacrosstrack[i] < 0.0)
-                angle = -angle;
+    /* apply position shifts if needed */
+    if (process->mbp_nav_shift == MBP_NAV_ON) {
+      navlon -= (headingy * mtodeglon * process->mbp_nav_offsetx + headingx * mtodeglon * process->mbp_nav_offsety -
+                 mtodeglon * process->mbp_nav_shiftx - process->mbp_nav_shiftlon);
+      navlat -= (-headingx * mtodeglat * process->mbp_nav_offsetx + headingy * mtodeglat * process->mbp_nav_offsety -
+                 mtodeglat * process->mbp_nav_shifty - process->mbp_nav_shiftlat);
+    }
 
-            }
-            else {
-              if (ix >= 0 && ix < grid->n_columns && jy >= 0 && jy < grid->n_rows && grid->data[kgrid] > grid->nodatavalue)
-                bathy = -grid->data[kgrid];
-              else
-                bathy = bath[i];
-              angle = RTD * atan(bathacrosstrack[i] / (bathy - sonardepth));
-              slope = 0.0;
-            }
+    /*--------------------------------------------
+      handle draft correction
+      --------------------------------------------*/
+    /* add user specified draft correction if desired */
+    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source)) {
+      if (process->mbp_draft_mode == MBP_DRAFT_OFFSET)
+        draft = draft + process->mbp_draft_offset;
+      else if (process->mbp_draft_mode == MBP_DRAFT_MULTIPLY)
+        draft = draft * process->mbp_draft_mult;
+      else if (process->mbp_draft_mode == MBP_DRAFT_MULTIPLYOFFSET)
+        draft = draft * process->mbp_draft_mult + process->mbp_draft_offset;
+      else if (process->mbp_draft_mode == MBP_DRAFT_SET)
+        draft = process->mbp_draft;
+    }
 
-            /* apply correction */
-            *status = get_anglecorr(verbose, ampcorrtableuse.nangle, ampcorrtableuse.angle,
-                                   ampcorrtableuse.amplitude, angle, &correction, error);
-            if (process->mbp_ampcorr_type == MBP_AMPCORR_SUBTRACTION)
-              amp[i] = amp[i] - correction + reference_amp;
-            else
-              amp[i] = amp[i] / correction * reference_amp;
-          }
-        }
+    /*--------------------------------------------
+      handle adjusted navigation merging
+      --------------------------------------------*/
+
+    /* interpolate the adjusted navigation if desired */
+    if (*error == MB_ERROR_NO_ERROR && process->mbp_navadj_mode >= MBP_NAVADJ_LL &&
+        (kind == MB_DATA_DATA || kind == nav_source)) {
+      /* interpolate adjusted navigation */
+      if (process->mbp_navadj_algorithm == MBP_NAV_SPLINE && time_d >= natime[0] && time_d <= natime[nanav - 1]) {
+        mb_spline_interp(verbose, natime - 1, nalon - 1, nalonspl - 1, nanav, time_d, &navlon, &inavadjtime, error);
+        mb_spline_interp(verbose, ntime - 1, nalat - 1, nalatspl - 1, nanav, time_d, &navlat, &inavadjtime, error);
+      }
+      else {
+        mb_linear_interp_longitude(verbose, natime - 1, nalon - 1, nanav, time_d, &navlon, &inavadjtime, error);
+        mb_linear_interp_latitude(verbose, natime - 1, nalat - 1, nanav, time_d, &navlat, &inavadjtime, error);
       }
+    }
 
-      /* correct the sidescan if desired */
-      if (process->mbp_sscorr_mode == MBP_SSCORR_ON && *error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA &&
-          nsscorrtable > 0 && nsscorrangle > 0) {
-        /* calculate the correction table */
-        *status = get_corrtable(verbose, time_d, nsscorrtable, nsscorrangle, sscorrtable, &sscorrtableuse, error);
+    /*--------------------------------------------
+      apply z offset from navigation adjustment correction
+      --------------------------------------------*/
 
-        /* set the reference amplitudes */
-        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
-                               (-process->mbp_sscorr_angle), &reference_amp_port, error);
-        *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle, sscorrtableuse.amplitude,
-                               process->mbp_sscorr_angle, &reference_amp_stbd, error);
-        reference_amp = 0.5 * (reference_amp_port + reference_amp_stbd);
+    /* apply z offset from navigation adjustment correction */
+    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA && process->mbp_navadj_mode == MBP_NAVADJ_LLZ &&
+        nanav > 1) {
+      /* interpolate z offset */
+      if (process->mbp_navadj_algorithm == MBP_NAV_SPLINE && time_d >= natime[0] && time_d <= natime[nanav - 1]) {
+        mb_spline_interp(verbose, natime - 1, naz - 1, nazspl - 1, nanav, time_d, &zoffset, &inavadjtime, error);
+      }
+      else {
+        mb_linear_interp(verbose, natime - 1, naz - 1, nanav, time_d, &zoffset, &inavadjtime, error);
+      }
 
-        /* get seafloor slopes */
-        for (int i = 0; i < nss; i++) {
-          if (ss[i] > MB_SIDESCAN_NULL) {
-            /* get position in grid */
-            r[0] = headingy * ssacrosstrack[i] + headingx * ssalongtrack[i];
-            r[1] = -headingx * ssacrosstrack[i] + headingy * ssalongtrack[i];
-            const int ix = (navlon + r[0] * mtodeglon - grid->xmin + 0.5 * grid->dx) / grid->dx;
-            const int jy = (navlat + r[1] * mtodeglat - grid->ymin + 0.5 * grid->dy) / grid->dy;
-            const int kgrid = ix * grid->n_rows + jy;
-            const int kgrid00 = (ix - 1) * grid->n_rows + jy - 1;
-            const int kgrid01 = (ix - 1) * grid->n_rows + jy + 1;
-            const int kgrid10 = (ix + 1) * grid->n_rows + jy - 1;
-            const int kgrid11 = (ix + 1) * grid->n_rows + jy + 1;
-            if (ix > 0 && ix < grid->n_columns - 1 && jy > 0 && jy < grid->n_rows - 1 &&
-                grid->data[kgrid] > grid->nodatavalue && grid->data[kgrid00] > grid->nodatavalue &&
-                grid->data[kgrid01] > grid->nodatavalue && grid->data[kgrid10] > grid->nodatavalue &&
-                grid->data[kgrid11] > grid->nodatavalue) {
-              /* get look vector for data */
-              bathy = -grid->data[kgrid];
-              r[2] = grid->data[kgrid] + sonardepth;
-              rr = -sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
-              r[0] /= rr;
-              r[1] /= rr;
-              r[2] /= rr;
+      /* apply z offset to draft / sonar depth */
+      draft += zoffset;
+    }
 
-              /* get normal vector to grid surface */
-              if (process->mbp_sscorr_slope == MBP_SSCORR_USETOPOSLOPE) {
-                v1[0] = 2.0 * grid->dx / mtodeglon;
-                v1[1] = 2.0 * grid->dy / mtodeglat;
-                v1[2] = grid->data[kgrid11] - grid->data[kgrid00];
-                v2[0] = -2.0 * grid->dx / mtodeglon;
-                v2[1] = 2.0 * grid->dy / mtodeglat;
-                v2[2] = grid->data[kgrid01] - grid->data[kgrid10];
-                v[0] = v1[1] * v2[2] - v2[1] * v1[2];
-                v[1] = v2[0] * v1[2] - v1[0] * v2[2];
-                v[2] = v1[0] * v2[1] - v2[0] * v1[1];
-                vv = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
-                v[0] /= vv;
-                v[1] /= vv;
-                v[2] /= vv;
-              }
-              else {
-                v[0] = 0.0;
-                v[1] = 0.0;
-                v[2] = 1.0;
-              }
+    /*--------------------------------------------
+      apply tide correction
+      --------------------------------------------*/
 
-              /* angle between look vector and surface normal
-                  is the acos(r dot v) */
-              angle = RTD * acos(r[0] * v[0] + r[1] * v[1] + r[2] * v[2]);
-              if (ssacrosstrack[i] < 0.0)
-                angle = -angle;
-            }
-            else {
-              if (ix >= 0 && ix < grid->n_columns && jy >= 0 && jy < grid->n_rows && grid->data[kgrid] > grid->nodatavalue)
-                bathy = -grid->data[kgrid];
-              else if (altitude > 0.0)
-                bathy = altitude + sonardepth;
-              else
-                bathy = altitude_default + sonardepth;
-              angle = RTD * atan(bathacrosstrack[i] / (bathy - sonardepth));
-              slope = 0.0;
-            }
+    /* apply tide corrections */
+    if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA
+      && process->mbp_tide_mode == MBP_TIDE_ON && ntide > 0) {
+      /* interpolate tide */
+      mb_linear_interp(verbose, tidetime - 1, tide - 1, ntide, time_d, &tideval, &itidetime, error);
 
-            /* apply correction */
-            *status = get_anglecorr(verbose, sscorrtableuse.nangle, sscorrtableuse.angle,
-                                   sscorrtableuse.amplitude, angle, &correction, error);
-            if (process->mbp_sscorr_type == MBP_SSCORR_SUBTRACTION) {
-              ss[i] = ss[i] - correction + reference_amp;
-            }
-            else {
-              ss[i] = ss[i] / correction * reference_amp;
-            }
-          }
+      /* apply tide to to draft / sonar depth */
+      draft -= tideval;
+    }
+
+    /*--------------------------------------------
+      handle lever arm correction
+      --------------------------------------------*/
+
+    /* do lever calculation to find heave implied by roll and pitch
+       for a sonar displaced from the vru - this will be added to the
+       bathymetry */
+    if (*error == MB_ERROR_NO_ERROR && process->mbp_lever_mode == MBP_LEVER_ON && kind == MB_DATA_DATA) {
+      alpha = pitch;
+      beta = roll;
+      if (process->mbp_pitchbias_mode == MBP_PITCHBIAS_ON)
+        alpha += process->mbp_pitchbias;
+      if (process->mbp_rollbias_mode == MBP_ROLLBIAS_SINGLE)
+        beta += process->mbp_rollbias;
+      else if (process->mbp_rollbias_mode == MBP_ROLLBIAS_DOUBLE)
+        beta += 0.5 * (process->mbp_rollbias_port + process->mbp_rollbias_stbd);
+      mb_lever(verbose, process->mbp_sonar_offsetx, process->mbp_sonar_offsety, process->mbp_sonar_offsetz,
+               (double)0.0, (double)0.0, (double)0.0, process->mbp_vru_offsetx, process->mbp_vru_offsety,
+               process->mbp_vru_offsetz, alpha, beta, &lever_x, &lever_y, &lever_heave, error);
+    }
+
+    /*--------------------------------------------
+      handle speed and heading calculation
+      --------------------------------------------*/
+
+    /* make up heading and speed if required */
+    bool calculatespeedheading = false;
+    if (process->mbp_heading_mode == MBP_HEADING_CALC || process->mbp_heading_mode == MBP_HEADING_CALCOFFSET)
+      calculatespeedheading = true;
+    for (icut = 0; icut < process->mbp_cut_num; icut++) {
+      if (process->mbp_cut_mode[icut] == MBP_CUT_MODE_SPEED)
+        calculatespeedheading = true;
+    }
+    if (*error == MB_ERROR_NO_ERROR
+        && (kind == MB_DATA_DATA || kind == nav_source)
+        && calculatespeedheading) {
+      if (process->mbp_nav_mode == MBP_NAV_ON && inavtime > 0) {
+        mb_coor_scale(verbose, nlat[inavtime - 1], &mtodeglon, &mtodeglat);
+        del_time = ntime[inavtime] - ntime[inavtime - 1];
+        dx = (nlon[inavtime] - nlon[inavtime - 1]) / mtodeglon;
+        dy = (nlat[inavtime] - nlat[inavtime - 1]) / mtodeglat;
+      }
+      else if (process->mbp_navadj_mode >= MBP_NAVADJ_LL && inavadjtime > 0) {
+        mb_coor_scale(verbose, nalat[inavadjtime - 1], &mtodeglon, &mtodeglat);
+        del_time = natime[inavadjtime] - natime[inavadjtime - 1];
+        dx = (nalon[inavadjtime] - nalon[inavadjtime - 1]) / mtodeglon;
+        dy = (nalat[inavadjtime] - nalat[inavadjtime - 1]) / mtodeglat;
+      }
+      else if ((kind == MB_DATA_DATA && idata > 1) || (kind == nav_source && inav > 1)) {
+        mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
+        del_time = time_d - time_d_old;
+        dx = (navlon - navlon_old) / mtodeglon;
+        dy = (navlat - navlat_old) / mtodeglat;
+      }
+      if ((process->mbp_nav_mode == MBP_NAV_ON) || (process->mbp_navadj_mode >= MBP_NAVADJ_LL) ||
+          ((kind == MB_DATA_DATA && idata > 1) || (kind == nav_source && inav > 1))) {
+        dist = sqrt(dx * dx + dy * dy);
+        if (del_time > 0.0) {
+          speedcalc = 3.6 * dist / del_time;
         }
+        else
+          speedcalc = speed_old;
+        if (dist > 0.0 && del_time > 0.0) {
+          headingcalc = RTD * atan2(dx / dist, dy / dist);
+          if (headingcalc < 0.0)
+            headingcalc += 360.0;
+        }
+        else
+          headingcalc = heading_old;
+      }
+      else {
+        speedcalc = speed;
+        headingcalc = heading;
+      }
+      if (process->mbp_heading_mode == MBP_HEADING_CALC || process->mbp_heading_mode == MBP_HEADING_CALCOFFSET) {
+        heading = headingcalc;
+      }
+      else {
+        speed = speedcalc;
       }
+      time_d_old = time_d;
+      navlon_old = navlon;
+      navlat_old = navlat;
+      heading_old = headingcalc;
+      speed_old = speedcalc;
     }
 
-    /*--------------------------------------------
-      insert the altered data (now done)
-      --------------------------------------------*/
-
-    /* insert the altered data if available */
-    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == MB_DATA_COMMENT)) {
-      *status = mb_insert(verbose, imbio_ptr, store_ptr, kind, time_i, time_d, navlon, navlat, speed, heading, nbath,
-                         namp, nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss, ssacrosstrack,
-                         ssalongtrack, comment, error);
+    /* adjust heading if required */
+    if (*error == MB_ERROR_NO_ERROR && (kind == MB_DATA_DATA || kind == nav_source) &&
+        (process->mbp_heading_mode == MBP_HEADING_OFFSET || process->mbp_heading_mode == MBP_HEADING_CALCOFFSET)) {
+      heading += process->mbp_headingbias;
+      if (heading >= 360.0)
+        heading -= 360.0;
+      else if (heading < 0.0)
+        heading += 360.0;
     }
 
     /*--------------------------------------------
-      output any changed beamflags to the reverse
-      edit save file (saving the change required
-      to get back to the original flag state from
-      the processed flag state)
+      deal with bathymetry
       --------------------------------------------*/
+
+    /* if survey data encountered,
+        get the bathymetry */
     if (*error == MB_ERROR_NO_ERROR && kind == MB_DATA_DATA) {
-      for (int i = 0; i < nbath; i++) {
-        if (beamflag[i] != beamflagorg[i]) {
-          if (mb_beam_ok(beamflagorg[i])) {
-            action = MBP_EDIT_UNFLAG;
-          }
-          else if (mb_beam_check_flag_unusable(beamflagorg[i])) {
-            action = MBP_EDIT_ZERO;
-          }
-          else if (mb_beam_check_flag_manual(beamflagorg[i])) {
-            action = MBP_EDIT_FLAG;
-          }
-          else if (mb_beam_check_flag_filter(beamflagorg[i])) {
-            action = MBP_EDIT_FILTER;
+
+      /*--------------------------------------------
+        get travel time values
+        --------------------------------------------*/
+
+      /* extract travel times if they exist */
+      if (traveltime) {
+        *status = mb_ttimes(verbose, imbio_ptr, store_ptr, &kind, &nbeams, ttimes, angles, angles_forward,
+                           angles_null, bheave, alongtrack_offset, &draft_org, &ssv, error);
+      }
+
+      /* estimate travel times if they don't exist */
+      else {
+        draft_org = sonardepth - heave;
+        ssv = 1500.0;
+        nbeams = nbath;
+        for (int i = 0; i < nbath; i++) {
+          if (beamflag[i] != MB_FLAG_NULL) {
+            zz = bath[i] - sonardepth;
+            rr = sqrt(zz * zz + bathacrosstrack[i] * bathacrosstrack[i] +
+                      bathalongtrack[i] * bathalongtrack[i]);
+            ttimes[i] = rr / 750.0;
+            mb_xyz_to_takeoff(verbose, bathacrosstrack[i], bathalongtrack[i], (bath[i] - sonardepth),
+                              &angles[i], &angles_forward[i], error);
           }
-          else if (mb_beam_check_flag_sonar(beamflagorg[i])) {
-            action = MBP_EDIT_SONAR;
+          else {
+            angles[i] = 0.0;
+            angles_forward[i] = 0.0;
           }
-        *status = mbprocess_save_edit(verbose, resf_fp, time_d,
-                                                 i + pingmultiplicity * MB_ESF_MULTIPLICITY_FACTOR,
-                                                 action, error);
+          angles_null[i] = 0.0;
+          bheave[i] = 0.0;
+          alongtrack_offset[i] = 0.0;
         }
       }
-    }
 
-    /*--------------------------------------------
-      write the processed data
-      --------------------------------------------*/
+      /*--------------------------------------------
+        handle adjustments to ssv, heave, and travel times
+        --------------------------------------------*/
 
-    /* write some data */
-    if (*error == MB_ERROR_NO_ERROR || (kind == MB_DATA_COMMENT && !process->mbp_strip_comments)) {
-      *status = mb_put_all(verbose, ombio_ptr, store_ptr, false, kind, time_i, time_d, navlon, navlat, speed,
-                          heading, nbath, namp, nss, beamflag, bath, amp, bathacrosstrack, bathalongtrack, ss,
-                          ssacrosstrack, ssalongtrack, comment, error);
-      if (*status == MB_SUCCESS) {
-        if (kind == MB_DATA_DATA)
-          odata++;
-        else if (kind == nav_source)
-          onav++;
-        else if (kind == MB_DATA_COMMENT)
-          ocomment++;
-        else
-          oother++;
-      }
-      else {
-        char *message = nullptr;
-        mb_error(verbose, *error, &message);
-        fprintf(stderr, "\nMBIO Error returned from function <mb_put>:\n%s\n", message);
-        fprintf(stderr, "\nMultibeam Data Not Written To File <%s>\n", process->mbp_ofile);
-        fprintf(stderr, "Output Record: %d\n", odata + 1);
-        fprintf(stderr, "Time: %4d %2d %2d %2d:%2d:%2d.%6d\n", time_i[0], time_i[1], time_i[2], time_i[3],
-                time_i[4], time_i[5], time_i[6]);
-        fprintf(stderr, "\nProgram <%s> Terminated\n", program_name);
-        exit(*error);
+      /* set surface sound speed to default if needed */
+      if (ssv <= 0.0)
+        ssv = ssv_start;
+      else
+        ssv_start = ssv;
+
+      /* if heave adjustment specified do it */
+      if (process->mbp_heave_mode != MBP_HEAVE_OFF) {
+        if (process->mbp_heave_mode == MBP_HEAVE_MULTIPLY || process->mbp_heave_mode == MBP_HEAVE_MULTIPLYOFFSET) {
+          for (int i = 0; i < nbath; i++)
+            bheave[i] *= process->mbp_heave_mult;
+        }
+        if (process->mbp_heave_mode == MBP_HEAVE_OFFSET || process->mbp_heave_mode == MBP_HEAVE_MULTIPLYOFFSET) {
+          for (int i = 0; i < nbath; i++)
+            bheave[i] += process->mbp_heave;
+        }
       }
 
-      if (*status == MB_SUCCESS && kind == MB_DATA_DATA) {
+      /* if tt adjustment specified do it */
+      if (process->mbp_tt_mode == MBP_TT_MULTIPLY) {
+        for (int i = 0; i < nbath; i++)
+          ttimes[i] *= process->mbp_tt_mult;
+      }
 
-        /* output fbt */
-        if (make_fbt) {
-          fstore->sensorhead = sensorhead;
-          fstore->topo_type = sensortype;
-          struct mb_io_struct *imb_io_ptr = (struct mb_io_struct *)imbio_ptr;
-          fstore->beam_xwidth = imb_io_ptr->beamwidth_xtrack;
-          fstore->beam_lwidth = imb_io_ptr->beamwidth_ltrack;
-          fstore->kind = kind;
-          mb_insert_nav(verbose, fmbio_ptr, fstore_ptr, time_i, time_d,
-                        navlon, navlat, speed, heading, draft,
-                        roll, pitch, heave, error);
-          mb_insert_altitude(verbose, fmbio_ptr, fstore_ptr, draft, altitude, error);
-          *status = mb_insert(verbose, fmbio_ptr, fstore_ptr, kind, time_i, time_d,
-                              navlon, navlat, speed, heading, nbath, namp, nss,
-                              beamflag, bath, amp, bathacrosstrack, bathalongtrack,
-                              ss, ssacrosstrack, ssalongtrack, comment, error);
-          *status = mb_put_all(verbose, fmbio_ptr, fstore_ptr, false,
-                              kind, time_i, time_d, navlon, navlat, speed,
-                              heading, nbath, 0, 0,
-                              beamflag, bath, nullptr, bathacrosstrack, bathalongtrack,
-                              nullptr, nullptr, nullptr, comment, error);
-        }
+      /* if ssv adjustment specified do it */
+      if (process->mbp_ssv_mode == MBP_SSV_SET) {
+        ssv = process->mbp_ssv;
+      }
+      else if (process->mbp_ssv_mode == MBP_SSV_OFFSET) {
+        ssv += process->mbp_ssv;
+      }
 
-        // get scaling for both fnv and inf calculations
-        mb_coor_scale(verbose, navlat, &mtodeglon, &mtodeglat);
-        headingx = sin(heading * DTR);
-        headingy = cos(heading * DTR);
+      /*--------------------------------------------
+        recalculate the bathymetry
+        --------------------------------------------*/
 
-        /* output fnv */
-        /* mblist output: tMXYHScRPr=X=Y+X+Y */
-        if (make_fnv) {
-          double seconds = time_i[5] + 1e-6 * time_i[6];
-          int beam_port, beam_vertical, beam_stbd;
-          int pixel_port, pixel_vertical, pixel_stbd;
-          *status = mb_swathbounds(verbose, true, nbath, 0,
-                              beamflag, bathacrosstrack, nullptr, nullptr,
-                              &beam_port, &beam_vertical, &beam_stbd,
-                              &pixel_port, &pixel_vertical, &pixel_stbd, error);
-          double portlon = navlon
-                            + headingy * mtodeglon * bathacrosstrack[beam_port]
-                            + headingx * mtodeglon * bathalongtrack[beam_port];
-          double portlat = navlat
-                            - headingx * mtodeglat * bathacrosstrack[beam_port]
-                            + headingy * mtodeglat * bathalongtrack[beam_port];
-          double stbdlon = navlon
-                            + headingy * mtodeglon * bathacrosstrack[beam_stbd]
-                            + headingx * mtodeglon * bathalongtrack[beam_stbd];
-          double stbdlat = navlat
-                            - headingx * mtodeglat * bathacrosstrack[beam_stbd]
-                            + headingy * mtodeglat * bathalongtrack[beam_stbd];
+      /* apply kluge006 - resets draft without changing bathymetry */
+      if (process->mbp_kluge006 && kind == MB_DATA_DATA) {
+        draft_org = draft;
+      }
+    }
 
-          fprintf(nfp, "%.4d %.2d %.2d %.2d %.2d %09.6f\t%.6f\t"
-                        "%15.10f\t%15.10f\t%7.3f\t%6.3f\t%.4f\t%6.3f\t%6.3f\t%7.4f\t"
-                        "%15.10f\t%15.10f\t%15.10f\t%15.10f\n",
-                  time_i[0], time_i[1], time_i[2], time_i[3], time_i[4], seconds,
-                  time_d, navlon, navlat, heading, speed, draft, roll, pitch, heave,
-                  portlon, portlat, stbdlon, stbdlat);
-        }
+    /* process the record in place */
+    if (!pipelined) {
+      struct mbprocess_ping_struct *ping = &ping_slots[0];
+      save_ping(ping, false);
+      recalculate_ping(ping, &works[0]);
+      edit_ping(ping);
+      write_ping(ping);
+      *status = ping->status;
+      *error = ping->error;
+    }
 
-        /* get bounds for mbinfo call to generate the *.inf file
-            - use only data with good navigation and valid soundings or pixels */
-        if (fabs(navlon) >= 0.005 || fabs(navlat) >= 0.005) {
-          if (mask_bounds_init) {
-            mask_bounds[0] = std::min(mask_bounds[0], navlon);
-            mask_bounds[1] = std::max(mask_bounds[1], navlon);
-            mask_bounds[2] = std::min(mask_bounds[2], navlat);
-            mask_bounds[3] = std::max(mask_bounds[3], navlat);
-          } else {
-            mask_bounds[0] = navlon;
-            mask_bounds[1] = navlon;
-            mask_bounds[2] = navlat;
-            mask_bounds[3] = navlat;
-            mask_bounds_init = true;
-          }
-          for (int i=0; i<nbath; i++) {
-            if (mb_beam_ok(beamflag[i])) {
-              double bathlon = navlon
-                          + headingy * mtodeglon * bathacrosstrack[i]
-                          + headingx * mtodeglon * bathalongtrack[i];
-              double bathlat = navlat
-                          - headingx * mtodeglat * bathacrosstrack[i]
-                          + headingy * mtodeglat * bathalongtrack[i];
+    /* or queue it in the pipeline - records that would be neither
+       processed nor written are dropped here */
+    else if (*error == MB_ERROR_NO_ERROR || kind == MB_DATA_COMMENT) {
+      struct mbprocess_ping_struct *ping = &ping_slots[nread % nslot];
+      if (!edit_pings(nread))
+        break;
+      if (save_ping(ping, true)) {
+        std::lock_guard<std::mutex> lock(pipeline_mutex);
+        ping->state = MBPROCESS_PING_READ;
+        nread++;
+        pipeline_cv.notify_all();
+      }
 
-              mask_bounds[0] = std::min(mask_bounds[0], bathlon);
-              mask_bounds[1] = std::max(mask_bounds[1], bathlon);
-              mask_bounds[2] = std::min(mask_bounds[2], bathlat);
-              mask_bounds[3] = std::max(mask_bounds[3], bathlat);
-            }
-          }
-          for (int i=0; i<nss; i++) {
-            if (ss[i] > MB_SIDESCAN_NULL) {
-              double sslon = navlon
-                          + headingy * mtodeglon * ssacrosstrack[i]
-                          + headingx * mtodeglon * ssalongtrack[i];
-              double sslat = navlat
-                          - headingx * mtodeglat * ssacrosstrack[i]
-                          + headingy * mtodeglat * ssalongtrack[i];
-              mask_bounds[0] = std::min(mask_bounds[0], sslon);
-              mask_bounds[1] = std::max(mask_bounds[1], sslon);
-              mask_bounds[2] = std::min(mask_bounds[2], sslat);
-              mask_bounds[3] = std::max(mask_bounds[3], sslat);
-            }
-          }
+      /* if the record cannot be copied, empty the pipeline and
+         process the record in place */
+      else {
+        if (!edit_pings(-1))
+          break;
+        {
+          std::unique_lock<std::mutex> lock(pipeline_mutex);
+          pipeline_cv.wait(lock, [&] { return nwritten == nread || pipeline_stop; });
         }
-
+        save_ping(ping, false);
+        recalculate_ping(ping, &works[0]);
+        edit_ping(ping);
+        write_ping(ping);
+        *status = ping->status;
+        *error = ping->error;
       }
     }
   }
 
+  /* empty the pipeline and stop the ping and writer threads */
+  if (pipelined) {
+    edit_pings(-1);
+    {
+      std::lock_guard<std::mutex> lock(pipeline_mutex);
+      reading_done = true;
+      editing_done = true;
+      pipeline_cv.notify_all();
+    }
+    for (auto &pipeline_thread : pipeline_threads)
+      pipeline_thread.join();
+    if (pipeline_stop) {
+      *status = pipeline_status;
+      *error = pipeline_error;
+    }
+  }
+  int deall_error = MB_ERROR_NO_ERROR;
+  if (verbose >= 1 && process->mbp_svp_mode != MBP_SVP_OFF && process->mbp_rt_table > 0.0) {
+    int nlookup_tot = 0;
+    int nexact_tot = 0;
+    for (size_t ithread = 0; ithread < works.size(); ithread++) {
+      int nlookup = 0;
+      int nexact = 0;
+      if (works[ithread].rt_svp != nullptr
+          && mb_rt_table_stats(verbose, works[ithread].rt_svp, &nlookup, &nexact, &deall_error) == MB_SUCCESS) {
+        nlookup_tot += nlookup;
+        nexact_tot += nexact;
+      }
+    }
+    fprintf(stderr, "%d rays interpolated from raytracing tables\n", nlookup_tot);
+    fprintf(stderr, "%d rays traced exactly\n", nexact_tot);
+  }
+  for (int islot = 0; islot < nslot; islot++) {
+    if (ping_slots[islot].store_copy != nullptr)
+      mb_deall(verbose, imbio_ptr, &ping_slots[islot].store_copy, &deall_error);
+  }
+  for (size_t ithread = 1; ithread < works.size(); ithread++) {
+    if (works[ithread].rt_svp != nullptr)
+      mb_rt_deall(verbose, &works[ithread].rt_svp, &deall_error);
+  }
+
   /* output beam flagging success info */
   neditnull = 0;
   neditduplicate = 0;
@@ -5608,7 +6169,7 @@ void process_file(int verbose, int thread_id, struct mb_process_struct *process,
 
 int main(int argc, char **argv) {
   constexpr char usage_message[] =
-      "mbprocess -Iinfile [-C -Fformat -N -Ooutfile -P -S -T -V -H]";
+      "mbprocess -Iinfile [-Cthreads[/pingthreads] -Fformat -N -Ooutfile -P -S -T -V -H]";
 
   int verbose = 0;
   int status = MB_SUCCESS;
@@ -5634,14 +6195,7 @@ int main(int argc, char **argv) {
   bool testonly = false;
 
   unsigned int n_threads = 1;
-
-  /* disable keeping a list of allocated memory because the memory list
-      functionality in mb_mem.c is not thread safe */
-  // TODO: add mutex locking/unlocking to allow testing with memory list
-  //       enabled - we will still want it disabled most of the time for
-  //       performance, but it would be good to be able to check for memory
-  //       leaks again.  DWC December 27 2020
-  mb_mem_list_disable(verbose, &error);
+  int n_ping_threads = 1;
 
   /* process argument list */
   {
@@ -5660,7 +6214,7 @@ int main(int argc, char **argv) {
         break;
       case 'C':
       case 'c':
-        sscanf(optarg, "%d", &n_threads);
+        sscanf(optarg, "%u/%d", &n_threads, &n_ping_threads);
         break;
       case 'F':
       case 'f':
@@ -5770,6 +6324,7 @@ int main(int argc, char **argv) {
     fprintf(stderr, "dbg2       printfilestatus: %d\n", printfilestatus);
     fprintf(stderr, "dbg2       testonly:        %d\n", testonly);
     fprintf(stderr, "dbg2       n_threads:       %d\n", n_threads);
+    fprintf(stderr, "dbg2       n_ping_threads:  %d\n", n_ping_threads);
     fprintf(stderr, "dbg2       verbose:         %d\n", verbose);
   }
 
@@ -5787,7 +6342,8 @@ int main(int argc, char **argv) {
       fprintf(stderr, "  Comments embedded in output.\n\n");
     else
       fprintf(stderr, "  Comments stripped from output.\n\n");
-    fprintf(stderr, "  Using %d threads\n\n", n_threads);
+    fprintf(stderr, "  Using %d threads\n", n_threads);
+    fprintf(stderr, "  Using %d ping threads per file\n\n", n_ping_threads);
   }
 
   /* swath file locking variables */
@@ -5815,6 +6371,7 @@ int main(int argc, char **argv) {
   /* get number of threads to use */
   unsigned int n_concurrency = std::thread::hardware_concurrency();
   n_threads = MIN(n_threads, MIN(n_concurrency, MB_THREAD_MAX));
+  n_ping_threads = MAX(1, MIN(n_ping_threads, (int)MIN(n_concurrency, MB_THREAD_MAX)));
   unsigned int n_thread_set = 0;
   std::thread mbprocessThreads[MB_THREAD_MAX];
   int thread_status[MB_THREAD_MAX];
@@ -6205,7 +6762,7 @@ int main(int argc, char **argv) {
       thread_status[n_thread_set] = MB_SUCCESS;
       thread_error[n_thread_set] = MB_ERROR_NO_ERROR;
       mbprocessThreads[n_thread_set]
-          = std::thread(process_file, verbose, n_thread_set, &processPars[n_thread_set], grid_use,
+          = std::thread(process_file, verbose, n_thread_set, &processPars[n_thread_set], grid_use, n_ping_threads,
                         &thread_status[n_thread_set], &thread_error[n_thread_set]);
       n_thread_set++;
 
@@ -590,6 +590,10 @@ int main(int argc, char **argv) {
         found = true;
 				sscanf(pargv[i], "SOUNDSPEEDREF:%d", &process.mbp_corrected);
 			}
+			if (!found && strncmp(pargv[i], "RAYTABLE", 8) == 0) {
+        found = true;
+				sscanf(pargv[i], "RAYTABLE:%lf", &process.mbp_rt_table);
+			}
 
 			/* static beam bathymetry correction */
 			if (!found && strncmp(pargv[i], "STATICMODE", 10) == 0) {
@@ -1136,6 +1140,10 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "  Travel time mode:              %d\n", process.mbp_tt_mode);
 			fprintf(stderr, "  Travel time multiplier:        %f\n", process.mbp_tt_mult);
 			fprintf(stderr, "  Raytrace angle mode:           %d\n", process.mbp_angle_mode);
+			if (process.mbp_rt_table > 0.0)
+				fprintf(stderr, "  Raytrace table tolerance:      %f m\n", process.mbp_rt_table);
+			else
+				fprintf(stderr, "  Raytrace table tolerance:      off (exact raytracing)\n");
 
 			fprintf(stderr, "\nBathymetry Water Sound Speed Reference:\n");
 			if (process.mbp_corrected == true)
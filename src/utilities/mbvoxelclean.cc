@@ -21,9 +21,10 @@
  * applied to the data by the program mbprocess. These are the same edit save
  * files created and/or modified by mbvoxelclean and mbedit.
  * The input data are one swath file or a datalist referencing multiple
- * swath files. Each file is read and processed separately.
- * The rectangular prism including all of the flagged and unflagged soundings
- * is divided into 3D voxels of the specified size. All of the soundings are
+ * swath files. Each file is read and processed separately, or with --region
+ * the density filter is calculated from the soundings of all of the files.
+ * Space is divided into 3D voxels of the specified size, and only the voxels
+ * containing soundings are stored, in a hash table. All of the soundings are
  * read into memory and associated with one of the voxels. Once all of
  * data are read, a density filter is applied such that containing more than a
  * specified threshold of soundings are considered to be occupied by a valid target and
@@ -47,9 +48,12 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <cstdint>
 #include <getopt.h>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include "mb_define.h"
 #include "mb_format.h"
@@ -108,6 +112,8 @@ constexpr char usage_message[] =
     "\t--unflag-occupied\n"
     "\t--ignore-occupied\n"
     "\t--neighborhood=value\n"
+    "\t--region\n"
+    "\t--threads=value\n"
     "\t--range-minimum=value\n"
     "\t--range-maximum=value]\n"
     "\t--acrosstrack-minimum=value\n"
@@ -115,6 +121,220 @@ constexpr char usage_message[] =
     "\t--amplitude-minimum=value\n"
     "\t--amplitude-maximum=value]";
 
+/*--------------------------------------------------------------------*/
+/*
+ * Sparse voxel grid: only voxels containing soundings are stored, so memory
+ * scales with the number of occupied voxels rather than with the bounding
+ * box of the data. Voxels are keyed by their integer x, y, z indices on a
+ * fixed lattice and held in open addressing hash tables with linear probing.
+ * The voxels are split by hash into one shard per thread so that soundings
+ * can be binned in parallel, each thread inserting only into its own shard.
+ */
+
+/* initial number of slots in each hash table shard */
+constexpr size_t MBVC_SHARD_SLOTS_MIN = 1024;
+
+/* voxel with beam count - use unsigned char so that beam counts are capped
+   at 255 - ergo the maximum occupied count threshold is 255 */
+struct mbvoxelclean_voxel_struct {
+  int ix;
+  int iy;
+  int iz;
+  unsigned char count;
+  bool used;
+  bool occupied;
+};
+
+struct mbvoxelclean_shard_struct {
+  size_t nvoxel;
+  std::vector<struct mbvoxelclean_voxel_struct> slots;
+};
+
+struct mbvoxelclean_grid_struct {
+  double voxel_size_xy;
+  double voxel_size_z;
+  int nshard;
+  struct mbvoxelclean_shard_struct shards[MB_THREAD_MAX];
+};
+
+/*--------------------------------------------------------------------*/
+inline uint64_t mbvoxelclean_hash(int ix, int iy, int iz) {
+  uint64_t h = (uint64_t)(uint32_t)ix * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)(uint32_t)iy * 0xC2B2AE3D27D4EB4FULL;
+  h ^= (uint64_t)(uint32_t)iz * 0x165667B19E3779F9ULL;
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/*--------------------------------------------------------------------*/
+inline int mbvoxelclean_shard(const struct mbvoxelclean_grid_struct *grid, uint64_t h) {
+  return (int)((h >> 40) % (uint64_t)grid->nshard);
+}
+
+/*--------------------------------------------------------------------*/
+inline void mbvoxelclean_index(const struct mbvoxelclean_grid_struct *grid, double x, double y, double z, int *ix,
+                               int *iy, int *iz) {
+  *ix = (int)floor(x / grid->voxel_size_xy);
+  *iy = (int)floor(y / grid->voxel_size_xy);
+  *iz = (int)floor(z / grid->voxel_size_z);
+}
+
+/*--------------------------------------------------------------------*/
+void mbvoxelclean_grid_init(struct mbvoxelclean_grid_struct *grid, double voxel_size_xy, double voxel_size_z,
+                            int nshard) {
+  grid->voxel_size_xy = voxel_size_xy;
+  grid->voxel_size_z = voxel_size_z;
+  grid->nshard = std::max(1, std::min(nshard, MB_THREAD_MAX));
+  for (int ishard = 0; ishard < MB_THREAD_MAX; ishard++) {
+    grid->shards[ishard].nvoxel = 0;
+    grid->shards[ishard].slots.clear();
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* release all voxels, e.g. before binning the next file */
+void mbvoxelclean_grid_clear(struct mbvoxelclean_grid_struct *grid) {
+  for (int ishard = 0; ishard < grid->nshard; ishard++) {
+    grid->shards[ishard].nvoxel = 0;
+    std::vector<struct mbvoxelclean_voxel_struct>().swap(grid->shards[ishard].slots);
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* return the voxel (ix, iy, iz), or nullptr if it contains no soundings */
+struct mbvoxelclean_voxel_struct *mbvoxelclean_grid_find(struct mbvoxelclean_grid_struct *grid, int ix, int iy,
+                                                         int iz) {
+  const uint64_t h = mbvoxelclean_hash(ix, iy, iz);
+  struct mbvoxelclean_shard_struct *shard = &grid->shards[mbvoxelclean_shard(grid, h)];
+  if (shard->slots.empty())
+    return nullptr;
+  const size_t mask = shard->slots.size() - 1;
+  for (size_t k = h & mask;; k = (k + 1) & mask) {
+    struct mbvoxelclean_voxel_struct *voxel = &shard->slots[k];
+    if (!voxel->used)
+      return nullptr;
+    if (voxel->ix == ix && voxel->iy == iy && voxel->iz == iz)
+      return voxel;
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* return the voxel (ix, iy, iz) of the shard, inserting it with a zero count
+   if necessary - the table is doubled when half full */
+struct mbvoxelclean_voxel_struct *mbvoxelclean_shard_insert(struct mbvoxelclean_shard_struct *shard, uint64_t h,
+                                                            int ix, int iy, int iz) {
+  if (2 * (shard->nvoxel + 1) > shard->slots.size()) {
+    std::vector<struct mbvoxelclean_voxel_struct> slots(std::max(2 * shard->slots.size(), MBVC_SHARD_SLOTS_MIN),
+                                                        mbvoxelclean_voxel_struct{0, 0, 0, 0, false, false});
+    const size_t mask = slots.size() - 1;
+    for (const struct mbvoxelclean_voxel_struct &voxel : shard->slots) {
+      if (voxel.used) {
+        size_t k = mbvoxelclean_hash(voxel.ix, voxel.iy, voxel.iz) & mask;
+        while (slots[k].used)
+          k = (k + 1) & mask;
+        slots[k] = voxel;
+      }
+    }
+    shard->slots.swap(slots);
+  }
+  const size_t mask = shard->slots.size() - 1;
+  size_t k = h & mask;
+  for (; shard->slots[k].used; k = (k + 1) & mask) {
+    if (shard->slots[k].ix == ix && shard->slots[k].iy == iy && shard->slots[k].iz == iz)
+      return &shard->slots[k];
+  }
+  shard->slots[k] = mbvoxelclean_voxel_struct{ix, iy, iz, 0, true, false};
+  shard->nvoxel++;
+  return &shard->slots[k];
+}
+
+/*--------------------------------------------------------------------*/
+/* count the soundings falling in the voxels of one shard */
+void mbvoxelclean_bin_shard(struct mbvoxelclean_grid_struct *grid, int ishard,
+                            const struct mbvoxelclean_ping_struct *pings, int n_pings, bool count_flagged) {
+  struct mbvoxelclean_shard_struct *shard = &grid->shards[ishard];
+
+  /* successive soundings often share a voxel - the last voxel found stays
+     valid until the next insertion */
+  struct mbvoxelclean_voxel_struct *voxel = nullptr;
+  for (int i = 0; i < n_pings; i++) {
+    for (int j = 0; j < pings[i].beams_bath; j++) {
+      if (!mb_beam_check_flag_null(pings[i].beamflag[j])) {
+        int ix;
+        int iy;
+        int iz;
+        mbvoxelclean_index(grid, pings[i].bathx[j], pings[i].bathy[j], pings[i].bathz[j], &ix, &iy, &iz);
+        if (voxel == nullptr || voxel->ix != ix || voxel->iy != iy || voxel->iz != iz) {
+          const uint64_t h = mbvoxelclean_hash(ix, iy, iz);
+          if (mbvoxelclean_shard(grid, h) != ishard)
+            continue;
+          voxel = mbvoxelclean_shard_insert(shard, h, ix, iy, iz);
+        }
+        if ((mb_beam_ok(pings[i].beamflag[j]) || count_flagged) && voxel->count < 255)
+          voxel->count++;
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* mark the voxels of one shard occupied if they reach the occupy threshold,
+   or if any voxel within the neighborhood does - only the occupied flags of
+   this shard are written, so the shards can be processed concurrently */
+void mbvoxelclean_occupy_shard(struct mbvoxelclean_grid_struct *grid, int ishard, int occupy_threshold,
+                               int neighborhood) {
+  for (struct mbvoxelclean_voxel_struct &voxel : grid->shards[ishard].slots) {
+    if (!voxel.used)
+      continue;
+    voxel.occupied = voxel.count >= occupy_threshold;
+    for (int iix = voxel.ix - neighborhood; iix <= voxel.ix + neighborhood && !voxel.occupied; iix++) {
+      for (int iiy = voxel.iy - neighborhood; iiy <= voxel.iy + neighborhood && !voxel.occupied; iiy++) {
+        for (int iiz = voxel.iz - neighborhood; iiz <= voxel.iz + neighborhood && !voxel.occupied; iiz++) {
+          const struct mbvoxelclean_voxel_struct *neighbor = mbvoxelclean_grid_find(grid, iix, iiy, iiz);
+          if (neighbor != nullptr && neighbor->count >= occupy_threshold)
+            voxel.occupied = true;
+        }
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------*/
+/* count the soundings of n_pings pings into the grid, one thread per shard */
+void mbvoxelclean_grid_bin(struct mbvoxelclean_grid_struct *grid, const struct mbvoxelclean_ping_struct *pings,
+                           int n_pings, bool count_flagged) {
+  std::thread binThreads[MB_THREAD_MAX];
+  for (int ishard = 1; ishard < grid->nshard; ishard++)
+    binThreads[ishard] = std::thread(mbvoxelclean_bin_shard, grid, ishard, pings, n_pings, count_flagged);
+  mbvoxelclean_bin_shard(grid, 0, pings, n_pings, count_flagged);
+  for (int ishard = 1; ishard < grid->nshard; ishard++)
+    binThreads[ishard].join();
+}
+
+/*--------------------------------------------------------------------*/
+/* apply the occupy threshold and neighborhood to all voxels of the grid */
+void mbvoxelclean_grid_occupy(struct mbvoxelclean_grid_struct *grid, int occupy_threshold, int neighborhood) {
+  std::thread occupyThreads[MB_THREAD_MAX];
+  for (int ishard = 1; ishard < grid->nshard; ishard++)
+    occupyThreads[ishard] = std::thread(mbvoxelclean_occupy_shard, grid, ishard, occupy_threshold, neighborhood);
+  mbvoxelclean_occupy_shard(grid, 0, occupy_threshold, neighborhood);
+  for (int ishard = 1; ishard < grid->nshard; ishard++)
+    occupyThreads[ishard].join();
+}
+
+/*--------------------------------------------------------------------*/
+/* return whether the voxel containing the point (x, y, z) is occupied */
+bool mbvoxelclean_grid_occupied(struct mbvoxelclean_grid_struct *grid, double x, double y, double z) {
+  int ix;
+  int iy;
+  int iz;
+  mbvoxelclean_index(grid, x, y, z, &ix, &iy, &iz);
+  const struct mbvoxelclean_voxel_struct *voxel = mbvoxelclean_grid_find(grid, ix, iy, iz);
+  return voxel != nullptr && voxel->occupied;
+}
+
 /*--------------------------------------------------------------------*/
 
 int main(int argc, char **argv) {
@@ -160,6 +380,8 @@ int main(int argc, char **argv) {
   empty_mode_t empty_mode = MBVC_EMPTY_FLAG;
   occupied_mode_t occupied_mode = MBVC_OCCUPIED_IGNORE;
   int neighborhood = 0;
+  bool region = false;
+  int n_threads = 1;
 
   /* other mbvoxelclean control parameters */
   bool apply_range_minimum = false;
@@ -192,6 +414,8 @@ int main(int argc, char **argv) {
         {"unflag-occupied", no_argument, nullptr, 0},
         {"ignore-occupied", no_argument, nullptr, 0},
         {"neighborhood", required_argument, nullptr, 0},
+        {"region", no_argument, nullptr, 0},
+        {"threads", required_argument, nullptr, 0},
         {"range-minimum", required_argument, nullptr, 0},
         {"range-maximum", required_argument, nullptr, 0},
         {"acrosstrack-minimum", required_argument, nullptr, 0},
@@ -253,6 +477,16 @@ int main(int argc, char **argv) {
         else if (strcmp("neighborhood", options[option_index].name) == 0) {
           sscanf(optarg, "%d", &neighborhood);
         }
+        else if (strcmp("region", options[option_index].name) == 0) {
+          region = true;
+        }
+        else if (strcmp("threads", options[option_index].name) == 0) {
+          int tmp;
+          if (sscanf(optarg, "%d", &tmp) == 1 && tmp > 0)
+            n_threads = tmp;
+          n_threads = std::min(n_threads, std::min((int)std::max(std::thread::hardware_concurrency(), 1U),
+                                                   MB_THREAD_MAX));
+        }
         else if (strcmp("range-minimum", options[option_index].name) == 0) {
           apply_range_minimum = true;
           sscanf(optarg, "%lf", &range_minimum);
@@ -333,6 +567,8 @@ int main(int argc, char **argv) {
       fprintf(outfp, "dbg2       empty_mode:                  %d\n", empty_mode);
       fprintf(outfp, "dbg2       occupied_mode:               %d\n", occupied_mode);
       fprintf(outfp, "dbg2       neighborhood:                %d\n", neighborhood);
+      fprintf(outfp, "dbg2       region:                      %d\n", region);
+      fprintf(outfp, "dbg2       n_threads:                   %d\n", n_threads);
       fprintf(outfp, "dbg2       apply_range_minimum:         %d\n", apply_range_minimum);
       fprintf(outfp, "dbg2       range_minimum:               %f\n", range_minimum);
       fprintf(outfp, "dbg2       apply_range_maximum:         %d\n", apply_range_maximum);
@@ -386,6 +622,11 @@ int main(int argc, char **argv) {
     read_data = true;
   }
 
+  /* in region mode the files are read twice, first only to bin all of their
+     soundings into one voxel grid, and then to clean them */
+  region = region && read_datalist;
+  bool bin_pass = region;
+
   int kind = MB_DATA_NONE;
   char swathfileread[MB_PATH_MAXLINE];
   int variable_beams;
@@ -424,7 +665,16 @@ int main(int argc, char **argv) {
   struct mbvoxelclean_ping_struct *pings = nullptr;
 
   /* voxel storage */
-  unsigned char *voxel_count = nullptr;  // TODO(schwehr): Make this a bool
+  struct mbvoxelclean_grid_struct grid;
+  mbvoxelclean_grid_init(&grid, voxel_size_xy, voxel_size_z, n_threads);
+
+  /* origin of the local cartesian coordinates, reset for each file unless
+     the whole region is cleaned together */
+  bool origin_set = false;
+  double origin_lon = 0.0;
+  double origin_lat = 0.0;
+  double mtodeglon = 0.0;
+  double mtodeglat = 0.0;
 
   /* save file control variables */
   char esffile[MB_PATH_MAXLINE];
@@ -449,7 +699,6 @@ int main(int argc, char **argv) {
 
   bool esffile_open = false;
   bool locked = false;
-  int n_voxel_alloc = 0;
   int npings_alloc = 0;
 
   /* loop over all files to be read */
@@ -480,7 +729,9 @@ int main(int argc, char **argv) {
     char lock_date[25] = "";
     // int lock_status = MB_SUCCESS;
     /* try to lock file */
-    if (uselockfiles) {
+    if (bin_pass) {
+      /* the binning pass only reads the files */
+    } else if (uselockfiles) {
       status = mb_pr_lockswathfile(verbose, swathfile, MBP_LOCK_EDITBATHY, program_name, &error);
     } else {
       /* lock_status = */
@@ -588,9 +839,12 @@ int main(int argc, char **argv) {
       }
 
       /* define local cartesian coordinate system based on first ping navigation and heading */
-      double mtodeglon;
-      double mtodeglat;
-      mb_coor_scale(verbose, mb_info.lat_start, &mtodeglon, &mtodeglat);
+      if (!region || !origin_set) {
+        origin_lon = mb_info.lon_start;
+        origin_lat = mb_info.lat_start;
+        mb_coor_scale(verbose, origin_lat, &mtodeglon, &mtodeglat);
+        origin_set = true;
+      }
       const double headingx = sin(mb_info.heading_start * DTR);
       const double headingy = cos(mb_info.heading_start * DTR);
 
@@ -602,7 +856,8 @@ int main(int argc, char **argv) {
       /* if verbose output status */
       if (verbose >= 0) {
         fprintf(stderr, "---------------------------------\n");
-        fprintf(stderr, "Processing %s...\n\tActually reading %s...\n", swathfile, swathfileread);
+        fprintf(stderr, "%s %s...\n\tActually reading %s...\n", bin_pass ? "Binning" : "Processing", swathfile,
+                swathfileread);
       }
 
       /* initialize reading the input swath sonar file */
@@ -674,12 +929,6 @@ int main(int argc, char **argv) {
       }
 
       void *store_ptr = nullptr;
-      double x_min;
-      double x_max;
-      double y_min;
-      double y_max;
-      double z_min;
-      double z_max;
 
       /* now deal with old edit save file */
       if (status == MB_SUCCESS) {
@@ -687,7 +936,8 @@ int main(int argc, char **argv) {
         fprintf(stderr, "\tOpening edit save file...\n");
 
         /* handle esf edits */
-        status = mb_esf_load(verbose, program_name, swathfile, true, true, esffile, &esf, &error);
+        status = mb_esf_load(verbose, program_name, swathfile, true, bin_pass ? MBP_ESF_NOWRITE : MBP_ESF_WRITE, esffile,
+                             &esf, &error);
         if (status == MB_SUCCESS && esf.esffp != nullptr)
           esffile_open = true;
         if (status == MB_FAILURE && error == MB_ERROR_OPEN_FAIL) {
@@ -706,7 +956,6 @@ int main(int argc, char **argv) {
 
       /* read */
       bool done = false;
-      bool first = true;
       while (!done) {
         if (verbose > 1)
           fprintf(stderr, "\n");
@@ -778,17 +1027,17 @@ int main(int argc, char **argv) {
           pings[n_pings].heading = heading;
           pings[n_pings].sensordepth = sensordepth;
           pings[n_pings].beams_bath = beams_bath;
-          const double sensorx = (navlon - mb_info.lon_start) / mtodeglon;
-          const double sensory = (navlat - mb_info.lat_start) / mtodeglat;
+          const double sensorx = (navlon - origin_lon) / mtodeglon;
+          const double sensory = (navlat - origin_lat) / mtodeglat;
           const double sensorz = -sensordepth;
           for (int j = 0; j < beams_bath; j++) {
             pings[n_pings].beamflag[j] = beamflag[j];
             pings[n_pings].beamflagorg[j] = beamflag[j];
             if (!mb_beam_check_flag_null(beamflag[j])) {
               pings[n_pings].bathacrosstrack[j] = bathacrosstrack[j];
-              pings[n_pings].bathx[j] = (navlon - mb_info.lon_start) / mtodeglon +
+              pings[n_pings].bathx[j] = (navlon - origin_lon) / mtodeglon +
                        headingy * bathacrosstrack[j] + headingx * bathalongtrack[j];
-              pings[n_pings].bathy[j] = (navlat - mb_info.lat_start) / mtodeglat -
+              pings[n_pings].bathy[j] = (navlat - origin_lat) / mtodeglat -
                        headingx * bathacrosstrack[j] + headingy * bathalongtrack[j];
               pings[n_pings].bathz[j] = -bath[j];
               pings[n_pings].bathr[j] = sqrt((pings[n_pings].bathx[j] - sensorx)
@@ -797,23 +1046,6 @@ int main(int argc, char **argv) {
                     * (pings[n_pings].bathy[j] - sensory)
                          + (pings[n_pings].bathz[j] - sensorz)
                     * (pings[n_pings].bathz[j] - sensorz));
-              if (first) {
-                  x_min = pings[n_pings].bathx[j];
-                  x_max = pings[n_pings].bathx[j];
-                  y_min = pings[n_pings].bathy[j];
-                  y_max = pings[n_pings].bathy[j];
-                  z_min = pings[n_pings].bathz[j];
-                  z_max = pings[n_pings].bathz[j];
-                  first = false;
-              } else {
-                  x_min = std::min(x_min, pings[n_pings].bathx[j]);
-                  x_max = std::max(x_max, pings[n_pings].bathx[j]);
-                  y_min = std::min(y_min, pings[n_pings].bathy[j]);
-                  y_max = std::max(y_max, pings[n_pings].bathy[j]);
-                  z_min = std::min(z_min, pings[n_pings].bathz[j]);
-                  z_max = std::max(z_max, pings[n_pings].bathz[j]);
-              }
-
               // apply amplitude filter here where amplitude values are available
               // = note that a density unflag setting could undo flags defined here
               if (apply_amplitude_minimum || apply_amplitude_maximum) {
@@ -852,14 +1084,6 @@ int main(int argc, char **argv) {
               n_pings, j, pings[n_pings].bathx[j],
               pings[n_pings].bathy[j], pings[n_pings].bathz[j]);
             }
-
-            fprintf(stderr, "\ndbg2  current voxel bounds:\n");
-            fprintf(stderr, "dbg2    x_min: %10.3f m\n", x_min);
-            fprintf(stderr, "dbg2    x_max: %10.3f m\n", x_max);
-            fprintf(stderr, "dbg2    y_min: %10.3f m\n", y_min);
-            fprintf(stderr, "dbg2    y_max: %10.3f m\n", y_max);
-            fprintf(stderr, "dbg2    z_min: %10.3f m\n", z_min);
-            fprintf(stderr, "dbg2    z_max: %10.3f m\n", z_max);
           }
 
           /* update counters */
@@ -955,109 +1179,33 @@ int main(int argc, char **argv) {
         }
       }
 
-      // allocate arrays of voxel beam counts - use unsigned char so that beam
-      // counts are capped at 255 - ergo the maximum occupied count threshold
-      // is 254
-      const int n_voxel_x = (x_max - x_min) / voxel_size_xy + 3;
-      x_min = x_min - 0.5 * voxel_size_xy;
-      x_max = x_min + n_voxel_x * voxel_size_xy;
-      const int n_voxel_y = (x_max - y_min) / voxel_size_xy + 3;
-      y_min = y_min - 0.5 * voxel_size_xy;
-      y_max = y_min + n_voxel_y * voxel_size_xy;
-      const int n_voxel_z = (z_max - z_min) / voxel_size_z + 3;
-      z_min = z_min - 0.5 * voxel_size_z;
-      z_max = z_min + n_voxel_z * voxel_size_z;
-      int n_voxel = n_voxel_x * n_voxel_y * n_voxel_z;
-      if (verbose >= 2) {
-        fprintf(stderr, "\ndbg2  final voxel bounds:\n");
-        fprintf(stderr, "dbg2    x_min:      %10.3f m\n", x_min);
-        fprintf(stderr, "dbg2    x_max:      %10.3f m\n", x_max);
-        fprintf(stderr, "dbg2    y_min:      %10.3f m\n", y_min);
-        fprintf(stderr, "dbg2    y_max:      %10.3f m\n", y_max);
-        fprintf(stderr, "dbg2    z_min:      %10.3f m\n", z_min);
-        fprintf(stderr, "dbg2    z_max:      %10.3f m\n", z_max);
-        fprintf(stderr, "dbg2    n_voxel_x:  %d\n", n_voxel_x);
-        fprintf(stderr, "dbg2    n_voxel_y:  %d\n", n_voxel_y);
-        fprintf(stderr, "dbg2    n_voxel_z:  %d\n", n_voxel_z);
-        fprintf(stderr, "dbg2    n_voxel:    %d\n", n_voxel);
-      }
-      if (n_voxel_alloc < n_voxel) {
-        status &= mb_reallocd(verbose, __FILE__, __LINE__, (size_t)n_voxel,
-             (void **)&voxel_count, &error);
-        if (error != MB_ERROR_NO_ERROR) {
-          char *message = nullptr;
-          mb_error(verbose, MB_ERROR_MEMORY_FAIL, &message);
-          fprintf(outfp, "\nMBIO Error allocating voxel counting arrays:\n%s\n", message);
-          fprintf(outfp, "\nProgram <%s> Terminated\n", program_name);
-          mb_memory_clear(verbose, &error);
-          exit(error);
-        }
-        memset((void *)voxel_count, 0, (size_t)n_voxel);
-        n_voxel_alloc = n_voxel;
-      }
+      /* count the soundings in each voxel - in region mode the soundings of
+         all files are counted during the binning pass */
+      if (!region)
+        mbvoxelclean_grid_clear(&grid);
+      if (!region || bin_pass)
+        mbvoxelclean_grid_bin(&grid, pings, n_pings, count_flagged);
 
-      /* count the soundings in each voxel */
-      for (int i = 0; i < n_pings; i++) {
-        for (int j = 0; j< pings[i].beams_bath; j++) {
-          if (!mb_beam_check_flag_null(pings[i].beamflag[j])) {
-            const int ix = (pings[i].bathx[j] - x_min) / voxel_size_xy;
-            const int iy = (pings[i].bathy[j] - y_min) / voxel_size_xy;
-            const int iz = (pings[i].bathz[j] - z_min) / voxel_size_z;
-            const int kk = (ix * n_voxel_y + iy) * n_voxel_z + iz;
-            if ((mb_beam_ok(pings[i].beamflag[j]) || count_flagged) && voxel_count[kk] < 254) {
-              voxel_count[kk]++;
-            }
-          }
-        }
-      }
-
-      // apply neighborhood to extend occupied region
-      if (neighborhood > 0) {
-
-        for (int ix=0; ix<n_voxel_x; ix++) {
-          for (int iy=0; iy<n_voxel_y; iy++) {
-            for (int iz=0; iz<n_voxel_z; iz++) {
-              const int kk = (ix * n_voxel_y + iy) * n_voxel_z + iz;
-
-              if (voxel_count[kk] >= occupy_threshold && voxel_count[kk] < 255) {
-                for (int iix=std::max(ix-neighborhood,0); iix<std::min(ix+neighborhood+1,n_voxel_x); iix++) {
-                  for (int iiy=std::max(iy-neighborhood,0); iiy<std::min(iy+neighborhood+1,n_voxel_y); iiy++) {
-                    for (int iiz=std::max(iz-neighborhood,0); iiz<std::min(iz+neighborhood+1,n_voxel_z); iiz++) {
-                      const int kkk = (iix * n_voxel_y + iiy) * n_voxel_z + iiz;
-                      if (voxel_count[kkk] < occupy_threshold) {
-                        voxel_count[kkk] = 255;
-                      }
-                    }
-                  }
-                }
-              }
-
-            }
-          }
-        }
-      }
-
-      // apply threshold to generate binary mask of occupied voxels
-      for (int kk = 0; kk < n_voxel; kk++) {
-        if (voxel_count[kk] >= occupy_threshold) {
-          voxel_count[kk] = 1;
-        }
-        else if (voxel_count[kk] < occupy_threshold) {
-          voxel_count[kk] = 0;
-        }
+      // apply threshold and neighborhood to generate the occupied voxels
+      if (!region)
+        mbvoxelclean_grid_occupy(&grid, occupy_threshold, neighborhood);
+      if (verbose >= 2) {
+        size_t n_voxel = 0;
+        for (int ishard = 0; ishard < grid.nshard; ishard++)
+          n_voxel += grid.shards[ishard].nvoxel;
+        fprintf(stderr, "\ndbg2  voxel grid:\n");
+        fprintf(stderr, "dbg2    n_voxel:    %zu\n", n_voxel);
       }
 
       /* apply density filter to the soundings  */
-      if (occupied_mode == MBVC_OCCUPIED_UNFLAG || empty_mode == MBVC_EMPTY_FLAG) {
+      if (!bin_pass && (occupied_mode == MBVC_OCCUPIED_UNFLAG || empty_mode == MBVC_EMPTY_FLAG)) {
         for (int i = 0; i < n_pings; i++) {
           for (int j = 0; j < pings[i].beams_bath; j++) {
             if (!mb_beam_check_flag_null(pings[i].beamflag[j])) {
-              const int ix = (pings[i].bathx[j] - x_min) / voxel_size_xy;
-              const int iy = (pings[i].bathy[j] - y_min) / voxel_size_xy;
-              const int iz = (pings[i].bathz[j] - z_min) / voxel_size_z;
-              const int kk = (ix * n_voxel_y + iy) * n_voxel_z + iz;
+              const bool occupied = mbvoxelclean_grid_occupied(&grid, pings[i].bathx[j], pings[i].bathy[j],
+                                                               pings[i].bathz[j]);
               if (occupied_mode == MBVC_OCCUPIED_UNFLAG
-                && voxel_count[kk]
+                && occupied
                 && !mb_beam_ok(pings[i].beamflag[j])) {
                 pings[i].beamflag[j] = MB_FLAG_NONE;
                 const int action = MBP_EDIT_UNFLAG;
@@ -1067,7 +1215,7 @@ int main(int argc, char **argv) {
                 n_density_unflag++;
               }
               if (empty_mode == MBVC_EMPTY_FLAG
-                && !voxel_count[kk]
+                && !occupied
                 && mb_beam_ok(pings[i].beamflag[j])) {
                 pings[i].beamflag[j] = MB_FLAG_FLAG + MB_FLAG_FILTER;
                 const int action = MBP_EDIT_FILTER;
@@ -1082,7 +1230,7 @@ int main(int argc, char **argv) {
       }
 
       /* apply acrosstrack filter to the soundings */
-      if (apply_acrosstrack_minimum || apply_acrosstrack_maximum) {
+      if (!bin_pass && (apply_acrosstrack_minimum || apply_acrosstrack_maximum)) {
         for (int i = 0; i < n_pings; i++) {
           for (int j = 0; j< pings[i].beams_bath; j++) {
             if (!mb_beam_check_flag_null(pings[i].beamflag[j])) {
@@ -1111,7 +1259,7 @@ int main(int argc, char **argv) {
       }
 
       /* apply range filter to the soundings */
-      if (apply_range_minimum || apply_range_maximum) {
+      if (!bin_pass && (apply_range_minimum || apply_range_maximum)) {
         for (int i = 0; i < n_pings; i++) {
           for (int j = 0; j< pings[i].beams_bath; j++) {
             if (!mb_beam_check_flag_null(pings[i].beamflag[j])) {
@@ -1143,14 +1291,14 @@ int main(int argc, char **argv) {
       status = mb_esf_close(verbose, &esf, &error);
 
       /* update mbprocess parameter file */
-      if (esffile_open) {
+      if (esffile_open && !bin_pass) {
         /* update mbprocess parameter file */
         status = mb_pr_update_format(verbose, swathfile, true, format, &error);
         status = mb_pr_update_edit(verbose, swathfile, MBP_EDIT_ON, esffile, &error);
       }
 
       /* unlock the raw swath file */
-      if (uselockfiles)
+      if (uselockfiles && !bin_pass)
         status = mb_pr_unlockswathfile(verbose, swathfile, MBP_LOCK_EDITBATHY, program_name, &error);
 
       /* check memory */
@@ -1158,25 +1306,27 @@ int main(int argc, char **argv) {
         status = mb_memory_list(verbose, &error);
 
       /* increment the total counting variables */
-      n_files_tot++;
-      n_pings_tot += n_pings;
-      n_beams_tot += n_beams;
-      n_beamflag_null_tot += n_beamflag_null;
-      n_beamflag_good_tot += n_beamflag_good;
-      n_beamflag_flag_tot += n_beamflag_flag;
-      n_esf_flag_tot += n_esf_flag;
-      n_esf_unflag_tot += n_esf_unflag;
-      n_density_flag_tot += n_density_flag;
-      n_density_unflag_tot += n_density_unflag;
-      n_minrange_flag_tot += n_minrange_flag;
-      n_maxrange_flag_tot += n_maxrange_flag;
-      n_minacrosstrack_flag_tot += n_minacrosstrack_flag;
-      n_maxacrosstrack_flag_tot += n_maxacrosstrack_flag;
-      n_minamplitude_flag_tot += n_minamplitude_flag;
-      n_maxamplitude_flag_tot += n_maxamplitude_flag;
+      if (!bin_pass) {
+        n_files_tot++;
+        n_pings_tot += n_pings;
+        n_beams_tot += n_beams;
+        n_beamflag_null_tot += n_beamflag_null;
+        n_beamflag_good_tot += n_beamflag_good;
+        n_beamflag_flag_tot += n_beamflag_flag;
+        n_esf_flag_tot += n_esf_flag;
+        n_esf_unflag_tot += n_esf_unflag;
+        n_density_flag_tot += n_density_flag;
+        n_density_unflag_tot += n_density_unflag;
+        n_minrange_flag_tot += n_minrange_flag;
+        n_maxrange_flag_tot += n_maxrange_flag;
+        n_minacrosstrack_flag_tot += n_minacrosstrack_flag;
+        n_maxacrosstrack_flag_tot += n_maxacrosstrack_flag;
+        n_minamplitude_flag_tot += n_minamplitude_flag;
+        n_maxamplitude_flag_tot += n_maxamplitude_flag;
+      }
 
       /* give the statistics */
-      if (verbose >= 1) {
+      if (verbose >= 1 && !bin_pass) {
         fprintf(stderr, "%7d survey data records processed\n", n_pings);
         fprintf(stderr, "%7d soundings processed\n", n_beams);
         fprintf(stderr, "%7d beams good originally\n", n_beamflag_good);
@@ -1205,6 +1355,20 @@ int main(int argc, char **argv) {
       read_data = false;
     }
 
+    /* in region mode, once all files are binned apply the threshold and
+       neighborhood to the whole region and start over to clean each file */
+    if (bin_pass && !read_data) {
+      mbvoxelclean_grid_occupy(&grid, occupy_threshold, neighborhood);
+      bin_pass = false;
+      mb_datalist_close(verbose, &datalist, &error);
+      if (mb_datalist_open(verbose, &datalist, read_file, MB_DATALIST_LOOK_NO, &error) != MB_SUCCESS) {
+        fprintf(stderr, "\nUnable to open data list file: %s\n", read_file);
+        fprintf(stderr, "\nProgram <%s> Terminated\n", program_name);
+        exit(MB_ERROR_OPEN_FAIL);
+      }
+      read_data = mb_datalist_read(verbose, datalist, swathfile, dfile, &format, &file_weight, &error) == MB_SUCCESS;
+    }
+
     /* end loop over files in list */
   }
   if (read_datalist)
@@ -1244,7 +1408,7 @@ int main(int argc, char **argv) {
     pings[i].beams_bath_alloc = 0;
   }
   status &= mb_freed(verbose, __FILE__, __LINE__, (void **)&pings, &error);
-  status &= mb_freed(verbose, __FILE__, __LINE__, (void **)&voxel_count, &error);
+  mbvoxelclean_grid_clear(&grid);
 
   /* check memory */
   if ((status = mb_memory_list(verbose, &error)) == MB_FAILURE) {
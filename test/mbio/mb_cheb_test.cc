@@ -0,0 +1,197 @@
+// See README file for copying and redistribution conditions.
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "mbaux/mb_aux.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+// A navigation inversion in the fixed stride form built by mbnavadjust:
+// each row holds up to ia_dim entries at ia[ia_dim * i + j].
+struct StrideMatrix {
+  int m = 0;
+  int n = 0;
+  int ia_dim = 6;
+  std::vector<int> nia;
+  std::vector<int> ia;
+  std::vector<double> a;
+  std::vector<double> b;
+
+  void AddRow(const std::vector<int> &cols, const std::vector<double> &values, double rhs) {
+    nia.push_back(static_cast<int>(cols.size()));
+    for (int j = 0; j < ia_dim; j++) {
+      ia.push_back(j < static_cast<int>(cols.size()) ? cols[j] : 0);
+      a.push_back(j < static_cast<int>(values.size()) ? values[j] : 0.0);
+    }
+    b.push_back(rhs);
+    m++;
+  }
+};
+
+// The serial products of mb_aprod in mbnavadjust.
+void StrideAprod(int mode, int m, int n, double x[], double y[], void *UsrWrk) {
+  (void)n;
+  const StrideMatrix *matrix = static_cast<const StrideMatrix *>(UsrWrk);
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < matrix->nia[i]; j++) {
+      const int k = matrix->ia[matrix->ia_dim * i + j];
+      if (mode == 1)
+        y[i] += matrix->a[matrix->ia_dim * i + j] * x[k];
+      else
+        x[k] += matrix->a[matrix->ia_dim * i + j] * y[i];
+    }
+  }
+}
+
+// Deterministic pseudo random numbers in [0, 1).
+class Lcg {
+ public:
+  double Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<double>(state_ >> 11) / 9007199254740992.0;
+  }
+
+ private:
+  unsigned long long state_ = 42;
+};
+
+// A synthetic project: nsurvey tracks of npoint navigation points each with
+// x, y and z offsets, second difference smoothing along each track and
+// crossing ties interpolated between neighbouring points of two tracks.
+StrideMatrix SyntheticProject(int nsurvey, int npoint, int ntie) {
+  StrideMatrix matrix;
+  matrix.n = 3 * nsurvey * npoint;
+  Lcg random;
+  for (int isurvey = 0; isurvey < nsurvey; isurvey++) {
+    for (int ipoint = 1; ipoint < npoint - 1; ipoint++) {
+      const int inav = isurvey * npoint + ipoint;
+      for (int d = 0; d < 3; d++)
+        matrix.AddRow({3 * (inav - 1) + d, 3 * inav + d, 3 * (inav + 1) + d}, {-10.0, 20.0, -10.0}, 0.0);
+    }
+  }
+  for (int itie = 0; itie < ntie; itie++) {
+    const int inav1 = static_cast<int>(random.Next() * (nsurvey * npoint - 1));
+    const int inav2 = static_cast<int>(random.Next() * (nsurvey * npoint - 1));
+    const double f1 = random.Next();
+    const double f2 = random.Next();
+    for (int d = 0; d < 3; d++)
+      matrix.AddRow({3 * inav1 + d, 3 * (inav1 + 1) + d, 3 * inav2 + d, 3 * (inav2 + 1) + d},
+                    {-(1.0 - f1), -f1, 1.0 - f2, f2}, 20.0 * (random.Next() - 0.5));
+  }
+  return matrix;
+}
+
+class MbCheb : public ::testing::Test {
+ protected:
+  void TearDown() override { mbcblas_set_num_threads(1); }
+};
+
+TEST_F(MbCheb, CsrInitRejectsBadColumn) {
+  StrideMatrix matrix;
+  matrix.n = 2;
+  matrix.AddRow({0, 2}, {1.0, 1.0}, 0.0);
+  mblsqr_csr csr;
+  int error = MB_ERROR_NO_ERROR;
+  EXPECT_EQ(MB_FAILURE, mblsqr_csr_init(0, matrix.m, matrix.n, matrix.ia_dim, matrix.nia.data(), matrix.ia.data(),
+                                        matrix.a.data(), &csr, &error));
+  EXPECT_EQ(MB_ERROR_BAD_PARAMETER, error);
+}
+
+TEST_F(MbCheb, CsrProductsMatchStrideProducts) {
+  StrideMatrix matrix = SyntheticProject(4, 5000, 20000);
+  mblsqr_csr csr;
+  int error = MB_ERROR_NO_ERROR;
+  ASSERT_EQ(MB_SUCCESS, mblsqr_csr_init(0, matrix.m, matrix.n, matrix.ia_dim, matrix.nia.data(), matrix.ia.data(),
+                                        matrix.a.data(), &csr, &error));
+
+  Lcg random;
+  std::vector<double> x(matrix.n);
+  std::vector<double> y(matrix.m);
+  for (double &value : x)
+    value = random.Next() - 0.5;
+  for (double &value : y)
+    value = random.Next() - 0.5;
+
+  for (int nthreads : {1, 4}) {
+    mbcblas_set_num_threads(nthreads);
+    std::vector<double> x_stride = x;
+    std::vector<double> y_stride = y;
+    std::vector<double> x_csr = x;
+    std::vector<double> y_csr = y;
+    StrideAprod(1, matrix.m, matrix.n, x_stride.data(), y_stride.data(), &matrix);
+    mblsqr_csr_aprod(1, matrix.m, matrix.n, x_csr.data(), y_csr.data(), &csr);
+    EXPECT_EQ(y_stride, y_csr);
+    StrideAprod(2, matrix.m, matrix.n, x_stride.data(), y_stride.data(), &matrix);
+    mblsqr_csr_aprod(2, matrix.m, matrix.n, x_csr.data(), y_csr.data(), &csr);
+    EXPECT_EQ(x_stride, x_csr);
+  }
+
+  EXPECT_EQ(MB_SUCCESS, mblsqr_csr_deall(0, &csr, &error));
+}
+
+TEST_F(MbCheb, ThreadedKernelsMatchSerial) {
+  const int n = 200001;
+  Lcg random;
+  std::vector<double> x(n);
+  std::vector<double> y(n);
+  for (int i = 0; i < n; i++) {
+    x[i] = random.Next();
+    y[i] = random.Next();
+  }
+
+  std::vector<double> y_serial = y;
+  std::vector<double> x_serial = x;
+  mbcblas_daxpy(n, 0.3, x.data(), 1, y_serial.data(), 1);
+  mbcblas_dscal(n, -1.7, x_serial.data(), 1);
+
+  mbcblas_set_num_threads(4);
+  EXPECT_EQ(4, mbcblas_get_num_threads());
+  mbcblas_daxpy(n, 0.3, x.data(), 1, y.data(), 1);
+  mbcblas_dscal(n, -1.7, x.data(), 1);
+  EXPECT_EQ(y_serial, y);
+  EXPECT_EQ(x_serial, x);
+}
+
+// Benchmark: solve a synthetic project of 120000 navigation points with the
+// serial stride products and with the threaded sparse row products.
+TEST_F(MbCheb, SyntheticProjectLsqr) {
+  StrideMatrix matrix = SyntheticProject(8, 15000, 60000);
+  const int itnlim = 50;
+
+  auto solve = [&](void (*aprod)(int, int, int, double *, double *, void *), void *work, std::vector<double> *x) {
+    std::vector<double> u = matrix.b;
+    std::vector<double> v(matrix.n);
+    std::vector<double> w(matrix.n);
+    x->assign(matrix.n, 0.0);
+    int istop, itn;
+    double anorm, acond, rnorm, arnorm, xnorm;
+    const auto start = std::chrono::steady_clock::now();
+    mblsqr_lsqr(matrix.m, matrix.n, aprod, 0.0, work, u.data(), v.data(), w.data(), x->data(), nullptr, 5.0e-7, 5.0e-7,
+                1.0e7, itnlim, nullptr, &istop, &itn, &anorm, &acond, &rnorm, &arnorm, &xnorm);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  std::vector<double> x_stride;
+  const double t_stride = solve(&StrideAprod, &matrix, &x_stride);
+
+  mblsqr_csr csr;
+  int error = MB_ERROR_NO_ERROR;
+  ASSERT_EQ(MB_SUCCESS, mblsqr_csr_init(0, matrix.m, matrix.n, matrix.ia_dim, matrix.nia.data(), matrix.ia.data(),
+                                        matrix.a.data(), &csr, &error));
+  mbcblas_set_num_threads(static_cast<int>(std::thread::hardware_concurrency()));
+  std::vector<double> x_csr;
+  const double t_csr = solve(&mblsqr_csr_aprod, &csr, &x_csr);
+  mblsqr_csr_deall(0, &csr, &error);
+
+  fprintf(stderr, "LSQR %d rows %d columns %d iterations: stride %.3f s, sparse row with %d threads %.3f s\n", matrix.m,
+          matrix.n, itnlim, t_stride, mbcblas_get_num_threads(), t_csr);
+  EXPECT_EQ(x_stride, x_csr);
+}
+
+}  // namespace
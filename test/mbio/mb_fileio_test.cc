@@ -0,0 +1,190 @@
+// See README file for copying and redistribution conditions.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "mb_define.h"
+#include "mb_io.h"
+#include "mb_status.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+const size_t kFileSize = 32 * 1024 * 1024;
+const size_t kRecordSize = 20000;
+
+// Point HOME at a scratch directory holding an .mbio_defaults file so that
+// mb_fileiobuffer() returns the requested mode.
+class MbFileio : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir_template[] = "/tmp/mb_fileio_testXXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    dir_ = dir_template;
+    file_ = dir_ + "/data.bin";
+    const char *home = getenv("HOME");
+    if (home != nullptr)
+      home_ = home;
+    setenv("HOME", dir_.c_str(), 1);
+
+    data_.resize(kFileSize);
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < kFileSize; i++) {
+      seed = seed * 1103515245 + 12345;
+      data_[i] = static_cast<char>(seed >> 16);
+    }
+    FILE *fp = fopen(file_.c_str(), "wb");
+    ASSERT_NE(nullptr, fp);
+    ASSERT_EQ(kFileSize, fwrite(data_.data(), 1, kFileSize, fp));
+    fclose(fp);
+  }
+
+  void TearDown() override {
+    unlink(file_.c_str());
+    unlink((dir_ + "/.mbio_defaults").c_str());
+    rmdir(dir_.c_str());
+    if (!home_.empty())
+      setenv("HOME", home_.c_str(), 1);
+  }
+
+  void SetFileioBuffer(int fileiobuffer) {
+    FILE *fp = fopen((dir_ + "/.mbio_defaults").c_str(), "w");
+    ASSERT_NE(nullptr, fp);
+    fprintf(fp, "fileiobuffer:%d\n", fileiobuffer);
+    fclose(fp);
+  }
+
+  void Open(struct mb_io_struct *mb_io, bool mmap_ok) {
+    memset(mb_io, 0, sizeof(*mb_io));
+    strncpy(mb_io->file, file_.c_str(), sizeof(mb_io->file) - 1);
+    mb_io->filemode = MB_FILEMODE_READ;
+    mb_io->file_mmap_ok = mmap_ok;
+    int error = MB_ERROR_NO_ERROR;
+    ASSERT_EQ(MB_SUCCESS, mb_fileio_open(0, mb_io, &error));
+  }
+
+  // Read the whole file in fixed size records, returning MB/s.
+  double ReadAll(struct mb_io_struct *mb_io, std::vector<char> *out) {
+    out->resize(kFileSize);
+    int error = MB_ERROR_NO_ERROR;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < kFileSize; offset += kRecordSize) {
+      size_t size = std::min(kRecordSize, kFileSize - offset);
+      EXPECT_EQ(MB_SUCCESS, mb_fileio_get(0, mb_io, &(*out)[offset], &size, &error));
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return kFileSize / (1024.0 * 1024.0) / elapsed.count();
+  }
+
+  std::string dir_;
+  std::string file_;
+  std::string home_;
+  std::vector<char> data_;
+};
+
+TEST_F(MbFileio, StdioRead) {
+  SetFileioBuffer(0);
+  struct mb_io_struct mb_io;
+  Open(&mb_io, true);
+  EXPECT_EQ(nullptr, mb_io.file_mmap);
+  std::vector<char> out;
+  const double rate = ReadAll(&mb_io, &out);
+  EXPECT_EQ(data_, out);
+  printf("stdio read: %.1f MB/s\n", rate);
+  int error = MB_ERROR_NO_ERROR;
+  EXPECT_EQ(MB_SUCCESS, mb_fileio_close(0, &mb_io, &error));
+}
+
+TEST_F(MbFileio, MmapRead) {
+  SetFileioBuffer(-1);
+  struct mb_io_struct mb_io;
+  Open(&mb_io, true);
+  EXPECT_NE(nullptr, mb_io.file_mmap);
+  EXPECT_EQ(kFileSize, mb_io.file_mmap_size);
+  std::vector<char> out;
+  const double rate = ReadAll(&mb_io, &out);
+  EXPECT_EQ(data_, out);
+  printf("mmap read:  %.1f MB/s\n", rate);
+
+  // Reading past the end fails with EOF and a short count
+  int error = MB_ERROR_NO_ERROR;
+  char buffer[16];
+  size_t size = sizeof(buffer);
+  EXPECT_EQ(MB_FAILURE, mb_fileio_get(0, &mb_io, buffer, &size, &error));
+  EXPECT_EQ(MB_ERROR_EOF, error);
+  EXPECT_EQ(0u, size);
+  EXPECT_EQ(MB_SUCCESS, mb_fileio_close(0, &mb_io, &error));
+  EXPECT_EQ(nullptr, mb_io.file_mmap);
+}
+
+TEST_F(MbFileio, MmapRequiresDriverSupport) {
+  SetFileioBuffer(-1);
+  struct mb_io_struct mb_io;
+  Open(&mb_io, false);
+  EXPECT_EQ(nullptr, mb_io.file_mmap);
+  int error = MB_ERROR_NO_ERROR;
+  char *buffer = nullptr;
+  size_t size = 4;
+  EXPECT_EQ(MB_FAILURE, mb_fileio_map(0, &mb_io, &buffer, &size, &error));
+  EXPECT_EQ(MB_ERROR_BAD_PARAMETER, error);
+  EXPECT_EQ(MB_SUCCESS, mb_fileio_close(0, &mb_io, &error));
+}
+
+TEST_F(MbFileio, MmapZeroCopy) {
+  SetFileioBuffer(-1);
+  struct mb_io_struct mb_io;
+  Open(&mb_io, true);
+  ASSERT_NE(nullptr, mb_io.file_mmap);
+  int error = MB_ERROR_NO_ERROR;
+
+  const auto start = std::chrono::steady_clock::now();
+  long sum = 0;
+  for (size_t offset = 0; offset < kFileSize; offset += kRecordSize) {
+    char *buffer = nullptr;
+    size_t size = std::min(kRecordSize, kFileSize - offset);
+    ASSERT_EQ(MB_SUCCESS, mb_fileio_map(0, &mb_io, &buffer, &size, &error));
+    ASSERT_EQ(0, memcmp(buffer, &data_[offset], size));
+    sum += buffer[0];
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("mmap map:   %.1f MB/s (%ld)\n", kFileSize / (1024.0 * 1024.0) / elapsed.count(), sum);
+
+  char *buffer = nullptr;
+  size_t size = 1;
+  EXPECT_EQ(MB_FAILURE, mb_fileio_map(0, &mb_io, &buffer, &size, &error));
+  EXPECT_EQ(MB_ERROR_EOF, error);
+  EXPECT_EQ(MB_SUCCESS, mb_fileio_close(0, &mb_io, &error));
+}
+
+TEST_F(MbFileio, SeekTell) {
+  for (int fileiobuffer : {0, -1}) {
+    SetFileioBuffer(fileiobuffer);
+    struct mb_io_struct mb_io;
+    Open(&mb_io, true);
+    int error = MB_ERROR_NO_ERROR;
+    EXPECT_EQ(0, mb_fileio_tell(0, &mb_io));
+    EXPECT_EQ(0, mb_fileio_seek(0, &mb_io, 1000, SEEK_SET));
+    EXPECT_EQ(1000, mb_fileio_tell(0, &mb_io));
+    EXPECT_EQ(0, mb_fileio_seek(0, &mb_io, -10, SEEK_CUR));
+    EXPECT_EQ(990, mb_fileio_tell(0, &mb_io));
+    char buffer[8];
+    size_t size = sizeof(buffer);
+    EXPECT_EQ(MB_SUCCESS, mb_fileio_get(0, &mb_io, buffer, &size, &error));
+    EXPECT_EQ(0, memcmp(buffer, &data_[990], sizeof(buffer)));
+    EXPECT_EQ(998, mb_fileio_tell(0, &mb_io));
+    EXPECT_EQ(0, mb_fileio_seek(0, &mb_io, -8, SEEK_END));
+    EXPECT_EQ(static_cast<long>(kFileSize) - 8, mb_fileio_tell(0, &mb_io));
+    EXPECT_EQ(MB_SUCCESS, mb_fileio_close(0, &mb_io, &error));
+  }
+}
+
+}  // namespace
@@ -0,0 +1,201 @@
+// See README file for copying and redistribution conditions.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+#include "mb_define.h"
+#include "mb_format.h"
+#include "mb_io.h"
+#include "mb_status.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+const int kNumRecords = 200;
+const int kNumBeams = 11;
+const double kStartTime = 1600000000.0;
+
+// Writes a format 71 file with a comment before every tenth record and one
+// survey ping per second otherwise.
+class MbIndex : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir_template[] = "/tmp/mb_index_testXXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    dir_ = dir_template;
+    file_ = dir_ + "/data.mb71";
+
+    char file[MB_PATH_MAXLINE];
+    strncpy(file, file_.c_str(), sizeof(file) - 1);
+    file[sizeof(file) - 1] = '\0';
+    void *mbio_ptr = nullptr;
+    int beams_bath = 0;
+    int beams_amp = 0;
+    int pixels_ss = 0;
+    int error = MB_ERROR_NO_ERROR;
+    ASSERT_EQ(MB_SUCCESS, mb_write_init(0, file, MBF_MBLDEOIH, &mbio_ptr, &beams_bath, &beams_amp, &pixels_ss, &error));
+    void *store_ptr = static_cast<struct mb_io_struct *>(mbio_ptr)->store_data;
+
+    char beamflag[kNumBeams];
+    double bath[kNumBeams];
+    double bathacrosstrack[kNumBeams];
+    double bathalongtrack[kNumBeams];
+    for (int i = 0; i < kNumBeams; i++) {
+      beamflag[i] = MB_FLAG_NONE;
+      bath[i] = 1000.0 + i;
+      bathacrosstrack[i] = 100.0 * (i - kNumBeams / 2);
+      bathalongtrack[i] = 0.0;
+    }
+    for (int irecord = 0; irecord < kNumRecords; irecord++) {
+      if (irecord % 10 == 0) {
+        char comment[MB_COMMENT_MAXLINE];
+        snprintf(comment, sizeof(comment), "comment %d", irecord);
+        ASSERT_EQ(MB_SUCCESS, mb_put_comment(0, mbio_ptr, comment, &error));
+      }
+      else {
+        const double time_d = kStartTime + irecord;
+        int time_i[7];
+        mb_get_date(0, time_d, time_i);
+        ASSERT_EQ(MB_SUCCESS, mb_put_all(0, mbio_ptr, store_ptr, true, MB_DATA_DATA, time_i, time_d, -122.0, 36.0, 10.0,
+                                         90.0, kNumBeams, 0, 0, beamflag, bath, nullptr, bathacrosstrack, bathalongtrack,
+                                         nullptr, nullptr, nullptr, nullptr, &error));
+      }
+    }
+    ASSERT_EQ(MB_SUCCESS, mb_close(0, &mbio_ptr, &error));
+  }
+
+  void TearDown() override {
+    unlink((file_ + ".idx").c_str());
+    unlink(file_.c_str());
+    rmdir(dir_.c_str());
+  }
+
+  void *Open() {
+    char file[MB_PATH_MAXLINE];
+    strncpy(file, file_.c_str(), sizeof(file) - 1);
+    file[sizeof(file) - 1] = '\0';
+    double bounds[4] = {-360.0, 360.0, -90.0, 90.0};
+    int btime_i[7] = {1962, 2, 21, 10, 30, 0, 0};
+    int etime_i[7] = {2062, 2, 21, 10, 30, 0, 0};
+    double btime_d = 0.0;
+    double etime_d = 0.0;
+    int beams_bath = 0;
+    int beams_amp = 0;
+    int pixels_ss = 0;
+    int error = MB_ERROR_NO_ERROR;
+    void *mbio_ptr = nullptr;
+    EXPECT_EQ(MB_SUCCESS, mb_read_init(0, file, MBF_MBLDEOIH, 1, 0, bounds, btime_i, etime_i, 0.0, 0.0, &mbio_ptr,
+                                       &btime_d, &etime_d, &beams_bath, &beams_amp, &pixels_ss, &error));
+    return mbio_ptr;
+  }
+
+  // Reads the next record, returning its time or -1 if it is not a ping.
+  double ReadTime(void *mbio_ptr) {
+    void *store_ptr = static_cast<struct mb_io_struct *>(mbio_ptr)->store_data;
+    int kind = MB_DATA_NONE;
+    int error = MB_ERROR_NO_ERROR;
+    if (mb_read_ping(0, mbio_ptr, store_ptr, &kind, &error) != MB_SUCCESS || kind != MB_DATA_DATA)
+      return -1.0;
+    int time_i[7];
+    double time_d = 0.0;
+    double navlon, navlat, speed, heading, draft, roll, pitch, heave;
+    mb_extract_nav(0, mbio_ptr, store_ptr, &kind, time_i, &time_d, &navlon, &navlat, &speed, &heading, &draft, &roll,
+                   &pitch, &heave, &error);
+    return time_d;
+  }
+
+  void MakeIndex() {
+    char file[MB_PATH_MAXLINE];
+    strncpy(file, file_.c_str(), sizeof(file) - 1);
+    file[sizeof(file) - 1] = '\0';
+    int error = MB_ERROR_NO_ERROR;
+    ASSERT_EQ(MB_SUCCESS, mb_make_index(0, file, MBF_MBLDEOIH, &error));
+    ASSERT_EQ(0, access((file_ + ".idx").c_str(), R_OK));
+  }
+
+  std::string dir_;
+  std::string file_;
+};
+
+TEST_F(MbIndex, ShouldMakeIndex) {
+  EXPECT_TRUE(mb_should_make_index(0, MBF_MBLDEOIH));
+  EXPECT_FALSE(mb_should_make_index(0, MBF_SBSIOMRG));
+}
+
+TEST_F(MbIndex, MakeIndexBadFormat) {
+  char file[MB_PATH_MAXLINE];
+  strncpy(file, file_.c_str(), sizeof(file) - 1);
+  file[sizeof(file) - 1] = '\0';
+  int error = MB_ERROR_NO_ERROR;
+  EXPECT_EQ(MB_FAILURE, mb_make_index(0, file, MBF_SBSIOMRG, &error));
+  EXPECT_EQ(MB_ERROR_BAD_FORMAT, error);
+}
+
+TEST_F(MbIndex, SeekPing) {
+  MakeIndex();
+  void *mbio_ptr = Open();
+  ASSERT_NE(nullptr, mbio_ptr);
+  int error = MB_ERROR_NO_ERROR;
+
+  // Ping n is record n + n / 9 + 1 because of the comments
+  for (int ping : {50, 3, 0, 169}) {
+    ASSERT_EQ(MB_SUCCESS, mb_read_seek_ping(0, mbio_ptr, ping, &error));
+    EXPECT_EQ(kStartTime + ping + ping / 9 + 1, ReadTime(mbio_ptr));
+    EXPECT_EQ(kStartTime + ping + ping / 9 + 2, ReadTime(mbio_ptr));
+  }
+
+  EXPECT_EQ(MB_FAILURE, mb_read_seek_ping(0, mbio_ptr, kNumRecords, &error));
+  EXPECT_EQ(MB_ERROR_EOF, error);
+  EXPECT_EQ(MB_FAILURE, mb_read_seek_ping(0, mbio_ptr, -1, &error));
+  EXPECT_EQ(MB_SUCCESS, mb_close(0, &mbio_ptr, &error));
+}
+
+TEST_F(MbIndex, SeekTime) {
+  MakeIndex();
+  void *mbio_ptr = Open();
+  ASSERT_NE(nullptr, mbio_ptr);
+  int error = MB_ERROR_NO_ERROR;
+
+  ASSERT_EQ(MB_SUCCESS, mb_read_seek_time(0, mbio_ptr, kStartTime + 120.5, &error));
+  EXPECT_EQ(kStartTime + 121, ReadTime(mbio_ptr));
+
+  // Record 130 is a comment so the next ping is record 131
+  ASSERT_EQ(MB_SUCCESS, mb_read_seek_time(0, mbio_ptr, kStartTime + 129.5, &error));
+  EXPECT_EQ(kStartTime + 131, ReadTime(mbio_ptr));
+
+  ASSERT_EQ(MB_SUCCESS, mb_read_seek_time(0, mbio_ptr, 0.0, &error));
+  EXPECT_EQ(kStartTime + 1, ReadTime(mbio_ptr));
+
+  EXPECT_EQ(MB_FAILURE, mb_read_seek_time(0, mbio_ptr, kStartTime + kNumRecords, &error));
+  EXPECT_EQ(MB_ERROR_EOF, error);
+  EXPECT_EQ(MB_SUCCESS, mb_close(0, &mbio_ptr, &error));
+}
+
+TEST_F(MbIndex, MissingOrStaleIndex) {
+  void *mbio_ptr = Open();
+  ASSERT_NE(nullptr, mbio_ptr);
+  int error = MB_ERROR_NO_ERROR;
+  EXPECT_EQ(MB_FAILURE, mb_read_seek_ping(0, mbio_ptr, 5, &error));
+  EXPECT_EQ(MB_ERROR_FILE_NOT_FOUND, error);
+  EXPECT_EQ(MB_SUCCESS, mb_close(0, &mbio_ptr, &error));
+
+  // Changing the data file invalidates the index
+  MakeIndex();
+  FILE *fp = fopen(file_.c_str(), "ab");
+  ASSERT_NE(nullptr, fp);
+  fputc(0, fp);
+  fclose(fp);
+  mbio_ptr = Open();
+  ASSERT_NE(nullptr, mbio_ptr);
+  EXPECT_EQ(MB_FAILURE, mb_read_seek_ping(0, mbio_ptr, 5, &error));
+  EXPECT_EQ(MB_ERROR_FILE_NOT_FOUND, error);
+  EXPECT_EQ(MB_SUCCESS, mb_close(0, &mbio_ptr, &error));
+}
+
+}  // namespace
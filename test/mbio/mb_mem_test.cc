@@ -4,6 +4,8 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <thread>
+#include <vector>
 
 #include "mb_define.h"
 #include "mb_status.h"
@@ -90,12 +92,84 @@ TEST(MbDebug, FreeNullptr) {
   EXPECT_EQ(MB_ERROR_NO_ERROR, error);
 }
 
-// TODO(schwehr): Test mb_mallocd
+TEST(MbDebug, ReallocdTracksMovedPointer) {
+  int error = MB_ERROR_NO_ERROR;
+  int verbose = 0;
+  int nalloc0, nalloc, nallocmax, overflow;
+  size_t allocsize0, allocsize;
+  EXPECT_EQ(MB_SUCCESS, mb_memory_status(verbose, &nalloc0, &nallocmax, &overflow, &allocsize0, &error));
+
+  void *ptr = nullptr;
+  EXPECT_EQ(MB_SUCCESS, mb_mallocd(verbose, __FILE__, __LINE__, 16, &ptr, &error));
+  EXPECT_EQ(MB_SUCCESS, mb_reallocd(verbose, __FILE__, __LINE__, 1000000, &ptr, &error));
+  EXPECT_NE(nullptr, ptr);
+  EXPECT_EQ(MB_SUCCESS, mb_memory_status(verbose, &nalloc, &nallocmax, &overflow, &allocsize, &error));
+  EXPECT_EQ(nalloc0 + 1, nalloc);
+  EXPECT_EQ(allocsize0 + 1000000, allocsize);
+
+  EXPECT_EQ(MB_SUCCESS, mb_freed(verbose, __FILE__, __LINE__, &ptr, &error));
+  EXPECT_EQ(nullptr, ptr);
+  EXPECT_EQ(MB_SUCCESS, mb_memory_status(verbose, &nalloc, &nallocmax, &overflow, &allocsize, &error));
+  EXPECT_EQ(nalloc0, nalloc);
+  EXPECT_EQ(allocsize0, allocsize);
+}
+
+TEST(MbDebug, ConcurrentAllocations) {
+  int error = MB_ERROR_NO_ERROR;
+  int verbose = 0;
+  int nalloc0, nalloc, nallocmax, overflow;
+  size_t allocsize0, allocsize;
+  EXPECT_EQ(MB_SUCCESS, mb_memory_status(verbose, &nalloc0, &nallocmax, &overflow, &allocsize0, &error));
+
+  // Each thread keeps a changing set of allocations, some of which are
+  // reallocated, and frees the rest at the end.
+  const int kThreads = 8;
+  const int kAllocs = 500;
+  std::vector<std::thread> threads;
+  for (int ithread = 0; ithread < kThreads; ithread++) {
+    threads.emplace_back([ithread]() {
+      int thread_error = MB_ERROR_NO_ERROR;
+      std::vector<void *> ptrs(kAllocs, nullptr);
+      for (int pass = 0; pass < 4; pass++) {
+        for (int i = 0; i < kAllocs; i++) {
+          if (ptrs[i] == nullptr)
+            mb_mallocd(0, __FILE__, __LINE__, 8 + i + ithread, &ptrs[i], &thread_error);
+          else if ((i + pass) % 3 == 0)
+            mb_reallocd(0, __FILE__, __LINE__, 64 + i, &ptrs[i], &thread_error);
+          else if ((i + pass) % 3 == 1)
+            mb_freed(0, __FILE__, __LINE__, &ptrs[i], &thread_error);
+        }
+      }
+      for (int i = 0; i < kAllocs; i++)
+        mb_freed(0, __FILE__, __LINE__, &ptrs[i], &thread_error);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(MB_SUCCESS, mb_memory_status(verbose, &nalloc, &nallocmax, &overflow, &allocsize, &error));
+  EXPECT_EQ(nalloc0, nalloc);
+  EXPECT_EQ(allocsize0, allocsize);
+  EXPECT_EQ(0, overflow);
+}
+
+TEST(MbDebug, MemoryClear) {
+  int error = MB_ERROR_NO_ERROR;
+  int verbose = 0;
+
+  void *ptrs[100];
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(MB_SUCCESS, mb_mallocd(verbose, __FILE__, __LINE__, 10 + i, &ptrs[i], &error));
+  EXPECT_EQ(MB_SUCCESS, mb_memory_clear(verbose, &error));
+
+  int nalloc, nallocmax, overflow;
+  size_t allocsize;
+  EXPECT_EQ(MB_SUCCESS, mb_memory_status(verbose, &nalloc, &nallocmax, &overflow, &allocsize, &error));
+  EXPECT_EQ(0, nalloc);
+  EXPECT_EQ(0u, allocsize);
+}
+
 // TODO(schwehr): Test mb_realloc
-// TODO(schwehr): Test mb_reallocd
-// TODO(schwehr): Test mb_freed
-// TODO(schwehr): Test mb_memory_clear
-// TODO(schwehr): Test mb_memory_status
 // TODO(schwehr): Test mb_memory_list
 // TODO(schwehr): Test mb_register_array
 // TODO(schwehr): Test mb_update_arrays
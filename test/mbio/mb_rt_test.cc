@@ -0,0 +1,83 @@
+// See README file for copying and redistribution conditions.
+
+#include <cmath>
+
+#include "mb_define.h"
+#include "mb_status.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+const double kTolerance = 0.05;
+const int kSsvNoUse = 0;  // surface sound speed not used
+
+// A deep water profile with a surface mixed layer, a thermocline and a
+// deep sound channel.
+class MbRt : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    double depth[] = {0.0, 50.0, 100.0, 200.0, 400.0, 700.0, 1000.0, 1500.0, 2000.0, 3000.0, 4000.0, 5000.0};
+    double velocity[] = {1510.0, 1509.5, 1500.0, 1492.0, 1486.0, 1482.0,
+                         1481.0, 1483.0, 1486.0, 1501.0, 1517.0, 1534.0};
+    const int nsvp = sizeof(depth) / sizeof(double);
+    int error = MB_ERROR_NO_ERROR;
+    ASSERT_EQ(MB_SUCCESS, mb_rt_init(0, nsvp, depth, velocity, &exact_, &error));
+    ASSERT_EQ(MB_SUCCESS, mb_rt_init(0, nsvp, depth, velocity, &table_, &error));
+    ASSERT_EQ(MB_SUCCESS, mb_rt_table_init(0, table_, kTolerance, &error));
+  }
+
+  void TearDown() override {
+    int error = MB_ERROR_NO_ERROR;
+    mb_rt_deall(0, &exact_, &error);
+    mb_rt_deall(0, &table_, &error);
+  }
+
+  void *exact_ = nullptr;
+  void *table_ = nullptr;
+};
+
+TEST_F(MbRt, TableInitRejectsBadTolerance) {
+  int error = MB_ERROR_NO_ERROR;
+  EXPECT_EQ(MB_FAILURE, mb_rt_table_init(0, exact_, 0.0, &error));
+  EXPECT_EQ(MB_ERROR_BAD_PARAMETER, error);
+}
+
+TEST_F(MbRt, TableMatchesExactRaytracing) {
+  int nrays = 0;
+  for (double source_depth = 2.0; source_depth < 20.0; source_depth += 3.7) {
+    for (double angle = -70.0; angle <= 70.0; angle += 3.3) {
+      for (double end_time = 0.05; end_time < 3.0; end_time += 0.137) {
+        int error = MB_ERROR_NO_ERROR;
+        int ray_stat_exact = 0;
+        int ray_stat_table = 0;
+        double x_exact = 0.0;
+        double z_exact = 0.0;
+        double x_table = 0.0;
+        double z_table = 0.0;
+        double tt_exact = 0.0;
+        double tt_table = 0.0;
+        int nplot = 0;
+        ASSERT_EQ(MB_SUCCESS, mb_rt(0, exact_, source_depth, angle, end_time, kSsvNoUse, 0.0, 0.0, 0, &nplot,
+                                    nullptr, nullptr, nullptr, &x_exact, &z_exact, &tt_exact, &ray_stat_exact, &error));
+        ASSERT_EQ(MB_SUCCESS, mb_rt(0, table_, source_depth, angle, end_time, kSsvNoUse, 0.0, 0.0, 0, &nplot,
+                                    nullptr, nullptr, nullptr, &x_table, &z_table, &tt_table, &ray_stat_table, &error));
+        EXPECT_NEAR(x_exact, x_table, kTolerance);
+        EXPECT_NEAR(z_exact, z_table, kTolerance);
+        EXPECT_DOUBLE_EQ(tt_exact, tt_table);
+        nrays++;
+      }
+    }
+  }
+
+  // most rays are expected to come from the tables
+  int nlookup = 0;
+  int nexact = 0;
+  int error = MB_ERROR_NO_ERROR;
+  ASSERT_EQ(MB_SUCCESS, mb_rt_table_stats(0, table_, &nlookup, &nexact, &error));
+  EXPECT_EQ(nrays, nlookup + nexact);
+  EXPECT_GT(nlookup, nexact);
+}
+
+}  // namespace
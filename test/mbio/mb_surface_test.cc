@@ -0,0 +1,117 @@
+// See README file for copying and redistribution conditions.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "mbaux/mb_aux.h"
+#include "mbio/mb_status.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+// Deterministic pseudo random numbers in [0, 1).
+class Lcg {
+ public:
+  double Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<double>(state_ >> 11) / 9007199254740992.0;
+  }
+
+ private:
+  unsigned long long state_ = 42;
+};
+
+// Soundings scattered over a grid of n_columns by n_rows nodes 10 m apart,
+// sampling a smooth seafloor with a relief of about 200 m. The number of
+// intervals in each direction has a large common factor so that the
+// surface fit converges.
+class MbSurface : public ::testing::Test {
+ protected:
+  void Scatter(int n_columns, int n_rows, int ndat) {
+    n_columns_ = n_columns;
+    n_rows_ = n_rows;
+    Lcg random;
+    for (int k = 0; k < ndat; k++) {
+      const double u = (n_columns - 1) * random.Next();
+      const double v = (n_rows - 1) * random.Next();
+      x_.push_back(kXmin + kInc * u);
+      y_.push_back(kYmin + kInc * v);
+      z_.push_back(-1000.0 + 90.0 * sin(u / 37.0) * cos(v / 23.0) + 0.1 * u);
+    }
+    range_ = *std::max_element(z_.begin(), z_.end()) - *std::min_element(z_.begin(), z_.end());
+  }
+
+  std::vector<float> Serial() {
+    std::vector<float> grid(n_columns_ * n_rows_);
+    EXPECT_EQ(MB_SUCCESS, mb_surface(0, x_.size(), x_.data(), y_.data(), z_.data(), kXmin, Xmax(), kYmin, Ymax(), kInc,
+                                     kInc, kTension, grid.data()));
+    return grid;
+  }
+
+  std::vector<float> Tiled(int tile_dim, int tile_overlap, int nthreads) {
+    std::vector<float> grid(n_columns_ * n_rows_);
+    EXPECT_EQ(MB_SUCCESS, mb_surface_tiled(0, x_.size(), x_.data(), y_.data(), z_.data(), kXmin, Xmax(), kYmin, Ymax(),
+                                           kInc, kInc, kTension, tile_dim, tile_overlap, nthreads, grid.data()));
+    return grid;
+  }
+
+  double Xmax() const { return kXmin + kInc * (n_columns_ - 1); }
+  double Ymax() const { return kYmin + kInc * (n_rows_ - 1); }
+
+  static constexpr double kXmin = 5000.0;
+  static constexpr double kYmin = 2000.0;
+  static constexpr double kInc = 10.0;
+  static constexpr double kTension = 0.35;
+  int n_columns_ = 0;
+  int n_rows_ = 0;
+  double range_ = 0.0;
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+};
+
+TEST_F(MbSurface, ThreadedFitDoesNotDependOnThreads) {
+  Scatter(129, 97, 600);
+
+  // A tile larger than the grid fits the whole grid at once
+  const std::vector<float> one = Tiled(4096, 0, 1);
+  for (int nthreads = 2; nthreads <= 5; nthreads++)
+    EXPECT_EQ(one, Tiled(4096, 0, nthreads)) << nthreads << " threads";
+}
+
+TEST_F(MbSurface, TiledFitDoesNotDependOnThreads) {
+  Scatter(161, 161, 800);
+  const std::vector<float> one = Tiled(96, 8, 1);
+  EXPECT_EQ(one, Tiled(96, 8, 3));
+  EXPECT_EQ(one, Tiled(96, 8, 4));
+}
+
+TEST_F(MbSurface, TiledFitMatchesGlobalFit) {
+  Scatter(161, 161, 800);
+  const std::vector<float> global = Serial();
+  const std::vector<float> tiled = Tiled(96, 8, 2);
+
+  // The fits agree closely away from the grid edges, where the surface is
+  // extrapolated and depends most on the data far away
+  const int border = 8;
+  double sum = 0.0;
+  double max_interior = 0.0;
+  double max_all = 0.0;
+  for (int j = 0; j < n_rows_; j++)
+    for (int i = 0; i < n_columns_; i++) {
+      const double diff = fabs(global[j * n_columns_ + i] - tiled[j * n_columns_ + i]);
+      sum += diff * diff;
+      max_all = std::max(max_all, diff);
+      if (i >= border && i < n_columns_ - border && j >= border && j < n_rows_ - border)
+        max_interior = std::max(max_interior, diff);
+    }
+  EXPECT_LT(sqrt(sum / (n_columns_ * n_rows_)), 0.01 * range_);
+  EXPECT_LT(max_interior, 0.02 * range_);
+  EXPECT_LT(max_all, 0.1 * range_);
+}
+
+}  // namespace
@@ -0,0 +1,179 @@
+// See README file for copying and redistribution conditions.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <netcdf.h>
+
+#include "mapio.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace {
+
+const int kColumns = 300;
+const int kRows = 200;
+const double kX0 = 1000.0;
+const double kY0 = 5000.0;
+const double kDx = 2.0;
+
+// Small tiles and a small cache so that submaps span several tiles and
+// tiles are evicted while the tests run.
+const int kTileDim = 16;
+const int kMaxTiles = 24;
+
+// Writes a GMT style grid (x and y with actual_range, z(y, x)) whose z
+// values are all different.
+class MapioTiles : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir_template[] = "/tmp/mapio_testXXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir_template));
+    dir_ = dir_template;
+    file_ = dir_ + "/map.grd";
+
+    int ncid, xdim, ydim, xid, yid, zid;
+    ASSERT_EQ(NC_NOERR, nc_create(file_.c_str(), NC_CLOBBER, &ncid));
+    ASSERT_EQ(NC_NOERR, nc_def_dim(ncid, "x", kColumns, &xdim));
+    ASSERT_EQ(NC_NOERR, nc_def_dim(ncid, "y", kRows, &ydim));
+    ASSERT_EQ(NC_NOERR, nc_def_var(ncid, "x", NC_DOUBLE, 1, &xdim, &xid));
+    ASSERT_EQ(NC_NOERR, nc_def_var(ncid, "y", NC_DOUBLE, 1, &ydim, &yid));
+    const int zdims[2] = {ydim, xdim};
+    ASSERT_EQ(NC_NOERR, nc_def_var(ncid, "z", NC_FLOAT, 2, zdims, &zid));
+    const double xrange[2] = {kX0, kX0 + (kColumns - 1) * kDx};
+    const double yrange[2] = {kY0, kY0 + (kRows - 1) * kDx};
+    ASSERT_EQ(NC_NOERR, nc_put_att_double(ncid, xid, "actual_range", NC_DOUBLE, 2, xrange));
+    ASSERT_EQ(NC_NOERR, nc_put_att_double(ncid, yid, "actual_range", NC_DOUBLE, 2, yrange));
+    ASSERT_EQ(NC_NOERR, nc_enddef(ncid));
+
+    std::vector<double> x(kColumns), y(kRows);
+    for (int i = 0; i < kColumns; i++)
+      x[i] = xrange[0] + i * kDx;
+    for (int j = 0; j < kRows; j++)
+      y[j] = yrange[0] + j * kDx;
+    std::vector<float> z(kColumns * kRows);
+    for (int j = 0; j < kRows; j++)
+      for (int i = 0; i < kColumns; i++)
+        z[j * kColumns + i] = -1000.0f - j - 0.001f * i;
+    ASSERT_EQ(NC_NOERR, nc_put_var_double(ncid, xid, x.data()));
+    ASSERT_EQ(NC_NOERR, nc_put_var_double(ncid, yid, y.data()));
+    ASSERT_EQ(NC_NOERR, nc_put_var_float(ncid, zid, z.data()));
+    ASSERT_EQ(NC_NOERR, nc_close(ncid));
+  }
+
+  void TearDown() override {
+    unlink(file_.c_str());
+    rmdir(dir_.c_str());
+  }
+
+  struct mapsrc *Open(bool tiled) {
+    struct mapsrc *src = mapsrc_init();
+    mapsrc_fill(file_.c_str(), src);
+    EXPECT_TRUE(src->status & MAPSRC_IS_FILLED);
+    if (tiled)
+      EXPECT_EQ(MAPIO_OK, mapsrc_tiles_enable(src, kTileDim, kMaxTiles));
+    return src;
+  }
+
+  std::string dir_;
+  std::string file_;
+};
+
+struct mapdata *NewMapdata() {
+  struct mapdata *data = (struct mapdata *)calloc(1, sizeof(struct mapdata));
+  data->status = MAPDATA_IS_EMPTY;
+  return data;
+}
+
+// Fills a submap from both sources and expects identical results
+void ExpectSameSubmap(struct mapsrc *direct, struct mapsrc *cached, double x, double y, double width) {
+  struct mapdata *expected = NewMapdata();
+  struct mapdata *actual = NewMapdata();
+  const int expected_code = mapdata_fill(direct, expected, x, y, width, width);
+  EXPECT_EQ(expected_code, mapdata_fill(cached, actual, x, y, width, width));
+  ASSERT_EQ(expected->xdimlen, actual->xdimlen);
+  ASSERT_EQ(expected->ydimlen, actual->ydimlen);
+  EXPECT_EQ(0, memcmp(expected->z, actual->z, expected->xdimlen * expected->ydimlen * sizeof(float)))
+      << "submap at " << x << " " << y;
+  mapdata_free(expected, 1);
+  mapdata_free(actual, 1);
+}
+
+TEST_F(MapioTiles, CachedSubmapsMatchDirectReads) {
+  struct mapsrc *direct = Open(false);
+  struct mapsrc *cached = Open(true);
+
+  // Submaps at tile corners, straddling tile edges, at the map edges, and
+  // revisited after their tiles have been evicted
+  const double width = 50.0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (double y = kY0 + 10.0; y < kY0 + kRows * kDx; y += 37.0)
+      for (double x = kX0 + 10.0; x < kX0 + kColumns * kDx; x += 53.0)
+        ExpectSameSubmap(direct, cached, x, y, width);
+  }
+  ExpectSameSubmap(direct, cached, kX0 + kColumns * kDx / 2, kY0 + kRows * kDx / 2, kDx * kTileDim * 3);
+
+  mapsrc_free(&direct);
+  mapsrc_free(&cached);
+}
+
+TEST_F(MapioTiles, CachedPointsMatchDirectReads) {
+  struct mapsrc *direct = Open(false);
+  struct mapsrc *cached = Open(true);
+  for (int k = 0; k < 500; k++) {
+    const double x = kX0 + 1.0 + fmod(k * 7.31, (kColumns - 2) * kDx);
+    const double y = kY0 + 1.0 + fmod(k * 3.17, (kRows - 2) * kDx);
+    EXPECT_EQ(mapsrc_find(direct, x, y), mapsrc_find(cached, x, y)) << x << " " << y;
+  }
+  mapsrc_free(&direct);
+  mapsrc_free(&cached);
+}
+
+TEST_F(MapioTiles, PrefetchedSubmapsMatchDirectReads) {
+  struct mapsrc *direct = Open(false);
+  struct mapsrc *cached = Open(true);
+
+  // Prefetch ahead along a track and read each submap once the track gets
+  // there, as TerrainMapDEM does
+  const double width = 40.0;
+  const double y = kY0 + kRows * kDx / 2;
+  for (double x = kX0 + 30.0; x < kX0 + kColumns * kDx - 30.0; x += 20.0) {
+    mapsrc_tiles_prefetch(cached, x + width, y, width, width);
+    ExpectSameSubmap(direct, cached, x, y, width);
+  }
+
+  // Tiles may still be loading when the map is freed
+  mapsrc_tiles_prefetch(cached, kX0 + 100.0, kY0 + 100.0, 150.0, 150.0);
+  mapsrc_free(&direct);
+  mapsrc_free(&cached);
+}
+
+TEST_F(MapioTiles, OpenWhilePrefetching) {
+  struct mapsrc *direct = Open(false);
+  struct mapsrc *cached = Open(true);
+
+  // Opening other maps while the prefetch thread reads tiles
+  std::thread reader([&]() {
+    for (int k = 0; k < 50; k++)
+      mapsrc_tiles_prefetch(cached, kX0 + 20.0 + 8.0 * k, kY0 + 20.0 + 5.0 * k, 60.0, 60.0);
+  });
+  for (int k = 0; k < 20; k++) {
+    struct mapsrc *other = Open(k % 2 == 0);
+    mapsrc_free(&other);
+  }
+  reader.join();
+
+  ExpectSameSubmap(direct, cached, kX0 + 200.0, kY0 + 150.0, 60.0);
+  mapsrc_free(&direct);
+  mapsrc_free(&cached);
+}
+
+}  // namespace